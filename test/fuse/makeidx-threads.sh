@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# sra-makeidx builds the same indexes, sizes and md5-s on 1 and on 4 threads
+# usage: makeidx-threads.sh BINDIR [ KAR-FILES... ]
+
+BINDIR=$1
+shift
+SOURCES="$@"
+if [ "$SOURCES" == "" ] ; then
+    SOURCES=`dirname $0`/../vdb-validate/db/SRR053325
+fi
+
+MAKEIDX=$BINDIR/sra-makeidx
+if [ ! -x $MAKEIDX ] ; then
+    echo "$MAKEIDX not found: skipping the test"
+    exit 0
+fi
+
+TMP=tmp-makeidx-threads
+rm -fr $TMP
+mkdir -p $TMP || exit 1
+
+fail() {
+    echo "Failure: $1"
+    rm -fr $TMP
+    exit 2
+}
+
+for SRC in $SOURCES ; do
+    ACC=`basename $SRC`
+    for BLOCK in 4096 65536 ; do
+        for T in 1 4 ; do
+            DIR=$TMP/$T/$ACC
+            rm -fr $DIR
+            mkdir -p $TMP/$T
+            $BINDIR/kar --extract $SRC --directory $DIR > /dev/null \
+                || fail "cannot extract $SRC"
+            # -g: the plain indexes are built too, not only the gzip-ed ones
+            echo $ sra-makeidx -g -b $BLOCK -t $T $ACC
+            $MAKEIDX -g -b $BLOCK -t $T -a $ACC $DIR \
+                || fail "sra-makeidx -b $BLOCK -t $T $ACC failed"
+            $BINDIR/kdbmeta $DIR FUSE > $TMP/$T.meta \
+                || fail "no FUSE metadata in $ACC"
+        done
+
+        diff $TMP/1.meta $TMP/4.meta > /dev/null \
+            || fail "$ACC -b $BLOCK: sizes or md5-s differ between 1 and 4 threads"
+        for IDX in $TMP/1/$ACC/idx/fuse-* ; do
+            NAME=`basename $IDX`
+            cmp -s $IDX $TMP/4/$ACC/idx/$NAME \
+                || fail "$ACC -b $BLOCK: index $NAME differs between 1 and 4 threads"
+        done
+        if [ ! -e $TMP/1/$ACC/idx/fuse-fastq-gz ] ; then
+            fail "$ACC -b $BLOCK: no index was built"
+        fi
+    done
+done
+
+echo "Success: sra-makeidx builds the same indexes on 1 and 4 threads"
+rm -fr $TMP
@@ -0,0 +1,304 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <klib/rc.h>
+#include <klib/time.h> /* KSleepMs */
+#include <kproc/thread.h>
+
+#include <pthread.h>
+#include <string.h>
+
+extern "C" {
+#include "block-cache.h"
+}
+
+TEST_SUITE ( TestBlockCache );
+
+/* the generated file: BLOCKS blocks of BLOCK bytes, the last one is short */
+static const size_t BLOCK = 1000;
+static const uint64_t BLOCKS = 20;
+static const uint64_t FILE_SZ = BLOCKS * BLOCK - 123;
+
+static char Content ( uint64_t pos ) {
+    return ( char ) ( pos * 7 + pos / 251 );
+}
+
+struct TestFile {
+    /* fill of a file is serialized by the cache:
+       the counters are read when the file is released or has no read-ahead */
+    uint32_t fills [ BLOCKS ]; /* times each block is generated */
+    uint32_t ahead;            /* blocks generated on read-ahead threads */
+    pthread_t reader;
+    BlockCacheFile * file;
+
+    TestFile () : ahead ( 0 ), reader ( pthread_self () ), file ( NULL ) {
+        memset ( fills, 0, sizeof fills );
+    }
+    ~TestFile () { Release (); }
+
+    void Release () {
+        BlockCacheFile_Release ( file );
+        file = NULL;
+    }
+};
+
+static rc_t Locate ( void * data, uint64_t pos, BlockCache_Block * block ) {
+    block -> from = pos / BLOCK * BLOCK;
+    block -> size = FILE_SZ - block -> from < BLOCK
+        ? FILE_SZ - block -> from : BLOCK;
+    block -> id = ( int64_t ) ( pos / BLOCK ) + 1;
+    block -> id_qty = 1;
+    return 0;
+}
+
+static rc_t Fill ( void * data, const BlockCache_Block * block,
+    char * buf, size_t buf_sz, size_t * size )
+{
+    TestFile * f = ( TestFile * ) data;
+    if ( block -> size > buf_sz )
+        return RC ( rcExe, rcFile, rcReading, rcBuffer, rcInsufficient );
+    for ( uint64_t i = 0; i < block -> size; ++ i )
+        buf [ i ] = Content ( block -> from + i );
+    * size = ( size_t ) block -> size;
+    ++ f -> fills [ block -> from / BLOCK ];
+    if ( ! pthread_equal ( pthread_self (), f -> reader ) )
+        ++ f -> ahead;
+    return 0;
+}
+
+static rc_t Open ( TestFile & f ) {
+    return BlockCacheFile_Make ( & f . file, FILE_SZ, BLOCK,
+        Locate, Fill, & f );
+}
+
+/* reads size bytes at pos and compares them with the generated content */
+static bool Check ( BlockCacheFile * file, uint64_t pos, size_t size ) {
+    char buf [ 3 * BLOCK ];
+    size_t num_read = 0;
+    size_t expected = 0;
+
+    if ( size > sizeof buf )
+        size = sizeof buf;
+    if ( BlockCacheFile_Read ( file, pos, buf, size, & num_read ) != 0 )
+        return false;
+    if ( pos < FILE_SZ )
+        expected = FILE_SZ - pos < size ? ( size_t ) ( FILE_SZ - pos ) : size;
+    if ( num_read != expected )
+        return false;
+    for ( size_t i = 0; i < num_read; ++ i )
+        if ( buf [ i ] != Content ( pos + i ) )
+            return false;
+    return true;
+}
+
+static uint32_t Random ( uint32_t * seed, uint32_t n ) {
+    * seed = * seed * 1103515245 + 12345;
+    return ( * seed >> 8 ) % n;
+}
+
+/* the cache of a test: the settings of sra-fuser
+   --cache-blocks, --cache-mem ( bytes here ) and --read-ahead */
+struct Cache {
+    rc_t rc;
+    Cache ( uint32_t slots, uint64_t mem_limit, uint32_t read_ahead ) {
+        BlockCache_Configure ( slots, mem_limit, read_ahead );
+        rc = BlockCache_Init ();
+    }
+    ~Cache () { BlockCache_Fini (); }
+};
+
+TEST_CASE ( direct_reads ) {
+    Cache cache ( 4, 0, 0 );
+    REQUIRE_RC ( cache . rc );
+    TestFile f;
+    REQUIRE_RC ( Open ( f ) );
+
+    /* sequential reads across block boundaries generate every block once */
+    for ( uint64_t pos = 0; pos < FILE_SZ + 500; pos += 333 )
+        REQUIRE ( Check ( f . file, pos, 333 ) );
+    for ( uint64_t i = 0; i < BLOCKS; ++ i )
+        REQUIRE_EQ ( f . fills [ i ], 1u );
+
+    /* random reads of up to 3 blocks with 4 slots */
+    uint32_t seed = 1;
+    for ( int i = 0; i < 1000; ++ i ) {
+        uint64_t pos = Random ( & seed, ( uint32_t ) FILE_SZ + 10 );
+        REQUIRE ( Check ( f . file, pos, 1 + Random ( & seed, 3 * BLOCK ) ) );
+    }
+    REQUIRE_EQ ( f . ahead, 0u );
+}
+
+/* reads a byte of block n */
+#define READ_BLOCK( f, n ) REQUIRE ( Check ( ( f ) . file, ( n ) * BLOCK, 1 ) )
+
+TEST_CASE ( lru_eviction_under_mem_limit ) {
+    /* more slots than the memory of 3 blocks */
+    Cache cache ( 8, 3 * BLOCK, 0 );
+    REQUIRE_RC ( cache . rc );
+    TestFile f;
+    REQUIRE_RC ( Open ( f ) );
+
+    READ_BLOCK ( f, 0 );
+    READ_BLOCK ( f, 1 );
+    READ_BLOCK ( f, 2 );
+    READ_BLOCK ( f, 0 );
+    REQUIRE_EQ ( f . fills [ 0 ], 1u );
+
+    /* the memory is used up: block 1 is the least recently used */
+    READ_BLOCK ( f, 3 );
+    READ_BLOCK ( f, 0 );
+    READ_BLOCK ( f, 2 );
+    READ_BLOCK ( f, 3 );
+    REQUIRE_EQ ( f . fills [ 0 ], 1u );
+    REQUIRE_EQ ( f . fills [ 1 ], 1u );
+    REQUIRE_EQ ( f . fills [ 2 ], 1u );
+    REQUIRE_EQ ( f . fills [ 3 ], 1u );
+
+    /* ... now block 0 is */
+    READ_BLOCK ( f, 1 );
+    REQUIRE_EQ ( f . fills [ 1 ], 2u );
+    READ_BLOCK ( f, 2 );
+    READ_BLOCK ( f, 3 );
+    REQUIRE_EQ ( f . fills [ 2 ], 1u );
+    REQUIRE_EQ ( f . fills [ 3 ], 1u );
+    READ_BLOCK ( f, 0 );
+    REQUIRE_EQ ( f . fills [ 0 ], 2u );
+
+    /* another file gets one block beyond the limit, not more */
+    TestFile g;
+    REQUIRE_RC ( Open ( g ) );
+    READ_BLOCK ( g, 0 );
+    READ_BLOCK ( g, 1 );
+    READ_BLOCK ( g, 0 );
+    REQUIRE_EQ ( g . fills [ 0 ], 2u );
+    REQUIRE_EQ ( g . fills [ 1 ], 1u );
+
+    /* the memory of a released file is given to the others */
+    f . Release ();
+    READ_BLOCK ( g, 5 );
+    READ_BLOCK ( g, 6 );
+    READ_BLOCK ( g, 7 );
+    READ_BLOCK ( g, 5 );
+    READ_BLOCK ( g, 6 );
+    READ_BLOCK ( g, 7 );
+    REQUIRE_EQ ( g . fills [ 5 ], 1u );
+    REQUIRE_EQ ( g . fills [ 6 ], 1u );
+    REQUIRE_EQ ( g . fills [ 7 ], 1u );
+}
+
+TEST_CASE ( read_ahead_hits ) {
+    Cache cache ( 4, 0, 2 );
+    REQUIRE_RC ( cache . rc );
+    TestFile f;
+    REQUIRE_RC ( Open ( f ) );
+
+    /* a slow sequential reader finds the next blocks generated */
+    for ( uint64_t pos = 0; pos < FILE_SZ; pos += BLOCK ) {
+        REQUIRE ( Check ( f . file, pos, BLOCK ) );
+        KSleepMs ( 5 );
+    }
+    f . Release ();
+
+    /* the same content as direct reads, each block generated once */
+    for ( uint64_t i = 0; i < BLOCKS; ++ i )
+        REQUIRE_EQ ( f . fills [ i ], 1u );
+    REQUIRE_GT ( f . ahead, ( uint32_t ) ( BLOCKS / 2 ) );
+
+    /* release while read-ahead is queued or running */
+    for ( int t = 0; t < 50; ++ t ) {
+        TestFile g;
+        REQUIRE_RC ( Open ( g ) );
+        for ( uint64_t pos = 0; pos < 3 * BLOCK; pos += BLOCK )
+            REQUIRE ( Check ( g . file, pos, BLOCK ) );
+        g . Release ();
+        for ( uint64_t i = 0; i < BLOCKS; ++ i )
+            REQUIRE ( g . fills [ i ] <= 1 );
+    }
+}
+
+/* readers of one file: sequential passes from different blocks
+   with random reads in between */
+struct Reader {
+    BlockCacheFile * file;
+    uint32_t seed;
+    bool ok;
+};
+
+static rc_t CC ReaderRun ( const KThread * self, void * data ) {
+    Reader * r = ( Reader * ) data;
+    uint64_t start = Random ( & r -> seed, BLOCKS ) * BLOCK;
+
+    r -> ok = true;
+    for ( int pass = 0; pass < 3 && r -> ok; ++ pass ) {
+        for ( uint64_t n = 0; n < FILE_SZ && r -> ok; n += 400 ) {
+            r -> ok = Check ( r -> file, ( start + n ) % FILE_SZ, 400 );
+            if ( r -> ok && Random ( & r -> seed, 10 ) == 0 )
+                r -> ok = Check ( r -> file,
+                    Random ( & r -> seed, ( uint32_t ) FILE_SZ ),
+                    1 + Random ( & r -> seed, 2 * BLOCK ) );
+        }
+    }
+    return 0;
+}
+
+TEST_CASE ( interleaved_readers ) {
+    const int READERS = 4;
+    /* slots, --cache-mem, read-ahead: the last ones keep fewer blocks
+       than there are readers */
+    const uint64_t settings [] [ 3 ] = {
+        { 4, 0, 2 }, { 4, 2 * BLOCK, 2 }, { 2, 0, 0 } };
+
+    for ( size_t c = 0; c < sizeof settings / sizeof settings [ 0 ]; ++ c ) {
+        Cache cache ( ( uint32_t ) settings [ c ] [ 0 ], settings [ c ] [ 1 ],
+            ( uint32_t ) settings [ c ] [ 2 ] );
+        REQUIRE_RC ( cache . rc );
+        TestFile f;
+        REQUIRE_RC ( Open ( f ) );
+
+        Reader r [ READERS ];
+        KThread * t [ READERS ];
+        for ( int i = 0; i < READERS; ++ i ) {
+            r [ i ] . file = f . file;
+            r [ i ] . seed = ( uint32_t ) ( c * READERS + i + 1 );
+            r [ i ] . ok = false;
+            REQUIRE_RC ( KThreadMake ( & t [ i ], ReaderRun, & r [ i ] ) );
+        }
+        for ( int i = 0; i < READERS; ++ i ) {
+            REQUIRE_RC ( KThreadWait ( t [ i ], NULL ) );
+            REQUIRE_RC ( KThreadRelease ( t [ i ] ) );
+            REQUIRE ( r [ i ] . ok );
+        }
+    }
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestBlockCache ( argc, argv );
+    }
+}
@@ -0,0 +1,210 @@
+import os
+import re
+import sys
+import time
+import shutil
+import threading
+import subprocess
+
+sys.path.insert( 0, os.path.dirname( os.path.abspath( __file__ ) ) )
+from test_segmented import Handler, Server, fail
+
+'''---------------------------------------------------------------------
+    concurrent items of prefetch ( --jobs, --max-rate )
+    against the local HTTP server of test_segmented.py
+    usage: python test_jobs.py PATH-TO-PREFETCH
+---------------------------------------------------------------------'''
+
+JOBS = 3
+DELAY = 0.2 # seconds before each response: lets the jobs overlap
+RATE = 256 * 1024 # --max-rate, bytes per second
+
+'''---------------------------------------------------------------------
+    serves several files by the last component of the path,
+    counts the bytes delivered of each and the concurrent requests
+---------------------------------------------------------------------'''
+class Files :
+    def __init__( self, files ) :
+        self.files = files
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset( self ) :
+        with self.lock :
+            self.mode = "ok"
+            self.requests = 0
+            self.injected = 0
+            self.served = {} # name -> [ ( start, end ) ]
+            self.clients = set()
+            self.active = 0
+            self.max_active = 0
+
+    def bytes_served( self, name ) :
+        return sum( end - start for start, end in self.served.get( name, [] )
+                    if end - start > 1 ) # not a size probe
+
+class FilesHandler( Handler ) :
+    def name( self ) :
+        return self.path.split( "?" )[ 0 ].rstrip( "/" ).split( "/" )[ -1 ]
+
+    def body( self ) :
+        return self.server.state.files[ self.name() ]
+
+    def record( self, start, end ) :
+        self.server.state.served.setdefault( self.name(), [] ) \
+                                .append( ( start, end ) )
+
+    def do_GET( self ) :
+        state = self.server.state
+        if self.name() not in state.files :
+            self.send_response( 404 )
+            self.send_header( "Content-Length", "0" )
+            self.end_headers()
+            return
+        with state.lock :
+            state.active += 1
+            state.max_active = max( state.max_active, state.active )
+        try :
+            time.sleep( DELAY )
+            Handler.do_GET( self )
+        finally :
+            with state.lock :
+                state.active -= 1
+
+    def do_HEAD( self ) :
+        if self.name() not in self.server.state.files :
+            self.send_response( 404 )
+            self.send_header( "Content-Length", "0" )
+            self.end_headers()
+            return
+        Handler.do_HEAD( self )
+
+'''---------------------------------------------------------------------
+    test helpers
+---------------------------------------------------------------------'''
+def run_prefetch( prefetch, urls, top, options = [] ) :
+    env = dict( os.environ )
+    env[ "VDB_CONFIG" ] = os.path.join( top, "cfg" )
+    env[ "NCBI_SETTINGS" ] = "/"
+    p = subprocess.Popen( [ prefetch ] + urls + options,
+                          cwd = os.path.join( top, "dl" ), env = env,
+                          stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+    out, err = p.communicate()
+    return p.returncode, out.decode( "utf-8", "replace" )
+
+# the items in the order of their status messages:
+#   [ ( number, name ) ], a number once per item if the output is not mixed
+ITEM_LINE = re.compile( r"^(\d+)\) .*?'([^']+)'" )
+def items( out ) :
+    seq = []
+    for line in out.splitlines() :
+        m = ITEM_LINE.match( line.strip() )
+        if m is None :
+            continue
+        item = ( int( m.group( 1 ) ), m.group( 2 ) )
+        if len( seq ) == 0 or seq[ -1 ] != item :
+            seq.append( item )
+    return seq
+
+def check_downloads( top, files, names ) :
+    for name in set( names ) :
+        out = os.path.join( top, "dl", name )
+        if not os.path.exists( out ) :
+            fail( "%s was not downloaded" % name )
+        with open( out, "rb" ) as f :
+            if f.read() != files[ name ] :
+                fail( "%s differs from the served file" % name )
+
+def clean( top ) :
+    shutil.rmtree( os.path.join( top, "dl" ), ignore_errors = True )
+    os.makedirs( os.path.join( top, "dl" ) )
+
+def make_data( size, seed ) :
+    data = bytearray( size )
+    for i in range( size ) :
+        data[ i ] = ( i * seed + i // 1021 ) & 0xFF
+    return bytes( data )
+
+def main( prefetch ) :
+    top = os.path.abspath( "tmp-jobs" )
+    shutil.rmtree( top, ignore_errors = True )
+    os.makedirs( os.path.join( top, "cfg" ) )
+    os.makedirs( os.path.join( top, "dl" ) )
+    with open( os.path.join( top, "cfg", "t.kfg" ), "w" ) as f :
+        f.write( '/repository/user/main/public/apps/file/volumes/flat = '
+                 '"files"\n' )
+        f.write( '/repository/user/main/public/root = "%s"\n' % top )
+
+    files = { "a.bin"   : make_data( 300000, 3 ),
+              "b.bin"   : make_data( 17, 5 ),
+              "c.bin"   : make_data( 1200000, 7 ),
+              "ref.bin" : make_data( 700000, 11 ) }
+
+    state = Files( files )
+    server = Server( ( "127.0.0.1", 0 ), FilesHandler )
+    server.state = state
+    t = threading.Thread( target = server.serve_forever )
+    t.daemon = True
+    t.start()
+    url = "http://127.0.0.1:%d/" % server.server_address[ 1 ]
+
+    # ref.bin stands for a refseq two runs depend on
+    names = [ "a.bin", "ref.bin", "b.bin", "ref.bin", "c.bin" ]
+    urls = [ url + name for name in names ]
+
+    print( "serial run" )
+    state.reset()
+    rc, serial = run_prefetch( prefetch, urls, top )
+    if rc != 0 :
+        fail( "serial prefetch failed" )
+    check_downloads( top, files, names )
+    expected = items( serial )
+    if [ n for n, name in expected ] != list( range( 1, len( names ) + 1 ) ) :
+        fail( "unexpected items of the serial run: %s" % expected )
+    if state.bytes_served( "ref.bin" ) != len( files[ "ref.bin" ] ) :
+        fail( "serial run: ref.bin is served %d bytes, expected %d"
+              % ( state.bytes_served( "ref.bin" ), len( files[ "ref.bin" ] ) ) )
+
+    print( "%d jobs: the output of the serial run, a shared file once" % JOBS )
+    clean( top )
+    state.reset()
+    rc, concurrent = run_prefetch( prefetch, urls, top,
+                                   [ "--jobs", str( JOBS ) ] )
+    if rc != 0 :
+        fail( "prefetch --jobs %d failed" % JOBS )
+    check_downloads( top, files, names )
+    if state.max_active < 2 :
+        fail( "the items were not downloaded concurrently" )
+    if items( concurrent ) != expected :
+        fail( "the status of --jobs %d differs from the serial run:\n%s\n%s"
+              % ( JOBS, items( concurrent ), expected ) )
+    for name in files :
+        served = state.bytes_served( name )
+        if served != len( files[ name ] ) :
+            fail( "--jobs %d: %s is served %d bytes, expected %d"
+                  % ( JOBS, name, served, len( files[ name ] ) ) )
+
+    print( "--max-rate limits the total transfer rate of the jobs" )
+    clean( top )
+    state.reset()
+    total = sum( len( data ) for data in files.values() )
+    start = time.time()
+    rc, out = run_prefetch( prefetch, urls, top, [ "--jobs", str( JOBS ),
+                            "--max-rate", "%dK" % ( RATE // 1024 ) ] )
+    elapsed = time.time() - start
+    if rc != 0 :
+        fail( "prefetch --max-rate failed" )
+    check_downloads( top, files, names )
+    if elapsed < 0.9 * total / RATE :
+        fail( "%d bytes in %.1f seconds: --max-rate %dK is exceeded"
+              % ( total, elapsed, RATE // 1024 ) )
+
+    server.shutdown()
+    shutil.rmtree( top, ignore_errors = True )
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-PREFETCH" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
@@ -0,0 +1,149 @@
+import os
+import sys
+import shutil
+import hashlib
+import threading
+
+sys.path.insert( 0, os.path.dirname( os.path.abspath( __file__ ) ) )
+from test_segmented import Server, fail
+from test_jobs import Files, FilesHandler, run_prefetch, clean, make_data
+
+'''---------------------------------------------------------------------
+    md5 verification of prefetch ( --manifest, NAME.md5 )
+    against the local HTTP server of test_segmented.py
+    usage: python test_md5.py PATH-TO-PREFETCH
+---------------------------------------------------------------------'''
+
+'''---------------------------------------------------------------------
+    corrupts the body of the next state.corrupt GET requests
+    ( -1: of all of them ), not the size probes
+---------------------------------------------------------------------'''
+class CorruptHandler( FilesHandler ) :
+    bad = False
+
+    def body( self ) :
+        data = FilesHandler.body( self )
+        if not self.bad :
+            return data
+        data = bytearray( data )
+        for i in range( 100, len( data ), 4096 ) :
+            data[ i ] ^= 0xFF
+        return bytes( data )
+
+    def do_GET( self ) :
+        state = self.server.state
+        rng = self.get_range()
+        with state.lock :
+            if state.corrupt != 0 and ( rng is None or rng[ 1 ] > rng[ 0 ] ) :
+                self.bad = True
+                state.injected += 1
+                if state.corrupt > 0 :
+                    state.corrupt -= 1
+        FilesHandler.do_GET( self )
+
+def md5( data ) :
+    return hashlib.md5( data ).hexdigest()
+
+def sidecar( top, name ) :
+    path = os.path.join( top, "dl", name + ".md5" )
+    if not os.path.exists( path ) :
+        return None
+    with open( path ) as f :
+        return f.read().split()
+
+def check_verified( top, files, name ) :
+    out = os.path.join( top, "dl", name )
+    if not os.path.exists( out ) :
+        fail( "%s was not downloaded" % name )
+    with open( out, "rb" ) as f :
+        if f.read() != files[ name ] :
+            fail( "%s differs from the served file" % name )
+    if sidecar( top, name ) != [ md5( files[ name ] ), "*" + name ] :
+        fail( "%s.md5 is %s, expected the md5 of %s"
+              % ( name, sidecar( top, name ), name ) )
+
+def main( prefetch ) :
+    top = os.path.abspath( "tmp-md5" )
+    shutil.rmtree( top, ignore_errors = True )
+    os.makedirs( os.path.join( top, "cfg" ) )
+    os.makedirs( os.path.join( top, "dl" ) )
+    with open( os.path.join( top, "cfg", "t.kfg" ), "w" ) as f :
+        f.write( '/repository/user/main/public/apps/file/volumes/flat = '
+                 '"files"\n' )
+        f.write( '/repository/user/main/public/root = "%s"\n' % top )
+
+    files = { "good.bin"  : make_data( 1500000, 3 ),
+              "text.bin"  : make_data( 5000, 5 ),
+              "other.bin" : make_data( 70000, 7 ) }
+
+    # binary and text mode lines of md5sum; other.bin is not listed
+    manifest = os.path.join( top, "manifest.md5" )
+    with open( manifest, "w" ) as f :
+        f.write( "%s *good.bin\n" % md5( files[ "good.bin" ] ) )
+        f.write( "%s  text.bin\n" % md5( files[ "text.bin" ] ) )
+    options = [ "--manifest", manifest ]
+
+    state = Files( files )
+    server = Server( ( "127.0.0.1", 0 ), CorruptHandler )
+    server.state = state
+    t = threading.Thread( target = server.serve_forever )
+    t.daemon = True
+    t.start()
+    url = "http://127.0.0.1:%d/" % server.server_address[ 1 ]
+
+    print( "digests of the manifest are verified and saved next to the file" )
+    state.reset()
+    state.corrupt = 0
+    for name in [ "good.bin", "text.bin" ] :
+        rc, out = run_prefetch( prefetch, [ url + name ], top, options )
+        if rc != 0 :
+            fail( "prefetch of %s failed" % name )
+        check_verified( top, files, name )
+        if state.bytes_served( name ) != len( files[ name ] ) :
+            fail( "%s is downloaded more than once" % name )
+
+    print( "a file not in the manifest is not verified" )
+    rc, out = run_prefetch( prefetch, [ url + "other.bin" ], top, options )
+    if rc != 0 :
+        fail( "prefetch of other.bin failed" )
+    if sidecar( top, "other.bin" ) is not None :
+        fail( "other.bin.md5 is written without a digest to verify" )
+
+    print( "a corrupted download is detected and downloaded again" )
+    clean( top )
+    state.reset()
+    state.corrupt = 1
+    rc, out = run_prefetch( prefetch, [ url + "good.bin" ], top, options )
+    if rc != 0 :
+        fail( "prefetch failed after a corrupted download" )
+    if state.injected == 0 :
+        fail( "no download was corrupted" )
+    if "md5 mismatch" not in out :
+        fail( "the corrupted download is not reported" )
+    if state.bytes_served( "good.bin" ) <= len( files[ "good.bin" ] ) :
+        fail( "the corrupted download is not downloaded again" )
+    check_verified( top, files, "good.bin" )
+
+    print( "a download that is always corrupted is rejected" )
+    clean( top )
+    state.reset()
+    state.corrupt = -1
+    rc, out = run_prefetch( prefetch, [ url + "good.bin" ], top, options )
+    if rc == 0 :
+        fail( "prefetch of a corrupted file unexpectedly succeeded" )
+    if state.bytes_served( "good.bin" ) <= len( files[ "good.bin" ] ) :
+        fail( "the corrupted download is not retried" )
+    if os.path.exists( os.path.join( top, "dl", "good.bin" ) ) :
+        fail( "the corrupted file is kept" )
+    if sidecar( top, "good.bin" ) is not None :
+        fail( "good.bin.md5 is written for a corrupted file" )
+
+    server.shutdown()
+    shutil.rmtree( top, ignore_errors = True )
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-PREFETCH" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
@@ -0,0 +1,142 @@
+import os
+import sys
+import stat
+import shutil
+import hashlib
+import threading
+
+sys.path.insert( 0, os.path.dirname( os.path.abspath( __file__ ) ) )
+from test_segmented import Server, fail
+from test_jobs import Files, FilesHandler, run_prefetch, make_data
+
+'''---------------------------------------------------------------------
+    prefetch --mirror: files are placed from a local mirror directory
+    instead of being downloaded from the local HTTP server
+    of test_segmented.py
+    usage: python test_mirror.py PATH-TO-PREFETCH
+---------------------------------------------------------------------'''
+
+FOUND = "found in local mirror"
+
+def md5( data ) :
+    return hashlib.md5( data ).hexdigest()
+
+def put( mirror, name, data, mode ) :
+    path = os.path.join( mirror, name )
+    with open( path, "wb" ) as f :
+        f.write( data )
+    os.chmod( path, mode )
+    return path
+
+def check_content( top, files, name ) :
+    out = os.path.join( top, "dl", name )
+    if not os.path.exists( out ) :
+        fail( "%s was not placed" % name )
+    with open( out, "rb" ) as f :
+        if f.read() != files[ name ] :
+            fail( "%s differs from the served file" % name )
+    return out
+
+def main( prefetch ) :
+    top = os.path.abspath( "tmp-mirror" )
+    shutil.rmtree( top, ignore_errors = True )
+    mirror = os.path.join( top, "mirror" )
+    os.makedirs( os.path.join( top, "cfg" ) )
+    os.makedirs( os.path.join( top, "dl" ) )
+    os.makedirs( mirror )
+    with open( os.path.join( top, "cfg", "t.kfg" ), "w" ) as f :
+        f.write( '/repository/user/main/public/apps/file/volumes/flat = '
+                 '"files"\n' )
+        f.write( '/repository/user/main/public/root = "%s"\n' % top )
+
+    files = { "hit.bin"   : make_data( 400000, 3 ),
+              "short.bin" : make_data( 300000, 5 ),
+              "bad.bin"   : make_data( 200000, 7 ),
+              "sum.bin"   : make_data( 200000, 9 ),
+              "rw.bin"    : make_data( 100000, 11 ) }
+
+    corrupted = bytearray( files[ "bad.bin" ] )
+    corrupted[ 1000 ] ^= 0xFF
+    put( mirror, "hit.bin", files[ "hit.bin" ], 0o444 )
+    put( mirror, "short.bin", files[ "short.bin" ][ : -10 ], 0o444 )
+    put( mirror, "bad.bin", bytes( corrupted ), 0o444 )
+    # the sidecar of sum.bin is right about a wrong copy
+    corrupted = bytearray( files[ "sum.bin" ] )
+    corrupted[ 1000 ] ^= 0xFF
+    put( mirror, "sum.bin", bytes( corrupted ), 0o444 )
+    with open( os.path.join( mirror, "sum.bin.md5" ), "w" ) as f :
+        f.write( "%s *sum.bin\n" % md5( bytes( corrupted ) ) )
+    src = put( mirror, "rw.bin", files[ "rw.bin" ], 0o644 )
+
+    manifest = os.path.join( top, "manifest.md5" )
+    with open( manifest, "w" ) as f :
+        for name in [ "bad.bin", "sum.bin" ] :
+            f.write( "%s *%s\n" % ( md5( files[ name ] ), name ) )
+
+    state = Files( files )
+    server = Server( ( "127.0.0.1", 0 ), FilesHandler )
+    server.state = state
+    t = threading.Thread( target = server.serve_forever )
+    t.daemon = True
+    t.start()
+    url = "http://127.0.0.1:%d/" % server.server_address[ 1 ]
+    options = [ "--mirror", mirror ]
+
+    print( "a file of the mirror is placed instead of being downloaded" )
+    state.reset()
+    rc, out = run_prefetch( prefetch, [ url + "hit.bin" ], top, options )
+    if rc != 0 :
+        fail( "prefetch of hit.bin failed" )
+    check_content( top, files, "hit.bin" )
+    if FOUND not in out :
+        fail( "hit.bin is not reported as found in the mirror" )
+    if state.bytes_served( "hit.bin" ) != 0 :
+        fail( "hit.bin is downloaded although the mirror has it" )
+
+    print( "a mirror copy of another size is downloaded" )
+    state.reset()
+    rc, out = run_prefetch( prefetch, [ url + "short.bin" ], top, options )
+    if rc != 0 :
+        fail( "prefetch of short.bin failed" )
+    check_content( top, files, "short.bin" )
+    if FOUND in out or state.bytes_served( "short.bin" ) == 0 :
+        fail( "short.bin of another size is taken from the mirror" )
+
+    print( "a mirror copy with another md5 is downloaded" )
+    for name in [ "bad.bin", "sum.bin" ] :
+        state.reset()
+        rc, out = run_prefetch( prefetch, [ url + name ], top,
+                                options + [ "--manifest", manifest ] )
+        if rc != 0 :
+            fail( "prefetch of %s failed" % name )
+        check_content( top, files, name )
+        if FOUND in out or state.bytes_served( name ) == 0 :
+            fail( "%s with another md5 is taken from the mirror" % name )
+
+    print( "a writable mirror file is not hard linked" )
+    state.reset()
+    rc, out = run_prefetch( prefetch, [ url + "rw.bin" ], top, options )
+    if rc != 0 :
+        fail( "prefetch of rw.bin failed" )
+    if FOUND not in out :
+        fail( "rw.bin is not placed from the mirror" )
+    out = check_content( top, files, "rw.bin" )
+    if os.stat( out ).st_ino == os.stat( src ).st_ino \
+       or os.stat( src ).st_nlink != 1 :
+        fail( "rw.bin is hard linked to the writable %s" % src )
+    os.chmod( out, stat.S_IRUSR | stat.S_IWUSR )
+    with open( out, "r+b" ) as f :
+        f.write( b"changed" )
+    with open( src, "rb" ) as f :
+        if f.read() != files[ "rw.bin" ] :
+            fail( "changing rw.bin changes the mirror" )
+
+    server.shutdown()
+    shutil.rmtree( top, ignore_errors = True )
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-PREFETCH" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
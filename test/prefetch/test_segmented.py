@@ -0,0 +1,245 @@
+import os
+import sys
+import shutil
+import struct
+import threading
+import subprocess
+
+try:
+    from http.server import BaseHTTPRequestHandler, HTTPServer
+    from socketserver import ThreadingMixIn
+except ImportError :
+    from BaseHTTPServer import BaseHTTPRequestHandler, HTTPServer
+    from SocketServer import ThreadingMixIn
+
+'''---------------------------------------------------------------------
+    segmented download of prefetch against a local HTTP server
+    usage: python test_segmented.py PATH-TO-PREFETCH
+---------------------------------------------------------------------'''
+
+NAME = "data.bin"
+SEGMENT = 1024 * 1024
+SIZE = 12 * SEGMENT + 12345
+CONNECTIONS = 4
+SEG_HEADER = 24 # magic[8], size, segment size
+
+'''---------------------------------------------------------------------
+    HTTP server stand-in: supports Range requests, injects failures
+    mode "ok"     : serve everything
+    mode "flaky"  : drop two ranged requests in the middle of the body
+    mode "broken" : answer 500 to any request from the second half of file
+---------------------------------------------------------------------'''
+class State :
+    def __init__( self, data ) :
+        self.data = data
+        self.lock = threading.Lock()
+        self.reset( "ok" )
+
+    def reset( self, mode ) :
+        with self.lock :
+            self.mode = mode
+            self.requests = 0
+            self.injected = 0
+            self.served = [] # ( start, end ) of delivered ranges
+            self.clients = set()
+
+class Handler( BaseHTTPRequestHandler ) :
+    protocol_version = "HTTP/1.1"
+
+    def log_message( self, format, *args ) :
+        pass
+
+    # the served file: a subclass can serve several
+    def body( self ) :
+        return self.server.state.data
+
+    # a delivered range
+    def record( self, start, end ) :
+        self.server.state.served.append( ( start, end ) )
+
+    def get_range( self ) :
+        r = self.headers.get( "Range" )
+        if r is None or not r.startswith( "bytes=" ) :
+            return None
+        start, end = r[ len( "bytes=" ): ].split( "-" )
+        start = int( start )
+        end = int( end ) if end else len( self.body() ) - 1
+        return ( start, min( end, len( self.body() ) - 1 ) )
+
+    def send_error_500( self ) :
+        self.send_response( 500 )
+        self.send_header( "Content-Length", "0" )
+        self.end_headers()
+
+    def respond( self, body ) :
+        state = self.server.state
+        data = self.body()
+        rng = self.get_range()
+        if rng is None :
+            start, end = 0, len( data ) - 1
+            self.send_response( 200 )
+        else :
+            start, end = rng
+            self.send_response( 206 )
+            self.send_header( "Content-Range", "bytes %d-%d/%d"
+                              % ( start, end, len( data ) ) )
+        self.send_header( "Accept-Ranges", "bytes" )
+        self.send_header( "Content-Length", str( end - start + 1 ) )
+        self.end_headers()
+        if not body :
+            return
+
+        drop = False
+        with state.lock :
+            state.requests += 1
+            state.clients.add( self.client_address )
+            if state.mode == "flaky" and rng is not None and end > start \
+               and state.requests % 4 == 0 and state.injected < 2 :
+                state.injected += 1
+                drop = True
+        if drop :
+            self.wfile.write( data[ start : ( start + end ) // 2 ] )
+            self.close_connection = True
+            return
+
+        self.wfile.write( data[ start : end + 1 ] )
+        with state.lock :
+            self.record( start, end + 1 )
+
+    def do_HEAD( self ) :
+        self.respond( False )
+
+    def do_GET( self ) :
+        state = self.server.state
+        rng = self.get_range()
+        if state.mode == "broken" and rng is not None \
+           and rng[ 0 ] >= len( self.body() ) // 2 :
+            with state.lock :
+                state.injected += 1
+            self.send_error_500()
+            return
+        self.respond( True )
+
+class Server( ThreadingMixIn, HTTPServer ) :
+    daemon_threads = True
+
+'''---------------------------------------------------------------------
+    test helpers
+---------------------------------------------------------------------'''
+def fail( msg ) :
+    print( "FAILED: %s" % msg )
+    sys.exit( 1 )
+
+def run_prefetch( prefetch, url, top ) :
+    env = dict( os.environ )
+    env[ "VDB_CONFIG" ] = os.path.join( top, "cfg" )
+    env[ "NCBI_SETTINGS" ] = "/"
+    cmd = [ prefetch, url, "--connections", str( CONNECTIONS ),
+            "--segment-size", "%dK" % ( SEGMENT // 1024 ) ]
+    with open( os.devnull, "w" ) as null :
+        return subprocess.call( cmd, cwd = os.path.join( top, "dl" ),
+                                env = env, stdout = null, stderr = null )
+
+def read_bitmap( path ) :
+    with open( path, "rb" ) as f :
+        hdr = f.read( SEG_HEADER )
+        bits = f.read()
+    magic, size, seg = struct.unpack( "=8sQQ", hdr )
+    if magic != b"NCBIprt1" or size != SIZE or seg != SEGMENT :
+        fail( "unexpected header of %s" % path )
+    count = ( size + seg - 1 ) // seg
+    return [ i for i in range( count )
+             if ord( bits[ i // 8 : i // 8 + 1 ] ) & ( 1 << ( i % 8 ) ) ]
+
+def check_result( top, data ) :
+    out = os.path.join( top, "dl", NAME )
+    if not os.path.exists( out ) :
+        fail( "%s was not downloaded" % NAME )
+    with open( out, "rb" ) as f :
+        if f.read() != data :
+            fail( "%s differs from the served file" % NAME )
+    for ext in [ ".prt", ".prt.seg" ] :
+        if os.path.exists( out + ext ) :
+            fail( "%s%s was not removed" % ( NAME, ext ) )
+    os.remove( out )
+
+def main( prefetch ) :
+    top = os.path.abspath( "tmp-segmented" )
+    shutil.rmtree( top, ignore_errors = True )
+    os.makedirs( os.path.join( top, "cfg" ) )
+    os.makedirs( os.path.join( top, "dl" ) )
+    with open( os.path.join( top, "cfg", "t.kfg" ), "w" ) as f :
+        f.write( '/repository/user/main/public/apps/file/volumes/flat = '
+                 '"files"\n' )
+        f.write( '/repository/user/main/public/root = "%s"\n' % top )
+
+    data = bytearray( SIZE )
+    for i in range( SIZE ) :
+        data[ i ] = ( i * 7 + i // 4093 ) & 0xFF
+    data = bytes( data )
+
+    state = State( data )
+    server = Server( ( "127.0.0.1", 0 ), Handler )
+    server.state = state
+    t = threading.Thread( target = server.serve_forever )
+    t.daemon = True
+    t.start()
+    url = "http://127.0.0.1:%d/%s" % ( server.server_address[ 1 ], NAME )
+
+    print( "segmented download over concurrent connections" )
+    state.reset( "ok" )
+    if run_prefetch( prefetch, url, top ) != 0 :
+        fail( "prefetch failed" )
+    check_result( top, data )
+    if len( state.clients ) < 2 :
+        fail( "ranges were not requested concurrently" )
+
+    print( "transient failures are retried" )
+    state.reset( "flaky" )
+    if run_prefetch( prefetch, url, top ) != 0 :
+        fail( "prefetch failed on transient errors" )
+    if state.injected == 0 :
+        fail( "no failure was injected" )
+    check_result( top, data )
+
+    print( "interrupted download keeps completed segments" )
+    state.reset( "broken" )
+    if run_prefetch( prefetch, url, top ) == 0 :
+        fail( "prefetch unexpectedly succeeded" )
+    part = os.path.join( top, "dl", NAME + ".prt" )
+    if not os.path.exists( part ) or not os.path.exists( part + ".seg" ) :
+        fail( "partial download was not kept" )
+    done = read_bitmap( part + ".seg" )
+    if len( done ) == 0 :
+        fail( "no segment was completed" )
+    with open( part, "rb" ) as f :
+        for i in done :
+            f.seek( i * SEGMENT )
+            if f.read( SEGMENT ) != data[ i * SEGMENT : ( i + 1 ) * SEGMENT ] :
+                fail( "completed segment %d is corrupt" % i )
+
+    print( "restarted download fetches only missing segments" )
+    state.reset( "ok" )
+    if run_prefetch( prefetch, url, top ) != 0 :
+        fail( "resumed prefetch failed" )
+    check_result( top, data )
+    for start, end in state.served :
+        if end - start <= 1 :
+            continue # size probe
+        for i in range( start // SEGMENT, ( end - 1 ) // SEGMENT + 1 ) :
+            if i in done :
+                fail( "completed segment %d was downloaded again" % i )
+    missing = SIZE - sum( min( SEGMENT, SIZE - i * SEGMENT ) for i in done )
+    served = sum( end - start for start, end in state.served )
+    if served < missing :
+        fail( "served %d bytes, %d are missing" % ( served, missing ) )
+
+    server.shutdown()
+    shutil.rmtree( top, ignore_errors = True )
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-PREFETCH" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
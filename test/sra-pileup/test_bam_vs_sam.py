@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+
+import sys, getopt, subprocess, gzip, struct, os
+
+'''---------------------------------------------------------------------
+    sam-dump --bam has to produce the same alignments as the SAM-output:
+    the BAM-file is decoded ( BGZF is a multi-member gzip-file ) back into
+    SAM-text and compared line by line with the SAM-output of sam-dump
+---------------------------------------------------------------------'''
+
+CIGAR_OPS = "MIDNSHP=X"
+NT16 = "=ACMGRSVTWYHKDBN"
+INT_TYPES = { 'c' : '<b', 'C' : '<B', 's' : '<h', 'S' : '<H', 'i' : '<i', 'I' : '<I', 'f' : '<f' }
+
+
+class Reader :
+    def __init__( self, data ) :
+        self.data = data
+        self.pos = 0
+
+    def take( self, n ) :
+        res = self.data[ self.pos : self.pos + n ]
+        if len( res ) != n :
+            raise ValueError( "unexpected end of BAM-data" )
+        self.pos += n
+        return res
+
+    def unpack( self, fmt ) :
+        return struct.unpack( fmt, self.take( struct.calcsize( fmt ) ) )
+
+    def cstring( self ) :
+        end = self.data.index( b'\0', self.pos )
+        res = self.data[ self.pos : end ].decode( "ascii" )
+        self.pos = end + 1
+        return res
+
+    def at_end( self ) :
+        return self.pos >= len( self.data )
+
+
+def fmt_float( value ) :
+    return "%g" % value
+
+
+def decode_tag( r ) :
+    tag = r.take( 2 ).decode( "ascii" )
+    t = r.take( 1 ).decode( "ascii" )
+    if t == 'A' :
+        return "%s:A:%s" % ( tag, r.take( 1 ).decode( "ascii" ) )
+    if t in "cCsSiI" :
+        return "%s:i:%d" % ( tag, r.unpack( INT_TYPES[ t ] )[ 0 ] )
+    if t == 'f' :
+        return "%s:f:%s" % ( tag, fmt_float( r.unpack( '<f' )[ 0 ] ) )
+    if t in "ZH" :
+        return "%s:%s:%s" % ( tag, t, r.cstring() )
+    if t == 'B' :
+        sub = r.take( 1 ).decode( "ascii" )
+        count = r.unpack( '<I' )[ 0 ]
+        values = [ r.unpack( INT_TYPES[ sub ] )[ 0 ] for i in range( count ) ]
+        if sub == 'f' :
+            values = [ fmt_float( v ) for v in values ]
+        return "%s:B:%s" % ( tag, ",".join( [ sub ] + [ str( v ) for v in values ] ) )
+    raise ValueError( "unknown tag-type '%s'" % t )
+
+
+def decode_record( data, refs ) :
+    r = Reader( data )
+    ( tid, pos, l_read_name, mapq, bin, n_cigar, flag, l_seq,
+      next_tid, next_pos, tlen ) = r.unpack( '<iiBBHHHIiii' )
+    qname = r.take( l_read_name )[ : -1 ].decode( "ascii" )
+    cigar = ""
+    for i in range( n_cigar ) :
+        op = r.unpack( '<I' )[ 0 ]
+        cigar += "%d%s" % ( op >> 4, CIGAR_OPS[ op & 0xf ] )
+    packed = bytearray( r.take( ( l_seq + 1 ) // 2 ) )
+    seq = "".join( NT16[ ( packed[ i // 2 ] >> ( 4 * ( 1 - i % 2 ) ) ) & 0xf ] for i in range( l_seq ) )
+    qual = bytearray( r.take( l_seq ) )
+    if l_seq == 0 or qual[ 0 ] == 0xff :
+        qual = "*"
+    else :
+        qual = "".join( chr( q + 33 ) for q in qual )
+    tags = []
+    while not r.at_end() :
+        tags.append( decode_tag( r ) )
+
+    rname = refs[ tid ] if tid >= 0 else "*"
+    if next_tid < 0 :
+        rnext = "*"
+    elif next_tid == tid :
+        rnext = "="
+    else :
+        rnext = refs[ next_tid ]
+    fields = [ qname, str( flag ), rname, str( pos + 1 ), str( mapq ), cigar or "*",
+               rnext, str( next_pos + 1 ), str( tlen ), seq or "*", qual ]
+    return "\t".join( fields + tags )
+
+
+def bam_to_sam( filename ) :
+    f = gzip.open( filename, "rb" )
+    r = Reader( f.read() )
+    f.close()
+    if r.take( 4 ) != b'BAM\1' :
+        raise ValueError( "%s is not a BAM-file" % filename )
+    l_text = r.unpack( '<i' )[ 0 ]
+    lines = r.take( l_text ).decode( "ascii" ).splitlines()
+    refs = []
+    for i in range( r.unpack( '<i' )[ 0 ] ) :
+        l_name = r.unpack( '<i' )[ 0 ]
+        refs.append( r.take( l_name )[ : -1 ].decode( "ascii" ) )
+        r.unpack( '<i' )
+    while not r.at_end() :
+        block_size = r.unpack( '<i' )[ 0 ]
+        lines.append( decode_record( r.take( block_size ), refs ) )
+    return lines
+
+
+def normalize( line ) :
+    # the text-output of sam-dump may have no CIGAR/SEQ/QUAL as empty fields,
+    # and prints '0' as RNEXT for unaligned reads without a mate
+    fields = line.split( "\t" )
+    if not line.startswith( '@' ) and len( fields ) > 10 :
+        for i in ( 5, 9, 10 ) :
+            if fields[ i ] == "" :
+                fields[ i ] = "*"
+        if fields[ 6 ] == "0" :
+            fields[ 6 ] = "*"
+        # BAM has only upper-case bases, '.' becomes N
+        fields[ 9 ] = fields[ 9 ].upper().replace( '.', 'N' )
+    return "\t".join( fields )
+
+
+def run_sam_dump( sam_dump, args ) :
+    print( "$ %s" % " ".join( [ sam_dump ] + args ) )
+    p = subprocess.Popen( [ sam_dump ] + args, stdout = subprocess.PIPE )
+    out = p.communicate()[ 0 ]
+    if p.returncode != 0 :
+        print( "sam-dump failed with %d" % p.returncode )
+        sys.exit( 3 )
+    return out.decode( "ascii" )
+
+
+def compare( sam_dump, acc, extra ) :
+    bam = "%s.test.bam" % acc
+    sam = run_sam_dump( sam_dump, [ acc ] + extra ).splitlines()
+    run_sam_dump( sam_dump, [ acc, "--bam", "--output-file", bam ] + extra )
+    try :
+        decoded = bam_to_sam( bam )
+    finally :
+        os.remove( bam )
+    if len( sam ) != len( decoded ) :
+        print( "SAM has %d lines, BAM has %d" % ( len( sam ), len( decoded ) ) )
+        sys.exit( 4 )
+    for n in range( len( sam ) ) :
+        if normalize( sam[ n ] ) != decoded[ n ] :
+            print( "difference in line #%d:\nSAM: %s\nBAM: %s" % ( n + 1, sam[ n ], decoded[ n ] ) )
+            sys.exit( 5 )
+    print( "%d lines are the same" % len( sam ) )
+
+
+if __name__ == '__main__':
+    acc = 'SRR3332402'
+    sam_dump = 'sam-dump'
+    usage = "%s -a <accession> -m <sam-dump-binary>" % sys.argv[ 0 ]
+
+    try :
+        opts, args = getopt.getopt( sys.argv[ 1: ], "ha:m:", [ "acc=", "sam_dump=" ] )
+    except getopt.GetoptError :
+        print( usage )
+        sys.exit( 2 )
+    for opt, arg in opts :
+        if opt == '-h' :
+            print( usage )
+            sys.exit()
+        elif opt in ( "-a", "--acc" ) :
+            acc = arg
+        elif opt in ( "-m", "--sam_dump" ) :
+            sam_dump = arg
+
+    compare( sam_dump, acc, [ "--unaligned" ] )
+    compare( sam_dump, acc, [ "--unaligned", "--threads", "4" ] )
+    compare( sam_dump, acc, [ "--unaligned", "--spot-group", "--prefix", "test" ] )
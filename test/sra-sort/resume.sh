@@ -0,0 +1,119 @@
+#!/bin/bash
+
+# sra-sort --checkpoint is killed after its first checkpoints,
+# then --resume has to produce the same database as a run without interruption;
+# --resume without a journal to resume from and journaled tables are rejected
+
+if [ "$TEST_DATA" == "" ] ; then
+    echo TEST_DATA is not set: exiting
+    exit 1
+fi
+
+SRC=${1:-$TEST_DATA/SRR5318091-sra-sort-md}
+if [ ! -e "$SRC" ] ; then
+    echo $SRC is not found: skipping the test
+    exit 0
+fi
+
+SORT=sra-sort
+DUMP=vdb-dump
+for T in $SORT $DUMP ; do
+    which $T > /dev/null 2>&1
+    if [ "$?" != "0" ] ; then
+        echo "$T not found: add it to your PATH"
+        exit 10
+    fi
+done
+
+I=`whoami`
+DSTDIR=${TMPDIR:-/tmp}/$I/sra-sort-resume.$$
+EXPECTED=$DSTDIR/expected
+DST=$DSTDIR/sorted
+JOURNAL=$DST.sra-sort.journal
+
+rm -fr $DSTDIR
+mkdir -p $DSTDIR || exit 11
+
+OPT="--tempdir $DSTDIR --mmapdir $DSTDIR"
+
+fail() {
+    echo Failure: $1
+    rm -fr $DSTDIR
+    exit $2
+}
+
+# every table of the database, in a stable order
+dump() {
+    for TBL in SEQUENCE PRIMARY_ALIGNMENT SECONDARY_ALIGNMENT EVIDENCE_ALIGNMENT EVIDENCE_INTERVAL REFERENCE ; do
+        if $DUMP -T $TBL -R1 $1 > /dev/null 2>&1 ; then
+            echo "== $TBL"
+            $DUMP -T $TBL $1 || return 1
+        fi
+    done
+}
+
+# the number of complete checkpoints in the journal
+checkpoints() {
+    if [ -f $JOURNAL ] ; then
+        grep -c '^end ' $JOURNAL
+    else
+        echo 0
+    fi
+}
+
+echo $ $SORT -f $OPT $SRC $EXPECTED
+$SORT -f $OPT $SRC $EXPECTED || fail "sra-sort failed with $?" 20
+dump $EXPECTED > $DSTDIR/expected.txt || fail "cannot dump $EXPECTED" 21
+
+# 1. interrupted after two checkpoints, then resumed
+echo $ $SORT --checkpoint $OPT $SRC $DST
+$SORT --checkpoint $OPT $SRC $DST &
+PID=$!
+while kill -0 $PID 2> /dev/null && [ `checkpoints` -lt 2 ] ; do
+    sleep 0.1
+done
+kill -9 $PID 2> /dev/null
+wait $PID 2> /dev/null
+
+if [ ! -f $JOURNAL ] ; then
+    echo "the run completed before it was interrupted: nothing to resume"
+else
+    echo interrupted after `checkpoints` checkpoints
+
+    # a record that was not finished does not count
+    echo "ckpt 9999" >> $JOURNAL
+
+    echo $ $SORT --resume $OPT $SRC $DST
+    $SORT --resume $OPT $SRC $DST || fail "resumed sra-sort failed with $?" 30
+fi
+
+[ -f $JOURNAL ] && fail "the journal is not removed after success" 31
+dump $DST > $DSTDIR/actual.txt || fail "cannot dump $DST" 32
+diff -q $DSTDIR/expected.txt $DSTDIR/actual.txt > /dev/null || fail "resumed run differs from the uninterrupted one" 33
+
+# 2. resume without a journal starts from the beginning
+rm -fr $DST
+echo $ $SORT --resume $OPT $SRC $DST
+$SORT --resume $OPT $SRC $DST || fail "sra-sort --resume without journal failed with $?" 40
+dump $DST > $DSTDIR/actual.txt || fail "cannot dump $DST" 41
+diff -q $DSTDIR/expected.txt $DSTDIR/actual.txt > /dev/null || fail "run without journal differs from the expected one" 42
+
+# 3. resume onto a destination without a journal is rejected before copying
+echo $ $SORT --resume $OPT $SRC $DST
+$SORT --resume $OPT $SRC $DST > $DSTDIR/stderr.txt 2>&1 && fail "sra-sort --resume onto a destination without journal succeeded" 50
+grep -q "has no journal to resume from" $DSTDIR/stderr.txt || fail "sra-sort --resume did not report the missing journal" 51
+dump $DST > $DSTDIR/actual.txt || fail "cannot dump $DST" 52
+diff -q $DSTDIR/expected.txt $DSTDIR/actual.txt > /dev/null || fail "rejected --resume modified the destination" 53
+
+# 4. a table is not copied under a journal
+TBL=`dirname $0`/../vdb-validate/db/SRR053325
+if [ -e $TBL ] ; then
+    for OPTION in --checkpoint --resume ; do
+        echo $ $SORT $OPTION $OPT $TBL $DSTDIR/table
+        $SORT $OPTION $OPT $TBL $DSTDIR/table > $DSTDIR/stderr.txt 2>&1 && fail "sra-sort $OPTION of a table succeeded" 60
+        grep -q "only supported for database sources" $DSTDIR/stderr.txt || fail "sra-sort $OPTION did not reject the table" 61
+    done
+fi
+
+echo Success: resumed run matches the uninterrupted one
+rm -fr $DSTDIR
@@ -0,0 +1,247 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <klib/rc.h>
+
+#include <string.h>
+
+#include <algorithm> /* std::sort */
+#include <vector>
+
+extern "C" {
+#include "sort-defs.h"
+#include "ctx.h"
+#include "caps.h"
+#include "mem.h"
+#include "except.h"
+#include "sra-sort.h"
+#include "idx-mapping.h"
+}
+
+FILE_ENTRY ( test-idx-mapping );
+
+TEST_SUITE ( TestIdxMapping );
+
+/* the ctx of sra-sort with a --mem-limit of quota bytes */
+struct SortCtx {
+    Caps caps;
+    Tool tp;
+    ctx_t main_ctx;
+    const ctx_t * ctx;
+
+    SortCtx ( size_t quota = ( size_t ) -1 ) {
+        DECLARE_CTX_INFO ();
+        CapsInit ( & caps, NULL );
+        memset ( & tp, 0, sizeof tp );
+        tp . num_threads = 4;
+        caps . tool = & tp;
+        main_ctx . caps = & caps;
+        main_ctx . caller = NULL;
+        main_ctx . info = & ctx_info;
+        main_ctx . rc = 0;
+        ctx = & main_ctx;
+        caps . mem = MemBankMake ( ctx, quota );
+    }
+    ~SortCtx () { CapsWhack ( & caps, ctx ); }
+};
+
+/* xorshift64 */
+static uint64_t Random ( uint64_t * x ) {
+    * x ^= * x << 13;
+    * x ^= * x >> 7;
+    * x ^= * x << 17;
+    return * x;
+}
+
+/* the radix sort is threaded from 2 slices of this many entries,
+   below 256K entries IdxMappingSortOld and New stay with KSORT */
+static const size_t SLICE = 1024 * 1024;
+static const size_t MIN_RADIX = 256 * 1024;
+
+enum Keys {
+    keysSigned,    /* the whole range of int64_t and its extremes */
+    keysHighBytes, /* negative keys that share all bytes but the lowest two */
+    keysSame,      /* one key: every pass is skipped */
+    keysFew        /* many duplicates around 0 */
+};
+
+/* keys of the given kind, the other id of entry i is i:
+   a stable sort orders by ( key, other id ) */
+static std::vector < IdxMapping > MakeIds ( size_t count, Keys keys, bool by_new, uint64_t seed ) {
+    std::vector < IdxMapping > v ( count );
+    for ( size_t i = 0; i < count; ++ i ) {
+        uint64_t r = Random ( & seed );
+        int64_t key;
+        switch ( keys ) {
+        case keysSigned: {
+            const int64_t extremes [] = { INT64_MIN, INT64_MAX, 0, -1 };
+            key = r % 16 == 0 ? extremes [ ( r >> 4 ) % 4 ] : ( int64_t ) r;
+            break;
+        }
+        case keysHighBytes:
+            key = ( int64_t ) ( 0xFEDCBA9876540000ULL | ( r >> 48 ) );
+            break;
+        case keysSame:
+            key = -12345;
+            break;
+        default:
+            key = ( int64_t ) ( ( r >> 8 ) % 200 ) - 100;
+            break;
+        }
+        v [ i ] . new_id = by_new ? key : ( int64_t ) i;
+        v [ i ] . old_id = by_new ? ( int64_t ) i : key;
+    }
+    return v;
+}
+
+struct ByOld {
+    bool operator () ( const IdxMapping & a, const IdxMapping & b ) const {
+        return a . old_id < b . old_id || ( a . old_id == b . old_id && a . new_id < b . new_id );
+    }
+};
+
+struct ByNew {
+    bool operator () ( const IdxMapping & a, const IdxMapping & b ) const {
+        return a . new_id < b . new_id || ( a . new_id == b . new_id && a . old_id < b . old_id );
+    }
+};
+
+static bool Same ( const std::vector < IdxMapping > & a, const std::vector < IdxMapping > & b ) {
+    return a . size () == b . size () &&
+        memcmp ( & a [ 0 ], & b [ 0 ], a . size () * sizeof a [ 0 ] ) == 0;
+}
+
+/* the order of a stable sort */
+static std::vector < IdxMapping > Stable ( std::vector < IdxMapping > v, bool by_new ) {
+    if ( by_new )
+        std::sort ( v . begin (), v . end (), ByNew () );
+    else
+        std::sort ( v . begin (), v . end (), ByOld () );
+    return v;
+}
+
+static void RadixSort ( std::vector < IdxMapping > & v, const ctx_t * ctx, bool by_new, uint32_t num_threads ) {
+    if ( by_new )
+        IdxMappingRadixSortNew ( & v [ 0 ], ctx, v . size (), num_threads );
+    else
+        IdxMappingRadixSortOld ( & v [ 0 ], ctx, v . size (), num_threads );
+}
+
+static void KSort ( std::vector < IdxMapping > & v, const ctx_t * ctx, bool by_new ) {
+    if ( by_new )
+        IdxMappingKSortNew ( & v [ 0 ], ctx, v . size () );
+    else
+        IdxMappingKSortOld ( & v [ 0 ], ctx, v . size () );
+}
+
+/* sorts the ids with KSORT and with the radix sort on 1 and 4 threads:
+   the radix sort is stable, KSORT has the same keys in the same order */
+static bool SameAsKSort ( const ctx_t * ctx, size_t count, Keys keys, bool by_new ) {
+    const std::vector < IdxMapping > ids = MakeIds ( count, keys, by_new, count + keys + 1 );
+    const std::vector < IdxMapping > expected = Stable ( ids, by_new );
+
+    std::vector < IdxMapping > ksorted = ids;
+    KSort ( ksorted, ctx, by_new );
+    if ( FAILED () || ! Same ( Stable ( ksorted, by_new ), expected ) )
+        return false;
+
+    for ( uint32_t num_threads = 1; num_threads <= 4; num_threads *= 4 ) {
+        std::vector < IdxMapping > radix = ids;
+        RadixSort ( radix, ctx, by_new, num_threads );
+        if ( FAILED () || ! Same ( radix, expected ) )
+            return false;
+        for ( size_t i = 0; i < count; ++ i ) {
+            if ( by_new ? radix [ i ] . new_id != ksorted [ i ] . new_id
+                        : radix [ i ] . old_id != ksorted [ i ] . old_id )
+                return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE ( radix_same_as_ksort ) {
+    SortCtx sc;
+    const ctx_t * ctx = sc . ctx;
+    REQUIRE ( ! FAILED () );
+
+    const Keys keys [] = { keysSigned, keysHighBytes, keysSame, keysFew };
+    for ( size_t k = 0; k < sizeof keys / sizeof keys [ 0 ]; ++ k ) {
+        for ( int by_new = 0; by_new < 2; ++ by_new ) {
+            REQUIRE ( SameAsKSort ( ctx, 2, keys [ k ], by_new != 0 ) );
+            REQUIRE ( SameAsKSort ( ctx, 1000, keys [ k ], by_new != 0 ) );
+            /* 2 slices on 4 threads, the second one longer */
+            REQUIRE ( SameAsKSort ( ctx, 2 * SLICE + 17, keys [ k ], by_new != 0 ) );
+        }
+    }
+}
+
+TEST_CASE ( sort_under_mem_limit ) {
+    const size_t count = MIN_RADIX + 1000;
+    const size_t bytes = count * sizeof ( IdxMapping );
+    const std::vector < IdxMapping > ids = MakeIds ( count, keysFew, false, 9 );
+
+    /* without a limit: the radix sort */
+    {
+        SortCtx sc;
+        const ctx_t * ctx = sc . ctx;
+        std::vector < IdxMapping > v = ids;
+        IdxMappingSortOld ( & v [ 0 ], ctx, count );
+        REQUIRE ( ! FAILED () );
+        REQUIRE ( Same ( v, Stable ( ids, false ) ) );
+    }
+
+    /* the array takes up the limit but for less than a scratch copy */
+    SortCtx sc ( bytes + bytes / 2 );
+    const ctx_t * ctx = sc . ctx;
+    IdxMapping * a = ( IdxMapping * ) MemAlloc ( ctx, bytes, false );
+    REQUIRE ( ! FAILED () );
+
+    /* the radix sort itself fails and leaves the array alone */
+    memmove ( a, & ids [ 0 ], bytes );
+    IdxMappingRadixSortOld ( a, ctx, count, 4 );
+    REQUIRE ( FAILED () );
+    CLEAR ();
+    REQUIRE_EQ ( memcmp ( a, & ids [ 0 ], bytes ), 0 );
+
+    /* ... SortOld falls back to KSORT: its exact order, not the stable one */
+    std::vector < IdxMapping > ksorted = ids;
+    KSort ( ksorted, ctx, false );
+    REQUIRE ( ! Same ( ksorted, Stable ( ids, false ) ) );
+    IdxMappingSortOld ( a, ctx, count );
+    REQUIRE ( ! FAILED () );
+    REQUIRE_EQ ( memcmp ( a, & ksorted [ 0 ], bytes ), 0 );
+
+    MemFree ( ctx, a, bytes );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestIdxMapping ( argc, argv );
+    }
+}
@@ -0,0 +1,310 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <klib/rc.h>
+
+#include <string.h>
+#include <unistd.h> /* getpid */
+
+#include <algorithm> /* std::swap */
+#include <vector>
+
+extern "C" {
+#include "sort-defs.h"
+#include "ctx.h"
+#include "caps.h"
+#include "mem.h"
+#include "except.h"
+#include "sra-sort.h"
+#include "idx-mapping.h"
+#include "map-file.h"
+}
+
+FILE_ENTRY ( test-map-file );
+
+TEST_SUITE ( TestMapFile );
+
+/* the ctx of sra-sort without a journal:
+   the id map files are created in the current directory and unlinked */
+struct SortCtx {
+    Caps caps;
+    Tool tp;
+    ctx_t main_ctx;
+    const ctx_t * ctx;
+
+    SortCtx () {
+        DECLARE_CTX_INFO ();
+        CapsInit ( & caps, NULL );
+        memset ( & tp, 0, sizeof tp );
+        tp . tmpdir = ".";
+        tp . pid = getpid ();
+        tp . map_file_bsize = tp . map_file_random_bsize = 64 * 1024;
+        tp . num_threads = 1;
+        tp . write_new_to_old = true;
+        tp . unlink_idx_files = true;
+        caps . tool = & tp;
+        main_ctx . caps = & caps;
+        main_ctx . caller = NULL;
+        main_ctx . info = & ctx_info;
+        main_ctx . rc = 0;
+        ctx = & main_ctx;
+        caps . mem = MemBankMake ( ctx, -1 );
+    }
+    ~SortCtx () { CapsWhack ( & caps, ctx ); }
+};
+
+/* xorshift64 */
+static uint64_t Random ( uint64_t * x ) {
+    * x ^= * x << 13;
+    * x ^= * x >> 7;
+    * x ^= * x << 17;
+    return * x;
+}
+
+/* 4096 values are encoded in a block */
+static const size_t BLOCK = 4096;
+
+/* mostly ascending values with negative deltas, gaps of up to 2^44
+   and the extremes of int64_t, where the deltas wrap around */
+static std::vector < int64_t > MakeValues ( size_t count, uint64_t seed ) {
+    std::vector < int64_t > v ( count );
+    uint64_t prior = 0; /* unsigned: wraps around like the deltas */
+    for ( size_t i = 0; i < count; ++ i ) {
+        uint64_t r = Random ( & seed );
+        switch ( r % 8 ) {
+        case 5:  prior -= ( r >> 8 ) % 300; break;
+        case 6:  prior += ( r & 8 ) ? ( r >> 20 ) : 0 - ( r >> 20 ); break;
+        case 7: {
+            const int64_t extremes [] = { INT64_MIN, INT64_MAX, 0, -1 };
+            prior = ( uint64_t ) extremes [ ( r >> 8 ) % 4 ];
+            break;
+        }
+        default: prior += ( r >> 8 ) % 300; break;
+        }
+        v [ i ] = ( int64_t ) prior;
+    }
+    return v;
+}
+
+/* a permutation of 1 .. count */
+static std::vector < int64_t > MakePermutation ( size_t count, uint64_t seed ) {
+    std::vector < int64_t > p ( count );
+    for ( size_t i = 0; i < count; ++ i )
+        p [ i ] = ( int64_t ) i + 1;
+    for ( size_t i = count; i > 1; -- i )
+        std::swap ( p [ i - 1 ], p [ Random ( & seed ) % i ] );
+    return p;
+}
+
+/* the rows of a table are 1-based:
+   poslen of new id i + 1 is poslen [ i ], its old id is old [ i ] */
+struct Rows {
+    std::vector < int64_t > poslen;
+    std::vector < int64_t > old;
+    Rows ( size_t count ) : poslen ( MakeValues ( count, 7 ) ), old ( MakePermutation ( count, 11 ) ) {}
+};
+
+/* writes the rows in chunks of random size, as the alignment tables do:
+   the poslen of a chunk, then its new=>old and old=>new ids */
+static bool WriteRows ( MapFile * map, const ctx_t * ctx, const Rows & rows ) {
+    size_t count = rows . poslen . size ();
+    uint64_t seed = 3;
+    std::vector < IdxMapping > ids;
+    for ( size_t start = 0; start < count && ! FAILED (); ) {
+        size_t n = 1 + ( size_t ) ( Random ( & seed ) % ( 3 * BLOCK / 4 ) );
+        if ( n > count - start )
+            n = count - start;
+        ids . resize ( n );
+        for ( size_t i = 0; i < n; ++ i ) {
+            ids [ i ] . old_id = 0;
+            ids [ i ] . new_id = rows . poslen [ start + i ];
+        }
+        MapFileSetPoslen ( map, ctx, & ids [ 0 ], n );
+        for ( size_t i = 0; i < n; ++ i ) {
+            ids [ i ] . old_id = rows . old [ start + i ];
+            ids [ i ] . new_id = ( int64_t ) ( start + i ) + 1;
+        }
+        if ( ! FAILED () )
+            MapFileSetNewToOld ( map, ctx, & ids [ 0 ], n );
+        if ( ! FAILED () )
+            MapFileSetOldToNew ( map, ctx, & ids [ 0 ], n );
+        start += n;
+    }
+    return ! FAILED ();
+}
+
+/* reads count poslen values from start_id and compares them */
+static bool CheckPoslen ( const MapFile * map, const ctx_t * ctx, const Rows & rows,
+    int64_t start_id, size_t count )
+{
+    std::vector < uint64_t > buf ( count + 1 );
+    size_t total = rows . poslen . size ();
+    size_t expected = ( size_t ) ( start_id - 1 ) + count > total ? total - ( size_t ) ( start_id - 1 ) : count;
+    size_t num_read = MapFileReadPoslen ( map, ctx, start_id, & buf [ 0 ], count );
+    if ( FAILED () || num_read != expected )
+        return false;
+    for ( size_t i = 0; i < num_read; ++ i ) {
+        if ( ( int64_t ) buf [ i ] != rows . poslen [ ( size_t ) ( start_id - 1 ) + i ] )
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE ( poslen_random_access ) {
+    SortCtx sc;
+    const ctx_t * ctx = sc . ctx;
+    REQUIRE ( ! FAILED () );
+
+    /* 5 full blocks and the unsealed tail */
+    const size_t count = 5 * BLOCK + 1234;
+    Rows rows ( count );
+    MapFile * map = MapFileMakeForPoslen ( ctx, "test-poslen" );
+    REQUIRE ( ! FAILED () );
+    MapFileSetIdRange ( map, ctx, 1, count );
+    REQUIRE ( WriteRows ( map, ctx, rows ) );
+
+    /* all at once and around every block boundary */
+    REQUIRE ( CheckPoslen ( map, ctx, rows, 1, count ) );
+    for ( size_t b = 1; b <= count / BLOCK; ++ b ) {
+        REQUIRE ( CheckPoslen ( map, ctx, rows, ( int64_t ) ( b * BLOCK ), 2 ) );
+        REQUIRE ( CheckPoslen ( map, ctx, rows, ( int64_t ) ( b * BLOCK - 10 ), BLOCK + 20 ) );
+    }
+
+    /* random reads of up to 3 blocks, jumping back and forth */
+    uint64_t seed = 5;
+    for ( int i = 0; i < 2000; ++ i ) {
+        int64_t start_id = 1 + ( int64_t ) ( Random ( & seed ) % count );
+        size_t n = 1 + ( size_t ) ( Random ( & seed ) % ( 3 * BLOCK ) );
+        REQUIRE ( CheckPoslen ( map, ctx, rows, start_id, n ) );
+    }
+
+    /* the end of the column is not an error */
+    uint64_t poslen;
+    REQUIRE_EQ ( MapFileReadPoslen ( map, ctx, ( int64_t ) count + 1, & poslen, 1 ), ( size_t ) 0 );
+    REQUIRE ( ! FAILED () );
+
+    MapFileRelease ( map, ctx );
+    REQUIRE ( ! FAILED () );
+}
+
+TEST_CASE ( new_to_old_random_ids ) {
+    SortCtx sc;
+    const ctx_t * ctx = sc . ctx;
+    REQUIRE ( ! FAILED () );
+
+    /* a permutation: the deltas of the old ids jump in both directions */
+    const size_t count = 7 * BLOCK + 99;
+    Rows rows ( count );
+    MapFile * map = MapFileMakeForPoslen ( ctx, "test-new-to-old" );
+    REQUIRE ( ! FAILED () );
+    MapFileSetIdRange ( map, ctx, 1, count );
+    REQUIRE ( WriteRows ( map, ctx, rows ) );
+
+    /* reads the new=>old ids of every block and checks them against old=>new */
+    MapFileConsistencyCheck ( map, ctx );
+    REQUIRE ( ! FAILED () );
+
+    uint64_t seed = 13;
+    for ( int i = 0; i < 1000; ++ i ) {
+        size_t row = ( size_t ) ( Random ( & seed ) % count );
+        REQUIRE_EQ ( MapFileMapSingleOldToNew ( map, ctx, rows . old [ row ], false ), ( int64_t ) row + 1 );
+    }
+
+    MapFileRelease ( map, ctx );
+    REQUIRE ( ! FAILED () );
+}
+
+/* n new=>old mappings from new_id, old id = new id */
+static std::vector < IdxMapping > Ids ( int64_t new_id, size_t n ) {
+    std::vector < IdxMapping > ids ( n );
+    for ( size_t i = 0; i < n; ++ i )
+        ids [ i ] . old_id = ids [ i ] . new_id = new_id + ( int64_t ) i;
+    return ids;
+}
+
+static bool OutOfOrder ( const ctx_t * ctx ) {
+    bool out_of_order = FAILED () && GetRCState ( ctx -> rc ) == rcOutoforder;
+    CLEAR ();
+    return out_of_order;
+}
+
+TEST_CASE ( out_of_order_writes ) {
+    SortCtx sc;
+    const ctx_t * ctx = sc . ctx;
+    REQUIRE ( ! FAILED () );
+
+    const size_t count = BLOCK + 10;
+    MapFile * map = MapFileMakeForPoslen ( ctx, "test-order" );
+    REQUIRE ( ! FAILED () );
+    MapFileSetIdRange ( map, ctx, 1, count );
+
+    /* poslen continues after the last new id written, none yet */
+    std::vector < IdxMapping > ids = Ids ( 1, 5 );
+    MapFileSetPoslen ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( ! FAILED () );
+    MapFileSetPoslen ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( OutOfOrder ( ctx ) );
+
+    ids = Ids ( 1, 100 );
+    MapFileSetNewToOld ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( ! FAILED () );
+    MapFileSetPoslen ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( OutOfOrder ( ctx ) );
+
+    /* a gap, a repeat and a gap in the middle of a batch */
+    ids = Ids ( 102, 1 );
+    MapFileSetNewToOld ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( OutOfOrder ( ctx ) );
+    ids = Ids ( 100, 1 );
+    MapFileSetNewToOld ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( OutOfOrder ( ctx ) );
+    ids = Ids ( 101, 3 );
+    ids [ 2 ] . new_id = ids [ 2 ] . old_id = 104;
+    MapFileSetNewToOld ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( OutOfOrder ( ctx ) );
+
+    /* the ids before the failure are kept, the rejected ones are not */
+    ids = Ids ( 103, count - 102 );
+    MapFileSetNewToOld ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( ! FAILED () );
+    ids = Ids ( 1, count );
+    MapFileSetOldToNew ( map, ctx, & ids [ 0 ], ids . size () );
+    REQUIRE ( ! FAILED () );
+    MapFileConsistencyCheck ( map, ctx );
+    REQUIRE ( ! FAILED () );
+
+    MapFileRelease ( map, ctx );
+    REQUIRE ( ! FAILED () );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestMapFile ( argc, argv );
+    }
+}
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# sra-sort has to produce the same database on 1 and on 4 threads,
+# with and without a memory limit holding back the large columns
+
+if [ "$TEST_DATA" == "" ] ; then
+    echo TEST_DATA is not set: exiting
+    exit 1
+fi
+
+SRC=${1:-$TEST_DATA/SRR5318091-sra-sort-md}
+if [ ! -e "$SRC" ] ; then
+    echo $SRC is not found: skipping the test
+    exit 0
+fi
+
+SORT=sra-sort
+DUMP=vdb-dump
+for T in $SORT $DUMP ; do
+    which $T > /dev/null 2>&1
+    if [ "$?" != "0" ] ; then
+        echo "$T not found: add it to your PATH"
+        exit 10
+    fi
+done
+
+I=`whoami`
+DSTDIR=${TMPDIR:-/tmp}/$I/sra-sort-threads.$$
+DST=$DSTDIR/sorted
+
+rm -fr $DSTDIR
+mkdir -p $DSTDIR || exit 11
+
+OPT="--tempdir $DSTDIR --mmapdir $DSTDIR"
+
+fail() {
+    echo Failure: $1
+    rm -fr $DSTDIR
+    exit $2
+}
+
+# every table of the database, in a stable order
+dump() {
+    for TBL in SEQUENCE PRIMARY_ALIGNMENT SECONDARY_ALIGNMENT EVIDENCE_ALIGNMENT EVIDENCE_INTERVAL REFERENCE ; do
+        if $DUMP -T $TBL -R1 $1 > /dev/null 2>&1 ; then
+            echo "== $TBL"
+            $DUMP -T $TBL $1 || return 1
+        fi
+    done
+}
+
+echo $ $SORT -f --threads 1 $OPT $SRC $DST
+$SORT -f --threads 1 $OPT $SRC $DST || fail "sra-sort --threads 1 failed with $?" 20
+dump $DST > $DSTDIR/expected.txt || fail "cannot dump $DST" 21
+
+N=30
+for THREADS in "--threads 4" "--threads 4 --mem-limit 2147483648" ; do
+    rm -fr $DST
+    echo $ $SORT -f $THREADS $OPT $SRC $DST
+    $SORT -f $THREADS $OPT $SRC $DST || fail "sra-sort $THREADS failed with $?" $N
+    dump $DST > $DSTDIR/actual.txt || fail "cannot dump $DST" $(( N + 1 ))
+    diff -q $DSTDIR/expected.txt $DSTDIR/actual.txt > /dev/null \
+        || fail "sra-sort $THREADS differs from --threads 1" $(( N + 2 ))
+    N=$(( N + 10 ))
+done
+
+echo Success: sra-sort produces the same database on 1 and 4 threads
+rm -fr $DSTDIR
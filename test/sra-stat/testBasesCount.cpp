@@ -0,0 +1,167 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-stat/bases-count.c" /* BasesCountSpot, BasesCountLoop */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+TEST_SUITE ( TestBasesCount );
+
+static uint32_t seed = 1;
+static uint32_t Random ( uint32_t n ) {
+    seed = seed * 1103515245 + 12345;
+    return ( seed >> 8 ) % n;
+}
+
+static void Fill ( uint8_t * bases, size_t count, bool alignment ) {
+    for ( size_t i = 0; i < count; ++ i )
+        bases [ i ] = ( uint8_t ) Random ( alignment ? 16 : 5 );
+}
+
+static bool Count ( uint64_t cnt [ 5 ], const uint8_t * bases, size_t count,
+    bool alignment, bool scalar )
+{
+    if ( scalar )
+        return alignment ? CountBases4naScalar ( cnt, bases, count )
+                         : CountBasesScalar    ( cnt, bases, count );
+    return alignment ? CountBases4na ( cnt, bases, count )
+                     : CountBases    ( cnt, bases, count );
+}
+
+/* the vectorized runs against the base-by-base ones */
+TEST_CASE ( runs ) {
+    static uint8_t bases [ 40000 ];
+    for ( int alignment = 0; alignment < 2; ++ alignment ) {
+        for ( int t = 0; t < 400; ++ t ) {
+            /* every length up to a few vector steps, then long runs
+               with more than 255 steps and odd tails */
+            size_t count = t < 100 ? t : Random ( sizeof bases - 16 );
+            /* unaligned starts */
+            size_t offset = Random ( 16 );
+            Fill ( bases + offset, count, alignment != 0 );
+
+            uint64_t expected [ 5 ] = { 1, 2, 3, 4, 5 };
+            uint64_t cnt [ 5 ] = { 1, 2, 3, 4, 5 };
+            REQUIRE ( Count ( expected, bases + offset, count,
+                alignment != 0, true ) );
+            REQUIRE ( Count ( cnt, bases + offset, count,
+                alignment != 0, false ) );
+            for ( int k = 0; k < 5; ++ k )
+                REQUIRE_EQ ( cnt [ k ], expected [ k ] );
+
+            /* a bad base in the vectorized part or in the tail */
+            if ( count > 0 ) {
+                size_t at = t % 2 == 0 ? Random ( ( uint32_t ) count )
+                                       : count - 1;
+                bases [ offset + at ] = alignment ? 16 : 5;
+                REQUIRE ( ! Count ( cnt, bases + offset, count,
+                    alignment != 0, true ) );
+                REQUIRE ( ! Count ( cnt, bases + offset, count,
+                    alignment != 0, false ) );
+            }
+        }
+    }
+}
+
+/* BasesCountSpot against BasesCountLoop: the two paths of BasesAdd */
+TEST_CASE ( spots ) {
+    static uint8_t bases [ 4000 + 16 ];
+    uint32_t READ_LEN [ 8 ] = { 0 };
+    uint8_t READ_TYPE [ 8 ] = { 0 };
+    int fast = 0;
+
+    for ( int t = 0; t < 20000; ++ t ) {
+        bool alignment = Random ( 2 ) != 0;
+        int nreads = 1 + Random ( 6 );
+        uint64_t size = 0;
+        /* unaligned spots */
+        uint8_t * spot = bases + Random ( 16 );
+        for ( int r = 0; r < nreads; ++ r ) {
+            /* odd lengths, a length of 0 now and then */
+            READ_LEN [ r ] = Random ( 5 ) == 0 ? 0 : Random ( 500 );
+            READ_TYPE [ r ] = Random ( 3 ) == 0
+                ? SRA_READ_TYPE_TECHNICAL : SRA_READ_TYPE_BIOLOGICAL;
+            size += READ_LEN [ r ];
+        }
+        Fill ( spot, size, alignment );
+        switch ( Random ( 10 ) ) {
+            case 0: /* bases do not match READ_LEN */
+                size = Random ( ( uint32_t ) size + 1 );
+                break;
+            case 1: /* a bad base */
+                if ( size > 0 )
+                    spot [ Random ( ( uint32_t ) size ) ] = 200;
+                break;
+        }
+
+        uint64_t expected [ 5 ] = { 0, 0, 0, 0, 0 };
+        int64_t at = 0;
+        bool loop = BasesCountLoop ( expected, spot, size,
+            READ_LEN, READ_TYPE, nreads, alignment, & at );
+        if ( ! loop && at >= 0 )
+            REQUIRE_GT ( ( uint32_t ) spot [ at ], alignment ? 15u : 4u );
+
+        uint64_t cnt [ 5 ] = { 0, 0, 0, 0, 0 };
+        if ( BasesCountSpot ( cnt, spot, size,
+                READ_LEN, READ_TYPE, nreads, alignment ) )
+        {
+            /* everything the vectorized path accepts is counted the same */
+            ++ fast;
+            REQUIRE ( loop );
+            for ( int k = 0; k < 5; ++ k )
+                REQUIRE_EQ ( cnt [ k ], expected [ k ] );
+        }
+        else {
+            /* BasesAdd runs the loop then: cnt must stay untouched */
+            for ( int k = 0; k < 5; ++ k )
+                REQUIRE_EQ ( cnt [ k ], ( uint64_t ) 0 );
+        }
+    }
+
+    /* most spots take the vectorized path */
+    REQUIRE_GT ( fast, 10000 );
+}
+
+TEST_CASE ( bad_base_in_technical_read ) {
+    /* technical reads are not counted, so their bases are not checked */
+    uint8_t bases [] = { 0, 1, 99, 99, 2, 3, 4 };
+    uint32_t READ_LEN [] = { 2, 2, 3 };
+    uint8_t READ_TYPE [] = { SRA_READ_TYPE_BIOLOGICAL,
+        SRA_READ_TYPE_TECHNICAL, SRA_READ_TYPE_BIOLOGICAL };
+    uint64_t cnt [ 5 ] = { 0, 0, 0, 0, 0 };
+
+    REQUIRE ( BasesCountSpot ( cnt, bases, sizeof bases,
+        READ_LEN, READ_TYPE, 3, false ) );
+    for ( int k = 0; k < 5; ++ k )
+        REQUIRE_EQ ( cnt [ k ], ( uint64_t ) 1 );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestBasesCount ( argc, argv );
+    }
+}
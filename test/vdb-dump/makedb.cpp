@@ -196,6 +196,90 @@ NestedDatabase()
     return 0;
 }
 
+/* the values are recomputed by test_arrow.py */
+rc_t
+TypedTable()
+{
+    const string ScratchDir         = "./data/";
+    const string SchemaText  =
+        "table typed_table #1.0.0\n"
+        "{\n"
+        " column ascii TXT;\n"
+        " column U8 U8;\n"
+        " column I32 I32;\n"
+        " column F64 F64;\n"
+        " column bool FLAG;\n"
+        " column U16 [ 2 ] PAIR;\n"
+        " column U64 U64;\n"
+        "};\n"
+    ;
+    const int64_t RowCount = 5000;
+
+    VDBManager* mgr;
+    CHECK_RC ( VDBManagerMakeUpdate ( & mgr, NULL ) );
+    VSchema* schema;
+    CHECK_RC ( VDBManagerMakeSchema ( mgr, & schema ) );
+    CHECK_RC ( VSchemaParseText ( schema, NULL, SchemaText.c_str(), SchemaText.size() ) );
+
+    VTable *tab;
+    CHECK_RC ( VDBManagerCreateTable ( mgr, & tab, schema, "typed_table", kcmInit + kcmMD5,
+                                       "%s", ( ScratchDir + "TypedTable" ) . c_str() ) );
+    VCursor *curs;
+    CHECK_RC ( VTableCreateCursorWrite ( tab, & curs, kcmInsert ) ) ;
+    uint32_t idx[ 7 ];
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 0 ], "TXT" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 1 ], "U8" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 2 ], "I32" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 3 ], "F64" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 4 ], "FLAG" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 5 ], "PAIR" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx[ 6 ], "U64" ) );
+    CHECK_RC ( VCursorOpen ( curs ) );
+
+    for ( int64_t row = 1; row <= RowCount; ++row )
+    {
+        uint32_t k = row % 5;
+        char txt[ 8 ];
+        uint8_t u8[ 8 ];
+        int32_t i32 = ( int32_t )( row * -7 );
+        double f64[ 8 ];
+        uint8_t flag[ 16 ];
+        uint16_t pair[ 16 ];
+        uint64_t u64 = row * 1000000007ULL;
+
+        for ( uint32_t i = 0; i < row % 7; ++i )
+            txt[ i ] = 'a' + ( row + i ) % 26;
+        for ( uint32_t i = 0; i < k; ++i )
+        {
+            u8[ i ] = ( uint8_t )( row * 3 + i );
+            f64[ i ] = row + i / 4.0;
+            pair[ 2 * i ] = ( uint16_t )( row * 10 + 2 * i );
+            pair[ 2 * i + 1 ] = ( uint16_t )( row * 10 + 2 * i + 1 );
+        }
+        for ( uint32_t i = 0; i < row % 11; ++i )
+            flag[ i ] = ( ( row + i ) % 3 ) == 0;
+
+        CHECK_RC ( VCursorSetRowId ( curs, row ) );
+        CHECK_RC ( VCursorOpenRow ( curs ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 0 ], 8, txt, 0, row % 7 ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 1 ], 8, u8, 0, k ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 2 ], 32, & i32, 0, 1 ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 3 ], 64, f64, 0, k ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 4 ], 8, flag, 0, row % 11 ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 5 ], 32, pair, 0, k ) );
+        CHECK_RC ( VCursorWrite ( curs, idx[ 6 ], 64, & u64, 0, 1 ) );
+        CHECK_RC ( VCursorCommitRow ( curs ) );
+        CHECK_RC ( VCursorCloseRow ( curs ) );
+    }
+    CHECK_RC ( VCursorCommit ( curs ) );
+    CHECK_RC ( VCursorRelease ( curs ) );
+    CHECK_RC ( VTableRelease ( tab ) );
+
+    CHECK_RC ( VSchemaRelease ( schema ) );
+    CHECK_RC ( VDBManagerRelease ( mgr ) );
+    return 0;
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -223,7 +307,8 @@ rc_t CC KMain ( int argc, char *argv [] )
 {
     KConfigDisableUserSettings();
 
-    return NestedDatabase();
+    CHECK_RC ( NestedDatabase() );
+    return TypedTable();
 }
 
 }
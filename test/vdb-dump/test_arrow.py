@@ -0,0 +1,317 @@
+import os
+import sys
+import struct
+import subprocess
+
+'''---------------------------------------------------------------------
+    round-trip of vdb-dump's arrow output ( -f arrow / -f arrow-file )
+    the table data/TypedTable is written by vdb-dump-makedb
+    usage: python test_arrow.py PATH-TO-VDB-DUMP
+---------------------------------------------------------------------'''
+
+TABLE = os.path.join( "data", "TypedTable" )
+ROWS = 5000
+
+'''---------------------------------------------------------------------
+    the values written by makedb.cpp ( TypedTable )
+---------------------------------------------------------------------'''
+def expected_row( row ) :
+    k = row % 5
+    return {
+        "TXT"  : "".join( chr( ord( 'a' ) + ( row + i ) % 26 ) for i in range( row % 7 ) ),
+        "U8"   : [ ( row * 3 + i ) & 0xFF for i in range( k ) ],
+        "I32"  : [ row * -7 ],
+        "F64"  : [ row + i / 4.0 for i in range( k ) ],
+        "FLAG" : [ ( ( row + i ) % 3 ) == 0 for i in range( row % 11 ) ],
+        "PAIR" : [ [ ( row * 10 + 2 * i ) & 0xFFFF, ( row * 10 + 2 * i + 1 ) & 0xFFFF ]
+                   for i in range( k ) ],
+        "U64"  : [ row * 1000000007 ] }
+
+EXPECTED_TYPES = {
+    "TXT"  : "utf8",
+    "U8"   : "list<uint8>",
+    "I32"  : "list<int32>",
+    "F64"  : "list<float64>",
+    "FLAG" : "list<bool>",
+    "PAIR" : "list<fixed_size_list<uint16>[2]>",
+    "U64"  : "list<uint64>" }
+
+'''---------------------------------------------------------------------
+    a small flatbuffer reader: just enough for Message.fbs, Schema.fbs
+    and File.fbs
+---------------------------------------------------------------------'''
+class Table :
+    def __init__( self, buf, pos ) :
+        self.buf = buf
+        self.pos = pos
+        self.vt = pos - struct.unpack_from( "<i", buf, pos )[ 0 ]
+        self.vt_size = struct.unpack_from( "<H", buf, self.vt )[ 0 ]
+
+    def field( self, idx ) :
+        at = 4 + 2 * idx
+        if at >= self.vt_size :
+            return 0
+        return struct.unpack_from( "<H", self.buf, self.vt + at )[ 0 ]
+
+    def scalar( self, idx, fmt, default = 0 ) :
+        ofs = self.field( idx )
+        if ofs == 0 :
+            return default
+        return struct.unpack_from( "<" + fmt, self.buf, self.pos + ofs )[ 0 ]
+
+    def target( self, idx ) :
+        ofs = self.field( idx )
+        if ofs == 0 :
+            return None
+        at = self.pos + ofs
+        return at + struct.unpack_from( "<I", self.buf, at )[ 0 ]
+
+    def table( self, idx ) :
+        at = self.target( idx )
+        return None if at is None else Table( self.buf, at )
+
+    def string( self, idx ) :
+        at = self.target( idx )
+        n = struct.unpack_from( "<I", self.buf, at )[ 0 ]
+        return self.buf[ at + 4 : at + 4 + n ].decode( "utf-8" )
+
+    def tables( self, idx ) :
+        at = self.target( idx )
+        if at is None :
+            fail( "missing vector in flatbuffer" )
+        n = struct.unpack_from( "<I", self.buf, at )[ 0 ]
+        res = []
+        for i in range( n ) :
+            e = at + 4 + 4 * i
+            res.append( Table( self.buf, e + struct.unpack_from( "<I", self.buf, e )[ 0 ] ) )
+        return res
+
+    def structs( self, idx, fmt ) :
+        at = self.target( idx )
+        if at is None :
+            fail( "missing vector in flatbuffer" )
+        n = struct.unpack_from( "<I", self.buf, at )[ 0 ]
+        size = struct.calcsize( "<" + fmt )
+        if ( at + 4 ) % 8 != 0 :
+            fail( "vector of structs is not aligned" )
+        return [ struct.unpack_from( "<" + fmt, self.buf, at + 4 + i * size )
+                 for i in range( n ) ]
+
+def root( buf ) :
+    return Table( buf, struct.unpack_from( "<I", buf, 0 )[ 0 ] )
+
+'''---------------------------------------------------------------------
+    arrow: schema, record-batches and the decoding of the columns
+---------------------------------------------------------------------'''
+TYPE_INT, TYPE_FLOAT, TYPE_UTF8, TYPE_BOOL, TYPE_LIST, TYPE_FIXED_LIST = 2, 3, 5, 6, 12, 16
+MSG_SCHEMA, MSG_BATCH = 1, 3
+
+def parse_field( f ) :
+    type_id = f.scalar( 2, "B" )
+    t = f.table( 3 )
+    children = [ parse_field( c ) for c in f.tables( 5 ) ]
+    if type_id == TYPE_INT :
+        desc = ( "int", t.scalar( 0, "i" ), t.scalar( 1, "B" ) != 0 )
+    elif type_id == TYPE_FLOAT :
+        desc = ( "float", t.scalar( 0, "h" ) )
+    elif type_id == TYPE_FIXED_LIST :
+        desc = ( "fixed_list", t.scalar( 0, "i" ) )
+    elif type_id in ( TYPE_UTF8, TYPE_BOOL, TYPE_LIST ) :
+        desc = ( { TYPE_UTF8 : "utf8", TYPE_BOOL : "bool", TYPE_LIST : "list" }[ type_id ], )
+    else :
+        fail( "unexpected arrow type %d" % type_id )
+    return ( f.string( 0 ), desc, children )
+
+def type_name( field ) :
+    name, desc, children = field
+    if desc[ 0 ] == "int" :
+        return "%sint%d" % ( "" if desc[ 2 ] else "u", desc[ 1 ] )
+    if desc[ 0 ] == "float" :
+        return { 1 : "float32", 2 : "float64" }[ desc[ 1 ] ]
+    if desc[ 0 ] == "list" :
+        return "list<%s>" % type_name( children[ 0 ] )
+    if desc[ 0 ] == "fixed_list" :
+        return "fixed_size_list<%s>[%d]" % ( type_name( children[ 0 ] ), desc[ 1 ] )
+    return desc[ 0 ]
+
+class Batch :
+    def __init__( self, header, body ) :
+        self.length = header.scalar( 0, "q" )
+        self.nodes = header.structs( 1, "qq" )
+        self.buffers = header.structs( 2, "qq" )
+        self.body = body
+
+    def next_buffer( self ) :
+        offset, length = self.buffers.pop( 0 )
+        if offset % 8 != 0 or offset + length > len( self.body ) :
+            fail( "buffer at %d with %d bytes is not in the body" % ( offset, length ) )
+        return self.body[ offset : offset + length ]
+
+    def decode( self, field ) :
+        name, desc, children = field
+        length, null_count = self.nodes.pop( 0 )
+        if null_count != 0 :
+            fail( "unexpected nulls in %s" % name )
+        self.next_buffer() # validity
+        if desc[ 0 ] == "utf8" :
+            offsets = struct.unpack_from( "<%di" % ( length + 1 ), self.next_buffer() )
+            data = self.next_buffer()
+            return [ data[ offsets[ i ] : offsets[ i + 1 ] ].decode( "utf-8" )
+                     for i in range( length ) ]
+        if desc[ 0 ] == "list" :
+            offsets = struct.unpack_from( "<%di" % ( length + 1 ), self.next_buffer() )
+            values = self.decode( children[ 0 ] )
+            return [ values[ offsets[ i ] : offsets[ i + 1 ] ] for i in range( length ) ]
+        if desc[ 0 ] == "fixed_list" :
+            n = desc[ 1 ]
+            values = self.decode( children[ 0 ] )
+            return [ values[ i * n : ( i + 1 ) * n ] for i in range( length ) ]
+        data = self.next_buffer()
+        if desc[ 0 ] == "bool" :
+            return [ ( ord( data[ i // 8 : i // 8 + 1 ] ) >> ( i % 8 ) ) & 1 == 1
+                     for i in range( length ) ]
+        if desc[ 0 ] == "int" :
+            fmt = { 8 : "b", 16 : "h", 32 : "i", 64 : "q" }[ desc[ 1 ] ]
+            fmt = fmt if desc[ 2 ] else fmt.upper()
+        else :
+            fmt = { 1 : "f", 2 : "d" }[ desc[ 1 ] ]
+        return list( struct.unpack_from( "<%d%s" % ( length, fmt ), data ) )
+
+def read_message( buf, pos ) :
+    cont, size = struct.unpack_from( "<Ii", buf, pos )
+    if cont != 0xFFFFFFFF :
+        fail( "missing continuation-marker at %d" % pos )
+    if size == 0 :
+        return None, pos + 8
+    if ( 8 + size ) % 8 != 0 :
+        fail( "metadata at %d is not padded" % pos )
+    msg = root( buf[ pos + 8 : pos + 8 + size ] )
+    if msg.scalar( 0, "h" ) != 4 :
+        fail( "metadata-version is not V5" )
+    body_len = msg.scalar( 3, "q" )
+    body = buf[ pos + 8 + size : pos + 8 + size + body_len ]
+    return ( msg.scalar( 1, "B" ), msg.table( 2 ), body ), pos + 8 + size + body_len
+
+def to_rows( fields, batches ) :
+    rows = []
+    for header, body in batches :
+        batch = Batch( header, body )
+        cols = [ batch.decode( f ) for f in fields ]
+        if batch.nodes or batch.buffers :
+            fail( "record-batch has unused nodes or buffers" )
+        for i in range( batch.length ) :
+            rows.append( dict( ( f[ 0 ], c[ i ] ) for f, c in zip( fields, cols ) ) )
+    return rows
+
+def read_stream( buf, pos = 0 ) :
+    fields = None
+    batches = []
+    while True :
+        msg, pos = read_message( buf, pos )
+        if msg is None :
+            break
+        kind, header, body = msg
+        if kind == MSG_SCHEMA :
+            fields = [ parse_field( f ) for f in header.tables( 1 ) ]
+        elif kind == MSG_BATCH :
+            batches.append( ( header, body ) )
+        else :
+            fail( "unexpected message-type %d" % kind )
+    return fields, to_rows( fields, batches ), pos
+
+def read_file( buf ) :
+    if buf[ : 8 ] != b"ARROW1\0\0" or buf[ -6 : ] != b"ARROW1" :
+        fail( "missing magic of arrow-file" )
+    fields, rows, end = read_stream( buf, 8 )
+    footer_len = struct.unpack_from( "<i", buf, len( buf ) - 10 )[ 0 ]
+    if end + footer_len + 10 != len( buf ) :
+        fail( "footer is not at the end of the stream" )
+    footer = root( buf[ end : end + footer_len ] )
+    schema = footer.table( 1 )
+    if [ parse_field( f ) for f in schema.tables( 1 ) ] != fields :
+        fail( "schema of footer differs" )
+    batches = []
+    for offset, meta_len, body_len in footer.structs( 3, "qi4xq" ) :
+        ( kind, header, body ), pos = read_message( buf, offset )
+        if kind != MSG_BATCH or pos != offset + meta_len + body_len :
+            fail( "block at %d is not a record-batch" % offset )
+        batches.append( ( header, body ) )
+    if to_rows( fields, batches ) != rows :
+        fail( "blocks of footer differ from stream" )
+    return fields, rows
+
+'''---------------------------------------------------------------------
+    test helpers
+---------------------------------------------------------------------'''
+def fail( msg ) :
+    print( "FAILED: %s" % msg )
+    sys.exit( 1 )
+
+def run_vdb_dump( vdb_dump, args ) :
+    p = subprocess.Popen( [ vdb_dump, TABLE ] + args, stdout = subprocess.PIPE )
+    out = p.communicate()[ 0 ]
+    if p.returncode != 0 :
+        fail( "vdb-dump %s failed" % " ".join( args ) )
+    return out
+
+def check( fields, rows, first, last, columns ) :
+    types = dict( ( f[ 0 ], type_name( f ) ) for f in fields )
+    if sorted( types.keys() ) != sorted( columns ) :
+        fail( "unexpected columns %s" % sorted( types.keys() ) )
+    for name in columns :
+        if types[ name ] != EXPECTED_TYPES[ name ] :
+            fail( "column %s is %s" % ( name, types[ name ] ) )
+    if len( rows ) != last - first + 1 :
+        fail( "got %d rows instead of %d" % ( len( rows ), last - first + 1 ) )
+    for i, row in enumerate( rows ) :
+        exp = expected_row( first + i )
+        for name in columns :
+            if row[ name ] != exp[ name ] :
+                fail( "row %d column %s: %s != %s"
+                      % ( first + i, name, row[ name ], exp[ name ] ) )
+
+def check_where( fields, rows, columns, pred ) :
+    ids = [ row for row in range( 1, ROWS + 1 ) if pred( expected_row( row ) ) ]
+    if len( rows ) != len( ids ) :
+        fail( "got %d rows instead of %d" % ( len( rows ), len( ids ) ) )
+    for row, id in zip( rows, ids ) :
+        exp = expected_row( id )
+        for name in columns :
+            if row[ name ] != exp[ name ] :
+                fail( "row %d column %s: %s != %s" % ( id, name, row[ name ], exp[ name ] ) )
+
+def main( vdb_dump ) :
+    columns = sorted( EXPECTED_TYPES.keys() )
+
+    print( "arrow stream of all rows" )
+    fields, rows, end = read_stream( run_vdb_dump( vdb_dump, [ "-f", "arrow" ] ) )
+    check( fields, rows, 1, ROWS, columns )
+
+    print( "arrow file of all rows" )
+    fields, rows = read_file( run_vdb_dump( vdb_dump, [ "-f", "arrow-file" ] ) )
+    check( fields, rows, 1, ROWS, columns )
+
+    print( "arrow stream of a row-range and some columns" )
+    fields, rows, end = read_stream( run_vdb_dump( vdb_dump,
+        [ "-f", "arrow", "-R", "4090-4100", "-C", "TXT,PAIR,FLAG" ] ) )
+    check( fields, rows, 4090, 4100, [ "FLAG", "PAIR", "TXT" ] )
+
+    print( "arrow stream of the rows selected by --where" )
+    fields, rows, end = read_stream( run_vdb_dump( vdb_dump,
+        [ "-f", "arrow", "-C", "TXT,I32", "--where", "I32 > -350 and TXT ^= 'c'" ] ) )
+    check_where( fields, rows, [ "I32", "TXT" ],
+        lambda r : r[ "I32" ][ 0 ] > -350 and r[ "TXT" ].startswith( "c" ) )
+
+    fields, rows, end = read_stream( run_vdb_dump( vdb_dump,
+        [ "-f", "arrow", "-C", "U8,F64", "--where", "U8 in 10..12 or not ( F64 < 4990.5 )" ] ) )
+    check_where( fields, rows, [ "F64", "U8" ],
+        lambda r : any( 10 <= v <= 12 for v in r[ "U8" ] )
+                   or not any( v < 4990.5 for v in r[ "F64" ] ) )
+
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-VDB-DUMP" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
@@ -0,0 +1,68 @@
+import sys
+import subprocess
+
+from test_arrow import expected_row, fail, ROWS, TABLE
+
+'''---------------------------------------------------------------------
+    checks the rows selected by vdb-dump --where in the text output
+    against the values written by makedb.cpp ( TypedTable )
+    usage: python test_filter.py PATH-TO-VDB-DUMP
+---------------------------------------------------------------------'''
+
+def run_where( vdb_dump, expr, columns ) :
+    args = [ vdb_dump, TABLE, "-f", "tab", "-I", "-C", columns, "--where", expr ]
+    p = subprocess.Popen( args, stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+    out = p.communicate()[ 0 ]
+    return p.returncode, out.decode( "utf-8" )
+
+def check_where( vdb_dump, expr, columns, pred ) :
+    print( "--where \"%s\"" % expr )
+    rc, out = run_where( vdb_dump, expr, columns )
+    if rc != 0 :
+        fail( "vdb-dump --where \"%s\" failed" % expr )
+    ids = [ int( line.split( "\t" )[ 0 ] ) for line in out.splitlines() if line ]
+    expected = [ row for row in range( 1, ROWS + 1 ) if pred( expected_row( row ) ) ]
+    if ids != expected :
+        fail( "--where \"%s\": got %d rows instead of %d" % ( expr, len( ids ), len( expected ) ) )
+
+def check_rejected( vdb_dump, expr, columns ) :
+    print( "--where \"%s\" is rejected" % expr )
+    rc, out = run_where( vdb_dump, expr, columns )
+    if rc == 0 :
+        fail( "vdb-dump --where \"%s\" did not fail" % expr )
+    if out :
+        fail( "vdb-dump --where \"%s\" printed rows" % expr )
+
+def main( vdb_dump ) :
+    u64 = lambda r : r[ "U64" ][ 0 ]
+    i32 = lambda r : r[ "I32" ][ 0 ]
+
+    check_where( vdb_dump, "U64 = 1000000007", "U64", lambda r : u64( r ) == 1000000007 )
+    check_where( vdb_dump, "U64 >= 4990000034930", "U64", lambda r : u64( r ) >= 4990000034930 )
+    # the whole range of an unsigned column
+    check_where( vdb_dump, "U64 in 0..18446744073709551615", "U64", lambda r : True )
+    check_where( vdb_dump, "U64 < 18446744073709551615", "U64", lambda r : True )
+    check_where( vdb_dump, "U64 > -1", "U64", lambda r : True )
+    check_where( vdb_dump, "U64 <= -0", "U64", lambda r : False )
+    # decimal, even with a leading zero
+    check_where( vdb_dump, "I32 = -070", "I32", lambda r : i32( r ) == -70 )
+    check_where( vdb_dump, "I32 in -9223372036854775808..-34965", "I32", lambda r : i32( r ) <= -34965 )
+    check_where( vdb_dump, "I32 > -35.5 and TXT ^= 'c'", "I32,TXT",
+                 lambda r : i32( r ) > -35.5 and r[ "TXT" ].startswith( "c" ) )
+    check_where( vdb_dump, "TXT = 'bcdef'", "TXT", lambda r : r[ "TXT" ] == "bcdef" )
+
+    check_rejected( vdb_dump, "U64 = 18446744073709551616", "U64" )
+    check_rejected( vdb_dump, "I32 = 9223372036854775808", "I32" )
+    check_rejected( vdb_dump, "I32 > -9223372036854775809", "I32" )
+    check_rejected( vdb_dump, "I32 = 0x10", "I32" )
+    check_rejected( vdb_dump, "U64 = 12abc", "U64" )
+    check_rejected( vdb_dump, "F64 < 1e999", "F64" )
+    check_rejected( vdb_dump, "TXT = 5", "TXT" )
+
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-VDB-DUMP" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
@@ -0,0 +1,73 @@
+import sys
+import json
+import subprocess
+
+from test_arrow import expected_row, fail, ROWS, TABLE
+
+'''---------------------------------------------------------------------
+    checks the JSON-report of vdb-dump --profile against the values
+    written by makedb.cpp ( TypedTable ), single- and multi-threaded
+    usage: python test_profile.py PATH-TO-VDB-DUMP
+---------------------------------------------------------------------'''
+
+def run_profile( vdb_dump, args ) :
+    p = subprocess.Popen( [ vdb_dump, TABLE, "--profile" ] + args, stdout = subprocess.PIPE )
+    out = p.communicate()[ 0 ]
+    if p.returncode != 0 :
+        fail( "vdb-dump --profile %s failed" % " ".join( args ) )
+    return json.loads( out.decode( "utf-8" ) )
+
+def check_equal( what, value, expected ) :
+    if value != expected :
+        fail( "%s: %s != %s" % ( what, value, expected ) )
+
+def check( report ) :
+    rows = [ expected_row( row ) for row in range( 1, ROWS + 1 ) ]
+    check_equal( "rows", report[ "rows" ], ROWS )
+    cols = dict( ( c[ "name" ], c ) for c in report[ "columns" ] )
+
+    for name in [ "U8", "I32", "U64", "FLAG" ] :
+        values = [ int( v ) for r in rows for v in r[ name ] ]
+        col = cols[ name ]
+        check_equal( name + ".elements", col[ "elements" ], len( values ) )
+        check_equal( name + ".min", col[ "values" ][ "min" ], min( values ) )
+        check_equal( name + ".max", col[ "values" ][ "max" ], max( values ) )
+        check_equal( name + ".sum", col[ "values" ][ "sum" ], sum( values ) )
+        check_equal( name + ".histogram", sum( b[ "count" ] for b in col[ "values" ][ "histogram" ] ),
+                     len( values ) )
+
+    lengths = [ len( r[ "PAIR" ] ) for r in rows ]
+    check_equal( "PAIR.empty_rows", cols[ "PAIR" ][ "empty_rows" ], lengths.count( 0 ) )
+    check_equal( "PAIR.elements_per_row.max", cols[ "PAIR" ][ "elements_per_row" ][ "max" ], max( lengths ) )
+
+    # TXT has less distinct values than the top-k keeps: the counts are exact
+    counts = {}
+    for r in rows :
+        counts[ r[ "TXT" ] ] = counts.get( r[ "TXT" ], 0 ) + 1
+    top = cols[ "TXT" ][ "top" ][ 0 ]
+    check_equal( "TXT.top", ( top[ "value" ], top[ "count" ], top[ "error" ] ),
+                 ( "", counts[ "" ], 0 ) )
+    estimate = cols[ "TXT" ][ "distinct" ][ "estimate" ]
+    if abs( estimate - len( counts ) ) > len( counts ) * 0.05 :
+        fail( "TXT.distinct: %d is not close to %d" % ( estimate, len( counts ) ) )
+
+def main( vdb_dump ) :
+    print( "profile, one thread" )
+    single = run_profile( vdb_dump, [] )
+    check( single )
+
+    print( "profile, four threads" )
+    multi = run_profile( vdb_dump, [ "--threads", "4" ] )
+    check( multi )
+    for report in ( single, multi ) :
+        del report[ "threads" ]
+    if single != multi :
+        fail( "the reports of one and four threads differ" )
+
+    print( "OK" )
+
+if __name__ == "__main__" :
+    if len( sys.argv ) != 2 :
+        print( "usage: %s PATH-TO-VDB-DUMP" % sys.argv[ 0 ] )
+        sys.exit( 1 )
+    main( sys.argv[ 1 ] )
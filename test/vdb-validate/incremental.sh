@@ -0,0 +1,113 @@
+#!/bin/bash
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+# vdb-validate --incremental:
+#   1. the first run writes the manifest and reports like a run without it
+#   2. the second run replays the consistency check of every job from the
+#      manifest and skips the data checks
+#   3. after a file of one table is touched, only that table is checked again
+#   4. with other options the manifest is not used
+# usage: incremental.sh BINDIR [ KAR-FILE ]
+
+BINDIR=$1
+SRC=${2:-db/sdc_len_mismatch.csra}
+
+VALIDATE=$BINDIR/vdb-validate
+if [ ! -x $BINDIR/kar ] ; then
+    echo "$BINDIR/kar not found: skipping the test"
+    exit 0
+fi
+
+TMP=actual/incremental
+DB=$TMP/`basename $SRC`
+MANIFESTS=$TMP/manifests
+rm -fr $TMP
+mkdir -p $MANIFESTS || exit 1
+
+fail() {
+    echo "Failure: $1"
+    exit 2
+}
+
+# without the date, the program name and the file names of the messages
+run() {
+    CASEID=$1
+    shift
+    echo $ vdb-validate $@
+    $VALIDATE $@ > $TMP/$CASEID.tmp 2>&1 || fail "vdb-validate $@ returned $?"
+    awk '{if(substr($2,1,12) == "vdb-validate"){$2=$1="";} print $0}' $TMP/$CASEID.tmp \
+        | sed -e 's/^[ \t]*//g' -e 's/: .*:[0-9]*:[^ ]*:/:/g' > $TMP/$CASEID
+    rm $TMP/$CASEID.tmp
+}
+
+# the log-messages without the ones of the data checks and the skip-notice
+cc_messages() {
+    grep -E '^(info|warn|err):' $TMP/$1 \
+        | grep -v -E "are consistent$|integrity( checks)? ok$|Referential Integrity|has not changed"
+}
+
+# the jobs replayed from the manifest ( a status-message, -v )
+replayed() {
+    grep "has not changed since its last check" $TMP/$1
+}
+
+$BINDIR/kar --extract $SRC --directory $DB > /dev/null || fail "cannot extract $SRC"
+OPT="--incremental --manifest-dir $MANIFESTS -v"
+
+# 1.
+run plain $DB
+run first $DB $OPT
+ls $MANIFESTS/*.vdb-validate > /dev/null 2>&1 || fail "no manifest is written"
+[ "`replayed first`" == "" ] || fail "the first run replays a job"
+diff <( grep -E '^(info|warn|err):' $TMP/plain ) <( grep -E '^(info|warn|err):' $TMP/first ) \
+    || fail "the first run reports other messages than a run without --incremental"
+
+# 2.
+run second $DB $OPT
+JOBS=$(( `ls $DB/tbl | wc -l` + 1 ))
+[ "`replayed second | wc -l`" == "$JOBS" ] || fail "the second run does not replay all $JOBS jobs"
+grep -q "data checks skipped" $TMP/second || fail "the second run does not skip the data checks"
+diff <( cc_messages first ) <( cc_messages second ) \
+    || fail "the second run does not replay the messages of the first one"
+
+# 3.
+FILE=`find $DB/tbl/SEQUENCE -type f | head -n 1`
+touch -m -d @$(( `stat -c %Y $FILE` + 60 )) $FILE
+run touched $DB $OPT
+[ "`replayed touched | wc -l`" == "$(( JOBS - 1 ))" ] \
+    || fail "after touching $FILE, not all the other jobs are replayed"
+replayed touched | grep -q "'SEQUENCE'" && fail "after touching $FILE, SEQUENCE is replayed"
+grep -q "data checks skipped" $TMP/touched && fail "after touching $FILE, the data checks are skipped"
+diff <( grep -E '^(info|warn|err):' $TMP/plain ) <( grep -E '^(info|warn|err):' $TMP/touched ) \
+    || fail "after touching $FILE, the messages differ from a run without --incremental"
+
+# 4.
+run options $DB $OPT --exhaustive
+grep -q "is not usable" $TMP/options || fail "the manifest of other options is used"
+[ "`replayed options`" == "" ] || fail "a job is replayed with other options"
+grep -q "data checks skipped" $TMP/options && fail "the data checks are skipped with other options"
+
+echo "Success: vdb-validate --incremental replays what did not change"
+rm -fr $TMP
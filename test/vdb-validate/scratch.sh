@@ -0,0 +1,93 @@
+#!/bin/bash
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+
+# vdb-validate --temp: the runs of the referential integrity keys sorted
+# on disk ( --mem ) are scratch files of --temp, else of $TMPDIR
+#   1. a run with --temp reports like a run in memory and leaves no file
+#   2. without --temp, the scratch files are created in $TMPDIR
+#   3. a --temp directory that does not exist is reported
+# usage: scratch.sh BINDIR [ DB ]
+
+BINDIR=$1
+SRC=${2:-db/sdc_seq_cmp_read_len_fixed.csra}
+
+VALIDATE=$BINDIR/vdb-validate
+TMP=actual/scratch
+SCRATCH=$TMP/temp
+rm -fr $TMP
+mkdir -p $SCRATCH || exit 1
+
+fail() {
+    echo "Failure: $1"
+    exit 2
+}
+
+# without the date, the program name, the file names of the messages
+# and the progress of the sort
+run() {
+    CASEID=$1
+    shift
+    echo $ vdb-validate $@
+    $VALIDATE $@ > $TMP/$CASEID.tmp 2>&1
+    echo $? > $TMP/$CASEID.rc
+    awk '{if(substr($2,1,12) == "vdb-validate"){$2=$1="";} print $0}' $TMP/$CASEID.tmp \
+        | sed -e 's/^[ \t]*//g' -e 's/: .*:[0-9]*:[^ ]*:/:/g' \
+              -e '/Referential Integrity: .*% \(sorted\|complete\)$/d' > $TMP/$CASEID
+    rm $TMP/$CASEID.tmp
+}
+
+no_scratch_files() {
+    [ "`ls -A $1`" == "" ] || fail "scratch files are left in $1: `ls -A $1`"
+}
+
+run memory $SRC
+[ "`cat $TMP/memory.rc`" == "0" ] || fail "vdb-validate $SRC returned `cat $TMP/memory.rc`"
+
+# 1.
+for THREADS in 1 4 ; do
+    run temp$THREADS $SRC --mem 1K --temp $SCRATCH --threads $THREADS
+    [ "`cat $TMP/temp$THREADS.rc`" == "0" ] \
+        || fail "vdb-validate --temp --threads $THREADS returned `cat $TMP/temp$THREADS.rc`"
+    diff $TMP/memory $TMP/temp$THREADS \
+        || fail "--temp --threads $THREADS reports other messages than a run in memory"
+    no_scratch_files $SCRATCH
+done
+
+# 2.
+TMPDIR=$SCRATCH run tmpdir $SRC --mem 1K
+[ "`cat $TMP/tmpdir.rc`" == "0" ] || fail "vdb-validate with TMPDIR returned `cat $TMP/tmpdir.rc`"
+diff $TMP/memory $TMP/tmpdir || fail "TMPDIR: other messages than a run in memory"
+no_scratch_files $SCRATCH
+
+# 3.
+run missing $SRC --mem 1K --temp $TMP/missing
+[ "`cat $TMP/missing.rc`" != "0" ] || fail "a missing --temp directory is not an error"
+grep -q "cannot create a scratch file in" $TMP/missing \
+    || fail "a missing --temp directory is not reported"
+[ -e $TMP/missing ] && fail "$TMP/missing is created"
+
+echo "Success: vdb-validate sorts on disk in --temp and leaves no scratch file"
+rm -fr $TMP
@@ -0,0 +1,546 @@
+/*===========================================================================
+ *
+ *                            Public DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+#include <klib/rc.h>
+#include <kproc/cond.h>
+#include <kproc/lock.h>
+#include <kproc/thread.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "block-cache.h"
+
+#define BLOCK_CACHE_THREADS 2
+#define BLOCK_CACHE_QUEUE 64
+
+typedef struct BlockCache_Slot {
+    KLock* lock;     /* held while the block is generated or copied */
+    char* buf;       /* NULL until the slot is first used */
+    uint64_t from;
+    uint64_t size;   /* block size from index until it is generated */
+    uint64_t used;   /* LRU tick */
+    uint32_t users;
+    rc_t rc;         /* generation failure */
+    bool valid;      /* slot holds (or is generating) block from..size */
+} BlockCache_Slot;
+
+struct BlockCacheFile {
+    KLock* lock;           /* slots state */
+    KCondition* idle;      /* a slot is released or read-ahead stopped */
+    KLock* fill_lock;      /* serializes locate and fill */
+    uint64_t file_sz;
+    size_t block_sz;
+    BlockCache_Locate* locate;
+    BlockCache_Fill* fill;
+    void* data;
+    uint64_t tick;
+    uint32_t buffers;      /* allocated slot buffers */
+    /* sequential access detection */
+    uint64_t last_from;
+    uint64_t next_from;
+    uint32_t sequential;
+    uint32_t jobs;         /* read-ahead jobs queued or running */
+    bool closing;
+    uint32_t count;
+    BlockCache_Slot slot[1];
+};
+
+typedef struct BlockCache_Job {
+    struct BlockCache_Job* next;
+    BlockCacheFile* file;
+    uint64_t pos;
+} BlockCache_Job;
+
+static struct {
+    uint32_t slots;
+    uint64_t mem_limit;
+    uint32_t read_ahead;
+    KLock* lock;
+    KCondition* cond;
+    uint64_t mem_used;
+    BlockCache_Job* head;
+    BlockCache_Job* tail;
+    uint32_t queued;
+    bool stop;
+    uint32_t threads;
+    KThread* thread[BLOCK_CACHE_THREADS];
+} g_cache = { 4, 0, 2 };
+
+/* a file with no buffers may go over the limit so its reader can go on */
+static
+bool BlockCache_MemTake(uint64_t size, bool force)
+{
+    bool ok = true;
+    if( g_cache.lock != NULL && KLockAcquire(g_cache.lock) == 0 ) {
+        if( !force && g_cache.mem_limit > 0 && g_cache.mem_used + size > g_cache.mem_limit ) {
+            ok = false;
+        } else {
+            g_cache.mem_used += size;
+        }
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+    }
+    return ok;
+}
+
+static
+void BlockCache_MemGive(uint64_t size)
+{
+    if( g_cache.lock != NULL && KLockAcquire(g_cache.lock) == 0 ) {
+        g_cache.mem_used -= size;
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+    }
+}
+
+/* slot holding pos; called with self->lock held */
+static
+BlockCache_Slot* BlockCacheFile_Find(BlockCacheFile* self, uint64_t pos)
+{
+    uint32_t i;
+    for(i = 0; i < self->count; i++) {
+        BlockCache_Slot* s = &self->slot[i];
+        if( s->valid && pos >= s->from && pos < s->from + s->size ) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/* slot to generate a new block into: an unused buffer, a new one if memory allows
+   or the least recently used block; called with self->lock held */
+static
+BlockCache_Slot* BlockCacheFile_Pick(BlockCacheFile* self, bool wait)
+{
+    while( true ) {
+        uint32_t i;
+        BlockCache_Slot* victim = NULL;
+        BlockCache_Slot* fresh = NULL;
+
+        for(i = 0; i < self->count; i++) {
+            BlockCache_Slot* s = &self->slot[i];
+            if( s->users > 0 ) {
+                continue;
+            }
+            if( s->buf == NULL ) {
+                if( fresh == NULL ) {
+                    fresh = s;
+                }
+            } else if( !s->valid ) {
+                return s;
+            } else if( victim == NULL || s->used < victim->used ) {
+                victim = s;
+            }
+        }
+        if( fresh != NULL && BlockCache_MemTake(self->block_sz, wait && self->buffers == 0) ) {
+            MALLOC(fresh->buf, self->block_sz);
+            if( fresh->buf != NULL ) {
+                self->buffers++;
+                return fresh;
+            }
+            BlockCache_MemGive(self->block_sz);
+        }
+        if( victim != NULL || !wait ) {
+            if( victim != NULL ) {
+                DEBUG_MSG(10, ("Evicting block %lu\n", victim->from));
+            }
+            return victim;
+        }
+        if( KConditionWait(self->idle, self->lock) != 0 ) {
+            return NULL;
+        }
+    }
+}
+
+/* slot with the block containing pos, locked, generated if needed;
+   without wait (read-ahead) NULL is returned when there is no slot to spare
+   or the file is being released */
+static
+rc_t BlockCacheFile_Get(BlockCacheFile* self, uint64_t pos, bool wait, BlockCache_Slot** slot)
+{
+    rc_t rc = 0;
+    BlockCache_Block blk;
+    BlockCache_Slot* s = NULL;
+
+    *slot = NULL;
+    if( (rc = KLockAcquire(self->lock)) != 0 ) {
+        return rc;
+    }
+    if( !wait && self->closing ) {
+        ReleaseComplain(KLockUnlock, self->lock);
+        return 0;
+    }
+    if( (s = BlockCacheFile_Find(self, pos)) == NULL ) {
+        ReleaseComplain(KLockUnlock, self->lock);
+        if( (rc = KLockAcquire(self->fill_lock)) == 0 ) {
+            rc = self->locate(self->data, pos, &blk);
+            ReleaseComplain(KLockUnlock, self->fill_lock);
+        }
+        if( rc != 0 || (rc = KLockAcquire(self->lock)) != 0 ) {
+            return rc;
+        }
+        /* could be generated by another reader meanwhile */
+        s = BlockCacheFile_Find(self, pos);
+    }
+    if( s != NULL ) {
+        s->users++;
+        s->used = ++self->tick;
+        ReleaseComplain(KLockUnlock, self->lock);
+        if( (rc = KLockAcquire(s->lock)) == 0 ) {
+            /* waits until generation of the block is complete */
+            *slot = s;
+            rc = s->rc;
+        }
+        return rc;
+    }
+    if( (s = BlockCacheFile_Pick(self, wait)) == NULL ) {
+        ReleaseComplain(KLockUnlock, self->lock);
+        return wait ? RC(rcExe, rcFile, rcReading, rcMemory, rcExhausted) : 0;
+    }
+    s->valid = true;
+    s->from = blk.from;
+    s->size = blk.size;
+    s->used = ++self->tick;
+    s->users = 1;
+    s->rc = 0;
+    /* not used by anybody: acquired without waiting */
+    rc = KLockAcquire(s->lock);
+    ReleaseComplain(KLockUnlock, self->lock);
+    if( rc == 0 ) {
+        size_t size = 0;
+        *slot = s;
+        DEBUG_MSG(10, ("Caching from %lu:%lu, %lu bytes\n", blk.from, blk.from + blk.size - 1, blk.size));
+        DEBUG_MSG(10, ("Caching spot %ld, %lu spots\n", blk.id, blk.id_qty));
+        if( (rc = KLockAcquire(self->fill_lock)) == 0 ) {
+            rc = self->fill(self->data, &blk, s->buf, self->block_sz, &size);
+            ReleaseComplain(KLockUnlock, self->fill_lock);
+        }
+        if( KLockAcquire(self->lock) == 0 ) {
+            if( rc == 0 ) {
+                s->size = size;
+            } else {
+                s->valid = false;
+            }
+            s->rc = rc;
+            ReleaseComplain(KLockUnlock, self->lock);
+        }
+    }
+    return rc;
+}
+
+static
+void BlockCacheFile_Put(BlockCacheFile* self, BlockCache_Slot* slot)
+{
+    ReleaseComplain(KLockUnlock, slot->lock);
+    if( KLockAcquire(self->lock) == 0 ) {
+        if( --slot->users == 0 ) {
+            KConditionBroadcast(self->idle);
+        }
+        ReleaseComplain(KLockUnlock, self->lock);
+    }
+}
+
+static
+bool BlockCache_Push(BlockCacheFile* file, uint64_t pos)
+{
+    bool pushed = false;
+    if( g_cache.threads > 0 && KLockAcquire(g_cache.lock) == 0 ) {
+        if( !g_cache.stop && g_cache.queued < BLOCK_CACHE_QUEUE ) {
+            BlockCache_Job* job;
+            MALLOC(job, sizeof(*job));
+            if( job != NULL ) {
+                job->next = NULL;
+                job->file = file;
+                job->pos = pos;
+                if( g_cache.tail != NULL ) {
+                    g_cache.tail->next = job;
+                } else {
+                    g_cache.head = job;
+                }
+                g_cache.tail = job;
+                g_cache.queued++;
+                KConditionSignal(g_cache.cond);
+                pushed = true;
+            }
+        }
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+    }
+    return pushed;
+}
+
+/* note access to block from..end: the next blocks are requested
+   when the block follows the one read before */
+static
+void BlockCacheFile_Access(BlockCacheFile* self, uint64_t from, uint64_t end)
+{
+    bool ahead = false;
+
+    if( g_cache.read_ahead == 0 || g_cache.threads == 0 || KLockAcquire(self->lock) != 0 ) {
+        return;
+    }
+    if( from != self->last_from ) {
+        self->sequential = from == self->next_from ? self->sequential + 1 : 0;
+        self->last_from = from;
+        self->next_from = end;
+        if( self->sequential > 0 && end < self->file_sz && self->jobs == 0 && !self->closing ) {
+            self->jobs++;
+            ahead = true;
+        }
+    }
+    ReleaseComplain(KLockUnlock, self->lock);
+
+    if( ahead && !BlockCache_Push(self, end) ) {
+        if( KLockAcquire(self->lock) == 0 ) {
+            if( --self->jobs == 0 ) {
+                KConditionBroadcast(self->idle);
+            }
+            ReleaseComplain(KLockUnlock, self->lock);
+        }
+    }
+}
+
+static
+void BlockCacheFile_ReadAhead(BlockCacheFile* self, uint64_t pos)
+{
+    uint32_t i;
+
+    for(i = 0; i < g_cache.read_ahead && pos < self->file_sz; i++) {
+        BlockCache_Slot* s = NULL;
+        rc_t rc = BlockCacheFile_Get(self, pos, false, &s);
+        if( s == NULL ) {
+            break;
+        }
+        DEBUG_MSG(10, ("Read ahead block %lu\n", s->from));
+        pos = s->from + s->size;
+        BlockCacheFile_Put(self, s);
+        if( rc != 0 ) {
+            break;
+        }
+    }
+    if( KLockAcquire(self->lock) == 0 ) {
+        if( --self->jobs == 0 ) {
+            KConditionBroadcast(self->idle);
+        }
+        ReleaseComplain(KLockUnlock, self->lock);
+    }
+}
+
+static
+rc_t CC BlockCache_Thread(const KThread* thread, void* data)
+{
+    rc_t rc = 0;
+
+    while( (rc = KLockAcquire(g_cache.lock)) == 0 ) {
+        BlockCache_Job* job = NULL;
+        while( !g_cache.stop && g_cache.head == NULL && rc == 0 ) {
+            rc = KConditionWait(g_cache.cond, g_cache.lock);
+        }
+        if( rc == 0 && !g_cache.stop ) {
+            job = g_cache.head;
+            g_cache.head = job->next;
+            if( g_cache.head == NULL ) {
+                g_cache.tail = NULL;
+            }
+            g_cache.queued--;
+        }
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+        if( job == NULL ) {
+            break;
+        }
+        BlockCacheFile_ReadAhead(job->file, job->pos);
+        FREE(job);
+    }
+    return rc;
+}
+
+void BlockCache_Configure(uint32_t slots, uint64_t mem_limit, uint32_t read_ahead)
+{
+    g_cache.slots = slots > 0 ? slots : 1;
+    g_cache.mem_limit = mem_limit;
+    /* keep a slot for the block being read */
+    g_cache.read_ahead = read_ahead < g_cache.slots ? read_ahead : g_cache.slots - 1;
+}
+
+rc_t BlockCache_Init(void)
+{
+    rc_t rc = 0;
+
+    if( (rc = KLockMake(&g_cache.lock)) == 0 && (rc = KConditionMake(&g_cache.cond)) == 0 ) {
+        g_cache.stop = false;
+        while( g_cache.read_ahead > 0 && g_cache.threads < BLOCK_CACHE_THREADS ) {
+            if( (rc = KThreadMake(&g_cache.thread[g_cache.threads], BlockCache_Thread, NULL)) != 0 ) {
+                LOGERR(klogErr, rc, "read-ahead thread");
+                break;
+            }
+            g_cache.threads++;
+        }
+    }
+    return rc;
+}
+
+void BlockCache_Fini(void)
+{
+    uint32_t i;
+
+    if( g_cache.lock == NULL ) {
+        return;
+    }
+    if( KLockAcquire(g_cache.lock) == 0 ) {
+        g_cache.stop = true;
+        KConditionBroadcast(g_cache.cond);
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+    }
+    for(i = 0; i < g_cache.threads; i++) {
+        KThreadWait(g_cache.thread[i], NULL);
+        ReleaseComplain(KThreadRelease, g_cache.thread[i]);
+    }
+    g_cache.threads = 0;
+    while( g_cache.head != NULL ) {
+        BlockCache_Job* job = g_cache.head;
+        g_cache.head = job->next;
+        FREE(job);
+    }
+    g_cache.tail = NULL;
+    g_cache.queued = 0;
+    ReleaseComplain(KConditionRelease, g_cache.cond);
+    ReleaseComplain(KLockRelease, g_cache.lock);
+    g_cache.cond = NULL;
+    g_cache.lock = NULL;
+}
+
+rc_t BlockCacheFile_Make(BlockCacheFile** self, uint64_t file_sz, size_t block_sz,
+                         BlockCache_Locate* locate, BlockCache_Fill* fill, void* data)
+{
+    rc_t rc = 0;
+    BlockCacheFile* obj = NULL;
+    uint32_t i, count = g_cache.slots;
+
+    CALLOC(obj, 1, sizeof(*obj) + (count - 1) * sizeof(obj->slot[0]));
+    if( obj == NULL ) {
+        rc = RC(rcExe, rcFile, rcConstructing, rcMemory, rcExhausted);
+    } else {
+        obj->file_sz = file_sz;
+        obj->block_sz = block_sz;
+        obj->locate = locate;
+        obj->fill = fill;
+        obj->data = data;
+        obj->last_from = ~0; /* beyond file end */
+        if( (rc = KLockMake(&obj->lock)) == 0 &&
+            (rc = KLockMake(&obj->fill_lock)) == 0 &&
+            (rc = KConditionMake(&obj->idle)) == 0 ) {
+            for(i = 0; rc == 0 && i < count; i++) {
+                if( (rc = KLockMake(&obj->slot[i].lock)) == 0 ) {
+                    obj->count++;
+                }
+            }
+        }
+        if( rc == 0 ) {
+            *self = obj;
+        } else {
+            BlockCacheFile_Release(obj);
+        }
+    }
+    return rc;
+}
+
+rc_t BlockCacheFile_Read(BlockCacheFile* self, uint64_t pos, void* buffer, size_t size, size_t* num_read)
+{
+    rc_t rc = 0;
+
+    *num_read = 0;
+    while( rc == 0 && *num_read < size && pos < self->file_sz ) {
+        BlockCache_Slot* s = NULL;
+        uint64_t from = 0, end = 0;
+
+        rc = BlockCacheFile_Get(self, pos, true, &s);
+        if( s == NULL ) {
+            break;
+        }
+        if( rc == 0 ) {
+            uint64_t off = pos - s->from;
+            if( off >= s->size ) {
+                /* generated block is shorter than in index */
+                rc = RC(rcExe, rcFile, rcReading, rcData, rcInconsistent);
+            } else {
+                size_t q = (s->size - off) > (size - *num_read) ? (size - *num_read) : (s->size - off);
+                DEBUG_MSG(10, ("Copying from %lu %u bytes\n", off, q));
+                memmove(&((char*)buffer)[*num_read], &s->buf[off], q);
+                *num_read = *num_read + q;
+                pos += q;
+            }
+            from = s->from;
+            end = s->from + s->size;
+        }
+        BlockCacheFile_Put(self, s);
+        if( rc == 0 ) {
+            BlockCacheFile_Access(self, from, end);
+        }
+    }
+    return rc;
+}
+
+void BlockCacheFile_Release(BlockCacheFile* self)
+{
+    uint32_t i, removed = 0;
+
+    if( self == NULL ) {
+        return;
+    }
+    /* drop queued read-ahead and wait for the running one */
+    if( g_cache.lock != NULL && KLockAcquire(g_cache.lock) == 0 ) {
+        BlockCache_Job** p = &g_cache.head;
+        g_cache.tail = NULL;
+        while( *p != NULL ) {
+            BlockCache_Job* job = *p;
+            if( job->file == self ) {
+                *p = job->next;
+                g_cache.queued--;
+                removed++;
+                FREE(job);
+            } else {
+                g_cache.tail = job;
+                p = &job->next;
+            }
+        }
+        ReleaseComplain(KLockUnlock, g_cache.lock);
+    }
+    if( self->lock != NULL && KLockAcquire(self->lock) == 0 ) {
+        self->closing = true;
+        self->jobs -= removed;
+        while( self->jobs > 0 && KConditionWait(self->idle, self->lock) == 0 ) {
+        }
+        ReleaseComplain(KLockUnlock, self->lock);
+    }
+    for(i = 0; i < self->count; i++) {
+        if( self->slot[i].buf != NULL ) {
+            FREE(self->slot[i].buf);
+            BlockCache_MemGive(self->block_sz);
+        }
+        ReleaseComplain(KLockRelease, self->slot[i].lock);
+    }
+    ReleaseComplain(KConditionRelease, self->idle);
+    ReleaseComplain(KLockRelease, self->fill_lock);
+    ReleaseComplain(KLockRelease, self->lock);
+    FREE(self);
+}
@@ -0,0 +1,73 @@
+/*===========================================================================
+ *
+ *                            Public DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+#ifndef _h_sra_fuse_block_cache_
+#define _h_sra_fuse_block_cache_
+
+#include <klib/rc.h>
+
+/*
+ * Cache of generated file content (fastq text, ...)
+ *  every open file keeps up to N blocks in LRU order,
+ *  sequential readers get next blocks generated ahead by worker threads,
+ *  memory of all blocks of all files is limited
+ */
+typedef struct BlockCacheFile BlockCacheFile;
+
+/* a block of file content as found in the file index */
+typedef struct BlockCache_Block {
+    uint64_t from;   /* file offset of the block */
+    uint64_t size;   /* block size */
+    int64_t id;      /* first row of the block */
+    uint64_t id_qty; /* number of rows in the block */
+} BlockCache_Block;
+
+/* find the block containing pos */
+typedef rc_t (BlockCache_Locate)(void* data, uint64_t pos, BlockCache_Block* block);
+
+/* generate content of the block into buf, *size is set to bytes generated;
+   locate and fill of the same file are never called concurrently */
+typedef rc_t (BlockCache_Fill)(void* data, const BlockCache_Block* block, char* buf, size_t buf_sz, size_t* size);
+
+/*
+ * Set cache parameters; must be called before BlockCache_Init
+ *  slots: blocks kept per open file
+ *  mem_limit: bytes of all blocks of all files, 0 - no limit
+ *  read_ahead: blocks generated ahead of a sequential reader, 0 - none
+ */
+void BlockCache_Configure(uint32_t slots, uint64_t mem_limit, uint32_t read_ahead);
+
+/* start/stop read-ahead threads */
+rc_t BlockCache_Init(void);
+void BlockCache_Fini(void);
+
+rc_t BlockCacheFile_Make(BlockCacheFile** self, uint64_t file_sz, size_t block_sz,
+                         BlockCache_Locate* locate, BlockCache_Fill* fill, void* data);
+
+rc_t BlockCacheFile_Read(BlockCacheFile* self, uint64_t pos, void* buffer, size_t size, size_t* num_read);
+
+/* waits for read-ahead of the file to stop */
+void BlockCacheFile_Release(BlockCacheFile* self);
+
+#endif /* _h_sra_fuse_block_cache_ */
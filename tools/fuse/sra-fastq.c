@@ -24,7 +24,6 @@
  */
 #include <klib/rc.h>
 #include <kfs/file.h>
-#include <kproc/lock.h>
 #include <kdb/table.h>
 #include <kdb/index.h>
 
@@ -39,6 +38,7 @@
 #include "sra-list.h"
 #include "sra-fastq.h"
 #include "zlib-simple.h"
+#include "block-cache.h"
 
 typedef struct SRAFastqFile SRAFastqFile;
 #define KFILE_IMPL SRAFastqFile
@@ -48,31 +48,25 @@ struct SRAFastqFile {
     KFile dad;
     uint32_t buffer_sz;
     uint64_t file_sz;
-    char* gzipped; /* serves as flag and a buffer */
-    KLock* lock;
+    char* gzipped; /* serves as flag and a buffer for text to be deflated */
     const SRATable* stbl;
     const KTable* ktbl;
     const KIndex* kidx;
     const FastqReader* reader;
-    /* current buf content */
-    uint64_t from;
-    uint64_t size;
-    char* buf;
+    BlockCacheFile* cache;
 };
 
 static
 rc_t SRAFastqFile_Destroy(SRAFastqFile *self)
 {
-    if( KLockAcquire(self->lock) == 0 ) {
-        ReleaseComplain(FastqReaderWhack, self->reader);
-        ReleaseComplain(KIndexRelease, self->kidx);
-        ReleaseComplain(KTableRelease, self->ktbl);
-        ReleaseComplain(SRATableRelease, self->stbl);
-        FREE(self->buf < self->gzipped ? self->buf : self->gzipped);
-        ReleaseComplain(KLockUnlock, self->lock);
-        ReleaseComplain(KLockRelease, self->lock);
-        FREE(self);
-    }
+    /* stops read-ahead which uses the reader */
+    BlockCacheFile_Release(self->cache);
+    ReleaseComplain(FastqReaderWhack, self->reader);
+    ReleaseComplain(KIndexRelease, self->kidx);
+    ReleaseComplain(KTableRelease, self->ktbl);
+    ReleaseComplain(SRATableRelease, self->stbl);
+    FREE(self->gzipped);
+    FREE(self);
     return 0;
 }
 
@@ -109,63 +103,56 @@ rc_t SRAFastqFile_SetSize(SRAFastqFile *self, uint64_t size)
 }
 
 static
-rc_t SRAFastqFile_Read(const SRAFastqFile* self, uint64_t pos, void *buffer, size_t size, size_t *num_read)
+rc_t SRAFastqFile_Locate(void* data, uint64_t pos, BlockCache_Block* block)
+{
+    const SRAFastqFile* self = data;
+    return KIndexFindU64(self->kidx, pos, &block->from, &block->size, &block->id, &block->id_qty);
+}
+
+static
+rc_t SRAFastqFile_Fill(void* data, const BlockCache_Block* block, char* buf, size_t buf_sz, size_t* size)
 {
     rc_t rc = 0;
+    const SRAFastqFile* self = data;
+    size_t inbuf = 0, w = 0;
+    char* b = self->gzipped != NULL ? self->gzipped : buf;
+    uint64_t left = self->buffer_sz;
+    uint64_t id_qty = block->id_qty;
 
-    if( pos >= self->file_sz ) {
-        *num_read = 0;
-    } else if( (rc = KLockAcquire(self->lock)) == 0 ) {
+    if( (rc = FastqReaderSeekSpot(self->reader, block->id)) == 0 ) {
         do {
-            if( pos < self->from || pos >= (self->from + self->size) ) {
-                int64_t id = 0;
-                uint64_t id_qty = 0;
-                DEBUG_MSG(10, ("Caching for pos %lu %lu bytes\n", pos, size - *num_read));
-                if( (rc = KIndexFindU64(self->kidx, pos, &((SRAFastqFile*)self)->from, &((SRAFastqFile*)self)->size, &id, &id_qty)) == 0 ) {
-                    DEBUG_MSG(10, ("Caching from %lu:%lu, %lu bytes\n", self->from, self->from + self->size - 1, self->size));
-                    DEBUG_MSG(10, ("Caching spot %ld, %lu spots\n", id, id_qty));
-                    if( (rc = FastqReaderSeekSpot(self->reader, id)) == 0 ) {
-                        size_t inbuf = 0, w = 0;
-                        char* b = self->buf;
-                        uint64_t left = self->buffer_sz;
-                        do {
-                            if( (rc = FastqReader_GetCurrentSpotSplitData(self->reader, b, left, &w)) != 0 ) {
-                                break;
-                            }
-                            b += w; left -= w; inbuf += w; --id_qty;
-                        } while( id_qty > 0 && (rc = FastqReaderNextSpot(self->reader)) == 0);
-                        if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
-                            DEBUG_MSG(10, ("No more rows\n"));
-                            rc = 0;
-                        }
-                        DEBUG_MSG(8, ("Cached %u bytes\n", inbuf));
-                        if( self->gzipped != NULL ) {
-                            size_t compressed = 0;
-                            if( (rc = ZLib_DeflateBlock(self->buf, inbuf, self->gzipped, self->buffer_sz, &compressed)) == 0 ) {
-                                char* b = self->buf;
-                                ((SRAFastqFile*)self)->buf = self->gzipped;
-                                ((SRAFastqFile*)self)->gzipped = b;
-                                ((SRAFastqFile*)self)->size = compressed;
-                                DEBUG_MSG(10, ("gzipped %lu bytes\n", self->size));
-                            }
-                        }
-                    }
-                }
+            if( (rc = FastqReader_GetCurrentSpotSplitData(self->reader, b, left, &w)) != 0 ) {
+                break;
             }
-            if( rc == 0 ) {
-                off_t from = pos - self->from;
-                size_t q = (self->size - from) > (size - *num_read) ? (size - *num_read) : (self->size - from);
-                DEBUG_MSG(10, ("Copying from %lu %u bytes\n", from, q));
-                memmove(&((char*)buffer)[*num_read], &self->buf[from], q);
-                *num_read = *num_read + q;
-                pos += q;
+            b += w; left -= w; inbuf += w; --id_qty;
+        } while( id_qty > 0 && (rc = FastqReaderNextSpot(self->reader)) == 0);
+        if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
+            DEBUG_MSG(10, ("No more rows\n"));
+            rc = 0;
+        }
+        DEBUG_MSG(8, ("Cached %u bytes\n", inbuf));
+        if( rc == 0 && self->gzipped != NULL ) {
+            size_t compressed = 0;
+            if( (rc = ZLib_DeflateBlock(self->gzipped, inbuf, buf, buf_sz, &compressed)) == 0 ) {
+                inbuf = compressed;
+                DEBUG_MSG(10, ("gzipped %lu bytes\n", inbuf));
             }
-        } while( rc == 0 && *num_read < size && pos < self->file_sz );
-        ReleaseComplain(KLockUnlock, self->lock);
+        }
     }
+    *size = inbuf;
     return rc;
 }
 
+static
+rc_t SRAFastqFile_Read(const SRAFastqFile* self, uint64_t pos, void *buffer, size_t size, size_t *num_read)
+{
+    if( pos >= self->file_sz ) {
+        *num_read = 0;
+        return 0;
+    }
+    return BlockCacheFile_Read(self->cache, pos, buffer, size, num_read);
+}
+
 static
 rc_t SRAFastqFile_Write(SRAFastqFile *self, uint64_t pos, const void *buffer, size_t size, size_t *num_writ)
 {
@@ -203,30 +190,30 @@ rc_t SRAFastqFile_Open(const KFile** cself, const SRAListNode* sra, const FileOp
                 {
                     if ( ( rc = KTableOpenIndexRead( self->ktbl, &self->kidx, opt->index ) ) == 0 )
                     {
-                        if ( ( rc = KLockMake( &self->lock ) ) == 0 )
+                        if ( opt->f.fastq.gzip )
                         {
-                            MALLOC( self->buf, opt->buffer_sz * ( opt->f.fastq.gzip ? 2 : 1 ) );
-                            if ( self->buf == NULL )
+                            MALLOC( self->gzipped, opt->buffer_sz );
+                            if ( self->gzipped == NULL )
                             {
                                 rc = RC( rcExe, rcFile, rcOpening, rcMemory, rcExhausted );
                             }
-                            else
-                            {
-                                self->file_sz = opt->file_sz;
-                                self->buffer_sz = opt->buffer_sz;
-                                if ( opt->f.fastq.gzip )
-                                {
-                                    self->gzipped = &self->buf[ opt->buffer_sz ];
-                                }
-                                self->from = ~0; /* reset position beyond file end */
-                                rc = FastqReaderMake( &self->reader, self->stbl,
-                                                      opt->f.fastq.accession, opt->f.fastq.colorSpace,
-                                                      opt->f.fastq.origFormat, false, opt->f.fastq.printLabel,
-                                                      opt->f.fastq.printReadId, !opt->f.fastq.clipQuality, false,
-                                                      opt->f.fastq.minReadLen, opt->f.fastq.qualityOffset,
-                                                      opt->f.fastq.colorSpaceKey,
-                                                      opt->f.fastq.minSpotId, opt->f.fastq.maxSpotId );
-                            }
+                        }
+                        if ( rc == 0 )
+                        {
+                            self->file_sz = opt->file_sz;
+                            self->buffer_sz = opt->buffer_sz;
+                            rc = FastqReaderMake( &self->reader, self->stbl,
+                                                  opt->f.fastq.accession, opt->f.fastq.colorSpace,
+                                                  opt->f.fastq.origFormat, false, opt->f.fastq.printLabel,
+                                                  opt->f.fastq.printReadId, !opt->f.fastq.clipQuality, false,
+                                                  opt->f.fastq.minReadLen, opt->f.fastq.qualityOffset,
+                                                  opt->f.fastq.colorSpaceKey,
+                                                  opt->f.fastq.minSpotId, opt->f.fastq.maxSpotId );
+                        }
+                        if ( rc == 0 )
+                        {
+                            rc = BlockCacheFile_Make( &self->cache, self->file_sz, self->buffer_sz,
+                                                      SRAFastqFile_Locate, SRAFastqFile_Fill, self );
                         }
                     }
                 }
@@ -35,6 +35,7 @@
 #include "node.h"
 #include "accessor.h"
 #include "sra-list.h"
+#include "block-cache.h"
 
 typedef struct SRequest_struct {
     const FSNode* node;
@@ -122,6 +123,10 @@ void SRA_FUSER_Init(void)
     if( (rc = LogFile_Init(NULL, 0, true, NULL)) != 0 ) {
         LOGERR(klogErr, rc, "log file");
     }
+    /* threads started before FUSE goes to background would be lost */
+    if( (rc = BlockCache_Init()) != 0 ) {
+        LOGERR(klogErr, rc, "block cache");
+    }
     SRAList_Init(); /* this preceeeds XML_Init */
     XML_Init();     /* or SRAList may become corrupt */
     LOGMSG(klogInfo, "Started");
@@ -131,6 +136,7 @@ void SRA_FUSER_Fini(void)
 {
     SRAList_Fini();
     XML_Fini();
+    BlockCache_Fini();
     LOGMSG(klogInfo, "Stopped");
     LogFile_Fini();
     FREE(g_work_dir);
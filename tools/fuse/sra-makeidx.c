@@ -35,6 +35,9 @@
 #include <kdb/table.h>
 #include <kdb/meta.h>
 #include <kdb/index.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include <sra/wsradb.h>
 #include <sra/sradb-priv.h>
@@ -53,13 +56,18 @@ uint32_t g_file_block_sz = 32 * 1024;
 const char* g_accession = NULL;
 bool g_dump = false;
 bool g_ungzip = false;
+uint32_t g_threads = 4;
+
+/* spots rendered by a worker at a time */
+#define IDX_CHUNK_SPOTS 4096
+#define IDX_MAX_THREADS 64
 
 typedef struct SIndexObj_struct {
     KMDataNode* meta;
     const char* const file;
     const char* const format;
     const char* const index;
-    rc_t (*func)(const SRATable* sratbl, struct SIndexObj_struct* obj, char* buffer, const size_t buffer_sz);
+    rc_t (*func)(const SRATable* sratbl, struct SIndexObj_struct* obj);
     uint64_t file_size;
     uint32_t buffer_sz;
     uint64_t minSpotId;
@@ -171,198 +179,716 @@ rc_t WriteFileMeta(SIndexObj* obj)
     return rc;
 }
 
+/* spot sources: a reader per worker thread, positioned with seek */
+typedef struct SIndexSource_struct {
+    const SRATable* sratbl;
+    const SIndexObj* obj;
+    bool sff;
+    uint8_t colorSpace;
+    char colorSpaceKey;
+    uint8_t origFormat;
+    uint8_t printLabel;
+    uint8_t printReadId;
+    uint8_t clipQuality;
+    uint32_t minReadLen;
+    uint16_t qualityOffset;
+} SIndexSource;
+
+static
+rc_t SIndexSource_Make(const SIndexSource* self, const void** reader)
+{
+    if( self->sff ) {
+        return SFFReaderMake((const SFFReader**)reader, self->sratbl, g_accession, self->obj->minSpotId, self->obj->maxSpotId);
+    }
+    return FastqReaderMake((const FastqReader**)reader, self->sratbl, g_accession,
+                           self->colorSpace, self->origFormat, false, self->printLabel, self->printReadId,
+                           !self->clipQuality, self->minReadLen, self->qualityOffset, self->colorSpaceKey,
+                           self->obj->minSpotId, self->obj->maxSpotId);
+}
+
+static
+void SIndexSource_Whack(const SIndexSource* self, const void* reader)
+{
+    if( self->sff ) {
+        SFFReaderWhack(reader);
+    } else {
+        FastqReaderWhack(reader);
+    }
+}
+
+static
+rc_t SIndexSource_Seek(const SIndexSource* self, const void* reader, spotid_t spot)
+{
+    return self->sff ? SFFReaderSeekSpot(reader, spot) : FastqReaderSeekSpot(reader, spot);
+}
+
+static
+rc_t SIndexSource_Next(const SIndexSource* self, const void* reader)
+{
+    return self->sff ? SFFReaderNextSpot(reader) : FastqReaderNextSpot(reader);
+}
+
 static
-rc_t SFF_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_t buffer_sz)
+rc_t SIndexSource_Current(const SIndexSource* self, const void* reader, spotid_t* spot)
+{
+    return self->sff ? SFFReaderCurrentSpot(reader, spot) : FastqReaderCurrentSpot(reader, spot);
+}
+
+/* renders current spot, SFF header goes in front of spot 1 */
+static
+rc_t SIndexSource_Data(const SIndexSource* self, const void* reader, spotid_t spot, char* buffer, size_t buffer_sz, size_t* written)
 {
     rc_t rc = 0;
-    const SFFReader* reader = NULL;
+    size_t hd_sz = 0;
 
-    if( (rc = SFFReaderMake(&reader, sratbl, g_accession, obj->minSpotId, obj->maxSpotId)) != 0 ) {
+    *written = 0;
+    if( !self->sff ) {
+        return FastqReader_GetCurrentSpotSplitData(reader, buffer, buffer_sz, written);
+    }
+    if( spot == 1 && (rc = SFFReaderHeader(reader, 0, buffer, buffer_sz, &hd_sz)) != 0 ) {
         return rc;
-    } else {
-        size_t written = 0;
-        uint32_t blk = 0;
-        SIndexNode* inode = NULL;
+    }
+    if( (rc = SFFReader_GetCurrentSpotData(reader, &buffer[hd_sz], buffer_sz - hd_sz, written)) == 0 ) {
+        *written += hd_sz;
+    }
+    return rc;
+}
 
-        while( rc == 0 ) {
-            rc = SFFReader_GetNextSpotData(reader, buffer, buffer_sz, &written);
-            if( blk >= g_file_block_sz || (GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted) ) {
-                inode->key_size = blk;
-                SLListPushTail(&obj->li, &inode->n);
-                DEBUG_MSG(5, ("SFF index closed spots %lu, offset %lu, block size %lu\n", inode->id_qty, inode->key, inode->key_size));
-                inode = NULL;
-                if( blk > obj->buffer_sz ) {
-                    obj->buffer_sz = blk;
-                }
-                blk = 0;
+/* a range of spots rendered by a worker */
+typedef struct SIndexChunk_struct {
+    spotid_t from;
+    spotid_t to;
+    uint32_t qty;
+    spotid_t id[IDX_CHUNK_SPOTS];
+    uint64_t end[IDX_CHUNK_SPOTS]; /* end of every spot in data */
+    char* data;
+    size_t data_max;
+    spotid_t spot; /* failed spot */
+    rc_t rc;
+    bool ready;
+} SIndexChunk;
+
+/* deflate of a block guessed ahead of the stitcher */
+typedef struct SIndexTrial_struct {
+    uint64_t start; /* stream number of the first spot */
+    uint64_t qty;
+    char* raw;
+    size_t raw_sz;
+    size_t raw_max;
+    char* z;
+    size_t z_sz;
+    rc_t rc;
+    enum {
+        eTrialFree = 0,
+        eTrialQueued,
+        eTrialRunning,
+        eTrialDone
+    } state;
+} SIndexTrial;
+
+typedef struct SIndexBuild_struct {
+    const SIndexSource* src;
+    SIndexObj* obj;
+    bool gzip;
+    KLock* lock;
+    KCondition* cond; /* chunk rendered or consumed, trial queued or deflated */
+    bool stop;
+
+    spotid_t min_spot;
+    uint64_t chunks;
+    uint64_t next;     /* chunk to render */
+    uint64_t consumed; /* chunks taken by stitcher */
+    uint32_t window;   /* chunks in flight */
+    SIndexChunk* chunk;
+
+    SIndexTrial trial[IDX_MAX_THREADS];
+    uint32_t trials;
+    uint64_t block_start; /* stream number of the first spot in current block */
+    size_t z_max;
+    char* zbuf;
+
+    /* spots taken from chunks and not indexed yet, first spot in window is b->first */
+    char* buf;
+    size_t buf_sz;
+    size_t buf_max;
+    uint64_t* end;
+    spotid_t* id;
+    uint64_t first;
+    uint64_t qty;
+    uint64_t max;
+    uint64_t base; /* stream number of id[0] */
+    spotid_t spot; /* last spot seen, for error reporting */
+    bool eof;
+} SIndexBuild;
+
+static
+rc_t SIndexBuild_Render(SIndexBuild* self, SIndexChunk* c, const void* reader, char* buffer, size_t buffer_sz)
+{
+    rc_t rc = 0;
+    size_t data_sz = 0;
+
+    c->qty = 0;
+    c->spot = c->from;
+    if( (rc = SIndexSource_Seek(self->src, reader, c->from)) == 0 ) {
+        do {
+            size_t written = 0;
+            if( (rc = SIndexSource_Current(self->src, reader, &c->spot)) != 0 || c->spot > c->to ) {
+                break;
             }
-            if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
-                rc = 0;
+            if( (rc = SIndexSource_Data(self->src, reader, c->spot, buffer, buffer_sz, &written)) != 0 ) {
                 break;
             }
-            if( inode == NULL ) {
-                spotid_t spotid = 0;
-                if( (rc = SFFReaderCurrentSpot(reader, &spotid)) != 0 ) {
-                    break;
-                }
-                inode = malloc(sizeof(SIndexNode));
-                if( inode == NULL ) {
+            if( data_sz + written > c->data_max ) {
+                size_t sz = c->data_max * 2 > data_sz + written ? c->data_max * 2 : data_sz + written;
+                char* d = realloc(c->data, sz);
+                if( d == NULL ) {
                     rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
                     break;
                 }
-                inode->key = obj->file_size;
-                inode->key_size = 0;
-                inode->id = spotid;
-                inode->id_qty = 0;
-                DEBUG_MSG(5, ("SFF index opened spot %ld, offset %lu\n", inode->id, inode->key));
-                if( spotid == 1 ) {
-                    char hd[10240];
-                    size_t hd_sz = 0;
-                    if( (rc = SFFReaderHeader(reader, 0, hd, sizeof(hd), &hd_sz)) == 0 ) {
-                        obj->file_size += hd_sz;
-                        blk += hd_sz;
-                        MD5StateAppend(&obj->md5, hd, hd_sz);
-                        if( g_dump ) {
-                            fwrite(hd, hd_sz, 1, stderr);
-                        }
-                    }
+                c->data = d;
+                c->data_max = sz;
+            }
+            memmove(&c->data[data_sz], buffer, written);
+            data_sz += written;
+            c->id[c->qty] = c->spot;
+            c->end[c->qty++] = data_sz;
+        } while( (rc = SIndexSource_Next(self->src, reader)) == 0 );
+    }
+    if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
+        rc = 0;
+    }
+    DEBUG_MSG(8, ("%s chunk %ld-%ld rendered %u spots, %lu bytes\n", self->obj->index, c->from, c->to, c->qty, data_sz));
+    return rc;
+}
+
+static
+rc_t CC SIndexBuild_Thread(const KThread* thread, void* data)
+{
+    rc_t rc = 0;
+    SIndexBuild* self = data;
+    const void* reader = NULL;
+    size_t buffer_sz = g_file_block_sz * 100;
+    char* buffer = NULL;
+
+    while( (rc = KLockAcquire(self->lock)) == 0 ) {
+        SIndexTrial* t = NULL;
+        SIndexChunk* c = NULL;
+        uint32_t i;
+
+        while( !self->stop && rc == 0 ) {
+            /* deflates hold up the stitcher, take them first */
+            for(i = 0; t == NULL && i < self->trials; i++) {
+                if( self->trial[i].state == eTrialQueued ) {
+                    t = &self->trial[i];
+                    /* stitcher went past it */
+                    t->state = t->start < self->block_start ? eTrialFree : eTrialRunning;
+                    t = t->state == eTrialRunning ? t : NULL;
                 }
             }
-            obj->file_size += written;
-            blk += written;
-            inode->id_qty++;
-            MD5StateAppend(&obj->md5, buffer, written);
-            if( g_dump ) {
-                fwrite(buffer, written, 1, stderr);
+            if( t != NULL ) {
+                break;
+            }
+            if( self->next < self->chunks && self->next < self->consumed + self->window ) {
+                c = &self->chunk[self->next % self->window];
+                c->from = self->min_spot + self->next * IDX_CHUNK_SPOTS;
+                c->to = c->from + IDX_CHUNK_SPOTS - 1;
+                self->next++;
+                break;
+            }
+            if( self->next >= self->chunks && !self->gzip ) {
+                break;
+            }
+            rc = KConditionWait(self->cond, self->lock);
+        }
+        KLockUnlock(self->lock);
+        if( t != NULL ) {
+            rc_t r = ZLib_DeflateBlock(t->raw, t->raw_sz, t->z, self->z_max, &t->z_sz);
+            if( (rc = KLockAcquire(self->lock)) == 0 ) {
+                t->rc = r;
+                t->state = eTrialDone;
+                KConditionBroadcast(self->cond);
+                KLockUnlock(self->lock);
+            }
+        } else if( c != NULL ) {
+            rc_t r = 0;
+            if( buffer == NULL && (buffer = malloc(buffer_sz)) == NULL ) {
+                r = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+            }
+            if( r == 0 && reader == NULL ) {
+                r = SIndexSource_Make(self->src, &reader);
             }
+            if( r == 0 ) {
+                r = SIndexBuild_Render(self, c, reader, buffer, buffer_sz);
+            }
+            if( (rc = KLockAcquire(self->lock)) == 0 ) {
+                c->rc = r;
+                c->ready = true;
+                KConditionBroadcast(self->cond);
+                KLockUnlock(self->lock);
+            }
+        } else {
+            break;
         }
-        rc = rc ? rc : Quitting();
         if( rc != 0 ) {
-            spotid_t spot = 0;
-            SFFReaderCurrentSpot(reader, &spot);
-            PLOGERR(klogErr, (klogErr, rc, "spot $(s)", PLOG_U32(s), spot));
+            break;
         }
     }
-    SFFReaderWhack(reader);
+    if( reader != NULL ) {
+        SIndexSource_Whack(self->src, reader);
+    }
+    free(buffer);
     return rc;
 }
 
 static
-rc_t SFFGzip_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_t buffer_sz)
+uint64_t SIndexBuild_Off(const SIndexBuild* self, uint64_t i)
+{
+    return i == 0 ? 0 : self->end[i - 1];
+}
+
+/* makes sure window holds at least qty spots unless stream is over */
+static
+rc_t SIndexBuild_Fill(SIndexBuild* self, uint64_t qty)
 {
     rc_t rc = 0;
-    uint16_t zlib_ver = ZLIB_VERNUM;
-    const SFFReader* reader = NULL;
 
-    if( (rc = SFFReaderMake(&reader, sratbl, g_accession, obj->minSpotId, obj->maxSpotId)) != 0 ) {
+    while( rc == 0 && !self->eof && self->qty - self->first < qty ) {
+        SIndexChunk* c = &self->chunk[self->consumed % self->window];
+        uint64_t shift = SIndexBuild_Off(self, self->first), i;
+        size_t sz;
+
+        if( self->consumed >= self->chunks ) {
+            self->eof = true;
+            break;
+        }
+        if( (rc = Quitting()) != 0 || (rc = KLockAcquire(self->lock)) != 0 ) {
+            break;
+        }
+        while( rc == 0 && !c->ready ) {
+            rc = KConditionWait(self->cond, self->lock);
+        }
+        KLockUnlock(self->lock);
+        if( rc == 0 && (rc = c->rc) != 0 ) {
+            self->spot = c->spot;
+        }
+        if( rc != 0 ) {
+            break;
+        }
+        /* drop indexed spots */
+        self->buf_sz -= shift;
+        memmove(self->buf, &self->buf[shift], self->buf_sz);
+        self->qty -= self->first;
+        for(i = 0; i < self->qty; i++) {
+            self->end[i] = self->end[i + self->first] - shift;
+            self->id[i] = self->id[i + self->first];
+        }
+        self->base += self->first;
+        self->first = 0;
+
+        sz = c->qty > 0 ? c->end[c->qty - 1] : 0;
+        if( self->buf_sz + sz > self->buf_max ) {
+            char* b = realloc(self->buf, self->buf_sz + sz);
+            if( b == NULL ) {
+                rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+                break;
+            }
+            self->buf = b;
+            self->buf_max = self->buf_sz + sz;
+        }
+        if( self->qty + c->qty > self->max ) {
+            uint64_t* e = realloc(self->end, (self->qty + c->qty) * sizeof(*e));
+            spotid_t* d = e == NULL ? NULL : realloc(self->id, (self->qty + c->qty) * sizeof(*d));
+            if( e != NULL ) {
+                self->end = e;
+            }
+            if( d == NULL ) {
+                rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+                break;
+            }
+            self->id = d;
+            self->max = self->qty + c->qty;
+        }
+        memmove(&self->buf[self->buf_sz], c->data, sz);
+        for(i = 0; i < c->qty; i++) {
+            self->end[self->qty] = self->buf_sz + c->end[i];
+            self->id[self->qty++] = c->id[i];
+        }
+        self->buf_sz += sz;
+
+        if( (rc = KLockAcquire(self->lock)) == 0 ) {
+            c->ready = false;
+            self->consumed++;
+            KConditionBroadcast(self->cond);
+            KLockUnlock(self->lock);
+        }
+    }
+    return rc;
+}
+
+/* guess that qty spots make current block and hand first trial of the next one to workers */
+static
+rc_t SIndexBuild_Speculate(SIndexBuild* self, uint64_t qty)
+{
+    rc_t rc = 0;
+    uint64_t next_qty = (uint64_t)(qty * 0.95) + 1, start = self->base + self->first + qty, i;
+    SIndexTrial* t = NULL;
+
+    if( (rc = SIndexBuild_Fill(self, qty + next_qty)) != 0 || self->qty - self->first < qty + next_qty ) {
         return rc;
-    } else {
-        size_t written = 0;
-        uint32_t blk = 0, spots_per_block = 0, proj_id_qty = 0;
-        SIndexNode* inode = NULL;
-        size_t z_blk = 0;
-        size_t spots_buf_sz = g_file_block_sz * 100;
-        size_t zbuf_sz = spots_buf_sz + 100;
-
-        char* zbuf = malloc(zbuf_sz);
-        char* spots_buf = malloc(spots_buf_sz);
+    }
+    if( (rc = KLockAcquire(self->lock)) != 0 ) {
+        return rc;
+    }
+    for(i = 0; i < self->trials; i++) {
+        SIndexTrial* x = &self->trial[i];
+        if( x->state != eTrialFree && x->start == start && x->qty == next_qty ) {
+            t = NULL;
+            break;
+        }
+        if( t == NULL && (x->state == eTrialFree ||
+            (x->state == eTrialDone && (x->start < self->block_start || (x->start == self->block_start && x->qty < qty)))) ) {
+            t = x;
+        }
+    }
+    KLockUnlock(self->lock);
+    if( t != NULL ) {
+        uint64_t from = SIndexBuild_Off(self, self->first + qty);
+        size_t sz = SIndexBuild_Off(self, self->first + qty + next_qty) - from;
+
+        if( t->z == NULL && (t->z = malloc(self->z_max)) == NULL ) {
+            return rc;
+        }
+        if( sz > t->raw_max ) {
+            char* r = realloc(t->raw, sz);
+            if( r == NULL ) {
+                return rc;
+            }
+            t->raw = r;
+            t->raw_max = sz;
+        }
+        memmove(t->raw, &self->buf[from], sz);
+        t->raw_sz = sz;
+        t->start = start;
+        t->qty = next_qty;
+        if( (rc = KLockAcquire(self->lock)) == 0 ) {
+            t->state = eTrialQueued;
+            KConditionBroadcast(self->cond);
+            KLockUnlock(self->lock);
+        }
+    }
+    return rc;
+}
+
+/* deflates qty spots from the start of current block into zbuf */
+static
+rc_t SIndexBuild_Deflate(SIndexBuild* self, uint64_t qty, size_t blk, size_t* z_blk)
+{
+    rc_t rc = 0;
+    SIndexTrial* t = NULL;
+    uint32_t i;
+
+    if( (rc = KLockAcquire(self->lock)) != 0 ) {
+        return rc;
+    }
+    for(i = 0; i < self->trials; i++) {
+        if( self->trial[i].state != eTrialFree && self->trial[i].start == self->block_start && self->trial[i].qty == qty ) {
+            t = &self->trial[i];
+            break;
+        }
+    }
+    KLockUnlock(self->lock);
+    if( (rc = SIndexBuild_Speculate(self, qty)) != 0 ) {
+        return rc;
+    }
+    if( t == NULL ) {
+        const char* raw = &self->buf[SIndexBuild_Off(self, self->first)];
+        return ZLib_DeflateBlock(raw, blk, self->zbuf, self->z_max, z_blk);
+    }
+    if( (rc = KLockAcquire(self->lock)) == 0 ) {
+        while( rc == 0 && t->state != eTrialDone ) {
+            rc = KConditionWait(self->cond, self->lock);
+        }
+        if( rc == 0 && (rc = t->rc) == 0 ) {
+            memmove(self->zbuf, t->z, t->z_sz);
+            *z_blk = t->z_sz;
+        }
+        t->state = eTrialFree;
+        KLockUnlock(self->lock);
+    }
+    return rc;
+}
+
+/* close current block of qty spots */
+static
+rc_t SIndexBuild_Push(SIndexBuild* self, SIndexNode** inode, uint64_t qty)
+{
+    rc_t rc = 0;
+
+    SLListPushTail(&self->obj->li, &(*inode)->n);
+    *inode = NULL;
+    self->first += qty;
+    if( self->gzip && (rc = KLockAcquire(self->lock)) == 0 ) {
+        self->block_start = self->base + self->first;
+        KLockUnlock(self->lock);
+    }
+    return rc;
+}
+
+static
+rc_t SIndexBuild_Open(SIndexBuild* self, SIndexNode** inode)
+{
+    if( (*inode = malloc(sizeof(SIndexNode))) == NULL ) {
+        return RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+    }
+    (*inode)->key = self->obj->file_size;
+    (*inode)->key_size = 0;
+    (*inode)->id = self->id[self->first];
+    (*inode)->id_qty = 0;
+    return 0;
+}
+
+static
+rc_t SIndexBuild_Plain(SIndexBuild* self)
+{
+    rc_t rc = 0;
+    SIndexObj* obj = self->obj;
+    uint32_t blk = 0;
+    SIndexNode* inode = NULL;
+
+    while( rc == 0 ) {
         bool eof = false;
+        const char* spot;
+        size_t written;
 
-        if( zbuf == NULL || spots_buf == NULL ) {
-            rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+        if( (rc = SIndexBuild_Fill(self, inode == NULL ? 1 : inode->id_qty + 1)) != 0 ) {
+            break;
         }
-        while( rc == 0 ) {
-            if( (rc = SFFReader_GetNextSpotData(reader, buffer, buffer_sz, &written)) == 0 ) {
-                if( inode == NULL ) {
-                    spotid_t spotid = 0;
-                    if( (rc = SFFReaderCurrentSpot(reader, &spotid)) != 0 ) {
-                        break;
-                    }
-                    inode = malloc(sizeof(SIndexNode));
-                    if( inode == NULL ) {
-                        rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
-                        break;
-                    }
-                    inode->key = obj->file_size;
-                    inode->key_size = 0;
-                    inode->id = spotid;
-                    inode->id_qty = 0;
-                    DEBUG_MSG(5, ("%s open key: spot %ld, offset %lu\n", obj->index, inode->id, inode->key));
-                    if( spotid == 1 ) {
-                        char hd[10240];
-                        size_t hd_sz = 0;
-                        if( (rc = SFFReaderHeader(reader, 0, hd, sizeof(hd), &hd_sz)) == 0 ) {
-                            if( hd_sz + written > spots_buf_sz ) {
-                                rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcInsufficient);
-                                break;
-                            }
-                            memmove(&spots_buf[blk], hd, hd_sz);
-                            blk += hd_sz;
-                            if( g_dump ) {
-                                fwrite(hd, hd_sz, 1, stderr);
-                            }
-                        }
-                    }
+        eof = self->qty - self->first <= (inode == NULL ? 0 : inode->id_qty);
+        if( inode != NULL && (blk >= g_file_block_sz || eof) ) {
+            inode->key_size = blk;
+            DEBUG_MSG(5, ("%s index closed spots %lu, offset %lu, block size %lu\n",
+                          obj->index, inode->id_qty, inode->key, inode->key_size));
+            if( (rc = SIndexBuild_Push(self, &inode, inode->id_qty)) != 0 ) {
+                break;
+            }
+            if( blk > obj->buffer_sz ) {
+                obj->buffer_sz = blk;
+            }
+            blk = 0;
+        }
+        if( eof ) {
+            break;
+        }
+        if( inode == NULL ) {
+            if( (rc = SIndexBuild_Open(self, &inode)) != 0 ) {
+                break;
+            }
+            DEBUG_MSG(5, ("%s index opened spot %ld, offset %lu\n", obj->index, inode->id, inode->key));
+        }
+        self->spot = self->id[self->first + inode->id_qty];
+        spot = &self->buf[SIndexBuild_Off(self, self->first + inode->id_qty)];
+        written = self->end[self->first + inode->id_qty] - SIndexBuild_Off(self, self->first + inode->id_qty);
+        inode->id_qty++;
+        obj->file_size += written;
+        blk += written;
+        MD5StateAppend(&obj->md5, spot, written);
+        if( g_dump ) {
+            fwrite(spot, written, 1, stderr);
+        }
+    }
+    free(inode);
+    return rc;
+}
 
-                }
-                if( blk + written > spots_buf_sz ) {
-                    rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcInsufficient);
+static
+rc_t SIndexBuild_Gzip(SIndexBuild* self)
+{
+    rc_t rc = 0;
+    SIndexObj* obj = self->obj;
+    uint32_t blk = 0, spots_per_block = 0, proj_id_qty = 0;
+    SIndexNode* inode = NULL;
+    size_t z_blk = 0;
+    size_t spots_buf_sz = g_file_block_sz * 100;
+    bool eof = false;
+
+    while( rc == 0 ) {
+        uint64_t n = inode == NULL ? 0 : inode->id_qty;
+
+        if( (rc = SIndexBuild_Fill(self, n + 1)) != 0 ) {
+            break;
+        }
+        if( !(eof = self->qty - self->first <= n) ) {
+            const char* spot = &self->buf[SIndexBuild_Off(self, self->first + n)];
+            size_t written = self->end[self->first + n] - SIndexBuild_Off(self, self->first + n);
+
+            if( inode == NULL ) {
+                if( (rc = SIndexBuild_Open(self, &inode)) != 0 ) {
                     break;
                 }
-                inode->id_qty++;
-                memmove(&spots_buf[blk], buffer, written);
-                blk += written;
-                if( g_dump ) {
-                    fwrite(buffer, written, 1, stderr);
-                }
+                DEBUG_MSG(5, ("%s open key: spot %ld, offset %lu\n", obj->index, inode->id, inode->key));
             }
-            if( (eof = (GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted)) ) {
-                rc = 0;
-                if( inode == NULL ) {
-                    break;
-                }
+            self->spot = self->id[self->first + n];
+            if( blk + written > spots_buf_sz ) {
+                rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcInsufficient);
+                break;
             }
-            if( rc == 0 && (eof || 
-                            (proj_id_qty == 0 && inode->id_qty > (spots_per_block * 0.95)) || 
-                            (proj_id_qty > 0 && inode->id_qty >= proj_id_qty) ) ) {
-                rc = ZLib_DeflateBlock(spots_buf, blk, zbuf, zbuf_sz, &z_blk);
-                if( z_blk < g_file_block_sz ) {
-                    /* project needed id_qty */
-                    proj_id_qty = g_file_block_sz * inode->id_qty / z_blk * 1.05;
-                    DEBUG_MSG(5, ("%s: project id qty %lu\n", obj->index, proj_id_qty));
-                } else {
-                    DEBUG_MSG(10, ("%s: no projection %lu > %lu\n", obj->index, z_blk, g_file_block_sz));
-                }
+            inode->id_qty++;
+            blk += written;
+            if( g_dump ) {
+                fwrite(spot, written, 1, stderr);
             }
-            if( rc == 0 && (eof || z_blk >= g_file_block_sz) ) {
-                obj->file_size += z_blk;
-                MD5StateAppend(&obj->md5, zbuf, z_blk);
-                inode->key_size = z_blk;
-                SLListPushTail(&obj->li, &inode->n);
-                DEBUG_MSG(5, ("%s close key: spots %lu, size %lu, ratio %hu%%, raw %lu\n",
-                         obj->index, inode->id_qty, inode->key_size, (uint16_t)(((float)(blk - z_blk)/blk)*100), blk));
-                spots_per_block = inode->id_qty;
-                inode = NULL;
-                if( blk > obj->buffer_sz ) {
-                    obj->buffer_sz = blk;
-                }
-                blk = 0;
-                z_blk = 0;
-                proj_id_qty = 0;
+        } else if( inode == NULL ) {
+            break;
+        }
+        if( eof ||
+            (proj_id_qty == 0 && inode->id_qty > (spots_per_block * 0.95)) ||
+            (proj_id_qty > 0 && inode->id_qty >= proj_id_qty) ) {
+            rc = SIndexBuild_Deflate(self, inode->id_qty, blk, &z_blk);
+            if( rc == 0 && z_blk < g_file_block_sz ) {
+                /* project needed id_qty */
+                proj_id_qty = g_file_block_sz * inode->id_qty / z_blk * 1.05;
+                DEBUG_MSG(5, ("%s: project id qty %u\n", obj->index, proj_id_qty));
+            } else {
+                DEBUG_MSG(10, ("%s: no projection %lu > %u\n", obj->index, z_blk, g_file_block_sz));
             }
-            if( eof ) {
+        }
+        if( rc == 0 && (eof || z_blk >= g_file_block_sz) ) {
+            obj->file_size += z_blk;
+            MD5StateAppend(&obj->md5, self->zbuf, z_blk);
+            inode->key_size = z_blk;
+            DEBUG_MSG(5, ("%s close key: spots %lu, size %lu, ratio %hu%%, raw %u\n",
+                     obj->index, inode->id_qty, inode->key_size, (uint16_t)(((float)(blk - z_blk)/blk)*100), blk));
+            spots_per_block = inode->id_qty;
+            if( (rc = SIndexBuild_Push(self, &inode, spots_per_block)) != 0 ) {
                 break;
             }
+            if( blk > obj->buffer_sz ) {
+                obj->buffer_sz = blk;
+            }
+            blk = 0;
+            z_blk = 0;
+            proj_id_qty = 0;
         }
-        rc = rc ? rc : Quitting();
-        if( rc != 0 ) {
-            spotid_t spot = 0;
-            SFFReaderCurrentSpot(reader, &spot);
-            PLOGERR(klogErr, (klogErr, rc, "spot $(s)", PLOG_U32(s), spot));
+        if( eof ) {
+            break;
+        }
+    }
+    free(inode);
+    return rc;
+}
+
+/* Spots are rendered in chunks by a pool of worker threads, each with its own reader;
+   stitcher takes chunks in order and cuts blocks exactly as a single reader would,
+   so index, size and md5 do not depend on number of threads. With gzip, block size
+   depends on deflated size of previous attempts and only deflating is moved to workers:
+   each attempt guesses it closes the block and queues first attempt for the next one */
+static
+rc_t SIndexBuild_Run(const SIndexSource* src, SIndexObj* obj, bool gzip)
+{
+    rc_t rc = 0;
+    SIndexBuild* self = calloc(1, sizeof(*self));
+    KThread* thread[IDX_MAX_THREADS];
+    uint32_t i, threads = 0, qty = g_threads > IDX_MAX_THREADS ? IDX_MAX_THREADS : g_threads;
+    spotid_t max_spot = 0;
+    const void* reader = NULL;
+
+    if( self == NULL ) {
+        return RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+    }
+    /* format may be unsupported for this table, report it before any work */
+    if( (rc = SIndexSource_Make(src, &reader)) != 0 ) {
+        free(self);
+        return rc;
+    }
+    SIndexSource_Whack(src, reader);
+    self->src = src;
+    self->obj = obj;
+    self->gzip = gzip;
+    self->window = qty * 2;
+    self->trials = gzip && qty > 1 ? qty : 0;
+    self->z_max = g_file_block_sz * 100 + 100;
+    if( (rc = SRATableMinSpotId(src->sratbl, &self->min_spot)) == 0 &&
+        (rc = SRATableMaxSpotId(src->sratbl, &max_spot)) == 0 ) {
+        if( obj->minSpotId > self->min_spot ) {
+            self->min_spot = obj->minSpotId;
         }
-        free(zbuf);
-        free(spots_buf);
+        if( obj->maxSpotId > 0 && obj->maxSpotId < max_spot ) {
+            max_spot = obj->maxSpotId;
+        }
+        self->chunks = max_spot < self->min_spot ? 0 : (max_spot - self->min_spot) / IDX_CHUNK_SPOTS + 1;
+        if( (self->chunk = calloc(self->window, sizeof(*self->chunk))) == NULL ||
+            (gzip && (self->zbuf = malloc(self->z_max)) == NULL) ) {
+            rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
+        }
+    }
+    if( rc == 0 && (rc = KLockMake(&self->lock)) == 0 && (rc = KConditionMake(&self->cond)) == 0 ) {
+        STSMSG(1, ("%s: %lu chunks of %u spots on %u threads", obj->index, self->chunks, IDX_CHUNK_SPOTS, qty));
+        for(threads = 0; rc == 0 && threads < qty; threads++) {
+            rc = KThreadMake(&thread[threads], SIndexBuild_Thread, self);
+        }
+        if( rc == 0 ) {
+            rc = gzip ? SIndexBuild_Gzip(self) : SIndexBuild_Plain(self);
+        } else {
+            threads--;
+        }
+        if( KLockAcquire(self->lock) == 0 ) {
+            self->stop = true;
+            KConditionBroadcast(self->cond);
+            KLockUnlock(self->lock);
+        }
+        for(i = 0; i < threads; i++) {
+            rc_t status = 0;
+            KThreadWait(thread[i], &status);
+            KThreadRelease(thread[i]);
+            rc = rc ? rc : status;
+        }
+    }
+    rc = rc ? rc : Quitting();
+    if( rc != 0 ) {
+        PLOGERR(klogErr, (klogErr, rc, "spot $(s)", PLOG_U32(s), self->spot));
+    }
+    KConditionRelease(self->cond);
+    KLockRelease(self->lock);
+    for(i = 0; self->chunk != NULL && i < self->window; i++) {
+        free(self->chunk[i].data);
     }
+    for(i = 0; i < self->trials; i++) {
+        free(self->trial[i].raw);
+        free(self->trial[i].z);
+    }
+    free(self->chunk);
+    free(self->zbuf);
+    free(self->buf);
+    free(self->end);
+    free(self->id);
+    free(self);
+    return rc;
+}
+
+static
+rc_t SFF_Idx(const SRATable* sratbl, SIndexObj* obj)
+{
+    SIndexSource src;
+
+    memset(&src, 0, sizeof(src));
+    src.sratbl = sratbl;
+    src.obj = obj;
+    src.sff = true;
+    return SIndexBuild_Run(&src, obj, false);
+}
+
+static
+rc_t SFFGzip_Idx(const SRATable* sratbl, SIndexObj* obj)
+{
+    rc_t rc = 0;
+    uint16_t zlib_ver = ZLIB_VERNUM;
+    SIndexSource src;
+
+    memset(&src, 0, sizeof(src));
+    src.sratbl = sratbl;
+    src.obj = obj;
+    src.sff = true;
+    rc = SIndexBuild_Run(&src, obj, true);
     if( rc == 0 ) {
         KMDataNode* opt = NULL, *nd = NULL;
 
@@ -375,15 +901,14 @@ rc_t SFFGzip_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const siz
         }
         KMDataNodeRelease(opt);
     }
-    SFFReaderWhack(reader);
     return rc;
 }
 
 static
-rc_t Fastq_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_t buffer_sz)
+rc_t Fastq_Idx(const SRATable* sratbl, SIndexObj* obj)
 {
     rc_t rc = 0;
-    const FastqReader* reader = NULL;
+    SIndexSource src;
 
     uint8_t colorSpace = false;
     char* colorSpaceKey = "\0";
@@ -411,12 +936,7 @@ rc_t Fastq_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_
         SRAColumnRelease(c);
     }}
 
-    if( (rc = FastqReaderMake(&reader, sratbl, g_accession,
-                        colorSpace, origFormat, false, printLabel, printReadId,
-                        !clipQuality, minReadLen, qualityOffset, colorSpaceKey[0],
-                        obj->minSpotId, obj->maxSpotId)) != 0 ) {
-        return rc;
-    } else {
+    {{
         KMDataNode* opt = NULL, *nd = NULL;
 
         if( (rc = KMDataNodeOpenNodeUpdate(obj->meta, &opt, "Format/Options")) != 0 ) {
@@ -455,70 +975,30 @@ rc_t Fastq_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_
             KMDataNodeRelease(nd);
         }
         KMDataNodeRelease(opt);
-    }
+    }}
 
     if( rc == 0 ) {
-        size_t written = 0;
-        uint32_t blk = 0;
-        SIndexNode* inode = NULL;
-
-        while( rc == 0 ) {
-            rc = FastqReader_GetNextSpotSplitData(reader, buffer, buffer_sz, &written);
-            if( blk >= g_file_block_sz || (GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted) ) {
-                inode->key_size = blk;
-                SLListPushTail(&obj->li, &inode->n);
-                DEBUG_MSG(5, ("Fastq index closed spots %lu, offset %lu, block size %lu\n",
-                                                            inode->id_qty, inode->key, inode->key_size));
-                inode = NULL;
-                if( blk > obj->buffer_sz ) {
-                    obj->buffer_sz = blk;
-                }
-                blk = 0;
-            }
-            if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
-                rc = 0;
-                break;
-            }
-            if( inode == NULL ) {
-                spotid_t spotid = 0;
-                if( (rc = FastqReaderCurrentSpot(reader, &spotid)) != 0 ) {
-                    break;
-                }
-                inode = malloc(sizeof(SIndexNode));
-                if( inode == NULL ) {
-                    rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
-                    break;
-                }
-                inode->key = obj->file_size;
-                inode->key_size = 0;
-                inode->id = spotid;
-                inode->id_qty = 0;
-                DEBUG_MSG(5, ("Fastq index opened spot %ld, offset %lu\n", inode->id, inode->key));
-            }
-            inode->id_qty++;
-            obj->file_size += written;
-            blk += written;
-            MD5StateAppend(&obj->md5, buffer, written);
-            if( g_dump ) {
-                fwrite(buffer, written, 1, stderr);
-            }
-        }
-        rc = rc ? rc : Quitting();
-        if( rc != 0 ) {
-            spotid_t spot = 0;
-            FastqReaderCurrentSpot(reader, &spot);
-            PLOGERR(klogErr, (klogErr, rc, "spot $(s)", PLOG_U32(s), spot));
-        }
+        memset(&src, 0, sizeof(src));
+        src.sratbl = sratbl;
+        src.obj = obj;
+        src.colorSpace = colorSpace;
+        src.colorSpaceKey = colorSpaceKey[0];
+        src.origFormat = origFormat;
+        src.printLabel = printLabel;
+        src.printReadId = printReadId;
+        src.clipQuality = clipQuality;
+        src.minReadLen = minReadLen;
+        src.qualityOffset = qualityOffset;
+        rc = SIndexBuild_Run(&src, obj, false);
     }
-    FastqReaderWhack(reader);
     return rc;
 }
 
 static
-rc_t FastqGzip_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const size_t buffer_sz)
+rc_t FastqGzip_Idx(const SRATable* sratbl, SIndexObj* obj)
 {
     rc_t rc = 0;
-    const FastqReader* reader = NULL;
+    SIndexSource src;
 
     uint16_t zlib_ver = ZLIB_VERNUM;
     uint8_t colorSpace = false;
@@ -547,101 +1027,18 @@ rc_t FastqGzip_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const s
         SRAColumnRelease(c);
     }}
 
-    if( (rc = FastqReaderMake(&reader, sratbl, g_accession,
-                        colorSpace, origFormat, false, printLabel, printReadId,
-                        !clipQuality, minReadLen, qualityOffset, colorSpaceKey[0],
-                        obj->minSpotId, obj->maxSpotId)) != 0 ) {
-        return rc;
-    } else {
-        size_t written = 0;
-        uint32_t blk = 0, spots_per_block = 0, proj_id_qty = 0;
-        SIndexNode* inode = NULL;
-        size_t z_blk = 0;
-        size_t spots_buf_sz = g_file_block_sz * 100;
-        size_t zbuf_sz = spots_buf_sz + 100;
-        char* zbuf = malloc(zbuf_sz);
-        char* spots_buf = malloc(spots_buf_sz);
-        bool eof = false;
-
-        if( zbuf == NULL || spots_buf == NULL ) {
-            rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
-        }
-        while( rc == 0 ) {
-            if( (rc = FastqReader_GetNextSpotSplitData(reader, buffer, buffer_sz, &written)) == 0 ) {
-                if( inode == NULL ) {
-                    spotid_t spotid = 0;
-                    if( (rc = FastqReaderCurrentSpot(reader, &spotid)) != 0 ) {
-                        break;
-                    }
-                    inode = malloc(sizeof(SIndexNode));
-                    if( inode == NULL ) {
-                        rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
-                        break;
-                    }
-                    inode->key = obj->file_size;
-                    inode->key_size = 0;
-                    inode->id = spotid;
-                    inode->id_qty = 0;
-                    DEBUG_MSG(5, ("%s open key: spot %ld, offset %lu\n", obj->index, inode->id, inode->key));
-                }
-                if( blk + written > spots_buf_sz ) {
-                    rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcInsufficient);
-                    break;
-                }
-                inode->id_qty++;
-                memmove(&spots_buf[blk], buffer, written);
-                blk += written;
-                if( g_dump ) {
-                    fwrite(buffer, written, 1, stderr);
-                }
-            }
-            if( (eof = (GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted)) ) {
-                rc = 0;
-                if( inode == NULL ) {
-                    break;
-                }
-            }
-            if( rc == 0 && (eof || 
-                            (proj_id_qty == 0 && inode->id_qty > (spots_per_block * 0.95)) || 
-                            (proj_id_qty > 0 && inode->id_qty >= proj_id_qty) ) ) {
-                rc = ZLib_DeflateBlock(spots_buf, blk, zbuf, zbuf_sz, &z_blk);
-                if( z_blk < g_file_block_sz ) {
-                    /* project needed id_qty */
-                    proj_id_qty = g_file_block_sz * inode->id_qty / z_blk * 1.05;
-                    DEBUG_MSG(5, ("%s: project id qty %u\n", obj->index, proj_id_qty));
-                } else {
-                    DEBUG_MSG(10, ("%s: no projection %u > %u\n", obj->index, z_blk, g_file_block_sz));
-                }
-            }
-            if( rc == 0 && (eof || z_blk >= g_file_block_sz) ) {
-                obj->file_size += z_blk;
-                MD5StateAppend(&obj->md5, zbuf, z_blk);
-                inode->key_size = z_blk;
-                SLListPushTail(&obj->li, &inode->n);
-                DEBUG_MSG(5, ("%s close key: spots %lu, size %lu, ratio %hu%%, raw %u\n",
-                         obj->index, inode->id_qty, inode->key_size, (uint16_t)(((float)(blk - z_blk)/blk)*100), blk ));
-                spots_per_block = inode->id_qty;
-                inode = NULL;
-                if( blk > obj->buffer_sz ) {
-                    obj->buffer_sz = blk;
-                }
-                blk = 0;
-                z_blk = 0;
-                proj_id_qty = 0;
-            }
-            if( eof ) {
-                break;
-            }
-        }
-        rc = rc ? rc : Quitting();
-        if( rc != 0 ) {
-            spotid_t spot = 0;
-            FastqReaderCurrentSpot(reader, &spot);
-            PLOGERR(klogErr, (klogErr, rc, "spot $(s)", PLOG_U32(s), spot));
-        }
-        free(zbuf);
-        free(spots_buf);
-    }
+    memset(&src, 0, sizeof(src));
+    src.sratbl = sratbl;
+    src.obj = obj;
+    src.colorSpace = colorSpace;
+    src.colorSpaceKey = colorSpaceKey[0];
+    src.origFormat = origFormat;
+    src.printLabel = printLabel;
+    src.printReadId = printReadId;
+    src.clipQuality = clipQuality;
+    src.minReadLen = minReadLen;
+    src.qualityOffset = qualityOffset;
+    rc = SIndexBuild_Run(&src, obj, true);
     if( rc == 0 ) {
         KMDataNode* opt = NULL, *nd = NULL;
 
@@ -686,7 +1083,6 @@ rc_t FastqGzip_Idx(const SRATable* sratbl, SIndexObj* obj, char* buffer, const s
         }
         KMDataNodeRelease(opt);
     }
-    FastqReaderWhack(reader);
     return rc;
 }
 
@@ -695,8 +1091,6 @@ rc_t MakeIndexes(const SRATable* stbl, KTable* ktbl, KMetadata* meta)
 {
     rc_t rc = 0;
     int i;
-    char* buffer = NULL;
-    size_t buffer_sz = g_file_block_sz * 100;
 
     SIndexObj idx[] = {
      /*  meta, file,        format,         index,          func,    file_size, buffer_sz, minSpotId, maxSpotId */
@@ -717,13 +1111,7 @@ rc_t MakeIndexes(const SRATable* stbl, KTable* ktbl, KMetadata* meta)
                 KMDataNodeDropChild(parent, "%s.tmp", idx[i].file);
                 if( (rc = KMDataNodeOpenNodeUpdate(parent, &idx[i].meta, "%s.tmp", idx[i].file)) == 0 ) {
                     if( idx[i].func != NULL ) {
-                        if( buffer == NULL ) {
-                            if( (buffer = malloc(buffer_sz)) == NULL ) {
-                                rc = RC(rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted);
-                                break;
-                            }
-                        }
-                        rc = idx[i].func(stbl, &idx[i], buffer, buffer_sz);
+                        rc = idx[i].func(stbl, &idx[i]);
                         if( rc == 0 ) {
                             MD5StateFinish(&idx[i].md5, idx[i].md5_digest);
                             rc = CommitIndex(ktbl, idx[i].index, &idx[i].li);
@@ -754,19 +1142,20 @@ rc_t MakeIndexes(const SRATable* stbl, KTable* ktbl, KMetadata* meta)
         }
         SLListWhack(&idx[i].li, WhackIndexData, NULL);
     }
-    free(buffer);
     return rc;
 }
 
 const char* blocksize_usage[] = {"Index block size", NULL};
 const char* accession_usage[] = {"Accession", NULL};
+const char* threads_usage[] = {"Number of threads rendering spots, default 4", NULL};
 
 /* this enum must have same order as MainArgs array below */
 enum OptDefIndex {
     eopt_BlockSize = 0,
     eopt_Accession,
     eopt_DumpIndex,
-    eopt_noGzip
+    eopt_noGzip,
+    eopt_Threads
 };
 
 OptDef MainArgs[] =
@@ -775,7 +1164,8 @@ OptDef MainArgs[] =
     {"block-size", "b", NULL, blocksize_usage, 1, true, false},
     {"accession", "a", NULL, accession_usage, 1, true, false},
     {"hidden-dump", "d", NULL, NULL, 1, false, false},
-    {"hidden-nogzip", "g", NULL, NULL, 1, false, false}
+    {"hidden-nogzip", "g", NULL, NULL, 1, false, false},
+    {"threads", "t", NULL, threads_usage, 1, true, false}
 };
 const char* MainParams[] =
 {
@@ -783,7 +1173,8 @@ const char* MainParams[] =
     "size",
     "accession",
     NULL,
-    NULL
+    NULL,
+    "count"
 };
 const size_t MainArgsQty = sizeof(MainArgs) / sizeof(MainArgs[0]);
 
@@ -832,7 +1223,7 @@ rc_t KMain(int argc, char *argv[])
     char accn[1024];
     
     if( (rc = ArgsMakeAndHandle(&args, argc, argv, 1, MainArgs, MainArgsQty)) == 0 ) {
-        const char* blksz = NULL;
+        const char* blksz = NULL, *threads = NULL;
         uint32_t count, dump = 0, gzip = 0;
 
         if( (rc = ArgsParamCount(args, &count)) != 0 || count != 1 ) {
@@ -856,6 +1247,12 @@ rc_t KMain(int argc, char *argv[])
 
         } else if( (rc = ArgsOptionCount(args, MainArgs[eopt_noGzip].name, &gzip)) != 0 ) {
             errmsg = MainArgs[eopt_noGzip].name;
+
+        } else if( (rc = ArgsOptionCount(args, MainArgs[eopt_Threads].name, &count)) != 0 || count > 1 ) {
+            rc = rc ? rc : RC(rcExe, rcArgv, rcParsing, rcParam, rcExcessive);
+            errmsg = MainArgs[eopt_Threads].name;
+        } else if( count > 0 && (rc = ArgsOptionValue(args, MainArgs[eopt_Threads].name, 0, (const void **)&threads)) != 0 ) {
+            errmsg = MainArgs[eopt_Threads].name;
         }
         while( rc == 0 ) {
             long val = 0;
@@ -875,6 +1272,16 @@ rc_t KMain(int argc, char *argv[])
                 }
                 g_file_block_sz = val;
             }
+            if( threads != NULL ) {
+                errno = 0;
+                val = strtol(threads, &end, 10);
+                if( errno != 0 || threads == end || *end != '\0' || val <= 0 || val > IDX_MAX_THREADS ) {
+                    rc = RC(rcExe, rcArgv, rcReading, rcParam, rcInvalid);
+                    errmsg = MainArgs[eopt_Threads].name;
+                    break;
+                }
+                g_threads = val;
+            }
             if( (rc = ArgsParamValue(args, 0, (const void **)&table_dir)) != 0 ) {
                 errmsg = "table";
                 break;
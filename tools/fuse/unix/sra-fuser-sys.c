@@ -36,6 +36,7 @@
 #include "xml.h"
 #include "sra-fuser.h"
 #include "log.h"
+#include "block-cache.h"
 
 #include <atomic.h>
 #include <stdio.h>
@@ -407,6 +408,13 @@ void CoreUsage(int fd, const char *progName, bool showHelp, bool showVersion, bo
                 "    --SRA-cache <path>                 Write SRA update info to a file.\n"
                 "                                       Must have --SRA-check option value of non-zero.\n"
                 );
+            KOutMsg(
+                "    --cache-blocks <n>                 Generated blocks kept per open fastq file, default: 4.\n"
+                "    --cache-mem <MB>                   Limit of memory for generated blocks of all files,\n"
+                "                                       default: 0 - no limit.\n"
+                "    --read-ahead <n>                   Blocks generated ahead of a sequential reader,\n"
+                "                                       default: 2, 0 - no read-ahead.\n"
+                );
             KOutMsg(
                 "    -L|--log-level                     Logging level as number or enum string. One\n"
                 "                                       of (fatal|sys|int|err|warn|info) or (0-5)\n"
@@ -456,6 +464,7 @@ rc_t CC KMain(int argc, char *argv[])
     const char* sra_cache = NULL, *xml_root = ".";
     char** fargs = (char**)calloc(argc, sizeof(char*));
     uint32_t xml_sync = 0, log_sync = 0, sra_sync = 0;
+    uint32_t cache_blocks = 4, cache_mem = 0, read_ahead = 2;
     EXMLValidate xml_validate = eXML_Full;
     int log_fd = STDOUT_FILENO;
 
@@ -493,6 +502,12 @@ rc_t CC KMain(int argc, char *argv[])
             sra_sync = AsciiToU32(argv[++i], NULL, NULL);
         } else if(!strcmp(argv[i], "-df") || !strcmp(argv[i], "--SRA-cache")) {
             sra_cache = argv[++i];
+        } else if(!strcmp(argv[i], "--cache-blocks")) {
+            cache_blocks = AsciiToU32(argv[++i], NULL, NULL);
+        } else if(!strcmp(argv[i], "--cache-mem")) {
+            cache_mem = AsciiToU32(argv[++i], NULL, NULL);
+        } else if(!strcmp(argv[i], "--read-ahead")) {
+            read_ahead = AsciiToU32(argv[++i], NULL, NULL);
         } else if(!strcmp(argv[i], "-u") || !strcmp (argv[i], "--unmount")) {
             unmount = true;
         } else if(!strcmp(argv[i], "-L") || !strcmp (argv[i], "--log-level")) {
@@ -586,6 +601,7 @@ rc_t CC KMain(int argc, char *argv[])
     g_dflt_file_stat.st_blksize = 0;
     g_dflt_file_stat.st_blocks = 0;
 
+    BlockCache_Configure(cache_blocks, (uint64_t)cache_mem * 1024 * 1024, read_ahead);
     if( (rc = Initialize(sra_sync, xml_path, xml_sync, sra_cache, xml_root, xml_validate)) != 0 ) {
         LOGERR(klogErr, rc, "at initialization");
         CoreUsage(log_fd, argv[0], true, false, true, false);
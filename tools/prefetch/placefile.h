@@ -0,0 +1,51 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_prefetch_placefile_
+#define _h_prefetch_placefile_
+
+#include <klib/rc.h>
+
+/*--------------------------------------------------------------------------
+ * PlaceFile
+ *  puts a copy of local file "src" at "dst" without reading it through
+ *  a user-space buffer when the file system allows it:
+ *  reflink (shares blocks), hard link (read-only sources only),
+ *  in-kernel copy; a plain copy is the last resort
+ *
+ *  paths are native paths; "dst" is overwritten
+ */
+typedef enum {
+    ePlaceNone,
+    ePlaceReflink,
+    ePlaceHardlink,
+    ePlaceKernelCopy,
+    ePlaceCopy
+} EPlace;
+
+rc_t PlaceFile ( const char * src, const char * dst, EPlace * how );
+
+#endif /* _h_prefetch_placefile_ */
@@ -56,7 +56,13 @@
 #include <kfs/gzip.h> /* KFileMakeGzipForRead */
 #include <kfs/subfile.h> /* KFileMakeSubRead */
 #include <kfs/cacheteefile.h> /* KDirectoryMakeCacheTee */
+#include <kfs/md5.h> /* KMD5SumFmt */
 
+#include <kproc/cond.h> /* KCondition */
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
+#include <klib/checksum.h> /* MD5State */
 #include <klib/container.h> /* BSTree */
 #include <klib/data-buffer.h> /* KDataBuffer */
 #include <klib/log.h> /* PLOGERR */
@@ -70,6 +76,7 @@
 #include <sysalloc.h>
 
 #include <assert.h>
+#include <stdarg.h> /* va_list */
 #include <stdlib.h> /* free */
 #include <string.h> /* memset */
 #include <time.h> /* time */
@@ -77,6 +84,8 @@
 #include <stdio.h> /* printf */
 
 #include "kfile-no-q.h"
+#include "placefile.h"
+#include "scheduler.h"
 
 #define DISP_RC(rc, err) (void)((rc == 0) ? 0 : LOGERR(klogInt, rc, err))
 
@@ -203,6 +212,23 @@ typedef struct {
     size_t maxSize;
     uint64_t heartbeat;
 
+    uint32_t connections; /* concurrent range requests: total for all jobs */
+    size_t segmentSize;   /* size of a range request */
+
+    uint32_t jobs;        /* items downloaded concurrently */
+    size_t maxRate;       /* bytes per second; 0: unlimited */
+    Scheduler *sched;     /* NULL when items are processed one by one */
+    Throttle *throttle;   /* NULL: transfer rate is not limited */
+
+    KLock *claimLock;     /* guards downloaded and claimed trees */
+    KCondition *claimCond;/* a claimed download is finished */
+    BSTree claimed;       /* downloads in progress by concurrent jobs */
+
+    const KMD5SumFmt *manifest; /* expected MD5 of downloaded files */
+
+    char **mirrors;       /* local directories with copies of remote files */
+    uint32_t mirrorCount;
+
     bool noAscp;
     bool noHttp;
 
@@ -224,6 +250,7 @@ typedef struct {
     const char * outFile; /* do not free! */
     const char * orderOrOutFile; /* do not free! */
     const char * fileType;  /* do not free! */
+    const char * manifestFile; /* do not free! */
 
 #if _DEBUGGING
     const char *textkart;
@@ -245,6 +272,8 @@ typedef struct {
     bool isDependency;
     char * seq_id;
 
+    struct ItemLog *log; /* NULL: status is printed right away */
+
     Main *mane; /* just a pointer, no refcount here, don't release it */
 } Item;
 typedef struct {
@@ -257,6 +286,72 @@ typedef struct {
     BSTNode n;
     Item *i;
 } KartTreeNode;
+/********** ItemLog **********/
+
+/* status messages of an item that is processed concurrently with others:
+   they are printed in the item order after the item is complete */
+typedef struct ItemLog {
+    char *text; /* '\0'-terminated messages one after another */
+    size_t size;
+    size_t allocated;
+} ItemLog;
+
+static void ItemLogPrint(const ItemLog *self) {
+    const char *msg = NULL;
+
+    assert(self);
+
+    for (msg = self->text; msg != NULL && msg < self->text + self->size;
+        msg += strlen(msg) + 1)
+    {
+        STSMSG(STS_TOP, ("%s", msg));
+    }
+}
+
+static void ItemLogFini(ItemLog *self) {
+    assert(self);
+    free(self->text);
+    memset(self, 0, sizeof *self);
+}
+
+/* the same as STSMSG(STS_TOP, ...) but keeps the item order */
+static void ItemMsg(const Item *self, const char *fmt, ...) {
+    rc_t rc = 0;
+    char msg[4096] = "";
+    size_t num_writ = 0;
+    ItemLog *log = NULL;
+
+    va_list args;
+    va_start(args, fmt);
+    rc = string_vprintf(msg, sizeof msg, &num_writ, fmt, args);
+    va_end(args);
+
+    if (rc != 0 && num_writ == 0)
+        return;
+    if (num_writ >= sizeof msg)
+        num_writ = sizeof msg - 1;
+    msg[num_writ] = '\0';
+
+    if (self != NULL)
+        log = self->log;
+    if (log == NULL) {
+        STSMSG(STS_TOP, ("%s", msg));
+        return;
+    }
+
+    if (log->size + num_writ + 1 > log->allocated) {
+        size_t allocated = log->allocated * 2 + num_writ + 1;
+        char *text = realloc(log->text, allocated);
+        if (text == NULL)
+            return;
+        log->text = text;
+        log->allocated = allocated;
+    }
+
+    memmove(log->text + log->size, msg, num_writ + 1);
+    log->size += num_writ + 1;
+}
+
 /********** String extension **********/
 static rc_t StringRelease(const String *self) {
     free((String*)self);
@@ -414,6 +509,29 @@ static rc_t _KDirectoryMkLockName(const KDirectory *self,
     return rc;
 }
 
+static rc_t _KDirectoryMkPartName(const KDirectory *self,
+    const String *prefix, char *out, size_t sz)
+{
+    rc_t rc = 0;
+    size_t num_writ = 0;
+
+    assert(prefix);
+
+    /* should not start with "<prefix>.tmp":
+       _KDirectoryClean would remove it together with the temporary files */
+    rc = string_printf(out, sz, &num_writ, "%S.prt", prefix);
+    DISP_RC2(rc, "string_printf(prt)", prefix->addr);
+
+    if (rc == 0 && num_writ > sz) {
+        rc = RC(rcExe, rcFile, rcCopying, rcBuffer, rcInsufficient);
+        PLOGERR(klogInt, (klogInt, rc,
+            "bad string_printf($(s).prt) result", "s=%S", prefix));
+        return rc;
+    }
+
+    return rc;
+}
+
 static
 rc_t _KDirectoryCleanCache(KDirectory *self, const String *local)
 {
@@ -1032,16 +1150,18 @@ static void ResolvedReset(Resolved *self, ERunType type) {
 /** isLocal is set to true when the object is found locally.
     i.e. does not need need not be [re]downloaded */
 static rc_t ResolvedLocal(const Resolved *self,
-    const Main *mane, bool *isLocal, EForce force)
+    const Item *item, bool *isLocal, EForce force)
 {
     rc_t rc = 0;
+    const Main *mane = NULL;
     const KDirectory *dir = NULL;
     uint64_t sRemote = 0;
     uint64_t sLocal = 0;
     const KFile *local = NULL;
     char path[PATH_MAX] = "";
 
-    assert(isLocal && self && mane);
+    assert(isLocal && self && item && item->mane);
+    mane = item -> mane;
     dir = mane -> dir;
 
     *isLocal = false;
@@ -1056,15 +1176,15 @@ static rc_t ResolvedLocal(const Resolved *self,
     if (rc == 0 && (KDirectoryPathType(dir, "%s", path) & ~kptAlias) != kptFile)
     {
         if (force == eForceNo) {
-            STSMSG(STS_TOP,
-                ("%s (not a file) is found locally: consider it complete",
-                 path));
+            ItemMsg(item,
+                "%s (not a file) is found locally: consider it complete",
+                 path);
             *isLocal = true;
         }
         else {
-            STSMSG(STS_TOP,
-                ("%s (not a file) is found locally and will be redownloaded",
-                 path));
+            ItemMsg(item,
+                "%s (not a file) is found locally and will be redownloaded",
+                 path);
         }
         return 0;
     }
@@ -1145,9 +1265,9 @@ static rc_t ResolvedLocal(const Resolved *self,
                 }
             }
             else
-                STSMSG(STS_TOP, (
+                ItemMsg(item,
                     "%s (%,lu) is incomplete. Expected size is %,lu. "
-                    "It will be re-downloaded", path, sLocal, sRemote));
+                    "It will be re-downloaded", path, sLocal, sRemote);
         }
     }
 
@@ -1212,8 +1332,786 @@ static rc_t MainDownloaded(Main *self, const char *path) {
     return 0;
 }
 
-static rc_t MainDownloadHttpFile(Resolved *self,
-    Main *mane, const char *to, const VPath * path)
+/* concurrent jobs can depend on the same object (e.g. refseq):
+   the first one downloads it, the others wait for it to be downloaded */
+static rc_t MainClaimDownload(Main *self, const char *path, bool *claimed) {
+    rc_t rc = 0;
+
+    assert(self && self->claimLock && claimed);
+
+    *claimed = false;
+
+    rc = KLockAcquire(self->claimLock);
+    if (rc != 0)
+        return rc;
+
+    while (rc == 0) {
+        TreeNode *sn = NULL;
+
+        if (self->force != eForceYES && MainHasDownloaded(self, path))
+            break;
+
+        if (BSTreeFind(&self->claimed, path, bstCmp) != NULL) {
+            STSMSG(STS_DBG, ("waiting for %s to be downloaded", path));
+            rc = KConditionWait(self->claimCond, self->claimLock);
+            continue;
+        }
+
+        sn = calloc(1, sizeof *sn);
+        if (sn != NULL)
+            sn->path = string_dup_measure(path, NULL);
+        if (sn == NULL || sn->path == NULL) {
+            free(sn);
+            rc = RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+            break;
+        }
+
+        BSTreeInsert(&self->claimed, (BSTNode*)sn, bstSort);
+        *claimed = true;
+        break;
+    }
+
+    KLockUnlock(self->claimLock);
+
+    return rc;
+}
+
+static rc_t MainUnclaimDownload(Main *self, const char *path, bool done) {
+    rc_t rc = 0;
+    TreeNode *sn = NULL;
+
+    assert(self && self->claimLock);
+
+    rc = KLockAcquire(self->claimLock);
+    if (rc != 0)
+        return rc;
+
+    sn = (TreeNode*) BSTreeFind(&self->claimed, path, bstCmp);
+    if (sn != NULL) {
+        BSTreeUnlink(&self->claimed, (BSTNode*)sn);
+        bstWhack((BSTNode*)sn, NULL);
+    }
+
+    if (done)
+        rc = MainDownloaded(self, path);
+
+    KConditionBroadcast(self->claimCond);
+    KLockUnlock(self->claimLock);
+
+    return rc;
+}
+
+static void MainThrottle(const Main *self, size_t bytes) {
+    assert(self);
+    if (self->throttle != NULL)
+        ThrottleTake(self->throttle, bytes);
+}
+
+/********** segmented HTTP download **********/
+
+/* MD5 of a downloaded file:
+   it is checked before the temporary file is renamed to its final name */
+typedef struct {
+    bool manifest;      /* expected md5 comes from the manifest */
+    bool expected;      /* expected md5 is known */
+    uint8_t md5[16];    /* expected md5 */
+
+    bool computed;      /* digest of the downloaded file is computed */
+    bool verified;      /* digest matches the expected md5 */
+    uint8_t digest[16];
+} Digest;
+
+#define MAX_CONNECTIONS 32
+#define SEG_CHUNK (1024 * 1024)
+#define SEG_RETRIES 3
+#define SEG_HASH_MAX (64 * 1024 * 1024) /* larger segments are not kept */
+
+static const char SEG_MAGIC[8] = { 'N', 'C', 'B', 'I', 'p', 'r', 't', '1' };
+
+/* header of the sidecar file:
+   it is followed by a bitmap with one bit per completed segment */
+typedef struct {
+    char magic[8];
+    uint64_t size;    /* size of the remote file */
+    uint64_t segSize; /* size of a segment */
+} SegHeader;
+
+typedef struct {
+    Main *mane;
+    const String *src;
+    bool reliable;
+
+    const char *part; /* partial file: preallocated to the remote size */
+    const char *seg;  /* sidecar bitmap of completed segments */
+    KFile *out;
+    KFile *bmp;
+
+    uint64_t size;
+    uint64_t segSize;
+    uint64_t count;   /* number of segments */
+    uint8_t *done;    /* one bit per segment */
+
+    KLock *lock;
+    uint64_t next;    /* next segment to look at */
+    rc_t rc;          /* the first failure: stops all workers */
+
+    /* md5 of the file, fed in order while the segments complete */
+    bool hashing;
+    MD5State md5;
+    uint64_t hashed;  /* segments fed to md5 */
+    uint64_t window;  /* segments taken ahead of hashed */
+    void **held;      /* completed segments waiting for the previous ones */
+    KCondition *cond; /* a segment is hashed or a worker failed */
+} SegDownload;
+
+static bool SegDownloadIsDone(const SegDownload *self, uint64_t i) {
+    assert(self && self->done && i < self->count);
+    return (self->done[i / 8] & (1 << (i % 8))) != 0;
+}
+
+static void SegDownloadFail(SegDownload *self, rc_t rc) {
+    assert(self);
+    if (KLockAcquire(self->lock) == 0) {
+        if (self->rc == 0)
+            self->rc = rc;
+        if (self->cond != NULL)
+            KConditionBroadcast(self->cond);
+        KLockUnlock(self->lock);
+    }
+}
+
+static bool SegDownloadNext(SegDownload *self, uint64_t *i) {
+    bool found = false;
+
+    assert(self && i);
+
+    if (KLockAcquire(self->lock) != 0)
+        return false;
+
+    /* held segments are bounded: don't run too far ahead of md5 */
+    while (self->hashing && self->rc == 0 && self->next < self->count
+        && self->next >= self->hashed + self->window)
+    {
+        if (KConditionWait(self->cond, self->lock) != 0)
+            break;
+    }
+
+    while (self->rc == 0 && self->next < self->count) {
+        uint64_t n = self->next++;
+        if (!SegDownloadIsDone(self, n)) {
+            *i = n;
+            found = true;
+            break;
+        }
+    }
+
+    KLockUnlock(self->lock);
+
+    return found;
+}
+
+static rc_t SegDownloadMark(SegDownload *self, uint64_t i) {
+    rc_t rc = 0;
+    size_t num_writ = 0;
+
+    assert(self);
+
+    rc = KLockAcquire(self->lock);
+    if (rc != 0)
+        return rc;
+
+    self->done[i / 8] |= 1 << (i % 8);
+    rc = KFileWriteAll(self->bmp, sizeof(SegHeader) + i / 8,
+        &self->done[i / 8], 1, &num_writ);
+    DISP_RC2(rc, "Cannot KFileWrite", self->seg);
+    if (rc == 0 && num_writ != 1)
+        rc = RC(rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete);
+
+    KLockUnlock(self->lock);
+
+    STSMSG(STS_DBG, ("%s: segment %lu of %lu done", self->part, i + 1,
+        self->count));
+
+    return rc;
+}
+
+/* reuse partial file and its bitmap left by an interrupted download */
+static rc_t SegDownloadResume(SegDownload *self, KDirectory *dir) {
+    rc_t rc = 0;
+    const KFile *f = NULL;
+    SegHeader hdr;
+    size_t bytes = 0;
+    size_t num_read = 0;
+    uint64_t size = 0;
+
+    assert(self && dir);
+
+    if (KDirectoryPathType(dir, "%s", self->seg) != kptFile ||
+        KDirectoryPathType(dir, "%s", self->part) != kptFile)
+    {
+        return SILENT_RC(rcExe, rcFile, rcOpening, rcFile, rcNotFound);
+    }
+
+    rc = KDirectoryOpenFileRead(dir, &f, "%s", self->seg);
+    if (rc == 0)
+        rc = KFileReadAll(f, 0, &hdr, sizeof hdr, &num_read);
+    if (rc == 0 && (num_read != sizeof hdr
+        || memcmp(hdr.magic, SEG_MAGIC, sizeof hdr.magic) != 0
+        || hdr.size != self->size || hdr.segSize == 0))
+    {
+        rc = SILENT_RC(rcExe, rcFile, rcValidating, rcData, rcInconsistent);
+    }
+
+    if (rc == 0) {
+        self->segSize = hdr.segSize;
+        self->count = (self->size + self->segSize - 1) / self->segSize;
+        bytes = (size_t)((self->count + 7) / 8);
+        self->done = calloc(1, bytes);
+        if (self->done == NULL)
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    }
+    if (rc == 0) {
+        rc = KFileReadAll(f, sizeof hdr, self->done, bytes, &num_read);
+        if (rc == 0 && num_read != bytes)
+            rc = SILENT_RC(rcExe, rcFile, rcReading, rcData, rcInsufficient);
+    }
+    RELEASE(KFile, f);
+
+    if (rc == 0)
+        rc = KDirectoryOpenFileWrite(dir, &self->out, true, "%s", self->part);
+    if (rc == 0)
+        rc = KFileSize(self->out, &size);
+    if (rc == 0 && size != self->size)
+        rc = SILENT_RC(rcExe, rcFile, rcValidating, rcSize, rcInconsistent);
+    if (rc == 0)
+        rc = KDirectoryOpenFileWrite(dir, &self->bmp, true, "%s", self->seg);
+
+    if (rc != 0) {
+        RELEASE(KFile, self->out);
+        RELEASE(KFile, self->bmp);
+        free(self->done);
+        self->done = NULL;
+    }
+
+    return rc;
+}
+
+/* start over: preallocate partial file and create an empty bitmap */
+static rc_t SegDownloadCreate(SegDownload *self, KDirectory *dir) {
+    rc_t rc = 0;
+    SegHeader hdr;
+    size_t bytes = 0;
+    size_t num_writ = 0;
+
+    assert(self && dir && self->segSize > 0);
+
+    self->count = (self->size + self->segSize - 1) / self->segSize;
+    bytes = (size_t)((self->count + 7) / 8);
+    self->done = calloc(1, bytes);
+    if (self->done == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+
+    STSMSG(STS_DBG, ("creating %s", self->part));
+    rc = KDirectoryCreateFile(dir, &self->out,
+        false, 0664, kcmInit | kcmParents, "%s", self->part);
+    DISP_RC2(rc, "Cannot OpenFileWrite", self->part);
+
+    if (rc == 0) {
+        rc = KFileSetSize(self->out, self->size);
+        DISP_RC2(rc, "Cannot KFileSetSize", self->part);
+    }
+
+    if (rc == 0) {
+        STSMSG(STS_DBG, ("creating %s", self->seg));
+        rc = KDirectoryCreateFile(dir, &self->bmp,
+            false, 0664, kcmInit | kcmParents, "%s", self->seg);
+        DISP_RC2(rc, "Cannot OpenFileWrite", self->seg);
+    }
+
+    if (rc == 0) {
+        memset(&hdr, 0, sizeof hdr);
+        memmove(hdr.magic, SEG_MAGIC, sizeof hdr.magic);
+        hdr.size = self->size;
+        hdr.segSize = self->segSize;
+        rc = KFileWriteAll(self->bmp, 0, &hdr, sizeof hdr, &num_writ);
+        if (rc == 0 && num_writ != sizeof hdr)
+            rc = RC(rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete);
+    }
+    if (rc == 0) {
+        rc = KFileWriteAll(self->bmp, sizeof hdr, self->done, bytes, &num_writ);
+        if (rc == 0 && num_writ != bytes)
+            rc = RC(rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete);
+        DISP_RC2(rc, "Cannot KFileWrite", self->seg);
+    }
+
+    return rc;
+}
+
+static rc_t SegDownloadFetch(SegDownload *self, const KFile *in,
+    void *buffer, uint64_t i)
+{
+    rc_t rc = 0;
+    uint64_t pos = 0;
+    uint64_t end = 0;
+
+    assert(self && in && buffer);
+
+    pos = i * self->segSize;
+    end = pos + self->segSize;
+    if (end > self->size)
+        end = self->size;
+
+    while (rc == 0 && pos < end) {
+        size_t num_read = 0;
+        size_t num_writ = 0;
+        size_t to_read = SEG_CHUNK;
+        /* the segment is kept in buffer to be fed to md5 */
+        char *dst = self->hashing
+            ? (char *)buffer + (pos - i * self->segSize) : buffer;
+        if (end - pos < to_read)
+            to_read = (size_t)(end - pos);
+
+        rc = KFileReadAll(in, pos, dst, to_read, &num_read);
+        if (rc == 0 && num_read != to_read)
+            rc = RC(rcExe, rcFile, rcReading, rcTransfer, rcIncomplete);
+
+        MainThrottle(self->mane, num_read);
+
+        if (rc == 0) {
+            rc = KFileWriteAll(self->out, pos, dst, num_read, &num_writ);
+            DISP_RC2(rc, "Cannot KFileWrite", self->part);
+            if (rc == 0 && num_writ != num_read)
+                rc = RC(rcExe, rcFile, rcCopying, rcTransfer, rcIncomplete);
+        }
+
+        pos += num_read;
+
+        if (rc == 0)
+            rc = Quitting();
+    }
+
+    return rc;
+}
+
+static size_t SegDownloadLength(const SegDownload *self, uint64_t i) {
+    uint64_t end = (i + 1) * self->segSize;
+    if (end > self->size)
+        end = self->size;
+    return (size_t)(end - i * self->segSize);
+}
+
+/* segment i in *buffer is complete: it is fed to md5 when all segments before
+   it are, or it is held until then and *buffer is replaced */
+static rc_t SegDownloadHash(SegDownload *self, uint64_t i, void **buffer) {
+    rc_t rc = 0;
+
+    assert(self && buffer && *buffer);
+
+    if (!self->hashing)
+        return 0;
+
+    rc = KLockAcquire(self->lock);
+    if (rc != 0)
+        return rc;
+
+    if (i != self->hashed) {
+        void *next = malloc((size_t)self->segSize);
+        if (next == NULL)
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+        else {
+            self->held[i] = *buffer;
+            *buffer = next;
+        }
+    }
+    else {
+        MD5StateAppend(&self->md5, *buffer, SegDownloadLength(self, i));
+        for (++self->hashed; self->hashed < self->count
+            && self->held[self->hashed] != NULL; ++self->hashed)
+        {
+            uint64_t h = self->hashed;
+            MD5StateAppend(&self->md5, self->held[h],
+                SegDownloadLength(self, h));
+            free(self->held[h]);
+            self->held[h] = NULL;
+        }
+        KConditionBroadcast(self->cond);
+    }
+
+    KLockUnlock(self->lock);
+
+    return rc;
+}
+
+/* worker: every worker keeps its own connection to the server */
+static rc_t CC SegDownloadThread(const KThread *self, void *data) {
+    rc_t rc = 0;
+    SegDownload *sd = data;
+    const KFile *in = NULL;
+    void *buffer = malloc(sd->hashing ? (size_t)sd->segSize : SEG_CHUNK);
+
+    assert(sd);
+
+    if (buffer == NULL)
+        rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+
+    while (rc == 0) {
+        uint64_t i = 0;
+        int attempt = 0;
+
+        if (!SegDownloadNext(sd, &i))
+            break;
+
+        for (attempt = 1; ; ++attempt) {
+            /* the connection is kept for the next segments */
+            if (in == NULL)
+                rc = _KFileOpenRemote(&in, sd->mane->kns, sd->src,
+                    sd->reliable);
+            if (rc == 0)
+                rc = SegDownloadFetch(sd, in, buffer, i);
+            if (rc == 0 || attempt >= SEG_RETRIES || Quitting() != 0)
+                break;
+
+            PLOGERR(klogWarn, (klogWarn, rc, "segment $(n) of $(path) failed: "
+                "retrying", "n=%lu,path=%S", i + 1, sd->src));
+            RELEASE(KFile, in); /* reconnect */
+        }
+
+        if (rc == 0)
+            rc = SegDownloadHash(sd, i, &buffer);
+        if (rc == 0)
+            rc = SegDownloadMark(sd, i);
+    }
+
+    if (rc != 0)
+        SegDownloadFail(sd, rc);
+
+    RELEASE(KFile, in);
+    free(buffer);
+
+    return rc;
+}
+
+static rc_t MainDownloadSegmented(const Resolved *self, Main *mane,
+    const char *to, const char *part, const String *src, uint64_t size,
+    Digest *digest)
+{
+    rc_t rc = 0;
+    uint32_t i = 0;
+    uint32_t n = 0;
+    uint64_t s = 0;
+    uint64_t completed = 0;
+
+    KThread *threads[MAX_CONNECTIONS];
+    char seg[PATH_MAX] = "";
+
+    SegDownload sd;
+    memset(&sd, 0, sizeof sd);
+
+    assert(self && mane && mane->segmentSize > 0);
+
+    sd.mane = mane;
+    sd.src = src;
+    sd.reliable = !self->isUri;
+    sd.part = part;
+    sd.seg = seg;
+    sd.size = size;
+    sd.segSize = mane->segmentSize;
+
+    rc = string_printf(seg, sizeof seg, NULL, "%s.seg", part);
+    DISP_RC2(rc, "string_printf(seg)", part);
+
+    if (rc == 0) {
+        if (SegDownloadResume(&sd, mane->dir) == 0) {
+            for (s = 0; s < sd.count; ++s)
+                if (SegDownloadIsDone(&sd, s))
+                    ++completed;
+            STSMSG(STS_INFO, ("resuming %s: %lu of %lu segments are complete",
+                part, completed, sd.count));
+        }
+        else
+            rc = SegDownloadCreate(&sd, mane->dir);
+    }
+
+    if (rc == 0) {
+        rc = KLockMake(&sd.lock);
+        DISP_RC(rc, "KLockMake(SegDownload)");
+    }
+
+    /* a resumed download is read back to compute its md5 */
+    if (rc == 0 && digest != NULL && completed == 0
+        && sd.segSize <= SEG_HASH_MAX)
+    {
+        sd.held = calloc((size_t)sd.count, sizeof sd.held[0]);
+        if (sd.held != NULL && KConditionMake(&sd.cond) == 0) {
+            MD5StateInit(&sd.md5);
+            sd.hashing = true;
+        }
+    }
+
+    if (rc == 0) {
+        n = mane->connections;
+        if (mane->sched != NULL) /* share connections between jobs */
+            n = n > mane->jobs ? n / mane->jobs : 1;
+        if (n > MAX_CONNECTIONS)
+            n = MAX_CONNECTIONS;
+        if (n > sd.count - completed)
+            n = (uint32_t)(sd.count - completed);
+
+        STSMSG(STS_INFO, ("%S -> %s: %lu segments of %lu bytes, "
+            "%u connections", src, part, sd.count, sd.segSize, n));
+
+        sd.window = 2 * (uint64_t)n;
+
+        for (i = 0; i < n; ++i) {
+            rc = KThreadMake(&threads[i], SegDownloadThread, &sd);
+            if (rc != 0) {
+                DISP_RC(rc, "KThreadMake(SegDownload)");
+                SegDownloadFail(&sd, rc);
+                break;
+            }
+        }
+
+        n = i;
+        for (i = 0; i < n; ++i) {
+            rc_t status = 0;
+            rc_t rc2 = KThreadWait(threads[i], &status);
+            if (rc == 0)
+                rc = rc2 != 0 ? rc2 : status;
+            KThreadRelease(threads[i]);
+        }
+
+        if (rc == 0)
+            rc = sd.rc;
+    }
+
+    if (rc == 0 && sd.hashing && sd.hashed == sd.count) {
+        MD5StateFinish(&sd.md5, digest->digest);
+        digest->computed = true;
+    }
+
+    RELEASE(KFile, sd.out);
+    RELEASE(KFile, sd.bmp);
+    RELEASE(KLock, sd.lock);
+    RELEASE(KCondition, sd.cond);
+    if (sd.held != NULL) {
+        for (s = 0; s < sd.count; ++s)
+            free(sd.held[s]);
+        free(sd.held);
+    }
+    free(sd.done);
+
+    if (rc == 0) {
+        STSMSG(STS_DBG, ("renaming %s -> %s", part, to));
+        rc = KDirectoryRename(mane->dir, true, part, to);
+        if (rc != 0)
+            PLOGERR(klogInt, (klogInt, rc, "cannot rename $(from) to $(to)",
+                "from=%s,to=%s", part, to));
+    }
+
+    if (rc == 0) {
+        STSMSG(STS_DBG, ("removing %s", seg));
+        rc = KDirectoryRemove(mane->dir, false, "%s", seg);
+        DISP_RC2(rc, "Cannot KDirectoryRemove", seg);
+    }
+
+    if (rc == 0)
+        STSMSG(STS_INFO, ("%s (%ld)", to, size));
+    else if (KDirectoryPathType(mane->dir, "%s", seg) == kptFile)
+        STSMSG(STS_INFO, ("%s is kept to resume the download", part));
+
+    return rc;
+}
+
+/********** download verification **********/
+
+#define VERIFY_RETRIES 2
+
+static void _Md5ToHex(const uint8_t md5[16], char hex[33]) {
+    int i = 0;
+    for (i = 0; i < 16; ++i)
+        string_printf(hex + 2 * i, 3, NULL, "%02x", md5[i]);
+}
+
+static void DigestInit(Digest *self, const Main *mane, const String *cache) {
+    bool bin = false;
+    const char *name = NULL;
+
+    assert(self && mane && cache && cache->addr);
+
+    memset(self, 0, sizeof *self);
+
+    if (mane->manifest == NULL)
+        return;
+
+    name = strrchr(cache->addr, '/');
+    name = name == NULL ? cache->addr : name + 1;
+
+    if (KMD5SumFmtFind(mane->manifest, name, self->md5, &bin) == 0)
+        self->manifest = self->expected = true;
+    else
+        STSMSG(STS_DBG, ("%s is not found in the manifest", name));
+}
+
+/* a new download attempt from path */
+static void DigestReset(Digest *self, const VPath *path) {
+    assert(self);
+
+    self->computed = self->verified = false;
+
+    if (!self->manifest) {
+        const uint8_t *md5 = path == NULL ? NULL : VPathGetMd5(path);
+        self->expected = md5 != NULL;
+        if (md5 != NULL)
+            memmove(self->md5, md5, sizeof self->md5);
+    }
+}
+
+static rc_t _KDirectoryFileMd5(const KDirectory *self,
+    const char *path, uint8_t digest[16])
+{
+    rc_t rc = 0;
+    const KFile *f = NULL;
+    uint64_t pos = 0;
+    MD5State md5;
+
+    size_t bsize = 1024 * 1024;
+    void *buffer = malloc(bsize);
+    if (buffer == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+
+    rc = KDirectoryOpenFileRead(self, &f, "%s", path);
+    DISP_RC2(rc, "KDirectoryOpenFileRead", path);
+
+    MD5StateInit(&md5);
+
+    while (rc == 0) {
+        size_t num_read = 0;
+        rc = KFileReadAll(f, pos, buffer, bsize, &num_read);
+        DISP_RC2(rc, "Cannot KFileRead", path);
+        if (rc != 0 || num_read == 0)
+            break;
+
+        MD5StateAppend(&md5, buffer, num_read);
+        pos += num_read;
+
+        rc = Quitting();
+    }
+
+    if (rc == 0)
+        MD5StateFinish(&md5, digest);
+
+    RELEASE(KFile, f);
+    free(buffer);
+
+    return rc;
+}
+
+/* compare the downloaded file with its expected md5:
+   the file is removed when they differ */
+static rc_t MainVerifyDownload(const Main *self,
+    const char *path, Digest *digest)
+{
+    rc_t rc = 0;
+    char expected[33] = "";
+    char actual[33] = "";
+
+    assert(self && path && digest);
+
+    /* no reference or the content differs from the remote file */
+    if (!digest->expected || self->dryRun ||
+        self->stripQuals || self->eliminateQuals)
+    {
+        return 0;
+    }
+
+    /* fasp and resumed segmented downloads are read back */
+    if (!digest->computed) {
+        STSMSG(STS_DBG, ("computing md5 of %s", path));
+        rc = _KDirectoryFileMd5(self->dir, path, digest->digest);
+        if (rc != 0)
+            return rc;
+        digest->computed = true;
+    }
+
+    if (memcmp(digest->digest, digest->md5, sizeof digest->md5) == 0) {
+        STSMSG(STS_INFO, ("%s: md5 is verified", path));
+        digest->verified = true;
+        return 0;
+    }
+
+    _Md5ToHex(digest->md5, expected);
+    _Md5ToHex(digest->digest, actual);
+
+    rc = RC(rcExe, rcFile, rcValidating, rcChecksum, rcUnequal);
+    PLOGERR(klogErr, (klogErr, rc, "md5 of $(path) is $(actual), "
+        "expected $(expected)", "path=%s,actual=%s,expected=%s",
+        path, actual, expected));
+
+    digest->computed = false;
+
+    STSMSG(STS_DBG, ("removing %s", path));
+    KDirectoryRemove(self->dir, false, "%s", path);
+
+    return rc;
+}
+
+/* keep the verified md5 next to the file in md5sum format:
+   it can be revalidated later without reading the remote file */
+static rc_t _KDirectoryWriteMd5(KDirectory *self,
+    const String *cache, const Digest *digest)
+{
+    rc_t rc = 0;
+    KFile *f = NULL;
+    KMD5SumFmt *fmt = NULL;
+    const char *name = NULL;
+
+    char path[PATH_MAX] = "";
+
+    assert(self && cache && cache->addr && digest);
+
+    rc = string_printf(path, sizeof path, NULL, "%S.md5", cache);
+    DISP_RC2(rc, "string_printf(md5)", cache->addr);
+    if (rc != 0)
+        return rc;
+
+    if (!digest->verified) { /* don't keep md5 of a previous download */
+        if (KDirectoryPathType(self, "%s", path) != kptNotFound) {
+            STSMSG(STS_DBG, ("removing %s", path));
+            rc = KDirectoryRemove(self, false, "%s", path);
+        }
+        return rc;
+    }
+
+    name = strrchr(cache->addr, '/');
+    name = name == NULL ? cache->addr : name + 1;
+
+    STSMSG(STS_DBG, ("creating %s", path));
+    rc = KDirectoryCreateFile(self, &f, false, 0664, kcmInit, "%s", path);
+    DISP_RC2(rc, "Cannot OpenFileWrite", path);
+
+    if (rc == 0) {
+        rc = KMD5SumFmtMakeUpdate(&fmt, f); /* f is attached to fmt */
+        DISP_RC2(rc, "KMD5SumFmtMakeUpdate", path);
+        if (rc != 0)
+            RELEASE(KFile, f);
+    }
+
+    if (rc == 0) {
+        rc = KMD5SumFmtUpdate(fmt, name, digest->digest, true);
+        DISP_RC2(rc, "KMD5SumFmtUpdate", path);
+    }
+
+    {
+        rc_t rc2 = KMD5SumFmtRelease(fmt); /* writes the file */
+        if (rc == 0 && rc2 != 0)
+            rc = rc2;
+    }
+
+    return rc;
+}
+
+static rc_t MainDownloadHttpFile(Resolved *self, Main *mane,
+    const char *to, const char *part, const VPath * path, Digest *digest)
 {
     rc_t rc = 0;
     const KFile *in = NULL;
@@ -1221,6 +2119,8 @@ static rc_t MainDownloadHttpFile(Resolved *self,
     size_t num_read = 0;
     uint64_t opos = 0;
     size_t num_writ = 0;
+    void *buffer = NULL;
+    MD5State md5;
 
     const VPathStr * remote = NULL;
     String src;
@@ -1250,13 +2150,6 @@ static rc_t MainDownloadHttpFile(Resolved *self,
                                                : & self -> remoteHttps;
     assert(remote);
 
-    if (rc == 0 && !mane->dryRun) {
-        STSMSG(STS_DBG, ("creating %s", to));
-        rc = KDirectoryCreateFile(mane->dir, &out,
-                                  false, 0664, kcmInit | kcmParents, "%s", to);
-        DISP_RC2(rc, "Cannot OpenFileWrite", to);
-    }
-
     assert ( src . addr );
 
     if (!mane->dryRun) {
@@ -1277,8 +2170,31 @@ static rc_t MainDownloadHttpFile(Resolved *self,
             }
         }
     }
-    
+
+    /* large files of known size are fetched by concurrent range requests */
+    if (in != NULL && part != NULL && !mane->stripQuals) {
+        uint64_t size = 0;
+        if (KFileSize(in, &size) == 0 && size > mane->segmentSize) {
+            RELEASE(KFile, in);
+            return MainDownloadSegmented(self, mane, to, part, &src, size,
+                digest);
+        }
+    }
+
+    /* mane->buffer is shared by concurrent jobs */
+    buffer = mane->sched == NULL ? mane->buffer : malloc(mane->bsize);
+    if (buffer == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+
+    if (rc == 0 && !mane->dryRun) {
+        STSMSG(STS_DBG, ("creating %s", to));
+        rc = KDirectoryCreateFile(mane->dir, &out,
+                                  false, 0664, kcmInit | kcmParents, "%s", to);
+        DISP_RC2(rc, "Cannot OpenFileWrite", to);
+    }
+
     STSMSG(lvl, ("%S -> %s", & src, to));
+    MD5StateInit(&md5);
     {
         bool reliable = ! self -> isUri;
         ver_t http_vers = 0x01010000;
@@ -1306,7 +2222,7 @@ static rc_t MainDownloadHttpFile(Resolved *self,
 
                 while ( rc == 0 ) {
                     rc = KStreamRead
-                        ( s, mane -> buffer, mane -> bsize, & num_read );
+                        ( s, buffer, mane -> bsize, & num_read );
                     if ( rc != 0 || num_read == 0) {
                         DISP_RC2 ( rc, "Cannot KStreamRead",
                                    & src . addr );
@@ -1316,13 +2232,16 @@ static rc_t MainDownloadHttpFile(Resolved *self,
                     if (mane->dryRun)
                         break;
 
+                    MainThrottle(mane, num_read);
+
                     rc = KFileWriteAll
-                        ( out, opos, mane -> buffer, num_read, & num_writ);
+                        ( out, opos, buffer, num_read, & num_writ);
                     DISP_RC2 ( rc, "Cannot KFileWrite", to );
                     if ( rc == 0 && num_writ != num_read ) {
                         rc = RC ( rcExe,
                             rcFile, rcCopying, rcTransfer, rcIncomplete );
                     }
+                    MD5StateAppend ( & md5, buffer, num_writ );
                     opos += num_writ;
                 }
 
@@ -1337,6 +2256,14 @@ static rc_t MainDownloadHttpFile(Resolved *self,
 
     RELEASE(KFile, out);
 
+    if (buffer != mane->buffer)
+        free(buffer);
+
+    if (rc == 0 && !mane->dryRun && digest != NULL) {
+        MD5StateFinish(&md5, digest->digest);
+        digest->computed = true;
+    }
+
     if (rc == 0 && !mane->dryRun)
         STSMSG(STS_INFO, ("%s (%ld)", to, opos));
 
@@ -1422,56 +2349,218 @@ static rc_t MainDownloadAscp(const Resolved *self, Main *mane,
 
     assert(mane->ascp && mane->asperaKey);
 
-    memset(&opt, 0, sizeof opt);
+    memset(&opt, 0, sizeof opt);
+
+    rc = VPathReadUri(path, spath, sizeof spath, &len);
+    if (rc != 0) {
+        DISP_RC(rc, "VPathReadUri(MainDownloadAscp)");
+        return rc;
+    }
+    else {
+        String str;
+        char *query = string_chr(spath, len, '?');
+        if (query != NULL) {
+            *query = '\0';
+            len = query - spath;
+        }
+        StringInit(&str, spath, len, (uint32_t)len);
+        if (!_StringIsFasp(&str, &src))
+            return RC(rcExe, rcFile, rcCopying, rcSchema, rcInvalid);
+    }
+
+    if (mane->ascpParams != NULL) {
+        opt.ascp_options = mane->ascpParams;
+    }
+    else if (mane->ascpMaxRate != NULL) {
+        size_t sz = string_copy(opt.target_rate, sizeof opt.target_rate,
+            mane->ascpMaxRate->addr, mane->ascpMaxRate->size);
+        if (sz < sizeof opt.target_rate) {
+            return RC(rcExe, rcFile, rcCopying, rcBuffer, rcInsufficient);
+        }
+    }
+
+    opt.name = self->name;
+    opt.src_size = self->remoteSz;
+    opt.heartbeat = mane->heartbeat;
+    opt.quitting = Quitting;
+    opt.dryRun = mane->dryRun;
+
+    return aspera_get(mane->ascp, mane->asperaKey, src, to, &opt);
+}
+
+/********** local mirrors **********/
+
+static rc_t MainAddMirror(Main *self, const char *dir, size_t size) {
+    char **mirrors = NULL;
+
+    assert(self && dir);
+
+    while (size > 1 && dir[size - 1] == '/')
+        --size;
+    if (size == 0)
+        return 0;
+
+    mirrors = realloc(self->mirrors, (self->mirrorCount + 1) * sizeof *mirrors);
+    if (mirrors == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    self->mirrors = mirrors;
+
+    mirrors[self->mirrorCount] = string_dup(dir, size);
+    if (mirrors[self->mirrorCount] == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+
+    STSMSG(STS_DBG, ("local mirror: %s", mirrors[self->mirrorCount]));
+    ++self->mirrorCount;
+
+    return 0;
+}
+
+/* md5 of a mirror file saved next to it by an earlier prefetch run */
+static bool _KDirectoryReadMd5(const KDirectory *self,
+    const char *path, const char *name, uint8_t md5[16])
+{
+    bool bin = false;
+    bool found = false;
+    const KFile *f = NULL;
+    const KMD5SumFmt *fmt = NULL;
+
+    if (KDirectoryOpenFileRead(self, &f, "%s.md5", path) != 0)
+        return false;
+
+    if (KMD5SumFmtMakeRead(&fmt, f) != 0) { /* f is attached to fmt */
+        KFileRelease(f);
+        return false;
+    }
+
+    found = KMD5SumFmtFind(fmt, name, md5, &bin) == 0;
+
+    KMD5SumFmtRelease(fmt);
+
+    return found;
+}
+
+static const char *_EPlaceName(EPlace how) {
+    switch (how) {
+        case ePlaceReflink   : return "reflink";
+        case ePlaceHardlink  : return "hard link";
+        case ePlaceKernelCopy: return "in-kernel copy";
+        case ePlaceCopy      : return "copy";
+        default              : return "none";
+    }
+}
+
+/* place a mirror copy of the remote file at tmp;
+   returns false when no mirror has a copy with the expected size and md5 */
+static bool MainDownloadFromMirror(const Main *self, const Resolved *resolved,
+    const Item *item, const String *cache, const char *tmp, Digest *digest)
+{
+    uint32_t i = 0;
+    uint64_t size = 0;
+    const char *name = NULL;
+
+    assert(self && resolved && item && cache && cache->addr && tmp && digest);
+
+    if (self->mirrorCount == 0 || self->dryRun ||
+        self->stripQuals || self->eliminateQuals)
+    {
+        return false;
+    }
+
+    size = resolved->remoteSz;
+
+    if (resolved->respFile != NULL) {
+        KSrvRespFileIterator *fi = NULL;
+        const VPath *path = NULL;
+
+        if (KSrvRespFileGetSize(resolved->respFile, &size) != 0)
+            size = 0;
+
+        if (KSrvRespFileMakeIterator(resolved->respFile, &fi) == 0 &&
+            KSrvRespFileIteratorNextPath(fi, &path) == 0)
+        {
+            DigestReset(digest, path);
+        }
+
+        VPathRelease(path);
+        KSrvRespFileIteratorRelease(fi);
+    }
+    else if (resolved->remoteHttps.path != NULL)
+        DigestReset(digest, resolved->remoteHttps.path);
+    else if (resolved->remoteHttp.path != NULL)
+        DigestReset(digest, resolved->remoteHttp.path);
+    else
+        DigestReset(digest, resolved->remoteFasp.path);
+
+    name = strrchr(cache->addr, '/');
+    name = name == NULL ? cache->addr : name + 1;
+
+    for (i = 0; i < self->mirrorCount; ++i) {
+        rc_t rc = 0;
+        uint64_t sz = 0;
+        uint8_t md5[16];
+        EPlace how = ePlaceNone;
+
+        char src[PATH_MAX] = "";
+
+        rc = string_printf(src, sizeof src, NULL,
+            "%s/%s", self->mirrors[i], name);
+        if (rc != 0 ||
+            (KDirectoryPathType(self->dir, "%s", src) & ~kptAlias) != kptFile)
+        {
+            continue;
+        }
+
+        rc = KDirectoryFileSize(self->dir, &sz, "%s", src);
+        if (rc != 0 || (size > 0 && sz != size)) {
+            STSMSG(STS_INFO, ("%s: size %lu, expected %lu: ignored",
+                src, sz, size));
+            continue;
+        }
 
-    rc = VPathReadUri(path, spath, sizeof spath, &len);
-    if (rc != 0) {
-        DISP_RC(rc, "VPathReadUri(MainDownloadAscp)");
-        return rc;
-    }
-    else {
-        String str;
-        char *query = string_chr(spath, len, '?');
-        if (query != NULL) {
-            *query = '\0';
-            len = query - spath;
+        /* a verified md5 of the mirror saves reading the file */
+        if (digest->expected && _KDirectoryReadMd5(self->dir, src, name, md5))
+        {
+            if (memcmp(md5, digest->md5, sizeof md5) != 0) {
+                STSMSG(STS_INFO, ("%s: md5 differs: ignored", src));
+                continue;
+            }
+            memmove(digest->digest, md5, sizeof md5);
+            digest->computed = true;
         }
-        StringInit(&str, spath, len, (uint32_t)len);
-        if (!_StringIsFasp(&str, &src))
-            return RC(rcExe, rcFile, rcCopying, rcSchema, rcInvalid);
-    }
 
-    if (mane->ascpParams != NULL) {
-        opt.ascp_options = mane->ascpParams;
-    }
-    else if (mane->ascpMaxRate != NULL) {
-        size_t sz = string_copy(opt.target_rate, sizeof opt.target_rate,
-            mane->ascpMaxRate->addr, mane->ascpMaxRate->size);
-        if (sz < sizeof opt.target_rate) {
-            return RC(rcExe, rcFile, rcCopying, rcBuffer, rcInsufficient);
+        STSMSG(STS_DBG, ("%s -> %s", src, tmp));
+        rc = PlaceFile(src, tmp, &how);
+        if (rc != 0) {
+            PLOGERR(klogWarn, (klogWarn, rc,
+                "cannot copy $(path) from local mirror", "path=%s", src));
+            digest->computed = false;
+            continue;
         }
-    }
 
-    opt.name = self->name;
-    opt.src_size = self->remoteSz;
-    opt.heartbeat = mane->heartbeat;
-    opt.quitting = Quitting;
-    opt.dryRun = mane->dryRun;
+        if (MainVerifyDownload(self, tmp, digest) != 0)
+            continue;
 
-    return aspera_get(mane->ascp, mane->asperaKey, src, to, &opt);
+        ItemMsg(item, " found in local mirror %s: %s",
+            self->mirrors[i], _EPlaceName(how));
+        return true;
+    }
+
+    return false;
 }
 
 static rc_t MainDoDownload(Resolved *self, const Item * item,
-                        bool isDependency, const VPath * path, const char * to)
+    bool isDependency, const VPath * path, const char * to, const char * part,
+    Digest * digest)
 {
     bool canceled = false;
     rc_t rc = 0;
     Main * mane = NULL;
     String cache;
     memset(&cache, 0, sizeof cache);
-    assert(item);
+    assert(item && digest);
     mane = item->mane;
     assert(mane);
+    DigestReset(digest, path);
     {
         char spath[PATH_MAX] = "";
         KStsLevel lvl = STS_DBG;
@@ -1499,7 +2588,7 @@ static rc_t MainDoDownload(Resolved *self, const Item * item,
         ascp = _SchemeIsFasp(&scheme);
         if (!mane->noAscp) {
             if (ascp) {
-                STSMSG(STS_TOP, (" Downloading via fasp..."));
+                ItemMsg(item, " Downloading via fasp...");
                 if (mane->forceAscpFail)
                     rc = 1;
                 else if (mane->eliminateQuals) {
@@ -1512,16 +2601,19 @@ static rc_t MainDoDownload(Resolved *self, const Item * item,
                         "during fasp download");
                     rc = 1;
                 }
-                else
+                else {
                     rd = MainDownloadAscp(self, mane, to, path);
+                    if (rd == 0)
+                        rd = MainVerifyDownload(mane, to, digest);
+                }
                 if (rd == 0)
-                    STSMSG(STS_TOP, (" fasp download succeed"));
+                    ItemMsg(item, " fasp download succeed");
                 else {
                     rc_t rc = Quitting();
                     if (rc != 0)
                         canceled = true;
                     else
-                        STSMSG(STS_TOP, (" fasp download failed"));
+                        ItemMsg(item, " fasp download failed");
                 }
             }
         }
@@ -1529,23 +2621,36 @@ static rc_t MainDoDownload(Resolved *self, const Item * item,
             !canceled && !mane->noHttp) /*&& !self->isUri))*/
         {
             bool https = true;
-            STSMSG(STS_TOP,
-                (" Downloading via %s...", https ? "https" : "http"));
+            ItemMsg(item, " Downloading via %s...", https ? "https" : "http");
             if (mane->eliminateQuals)
                 rd = MainDownloadCacheFile(self, mane,
                     cache.addr, mane->eliminateQuals && !isDependency);
-            else
-                rd = MainDownloadHttpFile(self, mane, to, path);
+            else {
+                int attempt = 0;
+                for (attempt = 1; ; ++attempt) {
+                    rd = MainDownloadHttpFile(self, mane, to, part, path,
+                        digest);
+                    if (rd == 0)
+                        rd = MainVerifyDownload(mane, to, digest);
+                    if (rd == 0 || attempt >= VERIFY_RETRIES ||
+                        GetRCObject(rd) != rcChecksum ||
+                        GetRCState(rd) != rcUnequal)
+                    {
+                        break;
+                    }
+                    ItemMsg(item, " md5 mismatch: downloading again...");
+                }
+            }
             if (rd == 0)
-                STSMSG(STS_TOP, (" %s download succeed",
-                    https ? "https" : "http"));
+                ItemMsg(item, " %s download succeed",
+                    https ? "https" : "http");
             else {
                 rc_t rc = Quitting();
                 if (rc != 0)
                     canceled = true;
                 else
-                    STSMSG(STS_TOP, (" %s download failed",
-                        https ? "https" : "http"));
+                    ItemMsg(item, " %s download failed",
+                        https ? "https" : "http");
             }
         }
         if ( rc == 0 && rd != 0 )
@@ -1561,8 +2666,11 @@ static rc_t MainDownload(Resolved *self, const Item * item,
     rc_t rc = 0;
     KFile *flock = NULL;
     Main * mane = NULL;
+    bool claimed = false;
+    Digest digest;
 
     char tmp[PATH_MAX] = "";
+    char part[PATH_MAX] = "";
     char lock[PATH_MAX] = "";
 
     const VPath * vcache = NULL;
@@ -1599,7 +2707,18 @@ static rc_t MainDownload(Resolved *self, const Item * item,
         STSMSG(lvl, ("#################### cache(%S)", & cache));
     }
 
-    if (mane->force != eForceYES &&
+    DigestInit(&digest, mane, &cache);
+
+    if (mane->claimLock != NULL) {
+        rc = MainClaimDownload(mane, cache.addr, &claimed);
+        if (rc != 0)
+            return rc;
+        if (!claimed) {
+            STSMSG(STS_INFO, ("%s has just been downloaded", cache.addr));
+            return 0;
+        }
+    }
+    else if (mane->force != eForceYES &&
         MainHasDownloaded(mane, cache.addr))
     {
         STSMSG(STS_INFO, ("%s has just been downloaded", cache.addr));
@@ -1612,6 +2731,9 @@ static rc_t MainDownload(Resolved *self, const Item * item,
     if (rc == 0 && !mane->eliminateQuals)
         rc = _KDirectoryMkTmpName(mane->dir, & cache, tmp, sizeof tmp);
 
+    if (rc == 0 && !mane->eliminateQuals)
+        rc = _KDirectoryMkPartName(mane->dir, & cache, part, sizeof part);
+
     if (KDirectoryPathType(mane->dir, "%s", lock) != kptNotFound) {
         if (mane->force != eForceYES) {
             KTime_t date = 0;
@@ -1624,6 +2746,8 @@ static rc_t MainDownload(Resolved *self, const Item * item,
                     PLOGERR(klogWarn, (klogWarn, rc,
                         "Lock file $(file) exists: download canceled",
                         "file=%s", lock));
+                    if (claimed)
+                        MainUnclaimDownload(mane, cache.addr, false);
                     return rc;
                 }
                 else {
@@ -1654,7 +2778,12 @@ static rc_t MainDownload(Resolved *self, const Item * item,
 
     assert(!mane->noAscp || !mane->noHttp);
 
-    if (self->respFile != NULL) {
+    if (rc == 0 &&
+        MainDownloadFromMirror(mane, self, item, & cache, tmp, & digest))
+    {
+        STSMSG(STS_DBG, ("%s is placed from a local mirror", tmp));
+    }
+    else if (self->respFile != NULL) {
         rc_t rd = 0;
         KSrvRespFileIterator * fi = NULL;
         rc = KSrvRespFileMakeIterator(self->respFile, &fi);
@@ -1666,7 +2795,8 @@ static rc_t MainDownload(Resolved *self, const Item * item,
                     rc = rd;
                     break;
                 }
-                rd = MainDoDownload(self, item, isDependency, path, tmp);
+                rd = MainDoDownload(self, item, isDependency, path, tmp, part,
+                    &digest);
 #if 0
                 bool ascp = false;
                 String scheme;
@@ -1730,7 +2860,7 @@ static rc_t MainDownload(Resolved *self, const Item * item,
                         rd = MainDownloadCacheFile(self, mane,
                             cache.addr, mane->eliminateQuals && !isDependency);
                     else
-                        rd = MainDownloadHttpFile(self, mane, tmp, path);
+                        rd = MainDownloadHttpFile(self, mane, tmp, part, path);
                     if (rd == 0)
                         STSMSG(STS_TOP, (" %s download succeed",
                             https ? "https" : "http"));
@@ -1755,19 +2885,19 @@ static rc_t MainDownload(Resolved *self, const Item * item,
         do {
             if (self->remoteFasp.path != NULL) {
                 rc = MainDoDownload(self, item,
-                    isDependency, self->remoteFasp.path, tmp);
+                    isDependency, self->remoteFasp.path, tmp, part, &digest);
                 if (rc == 0)
                     break;
             }
             if (self->remoteHttp.path != NULL) {
                 rc = MainDoDownload(self, item,
-                    isDependency, self->remoteHttp.path, tmp);
+                    isDependency, self->remoteHttp.path, tmp, part, &digest);
                 if (rc == 0)
                     break;
             }
             if (self->remoteHttps.path != NULL) {
                 rc = MainDoDownload(self, item,
-                    isDependency, self->remoteHttps.path, tmp);
+                    isDependency, self->remoteHttps.path, tmp, part, &digest);
                 if (rc == 0)
                     break;
             }
@@ -1789,7 +2919,14 @@ static rc_t MainDownload(Resolved *self, const Item * item,
         }
     }
 
-    if (rc == 0)
+    if (rc == 0 && !mane->eliminateQuals && !mane->dryRun) {
+        rc_t rc2 = _KDirectoryWriteMd5(mane->dir, & cache, & digest);
+        if (rc2 != 0)
+            PLOGERR(klogWarn, (klogWarn, rc2,
+                "cannot save md5 of $(path)", "path=%S", & cache));
+    }
+
+    if (rc == 0 && !claimed)
         rc = MainDownloaded(mane, cache.addr);
 
     if (rc == 0 && !mane->eliminateQuals) {
@@ -1805,6 +2942,13 @@ static rc_t MainDownload(Resolved *self, const Item * item,
             rc = rc2;
     }
 
+    /* the lock file is removed: let waiting jobs go on */
+    if (claimed) {
+        rc_t rc2 = MainUnclaimDownload(mane, cache.addr, rc == 0);
+        if (rc == 0 && rc2 != 0)
+            rc = rc2;
+    }
+
     return rc;
 }
 
@@ -2276,8 +3420,7 @@ static rc_t ItemInitResolved(Item *self, VResolver *resolver, KDirectory *dir,
                     RELEASE(KFile, f);
                 }
                 else
-                    STSMSG(STS_TOP,
-                        ("'%s' is a local non-kart file", self->desc));
+                    ItemMsg(self, "'%s' is a local non-kart file", self->desc);
                 return 0;
             }
         }
@@ -2327,16 +3470,10 @@ static rc_t ItemInitResolved(Item *self, VResolver *resolver, KDirectory *dir,
 }
 
 /* resolve: locate */
-static rc_t ItemResolve(Item *item, int32_t row) {
-    Resolved *self = NULL;
+static void ItemSetNumber(Item *item, int32_t row) {
     static int n = 0;
-    rc_t rc = 0;
-    bool ascp = false;
 
-    assert(item && item->mane);
-
-    self = &item->resolved;
-    assert(self->type);
+    assert(item);
 
     ++n;
     if (row > 0 &&
@@ -2346,6 +3483,21 @@ static rc_t ItemResolve(Item *item, int32_t row) {
     }
 
     item->number = n;
+}
+
+static rc_t ItemResolve(Item *item, int32_t row) {
+    Resolved *self = NULL;
+    rc_t rc = 0;
+    bool ascp = false;
+
+    assert(item && item->mane);
+
+    self = &item->resolved;
+    assert(self->type);
+
+    /* concurrent jobs are numbered when scheduled */
+    if (item->number == 0)
+        ItemSetNumber(item, row);
 
     ascp = MainUseAscp(item->mane);
     if (self->type == eRunTypeList) {
@@ -2410,42 +3562,44 @@ static void logMaxSize(size_t maxSize) {
         "size=%zu", maxSize));
 }
 
-static void logBigFile(int n, const char *name, size_t size) {
+static void logBigFile(const Item *item, int n, const char *name,
+    size_t size)
+{
     if (size / 1024 < 10) {
-        STSMSG(STS_TOP,
-            ("%d) '%s' (%,zuB) is larger than maximum allowed: skipped\n",
-                n, name, size));
+        ItemMsg(item,
+            "%d) '%s' (%,zuB) is larger than maximum allowed: skipped\n",
+                n, name, size);
         return;
     }
 
     size /= 1024;
     if (size / 1024 < 10) {
-        STSMSG(STS_TOP,
-            ("%d) '%s' (%,zuKB) is larger than maximum allowed: skipped\n",
-                n, name, size));
+        ItemMsg(item,
+            "%d) '%s' (%,zuKB) is larger than maximum allowed: skipped\n",
+                n, name, size);
         return;
     }
 
     size /= 1024;
     if (size / 1024 < 10) {
-        STSMSG(STS_TOP,
-            ("%d) '%s' (%,zuMB) is larger than maximum allowed: skipped\n",
-                n, name, size));
+        ItemMsg(item,
+            "%d) '%s' (%,zuMB) is larger than maximum allowed: skipped\n",
+                n, name, size);
         return;
     }
 
     size /= 1024;
     if (size / 1024 < 10) {
-        STSMSG(STS_TOP,
-            ("%d) '%s' (%,zuGB) is larger than maximum allowed: skipped\n",
-                n, name, size));
+        ItemMsg(item,
+            "%d) '%s' (%,zuGB) is larger than maximum allowed: skipped\n",
+                n, name, size);
         return;
     }
 
     size /= 1024;
-    STSMSG(STS_TOP,
-        ("%d) '%s' (%,zuTB) is larger than maximum allowed: skipped\n",
-            n, name, size));
+    ItemMsg(item,
+        "%d) '%s' (%,zuTB) is larger than maximum allowed: skipped\n",
+            n, name, size);
 }
 
 /* download if not found; obey size restriction */
@@ -2484,18 +3638,18 @@ static rc_t ItemDownload(Item *item) {
             return rc;
         }
         if (undersized) {
-            STSMSG(STS_TOP,
-               ("%d) '%s' (%,zu KB) is smaller than minimum allowed: skipped\n",
-                n, self->name, self->remoteSz / 1024));
+            ItemMsg(item,
+               "%d) '%s' (%,zu KB) is smaller than minimum allowed: skipped\n",
+                n, self->name, self->remoteSz / 1024);
             skip = true;
         }
         else if (oversized) {
             logMaxSize(item->mane->maxSize);
-            logBigFile(n, self->name, self->remoteSz);
+            logBigFile(item, n, self->name, self->remoteSz);
             skip = true;
         }
 
-        rc = ResolvedLocal(self, item->mane, &isLocal,
+        rc = ResolvedLocal(self, item, &isLocal,
             skip ? eForceNo : item->mane->force);
 
         if (rc == 0) {
@@ -2522,11 +3676,11 @@ static rc_t ItemDownload(Item *item) {
                 const char * sep = string_rchr ( start, size, '/' );
                 if ( sep != NULL )
                     start = sep + 1;
-                STSMSG(STS_TOP, ("%d) '%s' is found locally (%.*s)",
-                    n, self->name, ( uint32_t ) ( end - start ), start));
+                ItemMsg(item, "%d) '%s' is found locally (%.*s)",
+                    n, self->name, ( uint32_t ) ( end - start ), start);
             }
             else
-                STSMSG(STS_TOP, ("%d) '%s' is found locally", n, self->name));
+                ItemMsg(item, "%d) '%s' is found locally", n, self->name);
             if (self->local.str != NULL) {
                 VPathStrFini(&self->path);
                 rc = StringCopy(&self->path.str, self->local.str);
@@ -2539,7 +3693,7 @@ static rc_t ItemDownload(Item *item) {
                 "name=%s", self->name));
         }
         else {
-            STSMSG(STS_TOP, ("%d) Downloading '%s'...", n, self->name));
+            ItemMsg(item, "%d) Downloading '%s'...", n, self->name);
             rc = MainDownload(self, item, item->isDependency);
             if (rc == 0) {
                 if (self->inOutDir) {
@@ -2550,19 +3704,19 @@ static rc_t ItemDownload(Item *item) {
                     if ( sep != NULL )
                         start = sep + 1;
                     if ( item->mane->outDir != NULL )
-                        STSMSG(STS_TOP,
-                            ("%d) '%s' was downloaded successfully (%s/%.*s)",
+                        ItemMsg(item,
+                            "%d) '%s' was downloaded successfully (%s/%.*s)",
                             n, self->name, item->mane->outDir,
-                            ( uint32_t ) ( end - start ), start));
+                            ( uint32_t ) ( end - start ), start);
                     else
-                        STSMSG(STS_TOP,
-                            ("%d) '%s' was downloaded successfully (%.*s)",
+                        ItemMsg(item,
+                            "%d) '%s' was downloaded successfully (%.*s)",
                             n, self->name,
-                            ( uint32_t ) ( end - start ), start));
+                            ( uint32_t ) ( end - start ), start);
                 }
                 else
-                    STSMSG(STS_TOP, ("%d) '%s' was downloaded successfully",
-                                       n, self->name));
+                    ItemMsg(item, "%d) '%s' was downloaded successfully",
+                                  n, self->name);
                 if (self->cache != NULL) {
                     VPathStrFini(&self->path);
                     rc = StringCopy(&self->path.str, self->cache);
@@ -2571,12 +3725,12 @@ static rc_t ItemDownload(Item *item) {
             else if (rc != SILENT_RC(rcExe,
                 rcProcess, rcExecuting, rcProcess, rcCanceled))
             {
-                STSMSG(STS_TOP, ("%d) failed to download %s", n, self->name));
+                ItemMsg(item, "%d) failed to download %s", n, self->name);
             }
         }
     }
     else {
-        STSMSG(STS_TOP, ("%d) cannot locate '%s'", n, self->name));
+        ItemMsg(item, "%d) cannot locate '%s'", n, self->name);
     }
 
     return rc;
@@ -2713,9 +3867,9 @@ static rc_t ItemDownloadDependencies(Item *item) {
     if (rc == 0 && deps != NULL) {
         rc = VDBDependenciesCount(deps, &count);
         if (rc == 0) {
-            STSMSG(STS_TOP, ("'%s' has %d%s dependenc%s", resolved->name,
+            ItemMsg(item, "'%s' has %d%s dependenc%s", resolved->name,
                 count, item->mane->check_all ? "" : " unresolved",
-                count == 1 ? "y" : "ies"));
+                count == 1 ? "y" : "ies");
         }
         else {
             DISP_RC2(rc, "Failed to check dependencies", resolved->name);
@@ -2764,6 +3918,9 @@ static rc_t ItemDownloadDependencies(Item *item) {
                 ditem->desc = ncbiAcc;
                 ditem->mane = item->mane;
                 ditem->isDependency = true;
+                ditem->log = item->log;
+                if (ditem->log != NULL) /* numbering must not be racy */
+                    ditem->number = item->number;
                 ditem->seq_id = string_dup_measure ( seq_id, NULL );
                 if ( ditem->seq_id == NULL )
                     return RC(rcExe,
@@ -3375,6 +4532,42 @@ static const char* HBEAT_USAGE[] = {
     "Time period in minutes to display download progress",
     "(0: no progress), default: 1", NULL };
 
+#define DEFAULT_CONNECTIONS "4"
+#define CONN_OPTION "connections"
+static const char* CONN_USAGE[] = {
+    "Number of concurrent range requests per HTTP download",
+    "(1 - 32), default: " DEFAULT_CONNECTIONS, NULL };
+
+#define DEFAULT_JOBS "1"
+#define JOBS_OPTION "jobs"
+static const char* JOBS_USAGE[] = {
+    "Number of kart items or accessions to resolve and download",
+    "concurrently (1 - 32), default: " DEFAULT_JOBS, NULL };
+
+#define RATE_OPTION "max-rate"
+static const char* RATE_USAGE[] = {
+    "Limit of the total HTTP download rate in KB per second.",
+    "Default: unlimited", NULL };
+
+#define MANIFEST_OPTION "manifest"
+static const char* MANIFEST_USAGE[] = {
+    "File of expected MD5 checksums of downloaded files",
+    "in md5sum format. Default: use checksums reported by the resolver",
+    NULL };
+
+#define MIRROR_OPTION "mirror"
+static const char* MIRROR_USAGE[] = {
+    "Local directory with copies of files to use instead of downloading",
+    "them (can be repeated). More directories are read from configuration",
+    "node /tools/prefetch/mirrors (separated by ':')", NULL };
+
+#define DEFAULT_SEGMENT_SIZE "8M"
+#define SEGM_OPTION "segment-size"
+static const char* SEGM_USAGE[] = {
+    "Size of a range request in KB. Larger HTTP downloads are split",
+    "into segments and resumed from the completed ones when restarted.",
+    "Default: " DEFAULT_SEGMENT_SIZE, NULL };
+
 #define ROWS_OPTION "rows"
 #define ROWS_ALIAS  "R"
 static const char* ROWS_USAGE[] =
@@ -3429,6 +4622,12 @@ static OptDef OPTIONS[] = {
 ,{ SIZE_OPTION        , SIZE_ALIAS        , NULL, SIZE_USAGE  , 1, true ,false }
 ,{ FORCE_OPTION       , FORCE_ALIAS       , NULL, FORCE_USAGE , 1, true, false }
 ,{ HBEAT_OPTION       , HBEAT_ALIAS       , NULL, HBEAT_USAGE , 1, true, false }
+,{ CONN_OPTION        , NULL              , NULL, CONN_USAGE  , 1, true, false }
+,{ SEGM_OPTION        , NULL              , NULL, SEGM_USAGE  , 1, true, false }
+,{ JOBS_OPTION        , NULL              , NULL, JOBS_USAGE  , 1, true, false }
+,{ RATE_OPTION        , NULL              , NULL, RATE_USAGE  , 1, true, false }
+,{ MANIFEST_OPTION    , NULL              ,NULL,MANIFEST_USAGE ,1, true, false }
+,{ MIRROR_OPTION      , NULL              , NULL, MIRROR_USAGE, 0, true, false }
 ,{ ELIM_QUALS_OPTION  , NULL             ,NULL,ELIM_QUALS_USAGE,1, false,false }
 ,{ CHECK_ALL_OPTION   , CHECK_ALL_ALIAS   ,NULL,CHECK_ALL_USAGE,1, false,false }
 ,{ LIST_OPTION        , LIST_ALIAS        , NULL, LIST_USAGE  , 1, false,false }
@@ -3655,6 +4854,137 @@ option_name = DRY_RUN_OPTION;
             self->heartbeat = (uint64_t)f;
         }
 
+/* CONN_OPTION */
+        {
+            const char *val = DEFAULT_CONNECTIONS;
+            rc = ArgsOptionCount(self->args, CONN_OPTION, &pcount);
+            if (rc != 0) {
+                LOGERR(klogErr,
+                    rc, "Failure to get '" CONN_OPTION "' argument");
+                break;
+            }
+            if (pcount > 0) {
+                rc = ArgsOptionValue(self->args, CONN_OPTION, 0, (const void **)&val);
+                if (rc != 0) {
+                    LOGERR(klogErr, rc,
+                        "Failure to get '" CONN_OPTION "' argument value");
+                    break;
+                }
+            }
+            self->connections = atoi(val);
+            if (self->connections < 1 || self->connections > MAX_CONNECTIONS) {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR(klogErr, rc, "Bad '" CONN_OPTION "' argument value");
+                break;
+            }
+        }
+
+/* SEGM_OPTION */
+        {
+            const char *val = DEFAULT_SEGMENT_SIZE;
+            rc = ArgsOptionCount(self->args, SEGM_OPTION, &pcount);
+            if (rc != 0) {
+                LOGERR(klogErr,
+                    rc, "Failure to get '" SEGM_OPTION "' argument");
+                break;
+            }
+            if (pcount > 0) {
+                rc = ArgsOptionValue(self->args, SEGM_OPTION, 0, (const void **)&val);
+                if (rc != 0) {
+                    LOGERR(klogErr, rc,
+                        "Failure to get '" SEGM_OPTION "' argument value");
+                    break;
+                }
+            }
+            self->segmentSize = _sizeFromString(val);
+            if (self->segmentSize == 0) {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR(klogErr, rc, "Segment size is zero");
+                break;
+            }
+        }
+
+/* JOBS_OPTION */
+        {
+            const char *val = DEFAULT_JOBS;
+            rc = ArgsOptionCount(self->args, JOBS_OPTION, &pcount);
+            if (rc != 0) {
+                LOGERR(klogErr,
+                    rc, "Failure to get '" JOBS_OPTION "' argument");
+                break;
+            }
+            if (pcount > 0) {
+                rc = ArgsOptionValue(self->args, JOBS_OPTION, 0, (const void **)&val);
+                if (rc != 0) {
+                    LOGERR(klogErr, rc,
+                        "Failure to get '" JOBS_OPTION "' argument value");
+                    break;
+                }
+            }
+            self->jobs = atoi(val);
+            if (self->jobs < 1 || self->jobs > MAX_CONNECTIONS) {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR(klogErr, rc, "Bad '" JOBS_OPTION "' argument value");
+                break;
+            }
+        }
+
+/* RATE_OPTION */
+        rc = ArgsOptionCount(self->args, RATE_OPTION, &pcount);
+        if (rc != 0) {
+            LOGERR(klogErr, rc, "Failure to get '" RATE_OPTION "' argument");
+            break;
+        }
+        if (pcount > 0) {
+            const char *val = NULL;
+            rc = ArgsOptionValue(self->args, RATE_OPTION, 0, (const void **)&val);
+            if (rc != 0) {
+                LOGERR(klogErr, rc,
+                    "Failure to get '" RATE_OPTION "' argument value");
+                break;
+            }
+            self->maxRate = _sizeFromString(val);
+        }
+
+/* MANIFEST_OPTION */
+        rc = ArgsOptionCount(self->args, MANIFEST_OPTION, &pcount);
+        if (rc != 0) {
+            LOGERR(klogErr,
+                rc, "Failure to get '" MANIFEST_OPTION "' argument");
+            break;
+        }
+        if (pcount > 0) {
+            rc = ArgsOptionValue(self->args,
+                MANIFEST_OPTION, 0, (const void **)&self->manifestFile);
+            if (rc != 0) {
+                LOGERR(klogErr, rc,
+                    "Failure to get '" MANIFEST_OPTION "' argument value");
+                break;
+            }
+        }
+
+/* MIRROR_OPTION */
+        {
+            uint32_t i = 0;
+            rc = ArgsOptionCount(self->args, MIRROR_OPTION, &pcount);
+            if (rc != 0) {
+                LOGERR(klogErr,
+                    rc, "Failure to get '" MIRROR_OPTION "' argument");
+                break;
+            }
+            for (i = 0; i < pcount && rc == 0; ++i) {
+                const char *val = NULL;
+                rc = ArgsOptionValue(self->args, MIRROR_OPTION, i, (const void **)&val);
+                if (rc != 0)
+                    LOGERR(klogErr, rc,
+                        "Failure to get '" MIRROR_OPTION "' argument value");
+                else
+                    rc = MainAddMirror(self, val, strlen(val));
+            }
+            if (rc != 0)
+                break;
+        }
+
 /* ROWS_OPTION */
         rc = ArgsOptionCount(self->args, ROWS_OPTION, &pcount);
         if (rc != 0) {
@@ -3995,6 +5325,17 @@ rc_t CC Usage(const Args *args) {
         }
         else if (strcmp(opt->name, ASCP_PAR_OPTION) == 0)
             param = "value";
+        else if (strcmp(opt->name, CONN_OPTION) == 0 ||
+                 strcmp(opt->name, JOBS_OPTION) == 0)
+            param = "value";
+        else if (strcmp(opt->name, RATE_OPTION) == 0)
+            param = "size";
+        else if (strcmp(opt->name, SEGM_OPTION) == 0)
+            param = "size";
+        else if (strcmp(opt->name, MANIFEST_OPTION) == 0)
+            param = "FILE";
+        else if (strcmp(opt->name, MIRROR_OPTION) == 0)
+            param = "DIRECTORY";
         else if (strcmp(opt->name, DRY_RUN_OPTION) == 0)
             continue; /* debug option */
 #if _DEBUGGING
@@ -4052,12 +5393,92 @@ static int64_t CC bstKrtSort(const BSTNode *item, const BSTNode *n) {
     return 0;
 }
 
+/*********** concurrent jobs **********/
+typedef struct {
+    Item *item;
+    int32_t row;
+    bool resolved; /* kart item ordered by size: only download is left */
+    bool newline;  /* print an empty line before the status of item */
+    ItemLog log;
+} ItemJob;
+
+static rc_t CC ItemJobRun(void *data) {
+    rc_t rc = 0;
+    ItemJob *self = data;
+
+    assert(self && self->item);
+
+    if (self->resolved) {
+        /* failures are not reported: the same as bstKrtDownload does */
+        if (ItemDownload(self->item) == 0)
+            ItemPostDownload(self->item, self->item->number);
+    }
+    else
+        rc = ItemProcess(self->item, self->row);
+
+    return rc;
+}
+
+static void CC ItemJobDone(void *data, rc_t status) {
+    rc_t rc = 0;
+    ItemJob *self = data;
+
+    assert(self);
+
+    if (self->newline)
+        OUTMSG(("\n"));
+
+    ItemLogPrint(&self->log);
+    ItemLogFini(&self->log);
+
+    RELEASE(Item, self->item);
+    free(self);
+}
+
+/* the scheduler takes ownership of the item */
+static rc_t MainSchedule(Main *self, Item *item, int32_t row, bool resolved,
+    bool newline)
+{
+    rc_t rc = 0;
+    ItemJob *job = NULL;
+
+    assert(self && self->sched && item);
+
+    job = calloc(1, sizeof *job);
+    if (job == NULL) {
+        RELEASE(Item, item);
+        return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+    }
+
+    if (item->number == 0)
+        ItemSetNumber(item, row);
+
+    job->item = item;
+    job->row = row;
+    job->resolved = resolved;
+    job->newline = newline;
+    item->log = &job->log;
+
+    rc = SchedulerPush(self->sched, job);
+    if (rc != 0)
+        ItemJobDone(job, rc);
+
+    return rc;
+}
+
 static void CC bstKrtDownload(BSTNode *n, void *data) {
     rc_t rc = 0;
 
-    const KartTreeNode *sn = (const KartTreeNode*) n;
+    KartTreeNode *sn = (KartTreeNode*) n;
     assert(sn && sn->i);
 
+    if (sn->i->mane->sched != NULL) {
+        Item *item = sn->i;
+        sn->i = NULL;
+        MainSchedule(item->mane, item, item->number, true, false);
+        return;
+    }
+
     rc = ItemDownload(sn->i);
 
     if (rc == 0) {
@@ -4071,6 +5492,8 @@ static rc_t MainFini(Main *self) {
 
     assert(self);
 
+    RELEASE(Scheduler, self->sched); /* waits for running jobs */
+
     RELEASE(KConfig, self->cfg);
     RELEASE(VResolver, self->resolver);
     RELEASE(VDBManager, self->mgr);
@@ -4080,10 +5503,20 @@ static rc_t MainFini(Main *self) {
     RELEASE(VFSManager, self->vfsMgr);
     RELEASE(Args, self->args);
 
+    RELEASE(KMD5SumFmt, self->manifest);
+    RELEASE(Throttle, self->throttle);
+    RELEASE(KCondition, self->claimCond);
+    RELEASE(KLock, self->claimLock);
+
     BSTreeWhack(&self->downloaded, bstWhack, NULL);
+    BSTreeWhack(&self->claimed, bstWhack, NULL);
 
     free(self->buffer);
 
+    while (self->mirrorCount > 0)
+        free(self->mirrors[--self->mirrorCount]);
+    free(self->mirrors);
+
     free((void*)self->ascp);
     free((void*)self->asperaKey);
     free(self->ascpMaxRate);
@@ -4104,11 +5537,17 @@ static rc_t MainInit(int argc, char *argv[], Main *self) {
 /*  self->heartbeat = 69; */
 
     BSTreeInit(&self->downloaded);
+    BSTreeInit(&self->claimed);
 
     if (rc == 0) {
         rc = MainProcessArgs(self, argc, argv);
     }
 
+    if (rc == 0 && self->maxRate > 0) {
+        rc = ThrottleMake(&self->throttle, self->maxRate);
+        DISP_RC(rc, "ThrottleMake");
+    }
+
     if (rc == 0) {
         self->bsize = 1024 * 1024;
         self->buffer = malloc(self->bsize);
@@ -4142,6 +5581,24 @@ static rc_t MainInit(int argc, char *argv[], Main *self) {
         DISP_RC(rc, "KConfigMake");
     }
 
+    if (rc == 0) {
+        String *mirrors = NULL;
+        if (KConfigReadString(self->cfg, "/tools/prefetch/mirrors", &mirrors)
+            == 0)
+        {
+            const char *p = mirrors->addr;
+            const char *end = mirrors->addr + mirrors->size;
+            while (rc == 0 && p < end) {
+                const char *sep = string_chr(p, end - p, ':');
+                if (sep == NULL)
+                    sep = end;
+                rc = MainAddMirror(self, p, sep - p);
+                p = sep + 1;
+            }
+            StringWhack(mirrors);
+        }
+    }
+
     if (rc == 0) {
         rc = KConfigMakeRepositoryMgrRead(self->cfg, &self->repoMgr);
         DISP_RC(rc, "KConfigMakeRepositoryMgrRead");
@@ -4167,10 +5624,33 @@ static rc_t MainInit(int argc, char *argv[], Main *self) {
         DISP_RC(rc, "KDirectoryNativeDir");
     }
 
+    if (rc == 0 && self->manifestFile != NULL) {
+        const KFile *f = NULL;
+        rc = KDirectoryOpenFileRead(self->dir, &f, "%s", self->manifestFile);
+        DISP_RC2(rc, "Cannot open manifest", self->manifestFile);
+        if (rc == 0) {
+            rc = KMD5SumFmtMakeRead(&self->manifest, f); /* f is attached */
+            DISP_RC2(rc, "KMD5SumFmtMakeRead", self->manifestFile);
+            if (rc != 0)
+                RELEASE(KFile, f);
+        }
+    }
+
     if (rc == 0) {
         srand((unsigned)time(NULL));
     }
 
+    if (rc == 0 && self->jobs > 1 && !self->list_kart && !self->dryRun) {
+        rc = KLockMake(&self->claimLock);
+        DISP_RC(rc, "KLockMake");
+        if (rc == 0) {
+            rc = KConditionMake(&self->claimCond);
+            DISP_RC(rc, "KConditionMake");
+        }
+        if (rc == 0)
+            rc = SchedulerMake(&self->sched, self->jobs, ItemJobRun, ItemJobDone);
+    }
+
     return rc;
 }
 
@@ -4250,6 +5730,7 @@ static rc_t MainRun ( Main * self, const char * arg, const char * realArg,
             size_t total = 0;
             const char *row = self->rows;
             int64_t n = 1;
+            bool newline = false;
             NumIterator nit;
             NumIteratorInit(&nit, row);
             if (type == eRunTypeList) {
@@ -4261,12 +5742,17 @@ static rc_t MainRun ( Main * self, const char * arg, const char * realArg,
             }
             else {
                 if (it.kart != NULL) {
+                    if (self->sched != NULL) /* report previous items first */
+                        SchedulerDrain(self->sched);
                     OUTMSG(("Downloading kart file '%s'\n", realArg));
                     if (type == eRunTypeGetSize) {
                         OUTMSG(("Checking sizes of kart files...\n"));
                     }
                 }
-                OUTMSG(("\n"));
+                if (self->sched != NULL && it.kart == NULL)
+                    newline = true; /* printed in order by the job */
+                else
+                    OUTMSG(("\n"));
             }
 
             for (n = 1; ; ++n) {
@@ -4292,7 +5778,20 @@ static rc_t MainRun ( Main * self, const char * arg, const char * realArg,
                 if (done) {
                     break;
                 }
-                if (!nit.skip) {
+                if (!nit.skip && self->sched != NULL &&
+                    type == eRunTypeDownload)
+                {
+                    item->mane = self;
+                    ResolvedReset(&item->resolved, type);
+
+                    rc3 = MainSchedule(self, item, (int32_t)n, false, newline);
+                    item = NULL;
+                    newline = false;
+                    if (rc3 != 0 && rc == 0) {
+                        rc = rc3;
+                    }
+                }
+                else if (!nit.skip) {
                     item->mane = self;
                     ResolvedReset(&item->resolved, type);
 
@@ -4314,7 +5813,7 @@ static rc_t MainRun ( Main * self, const char * arg, const char * realArg,
                              type == eRunTypeGetSize)
                         {
                             logMaxSize(self->maxSize);
-                            logBigFile(n, item->resolved.name,
+                            logBigFile(item, n, item->resolved.name,
                                           item->resolved.remoteSz);
                         }
                         else {
@@ -4434,6 +5933,12 @@ rc_t CC KMain(int argc, char *argv[]) {
             }
         }
 
+        if (pars.sched != NULL) {
+            rc_t rc2 = SchedulerDrain(pars.sched);
+            if (rc2 != 0 && rc == 0)
+                rc = rc2;
+        }
+
         if (pars.undersized || pars.oversized) {
             OUTMSG(("\n"));
             if (pars.undersized) {
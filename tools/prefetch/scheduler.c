@@ -0,0 +1,317 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#include "scheduler.h"
+
+#include <kproc/cond.h> /* KCondition */
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
+#include <klib/log.h> /* LOGERR */
+#include <klib/time.h> /* KSleepMs */
+
+#include <sysalloc.h>
+
+#include <assert.h>
+#include <stdlib.h> /* calloc */
+
+/*--------------------------------------------------------------------------
+ * Scheduler
+ */
+typedef struct {
+    void * job;
+    rc_t status;
+    bool done;
+} Slot;
+
+struct Scheduler {
+    SchedulerRunFn run;
+    SchedulerDoneFn done;
+
+    KLock * lock;
+    KCondition * changed; /* a job was queued, finished or reported */
+
+    Slot * slots;         /* ring of queued jobs */
+    uint32_t capacity;
+    uint64_t head;        /* next job to report */
+    uint64_t next;        /* next job to run */
+    uint64_t tail;        /* next free slot */
+
+    rc_t status;          /* the first failure */
+    bool stop;
+
+    KThread ** threads;
+    uint32_t count;
+};
+
+/* report finished jobs from the head of the ring */
+static void SchedulerReport ( Scheduler * self ) {
+    while ( self -> head < self -> next ) {
+        Slot * slot = & self -> slots [ self -> head % self -> capacity ];
+        if ( ! slot -> done )
+            break;
+
+        if ( self -> status == 0 && slot -> status != 0 )
+            self -> status = slot -> status;
+
+        self -> done ( slot -> job, slot -> status );
+
+        slot -> job = NULL;
+        slot -> done = false;
+        ++ self -> head;
+    }
+}
+
+static rc_t CC SchedulerThread ( const KThread * thread, void * data ) {
+    Scheduler * self = data;
+    rc_t rc = 0;
+
+    assert ( self );
+
+    rc = KLockAcquire ( self -> lock );
+    while ( rc == 0 ) {
+        Slot * slot = NULL;
+        rc_t status = 0;
+
+        while ( rc == 0 && ! self -> stop && self -> next == self -> tail )
+            rc = KConditionWait ( self -> changed, self -> lock );
+        if ( rc != 0 || self -> next == self -> tail )
+            break;
+
+        /* the slot is not reused before the job is reported */
+        slot = & self -> slots [ self -> next ++ % self -> capacity ];
+        KLockUnlock ( self -> lock );
+
+        status = self -> run ( slot -> job );
+
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            return rc;
+
+        slot -> status = status;
+        slot -> done = true;
+        SchedulerReport ( self );
+
+        KConditionBroadcast ( self -> changed );
+    }
+
+    KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
+rc_t SchedulerMake ( Scheduler ** self, uint32_t threads,
+    SchedulerRunFn run, SchedulerDoneFn done )
+{
+    rc_t rc = 0;
+    Scheduler * p = NULL;
+
+    assert ( self && run && done );
+
+    if ( threads == 0 )
+        return RC ( rcExe, rcThread, rcConstructing, rcParam, rcInvalid );
+
+    p = calloc ( 1, sizeof * p );
+    if ( p == NULL )
+        return RC ( rcExe, rcData, rcAllocating, rcMemory, rcExhausted );
+
+    p -> run = run;
+    p -> done = done;
+    p -> capacity = threads * 2;
+
+    p -> slots = calloc ( p -> capacity, sizeof * p -> slots );
+    p -> threads = calloc ( threads, sizeof * p -> threads );
+    if ( p -> slots == NULL || p -> threads == NULL )
+        rc = RC ( rcExe, rcData, rcAllocating, rcMemory, rcExhausted );
+
+    if ( rc == 0 )
+        rc = KLockMake ( & p -> lock );
+    if ( rc == 0 )
+        rc = KConditionMake ( & p -> changed );
+
+    for ( ; rc == 0 && p -> count < threads; ++ p -> count ) {
+        rc = KThreadMake ( & p -> threads [ p -> count ],
+                           SchedulerThread, p );
+        if ( rc != 0 )
+            LOGERR ( klogErr, rc, "cannot start download thread" );
+    }
+
+    if ( rc != 0 ) {
+        SchedulerRelease ( p );
+        return rc;
+    }
+
+    * self = p;
+
+    return rc;
+}
+
+rc_t SchedulerPush ( Scheduler * self, void * job ) {
+    rc_t rc = 0;
+    Slot * slot = NULL;
+
+    assert ( self );
+
+    rc = KLockAcquire ( self -> lock );
+    if ( rc != 0 )
+        return rc;
+
+    while ( rc == 0 && self -> tail - self -> head >= self -> capacity )
+        rc = KConditionWait ( self -> changed, self -> lock );
+
+    if ( rc == 0 ) {
+        slot = & self -> slots [ self -> tail ++ % self -> capacity ];
+        slot -> job = job;
+        slot -> status = 0;
+        slot -> done = false;
+        KConditionBroadcast ( self -> changed );
+    }
+
+    KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
+rc_t SchedulerDrain ( Scheduler * self ) {
+    rc_t rc = 0;
+
+    assert ( self );
+
+    rc = KLockAcquire ( self -> lock );
+    if ( rc != 0 )
+        return rc;
+
+    while ( rc == 0 && self -> head < self -> tail )
+        rc = KConditionWait ( self -> changed, self -> lock );
+
+    if ( rc == 0 )
+        rc = self -> status;
+
+    KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
+rc_t SchedulerRelease ( Scheduler * self ) {
+    rc_t rc = 0;
+    uint32_t i = 0;
+
+    if ( self == NULL )
+        return 0;
+
+    if ( self -> lock != NULL && self -> changed != NULL ) {
+        if ( self -> count > 0 )
+            rc = SchedulerDrain ( self );
+
+        if ( KLockAcquire ( self -> lock ) == 0 ) {
+            self -> stop = true;
+            KConditionBroadcast ( self -> changed );
+            KLockUnlock ( self -> lock );
+        }
+    }
+
+    for ( i = 0; i < self -> count; ++ i ) {
+        rc_t status = 0;
+        rc_t rc2 = KThreadWait ( self -> threads [ i ], & status );
+        if ( rc == 0 && rc2 != 0 )
+            rc = rc2;
+        KThreadRelease ( self -> threads [ i ] );
+    }
+
+    KConditionRelease ( self -> changed );
+    KLockRelease ( self -> lock );
+
+    free ( self -> threads );
+    free ( self -> slots );
+    free ( self );
+
+    return rc;
+}
+
+/*--------------------------------------------------------------------------
+ * Throttle
+ */
+struct Throttle {
+    KLock * lock;
+    uint64_t rate;  /* bytes per second */
+    uint64_t clock; /* microseconds: when transfers so far are paid off */
+};
+
+rc_t ThrottleMake ( Throttle ** self, uint64_t bytesPerSecond ) {
+    rc_t rc = 0;
+    Throttle * p = NULL;
+
+    assert ( self && bytesPerSecond > 0 );
+
+    p = calloc ( 1, sizeof * p );
+    if ( p == NULL )
+        return RC ( rcExe, rcData, rcAllocating, rcMemory, rcExhausted );
+
+    rc = KLockMake ( & p -> lock );
+    if ( rc != 0 ) {
+        free ( p );
+        return rc;
+    }
+
+    p -> rate = bytesPerSecond;
+    * self = p;
+
+    return rc;
+}
+
+void ThrottleTake ( Throttle * self, size_t bytes ) {
+    uint64_t now = 0;
+    uint64_t delay = 0;
+
+    if ( self == NULL || bytes == 0 )
+        return;
+
+    if ( KLockAcquire ( self -> lock ) != 0 )
+        return;
+
+    now = KTimeMsStamp () * 1000;
+    if ( self -> clock < now )
+        self -> clock = now;
+    self -> clock += ( uint64_t ) bytes * 1000000 / self -> rate;
+    delay = ( self -> clock - now ) / 1000;
+
+    KLockUnlock ( self -> lock );
+
+    if ( delay > 0 )
+        KSleepMs ( ( uint32_t ) delay );
+}
+
+rc_t ThrottleRelease ( Throttle * self ) {
+    rc_t rc = 0;
+
+    if ( self == NULL )
+        return 0;
+
+    rc = KLockRelease ( self -> lock );
+    free ( self );
+
+    return rc;
+}
@@ -0,0 +1,79 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_prefetch_scheduler_
+#define _h_prefetch_scheduler_
+
+#include <klib/rc.h>
+
+/*--------------------------------------------------------------------------
+ * Scheduler
+ *  runs jobs on a pool of threads.
+ *  completion of jobs is reported in the order they were pushed:
+ *  "done" callbacks are called one at a time,
+ *  so they can print without interleaving
+ */
+typedef struct Scheduler Scheduler;
+
+typedef rc_t ( CC * SchedulerRunFn ) ( void * job );
+typedef void ( CC * SchedulerDoneFn ) ( void * job, rc_t status );
+
+rc_t SchedulerMake ( Scheduler ** self, uint32_t threads,
+    SchedulerRunFn run, SchedulerDoneFn done );
+
+/* Push
+ *  queue a job; blocks while too many jobs are waiting to be run
+ */
+rc_t SchedulerPush ( Scheduler * self, void * job );
+
+/* Drain
+ *  wait until all pushed jobs are done and reported
+ *  returns the first failure of a job
+ */
+rc_t SchedulerDrain ( Scheduler * self );
+
+/* Release
+ *  drains queued jobs and stops the threads
+ */
+rc_t SchedulerRelease ( Scheduler * self );
+
+
+/*--------------------------------------------------------------------------
+ * Throttle
+ *  limits the total rate of transfers shared between threads
+ */
+typedef struct Throttle Throttle;
+
+rc_t ThrottleMake ( Throttle ** self, uint64_t bytesPerSecond );
+
+/* Take
+ *  account for bytes transferred; sleeps when the rate is exceeded
+ */
+void ThrottleTake ( Throttle * self, size_t bytes );
+
+rc_t ThrottleRelease ( Throttle * self );
+
+#endif /* _h_prefetch_scheduler_ */
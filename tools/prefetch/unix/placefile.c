@@ -0,0 +1,216 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#include "placefile.h"
+
+#include <klib/rc.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h> /* malloc */
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <linux/fs.h> /* FICLONE */
+#endif
+
+#define COPY_BUFFER ( 1024 * 1024 )
+
+static
+rc_t RCFromErrno ( int err )
+{
+    switch ( err )
+    {
+    case ENOENT:
+        return RC ( rcExe, rcFile, rcCopying, rcPath, rcNotFound );
+    case EACCES:
+    case EPERM:
+        return RC ( rcExe, rcFile, rcCopying, rcFile, rcUnauthorized );
+    case ENOSPC:
+        return RC ( rcExe, rcFile, rcCopying, rcStorage, rcExhausted );
+    case ENOMEM:
+        return RC ( rcExe, rcFile, rcCopying, rcMemory, rcExhausted );
+    default:
+        return RC ( rcExe, rcFile, rcCopying, rcFile, rcUnknown );
+    }
+}
+
+/* in-kernel copy: returns false when it is not supported for these files */
+static
+bool KernelCopy ( int in, int out, off_t size, int * err )
+{
+#ifdef SYS_copy_file_range
+    off_t done = 0;
+    while ( done < size )
+    {
+        ssize_t n = syscall ( SYS_copy_file_range,
+            in, NULL, out, NULL, ( size_t ) ( size - done ), 0 );
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            if ( done == 0 && ( errno == ENOSYS || errno == EXDEV
+                || errno == EINVAL || errno == EOPNOTSUPP ) )
+            {
+                return false;
+            }
+            * err = errno;
+            return true;
+        }
+        if ( n == 0 )
+            break;
+        done += n;
+    }
+    * err = done == size ? 0 : EIO;
+    return true;
+#else
+    return false;
+#endif
+}
+
+static
+int PlainCopy ( int in, int out )
+{
+    int err = 0;
+    char * buffer = malloc ( COPY_BUFFER );
+    if ( buffer == NULL )
+        return ENOMEM;
+
+    while ( err == 0 )
+    {
+        ssize_t w = 0;
+        ssize_t r = read ( in, buffer, COPY_BUFFER );
+        if ( r < 0 )
+        {
+            if ( errno != EINTR )
+                err = errno;
+            continue;
+        }
+        if ( r == 0 )
+            break;
+
+        while ( w < r )
+        {
+            ssize_t n = write ( out, buffer + w, r - w );
+            if ( n < 0 )
+            {
+                if ( errno == EINTR )
+                    continue;
+                err = errno;
+                break;
+            }
+            w += n;
+        }
+    }
+
+    free ( buffer );
+    return err;
+}
+
+rc_t PlaceFile ( const char * src, const char * dst, EPlace * how )
+{
+    int err = 0;
+    int in = -1;
+    int out = -1;
+    struct stat st;
+
+    assert ( src && dst && how );
+    * how = ePlaceNone;
+
+    in = open ( src, O_RDONLY );
+    if ( in < 0 )
+        return RCFromErrno ( errno );
+
+    if ( fstat ( in, & st ) != 0 )
+    {
+        err = errno;
+        close ( in );
+        return RCFromErrno ( err );
+    }
+
+    out = open ( dst, O_WRONLY | O_CREAT | O_TRUNC, 0664 );
+    if ( out < 0 )
+    {
+        err = errno;
+        close ( in );
+        return RCFromErrno ( err );
+    }
+
+#ifdef FICLONE
+    if ( ioctl ( out, FICLONE, in ) == 0 )
+        * how = ePlaceReflink;
+#endif
+
+    /* a hard link to a file we could modify would let later writes
+       to the downloaded file change the mirror */
+    if ( * how == ePlaceNone && access ( src, W_OK ) != 0 )
+    {
+        close ( out );
+        out = -1;
+        unlink ( dst );
+        if ( link ( src, dst ) == 0 )
+        {
+            close ( in );
+            * how = ePlaceHardlink;
+            return 0;
+        }
+
+        out = open ( dst, O_WRONLY | O_CREAT | O_TRUNC, 0664 );
+        if ( out < 0 )
+        {
+            err = errno;
+            close ( in );
+            return RCFromErrno ( err );
+        }
+    }
+
+    if ( * how == ePlaceNone && KernelCopy ( in, out, st . st_size, & err ) )
+        * how = ePlaceKernelCopy;
+
+    if ( * how == ePlaceNone )
+    {
+        err = PlainCopy ( in, out );
+        * how = ePlaceCopy;
+    }
+
+    if ( close ( out ) != 0 && err == 0 )
+        err = errno;
+    close ( in );
+
+    if ( err != 0 )
+    {
+        unlink ( dst );
+        * how = ePlaceNone;
+        return RCFromErrno ( err );
+    }
+
+    return 0;
+}
@@ -0,0 +1,485 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bam_index.h"
+#include "bgzf_writer.h"
+
+#include <kfs/directory.h>
+#include <kfs/file.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IDX_MIN_SHIFT 14
+#define IDX_DEPTH 5
+#define IDX_MAX_BIN 37450   /* ( ( 1 << ( ( IDX_DEPTH + 1 ) * 3 ) ) - 1 ) / 7 */
+#define IDX_PSEUDO_BIN IDX_MAX_BIN
+
+uint32_t bam_reg2bin( int32_t beg, int32_t end )
+{
+    --end;
+    if ( beg >> 14 == end >> 14 ) return ( ( 1 << 15 ) - 1 ) / 7 + ( beg >> 14 );
+    if ( beg >> 17 == end >> 17 ) return ( ( 1 << 12 ) - 1 ) / 7 + ( beg >> 17 );
+    if ( beg >> 20 == end >> 20 ) return ( ( 1 << 9 ) - 1 ) / 7 + ( beg >> 20 );
+    if ( beg >> 23 == end >> 23 ) return ( ( 1 << 6 ) - 1 ) / 7 + ( beg >> 23 );
+    if ( beg >> 26 == end >> 26 ) return ( ( 1 << 3 ) - 1 ) / 7 + ( beg >> 26 );
+    return 0;
+}
+
+
+typedef struct idx_chunk
+{
+    uint64_t beg;
+    uint64_t end;
+} idx_chunk;
+
+
+typedef struct idx_bin
+{
+    uint32_t bin;
+    uint32_t n_chunks;
+    uint32_t cap;
+    idx_chunk * chunks;
+} idx_bin;
+
+
+typedef struct idx_ref
+{
+    idx_bin * bins;
+    uint32_t n_bins;
+    uint32_t bins_cap;
+
+    uint64_t * linear;
+    uint32_t n_linear;
+
+    /* for the pseudo-bin */
+    uint64_t off_beg;
+    uint64_t off_end;
+    uint64_t n_mapped;
+    uint64_t n_unmapped;
+} idx_ref;
+
+
+typedef struct bam_index
+{
+    idx_ref * refs;
+    uint32_t n_refs;
+
+    /* bin-number -> index+1 into the bins of the current reference, 0 ... not used yet */
+    uint32_t * bin_slot;
+
+    int32_t last_tid;
+    int32_t last_pos;
+    uint64_t n_no_coor;
+    bool valid;
+} bam_index;
+
+
+rc_t make_bam_index( struct bam_index ** self, uint32_t n_refs )
+{
+    rc_t rc = 0;
+    bam_index * idx = calloc( 1, sizeof * idx );
+    *self = NULL;
+    if ( idx == NULL )
+        rc = RC( rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        idx->n_refs = n_refs;
+        idx->refs = calloc( n_refs + 1, sizeof idx->refs[ 0 ] );
+        idx->bin_slot = calloc( IDX_MAX_BIN + 1, sizeof idx->bin_slot[ 0 ] );
+        if ( idx->refs == NULL || idx->bin_slot == NULL )
+        {
+            rc = RC( rcExe, rcIndex, rcConstructing, rcMemory, rcExhausted );
+            release_bam_index( idx );
+        }
+        else
+        {
+            idx->last_tid = 0;
+            idx->last_pos = -1;
+            idx->valid = true;
+            *self = idx;
+        }
+    }
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot create bam-index" );
+    return rc;
+}
+
+
+static void forget_bin_slots( bam_index * self, const idx_ref * ref )
+{
+    uint32_t i;
+    for ( i = 0; i < ref->n_bins; ++i )
+        self->bin_slot[ ref->bins[ i ].bin ] = 0;
+}
+
+
+static idx_bin * get_bin( bam_index * self, idx_ref * ref, uint32_t bin )
+{
+    uint32_t slot = self->bin_slot[ bin ];
+    if ( slot == 0 )
+    {
+        idx_bin * b;
+        if ( ref->n_bins == ref->bins_cap )
+        {
+            uint32_t new_cap = ( ref->bins_cap == 0 ) ? 64 : ref->bins_cap * 2;
+            idx_bin * tmp = realloc( ref->bins, new_cap * sizeof tmp[ 0 ] );
+            if ( tmp == NULL )
+                return NULL;
+            ref->bins = tmp;
+            ref->bins_cap = new_cap;
+        }
+        b = &ref->bins[ ref->n_bins++ ];
+        memset( b, 0, sizeof * b );
+        b->bin = bin;
+        slot = self->bin_slot[ bin ] = ref->n_bins;
+    }
+    return &ref->bins[ slot - 1 ];
+}
+
+
+static rc_t add_chunk( idx_bin * b, uint64_t vbeg, uint64_t vend )
+{
+    if ( b->n_chunks > 0 )
+    {
+        /* merge with the previous chunk, if they touch or share a block */
+        idx_chunk * last = &b->chunks[ b->n_chunks - 1 ];
+        if ( last->end == vbeg || ( last->end >> 16 ) == ( vbeg >> 16 ) )
+        {
+            last->end = vend;
+            return 0;
+        }
+    }
+    if ( b->n_chunks == b->cap )
+    {
+        uint32_t new_cap = ( b->cap == 0 ) ? 4 : b->cap * 2;
+        idx_chunk * tmp = realloc( b->chunks, new_cap * sizeof tmp[ 0 ] );
+        if ( tmp == NULL )
+            return RC( rcExe, rcIndex, rcInserting, rcMemory, rcExhausted );
+        b->chunks = tmp;
+        b->cap = new_cap;
+    }
+    b->chunks[ b->n_chunks ].beg = vbeg;
+    b->chunks[ b->n_chunks ].end = vend;
+    b->n_chunks++;
+    return 0;
+}
+
+
+static rc_t add_linear( idx_ref * ref, int32_t beg, int32_t end, uint64_t vbeg )
+{
+    uint32_t w, w_beg = beg >> IDX_MIN_SHIFT, w_end = ( end - 1 ) >> IDX_MIN_SHIFT;
+    if ( w_end >= ref->n_linear )
+    {
+        uint32_t new_n = w_end + 1;
+        uint64_t * tmp = realloc( ref->linear, new_n * sizeof tmp[ 0 ] );
+        if ( tmp == NULL )
+            return RC( rcExe, rcIndex, rcInserting, rcMemory, rcExhausted );
+        memset( &tmp[ ref->n_linear ], 0, ( new_n - ref->n_linear ) * sizeof tmp[ 0 ] );
+        ref->linear = tmp;
+        ref->n_linear = new_n;
+    }
+    for ( w = w_beg; w <= w_end; ++w )
+    {
+        if ( ref->linear[ w ] == 0 )
+            ref->linear[ w ] = vbeg;
+    }
+    return 0;
+}
+
+
+rc_t bam_index_add( struct bam_index * self, int32_t tid, int32_t beg, int32_t end, bool mapped,
+                    uint64_t vbeg, uint64_t vend )
+{
+    rc_t rc = 0;
+    if ( !self->valid )
+        return 0;
+
+    if ( tid < 0 )
+    {
+        self->n_no_coor++;
+        self->last_tid = -1;
+        return 0;
+    }
+
+    if ( self->last_tid < 0 || tid < self->last_tid || ( uint32_t )tid >= self->n_refs ||
+         ( tid == self->last_tid && beg < self->last_pos ) )
+    {
+        self->valid = false;
+        return 0;
+    }
+
+    if ( tid != self->last_tid )
+        forget_bin_slots( self, &self->refs[ self->last_tid ] );
+    self->last_tid = tid;
+    self->last_pos = beg;
+
+    if ( end <= beg )
+        end = beg + 1;
+    {
+        idx_ref * ref = &self->refs[ tid ];
+        idx_bin * b = get_bin( self, ref, bam_reg2bin( beg, end ) );
+        if ( b == NULL )
+            rc = RC( rcExe, rcIndex, rcInserting, rcMemory, rcExhausted );
+        else
+            rc = add_chunk( b, vbeg, vend );
+        if ( rc == 0 )
+            rc = add_linear( ref, beg, end, vbeg );
+        if ( rc == 0 )
+        {
+            if ( ref->n_mapped + ref->n_unmapped == 0 )
+                ref->off_beg = vbeg;
+            ref->off_end = vend;
+            if ( mapped )
+                ref->n_mapped++;
+            else
+                ref->n_unmapped++;
+        }
+    }
+    return rc;
+}
+
+
+bool bam_index_is_valid( const struct bam_index * self )
+{
+    return self->valid;
+}
+
+
+/* ------------------------------------------------------------------------------------------- */
+
+typedef struct idx_buffer
+{
+    uint8_t * data;
+    size_t size;
+    size_t used;
+    rc_t rc;
+} idx_buffer;
+
+
+static void idx_put( idx_buffer * buf, const void * src, size_t len )
+{
+    if ( buf->rc != 0 )
+        return;
+    if ( buf->used + len > buf->size )
+    {
+        size_t new_size = ( buf->size == 0 ) ? 4096 : buf->size;
+        uint8_t * tmp;
+        while ( new_size < buf->used + len )
+            new_size *= 2;
+        tmp = realloc( buf->data, new_size );
+        if ( tmp == NULL )
+        {
+            buf->rc = RC( rcExe, rcIndex, rcWriting, rcMemory, rcExhausted );
+            return;
+        }
+        buf->data = tmp;
+        buf->size = new_size;
+    }
+    memmove( &buf->data[ buf->used ], src, len );
+    buf->used += len;
+}
+
+
+static void idx_put_u32( idx_buffer * buf, uint32_t value )
+{
+    uint8_t b[ 4 ];
+    b[ 0 ] = value & 0xff;
+    b[ 1 ] = ( value >> 8 ) & 0xff;
+    b[ 2 ] = ( value >> 16 ) & 0xff;
+    b[ 3 ] = ( value >> 24 ) & 0xff;
+    idx_put( buf, b, sizeof b );
+}
+
+
+static void idx_put_u64( idx_buffer * buf, uint64_t value )
+{
+    idx_put_u32( buf, ( uint32_t )( value & 0xffffffff ) );
+    idx_put_u32( buf, ( uint32_t )( value >> 32 ) );
+}
+
+
+/* the first position covered by a bin */
+static int64_t bin_beg( uint32_t bin )
+{
+    uint32_t level, first = 0;
+    for ( level = 0; level <= IDX_DEPTH; ++level )
+    {
+        uint32_t next = first + ( 1 << ( level * 3 ) );
+        if ( bin < next )
+            return ( int64_t )( bin - first ) << ( IDX_MIN_SHIFT + 3 * ( IDX_DEPTH - level ) );
+        first = next;
+    }
+    return 0;
+}
+
+
+static void serialize_ref( idx_buffer * buf, const idx_ref * ref, const struct bgzf_writer * bgzf,
+                           enum bam_index_format fmt )
+{
+    uint32_t i, j;
+    bool has_data = ( ref->n_mapped + ref->n_unmapped > 0 );
+
+    idx_put_u32( buf, ref->n_bins + ( has_data ? 1 : 0 ) );
+    for ( i = 0; i < ref->n_bins; ++i )
+    {
+        const idx_bin * b = &ref->bins[ i ];
+        idx_put_u32( buf, b->bin );
+        if ( fmt == bif_csi )
+        {
+            uint64_t loffset = b->chunks[ 0 ].beg;
+            uint64_t w = bin_beg( b->bin ) >> IDX_MIN_SHIFT;
+            if ( w < ref->n_linear && ref->linear[ w ] != 0 && ref->linear[ w ] < loffset )
+                loffset = ref->linear[ w ];
+            idx_put_u64( buf, bgzf_writer_resolve( bgzf, loffset ) );
+        }
+        idx_put_u32( buf, b->n_chunks );
+        for ( j = 0; j < b->n_chunks; ++j )
+        {
+            idx_put_u64( buf, bgzf_writer_resolve( bgzf, b->chunks[ j ].beg ) );
+            idx_put_u64( buf, bgzf_writer_resolve( bgzf, b->chunks[ j ].end ) );
+        }
+    }
+    if ( has_data )
+    {
+        idx_put_u32( buf, IDX_PSEUDO_BIN );
+        if ( fmt == bif_csi )
+            idx_put_u64( buf, 0 );
+        idx_put_u32( buf, 2 );
+        idx_put_u64( buf, bgzf_writer_resolve( bgzf, ref->off_beg ) );
+        idx_put_u64( buf, bgzf_writer_resolve( bgzf, ref->off_end ) );
+        idx_put_u64( buf, ref->n_mapped );
+        idx_put_u64( buf, ref->n_unmapped );
+    }
+    if ( fmt == bif_bai )
+    {
+        /* empty windows get the offset of the window before */
+        uint64_t prev = 0;
+        idx_put_u32( buf, ref->n_linear );
+        for ( i = 0; i < ref->n_linear; ++i )
+        {
+            if ( ref->linear[ i ] != 0 )
+                prev = bgzf_writer_resolve( bgzf, ref->linear[ i ] );
+            idx_put_u64( buf, prev );
+        }
+    }
+}
+
+
+static rc_t write_idx_file( const idx_buffer * buf, enum bam_index_format fmt, const char * filename )
+{
+    KDirectory * dir;
+    rc_t rc = KDirectoryNativeDir( &dir );
+    if ( rc != 0 )
+        (void)LOGERR( klogInt, rc, "KDirectoryNativeDir() failed" );
+    else
+    {
+        KFile * f;
+        rc = KDirectoryCreateFile( dir, &f, false, 0664, kcmInit, "%s", filename );
+        if ( rc != 0 )
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cannot create index-file '$(fn)'", "fn=%s", filename ) );
+        else
+        {
+            if ( fmt == bif_csi )
+            {
+                /* a csi-index is itself bgzf-compressed */
+                struct bgzf_writer * w;
+                rc = make_bgzf_writer( &w, f, 0, -1 );
+                if ( rc == 0 )
+                {
+                    rc = bgzf_writer_write( w, buf->data, buf->used );
+                    if ( rc == 0 )
+                        rc = bgzf_writer_finish( w );
+                    release_bgzf_writer( w );
+                }
+            }
+            else
+            {
+                size_t num_writ;
+                rc = KFileWriteAll( f, 0, buf->data, buf->used, &num_writ );
+            }
+            if ( rc != 0 )
+                (void)PLOGERR( klogErr, ( klogErr, rc, "cannot write index-file '$(fn)'", "fn=%s", filename ) );
+            KFileRelease( f );
+        }
+        KDirectoryRelease( dir );
+    }
+    return rc;
+}
+
+
+rc_t bam_index_write( const struct bam_index * self, const struct bgzf_writer * bgzf,
+                      enum bam_index_format fmt, const char * filename )
+{
+    rc_t rc;
+    uint32_t i;
+    idx_buffer buf;
+
+    memset( &buf, 0, sizeof buf );
+    if ( fmt == bif_csi )
+    {
+        idx_put( &buf, "CSI\1", 4 );
+        idx_put_u32( &buf, IDX_MIN_SHIFT );
+        idx_put_u32( &buf, IDX_DEPTH );
+        idx_put_u32( &buf, 0 );     /* l_aux */
+    }
+    else
+        idx_put( &buf, "BAI\1", 4 );
+
+    idx_put_u32( &buf, self->n_refs );
+    for ( i = 0; i < self->n_refs; ++i )
+        serialize_ref( &buf, &self->refs[ i ], bgzf, fmt );
+    idx_put_u64( &buf, self->n_no_coor );
+
+    rc = buf.rc;
+    if ( rc == 0 )
+        rc = write_idx_file( &buf, fmt, filename );
+    free( buf.data );
+    return rc;
+}
+
+
+void release_bam_index( struct bam_index * self )
+{
+    if ( self != NULL )
+    {
+        if ( self->refs != NULL )
+        {
+            uint32_t i, j;
+            for ( i = 0; i < self->n_refs; ++i )
+            {
+                idx_ref * ref = &self->refs[ i ];
+                for ( j = 0; j < ref->n_bins; ++j )
+                    free( ref->bins[ j ].chunks );
+                free( ref->bins );
+                free( ref->linear );
+            }
+            free( self->refs );
+        }
+        free( self->bin_slot );
+        free( self );
+    }
+}
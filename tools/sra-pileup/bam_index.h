@@ -0,0 +1,73 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bam_index_
+#define _h_bam_index_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <klib/rc.h>
+#include <klib/log.h>
+
+struct bgzf_writer;
+
+enum bam_index_format
+{
+    bif_none = 0,   /* do not write an index */
+    bif_bai,        /* write a .bai - index */
+    bif_csi         /* write a .csi - index ( min-shift = 14, depth = 5 ) */
+};
+
+/* the bin of a 0-based, half open region ( see SAM/BAM-spec 5.3 ) */
+uint32_t bam_reg2bin( int32_t beg, int32_t end );
+
+/*
+    collects the index of a coordinate-sorted BAM-file while it is written,
+    all file-positions are block-positions ( see bgzf_writer.h )
+*/
+struct bam_index;
+
+rc_t make_bam_index( struct bam_index ** self, uint32_t n_refs );
+
+/* beg/end reference-positions, vbeg/vend block-positions of the record
+   records have to come in coordinate order, otherwise the index becomes invalid */
+rc_t bam_index_add( struct bam_index * self, int32_t tid, int32_t beg, int32_t end, bool mapped,
+                    uint64_t vbeg, uint64_t vend );
+
+/* false if the records did not come in coordinate order */
+bool bam_index_is_valid( const struct bam_index * self );
+
+/* the bgzf-writer of the BAM-file has to be finished, to resolve the block-positions */
+rc_t bam_index_write( const struct bam_index * self, const struct bgzf_writer * bgzf,
+                      enum bam_index_format fmt, const char * filename );
+
+void release_bam_index( struct bam_index * self );
+
+#endif
@@ -0,0 +1,1013 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bam_out.h"
+#include "bgzf_writer.h"
+
+#include <klib/container.h>
+#include <klib/text.h>
+#include <klib/out.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define BAM_LINE_INITIAL_SIZE ( 1024 * 4 )
+#define BAM_MAX_FIELDS 256
+
+/* a record written by bam_rec_write(): marker, length of the rest, end on the reference,
+   length and text of RNAME and RNEXT, the BAM-record with the reference-ids left open */
+#define BAM_REC_MARKER 0
+#define BAM_REC_HDR_LEN 5
+
+/* offsets of the fields in the fixed part of a BAM-record */
+#define BAM_OFS_REFID 4
+#define BAM_OFS_BIN 14
+#define BAM_OFS_FLAG 18
+#define BAM_OFS_NEXT_REFID 24
+
+typedef struct bam_ref
+{
+    BSTNode node;
+    const char * name;
+    int32_t tid;
+    uint32_t len;
+} bam_ref;
+
+
+typedef struct bam_out
+{
+    struct bgzf_writer * bgzf;
+    struct bam_index * idx;
+    enum bam_index_format idx_fmt;
+    char * idx_filename;            /* a copy, the caller's name may not outlive the writer */
+
+    bam_buffer pending; /* a header-line or an encoded record, not yet complete */
+    bam_buffer header;  /* the header-text collected so far */
+
+    BSTree refs;
+    uint32_t n_refs;
+    const bam_ref * last_ref;   /* records come grouped by reference */
+
+    bool header_written;
+} bam_out;
+
+
+static rc_t buffer_reserve( bam_buffer * buf, size_t len )
+{
+    if ( buf->used + len > buf->size )
+    {
+        size_t new_size = ( buf->size == 0 ) ? BAM_LINE_INITIAL_SIZE : buf->size;
+        uint8_t * tmp;
+        while ( new_size < buf->used + len )
+            new_size *= 2;
+        tmp = realloc( buf->data, new_size );
+        if ( tmp == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        buf->data = tmp;
+        buf->size = new_size;
+    }
+    return 0;
+}
+
+
+static rc_t buffer_put( bam_buffer * buf, const void * src, size_t len )
+{
+    rc_t rc = buffer_reserve( buf, len );
+    if ( rc == 0 && len > 0 )
+    {
+        memmove( &buf->data[ buf->used ], src, len );
+        buf->used += len;
+    }
+    return rc;
+}
+
+
+static rc_t buffer_put_u8( bam_buffer * buf, uint8_t value )
+{
+    return buffer_put( buf, &value, 1 );
+}
+
+
+static rc_t buffer_put_u16( bam_buffer * buf, uint16_t value )
+{
+    uint8_t b[ 2 ];
+    b[ 0 ] = value & 0xff;
+    b[ 1 ] = ( value >> 8 ) & 0xff;
+    return buffer_put( buf, b, sizeof b );
+}
+
+
+static rc_t buffer_put_u32( bam_buffer * buf, uint32_t value )
+{
+    uint8_t b[ 4 ];
+    b[ 0 ] = value & 0xff;
+    b[ 1 ] = ( value >> 8 ) & 0xff;
+    b[ 2 ] = ( value >> 16 ) & 0xff;
+    b[ 3 ] = ( value >> 24 ) & 0xff;
+    return buffer_put( buf, b, sizeof b );
+}
+
+
+static void set_u16( uint8_t * at, uint16_t value )
+{
+    at[ 0 ] = value & 0xff;
+    at[ 1 ] = ( value >> 8 ) & 0xff;
+}
+
+
+static void set_u32( uint8_t * at, uint32_t value )
+{
+    at[ 0 ] = value & 0xff;
+    at[ 1 ] = ( value >> 8 ) & 0xff;
+    at[ 2 ] = ( value >> 16 ) & 0xff;
+    at[ 3 ] = ( value >> 24 ) & 0xff;
+}
+
+
+static uint16_t get_u16( const uint8_t * at )
+{
+    return ( uint16_t )( at[ 0 ] | ( at[ 1 ] << 8 ) );
+}
+
+
+static uint32_t get_u32( const uint8_t * at )
+{
+    return ( uint32_t )at[ 0 ] | ( ( uint32_t )at[ 1 ] << 8 ) |
+           ( ( uint32_t )at[ 2 ] << 16 ) | ( ( uint32_t )at[ 3 ] << 24 );
+}
+
+
+/* =========================================================================================== */
+/* the encoder, called by the record-printers ( in any thread ) */
+
+/* ASCII to the 4-bit codes of "=ACMGRSVTWYHKDBN", everything else is N */
+static const uint8_t nt16[ 256 ] =
+{
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  0, 15, 15,
+    15,  1, 14,  2, 13, 15, 15,  4, 11, 15, 15, 12, 15,  3, 15, 15,
+    15, 15,  5,  6,  8, 15,  7,  9, 15, 10, 15, 15, 15, 15, 15, 15,
+    15,  1, 14,  2, 13, 15, 15,  4, 11, 15, 15, 12, 15,  3, 15, 15,
+    15, 15,  5,  6,  8, 15,  7,  9, 15, 10, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15
+};
+
+/* the complement of a 4-bit code: the bits for A, C, G, T reversed */
+static const uint8_t nt16_cmpl[ 16 ] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+
+void bam_rec_init( bam_rec * self )
+{
+    memset( self, 0, sizeof * self );
+    self->pos = -1;
+    self->pnext = -1;
+}
+
+
+void bam_rec_reset( bam_rec * self )
+{
+    bam_buffer tags = self->tags;
+    bam_buffer enc = self->enc;
+    bam_rec_init( self );
+    self->tags = tags;
+    self->tags.used = 0;
+    self->enc = enc;
+    self->enc.used = 0;
+}
+
+
+void bam_rec_release( bam_rec * self )
+{
+    free( self->tags.data );
+    free( self->enc.data );
+    bam_rec_init( self );
+}
+
+
+static rc_t encode_cigar( bam_buffer * rec, const char * cigar, size_t cigar_len,
+                          uint32_t * n_ops, int32_t * ref_len )
+{
+    rc_t rc = 0;
+    const char * p = cigar;
+    const char * end = cigar + cigar_len;
+    *n_ops = 0;
+    *ref_len = 0;
+    if ( cigar_len == 1 && cigar[ 0 ] == '*' )
+        return 0;
+    while ( rc == 0 && p < end )
+    {
+        uint64_t len = 0;
+        const char * op_chr = NULL;
+        const char * digits = p;
+        while ( p < end && *p >= '0' && *p <= '9' )
+            len = len * 10 + ( *p++ - '0' );
+        if ( p == digits || p == end || len >= ( 1 << 28 ) ||
+             *p == 0 || ( op_chr = strchr( "MIDNSHP=X", *p ) ) == NULL )
+            rc = RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+        else
+        {
+            uint32_t op = op_chr - "MIDNSHP=X";
+            rc = buffer_put_u32( rec, ( uint32_t )( len << 4 ) | op );
+            /* M, D, N, =, X consume the reference */
+            if ( op == 0 || op == 2 || op == 3 || op == 7 || op == 8 )
+                *ref_len += len;
+            ( *n_ops )++;
+            p++;
+        }
+    }
+    if ( rc == 0 && *n_ops > 0xffff )
+        rc = RC( rcExe, rcString, rcParsing, rcFormat, rcExcessive );
+    return rc;
+}
+
+
+static rc_t encode_seq( bam_buffer * rec, const char * seq, size_t l_seq, bool reverse )
+{
+    rc_t rc = buffer_reserve( rec, ( l_seq + 1 ) / 2 );
+    if ( rc == 0 )
+    {
+        uint8_t * dst = &rec->data[ rec->used ];
+        size_t i;
+        for ( i = 0; i < l_seq; ++i )
+        {
+            uint8_t code = reverse ? nt16_cmpl[ nt16[ ( uint8_t )seq[ l_seq - i - 1 ] ] ]
+                                   : nt16[ ( uint8_t )seq[ i ] ];
+            if ( i & 1 )
+                dst[ i / 2 ] |= code;
+            else
+                dst[ i / 2 ] = code << 4;
+        }
+        rec->used += ( l_seq + 1 ) / 2;
+    }
+    return rc;
+}
+
+
+static rc_t encode_qual( bam_buffer * rec, const bam_rec * r )
+{
+    rc_t rc = buffer_reserve( rec, r->l_seq );
+    if ( rc == 0 )
+    {
+        uint8_t * dst = &rec->data[ rec->used ];
+        size_t i;
+        if ( r->qual == NULL )
+            memset( dst, 0xff, r->l_seq );
+        else
+        {
+            for ( i = 0; i < r->l_seq; ++i )
+            {
+                uint8_t q = ( uint8_t )r->qual[ r->qual_reverse ? r->l_seq - i - 1 : i ] - r->qual_offset;
+                dst[ i ] = ( r->qual_quant != NULL ) ? r->qual_quant[ q ] : q;
+            }
+        }
+        rec->used += r->l_seq;
+    }
+    return rc;
+}
+
+
+static rc_t out_of_range( const char * tag, int64_t value )
+{
+    rc_t rc = RC( rcExe, rcString, rcConverting, rcRange, rcExcessive );
+    (void)PLOGERR( klogErr, ( klogErr, rc, "value $(v) of tag $(t) does not fit into a BAM-integer",
+                              "v=%ld,t=%.2s", value, tag ) );
+    return rc;
+}
+
+
+/* integers are stored in the smallest type that can hold them ( like samtools does ) */
+static rc_t encode_int_tag( bam_buffer * rec, const char * tag, int64_t v )
+{
+    rc_t rc;
+    if ( v < INT32_MIN || v > UINT32_MAX )
+        rc = out_of_range( tag, v );
+    else if ( v < 0 )
+    {
+        if ( v >= INT8_MIN )
+        {
+            rc = buffer_put_u8( rec, 'c' );
+            if ( rc == 0 ) rc = buffer_put_u8( rec, ( uint8_t )( int8_t )v );
+        }
+        else if ( v >= INT16_MIN )
+        {
+            rc = buffer_put_u8( rec, 's' );
+            if ( rc == 0 ) rc = buffer_put_u16( rec, ( uint16_t )( int16_t )v );
+        }
+        else
+        {
+            rc = buffer_put_u8( rec, 'i' );
+            if ( rc == 0 ) rc = buffer_put_u32( rec, ( uint32_t )( int32_t )v );
+        }
+    }
+    else
+    {
+        if ( v <= UINT8_MAX )
+        {
+            rc = buffer_put_u8( rec, 'C' );
+            if ( rc == 0 ) rc = buffer_put_u8( rec, ( uint8_t )v );
+        }
+        else if ( v <= UINT16_MAX )
+        {
+            rc = buffer_put_u8( rec, 'S' );
+            if ( rc == 0 ) rc = buffer_put_u16( rec, ( uint16_t )v );
+        }
+        else
+        {
+            rc = buffer_put_u8( rec, 'I' );
+            if ( rc == 0 ) rc = buffer_put_u32( rec, ( uint32_t )v );
+        }
+    }
+    return rc;
+}
+
+
+static rc_t encode_float( bam_buffer * rec, const char * value, char ** end )
+{
+    float f;
+    uint32_t u;
+    errno = 0;
+    f = strtof( value, end );
+    if ( *end == value || errno == ERANGE )
+        return RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+    memmove( &u, &f, sizeof u );
+    return buffer_put_u32( rec, u );
+}
+
+
+/* a decimal integer of the SAM-text, without silent truncation */
+static rc_t parse_int( const char * tag, const char * value, char ** end, int64_t min, int64_t max, int64_t * v )
+{
+    errno = 0;
+    *v = strtoll( value, end, 10 );
+    if ( *end == value )
+        return RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+    if ( errno == ERANGE || *v < min || *v > max )
+        return out_of_range( tag, *v );
+    return 0;
+}
+
+
+/* B:type,v1,v2,... */
+static rc_t encode_array_tag( bam_buffer * rec, const char * tag, const char * value )
+{
+    char subtype = value[ 0 ];
+    const char * p = value + 1;
+    size_t count_at = 0;
+    uint32_t count = 0;
+    rc_t rc = buffer_put_u8( rec, subtype );
+    if ( rc == 0 )
+    {
+        count_at = rec->used;
+        rc = buffer_put_u32( rec, 0 );
+    }
+    while ( rc == 0 && *p == ',' )
+    {
+        char * end = NULL;
+        int64_t v;
+        ++p;
+        switch ( subtype )
+        {
+            case 'c' : rc = parse_int( tag, p, &end, INT8_MIN, INT8_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u8( rec, ( uint8_t )( int8_t )v );
+                       break;
+            case 'C' : rc = parse_int( tag, p, &end, 0, UINT8_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u8( rec, ( uint8_t )v );
+                       break;
+            case 's' : rc = parse_int( tag, p, &end, INT16_MIN, INT16_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u16( rec, ( uint16_t )( int16_t )v );
+                       break;
+            case 'S' : rc = parse_int( tag, p, &end, 0, UINT16_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u16( rec, ( uint16_t )v );
+                       break;
+            case 'i' : rc = parse_int( tag, p, &end, INT32_MIN, INT32_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u32( rec, ( uint32_t )( int32_t )v );
+                       break;
+            case 'I' : rc = parse_int( tag, p, &end, 0, UINT32_MAX, &v );
+                       if ( rc == 0 ) rc = buffer_put_u32( rec, ( uint32_t )v );
+                       break;
+            case 'f' : rc = encode_float( rec, p, &end ); break;
+            default  : rc = RC( rcExe, rcString, rcParsing, rcFormat, rcUnrecognized ); break;
+        }
+        p = end;
+        count++;
+    }
+    if ( rc == 0 && *p != 0 )
+        rc = RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+    if ( rc == 0 )
+        set_u32( &rec->data[ count_at ], count );
+    return rc;
+}
+
+
+/* TAG:TYPE:VALUE */
+static rc_t encode_text_tag( bam_buffer * rec, const char * tag )
+{
+    rc_t rc;
+    const char * value = tag + 5;
+    char * end = NULL;
+    int64_t v;
+
+    if ( strlen( tag ) < 5 || tag[ 2 ] != ':' || tag[ 4 ] != ':' )
+        return RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+
+    rc = buffer_put( rec, tag, 2 );
+    if ( rc == 0 )
+    {
+        switch ( tag[ 3 ] )
+        {
+            case 'A' : rc = buffer_put_u8( rec, 'A' );
+                       if ( rc == 0 ) rc = buffer_put_u8( rec, value[ 0 ] );
+                       break;
+
+            case 'i' : rc = parse_int( tag, value, &end, INT64_MIN, INT64_MAX, &v );
+                       if ( rc == 0 && *end != 0 )
+                           rc = RC( rcExe, rcString, rcParsing, rcFormat, rcInvalid );
+                       if ( rc == 0 )
+                           rc = encode_int_tag( rec, tag, v );
+                       break;
+
+            case 'f' : rc = buffer_put_u8( rec, 'f' );
+                       if ( rc == 0 ) rc = encode_float( rec, value, &end );
+                       break;
+
+            case 'Z' :
+            case 'H' : rc = buffer_put_u8( rec, tag[ 3 ] );
+                       if ( rc == 0 ) rc = buffer_put( rec, value, strlen( value ) + 1 );
+                       break;
+
+            case 'B' : rc = buffer_put_u8( rec, 'B' );
+                       if ( rc == 0 ) rc = encode_array_tag( rec, tag, value );
+                       break;
+
+            default  : rc = RC( rcExe, rcString, rcParsing, rcFormat, rcUnrecognized ); break;
+        }
+    }
+    return rc;
+}
+
+
+rc_t bam_rec_tag_int( bam_rec * self, const char * tag, int64_t value )
+{
+    rc_t rc = buffer_put( &self->tags, tag, 2 );
+    if ( rc == 0 )
+        rc = encode_int_tag( &self->tags, tag, value );
+    return rc;
+}
+
+
+rc_t bam_rec_tag_char( bam_rec * self, const char * tag, char value )
+{
+    rc_t rc = buffer_put( &self->tags, tag, 2 );
+    if ( rc == 0 )
+        rc = buffer_put_u8( &self->tags, 'A' );
+    if ( rc == 0 )
+        rc = buffer_put_u8( &self->tags, value );
+    return rc;
+}
+
+
+rc_t bam_rec_tag_str( bam_rec * self, const char * tag, const char * value, size_t len )
+{
+    rc_t rc = buffer_put( &self->tags, tag, 2 );
+    if ( rc == 0 )
+        rc = buffer_put_u8( &self->tags, 'Z' );
+    if ( rc == 0 )
+        rc = buffer_put( &self->tags, value, len );
+    if ( rc == 0 )
+        rc = buffer_put_u8( &self->tags, 0 );
+    return rc;
+}
+
+
+rc_t bam_rec_tags_text( bam_rec * self, const char * text, size_t len )
+{
+    rc_t rc = 0;
+    char * copy = string_dup( text, len );
+    if ( copy == NULL )
+        rc = RC( rcExe, rcString, rcCopying, rcMemory, rcExhausted );
+    else
+    {
+        char * p = copy;
+        while ( rc == 0 && p != NULL )
+        {
+            char * tab = strchr( p, '\t' );
+            if ( tab != NULL )
+                *tab++ = 0;
+            if ( *p != 0 )
+                rc = encode_text_tag( &self->tags, p );
+            p = tab;
+        }
+        if ( rc != 0 )
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cannot encode optional field '$(t)'", "t=%s", p ) );
+        free( copy );
+    }
+    return rc;
+}
+
+
+rc_t bam_rec_write( bam_rec * self )
+{
+    rc_t rc = 0;
+    bam_buffer * enc = &self->enc;
+    const char * qname = ( self->qname_len > 0 ) ? self->qname : "*";
+    size_t qname_len = ( self->qname_len > 0 ) ? self->qname_len : 1;
+    uint32_t n_cigar = 0;
+    int32_t ref_len = 0;
+    size_t rec_at;
+
+    if ( qname_len > BAM_MAX_QNAME_LEN )
+    {
+        rc = RC( rcExe, rcString, rcWriting, rcName, rcExcessive );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "read-name '$(n)' is longer than $(m) characters, BAM cannot store it",
+                                  "n=%.*s,m=%u", ( uint32_t )qname_len, qname, BAM_MAX_QNAME_LEN ) );
+        return rc;
+    }
+    if ( self->rname_len > 0xffff || self->rnext_len > 0xffff )
+    {
+        rc = RC( rcExe, rcString, rcWriting, rcName, rcExcessive );
+        (void)LOGERR( klogErr, rc, "reference-name too long" );
+        return rc;
+    }
+
+    /* the prefix for bam_out: marker, length, end on the reference, RNAME, RNEXT */
+    enc->used = 0;
+    rc = buffer_put_u8( enc, BAM_REC_MARKER );
+    if ( rc == 0 ) rc = buffer_put_u32( enc, 0 );
+    if ( rc == 0 ) rc = buffer_put_u32( enc, 0 );
+    if ( rc == 0 ) rc = buffer_put_u16( enc, self->rname_len );
+    if ( rc == 0 ) rc = buffer_put( enc, self->rname, self->rname_len );
+    if ( rc == 0 ) rc = buffer_put_u16( enc, self->rnext_len );
+    if ( rc == 0 ) rc = buffer_put( enc, self->rnext, self->rnext_len );
+
+    /* the fixed part, refID, bin and n_cigar_op are patched in later */
+    rec_at = enc->used;
+    if ( rc == 0 ) rc = buffer_put_u32( enc, 0 );                      /* block_size */
+    if ( rc == 0 ) rc = buffer_put_u32( enc, ( uint32_t )-1 );         /* refID */
+    if ( rc == 0 ) rc = buffer_put_u32( enc, self->pos );
+    if ( rc == 0 ) rc = buffer_put_u8( enc, qname_len + 1 );
+    if ( rc == 0 ) rc = buffer_put_u8( enc, self->mapq );
+    if ( rc == 0 ) rc = buffer_put_u16( enc, 0 );                      /* bin */
+    if ( rc == 0 ) rc = buffer_put_u16( enc, 0 );                      /* n_cigar_op */
+    if ( rc == 0 ) rc = buffer_put_u16( enc, self->flag );
+    if ( rc == 0 ) rc = buffer_put_u32( enc, self->l_seq );
+    if ( rc == 0 ) rc = buffer_put_u32( enc, ( uint32_t )-1 );         /* next_refID */
+    if ( rc == 0 ) rc = buffer_put_u32( enc, self->pnext );
+    if ( rc == 0 ) rc = buffer_put_u32( enc, self->tlen );
+    if ( rc == 0 ) rc = buffer_put( enc, qname, qname_len );
+    if ( rc == 0 ) rc = buffer_put_u8( enc, 0 );
+    if ( rc == 0 )
+    {
+        rc = encode_cigar( enc, self->cigar, self->cigar_len, &n_cigar, &ref_len );
+        if ( rc != 0 )
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cannot encode CIGAR '$(c)' of '$(n)'",
+                                      "c=%.*s,n=%.*s", ( uint32_t )self->cigar_len, self->cigar,
+                                      ( uint32_t )qname_len, qname ) );
+    }
+    if ( rc == 0 ) rc = encode_seq( enc, self->seq, self->l_seq, self->seq_reverse );
+    if ( rc == 0 ) rc = encode_qual( enc, self );
+    if ( rc == 0 ) rc = buffer_put( enc, self->tags.data, self->tags.used );
+
+    if ( rc == 0 )
+    {
+        int32_t end = ( ref_len > 0 ) ? self->pos + ref_len : self->pos + 1;
+        uint8_t * rec = &enc->data[ rec_at ];
+        size_t num_writ;
+        KWrtWriter writer = KOutWriterGet();
+
+        set_u32( &enc->data[ 1 ], enc->used - BAM_REC_HDR_LEN );
+        set_u32( &enc->data[ BAM_REC_HDR_LEN ], end );
+        set_u32( rec, enc->used - rec_at - 4 );
+        set_u16( &rec[ BAM_OFS_BIN ], bam_reg2bin( self->pos < 0 ? 0 : self->pos, self->pos < 0 ? 1 : end ) );
+        set_u16( &rec[ BAM_OFS_BIN + 2 ], n_cigar );
+
+        rc = writer( KOutDataGet(), ( const char * )enc->data, enc->used, &num_writ );
+        if ( rc == 0 && num_writ != enc->used )
+            rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+    }
+    self->tags.used = 0;
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot write BAM-record" );
+    return rc;
+}
+
+
+/* =========================================================================================== */
+/* bam_out, behind the KOut-handler */
+
+typedef struct ref_key
+{
+    const char * name;
+    size_t len;
+} ref_key;
+
+
+static int64_t CC ref_vs_ref( const BSTNode * item, const BSTNode * n )
+{
+    return strcmp( ( ( const bam_ref * )item )->name, ( ( const bam_ref * )n )->name );
+}
+
+
+/* the same order as strcmp(), the key is not 0-terminated */
+static int64_t CC key_vs_ref( const void * item, const BSTNode * n )
+{
+    const ref_key * key = item;
+    const char * name = ( ( const bam_ref * )n )->name;
+    int res = strncmp( key->name, name, key->len );
+    if ( res == 0 && name[ key->len ] != 0 )
+        res = -1;
+    return res;
+}
+
+
+static void CC release_ref( BSTNode * n, void * data )
+{
+    bam_ref * ref = ( bam_ref * )n;
+    free( ( void * )ref->name );
+    free( ref );
+}
+
+
+/* -1 for '*', -2 if the reference is not in the header */
+static int32_t lookup_tid( bam_out * self, const char * name, size_t len )
+{
+    const bam_ref * ref = self->last_ref;
+    if ( len == 0 || ( len == 1 && name[ 0 ] == '*' ) )
+        return -1;
+    if ( ref == NULL || strncmp( ref->name, name, len ) != 0 || ref->name[ len ] != 0 )
+    {
+        ref_key key;
+        key.name = name;
+        key.len = len;
+        ref = ( const bam_ref * )BSTreeFind( &self->refs, &key, key_vs_ref );
+        if ( ref == NULL )
+            return -2;
+        self->last_ref = ref;
+    }
+    return ref->tid;
+}
+
+
+/* splits the line at the tabs, returns the number of fields */
+static uint32_t split_line( char * line, char ** fields, uint32_t max_fields )
+{
+    uint32_t n = 0;
+    char * p = line;
+    while ( n < max_fields )
+    {
+        char * tab = strchr( p, '\t' );
+        fields[ n++ ] = p;
+        if ( tab == NULL )
+            break;
+        *tab = 0;
+        p = tab + 1;
+    }
+    return n;
+}
+
+
+/* @SQ	SN:name	LN:length */
+static rc_t register_reference( bam_out * self, char * line )
+{
+    rc_t rc = 0;
+    char * fields[ BAM_MAX_FIELDS ];
+    uint32_t i, n = split_line( line, fields, BAM_MAX_FIELDS );
+    const char * name = NULL;
+    uint32_t len = 0;
+
+    for ( i = 1; i < n; ++i )
+    {
+        if ( fields[ i ][ 0 ] == 'S' && fields[ i ][ 1 ] == 'N' && fields[ i ][ 2 ] == ':' )
+            name = &fields[ i ][ 3 ];
+        else if ( fields[ i ][ 0 ] == 'L' && fields[ i ][ 1 ] == 'N' && fields[ i ][ 2 ] == ':' )
+            len = strtoul( &fields[ i ][ 3 ], NULL, 10 );
+    }
+    if ( name != NULL )
+    {
+        bam_ref * ref = malloc( sizeof * ref );
+        if ( ref == NULL )
+            rc = RC( rcExe, rcNode, rcAllocating, rcMemory, rcExhausted );
+        else
+        {
+            ref->name = string_dup_measure( name, NULL );
+            ref->tid = self->n_refs;
+            ref->len = len;
+            if ( ref->name == NULL )
+            {
+                free( ref );
+                rc = RC( rcExe, rcNode, rcAllocating, rcMemory, rcExhausted );
+            }
+            else
+            {
+                rc = BSTreeInsertUnique( &self->refs, &ref->node, NULL, ref_vs_ref );
+                if ( rc == 0 )
+                    self->n_refs++;
+                else
+                {
+                    rc = RC( rcExe, rcNode, rcInserting, rcName, rcDuplicate );
+                    (void)PLOGERR( klogErr, ( klogErr, rc, "duplicate reference '$(r)' in header", "r=%s", name ) );
+                    release_ref( &ref->node, NULL );
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
+static void CC collect_ref( BSTNode * n, void * data )
+{
+    const bam_ref ** by_tid = data;
+    const bam_ref * ref = ( const bam_ref * )n;
+    by_tid[ ref->tid ] = ref;
+}
+
+
+/* magic, l_text, text, n_ref, ( l_name, name, l_ref ) * n_ref */
+static rc_t write_header( bam_out * self )
+{
+    rc_t rc = 0;
+    const bam_ref ** by_tid = calloc( self->n_refs + 1, sizeof by_tid[ 0 ] );
+    if ( by_tid == NULL )
+        rc = RC( rcExe, rcBuffer, rcWriting, rcMemory, rcExhausted );
+    else
+    {
+        bam_buffer hdr;
+        uint32_t i;
+
+        memset( &hdr, 0, sizeof hdr );
+        BSTreeForEach( &self->refs, false, collect_ref, by_tid );
+
+        rc = buffer_put( &hdr, "BAM\1", 4 );
+        if ( rc == 0 )
+            rc = buffer_put_u32( &hdr, self->header.used );
+        if ( rc == 0 )
+            rc = buffer_put( &hdr, self->header.data, self->header.used );
+        if ( rc == 0 )
+            rc = buffer_put_u32( &hdr, self->n_refs );
+        for ( i = 0; rc == 0 && i < self->n_refs; ++i )
+        {
+            size_t l_name = strlen( by_tid[ i ]->name ) + 1;
+            rc = buffer_put_u32( &hdr, l_name );
+            if ( rc == 0 )
+                rc = buffer_put( &hdr, by_tid[ i ]->name, l_name );
+            if ( rc == 0 )
+                rc = buffer_put_u32( &hdr, by_tid[ i ]->len );
+        }
+        if ( rc == 0 )
+            rc = bgzf_writer_write( self->bgzf, hdr.data, hdr.used );
+        /* the records start in a fresh block */
+        if ( rc == 0 )
+            rc = bgzf_writer_flush( self->bgzf );
+        free( hdr.data );
+        free( by_tid );
+    }
+
+    if ( rc == 0 && self->idx_fmt != bif_none )
+        rc = make_bam_index( &self->idx, self->n_refs );
+    if ( rc == 0 )
+        self->header_written = true;
+    else
+        (void)LOGERR( klogErr, rc, "cannot write BAM-header" );
+    return rc;
+}
+
+
+/* only the header is SAM-text, the records come encoded by bam_rec_write() */
+static rc_t process_line( bam_out * self, char * line, size_t len )
+{
+    rc_t rc = 0;
+    if ( len == 0 )
+        return 0;
+    if ( line[ 0 ] == '@' && !self->header_written )
+    {
+        rc = buffer_put( &self->header, line, len );
+        if ( rc == 0 )
+            rc = buffer_put_u8( &self->header, '\n' );
+        if ( rc == 0 && len > 3 && line[ 1 ] == 'S' && line[ 2 ] == 'Q' && line[ 3 ] == '\t' )
+        {
+            line[ len ] = 0;
+            rc = register_reference( self, line );
+        }
+    }
+    else
+    {
+        rc = RC( rcExe, rcString, rcWriting, rcFormat, rcUnexpected );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "unexpected SAM-text in BAM-output: '$(l)'",
+                                  "l=%.*s", ( uint32_t )( len > 64 ? 64 : len ), line ) );
+    }
+    return rc;
+}
+
+
+/* prefix ( see bam_rec_write() ) followed by the BAM-record */
+static rc_t process_record( bam_out * self, uint8_t * data, size_t len )
+{
+    rc_t rc = 0;
+    int32_t end = ( int32_t )get_u32( data );
+    size_t rname_len = get_u16( &data[ 4 ] );
+    const char * rname = ( const char * )&data[ 6 ];
+    size_t rnext_len = get_u16( &data[ 6 + rname_len ] );
+    const char * rnext = ( const char * )&data[ 8 + rname_len ];
+    uint8_t * rec = &data[ 8 + rname_len + rnext_len ];
+    size_t rec_len = len - ( 8 + rname_len + rnext_len );
+    int32_t tid, next_tid, pos;
+    uint32_t flag;
+
+    if ( !self->header_written )
+        rc = write_header( self );
+    if ( rc != 0 )
+        return rc;
+
+    tid = lookup_tid( self, rname, rname_len );
+    if ( rnext_len == 1 && rnext[ 0 ] == '=' )
+        next_tid = tid;
+    else
+        next_tid = lookup_tid( self, rnext, rnext_len );
+    if ( tid == -2 || next_tid == -2 )
+    {
+        rc = RC( rcExe, rcString, rcWriting, rcId, rcNotFound );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "reference '$(r)' is not in the header", "r=%.*s",
+                                  ( uint32_t )( tid == -2 ? rname_len : rnext_len ), tid == -2 ? rname : rnext ) );
+        return rc;
+    }
+    set_u32( &rec[ BAM_OFS_REFID ], tid );
+    set_u32( &rec[ BAM_OFS_NEXT_REFID ], next_tid );
+    pos = ( int32_t )get_u32( &rec[ BAM_OFS_REFID + 4 ] );
+    flag = get_u16( &rec[ BAM_OFS_FLAG ] );
+
+    {
+        uint64_t vbeg = bgzf_writer_tell( self->bgzf );
+        rc = bgzf_writer_write( self->bgzf, rec, rec_len );
+        if ( rc == 0 && self->idx != NULL )
+            rc = bam_index_add( self->idx, pos < 0 ? -1 : tid, pos, end, ( flag & 0x4 ) == 0,
+                                vbeg, bgzf_writer_tell( self->bgzf ) );
+    }
+    return rc;
+}
+
+
+rc_t make_bam_out( struct bam_out ** self, KFile * dst, uint32_t num_threads,
+                   enum bam_index_format idx_fmt, const char * idx_filename )
+{
+    rc_t rc = 0;
+    bam_out * o = calloc( 1, sizeof * o );
+    *self = NULL;
+    if ( o == NULL )
+    {
+        rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create bam-writer" );
+    }
+    else
+    {
+        BSTreeInit( &o->refs );
+        o->idx_fmt = idx_fmt;
+        if ( idx_fmt != bif_none )
+        {
+            o->idx_filename = string_dup_measure( idx_filename, NULL );
+            if ( o->idx_filename == NULL )
+            {
+                rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+                (void)LOGERR( klogErr, rc, "cannot create bam-writer" );
+            }
+        }
+        if ( rc == 0 )
+            rc = make_bgzf_writer( &o->bgzf, dst, num_threads, -1 );
+        if ( rc == 0 )
+            *self = o;
+        else
+            release_bam_out( o );
+    }
+    return rc;
+}
+
+
+rc_t bam_out_write( struct bam_out * self, const char * data, size_t len )
+{
+    rc_t rc = 0;
+    bam_buffer * p = &self->pending;
+    while ( rc == 0 && len > 0 )
+    {
+        size_t part;
+        if ( ( p->used > 0 ? p->data[ 0 ] : ( uint8_t )data[ 0 ] ) == BAM_REC_MARKER )
+        {
+            /* an encoded record: first the header with the length, then the rest */
+            size_t need = BAM_REC_HDR_LEN;
+            if ( p->used >= BAM_REC_HDR_LEN )
+                need += get_u32( &p->data[ 1 ] );
+            part = need - p->used;
+            if ( part > len )
+                part = len;
+            rc = buffer_put( p, data, part );
+            if ( rc == 0 && p->used >= BAM_REC_HDR_LEN &&
+                 p->used == BAM_REC_HDR_LEN + get_u32( &p->data[ 1 ] ) )
+            {
+                rc = process_record( self, &p->data[ BAM_REC_HDR_LEN ], p->used - BAM_REC_HDR_LEN );
+                p->used = 0;
+            }
+        }
+        else
+        {
+            /* a header-line */
+            const char * nl = memchr( data, '\n', len );
+            part = ( nl == NULL ) ? len : ( size_t )( nl - data );
+
+            /* one extra byte, to terminate the line */
+            rc = buffer_reserve( p, part + 1 );
+            if ( rc == 0 )
+            {
+                memmove( &p->data[ p->used ], data, part );
+                p->used += part;
+                if ( nl != NULL )
+                {
+                    rc = process_line( self, ( char * )p->data, p->used );
+                    p->used = 0;
+                    ++part;
+                }
+            }
+        }
+        data += part;
+        len -= part;
+    }
+    return rc;
+}
+
+
+rc_t bam_out_finish( struct bam_out * self )
+{
+    rc_t rc = 0;
+    if ( self->pending.used > 0 )
+    {
+        if ( self->pending.data[ 0 ] == BAM_REC_MARKER )
+        {
+            rc = RC( rcExe, rcFile, rcWriting, rcData, rcIncomplete );
+            (void)LOGERR( klogErr, rc, "incomplete BAM-record at the end of the output" );
+        }
+        else
+        {
+            rc = buffer_reserve( &self->pending, 1 );
+            if ( rc == 0 )
+                rc = process_line( self, ( char * )self->pending.data, self->pending.used );
+        }
+        self->pending.used = 0;
+    }
+    if ( rc == 0 && !self->header_written )
+        rc = write_header( self );
+    if ( rc == 0 )
+        rc = bgzf_writer_finish( self->bgzf );
+    if ( rc == 0 && self->idx != NULL )
+    {
+        if ( bam_index_is_valid( self->idx ) )
+            rc = bam_index_write( self->idx, self->bgzf, self->idx_fmt, self->idx_filename );
+        else
+            (void)LOGMSG( klogWarn, "output is not sorted by coordinate, no index written" );
+    }
+    return rc;
+}
+
+
+void release_bam_out( struct bam_out * self )
+{
+    if ( self != NULL )
+    {
+        release_bgzf_writer( self->bgzf );
+        release_bam_index( self->idx );
+        BSTreeWhack( &self->refs, release_ref, NULL );
+        free( self->pending.data );
+        free( self->header.data );
+        free( self->idx_filename );
+        free( self );
+    }
+}
@@ -0,0 +1,127 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bam_out_
+#define _h_bam_out_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <klib/rc.h>
+#include <klib/log.h>
+
+#include <kfs/file.h>
+
+#include "bam_index.h"
+
+/*
+    the record-printers ( sam-aligned.c, sam-unaligned.c ) fill a bam_rec straight from the
+    column-values and hand it to bam_rec_write(), which encodes the BAM-record and writes it
+    through the KOut-handler ( the dump-pool captures and orders it like SAM-text )
+
+    bam_out sits behind the KOut-handler: it collects the header-lines ( SAM-text, the
+    @SQ-lines define the reference-ids ), resolves the reference-names of the encoded
+    records and hands the records to a bgzf-writer
+*/
+
+typedef struct bam_buffer
+{
+    uint8_t * data;
+    size_t size;
+    size_t used;
+} bam_buffer;
+
+
+/* BAM stores l_read_name ( including the terminating 0 ) in one byte */
+#define BAM_MAX_QNAME_LEN 254
+
+typedef struct bam_rec
+{
+    const char * qname;             /* empty: '*' */
+    size_t qname_len;
+    uint32_t flag;
+    const char * rname;             /* empty: '*' */
+    size_t rname_len;
+    int32_t pos;                    /* 0-based, -1: no position */
+    uint32_t mapq;
+    const char * cigar;             /* the CIGAR-text, empty: '*' */
+    size_t cigar_len;
+    const char * rnext;             /* empty: '*', "=": the same as rname */
+    size_t rnext_len;
+    int32_t pnext;                  /* 0-based, -1: no position */
+    int32_t tlen;
+    const char * seq;               /* empty: '*' */
+    size_t l_seq;
+    bool seq_reverse;               /* store the reverse complement of seq */
+    const char * qual;              /* l_seq values, NULL: '*' */
+    uint8_t qual_offset;            /* 33: phred+33 text, 0: raw phred-values */
+    bool qual_reverse;
+    const uint8_t * qual_quant;     /* NULL or the quantization-matrix for the phred-values */
+
+    bam_buffer tags;                /* the encoded optional fields */
+    bam_buffer enc;                 /* the encoded record */
+} bam_rec;
+
+/* pos and pnext become -1, everything else empty */
+void bam_rec_init( bam_rec * self );
+
+/* clears the fields for the next record, keeps the buffers */
+void bam_rec_reset( bam_rec * self );
+
+void bam_rec_release( bam_rec * self );
+
+/* the value has to fit into 32 bits ( signed or unsigned ), BAM has no wider integer */
+rc_t bam_rec_tag_int( bam_rec * self, const char * tag, int64_t value );
+
+rc_t bam_rec_tag_char( bam_rec * self, const char * tag, char value );
+
+rc_t bam_rec_tag_str( bam_rec * self, const char * tag, const char * value, size_t len );
+
+/* optional fields only available as SAM-text ( cg_tools.c ): TAG:TYPE:VALUE, tab-separated */
+rc_t bam_rec_tags_text( bam_rec * self, const char * text, size_t len );
+
+/* encodes the record, writes it and clears the tags */
+rc_t bam_rec_write( bam_rec * self );
+
+
+struct bam_out;
+
+rc_t make_bam_out( struct bam_out ** self, KFile * dst, uint32_t num_threads,
+                   enum bam_index_format idx_fmt, const char * idx_filename );
+
+/* what arrives at the KOut-handler: the header-lines and the records of bam_rec_write(),
+   the data can be split at any position */
+rc_t bam_out_write( struct bam_out * self, const char * data, size_t len );
+
+/* writes the header ( if no record came ), the EOF-marker and the index ( if requested ) */
+rc_t bam_out_finish( struct bam_out * self );
+
+void release_bam_out( struct bam_out * self );
+
+#endif
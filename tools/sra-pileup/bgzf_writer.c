@@ -0,0 +1,489 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bgzf_writer.h"
+
+#include <klib/vector.h>
+#include <kproc/thread.h>
+#include <kproc/queue.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/timeout.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define BGZF_WAIT_MS 100
+
+/* max. uncompressed bytes per block, leaves room for incompressible data */
+#define BGZF_BLOCK_DATA 0xff00
+#define BGZF_MAX_BLOCK 0x10000
+#define BGZF_HDR_SIZE 18
+#define BGZF_FTR_SIZE 8
+
+static const uint8_t bgzf_eof_marker[ 28 ] =
+{
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+typedef struct bgzf_block
+{
+    uint64_t nr;
+    uint32_t ulen;
+    uint32_t clen;
+    uint8_t udata[ BGZF_BLOCK_DATA ];
+    uint8_t cdata[ BGZF_MAX_BLOCK ];
+} bgzf_block;
+
+
+typedef struct bgzf_writer
+{
+    KFile * dst;
+    uint64_t dst_pos;
+    int level;
+
+    /* the block currently filled by bgzf_writer_write() */
+    bgzf_block * current;
+    uint64_t next_block_nr;
+
+    /* the file-offset of every written block, indexed by block-number */
+    uint64_t * offsets;
+    uint64_t offsets_size;
+
+    /* compressed blocks waiting to be written in order */
+    KLock * lock;
+    KCondition * cond;
+    bgzf_block ** pending;
+    uint32_t max_pending;
+    uint64_t next_write;
+
+    KQueue * blocks;
+    Vector threads;
+    rc_t rc;            /* the first error, protected by lock */
+} bgzf_writer;
+
+
+static void put_u16( uint8_t * dst, uint32_t value )
+{
+    dst[ 0 ] = value & 0xff;
+    dst[ 1 ] = ( value >> 8 ) & 0xff;
+}
+
+
+static void put_u32( uint8_t * dst, uint32_t value )
+{
+    put_u16( dst, value & 0xffff );
+    put_u16( dst + 2, value >> 16 );
+}
+
+
+static int deflate_block( bgzf_block * b, int level )
+{
+    z_stream zs;
+    int zrc;
+
+    memset( &zs, 0, sizeof zs );
+    zrc = deflateInit2( &zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY );
+    if ( zrc == Z_OK )
+    {
+        zs.next_in = b->udata;
+        zs.avail_in = b->ulen;
+        zs.next_out = &b->cdata[ BGZF_HDR_SIZE ];
+        zs.avail_out = BGZF_MAX_BLOCK - BGZF_HDR_SIZE - BGZF_FTR_SIZE;
+        zrc = deflate( &zs, Z_FINISH );
+        if ( zrc == Z_STREAM_END )
+        {
+            b->clen = BGZF_HDR_SIZE + zs.total_out + BGZF_FTR_SIZE;
+            zrc = Z_OK;
+        }
+        else if ( zrc == Z_OK )
+            zrc = Z_BUF_ERROR; /* did not fit into one block */
+        deflateEnd( &zs );
+    }
+    return zrc;
+}
+
+
+static rc_t compress_block( bgzf_block * b, int level )
+{
+    static const uint8_t hdr[ 16 ] =
+        { 0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00 };
+    uint32_t crc;
+    int zrc = deflate_block( b, level );
+    if ( zrc == Z_BUF_ERROR )
+    {
+        /* incompressible data: stored blocks always fit, because of BGZF_BLOCK_DATA */
+        zrc = deflate_block( b, 0 );
+    }
+    if ( zrc != Z_OK )
+        return RC( rcExe, rcEncryption, rcWriting, rcData, rcUnexpected );
+
+    memmove( b->cdata, hdr, sizeof hdr );
+    put_u16( &b->cdata[ 16 ], b->clen - 1 );
+    crc = crc32( 0L, Z_NULL, 0 );
+    crc = crc32( crc, b->udata, b->ulen );
+    put_u32( &b->cdata[ b->clen - 8 ], crc );
+    put_u32( &b->cdata[ b->clen - 4 ], b->ulen );
+    return 0;
+}
+
+
+/* called with the lock held ( or after all workers are done ) */
+static rc_t write_block( bgzf_writer * self, uint64_t nr, const uint8_t * data, uint32_t len )
+{
+    size_t num_writ;
+    rc_t rc;
+
+    if ( nr >= self->offsets_size )
+    {
+        uint64_t new_size = ( self->offsets_size == 0 ) ? 1024 : self->offsets_size * 2;
+        uint64_t * tmp = realloc( self->offsets, new_size * sizeof self->offsets[ 0 ] );
+        if ( tmp == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        self->offsets = tmp;
+        self->offsets_size = new_size;
+    }
+    self->offsets[ nr ] = self->dst_pos;
+
+    rc = KFileWriteAll( self->dst, self->dst_pos, data, len, &num_writ );
+    if ( rc == 0 )
+        self->dst_pos += num_writ;
+    else
+        (void)LOGERR( klogErr, rc, "cannot write BGZF-block" );
+    return rc;
+}
+
+
+/* hands a compressed block to the ordered writer, takes ownership of the block */
+static rc_t deliver_block( bgzf_writer * self, bgzf_block * b, rc_t rc )
+{
+    rc_t rc1 = KLockAcquire( self->lock );
+    if ( rc1 == 0 )
+    {
+        if ( rc != 0 && self->rc == 0 )
+            self->rc = rc;
+        if ( self->rc != 0 )
+            free( b );
+        else
+        {
+            self->pending[ b->nr % self->max_pending ] = b;
+            while ( self->rc == 0 && self->pending[ self->next_write % self->max_pending ] != NULL )
+            {
+                uint32_t slot = self->next_write % self->max_pending;
+                bgzf_block * next = self->pending[ slot ];
+                if ( next->nr != self->next_write )
+                    break;
+                self->rc = write_block( self, next->nr, next->cdata, next->clen );
+                self->pending[ slot ] = NULL;
+                free( next );
+                self->next_write++;
+            }
+        }
+        rc = self->rc;
+        KConditionBroadcast( self->cond );
+        KLockUnlock( self->lock );
+    }
+    else
+    {
+        free( b );
+        rc = rc1;
+    }
+    return rc;
+}
+
+
+static rc_t CC bgzf_worker( const KThread * thread, void * data )
+{
+    bgzf_writer * self = data;
+    rc_t rc = 0;
+    while ( rc == 0 )
+    {
+        timeout_t tm;
+        bgzf_block * b = NULL;
+
+        rc = TimeoutInit( &tm, BGZF_WAIT_MS );
+        if ( rc == 0 )
+            rc = KQueuePop( self->blocks, ( void ** )&b, &tm );
+        if ( rc == 0 )
+            rc = deliver_block( self, b, compress_block( b, self->level ) );
+        else if ( GetRCState( rc ) == rcDone && GetRCObject( rc ) == ( enum RCObject )rcData )
+            rc = SILENT_RC( rcExe, rcQueue, rcReading, rcData, rcDone );
+        else if ( GetRCObject( rc ) == ( enum RCObject )rcTimeout )
+            rc = 0;
+        else
+            (void)LOGERR( klogInt, rc, "bgzf-writer: KQueuePop() failed" );
+    }
+    if ( GetRCState( rc ) == rcDone )
+        rc = 0;
+    else
+    {
+        /* unblock the producer */
+        if ( KLockAcquire( self->lock ) == 0 )
+        {
+            if ( self->rc == 0 )
+                self->rc = rc;
+            KConditionBroadcast( self->cond );
+            KLockUnlock( self->lock );
+        }
+    }
+    return rc;
+}
+
+
+/* waits until the block with this number can be put into the pending ring */
+static rc_t wait_for_room( bgzf_writer * self, uint64_t nr )
+{
+    rc_t rc = KLockAcquire( self->lock );
+    if ( rc == 0 )
+    {
+        while ( self->rc == 0 && nr >= self->next_write + self->max_pending )
+            KConditionWait( self->cond, self->lock );
+        rc = self->rc;
+        KLockUnlock( self->lock );
+    }
+    return rc;
+}
+
+
+static rc_t submit_block( bgzf_writer * self, bgzf_block * b )
+{
+    rc_t rc = 0;
+    if ( VectorLength( &self->threads ) == 0 )
+        return deliver_block( self, b, compress_block( b, self->level ) );
+
+    rc = wait_for_room( self, b->nr );
+    while ( rc == 0 )
+    {
+        timeout_t tm;
+        rc = TimeoutInit( &tm, BGZF_WAIT_MS );
+        if ( rc == 0 )
+            rc = KQueuePush( self->blocks, b, &tm );
+        if ( rc == 0 )
+            return 0;
+        if ( GetRCObject( rc ) == ( enum RCObject )rcTimeout )
+            rc = Quitting();
+        else
+            (void)LOGERR( klogInt, rc, "bgzf-writer: KQueuePush() failed" );
+    }
+    free( b );
+    return rc;
+}
+
+
+static rc_t new_block( bgzf_writer * self )
+{
+    bgzf_block * b = malloc( sizeof * b );
+    if ( b == NULL )
+        return RC( rcExe, rcBuffer, rcAllocating, rcMemory, rcExhausted );
+    b->nr = self->next_block_nr++;
+    b->ulen = 0;
+    b->clen = 0;
+    self->current = b;
+    return 0;
+}
+
+
+rc_t make_bgzf_writer( struct bgzf_writer ** self, KFile * dst, uint32_t num_threads, int level )
+{
+    rc_t rc = 0;
+    bgzf_writer * w = calloc( 1, sizeof * w );
+    *self = NULL;
+    if ( w == NULL )
+        rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        uint32_t idx;
+
+        w->dst = dst;
+        w->level = level;
+        w->max_pending = ( num_threads == 0 ) ? 1 : num_threads * 4;
+        VectorInit( &w->threads, 0, num_threads + 1 );
+
+        rc = KFileAddRef( dst );
+        if ( rc == 0 )
+            rc = KLockMake( &w->lock );
+        if ( rc == 0 )
+            rc = KConditionMake( &w->cond );
+        if ( rc == 0 )
+        {
+            w->pending = calloc( w->max_pending, sizeof w->pending[ 0 ] );
+            if ( w->pending == NULL )
+                rc = RC( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+        }
+        if ( rc == 0 && num_threads > 0 )
+            rc = KQueueMake( &w->blocks, w->max_pending );
+        for ( idx = 0; rc == 0 && idx < num_threads; ++idx )
+        {
+            KThread * thread;
+            rc = KThreadMake( &thread, bgzf_worker, w );
+            if ( rc == 0 )
+            {
+                rc = VectorAppend( &w->threads, NULL, thread );
+                if ( rc != 0 )
+                {
+                    KThreadCancel( thread );
+                    KThreadRelease( thread );
+                }
+            }
+        }
+        if ( rc == 0 )
+            rc = new_block( w );
+
+        if ( rc == 0 )
+            *self = w;
+        else
+            release_bgzf_writer( w );
+    }
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot create bgzf-writer" );
+    return rc;
+}
+
+
+rc_t bgzf_writer_write( struct bgzf_writer * self, const void * data, size_t size )
+{
+    rc_t rc = 0;
+    const uint8_t * src = data;
+    while ( rc == 0 && size > 0 )
+    {
+        bgzf_block * b = self->current;
+        size_t to_copy = BGZF_BLOCK_DATA - b->ulen;
+        if ( to_copy > size )
+            to_copy = size;
+        memmove( &b->udata[ b->ulen ], src, to_copy );
+        b->ulen += to_copy;
+        src += to_copy;
+        size -= to_copy;
+        if ( b->ulen == BGZF_BLOCK_DATA )
+            rc = bgzf_writer_flush( self );
+    }
+    return rc;
+}
+
+
+uint64_t bgzf_writer_tell( const struct bgzf_writer * self )
+{
+    return ( self->current->nr << 16 ) | self->current->ulen;
+}
+
+
+rc_t bgzf_writer_flush( struct bgzf_writer * self )
+{
+    rc_t rc = 0;
+    if ( self->current->ulen > 0 )
+    {
+        rc = submit_block( self, self->current ); /* takes ownership */
+        self->current = NULL;
+        if ( rc == 0 )
+            rc = new_block( self );
+    }
+    return rc;
+}
+
+
+rc_t bgzf_writer_finish( struct bgzf_writer * self )
+{
+    rc_t rc = bgzf_writer_flush( self );
+    uint32_t idx, n = VectorLength( &self->threads );
+
+    if ( self->blocks != NULL )
+        KQueueSeal( self->blocks );
+    for ( idx = VectorStart( &self->threads ); idx < n; ++idx )
+    {
+        KThread * thread = VectorGet( &self->threads, idx );
+        if ( thread != NULL )
+        {
+            rc_t rc1;
+            KThreadWait( thread, &rc1 );
+            if ( rc == 0 && rc1 != 0 )
+                rc = rc1;
+            KThreadRelease( thread );
+        }
+    }
+    VectorWhack( &self->threads, NULL, NULL );
+
+    if ( rc == 0 )
+        rc = self->rc;
+    if ( rc == 0 )
+    {
+        /* the block-position of the end of the data resolves to the EOF-marker */
+        rc = write_block( self, self->current->nr, bgzf_eof_marker, sizeof bgzf_eof_marker );
+    }
+    return rc;
+}
+
+
+uint64_t bgzf_writer_resolve( const struct bgzf_writer * self, uint64_t block_pos )
+{
+    uint64_t nr = block_pos >> 16;
+    if ( nr >= self->offsets_size )
+        return 0;
+    return ( self->offsets[ nr ] << 16 ) | ( block_pos & 0xffff );
+}
+
+
+void release_bgzf_writer( struct bgzf_writer * self )
+{
+    if ( self != NULL )
+    {
+        uint32_t idx, n = VectorLength( &self->threads );
+        if ( self->blocks != NULL )
+            KQueueSeal( self->blocks );
+        for ( idx = VectorStart( &self->threads ); idx < n; ++idx )
+        {
+            KThread * thread = VectorGet( &self->threads, idx );
+            if ( thread != NULL )
+            {
+                KThreadWait( thread, NULL );
+                KThreadRelease( thread );
+            }
+        }
+        VectorWhack( &self->threads, NULL, NULL );
+        if ( self->blocks != NULL )
+        {
+            bgzf_block * b;
+            timeout_t tm;
+            while ( TimeoutInit( &tm, 0 ) == 0 && KQueuePop( self->blocks, ( void ** )&b, &tm ) == 0 )
+                free( b );
+            KQueueRelease( self->blocks );
+        }
+        if ( self->pending != NULL )
+        {
+            uint32_t i;
+            for ( i = 0; i < self->max_pending; ++i )
+                free( self->pending[ i ] );
+            free( self->pending );
+        }
+        free( self->current );
+        free( self->offsets );
+        KConditionRelease( self->cond );
+        KLockRelease( self->lock );
+        KFileRelease( self->dst );
+        free( self );
+    }
+}
@@ -0,0 +1,71 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_bgzf_writer_
+#define _h_bgzf_writer_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <klib/rc.h>
+#include <klib/log.h>
+
+#include <kfs/file.h>
+
+/*
+    writes data as a sequence of BGZF-blocks ( gzip-members of at most 64k, see SAM/BAM-spec ),
+    the blocks are compressed by a pool of worker-threads and written in order
+
+    positions are reported as "block-positions" ( block-number << 16 | offset in block ),
+    because the compressed size of a block is not known before it has been compressed,
+    bgzf_writer_resolve() turns them into real virtual file-offsets after bgzf_writer_finish()
+*/
+
+struct bgzf_writer;
+
+/* num_threads == 0 ... compress in the calling thread, level is the zlib-level */
+rc_t make_bgzf_writer( struct bgzf_writer ** self, KFile * dst, uint32_t num_threads, int level );
+
+rc_t bgzf_writer_write( struct bgzf_writer * self, const void * data, size_t size );
+
+/* the block-position where the next byte will be written */
+uint64_t bgzf_writer_tell( const struct bgzf_writer * self );
+
+/* completes the current block, the next byte will start a new block */
+rc_t bgzf_writer_flush( struct bgzf_writer * self );
+
+/* flushes, waits for all blocks to be written and appends the EOF-marker */
+rc_t bgzf_writer_finish( struct bgzf_writer * self );
+
+/* translates a block-position into a virtual file-offset, valid after bgzf_writer_finish() */
+uint64_t bgzf_writer_resolve( const struct bgzf_writer * self, uint64_t block_pos );
+
+void release_bgzf_writer( struct bgzf_writer * self );
+
+#endif
@@ -0,0 +1,385 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "col_prefetch.h"
+#include "read_fkt.h"
+
+#include <klib/log.h>
+#include <vdb/blob.h>
+#include <sysalloc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if WINDOWS
+#define THREAD_LOCAL __declspec( thread )
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+typedef struct prefetch_cell
+{
+    size_t offset;          /* into the data-buffer of the column */
+    uint32_t elem_bits;
+    uint32_t row_len;
+    bool valid;             /* false: read from the cursor */
+} prefetch_cell;
+
+
+typedef struct prefetch_column
+{
+    uint32_t idx;
+    prefetch_cell * cells;  /* one for each row, in the order of the sorted rows */
+    char * data;
+    size_t data_used;
+    size_t data_size;
+} prefetch_column;
+
+
+struct col_prefetch
+{
+    const VCursor * cursor;
+    struct col_prefetch * next_active;
+
+    int64_t * rows;
+    uint32_t row_count;
+    uint32_t row_cap;
+    uint32_t cell_cap;      /* how many cells are allocated per column */
+    bool loaded;            /* rows are sorted and unique, cells are valid */
+
+    prefetch_column * columns;
+    uint32_t column_count;
+    uint32_t column_cap;
+};
+
+
+/* the prefetches that are active in this thread */
+static THREAD_LOCAL struct col_prefetch * active = NULL;
+
+/* zero-length cells point here, the read-functions do not dereference them */
+static const uint64_t empty_cell = 0;
+
+
+rc_t make_col_prefetch( struct col_prefetch ** self, const VCursor * cursor )
+{
+    rc_t rc = 0;
+    struct col_prefetch * o = calloc( 1, sizeof * o );
+    if ( o == NULL )
+    {
+        rc = RC( rcExe, rcBuffer, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create column-prefetch" );
+    }
+    else
+    {
+        o->cursor = cursor;
+        *self = o;
+    }
+    return rc;
+}
+
+
+void release_col_prefetch( struct col_prefetch * self )
+{
+    if ( self != NULL )
+    {
+        uint32_t i;
+        col_prefetch_deactivate( self );
+        for ( i = 0; i < self->column_count; ++i )
+        {
+            free( self->columns[ i ].cells );
+            free( self->columns[ i ].data );
+        }
+        free( self->columns );
+        free( self->rows );
+        free( self );
+    }
+}
+
+
+rc_t col_prefetch_add_column( struct col_prefetch * self, uint32_t idx )
+{
+    uint32_t i;
+    if ( idx == COL_NOT_AVAILABLE )
+        return 0;
+    for ( i = 0; i < self->column_count; ++i )
+    {
+        if ( self->columns[ i ].idx == idx )
+            return 0;
+    }
+    if ( self->column_count == self->column_cap )
+    {
+        uint32_t new_cap = ( self->column_cap == 0 ) ? 16 : self->column_cap * 2;
+        prefetch_column * tmp = realloc( self->columns, new_cap * sizeof * tmp );
+        if ( tmp == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        self->columns = tmp;
+        self->column_cap = new_cap;
+    }
+    memset( &self->columns[ self->column_count ], 0, sizeof self->columns[ 0 ] );
+    self->columns[ self->column_count ].idx = idx;
+    if ( self->cell_cap > 0 )
+    {
+        self->columns[ self->column_count ].cells = calloc( self->cell_cap, sizeof( prefetch_cell ) );
+        if ( self->columns[ self->column_count ].cells == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+    }
+    self->column_count++;
+    return 0;
+}
+
+
+void col_prefetch_clear( struct col_prefetch * self )
+{
+    self->row_count = 0;
+    self->loaded = false;
+}
+
+
+rc_t col_prefetch_add_row( struct col_prefetch * self, int64_t row_id )
+{
+    if ( self->row_count == self->row_cap )
+    {
+        uint32_t new_cap = ( self->row_cap == 0 ) ? 1024 : self->row_cap * 2;
+        int64_t * tmp = realloc( self->rows, new_cap * sizeof * tmp );
+        if ( tmp == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        self->rows = tmp;
+        self->row_cap = new_cap;
+    }
+    self->rows[ self->row_count++ ] = row_id;
+    self->loaded = false;
+    return 0;
+}
+
+
+static int CC cmp_row_id( const void * a, const void * b )
+{
+    int64_t ra = *( const int64_t * )a;
+    int64_t rb = *( const int64_t * )b;
+    return ( ra < rb ) ? -1 : ( ( ra > rb ) ? 1 : 0 );
+}
+
+
+/* the rows are sorted: one blob after the other is fetched, the cells of all the rows
+   that are in it are copied out of it before it is released */
+static rc_t load_column( const VCursor * cursor, prefetch_column * col, const int64_t * rows, uint32_t row_count )
+{
+    rc_t rc = 0;
+    const VBlob * blob = NULL;
+    int64_t first = 0;
+    uint64_t count = 0;
+    uint32_t i;
+
+    col->data_used = 0;
+    for ( i = 0; i < row_count && rc == 0; ++i )
+    {
+        prefetch_cell * cell = &col->cells[ i ];
+        const void * base;
+        uint32_t boff;
+        rc_t rc2 = 0;
+
+        if ( blob == NULL || rows[ i ] < first || ( uint64_t )( rows[ i ] - first ) >= count )
+        {
+            if ( blob != NULL )
+            {
+                VBlobRelease( blob );
+                blob = NULL;
+            }
+            rc2 = VCursorGetBlobDirect( cursor, &blob, rows[ i ], col->idx );
+            if ( rc2 == 0 )
+                rc2 = VBlobIdRange( blob, &first, &count );
+            if ( rc2 != 0 && blob != NULL )
+            {
+                VBlobRelease( blob );
+                blob = NULL;
+            }
+        }
+        if ( rc2 == 0 )
+            rc2 = VBlobCellData( blob, rows[ i ], &cell->elem_bits, &base, &boff, &cell->row_len );
+        /* a cell that cannot be read ( or is not byte-aligned ) is read again later from the cursor,
+           that is where the error gets reported with the name of the column */
+        cell->valid = ( rc2 == 0 && boff == 0 );
+        if ( cell->valid )
+        {
+            size_t bytes = ( ( ( size_t )cell->elem_bits * cell->row_len ) + 7 ) / 8;
+            size_t offset = ( col->data_used + 7 ) & ~( size_t )7;  /* keep 64-bit values aligned */
+            if ( offset + bytes > col->data_size )
+            {
+                size_t new_size = ( col->data_size == 0 ) ? 64 * 1024 : col->data_size;
+                char * tmp;
+                while ( new_size < offset + bytes ) new_size *= 2;
+                tmp = realloc( col->data, new_size );
+                if ( tmp == NULL )
+                    rc = RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+                else
+                {
+                    col->data = tmp;
+                    col->data_size = new_size;
+                }
+            }
+            if ( rc == 0 )
+            {
+                if ( bytes > 0 )
+                    memmove( col->data + offset, base, bytes );
+                cell->offset = offset;
+                col->data_used = offset + bytes;
+            }
+        }
+    }
+    if ( blob != NULL )
+        VBlobRelease( blob );
+    return rc;
+}
+
+
+rc_t col_prefetch_load( struct col_prefetch * self )
+{
+    rc_t rc = 0;
+    uint32_t i, n = 0;
+
+    if ( self->row_count == 0 )
+    {
+        self->loaded = true;
+        return 0;
+    }
+
+    /* sorted and unique row-ids: the cursor sees every column in ascending row-order */
+    qsort( self->rows, self->row_count, sizeof self->rows[ 0 ], cmp_row_id );
+    for ( i = 0; i < self->row_count; ++i )
+    {
+        if ( n == 0 || self->rows[ n - 1 ] != self->rows[ i ] )
+            self->rows[ n++ ] = self->rows[ i ];
+    }
+    self->row_count = n;
+
+    if ( self->row_count > self->cell_cap )
+    {
+        for ( i = 0; i < self->column_count && rc == 0; ++i )
+        {
+            prefetch_cell * tmp = realloc( self->columns[ i ].cells, self->row_cap * sizeof * tmp );
+            if ( tmp == NULL )
+                rc = RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+            else
+                self->columns[ i ].cells = tmp;
+        }
+        if ( rc == 0 )
+            self->cell_cap = self->row_cap;
+    }
+
+    for ( i = 0; i < self->column_count && rc == 0; ++i )
+        rc = load_column( self->cursor, &self->columns[ i ], self->rows, self->row_count );
+
+    if ( rc != 0 )
+    {
+        (void)LOGERR( klogErr, rc, "cannot prefetch alignment-rows" );
+    }
+    else
+        self->loaded = true;
+    return rc;
+}
+
+
+void col_prefetch_activate( struct col_prefetch * self )
+{
+    struct col_prefetch * p;
+    for ( p = active; p != NULL; p = p->next_active )
+    {
+        if ( p == self )
+            return;
+    }
+    self->next_active = active;
+    active = self;
+}
+
+
+void col_prefetch_deactivate( struct col_prefetch * self )
+{
+    struct col_prefetch ** p = &active;
+    while ( *p != NULL )
+    {
+        if ( *p == self )
+        {
+            *p = self->next_active;
+            self->next_active = NULL;
+            return;
+        }
+        p = &( *p )->next_active;
+    }
+}
+
+
+static const prefetch_cell * find_cell( const struct col_prefetch * self, int64_t row_id, uint32_t idx,
+                                        const prefetch_column ** column )
+{
+    uint32_t c;
+    for ( c = 0; c < self->column_count; ++c )
+    {
+        if ( self->columns[ c ].idx == idx )
+        {
+            uint32_t lo = 0, hi = self->row_count;
+            while ( lo < hi )
+            {
+                uint32_t mid = lo + ( hi - lo ) / 2;
+                if ( self->rows[ mid ] < row_id )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if ( lo < self->row_count && self->rows[ lo ] == row_id && self->columns[ c ].cells[ lo ].valid )
+            {
+                *column = &self->columns[ c ];
+                return &self->columns[ c ].cells[ lo ];
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+
+rc_t col_prefetch_cell_data( const VCursor * cursor, int64_t row_id, uint32_t idx,
+                             uint32_t * elem_bits, const void ** base, uint32_t * boff, uint32_t * row_len )
+{
+    const struct col_prefetch * p;
+    for ( p = active; p != NULL; p = p->next_active )
+    {
+        if ( p->cursor == cursor && p->loaded )
+        {
+            const prefetch_column * col;
+            const prefetch_cell * cell = find_cell( p, row_id, idx, &col );
+            if ( cell != NULL )
+            {
+                *elem_bits = cell->elem_bits;
+                *boff = 0;
+                *row_len = cell->row_len;
+                *base = ( cell->row_len > 0 ) ? ( const void * )( col->data + cell->offset ) : ( const void * )&empty_cell;
+                return 0;
+            }
+            break;
+        }
+    }
+    return VCursorCellDataDirect( cursor, row_id, idx, elem_bits, base, boff, row_len );
+}
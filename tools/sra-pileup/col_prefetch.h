@@ -0,0 +1,79 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_col_prefetch_
+#define _h_col_prefetch_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <klib/rc.h>
+#include <vdb/cursor.h>
+
+/*
+    prefetch of alignment-rows for the placement-walker
+
+    the placement-iterator delivers the alignments in reference-order, which jumps
+    around in the row-space of the alignment-table. The walker collects the row-ids of
+    a batch of placements, the prefetch sorts them and reads every registered column
+    in row-id-order ( one column after the other, one blob after the other ) into its
+    own buffer.
+
+    while a prefetch is active, the read-functions in read_fkt.c are served from these
+    buffers instead of the cursor. Activation is per thread, a cell that is not in the
+    buffers is read from the cursor as before.
+*/
+
+struct col_prefetch;
+
+rc_t make_col_prefetch( struct col_prefetch ** self, const VCursor * cursor );
+
+void release_col_prefetch( struct col_prefetch * self );
+
+/* register a column to be prefetched, COL_NOT_AVAILABLE is ignored */
+rc_t col_prefetch_add_column( struct col_prefetch * self, uint32_t idx );
+
+/* forget the rows and the buffered cells of the previous batch */
+void col_prefetch_clear( struct col_prefetch * self );
+
+rc_t col_prefetch_add_row( struct col_prefetch * self, int64_t row_id );
+
+/* sort the rows and read all registered columns in row-id-order */
+rc_t col_prefetch_load( struct col_prefetch * self );
+
+/* make the buffered cells visible to the read-functions of the calling thread */
+void col_prefetch_activate( struct col_prefetch * self );
+void col_prefetch_deactivate( struct col_prefetch * self );
+
+/* the replacement for VCursorCellDataDirect(), used by read_fkt.c */
+rc_t col_prefetch_cell_data( const VCursor * cursor, int64_t row_id, uint32_t idx,
+                             uint32_t * elem_bits, const void ** base, uint32_t * boff, uint32_t * row_len );
+
+#endif
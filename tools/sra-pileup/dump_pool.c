@@ -0,0 +1,290 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "dump_pool.h"
+#include "out_redir.h"
+
+#include <klib/vector.h>
+#include <kproc/thread.h>
+#include <kproc/queue.h>
+#include <kproc/timeout.h>
+#include <atomic32.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+
+#define DUMP_POOL_WAIT_MS 100
+
+typedef struct dump_pool
+{
+    dump_pool_callbacks cb;
+    KQueue * jobs;
+    struct out_reorder * reorder;
+    Vector threads;
+    uint64_t next_seq;
+    atomic32_t aborted;
+} dump_pool;
+
+
+typedef struct dump_pool_job
+{
+    uint64_t seq;
+    void * job;
+} dump_pool_job;
+
+
+static void dump_pool_abort( dump_pool * self )
+{
+    atomic32_set( &self->aborted, 1 );
+    out_reorder_abort( self->reorder );
+}
+
+
+static rc_t dump_pool_run_job( dump_pool * self, dump_pool_job * pj, void * worker_data )
+{
+    out_chunk * chunk;
+    rc_t rc = make_out_chunk( &chunk, pj->seq );
+    if ( rc == 0 )
+    {
+        out_redir_capture( chunk );
+        rc = self->cb.on_job( pj->job, worker_data );
+        out_redir_capture( NULL );
+        if ( rc == 0 )
+            rc = out_reorder_put( self->reorder, chunk ); /* takes ownership of the chunk */
+        else
+            release_out_chunk( chunk );
+    }
+    return rc;
+}
+
+
+static rc_t CC dump_pool_worker( const KThread * thread, void * data )
+{
+    dump_pool * self = data;
+    void * worker_data = NULL;
+    rc_t rc = 0;
+
+    if ( self->cb.on_worker_start != NULL )
+        rc = self->cb.on_worker_start( self->cb.pool_data, &worker_data );
+
+    while ( rc == 0 )
+    {
+        timeout_t tm;
+        dump_pool_job * pj = NULL;
+
+        rc = TimeoutInit( &tm, DUMP_POOL_WAIT_MS );
+        if ( rc == 0 )
+            rc = KQueuePop( self->jobs, ( void ** )&pj, &tm );
+        if ( rc == 0 )
+        {
+            /* once the pool is aborted the remaining jobs are just dropped */
+            if ( atomic32_read( &self->aborted ) == 0 )
+                rc = dump_pool_run_job( self, pj, worker_data );
+            if ( self->cb.release_job != NULL )
+                self->cb.release_job( pj->job );
+            free( pj );
+        }
+        else if ( GetRCState( rc ) == rcDone && GetRCObject( rc ) == ( enum RCObject )rcData )
+        {
+            /* the queue has been sealed and is empty: we are done */
+            rc = SILENT_RC( rcExe, rcQueue, rcReading, rcData, rcDone );
+        }
+        else if ( GetRCObject( rc ) == ( enum RCObject )rcTimeout )
+        {
+            /* nothing to do yet, try again */
+            rc = 0;
+        }
+        else
+        {
+            (void)LOGERR( klogInt, rc, "dump_pool: KQueuePop() failed" );
+        }
+    }
+
+    if ( GetRCState( rc ) == rcDone )
+        rc = 0;
+    if ( rc != 0 )
+        dump_pool_abort( self );
+
+    if ( self->cb.on_worker_end != NULL )
+        self->cb.on_worker_end( worker_data );
+    return rc;
+}
+
+
+static void dump_pool_release( dump_pool * self )
+{
+    if ( self != NULL )
+    {
+        if ( self->jobs != NULL )
+        {
+            /* drop the jobs that have not been picked up */
+            dump_pool_job * pj;
+            timeout_t tm;
+            KQueueSeal( self->jobs );
+            while ( TimeoutInit( &tm, 0 ) == 0 && KQueuePop( self->jobs, ( void ** )&pj, &tm ) == 0 )
+            {
+                if ( self->cb.release_job != NULL )
+                    self->cb.release_job( pj->job );
+                free( pj );
+            }
+            KQueueRelease( self->jobs );
+        }
+        release_out_reorder( self->reorder );
+        free( self );
+    }
+}
+
+
+rc_t make_dump_pool( struct dump_pool ** self, uint32_t num_threads, const dump_pool_callbacks * cb )
+{
+    rc_t rc = 0;
+    dump_pool * p = calloc( 1, sizeof * p );
+    *self = NULL;
+    if ( p == NULL )
+    {
+        rc = RC( rcExe, rcThread, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create dump-pool" );
+    }
+    else
+    {
+        uint32_t idx;
+
+        p->cb = *cb;
+        VectorInit( &p->threads, 0, num_threads );
+        atomic32_set( &p->aborted, 0 );
+
+        /* enough jobs in flight to keep all workers busy */
+        rc = KQueueMake( &p->jobs, num_threads * 2 );
+        if ( rc != 0 )
+            (void)LOGERR( klogErr, rc, "dump-pool: KQueueMake() failed" );
+        else
+        {
+            /* every worker can be at most 4 chunks ahead of the writer */
+            rc = make_out_reorder( &p->reorder, num_threads * 4 );
+        }
+
+        for ( idx = 0; rc == 0 && idx < num_threads; ++idx )
+        {
+            KThread * thread;
+            rc = KThreadMake( &thread, dump_pool_worker, p );
+            if ( rc != 0 )
+                (void)LOGERR( klogErr, rc, "dump-pool: KThreadMake() failed" );
+            else
+            {
+                rc = VectorAppend( &p->threads, NULL, thread );
+                if ( rc != 0 )
+                {
+                    KThreadCancel( thread );
+                    KThreadRelease( thread );
+                }
+            }
+        }
+
+        if ( rc == 0 )
+            *self = p;
+        else
+            dump_pool_finish( p );
+    }
+    return rc;
+}
+
+
+rc_t dump_pool_submit( struct dump_pool * self, void * job )
+{
+    rc_t rc = 0;
+    dump_pool_job * pj = malloc( sizeof * pj );
+    if ( pj == NULL )
+    {
+        rc = RC( rcExe, rcThread, rcInserting, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create dump-pool job" );
+    }
+    else
+    {
+        bool pushed = false;
+        pj->seq = self->next_seq;
+        pj->job = job;
+        while ( rc == 0 && !pushed )
+        {
+            if ( atomic32_read( &self->aborted ) != 0 )
+                rc = RC( rcExe, rcThread, rcInserting, rcThread, rcCanceled );
+            else
+                rc = Quitting();
+            if ( rc == 0 )
+            {
+                timeout_t tm;
+                rc = TimeoutInit( &tm, DUMP_POOL_WAIT_MS );
+                if ( rc == 0 )
+                    rc = KQueuePush( self->jobs, pj, &tm );
+                if ( rc == 0 )
+                    pushed = true;
+                else if ( GetRCObject( rc ) == ( enum RCObject )rcTimeout )
+                    rc = 0; /* all workers are busy, try again */
+                else
+                    (void)LOGERR( klogInt, rc, "dump-pool: KQueuePush() failed" );
+            }
+        }
+        if ( pushed )
+            self->next_seq++;
+        else
+            free( pj );
+    }
+    if ( rc != 0 )
+    {
+        if ( self->cb.release_job != NULL )
+            self->cb.release_job( job );
+        dump_pool_abort( self );
+    }
+    return rc;
+}
+
+
+rc_t dump_pool_finish( struct dump_pool * self )
+{
+    rc_t rc = 0;
+    if ( self != NULL )
+    {
+        uint32_t idx, n = VectorLength( &self->threads );
+
+        /* no more jobs: the workers exit as soon as the queue is empty */
+        KQueueSeal( self->jobs );
+        for ( idx = VectorStart( &self->threads ); idx < n; ++idx )
+        {
+            KThread * thread = VectorGet( &self->threads, idx );
+            if ( thread != NULL )
+            {
+                rc_t rc1;
+                KThreadWait( thread, &rc1 );
+                if ( rc == 0 && rc1 != 0 )
+                    rc = rc1;
+                KThreadRelease( thread );
+            }
+        }
+        VectorWhack( &self->threads, NULL, NULL );
+        if ( rc == 0 && atomic32_read( &self->aborted ) != 0 )
+            rc = RC( rcExe, rcThread, rcExecuting, rcThread, rcCanceled );
+        dump_pool_release( self );
+    }
+    return rc;
+}
@@ -0,0 +1,74 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_dump_pool_
+#define _h_dump_pool_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <klib/rc.h>
+#include <klib/log.h>
+
+/*
+    a pool of worker-threads, each job produces a piece of output via KOutMsg(),
+    the output of the jobs is captured per job and written in the order the jobs
+    have been submitted ( see out_reorder in out_redir.h )
+*/
+
+typedef struct dump_pool_callbacks
+{
+    /* called once in every worker-thread, creates the per-thread data ( cursors etc. ) */
+    rc_t ( CC * on_worker_start ) ( void * pool_data, void ** worker_data );
+
+    /* called for every job, in any of the worker-threads */
+    rc_t ( CC * on_job ) ( void * job, void * worker_data );
+
+    /* called once in every worker-thread at the end */
+    void ( CC * on_worker_end ) ( void * worker_data );
+
+    /* releases a job after it has been processed ( or dropped ) */
+    void ( CC * release_job ) ( void * job );
+
+    void * pool_data;
+} dump_pool_callbacks;
+
+
+struct dump_pool;
+
+rc_t make_dump_pool( struct dump_pool ** self, uint32_t num_threads, const dump_pool_callbacks * cb );
+
+/* hands the job to the worker-threads, the pool takes ownership of the job */
+rc_t dump_pool_submit( struct dump_pool * self, void * job );
+
+/* waits for all submitted jobs to be processed and written, releases the pool */
+rc_t dump_pool_finish( struct dump_pool * self );
+
+#endif
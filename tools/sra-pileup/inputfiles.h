@@ -84,6 +84,9 @@ typedef struct input_files
     uint32_t table_count;
     uint32_t not_found_count;
 
+    /* the options the reference-lists have been created with */
+    uint32_t reflist_options;
+
     Vector dbs;
     Vector tabs;
     VNamelist * not_found;
@@ -25,8 +25,748 @@
 */
 
 #include "matecache.h"
+#include <kproc/lock.h>
+#include <kproc/procmgr.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
 #include <sysalloc.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define MC_INITIAL_CAPACITY 1024
+#define MC_SPILL_BLOCK 1024     /* records per block of the sparse index */
+#define MC_MERGE_BUF 4096       /* records buffered per run while merging / writing */
+
+/* the packed entries have limited room for keys and values */
+#define MC_SAME_REF_KEY_SHIFT 16
+#define MC_SAME_REF_MAX_KEY ( ( ( int64_t )1 << 48 ) - 2 )
+#define MC_UNALIGNED_KEY_SHIFT 24
+#define MC_UNALIGNED_MAX_KEY ( ( ( int64_t )1 << 40 ) - 2 )
+#define MC_UNALIGNED_MAX_SEQ ( ( ( int64_t )1 << 40 ) - 1 )
+#define MC_UNALIGNED_MAX_REF 0xffff
+
+/* one unaligned entry in the spill-file, not packed */
+typedef struct matecache_spill_rec
+{
+    int64_t key;
+    int64_t seq_id;
+    INSDC_coord_zero ref_pos;
+    uint32_t ref_idx;
+} matecache_spill_rec;
+
+
+typedef struct matecache_run
+{
+    uint64_t first;     /* index of the first record in the spill-file */
+    uint64_t count;
+} matecache_run;
+
+
+/* -------------------------------------------------------------------------------------------
+    the open-addressed hash-table ( linear probing, backward-shift deletion )
+   -------------------------------------------------------------------------------------------*/
+
+static int64_t entry_key( const matecache_table * t, const matecache_entry * e )
+{
+    return ( int64_t )( e->a >> t->key_shift ) - 1;
+}
+
+
+static uint64_t table_home( const matecache_table * t, int64_t key )
+{
+    uint64_t h = ( uint64_t )key * 0x9E3779B97F4A7C15ULL;
+    return ( h ^ ( h >> 29 ) ) & ( t->capacity - 1 );
+}
+
+
+static rc_t table_init( matecache_table * t, uint32_t key_shift, uint64_t max_capacity )
+{
+    t->key_shift = key_shift;
+    t->max_capacity = max_capacity;
+    t->capacity = ( max_capacity < MC_INITIAL_CAPACITY ) ? max_capacity : MC_INITIAL_CAPACITY;
+    t->count = 0;
+    t->entries = calloc( t->capacity, sizeof t->entries[ 0 ] );
+    if ( t->entries == NULL )
+        return RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    return 0;
+}
+
+
+static matecache_entry * table_find( const matecache_table * t, int64_t key )
+{
+    uint64_t mask = t->capacity - 1;
+    uint64_t idx = table_home( t, key );
+    while ( t->entries[ idx ].a != 0 )
+    {
+        if ( entry_key( t, &t->entries[ idx ] ) == key )
+            return &t->entries[ idx ];
+        idx = ( idx + 1 ) & mask;
+    }
+    return NULL;
+}
+
+
+/* there has to be room for the entry, replaces an entry with the same key */
+static void table_put( matecache_table * t, const matecache_entry * e )
+{
+    uint64_t mask = t->capacity - 1;
+    int64_t key = entry_key( t, e );
+    uint64_t idx = table_home( t, key );
+    while ( t->entries[ idx ].a != 0 )
+    {
+        if ( entry_key( t, &t->entries[ idx ] ) == key )
+        {
+            t->entries[ idx ] = *e;
+            return;
+        }
+        idx = ( idx + 1 ) & mask;
+    }
+    t->entries[ idx ] = *e;
+    t->count++;
+}
+
+
+static void table_remove_at( matecache_table * t, uint64_t idx )
+{
+    uint64_t mask = t->capacity - 1;
+    uint64_t j = idx;
+    for ( ;; )
+    {
+        uint64_t home;
+        j = ( j + 1 ) & mask;
+        if ( t->entries[ j ].a == 0 )
+            break;
+        home = table_home( t, entry_key( t, &t->entries[ j ] ) );
+        /* the entry at j can fill the hole, if its home is not in the range ( idx, j ] */
+        if ( ( ( j - home ) & mask ) >= ( ( j - idx ) & mask ) )
+        {
+            t->entries[ idx ] = t->entries[ j ];
+            idx = j;
+        }
+    }
+    t->entries[ idx ].a = 0;
+    t->entries[ idx ].b = 0;
+    t->count--;
+}
+
+
+static bool table_is_full( const matecache_table * t )
+{
+    return ( ( t->count + 1 ) * 4 > t->capacity * 3 );
+}
+
+
+static rc_t table_grow( matecache_table * t )
+{
+    matecache_table bigger = *t;
+    uint64_t idx;
+
+    bigger.capacity = t->capacity * 2;
+    bigger.count = 0;
+    bigger.entries = calloc( bigger.capacity, sizeof bigger.entries[ 0 ] );
+    if ( bigger.entries == NULL )
+        return RC( rcApp, rcNoTarg, rcResizing, rcMemory, rcExhausted );
+    for ( idx = 0; idx < t->capacity; ++idx )
+    {
+        if ( t->entries[ idx ].a != 0 )
+            table_put( &bigger, &t->entries[ idx ] );
+    }
+    free( t->entries );
+    *t = bigger;
+    return 0;
+}
+
+
+static void table_clear( matecache_table * t )
+{
+    memset( t->entries, 0, t->capacity * sizeof t->entries[ 0 ] );
+    t->count = 0;
+}
+
+
+static void table_release( matecache_table * t )
+{
+    free( t->entries );
+    t->entries = NULL;
+}
+
+
+/* bucket of a distance: number of significant bits */
+static uint32_t distance_bucket( int64_t d )
+{
+    uint32_t b = 0;
+    while ( d > 0 )
+    {
+        d >>= 1;
+        b++;
+    }
+    return b;
+}
+
+
+/* drop at least half of the same-ref entries: the ones farthest behind the current row,
+   their mates are far away, a later lookup misses and reads the mate from the table */
+static uint64_t table_evict_far( matecache_table * t, int64_t current_key )
+{
+    uint64_t histo[ 65 ];
+    uint64_t idx, acc = 0, before = t->count;
+    uint32_t b, threshold = 0;
+
+    memset( histo, 0, sizeof histo );
+    for ( idx = 0; idx < t->capacity; ++idx )
+    {
+        if ( t->entries[ idx ].a != 0 )
+            histo[ distance_bucket( current_key - entry_key( t, &t->entries[ idx ] ) ) ]++;
+    }
+    for ( b = 65; b > 0; --b )
+    {
+        acc += histo[ b - 1 ];
+        if ( acc * 2 >= t->count )
+        {
+            threshold = b - 1;
+            break;
+        }
+    }
+
+    idx = 0;
+    while ( idx < t->capacity )
+    {
+        if ( t->entries[ idx ].a != 0 &&
+             distance_bucket( current_key - entry_key( t, &t->entries[ idx ] ) ) >= threshold )
+            table_remove_at( t, idx ); /* an entry from behind may have moved into idx */
+        else
+            idx++;
+    }
+    return before - t->count;
+}
+
+
+static int CC cmp_entry_a( const void * a, const void * b )
+{
+    uint64_t x = ( ( const matecache_entry * )a )->a;
+    uint64_t y = ( ( const matecache_entry * )b )->a;
+    return ( x < y ) ? -1 : ( x > y ) ? 1 : 0;
+}
+
+
+/* -------------------------------------------------------------------------------------------
+    packing of the entries
+   -------------------------------------------------------------------------------------------*/
+
+static void pack_same_ref( matecache_entry * e, int64_t key, INSDC_coord_zero ref_pos,
+                           uint32_t flags, INSDC_coord_len tlen )
+{
+    e->a = ( ( uint64_t )( key + 1 ) << MC_SAME_REF_KEY_SHIFT ) | ( flags & 0xffff );
+    e->b = ( ( uint64_t )( uint32_t )ref_pos << 32 ) | ( uint32_t )tlen;
+}
+
+
+static bool fits_unaligned( int64_t key, INSDC_coord_zero ref_pos, uint32_t ref_idx, int64_t seq_id )
+{
+    return ( key >= 0 && key <= MC_UNALIGNED_MAX_KEY && seq_id >= 0 && seq_id <= MC_UNALIGNED_MAX_SEQ &&
+             ref_pos >= 0 && ref_idx <= MC_UNALIGNED_MAX_REF );
+}
+
+
+static void pack_unaligned( matecache_entry * e, const matecache_spill_rec * r )
+{
+    e->a = ( ( uint64_t )( r->key + 1 ) << MC_UNALIGNED_KEY_SHIFT ) | ( ( uint64_t )r->seq_id >> 16 );
+    e->b = ( ( uint64_t )( r->seq_id & 0xffff ) << 48 ) | ( ( uint64_t )( uint32_t )r->ref_pos << 16 ) | r->ref_idx;
+}
+
+
+static void unpack_unaligned( const matecache_table * t, const matecache_entry * e, matecache_spill_rec * r )
+{
+    r->key = entry_key( t, e );
+    r->seq_id = ( int64_t )( ( ( e->a & 0xffffff ) << 16 ) | ( e->b >> 48 ) );
+    r->ref_pos = ( INSDC_coord_zero )( ( e->b >> 16 ) & 0xffffffff );
+    r->ref_idx = ( uint32_t )( e->b & 0xffff );
+}
+
+
+/* -------------------------------------------------------------------------------------------
+    the spill-file for unaligned entries
+   -------------------------------------------------------------------------------------------*/
+
+static void CC free_run( void * item, void * data )
+{
+    free( item );
+}
+
+
+/* a new file in the temp. directory, named after the process, the input-file and the generation */
+static rc_t spill_create( matecache_spill * sp, struct KFile ** file, char * path, size_t path_size )
+{
+    KDirectory * dir;
+    uint32_t pid = 0;
+    struct KProcMgr * proc_mgr;
+    rc_t rc;
+
+    if ( KProcMgrMakeSingleton( &proc_mgr ) == 0 )
+    {
+        KProcMgrGetPID( proc_mgr, &pid );
+        KProcMgrRelease( proc_mgr );
+    }
+    rc = KDirectoryNativeDir( &dir );
+    if ( rc == 0 )
+    {
+        size_t num_writ;
+        rc = string_printf( path, path_size, &num_writ, "%s/sam-dump.matecache.%u.%u.%u.tmp",
+                            sp->temp_dir, pid, sp->db_idx, sp->generation++ );
+        if ( rc == 0 )
+            rc = KDirectoryCreateFile( dir, file, true, 0600, kcmInit, "%s", path );
+        KDirectoryRelease( dir );
+    }
+    if ( rc != 0 )
+        (void)PLOGERR( klogErr, ( klogErr, rc, "cannot create matecache spill-file in '$(dir)'",
+                                  "dir=%s", sp->temp_dir ) );
+    return rc;
+}
+
+
+static void spill_remove( struct KFile * file, const char * path )
+{
+    KDirectory * dir;
+    KFileRelease( file );
+    if ( KDirectoryNativeDir( &dir ) == 0 )
+    {
+        KDirectoryRemove( dir, true, "%s", path );
+        KDirectoryRelease( dir );
+    }
+}
+
+
+static rc_t spill_open( matecache_spill * sp )
+{
+    rc_t rc = 0;
+    if ( sp->file == NULL )
+    {
+        rc = spill_create( sp, &sp->file, sp->path, sizeof sp->path );
+        sp->file_size = 0;
+    }
+    return rc;
+}
+
+
+static void spill_close( matecache_spill * sp )
+{
+    if ( sp->file != NULL )
+    {
+        spill_remove( sp->file, sp->path );
+        sp->file = NULL;
+    }
+    VectorWhack( &sp->runs, free_run, NULL );
+    free( sp->pending );
+    sp->pending = NULL;
+    free( sp->block_keys );
+    sp->block_keys = NULL;
+    free( sp->block );
+    sp->block = NULL;
+}
+
+
+static rc_t spill_read( matecache_spill * sp, uint64_t first, matecache_spill_rec * dst, uint64_t count )
+{
+    size_t num_read;
+    rc_t rc = KFileReadAll( sp->file, first * sizeof * dst, dst, count * sizeof * dst, &num_read );
+    if ( rc == 0 && num_read != count * sizeof * dst )
+        rc = RC( rcApp, rcFile, rcReading, rcTransfer, rcIncomplete );
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot read matecache spill-file" );
+    return rc;
+}
+
+
+/* appends records at pos of a spill-file */
+typedef struct spill_writer
+{
+    struct KFile * file;
+    uint64_t pos;
+    matecache_spill_rec buf[ MC_MERGE_BUF ];
+    uint32_t used;
+    uint64_t written;
+    rc_t rc;
+} spill_writer;
+
+
+static void spill_writer_flush( spill_writer * w )
+{
+    if ( w->rc == 0 && w->used > 0 )
+    {
+        size_t num_writ;
+        w->rc = KFileWriteAll( w->file, w->pos, w->buf, w->used * sizeof w->buf[ 0 ], &num_writ );
+        if ( w->rc == 0 )
+            w->pos += num_writ;
+        else
+            (void)LOGERR( klogErr, w->rc, "cannot write matecache spill-file" );
+        w->used = 0;
+    }
+}
+
+
+static void spill_writer_put( spill_writer * w, const matecache_spill_rec * r )
+{
+    if ( w->used == MC_MERGE_BUF )
+        spill_writer_flush( w );
+    w->buf[ w->used++ ] = *r;
+    w->written++;
+}
+
+
+static rc_t spill_add_run( matecache_spill * sp, uint64_t first, uint64_t count )
+{
+    rc_t rc = 0;
+    matecache_run * run = malloc( sizeof * run );
+    if ( run == NULL )
+        rc = RC( rcApp, rcNoTarg, rcInserting, rcMemory, rcExhausted );
+    else
+    {
+        run->first = first;
+        run->count = count;
+        rc = VectorAppend( &sp->runs, NULL, run );
+        if ( rc != 0 )
+            free( run );
+    }
+    return rc;
+}
+
+
+/* writes the records ( sorted by key ) as one run at the end of the spill-file */
+static rc_t spill_write_run( matecache_per_file * mcpf, const matecache_spill_rec * recs, uint64_t count )
+{
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = spill_open( sp );
+    if ( rc == 0 )
+    {
+        size_t num_writ;
+        uint64_t first = sp->file_size / sizeof recs[ 0 ];
+        rc = KFileWriteAll( sp->file, sp->file_size, recs, count * sizeof recs[ 0 ], &num_writ );
+        if ( rc == 0 && num_writ != count * sizeof recs[ 0 ] )
+            rc = RC( rcApp, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        if ( rc == 0 )
+        {
+            sp->file_size += num_writ;
+            rc = spill_add_run( sp, first, count );
+        }
+        if ( rc == 0 )
+        {
+            mcpf->stat_unaligned.evicted += count;
+            sp->merged = false;
+        }
+        else
+            (void)LOGERR( klogErr, rc, "cannot write matecache spill-file" );
+    }
+    return rc;
+}
+
+
+/* writes all entries of the unaligned table as one sorted run and empties the table */
+static rc_t spill_table( matecache_per_file * mcpf )
+{
+    matecache_table * t = &mcpf->unaligned;
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = spill_open( sp );
+    if ( rc == 0 )
+    {
+        spill_writer * w = calloc( 1, sizeof * w );
+        if ( w == NULL )
+            rc = RC( rcApp, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+        else
+        {
+            uint64_t idx, first = sp->file_size / sizeof( matecache_spill_rec );
+
+            /* the key is in the most significant bits of a, empty slots sort to the front */
+            qsort( t->entries, t->capacity, sizeof t->entries[ 0 ], cmp_entry_a );
+            w->file = sp->file;
+            w->pos = sp->file_size;
+            for ( idx = 0; idx < t->capacity; ++idx )
+            {
+                if ( t->entries[ idx ].a != 0 )
+                {
+                    matecache_spill_rec r;
+                    unpack_unaligned( t, &t->entries[ idx ], &r );
+                    spill_writer_put( w, &r );
+                }
+            }
+            spill_writer_flush( w );
+            rc = w->rc;
+            sp->file_size = w->pos;
+            if ( rc == 0 )
+                rc = spill_add_run( sp, first, w->written );
+            if ( rc == 0 )
+            {
+                mcpf->stat_unaligned.evicted += w->written;
+                sp->merged = false;
+            }
+            free( w );
+            table_clear( t );
+        }
+    }
+    return rc;
+}
+
+
+/* the pending records are written as one run */
+static rc_t spill_pending( matecache_per_file * mcpf )
+{
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = 0;
+    if ( sp->pending_count > 0 )
+    {
+        rc = spill_write_run( mcpf, sp->pending, sp->pending_count );
+        if ( rc == 0 )
+            sp->pending_count = 0;
+    }
+    return rc;
+}
+
+
+/* the first pending record with a key >= key */
+static uint32_t pending_lower_bound( const matecache_spill * sp, int64_t key )
+{
+    uint32_t l = 0, h = sp->pending_count;
+    while ( l < h )
+    {
+        uint32_t mid = ( l + h ) / 2;
+        if ( sp->pending[ mid ].key < key )
+            l = mid + 1;
+        else
+            h = mid;
+    }
+    return l;
+}
+
+
+/* a record that does not fit into a packed entry waits with others for a run of its own */
+static rc_t spill_record( matecache_per_file * mcpf, const matecache_spill_rec * r )
+{
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = 0;
+    if ( sp->pending == NULL )
+    {
+        sp->pending = malloc( MC_MERGE_BUF * sizeof sp->pending[ 0 ] );
+        if ( sp->pending == NULL )
+        {
+            rc = RC( rcApp, rcNoTarg, rcInserting, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "cannot allocate matecache pending records" );
+        }
+    }
+    else if ( sp->pending_count == MC_MERGE_BUF )
+        rc = spill_pending( mcpf );
+    if ( rc == 0 )
+    {
+        /* after the records with the same key: they stay in the order of insertion */
+        uint32_t idx = pending_lower_bound( sp, r->key + 1 );
+        if ( r->key == INT64_MAX )
+            idx = sp->pending_count;
+        memmove( &sp->pending[ idx + 1 ], &sp->pending[ idx ],
+                 ( sp->pending_count - idx ) * sizeof sp->pending[ 0 ] );
+        sp->pending[ idx ] = *r;
+        sp->pending_count++;
+    }
+    return rc;
+}
+
+
+typedef struct merge_src
+{
+    matecache_spill_rec buf[ MC_MERGE_BUF ];
+    uint64_t next;      /* next record to read from the file */
+    uint64_t left;      /* records left in the file */
+    uint32_t pos;
+    uint32_t avail;
+} merge_src;
+
+
+static rc_t merge_src_fill( matecache_spill * sp, merge_src * src )
+{
+    rc_t rc = 0;
+    if ( src->pos == src->avail && src->left > 0 )
+    {
+        uint32_t n = ( src->left < MC_MERGE_BUF ) ? ( uint32_t )src->left : MC_MERGE_BUF;
+        rc = spill_read( sp, src->next, src->buf, n );
+        src->next += n;
+        src->left -= n;
+        src->pos = 0;
+        src->avail = n;
+    }
+    return rc;
+}
+
+
+/* merges all runs into one run in a new file, which replaces the old one,
+   builds the sparse block-index */
+static rc_t spill_merge( matecache_per_file * mcpf )
+{
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = spill_pending( mcpf );
+    uint32_t n_runs = VectorLength( &sp->runs );
+    merge_src ** src = calloc( n_runs + 1, sizeof src[ 0 ] );
+    spill_writer * w = calloc( 1, sizeof * w );
+    struct KFile * merged = NULL;
+    char merged_path[ sizeof sp->path ];
+    uint64_t total = 0;
+    uint32_t i;
+
+    if ( rc == 0 && ( src == NULL || w == NULL ) )
+        rc = RC( rcApp, rcNoTarg, rcSorting, rcMemory, rcExhausted );
+    if ( rc == 0 )
+        rc = spill_create( sp, &merged, merged_path, sizeof merged_path );
+    for ( i = 0; rc == 0 && i < n_runs; ++i )
+    {
+        const matecache_run * run = VectorGet( &sp->runs, VectorStart( &sp->runs ) + i );
+        src[ i ] = calloc( 1, sizeof * src[ i ] );
+        if ( src[ i ] == NULL )
+            rc = RC( rcApp, rcNoTarg, rcSorting, rcMemory, rcExhausted );
+        else
+        {
+            src[ i ]->next = run->first;
+            src[ i ]->left = run->count;
+            total += run->count;
+        }
+    }
+
+    free( sp->block_keys );
+    sp->block_keys = NULL;
+    sp->block_count = 0;
+    sp->block_loaded = 0;
+    if ( rc == 0 )
+    {
+        sp->block_keys = malloc( ( total / MC_SPILL_BLOCK + 1 ) * sizeof sp->block_keys[ 0 ] );
+        if ( sp->block_keys == NULL )
+            rc = RC( rcApp, rcNoTarg, rcSorting, rcMemory, rcExhausted );
+    }
+
+    if ( rc == 0 )
+    {
+        w->file = merged;
+        for ( ;; )
+        {
+            merge_src * min = NULL;
+            for ( i = 0; rc == 0 && i < n_runs; ++i )
+            {
+                rc = merge_src_fill( sp, src[ i ] );
+                if ( rc == 0 && src[ i ]->pos < src[ i ]->avail &&
+                     ( min == NULL || src[ i ]->buf[ src[ i ]->pos ].key < min->buf[ min->pos ].key ) )
+                    min = src[ i ];
+            }
+            if ( rc != 0 || min == NULL )
+                break;
+            if ( w->written % MC_SPILL_BLOCK == 0 )
+                sp->block_keys[ sp->block_count++ ] = min->buf[ min->pos ].key;
+            spill_writer_put( w, &min->buf[ min->pos++ ] );
+        }
+        spill_writer_flush( w );
+        if ( rc == 0 )
+            rc = w->rc;
+    }
+
+    if ( rc == 0 )
+    {
+        /* the merged run replaces all the others, their file is not needed anymore */
+        spill_remove( sp->file, sp->path );
+        sp->file = merged;
+        merged = NULL;
+        string_copy( sp->path, sizeof sp->path, merged_path, string_size( merged_path ) );
+        sp->file_size = w->pos;
+        VectorWhack( &sp->runs, free_run, NULL );
+        VectorInit( &sp->runs, 0, 16 );
+        rc = spill_add_run( sp, 0, total );
+        sp->record_count = total;
+        sp->merged = ( rc == 0 );
+    }
+    if ( merged != NULL )
+        spill_remove( merged, merged_path );
+    if ( rc == 0 && sp->block == NULL )
+    {
+        sp->block = malloc( MC_SPILL_BLOCK * sizeof sp->block[ 0 ] );
+        if ( sp->block == NULL )
+            rc = RC( rcApp, rcNoTarg, rcSorting, rcMemory, rcExhausted );
+    }
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot merge matecache spill-file" );
+
+    if ( src != NULL )
+    {
+        for ( i = 0; i < n_runs; ++i )
+            free( src[ i ] );
+        free( src );
+    }
+    free( w );
+    return rc;
+}
+
+
+static rc_t spill_lookup( matecache_per_file * mcpf, int64_t key, matecache_spill_rec * found )
+{
+    matecache_spill * sp = &mcpf->spill;
+    rc_t rc = 0;
+    if ( sp->pending_count > 0 )
+    {
+        uint32_t idx = pending_lower_bound( sp, key );
+        if ( idx < sp->pending_count && sp->pending[ idx ].key == key )
+        {
+            *found = sp->pending[ idx ];
+            return 0;
+        }
+    }
+    if ( sp->file == NULL )
+        return SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcItem, rcNotFound );
+    if ( !sp->merged )
+        rc = spill_merge( mcpf );
+    if ( rc == 0 )
+    {
+        const matecache_run * run = VectorGet( &sp->runs, VectorStart( &sp->runs ) );
+        uint64_t lo = 0, hi = sp->block_count;
+
+        /* the last block with a first key <= key */
+        while ( hi - lo > 1 )
+        {
+            uint64_t mid = ( lo + hi ) / 2;
+            if ( sp->block_keys[ mid ] <= key )
+                lo = mid;
+            else
+                hi = mid;
+        }
+        if ( sp->block_count == 0 || sp->block_keys[ lo ] > key )
+            return SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcItem, rcNotFound );
+
+        if ( sp->block_loaded != lo + 1 )
+        {
+            uint64_t n = sp->record_count - lo * MC_SPILL_BLOCK;
+            if ( n > MC_SPILL_BLOCK )
+                n = MC_SPILL_BLOCK;
+            rc = spill_read( sp, run->first + lo * MC_SPILL_BLOCK, sp->block, n );
+            sp->block_loaded = ( rc == 0 ) ? lo + 1 : 0;
+        }
+        if ( rc == 0 )
+        {
+            uint64_t n = sp->record_count - lo * MC_SPILL_BLOCK;
+            uint64_t l = 0, h;
+            if ( n > MC_SPILL_BLOCK )
+                n = MC_SPILL_BLOCK;
+            h = n;
+            while ( l < h )
+            {
+                uint64_t mid = ( l + h ) / 2;
+                if ( sp->block[ mid ].key < key )
+                    l = mid + 1;
+                else
+                    h = mid;
+            }
+            if ( l < n && sp->block[ l ].key == key )
+                *found = sp->block[ l ];
+            else
+                rc = SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcItem, rcNotFound );
+        }
+    }
+    return rc;
+}
+
+
+/* -------------------------------------------------------------------------------------------
+    construction / destruction
+   -------------------------------------------------------------------------------------------*/
 
 void release_matecache( matecache * const self )
 {
@@ -37,24 +777,31 @@ void release_matecache( matecache * const self )
             uint32_t idx;
             for ( idx = 0; idx < self->count; ++idx )
             {
-                if ( self->per_file[ idx ].same_ref_64 != NULL )
-                    KVectorRelease( self->per_file[ idx ].same_ref_64 );
-                if ( self->per_file[ idx ].same_ref_16 != NULL )
-                    KVectorRelease( self->per_file[ idx ].same_ref_16 );
-
-                if ( self->per_file[ idx ].unaligned_64_a != NULL )
-                    KVectorRelease( self->per_file[ idx ].unaligned_64_a );
-                if ( self->per_file[ idx ].unaligned_64_b != NULL )
-                    KVectorRelease( self->per_file[ idx ].unaligned_64_b );
+                table_release( &self->per_file[ idx ].same_ref );
+                table_release( &self->per_file[ idx ].unaligned );
+                spill_close( &self->per_file[ idx ].spill );
             }
             free( self->per_file );
         }
+        if ( self->lock != NULL )
+            KLockRelease( self->lock );
+        free( self->temp_dir );
         free( self );
     }
 }
 
 
-rc_t make_matecache( matecache **self, uint32_t count )
+/* the largest power of 2 not above the given number of entries */
+static uint64_t max_entries( size_t bytes )
+{
+    uint64_t n = MC_INITIAL_CAPACITY;
+    while ( n * 2 * sizeof( matecache_entry ) <= bytes )
+        n *= 2;
+    return n;
+}
+
+
+rc_t make_matecache( matecache **self, uint32_t count, size_t mem_limit, const char * temp_dir )
 {
     rc_t rc = 0;
 
@@ -67,39 +814,34 @@ rc_t make_matecache( matecache **self, uint32_t count )
     }
     else
     {
+        if ( temp_dir == NULL || temp_dir[ 0 ] == 0 )
+            temp_dir = getenv( "TMPDIR" );
+        if ( temp_dir == NULL || temp_dir[ 0 ] == 0 )
+            temp_dir = "/tmp";
         mc->count = count;
+        mc->temp_dir = string_dup_measure( temp_dir, NULL );
         mc->per_file = calloc( sizeof *(mc->per_file), count );
-        if ( mc->per_file == NULL )
+        if ( mc->per_file == NULL || mc->temp_dir == NULL )
         {
             rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
             (void)LOGERR( klogErr, rc, "cannot create matecache internal structure" );
         }
         else
         {
+            /* the budget is split evenly between the files and the 2 tables of each file */
+            uint64_t max_cap = max_entries( count > 0 ? mem_limit / ( count * 2 ) : mem_limit );
             uint32_t idx;
             for ( idx = 0; idx < count && rc == 0; ++idx )
             {
-                rc = KVectorMake( &( mc->per_file[ idx ].same_ref_64 ) );
+                matecache_per_file * mcpf = &mc->per_file[ idx ];
+                VectorInit( &mcpf->spill.runs, 0, 16 );
+                mcpf->spill.temp_dir = mc->temp_dir;
+                mcpf->spill.db_idx = idx;
+                rc = table_init( &mcpf->same_ref, MC_SAME_REF_KEY_SHIFT, max_cap );
+                if ( rc == 0 )
+                    rc = table_init( &mcpf->unaligned, MC_UNALIGNED_KEY_SHIFT, max_cap );
                 if ( rc != 0 )
-                    (void)LOGERR( klogErr, rc, "cannot create KVector (same-ref) U64" );
-                else
-                {
-                    rc = KVectorMake( &( mc->per_file[ idx ].same_ref_16 ) );
-                    if ( rc != 0 )
-                        (void)LOGERR( klogErr, rc, "cannot create KVector (same-ref) U16" );
-                    else
-                    {
-                        rc = KVectorMake( &( mc->per_file[ idx ].unaligned_64_a ) );
-                        if ( rc != 0 )
-                            (void)LOGERR( klogErr, rc, "cannot create KVector (unaligned a) U64" );
-                        else
-                        {
-                            rc = KVectorMake( &( mc->per_file[ idx ].unaligned_64_b ) );
-                            if ( rc != 0 )
-                                (void)LOGERR( klogErr, rc, "cannot create KVector (unaligned b) U64" );
-                        }
-                    }
-                }
+                    (void)LOGERR( klogErr, rc, "cannot create matecache hash-tables" );
             }
             if ( rc == 0 )
                 *self = mc;
@@ -110,6 +852,38 @@ rc_t make_matecache( matecache **self, uint32_t count )
     return rc;
 }
 
+
+rc_t matecache_make_thread_safe( matecache * const self )
+{
+    rc_t rc = 0;
+    if ( self == NULL )
+    {
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcSelf, rcNull );
+        (void)LOGERR( klogErr, rc, "cannot make matecache thread-safe" );
+    }
+    else if ( self->lock == NULL )
+    {
+        rc = KLockMake( &self->lock );
+        if ( rc != 0 )
+            (void)LOGERR( klogErr, rc, "cannot create matecache lock" );
+    }
+    return rc;
+}
+
+
+static void matecache_lock( const matecache * const self )
+{
+    if ( self != NULL && self->lock != NULL )
+        KLockAcquire( self->lock );
+}
+
+
+static void matecache_unlock( const matecache * const self )
+{
+    if ( self != NULL && self->lock != NULL )
+        KLockUnlock( self->lock );
+}
+
 #if 0
 static int32_t calc_tlen( uint32_t self_pos, uint32_t mate_pos,
                    uint32_t self_len, uint32_t mate_len, uint32_t read_num )
@@ -155,38 +929,42 @@ static rc_t matecache_check( const matecache * const self, uint32_t db_idx, mate
     else if ( db_idx < self->count )
     {
         *mcpf = &self->per_file[ db_idx ];
-        if ( mcpf == NULL )
-        {
-            rc = RC( rcApp, rcNoTarg, rcAccessing, rcParam, rcInvalid );
-            (void)LOGERR( klogErr, rc, "cannot insert into same-ref-cache" );
-        }
+    }
+    else
+    {
+        rc = RC( rcApp, rcNoTarg, rcAccessing, rcParam, rcInvalid );
+        (void)LOGERR( klogErr, rc, "cannot insert into same-ref-cache" );
     }
     return rc;
 }
 
 
-rc_t matecache_insert_same_ref( matecache * const self,
+static rc_t matecache_insert_same_ref_unlocked( matecache * const self,
         uint32_t db_idx, int64_t key, INSDC_coord_zero ref_pos, uint32_t flags, INSDC_coord_len tlen )
 {
     matecache_per_file * mcpf = NULL;
     rc_t rc = matecache_check( self, db_idx, &mcpf );
-    if ( rc == 0 )
+    /* keys that do not fit into a packed entry are not cached, the mate will be read from the table */
+    if ( rc == 0 && key >= 0 && key <= MC_SAME_REF_MAX_KEY )
     {
-        uint64_t ref_pos_and_tlen = ref_pos;
-        ref_pos_and_tlen <<= 32;
-        ref_pos_and_tlen |= tlen;
-        rc = KVectorSetU64( mcpf->same_ref_64, key, ref_pos_and_tlen );
-        if ( rc != 0 )
-            (void)LOGERR( klogErr, rc, "cannot insert into KVector (same-ref) U64" );
-        else
+        matecache_table * t = &mcpf->same_ref;
+        matecache_entry e;
+
+        mcpf->last_same_ref_key = key;
+        if ( table_is_full( t ) )
         {
-            rc = KVectorSetU16( mcpf->same_ref_16, key, flags );
+            if ( t->capacity < t->max_capacity )
+                rc = table_grow( t );
+            else
+                mcpf->stat_same_ref.evicted += table_evict_far( t, key );
             if ( rc != 0 )
-                (void)LOGERR( klogErr, rc, "cannot insert into KVector (same-ref) U16" );
+                (void)LOGERR( klogErr, rc, "cannot grow same-ref-cache" );
         }
         if ( rc == 0 )
         {
-            mcpf->stat_same_ref.count++;
+            pack_same_ref( &e, key, ref_pos, flags, tlen );
+            table_put( t, &e );
+            mcpf->stat_same_ref.count = t->count;
             if ( mcpf->stat_same_ref.count > mcpf->maxcount_same_ref )
                 mcpf->maxcount_same_ref = mcpf->stat_same_ref.count;
             mcpf->stat_same_ref.inserts++;
@@ -196,88 +974,77 @@ rc_t matecache_insert_same_ref( matecache * const self,
 }
 
 
-rc_t matecache_lookup_same_ref( const matecache * const self, uint32_t db_idx, int64_t key,
+rc_t matecache_insert_same_ref( matecache * const self,
+        uint32_t db_idx, int64_t key, INSDC_coord_zero ref_pos, uint32_t flags, INSDC_coord_len tlen )
+{
+    rc_t rc;
+    matecache_lock( self );
+    rc = matecache_insert_same_ref_unlocked( self, db_idx, key, ref_pos, flags, tlen );
+    matecache_unlock( self );
+    return rc;
+}
+
+
+static rc_t matecache_lookup_same_ref_unlocked( const matecache * const self, uint32_t db_idx, int64_t key,
                        INSDC_coord_zero *ref_pos, uint32_t *flags, INSDC_coord_len *tlen )
 {
     matecache_per_file * mcpf = NULL;
     rc_t rc = matecache_check( self, db_idx, &mcpf );
     if ( rc == 0 )
     {
-        uint64_t value64;
+        const matecache_entry * e = NULL;
         mcpf->stat_same_ref.lookups++;
-        rc = KVectorGetU64( mcpf->same_ref_64, key, &value64 );
-        if ( rc != 0 )
-        {
-            if ( GetRCState( rc ) != rcNotFound )
-                (void)LOGERR( klogErr, rc, "cannot retrieve value (same-ref) U64" );
-        }
+        if ( key >= 0 && key <= MC_SAME_REF_MAX_KEY )
+            e = table_find( &mcpf->same_ref, key );
+        if ( e == NULL )
+            rc = SILENT_RC( rcApp, rcNoTarg, rcAccessing, rcItem, rcNotFound );
         else
         {
-            uint16_t value16;
-            rc = KVectorGetU16( mcpf->same_ref_16, key, &value16 );
-            if ( rc != 0 )
-            {
-                if ( GetRCState( rc ) != rcNotFound )
-                    (void)LOGERR( klogErr, rc, "cannot retrieve value (same-ref) U16" );
-            }
-            else
-            {
-                *ref_pos = ( value64 >> 32 );
-                *tlen = ( value64 & 0xFFFFFFFF );
-                *flags = value16;
-                mcpf->stat_same_ref.finds++;
-            }
+            *ref_pos = ( INSDC_coord_zero )( e->b >> 32 );
+            *tlen = ( INSDC_coord_len )( e->b & 0xFFFFFFFF );
+            *flags = ( uint32_t )( e->a & 0xFFFF );
+            mcpf->stat_same_ref.finds++;
         }
     }
     return rc;
 }
 
 
-rc_t matecache_remove_same_ref( matecache * const self, uint32_t db_idx, int64_t key )
+rc_t matecache_lookup_same_ref( const matecache * const self, uint32_t db_idx, int64_t key,
+                       INSDC_coord_zero *ref_pos, uint32_t *flags, INSDC_coord_len *tlen )
+{
+    rc_t rc;
+    matecache_lock( self );
+    rc = matecache_lookup_same_ref_unlocked( self, db_idx, key, ref_pos, flags, tlen );
+    matecache_unlock( self );
+    return rc;
+}
+
+
+static rc_t matecache_remove_same_ref_unlocked( matecache * const self, uint32_t db_idx, int64_t key )
 {
     matecache_per_file * mcpf = NULL;
     rc_t rc = matecache_check( self, db_idx, &mcpf );
-    if ( rc == 0 )
+    if ( rc == 0 && key >= 0 && key <= MC_SAME_REF_MAX_KEY )
     {
-        rc = KVectorUnset( mcpf->same_ref_64, key );
-        if ( rc != 0 )
-            (void)LOGERR( klogErr, rc, "cannot remove from same-ref-cache (64bit)" );
-        else
+        matecache_table * t = &mcpf->same_ref;
+        matecache_entry * e = table_find( t, key );
+        if ( e != NULL )
         {
-            rc = KVectorUnset( mcpf->same_ref_16, key );
-            if ( rc != 0 )
-                (void)LOGERR( klogErr, rc, "cannot remove from same-ref-cache (16bit)" );
+            table_remove_at( t, e - t->entries );
+            mcpf->stat_same_ref.count = t->count;
         }
-        if ( rc == 0 && mcpf->stat_same_ref.count > 0 )
-            mcpf->stat_same_ref.count--;
     }
     return rc;
 }
 
 
-static rc_t matecache_clear_same_ref_per_file( matecache_per_file * const mcpf )
+rc_t matecache_remove_same_ref( matecache * const self, uint32_t db_idx, int64_t key )
 {
-    rc_t rc = KVectorRelease( mcpf->same_ref_64 );
-    if ( rc != 0 )
-        (void)LOGERR( klogErr, rc, "cannot release same-ref-cache (64bit)" );
-    else
-    {
-        rc = KVectorRelease( mcpf->same_ref_16 );
-        if ( rc != 0 )
-            (void)LOGERR( klogErr, rc, "cannot release same-ref-cache (16bit)" );
-        else
-        {
-            rc = KVectorMake( &mcpf->same_ref_64 );
-            if ( rc != 0 )
-                (void)LOGERR( klogErr, rc, "cannot make same-ref-cache (64bit)" );
-            else
-            {
-                rc = KVectorMake( &mcpf->same_ref_16 );
-                if ( rc != 0 )
-                    (void)LOGERR( klogErr, rc, "cannot make same-ref-cache (16bit)" );
-            }
-        }
-    }
+    rc_t rc;
+    matecache_lock( self );
+    rc = matecache_remove_same_ref_unlocked( self, db_idx, key );
+    matecache_unlock( self );
     return rc;
 }
 
@@ -293,11 +1060,14 @@ rc_t matecache_clear_same_ref( matecache * const self )
     else
     {
         uint32_t idx;
-        for ( idx = 0; idx < self->count && rc == 0; ++idx )
+        matecache_lock( self );
+        for ( idx = 0; idx < self->count; ++idx )
         {
-            rc = matecache_clear_same_ref_per_file( &self->per_file[ idx ] );
+            table_clear( &self->per_file[ idx ].same_ref );
+            self->per_file[ idx ].stat_same_ref.count = 0;
         }
         self->flashes++;
+        matecache_unlock( self );
    }
     return rc;
 }
@@ -325,6 +1095,8 @@ rc_t matecache_report( const matecache * const self )
                 rc = KOutMsg( "matecache[ %u ].lookups = %,lu\n", idx, self->per_file[ idx ].stat_same_ref.lookups );
             if ( rc == 0 )
                 rc = KOutMsg( "matecache[ %u ].finds = %,lu\n", idx, self->per_file[ idx ].stat_same_ref.finds );
+            if ( rc == 0 )
+                rc = KOutMsg( "matecache[ %u ].evicted = %,lu\n", idx, self->per_file[ idx ].stat_same_ref.evicted );
             if ( rc == 0 )
                 rc = KOutMsg( "unaligned:\n" );
             if ( rc == 0 )
@@ -333,32 +1105,51 @@ rc_t matecache_report( const matecache * const self )
                 rc = KOutMsg( "matecache[ %u ].lookups = %,lu\n", idx, self->per_file[ idx ].stat_unaligned.lookups );
             if ( rc == 0 )
                 rc = KOutMsg( "matecache[ %u ].finds = %,lu\n", idx, self->per_file[ idx ].stat_unaligned.finds );
+            if ( rc == 0 )
+                rc = KOutMsg( "matecache[ %u ].spilled = %,lu\n", idx, self->per_file[ idx ].stat_unaligned.evicted );
         }
         if ( rc == 0 )
-            rc = KOutMsg( "matecache.flashes = %,lu\n", idx, self->flashes );
+            rc = KOutMsg( "matecache.flashes = %,u\n", self->flashes );
     }
     return rc;
 }
 
 
-rc_t matecache_insert_unaligned( matecache * const self,
+static rc_t matecache_insert_unaligned_unlocked( matecache * const self,
         uint32_t db_idx, int64_t key, INSDC_coord_zero ref_pos, uint32_t ref_idx, int64_t seq_id )
 {
     matecache_per_file * mcpf = NULL;
     rc_t rc = matecache_check( self, db_idx, &mcpf );
     if ( rc == 0 )
     {
-        uint64_t ref_pos_and_ref_idx = ref_pos;
-        ref_pos_and_ref_idx <<= 32;
-        ref_pos_and_ref_idx |= ref_idx;
-        rc = KVectorSetU64( mcpf->unaligned_64_a, key, ref_pos_and_ref_idx );
-        if ( rc != 0 )
-            (void)LOGERR( klogErr, rc, "cannot insert into KVector (unaligned a) U64" );
+        matecache_table * t = &mcpf->unaligned;
+        matecache_spill_rec r;
+
+        r.key = key;
+        r.seq_id = seq_id;
+        r.ref_pos = ref_pos;
+        r.ref_idx = ref_idx;
+
+        /* these entries cannot be dropped: what does not fit goes to the spill-file */
+        if ( !fits_unaligned( key, ref_pos, ref_idx, seq_id ) )
+            rc = spill_record( mcpf, &r );
         else
         {
-            rc = KVectorSetU64( mcpf->unaligned_64_b, key, seq_id );
-            if ( rc != 0 )
-                (void)LOGERR( klogErr, rc, "cannot insert into KVector (unaligned b) U64" );
+            if ( table_is_full( t ) )
+            {
+                if ( t->capacity < t->max_capacity )
+                    rc = table_grow( t );
+                else
+                    rc = spill_table( mcpf );
+                if ( rc != 0 )
+                    (void)LOGERR( klogErr, rc, "cannot make room in unaligned-cache" );
+            }
+            if ( rc == 0 )
+            {
+                matecache_entry e;
+                pack_unaligned( &e, &r );
+                table_put( t, &e );
+            }
         }
         if ( rc == 0 )
         {
@@ -370,57 +1161,71 @@ rc_t matecache_insert_unaligned( matecache * const self,
 }
 
 
-rc_t matecache_lookup_unaligned( const matecache * const self, uint32_t db_idx, int64_t key,
+rc_t matecache_insert_unaligned( matecache * const self,
+        uint32_t db_idx, int64_t key, INSDC_coord_zero ref_pos, uint32_t ref_idx, int64_t seq_id )
+{
+    rc_t rc;
+    matecache_lock( self );
+    rc = matecache_insert_unaligned_unlocked( self, db_idx, key, ref_pos, ref_idx, seq_id );
+    matecache_unlock( self );
+    return rc;
+}
+
+
+static rc_t matecache_lookup_unaligned_unlocked( const matecache * const self, uint32_t db_idx, int64_t key,
                                  INSDC_coord_zero * const ref_pos, uint32_t * const ref_idx, int64_t * const seq_id )
 {
     matecache_per_file * mcpf = NULL;
     rc_t rc = matecache_check( self, db_idx, &mcpf );
     if ( rc == 0 )
     {
-        uint64_t value64_a;
+        matecache_spill_rec r;
+        const matecache_entry * e = NULL;
+
         mcpf->stat_unaligned.lookups++;
-        rc = KVectorGetU64( mcpf->unaligned_64_a, key, &value64_a );
-        if ( rc != 0 )
+        if ( key >= 0 && key <= MC_UNALIGNED_MAX_KEY )
+            e = table_find( &mcpf->unaligned, key );
+        if ( e != NULL )
+            unpack_unaligned( &mcpf->unaligned, e, &r );
+        else
         {
-            if ( GetRCState( rc ) != rcNotFound )
-                (void)LOGERR( klogErr, rc, "cannot retrieve value (unaligned a) U64" );
+            rc = spill_lookup( mcpf, key, &r );
+            if ( rc != 0 && GetRCState( rc ) != rcNotFound )
+                (void)LOGERR( klogErr, rc, "cannot lookup in unaligned-cache" );
         }
-        else
+        if ( rc == 0 )
         {
-            uint64_t value64_b;
-            rc = KVectorGetU64( mcpf->unaligned_64_b, key, &value64_b );
-            if ( rc != 0 )
-            {
-                if ( GetRCState( rc ) != rcNotFound )
-                    (void)LOGERR( klogErr, rc, "cannot retrieve value (unaligned b) U64" );
-            }
-            else
-            {
-                *seq_id = ( int64_t )value64_b;
-                *ref_pos = ( value64_a >> 32 );
-                *ref_idx = ( value64_a & 0xFFFFFFFF );
-                mcpf->stat_unaligned.finds++;
-            }
+            *seq_id = r.seq_id;
+            *ref_pos = r.ref_pos;
+            *ref_idx = r.ref_idx;
+            mcpf->stat_unaligned.finds++;
         }
     }
     return rc;
 }
 
 
-typedef struct visit_ctx
+rc_t matecache_lookup_unaligned( const matecache * const self, uint32_t db_idx, int64_t key,
+                                 INSDC_coord_zero * const ref_pos, uint32_t * const ref_idx, int64_t * const seq_id )
 {
-    rc_t ( CC * f ) ( int64_t seq_id, int64_t al_id, void * user_data );
-    void * user_data;
-} visit_ctx;
+    rc_t rc;
+    matecache_lock( self );
+    rc = matecache_lookup_unaligned_unlocked( self, db_idx, key, ref_pos, ref_idx, seq_id );
+    matecache_unlock( self );
+    return rc;
+}
 
 
-static rc_t CC on_seq_id( uint64_t key, int64_t value, void *user_data )
+static int CC cmp_int64( const void * a, const void * b )
 {
-    visit_ctx * vctx = user_data;
-    return vctx->f( value, ( int64_t )key, vctx->user_data );
+    int64_t x = *( const int64_t * )a;
+    int64_t y = *( const int64_t * )b;
+    return ( x < y ) ? -1 : ( x > y ) ? 1 : 0;
 }
 
 
+/* visits all unaligned entries in the order of their keys ( align-id ), merging the
+   entries in memory with the ones in the spill-file */
 rc_t foreach_unaligned_entry( const matecache * const self,
                               uint32_t db_idx,
                               rc_t ( CC * f ) ( int64_t seq_id, int64_t al_id, void * user_data ),
@@ -430,10 +1235,82 @@ rc_t foreach_unaligned_entry( const matecache * const self,
     rc_t rc = matecache_check( self, db_idx, &mcpf );
     if ( rc == 0 )
     {
-        visit_ctx vctx;
-        vctx.f = f;
-        vctx.user_data = user_data;
-        rc = KVectorVisitI64 ( mcpf->unaligned_64_b, false, on_seq_id, &vctx );
+        const matecache_table * t = &mcpf->unaligned;
+        matecache_spill * sp = &mcpf->spill;
+        merge_src * src = NULL;
+        int64_t * keys = malloc( ( t->count + 1 ) * sizeof keys[ 0 ] );
+        uint64_t idx, n = 0;
+
+        if ( keys == NULL )
+            rc = RC( rcApp, rcNoTarg, rcVisiting, rcMemory, rcExhausted );
+        else
+        {
+            /* the callback may lookup entries: we sort a copy of the keys, not the table */
+            for ( idx = 0; idx < t->capacity; ++idx )
+            {
+                if ( t->entries[ idx ].a != 0 )
+                    keys[ n++ ] = entry_key( t, &t->entries[ idx ] );
+            }
+            qsort( keys, n, sizeof keys[ 0 ], cmp_int64 );
+        }
+
+        if ( rc == 0 && ( sp->file != NULL || sp->pending_count > 0 ) )
+        {
+            matecache_lock( self );
+            if ( !sp->merged || sp->pending_count > 0 )
+                rc = spill_merge( mcpf );
+            matecache_unlock( self );
+            if ( rc == 0 )
+            {
+                src = calloc( 1, sizeof * src );
+                if ( src == NULL )
+                    rc = RC( rcApp, rcNoTarg, rcVisiting, rcMemory, rcExhausted );
+                else
+                {
+                    const matecache_run * run = VectorGet( &sp->runs, VectorStart( &sp->runs ) );
+                    src->next = run->first;
+                    src->left = run->count;
+                }
+            }
+        }
+
+        idx = 0;
+        while ( rc == 0 )
+        {
+            bool from_file = false;
+            if ( src != NULL )
+            {
+                matecache_lock( self );
+                rc = merge_src_fill( sp, src );
+                matecache_unlock( self );
+                from_file = ( rc == 0 && src->pos < src->avail &&
+                              ( idx >= n || src->buf[ src->pos ].key < keys[ idx ] ) );
+            }
+            if ( rc != 0 )
+                break;
+            if ( from_file )
+            {
+                const matecache_spill_rec * r = &src->buf[ src->pos++ ];
+                rc = f( r->seq_id, r->key, user_data );
+            }
+            else if ( idx < n )
+            {
+                const matecache_entry * e;
+                matecache_spill_rec r;
+                matecache_lock( self );
+                e = table_find( t, keys[ idx ] );
+                if ( e != NULL )
+                    unpack_unaligned( t, e, &r );
+                matecache_unlock( self );
+                if ( e != NULL )
+                    rc = f( r.seq_id, r.key, user_data );
+                idx++;
+            }
+            else
+                break;
+        }
+        free( src );
+        free( keys );
     }
     return rc;
 }
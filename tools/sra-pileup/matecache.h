@@ -47,16 +47,60 @@ typedef struct matecache_stat
     uint64_t lookups;
     uint64_t finds;
     uint64_t inserts;
+    uint64_t evicted;   /* same-ref: dropped to stay in budget, unaligned: spilled to disk */
 } matecache_stat;
 
 
+/* open-addressed hash-table of packed 16-byte entries, a == 0 marks an empty slot */
+typedef struct matecache_entry
+{
+    uint64_t a;
+    uint64_t b;
+} matecache_entry;
+
+
+typedef struct matecache_table
+{
+    matecache_entry * entries;
+    uint64_t capacity;      /* power of 2 */
+    uint64_t max_capacity;  /* derived from the memory-budget */
+    uint64_t count;
+    uint32_t key_shift;     /* the key is stored in a >> key_shift */
+} matecache_table;
+
+
+/* unaligned entries that did not fit into memory, sorted runs in a temp. file */
+typedef struct matecache_spill
+{
+    struct KFile * file;
+    char path[ 1024 ];
+    const char * temp_dir;  /* owned by the matecache */
+    uint32_t db_idx;
+    uint32_t generation;    /* every merge writes a new file, the old one is removed */
+    uint64_t file_size;
+    Vector runs;            /* start of every sorted run ( matecache_run ) */
+
+    /* entries that do not fit into a packed entry, sorted by key, written as one run when full */
+    struct matecache_spill_rec * pending;
+    uint32_t pending_count;
+
+    /* after merging the runs: one sorted run + a sparse index into it */
+    int64_t * block_keys;   /* the first key of every block */
+    uint64_t block_count;
+    uint64_t record_count;
+    struct matecache_spill_rec * block;     /* the block loaded last */
+    uint64_t block_loaded;  /* index + 1, 0 ... nothing loaded */
+    bool merged;
+} matecache_spill;
+
+
 typedef struct matecache_per_file
 {
-    KVector *same_ref_64;   /* ref-pos and ref-idx */
-    KVector *same_ref_16;   /* flags */
+    matecache_table same_ref;   /* key: align-id, value: ref-pos, tlen, flags */
+    matecache_table unaligned;  /* key: align-id, value: ref-pos, ref-idx, seq-spot-id */
+    matecache_spill spill;
 
-    KVector *unaligned_64_a;  /* ref-pos and ref-idx */
-    KVector *unaligned_64_b;  /* seq_spot_id */
+    int64_t last_same_ref_key;  /* to find entries, whose mate is far away */
 
     matecache_stat stat_same_ref;
     matecache_stat stat_unaligned;
@@ -67,17 +111,25 @@ typedef struct matecache_per_file
 typedef struct matecache
 {
     matecache_per_file *per_file;
+    char * temp_dir;        /* where the spill-files are created */
+    struct KLock *lock;     /* only present if used from multiple threads */
     uint32_t count;
     uint32_t flashes;
 } matecache;
 
-
 /* general cache functions */
 
-rc_t make_matecache( matecache **self, uint32_t count );
+/* mem_limit ... bytes for all hash-tables together, the tables grow up to this limit,
+   beyond it same-ref entries far away from the current row are dropped and
+   unaligned entries are spilled into a sorted temp. file
+   temp_dir  ... directory of the temp. files, NULL: $TMPDIR or /tmp */
+rc_t make_matecache( matecache **self, uint32_t count, size_t mem_limit, const char * temp_dir );
 
 void release_matecache( matecache * const self );
 
+/* all following calls are serialized, needed if the cache is shared by worker-threads */
+rc_t matecache_make_thread_safe( matecache * const self );
+
 rc_t matecache_clear_same_ref( matecache * const self );
 
 rc_t matecache_report( const matecache * const self );
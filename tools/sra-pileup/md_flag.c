@@ -33,6 +33,7 @@
 #include <string.h>
 
 #include "md_flag.h"
+#include "dyn_string.h"
 
 struct cigar_t
 {
@@ -157,14 +158,18 @@ void free_cigar_t( struct cigar_t * c )
 }
 
 
-static rc_t kout_delete( int count, int *match_count,
+/* dst == NULL: print via KOutMsg(), otherwise append to dst */
+static rc_t kout_delete( struct dyn_string * dst, int count, int *match_count,
 						 const uint8_t * ref, const INSDC_coord_len ref_len, int *ref_idx )
 {
 	rc_t rc = 0;
 	
 	if ( *match_count > 0 )
 	{
-		rc = KOutMsg( "%d", *match_count );
+		if ( dst == NULL )
+			rc = KOutMsg( "%d", *match_count );
+		else
+			rc = print_2_dyn_string( dst, "%d", *match_count );
 		*match_count = 0;
 	}
 	
@@ -172,7 +177,10 @@ static rc_t kout_delete( int count, int *match_count,
 	{
 		if ( ( *ref_idx + count ) < ref_len )
 		{
-			rc = KOutMsg( "^%.*s", count, &(ref[ *ref_idx ] ) );
+			if ( dst == NULL )
+				rc = KOutMsg( "^%.*s", count, &(ref[ *ref_idx ] ) );
+			else
+				rc = print_2_dyn_string( dst, "^%.*s", count, &(ref[ *ref_idx ] ) );
 			(*ref_idx) += count;
 		}
 		else
@@ -182,7 +190,7 @@ static rc_t kout_delete( int count, int *match_count,
 }
 
 
-static rc_t kout_match( int count, int *match_count,
+static rc_t kout_match( struct dyn_string * dst, int count, int *match_count,
 						const char * read, size_t read_len, int *read_idx,
 						const uint8_t *ref, const INSDC_coord_len ref_len, int *ref_idx )
 {
@@ -198,7 +206,10 @@ static rc_t kout_match( int count, int *match_count,
 			}
 			else
 			{
-				rc = KOutMsg( "%d%c", *match_count, ref[ *ref_idx ] );
+				if ( dst == NULL )
+					rc = KOutMsg( "%d%c", *match_count, ref[ *ref_idx ] );
+				else
+					rc = print_2_dyn_string( dst, "%d%c", *match_count, ref[ *ref_idx ] );
 				*match_count = 0;
 			}
 			(*ref_idx)++;
@@ -210,7 +221,8 @@ static rc_t kout_match( int count, int *match_count,
 }
 
 
-static rc_t kout_tag( const struct cigar_t * c,
+static rc_t kout_tag( struct dyn_string * dst,
+					  const struct cigar_t * c,
 					  const char * read,
 					  const size_t read_len,
 					  const uint8_t * ref,
@@ -219,7 +231,8 @@ static rc_t kout_tag( const struct cigar_t * c,
 	rc_t rc = 0;
 	if ( c != NULL && read != NULL && read_len > 0 && ref != NULL && ref_len > 0 )
 	{
-		rc = KOutMsg( "\tMD:Z:" );
+		if ( dst == NULL )
+			rc = KOutMsg( "\tMD:Z:" );
 		if ( rc == 0 )
 		{
 			int read_idx = 0;
@@ -231,15 +244,20 @@ static rc_t kout_tag( const struct cigar_t * c,
 				int count = c->count[ cigar_idx ];
 				switch ( c->op[ cigar_idx ] )
 				{
-					case 'D' : rc = kout_delete( count, &match_count, ref, ref_len, &ref_idx ); break;
+					case 'D' : rc = kout_delete( dst, count, &match_count, ref, ref_len, &ref_idx ); break;
 					
 					case 'I' : read_idx += count; break;
 
-					case 'M' : rc = kout_match( count, &match_count, read, read_len, &read_idx, ref, ref_len, &ref_idx ); break;
+					case 'M' : rc = kout_match( dst, count, &match_count, read, read_len, &read_idx, ref, ref_len, &ref_idx ); break;
 				}
 			}
 			if ( rc == 0 && match_count > 0 )
-				rc = KOutMsg( "%d", match_count );
+			{
+				if ( dst == NULL )
+					rc = KOutMsg( "%d", match_count );
+				else
+					rc = print_2_dyn_string( dst, "%d", match_count );
+			}
 		}
 	}
 	else
@@ -248,12 +266,13 @@ static rc_t kout_tag( const struct cigar_t * c,
 }
 
 
-rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
-									const size_t cigar_len,
-									const char * read,
-									const size_t read_len,
-									const uint8_t * ref,
-									const INSDC_coord_len ref_len )
+static rc_t md_tag( struct dyn_string * dst,
+					 const char * cigar_str,
+					 const size_t cigar_len,
+					 const char * read,
+					 const size_t read_len,
+					 const uint8_t * ref,
+					 const INSDC_coord_len ref_len )
 {
 	rc_t rc = 0;
 	struct cigar_t * cigar = make_cigar_t( cigar_str, cigar_len );
@@ -261,8 +280,31 @@ rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
 		rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
 	else
 	{
-		rc = kout_tag( cigar, read, read_len, ref, ref_len );
+		rc = kout_tag( dst, cigar, read, read_len, ref, ref_len );
 		free_cigar_t( cigar );
 	}
 	return rc;
 }
+
+
+rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
+									const size_t cigar_len,
+									const char * read,
+									const size_t read_len,
+									const uint8_t * ref,
+									const INSDC_coord_len ref_len )
+{
+	return md_tag( NULL, cigar_str, cigar_len, read, read_len, ref, ref_len );
+}
+
+
+rc_t dyn_string_md_tag_from_cigar_string( struct dyn_string * dst,
+										  const char * cigar_str,
+										  const size_t cigar_len,
+										  const char * read,
+										  const size_t read_len,
+										  const uint8_t * ref,
+										  const INSDC_coord_len ref_len )
+{
+	return md_tag( dst, cigar_str, cigar_len, read, read_len, ref, ref_len );
+}
@@ -41,6 +41,16 @@ rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
 									const uint8_t * ref,
 									const INSDC_coord_len ref_len );
 
+/* appends only the value of the MD-tag to dst ( for the BAM-output ) */
+struct dyn_string;
+rc_t dyn_string_md_tag_from_cigar_string( struct dyn_string * dst,
+										  const char * cigar_str,
+										  const size_t cigar_len,
+										  const char * read,
+										  const size_t read_len,
+										  const uint8_t * ref,
+										  const INSDC_coord_len ref_len );
+
 #ifdef __cplusplus
 }
 #endif
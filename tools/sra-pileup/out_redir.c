@@ -25,19 +25,69 @@
 */
 
 #include "out_redir.h"
+#include "bam_out.h"
 
 #include <kfs/directory.h>
 #include <kfs/buffile.h>
 #include <kfs/bzip.h>
 #include <kfs/gzip.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 #include <sysalloc.h>
 
+#if WINDOWS
+#define THREAD_LOCAL __declspec( thread )
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* if not NULL: the output of the current thread is captured in this chunk */
+static THREAD_LOCAL out_chunk * captured = NULL;
+
+static rc_t append_to_chunk( out_chunk * self, const char * buffer, size_t bufsize )
+{
+    if ( self->used + bufsize > self->size )
+    {
+        size_t new_size = self->size;
+        char * new_buffer;
+        while ( new_size < self->used + bufsize )
+            new_size *= 2;
+        new_buffer = realloc( self->buffer, new_size );
+        if ( new_buffer == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        self->buffer = new_buffer;
+        self->size = new_size;
+    }
+    memmove( &self->buffer[ self->used ], buffer, bufsize );
+    self->used += bufsize;
+    return 0;
+}
+
+
 static rc_t CC out_redir_callback( void * self, const char * buffer, size_t bufsize, size_t * num_writ )
 {
-    out_redir * redir = ( out_redir * )self;
-    rc_t rc = KFileWriteAll( redir->kfile, redir->pos, buffer, bufsize, num_writ );
-    if ( rc == 0 )
-        redir->pos += *num_writ;
+    rc_t rc;
+    out_chunk * chunk = captured;
+    if ( chunk != NULL )
+    {
+        rc = append_to_chunk( chunk, buffer, bufsize );
+        *num_writ = ( rc == 0 ) ? bufsize : 0;
+    }
+    else
+    {
+        out_redir * redir = ( out_redir * )self;
+        if ( redir->bam != NULL )
+        {
+            rc = bam_out_write( redir->bam, buffer, bufsize );
+            *num_writ = ( rc == 0 ) ? bufsize : 0;
+        }
+        else
+        {
+            rc = KFileWriteAll( redir->kfile, redir->pos, buffer, bufsize, num_writ );
+            if ( rc == 0 )
+                redir->pos += *num_writ;
+        }
+    }
     return rc;
 }
 
@@ -98,6 +148,7 @@ rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * fi
                 self->org_writer = KOutWriterGet();
                 self->org_data = KOutDataGet();
                 self->pos = 0;
+                self->bam = NULL;
                 rc = KOutHandlerSet( out_redir_callback, self );
                 if ( rc != 0 )
                     LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
@@ -108,8 +159,26 @@ rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * fi
 }
 
 
+rc_t out_redir_make_bam( out_redir * self, uint32_t num_threads,
+                         enum bam_index_format idx_fmt, const char * idx_filename )
+{
+    return make_bam_out( &self->bam, self->kfile, num_threads, idx_fmt, idx_filename );
+}
+
+
+rc_t out_redir_finish( out_redir * self )
+{
+    rc_t rc = 0;
+    if ( self->bam != NULL )
+        rc = bam_out_finish( self->bam );
+    return rc;
+}
+
+
 void release_out_redir( out_redir * self )
 {
+    release_bam_out( self->bam );
+    self->bam = NULL;
     KFileRelease( self->kfile );
     if( self->org_writer != NULL )
     {
@@ -118,3 +187,206 @@ void release_out_redir( out_redir * self )
     self->org_writer = NULL;
 }
 
+
+
+/* =========================================================================================== */
+
+#define OUT_CHUNK_INITIAL_SIZE ( 1024 * 64 )
+
+rc_t make_out_chunk( out_chunk ** self, uint64_t seq )
+{
+    rc_t rc = 0;
+    out_chunk * c = malloc( sizeof * c );
+    *self = NULL;
+    if ( c == NULL )
+        rc = RC( rcExe, rcBuffer, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        c->buffer = malloc( OUT_CHUNK_INITIAL_SIZE );
+        if ( c->buffer == NULL )
+        {
+            rc = RC( rcExe, rcBuffer, rcConstructing, rcMemory, rcExhausted );
+            free( c );
+        }
+        else
+        {
+            c->seq = seq;
+            c->size = OUT_CHUNK_INITIAL_SIZE;
+            c->used = 0;
+            *self = c;
+        }
+    }
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot create output-chunk" );
+    return rc;
+}
+
+
+void release_out_chunk( out_chunk * self )
+{
+    if ( self != NULL )
+    {
+        free( self->buffer );
+        free( self );
+    }
+}
+
+
+void out_redir_capture( out_chunk * chunk )
+{
+    captured = chunk;
+}
+
+
+/* =========================================================================================== */
+
+typedef struct out_reorder
+{
+    KLock * lock;
+    KCondition * cond;
+    out_chunk ** pending;   /* ring-buffer, indexed by seq % max_pending */
+    uint64_t next_seq;      /* the seq-number of the chunk to be written next */
+    uint32_t max_pending;
+    bool aborted;
+    rc_t rc;                /* the first error while writing */
+} out_reorder;
+
+
+rc_t make_out_reorder( struct out_reorder ** self, uint32_t max_pending )
+{
+    rc_t rc = 0;
+    out_reorder * o = calloc( 1, sizeof * o );
+    *self = NULL;
+    if ( o == NULL )
+    {
+        rc = RC( rcExe, rcQueue, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create reorder-buffer" );
+    }
+    else
+    {
+        o->max_pending = ( max_pending > 0 ) ? max_pending : 1;
+        o->pending = calloc( o->max_pending, sizeof *( o->pending ) );
+        if ( o->pending == NULL )
+        {
+            rc = RC( rcExe, rcQueue, rcConstructing, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "cannot create reorder-buffer" );
+        }
+        if ( rc == 0 )
+        {
+            rc = KLockMake( &o->lock );
+            if ( rc != 0 )
+                (void)LOGERR( klogErr, rc, "KLockMake() for reorder-buffer failed" );
+        }
+        if ( rc == 0 )
+        {
+            rc = KConditionMake( &o->cond );
+            if ( rc != 0 )
+                (void)LOGERR( klogErr, rc, "KConditionMake() for reorder-buffer failed" );
+        }
+        if ( rc == 0 )
+            *self = o;
+        else
+            release_out_reorder( o );
+    }
+    return rc;
+}
+
+
+/* write a chunk through the installed KOut-handler, called with the lock held
+   and with capturing switched off for the calling thread */
+static rc_t out_reorder_write( out_chunk * chunk )
+{
+    rc_t rc = 0;
+    if ( chunk->used > 0 )
+    {
+        KWrtWriter writer = KOutWriterGet();
+        void * data = KOutDataGet();
+        size_t num_writ;
+        rc = writer( data, chunk->buffer, chunk->used, &num_writ );
+        if ( rc == 0 && num_writ != chunk->used )
+            rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        if ( rc != 0 )
+            (void)LOGERR( klogErr, rc, "cannot write output-chunk" );
+    }
+    return rc;
+}
+
+
+rc_t out_reorder_put( struct out_reorder * self, out_chunk * chunk )
+{
+    rc_t rc;
+    out_chunk * prev_captured = captured;
+
+    if ( self == NULL || chunk == NULL )
+    {
+        release_out_chunk( chunk );
+        return RC( rcExe, rcQueue, rcInserting, rcParam, rcNull );
+    }
+
+    captured = NULL;
+    rc = KLockAcquire( self->lock );
+    if ( rc == 0 )
+    {
+        /* back-pressure: do not let the workers run too far ahead of the writer,
+           the chunk with next_seq itself is never blocked here */
+        while ( rc == 0 && !self->aborted && chunk->seq >= self->next_seq + self->max_pending )
+            rc = KConditionWait( self->cond, self->lock );
+
+        if ( rc == 0 && self->rc == 0 && !self->aborted )
+        {
+            self->pending[ chunk->seq % self->max_pending ] = chunk;
+            chunk = NULL;
+
+            /* write out all the chunks that are now in order */
+            while ( self->rc == 0 )
+            {
+                uint32_t idx = ( uint32_t )( self->next_seq % self->max_pending );
+                out_chunk * c = self->pending[ idx ];
+                if ( c == NULL || c->seq != self->next_seq )
+                    break;
+                self->pending[ idx ] = NULL;
+                self->rc = out_reorder_write( c );
+                release_out_chunk( c );
+                self->next_seq++;
+            }
+            KConditionBroadcast( self->cond );
+        }
+        if ( rc == 0 )
+            rc = self->rc;
+        if ( rc == 0 && self->aborted )
+            rc = RC( rcExe, rcQueue, rcInserting, rcQueue, rcCanceled );
+        KLockUnlock( self->lock );
+    }
+    release_out_chunk( chunk );
+    captured = prev_captured;
+    return rc;
+}
+
+
+void out_reorder_abort( struct out_reorder * self )
+{
+    if ( self != NULL && KLockAcquire( self->lock ) == 0 )
+    {
+        self->aborted = true;
+        KConditionBroadcast( self->cond );
+        KLockUnlock( self->lock );
+    }
+}
+
+
+void release_out_reorder( struct out_reorder * self )
+{
+    if ( self != NULL )
+    {
+        if ( self->pending != NULL )
+        {
+            uint32_t idx;
+            for ( idx = 0; idx < self->max_pending; ++idx )
+                release_out_chunk( self->pending[ idx ] );
+            free( self->pending );
+        }
+        KConditionRelease( self->cond );
+        KLockRelease( self->lock );
+        free( self );
+    }
+}
@@ -39,6 +39,8 @@ extern "C" {
 
 #include <kfs/file.h>
 
+#include "bam_index.h"
+
 enum out_redir_mode
 {
     orm_uncompressed = 0,
@@ -54,11 +56,52 @@ typedef struct out_redir
     void* org_data;
     KFile* kfile;
     uint64_t pos;
+    struct bam_out * bam;   /* if not NULL: the header and the encoded records go into BAM */
 } out_redir;
 
 
 rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * filename, size_t bufsize );
 
+/* switch the ( uncompressed ) output to BAM, idx_filename can be NULL if idx_fmt is bif_none */
+rc_t out_redir_make_bam( out_redir * self, uint32_t num_threads,
+                         enum bam_index_format idx_fmt, const char * idx_filename );
+
+/* completes the output ( BAM: EOF-marker and index ), call before release_out_redir() */
+rc_t out_redir_finish( out_redir * self );
+
 void release_out_redir( out_redir * self );
 
+
+/* a chunk of output, produced by one worker-thread */
+typedef struct out_chunk
+{
+    uint64_t seq;       /* position of this chunk in the output-stream */
+    char * buffer;
+    size_t size;
+    size_t used;
+} out_chunk;
+
+rc_t make_out_chunk( out_chunk ** self, uint64_t seq );
+
+void release_out_chunk( out_chunk * self );
+
+/* everything the calling thread prints via KOutMsg() goes into the chunk,
+   pass NULL to send the output of this thread to the real output again */
+void out_redir_capture( out_chunk * chunk );
+
+
+/* the reorder-buffer in front of the output: chunks can be put in any order,
+   they are written in the order of their seq-numbers ( starting with zero ) */
+struct out_reorder;
+
+rc_t make_out_reorder( struct out_reorder ** self, uint32_t max_pending );
+
+/* takes ownership of the chunk, blocks if the chunk is too far ahead */
+rc_t out_reorder_put( struct out_reorder * self, out_chunk * chunk );
+
+/* unblocks all waiting threads, chunks put after this are discarded */
+void out_reorder_abort( struct out_reorder * self );
+
+void release_out_reorder( struct out_reorder * self );
+
 #endif
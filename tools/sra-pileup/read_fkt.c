@@ -25,6 +25,7 @@
 */
 
 #include "read_fkt.h"
+#include "col_prefetch.h"
 #include <sysalloc.h>
 
 /* ------------------------------------------------------------------------------------------------------------------- */
@@ -42,7 +43,7 @@ rc_t read_bool( int64_t row_id, const VCursor * cursor, uint32_t idx, bool *res,
     {
         const bool * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) bool failed", 
@@ -70,7 +71,7 @@ rc_t read_bool_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const
     {
         bool * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) failed", 
@@ -104,7 +105,7 @@ rc_t read_uint8( int64_t row_id, const VCursor * cursor, uint32_t idx, uint8_t *
     {
         const uint8_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) char_ptr failed", 
@@ -132,7 +133,7 @@ rc_t read_uint8_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const
     {
         const uint8_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) char_ptr failed", 
@@ -166,7 +167,7 @@ rc_t read_uint32( int64_t row_id, const VCursor * cursor, uint32_t idx, uint32_t
     {
         uint32_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) uint32_t failed", 
@@ -194,7 +195,7 @@ rc_t read_uint32_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, cons
     {
         uint32_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) uint32_t (ptr) failed", 
@@ -228,7 +229,7 @@ rc_t read_int32( int64_t row_id, const VCursor * cursor, uint32_t idx, int32_t *
     {
         int32_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) uint32_t failed", 
@@ -256,7 +257,7 @@ rc_t read_int32_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const
     {
         int32_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) uint32_t (ptr) failed", 
@@ -290,7 +291,7 @@ rc_t read_int64( int64_t row_id, const VCursor * cursor, uint32_t idx, int64_t *
     {
         const int64_t *value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) int64 failed", 
@@ -318,7 +319,7 @@ rc_t read_int64_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const
     {
         int64_t * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) uint64_t (ptr) failed", 
@@ -352,7 +353,7 @@ rc_t read_char_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const
     {
         const char * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) char_ptr failed", 
@@ -386,7 +387,7 @@ rc_t read_INSDC_coord_zero( int64_t row_id, const VCursor * cursor, uint32_t idx
     {
         INSDC_coord_zero * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_zero failed", 
@@ -414,7 +415,7 @@ rc_t read_INSDC_coord_zero_ptr( int64_t row_id, const VCursor * cursor, uint32_t
     {
         const INSDC_coord_zero * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_zero (ptr) failed", 
@@ -448,7 +449,7 @@ rc_t read_INSDC_coord_one( int64_t row_id, const VCursor * cursor, uint32_t idx,
     {
         INSDC_coord_one * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_one failed", 
@@ -476,7 +477,7 @@ rc_t read_INSDC_coord_one_ptr( int64_t row_id, const VCursor * cursor, uint32_t
     {
         INSDC_coord_one * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_one (ptr) failed", 
@@ -511,7 +512,7 @@ rc_t read_INSDC_coord_len( int64_t row_id, const VCursor * cursor, uint32_t idx,
     {
         INSDC_coord_len * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_len failed", 
@@ -539,7 +540,7 @@ rc_t read_INSDC_coord_len_ptr( int64_t row_id, const VCursor * cursor, uint32_t
     {
         const INSDC_coord_len * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_coord_len (ptr) failed", 
@@ -573,7 +574,7 @@ rc_t read_INSDC_read_type_ptr( int64_t row_id, const VCursor * cursor, uint32_t
     {
         const INSDC_read_type * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_read_type (ptr) failed", 
@@ -604,7 +605,7 @@ rc_t read_INSDC_read_filter_ptr( int64_t row_id, const VCursor * cursor, uint32_
     {
         const INSDC_read_filter * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_read_filter (ptr) failed", 
@@ -635,7 +636,7 @@ rc_t read_INSDC_dna_text_ptr( int64_t row_id, const VCursor * cursor, uint32_t i
     {
         const INSDC_dna_text * value;
         uint32_t elem_bits, boff, row_len;
-        rc = VCursorCellDataDirect( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
+        rc = col_prefetch_cell_data( cursor, row_id, idx, &elem_bits, (const void**)&value, &boff, &row_len );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row#$(tr) . idx#$(ti) . $(hi) ) INSDC_dna_text (ptr) failed", 
@@ -27,14 +27,19 @@
 #include <align/manager.h>
 #include <align/iterator.h>
 #include <kapp/main.h>
+#include <klib/printf.h>
 #include <ctype.h>
 #include <sysalloc.h>
 
 #include "read_fkt.h"
+#include "col_prefetch.h"
 #include "cg_tools.h"
 #include "rna_splice_log.h"
 #include "sam-aligned.h"
 #include "md_flag.h"
+#include "dyn_string.h"
+#include "dump_pool.h"
+#include "bam_out.h"
 
 const char * PRIM_TABLE = "PRIMARY_ALIGNMENT";
 const char * SEC_TABLE = "SECONDARY_ALIGNMENT";
@@ -180,6 +185,12 @@ typedef struct align_table_context
 
     /* the common part repeats for evidence-alignment */
     align_cmn_context eval;
+
+    /* value of the XR-tag for the next record printed, only used in region-batch mode */
+    const char * region_tag;
+
+    /* buffered columns of the current batch of placements ( prim/sec only, created on first use ) */
+    struct col_prefetch * prefetch;
 } align_table_context;
 
 
@@ -240,6 +251,8 @@ static void free_align_table_context( align_table_context * atx )
         if ( atx->cig_op_buffer != NULL )
             free( atx->cig_op_buffer );
 
+        release_col_prefetch( atx->prefetch );
+
         VCursorRelease( atx->cmn.cursor );
         VCursorRelease( atx->eval.cursor );
         free( atx );
@@ -547,16 +560,18 @@ static rc_t prepare_evidence_table_cursor( const samdump_opts * const opts,
 }
 
 
-static rc_t add_table_pl_iter( const samdump_opts * const opts,
-                               PlacementSetIterator * const set_iter,
-                               const ReferenceObj * const ref_obj,
-                               const input_database * const idb,
-                               INSDC_coord_zero ref_pos,
-                               INSDC_coord_len ref_len,
-                               const char * spot_group,
-                               const char * table_name,
-                               align_id_src id_src_selector,
-                               Vector * const context_list )
+/* creates one align-table-context ( with its cursor ) for the given table and one placement-iterator
+   for each of the windows, all of these iterators share the cursor of the context */
+static rc_t add_table_pl_iters( const samdump_opts * const opts,
+                                PlacementSetIterator * const set_iter,
+                                const ReferenceObj * const ref_obj,
+                                const input_database * const idb,
+                                const range * windows,
+                                uint32_t window_count,
+                                const char * spot_group,
+                                const char * table_name,
+                                align_id_src id_src_selector,
+                                Vector * const context_list )
 {
     rc_t rc = 0;
     align_table_context * atx;
@@ -606,35 +621,39 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
     if ( rc == 0 )
     {
         int32_t min_mapq = 0;
-        PlacementIterator *pl_iter;
+        uint32_t window_idx;
 
         if ( opts->use_min_mapq )
             min_mapq = opts->min_mapq;
 
-        rc = ReferenceObj_MakePlacementIterator( ref_obj, /* the reference-obj it is made from */
-            &pl_iter,           /* the placement-iterator we want to make */
-            ref_pos,            /* where it starts on the reference */
-            ref_len,            /* the whole length of this reference/chromosome */
-            min_mapq,           /* no minimal mapping-quality to filter out */
-            NULL,               /* no special reference-cursor */
-            atx->cmn.cursor,    /* a cursor into the PRIMARY/SECONDARY/EVIDENCE-table */
-            id_src_selector,    /* what ID-source to select from REFERENCE-table (ref_obj) */
-            &ext_0,             /* placement-record extensions #0 with data-ptr pointing to cursor/index-struct */
-            NULL,               /* no placement-record extensions #1 */
-            spot_group,         /* optional spotgroup re-grouping */
-            NULL                /* source-cursor specific data/context */
-            );
-        if ( rc == 0 )
+        for ( window_idx = 0; window_idx < window_count && rc == 0; ++window_idx )
         {
-            rc = PlacementSetIteratorAddPlacementIterator ( set_iter, pl_iter );
-            /* if the iterator-set was not able to take ownership of the new iterator
-               we have to release the iterator right here! */
-            if ( rc != 0 )
-                PlacementIteratorRelease( pl_iter );
+            PlacementIterator *pl_iter;
+            rc = ReferenceObj_MakePlacementIterator( ref_obj, /* the reference-obj it is made from */
+                &pl_iter,           /* the placement-iterator we want to make */
+                windows[ window_idx ].start,    /* where it starts on the reference */
+                windows[ window_idx ].end - windows[ window_idx ].start + 1, /* how many bases it covers */
+                min_mapq,           /* no minimal mapping-quality to filter out */
+                NULL,               /* no special reference-cursor */
+                atx->cmn.cursor,    /* a cursor into the PRIMARY/SECONDARY/EVIDENCE-table */
+                id_src_selector,    /* what ID-source to select from REFERENCE-table (ref_obj) */
+                &ext_0,             /* placement-record extensions #0 with data-ptr pointing to cursor/index-struct */
+                NULL,               /* no placement-record extensions #1 */
+                spot_group,         /* optional spotgroup re-grouping */
+                NULL                /* source-cursor specific data/context */
+                );
+            if ( rc == 0 )
+            {
+                rc = PlacementSetIteratorAddPlacementIterator ( set_iter, pl_iter );
+                /* if the iterator-set was not able to take ownership of the new iterator
+                   we have to release the iterator right here! */
+                if ( rc != 0 )
+                    PlacementIteratorRelease( pl_iter );
 
-            /* if the new iterator has actually no placements inside, the call
-               to PlacementSetIteratorAddPlacementIterator() returned rcDone, which is OK - we continue... */
-            if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+                /* if the new iterator has actually no placements inside, the call
+                   to PlacementSetIteratorAddPlacementIterator() returned rcDone, which is OK - we continue... */
+                if ( GetRCState( rc ) == rcDone ) { rc = 0; }
+            }
         }
     }
 
@@ -644,14 +663,14 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
 }
 
 
-static rc_t add_pl_iters( const samdump_opts * const opts,
-                          PlacementSetIterator * const set_iter,
-                          const ReferenceObj * const ref_obj,
-                          const input_database * const idb,
-                          INSDC_coord_zero ref_pos,
-                          INSDC_coord_len ref_len,
-                          const char * spot_group,
-                          Vector * const context_list )
+static rc_t add_pl_window_iters( const samdump_opts * const opts,
+                                 PlacementSetIterator * const set_iter,
+                                 const ReferenceObj * const ref_obj,
+                                 const input_database * const idb,
+                                 const range * windows,
+                                 uint32_t window_count,
+                                 const char * spot_group,
+                                 Vector * const context_list )
 {
     KNamelist *tables;
     rc_t rc = VDatabaseListTbl( idb->db, &tables );
@@ -663,14 +682,14 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
     {
         if ( opts->dump_primary_alignments && namelist_contains( tables, PRIM_TABLE ) ) /* read_fkt.c */
         {
-            rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                    PRIM_TABLE, primary_align_ids, context_list );
+            rc = add_table_pl_iters( opts, set_iter, ref_obj, idb, windows, window_count, spot_group, 
+                                     PRIM_TABLE, primary_align_ids, context_list );
         }
 
         if ( rc == 0 && opts->dump_secondary_alignments && namelist_contains( tables, SEC_TABLE ) )
         {
-            rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                    SEC_TABLE, secondary_align_ids, context_list );
+            rc = add_table_pl_iters( opts, set_iter, ref_obj, idb, windows, window_count, spot_group, 
+                                     SEC_TABLE, secondary_align_ids, context_list );
         }
 
         if ( rc == 0 )
@@ -684,8 +703,8 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
 
             if ( b0 || b1 )
             {
-                rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                        EV_INT_TABLE, evidence_align_ids, context_list );
+                rc = add_table_pl_iters( opts, set_iter, ref_obj, idb, windows, window_count, spot_group, 
+                                         EV_INT_TABLE, evidence_align_ids, context_list );
             }
         }
         KNamelistRelease( tables );
@@ -694,6 +713,22 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
 }
 
 
+static rc_t add_pl_iters( const samdump_opts * const opts,
+                          PlacementSetIterator * const set_iter,
+                          const ReferenceObj * const ref_obj,
+                          const input_database * const idb,
+                          INSDC_coord_zero ref_pos,
+                          INSDC_coord_len ref_len,
+                          const char * spot_group,
+                          Vector * const context_list )
+{
+    range window;
+    window.start = ref_pos;
+    window.end = ref_pos + ref_len - 1;
+    return add_pl_window_iters( opts, set_iter, ref_obj, idb, &window, 1, spot_group, context_list );
+}
+
+
 /* the user did not specify ranges on the reference, that means the whole file has to be dumped...
    the reflist is iterated over all ref-objects it contains ... */
 static rc_t prepare_whole_files( const samdump_opts * const opts,
@@ -752,6 +787,60 @@ typedef struct on_region_ctx
 } on_region_ctx;
 
 
+/* region-batch: ranges closer than this are walked as one window, the alignments starting in the gap
+   are skipped while walking, that is cheaper than setting up one more placement-iterator */
+#define REGION_BATCH_BRIDGE 4096
+
+/* region-batch: all ranges of one reference are walked by iterators sharing one cursor per table */
+static rc_t add_region_batch_iters( on_region_ctx * rctx,
+                                    const reference_region * ref_rgn,
+                                    const ReferenceObj * ref_obj )
+{
+    rc_t rc = 0;
+    uint32_t range_idx, range_count = VectorLength( &ref_rgn->ranges );
+    uint32_t window_count = 0;
+    range * windows = malloc( ( range_count + 1 ) * sizeof * windows );
+    if ( windows == NULL )
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        for ( range_idx = 0; range_idx < range_count && rc == 0; ++range_idx )
+        {
+            range * r = VectorGet( &ref_rgn->ranges, range_idx );
+            if ( r != NULL )
+            {
+                if ( r->end == RANGE_OPEN_END )
+                {
+                    INSDC_coord_len len;
+                    rc = ReferenceObj_SeqLength( ref_obj, &len );
+                    if ( rc == 0 )
+                    {
+                        if ( r->start == 0 )
+                            r->start = 1;
+                        r->end = len;
+                    }
+                }
+                if ( rc == 0 )
+                {
+                    if ( window_count > 0 && r->start <= windows[ window_count - 1 ].end + REGION_BATCH_BRIDGE )
+                    {
+                        if ( r->end > windows[ window_count - 1 ].end )
+                            windows[ window_count - 1 ].end = r->end;
+                    }
+                    else
+                        windows[ window_count++ ] = *r;
+                }
+            }
+        }
+        if ( rc == 0 && window_count > 0 )
+            rc = add_pl_window_iters( rctx->opts, rctx->set_iter, ref_obj, rctx->idb,
+                                      windows, window_count, NULL, rctx->context_list );
+        free( windows );
+    }
+    return rc;
+}
+
+
 static void CC on_region( BSTNode *n, void *data )
 {
     on_region_ctx * rctx = data;
@@ -760,7 +849,12 @@ static void CC on_region( BSTNode *n, void *data )
         reference_region * ref_rgn = ( reference_region * )n;
         const ReferenceObj * ref_obj;
         rctx->rc = ReferenceList_Find( rctx->idb->reflist, &ref_obj, ref_rgn->name, string_size( ref_rgn->name ) );
-        if ( rctx->rc == 0 )
+        if ( rctx->rc == 0 && rctx->opts->region_file != NULL )
+        {
+            rctx->rc = add_region_batch_iters( rctx, ref_rgn, ref_obj );
+            ReferenceObj_Release( ref_obj );
+        }
+        else if ( rctx->rc == 0 )
         {
             uint32_t range_idx, range_count = VectorLength( &ref_rgn->ranges );
             for ( range_idx = 0; range_idx < range_count && rctx->rc == 0; ++range_idx )
@@ -769,18 +863,22 @@ static void CC on_region( BSTNode *n, void *data )
                 if ( r != NULL )
                 {
                     INSDC_coord_len len;
-                    if ( r->start == 0 && r->end == 0 )
+                    if ( r->end == RANGE_OPEN_END )
                     {
-                        r->start = 1;
+                        if ( r->start == 0 )
+                            r->start = 1;
                         rctx->rc = ReferenceObj_SeqLength( ref_obj, &len );
                         if ( rctx->rc == 0 )
-                            r->end = ( r->start + len );
+                        {
+                            r->end = len;
+                            len = ( r->start <= r->end ) ? ( r->end - r->start + 1 ) : 0;
+                        }
                     }
                     else
                     {
                         len = ( r->end - r->start + 1 );
                     }
-                    if ( rctx->rc == 0 )
+                    if ( rctx->rc == 0 && len > 0 )
                     {
                         rctx->rc = add_pl_iters( rctx->opts, rctx->set_iter, ref_obj, rctx->idb,
                             r->start,           /* where the range starts on the reference */
@@ -976,12 +1074,8 @@ static rc_t cg_cigar_treatments( enum cigar_treatment what_treatment,
 }
 
 
-static rc_t print_quality_or_star( const samdump_opts * const opts,
-                                   const char * const q,
-                                   uint32_t q_len,
-                                   uint32_t r_len )
+static bool is_star_quality( const char * const q, uint32_t q_len, uint32_t r_len )
 {
-    rc_t rc;
     bool star_qual = ( q_len == 0 || q_len != r_len );
     if ( !star_qual && q[ 0 ] == 255 )
     {
@@ -989,8 +1083,17 @@ static rc_t print_quality_or_star( const samdump_opts * const opts,
         while ( i < q_len && q[ i ] == 255 ) i++;
         star_qual = ( i == q_len );
     }
-    
-    if ( star_qual )
+    return star_qual;
+}
+
+
+static rc_t print_quality_or_star( const samdump_opts * const opts,
+                                   const char * const q,
+                                   uint32_t q_len,
+                                   uint32_t r_len )
+{
+    rc_t rc;
+    if ( is_star_quality( q, q_len, r_len ) )
         rc = KOutMsg( "*" );
     else
         rc = dump_quality_33( opts, q, q_len, false ); /* sam-dump-opts.c */
@@ -1397,18 +1500,24 @@ static rc_t print_alignment_sam_ev( const samdump_opts * const opts,
 }
 
 
-static rc_t opt_field_spot_group( const VCursor * cursor, uint32_t col_id, int64_t row_id )
+/* bam != NULL: the field goes into the BAM-record instead of being printed */
+static rc_t opt_field_spot_group( bam_rec * bam, const VCursor * cursor, uint32_t col_id, int64_t row_id )
 {
     const char * value = NULL;
     uint32_t len;    
     rc_t rc = read_char_ptr( row_id, cursor, col_id, &value, &len, "SPOT_GROUP" );
     if ( rc == 0 && len > 0 )
-        rc = KOutMsg( "\tRG:Z:%.*s", len, value );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_str( bam, "RG", value, len );
+        else
+            rc = KOutMsg( "\tRG:Z:%.*s", len, value );
+    }
     return rc;
 }
 
 
-static rc_t opt_field_lnk_group( const VCursor * cursor, uint32_t col_id, int64_t row_id )
+static rc_t opt_field_lnk_group( bam_rec * bam, const VCursor * cursor, uint32_t col_id, int64_t row_id )
 {
     const char * value = NULL;
     uint32_t len;    
@@ -1450,7 +1559,18 @@ static rc_t opt_field_lnk_group( const VCursor * cursor, uint32_t col_id, int64_
             }
         }
         
-        if ( CB.addr == NULL && UB.addr == NULL )
+        if ( bam != NULL )
+        {
+            if ( CB.addr == NULL && UB.addr == NULL )
+                rc = bam_rec_tag_str( bam, "BX", value, len );
+            else
+            {
+                rc = bam_rec_tag_str( bam, "CB", CB.addr, CB.size );
+                if ( rc == 0 )
+                    rc = bam_rec_tag_str( bam, "UB", UB.addr, UB.size );
+            }
+        }
+        else if ( CB.addr == NULL && UB.addr == NULL )
             { rc = KOutMsg( "\tBX:Z:%.*s", len, value ); }
         else
             { rc = KOutMsg( "\tCB:Z:%S\tUB:Z:%S", &CB, &UB ); }
@@ -1458,6 +1578,33 @@ static rc_t opt_field_lnk_group( const VCursor * cursor, uint32_t col_id, int64_
     return rc;
 }
 
+
+/* OPT SAM-FIELD: MD    into the BAM-record */
+static rc_t bam_md_tag( bam_rec * bam, const char * cigar, size_t cigar_len,
+                        const char * read, size_t read_len,
+                        const uint8_t * ref, INSDC_coord_len ref_len )
+{
+    struct dyn_string * md;
+    rc_t rc = allocated_dyn_string( &md, 256 ); /* dyn_string.c */
+    if ( rc == 0 )
+    {
+        rc = dyn_string_md_tag_from_cigar_string( md, cigar, cigar_len, read, read_len, ref, ref_len ); /* md_flag.c */
+        if ( rc == 0 )
+            rc = bam_rec_tag_str( bam, "MD", dyn_string_char( md, 0 ), dyn_string_len( md ) );
+        free_dyn_string( md );
+    }
+    return rc;
+}
+
+
+/* SAM: the line ends, BAM: the record is encoded and written */
+static rc_t end_of_record( bam_rec * bam )
+{
+    if ( bam != NULL )
+        return bam_rec_write( bam ); /* bam_out.c */
+    return KOutMsg( "\n" );
+}
+
 static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                                     const char * ref_name,
                                     INSDC_coord_zero pos,
@@ -1476,6 +1623,9 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     cg_cigar_output cgc_output;
     rna_splice_candidates candidates; /* in cg_tools.h */
     bool rna_not_homogeneous_flag = false;
+    char * temp_cigar = NULL;
+    char qname[ 4096 ];
+    bam_rec bam_record, * bam = NULL;
 
     /* SAM-FIELD: NONE      SRA-column: MATE_ALIGN_ID ( int64 ) ... for cache lookup's */
     rc_t rc = read_int64( id, cursor, atx->mate_align_id_idx, &mate_align_id, 0, "MATE_ALIGN_ID" );
@@ -1587,27 +1737,38 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     if ( rc == 0 && opts->use_matepair_filter && !filter_by_matepair_dist( opts, tlen ) )
         return 0;
 
+    if ( opts->output_bam )
+    {
+        bam_rec_init( &bam_record );
+        bam = &bam_record;
+    }
+
     /* SAM-FIELD: QNAME     SRA-column: SEQ_SPOT_ID ( int64 ) */
     if ( rc == 0 )
     {
         if ( seq_spot_id_len > 0 )
         {
+            const char * spot_group = NULL;
+            uint32_t spot_group_len = 0;
             if ( opts->print_spot_group_in_name | opts->print_cg_names )
-            {
-                const char * spot_group;
-                uint32_t spot_group_len;
                 rc = read_char_ptr( id, cursor, atx->cmn.seq_spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
-                if ( rc == 0 )
+            if ( rc == 0 )
+            {
+                if ( bam != NULL )
+                {
+                    rc = format_name( opts, qname, sizeof qname, &bam->qname_len,
+                                      *seq_spot_id, spot_group, spot_group_len ); /* sam-dump-opts.c */
+                    bam->qname = qname;
+                }
+                else
                     rc = dump_name( opts, *seq_spot_id, spot_group, spot_group_len ); /* sam-dump-opts.c */
             }
-            else
-                rc = dump_name( opts, *seq_spot_id, NULL, 0 ); /* sam-dump-opts.c */
         }
-        else
+        else if ( bam == NULL )
             rc = KOutMsg( "*" );
     }
 
-    if ( rc == 0 )
+    if ( rc == 0 && bam == NULL )
         rc = KOutMsg( "\t" );
 
     /* massage the sam-flag if we are not dumping unaligned reads... */
@@ -1623,7 +1784,18 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     /* SAM-FIELD: POS       SRA-column: REF_POS + 1 */
     /* SAM-FIELD: MAPQ      SRA-column: MAPQ */
     if ( rc == 0 )
-        rc = KOutMsg( "%u\t%s\t%u\t%d\t", sam_flags, ref_name, pos + 1, rec->mapq );
+    {
+        if ( bam != NULL )
+        {
+            bam->flag = sam_flags;
+            bam->rname = ref_name;
+            bam->rname_len = string_size( ref_name );
+            bam->pos = pos;
+            bam->mapq = rec->mapq;
+        }
+        else
+            rc = KOutMsg( "%u\t%s\t%u\t%d\t", sam_flags, ref_name, pos + 1, rec->mapq );
+    }
 
     /* get READ, QUALITY and EIDT_DIST before cigar manipulation because we need/change these values */
     if ( rc == 0 )
@@ -1633,7 +1805,6 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     if ( rc == 0 )
     {
         cg_cigar_input cgc_input;
-        char * temp_cigar = NULL;
         static char const *bogus_quality = "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!";
 
         rc = read_char_ptr( id, cursor, atx->cmn.cigar_idx, &cgc_input.p_cigar.ptr, &cgc_input.p_cigar.len, "CIGAR" );
@@ -1670,7 +1841,7 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                     if ( candidates.fwd_matched > 0 && candidates.rev_matched > 0 )
                         rna_not_homogeneous_flag = true;
 
-                    temp_cigar = malloc( cgc_output.p_cigar.len + 1 ); /* temp_cigar will be released at the end of this block */
+                    temp_cigar = malloc( cgc_output.p_cigar.len + 1 ); /* temp_cigar will be released at the end */
                     if ( temp_cigar != NULL )
                     {
                         /* create a new cigarstring by applying the candidates to the cigar-string */
@@ -1709,16 +1880,33 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                 free( ( void * ) candidates.cigops );
         }
         if ( rc == 0 )
-            rc = KOutMsg( "%.*s\t", cgc_output.p_cigar.len, cgc_output.p_cigar.ptr );
-
-        if ( temp_cigar != NULL )
-            free( temp_cigar );
+        {
+            if ( bam != NULL )
+            {
+                bam->cigar = cgc_output.p_cigar.ptr;
+                bam->cigar_len = cgc_output.p_cigar.len;
+            }
+            else
+                rc = KOutMsg( "%.*s\t", cgc_output.p_cigar.len, cgc_output.p_cigar.ptr );
+        }
     }
 
     /* SAM-FIELD: RNEXT     SRA-column: MATE_REF_NAME ( !!! row_len can be zero !!! ) */
     /* SAM-FIELD: PNEXT     SRA-column: MATE_REF_POS + 1 ( !!! row_len can be zero !!! ) */
     /* SAM-FIELD: TLEN      SRA-column: TEMPLATE_LEN ( !!! row_len can be zero !!! ) */
-    if ( rc == 0 )
+    if ( rc == 0 && bam != NULL )
+    {
+        if ( mate_ref_name_len > 0 )
+        {
+            bam->rnext = mate_ref_name;
+            bam->rnext_len = mate_ref_name_len;
+            bam->pnext = mate_ref_pos;
+        }
+        else if ( mate_ref_pos_len != 0 )
+            bam->pnext = mate_ref_pos - 1;
+        bam->tlen = tlen;
+    }
+    else if ( rc == 0 )
     {
         if ( mate_ref_name_len > 0 )
         {
@@ -1734,27 +1922,49 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     }
 
     /* SAM-FIELD: SEQ       SRA-column: READ */
-    if ( rc == 0 )
-        rc = KOutMsg( "%.*s\t", cgc_output.p_read.len, cgc_output.p_read.ptr );
-
     /* SAM-FIELD: QUAL      SRA-column: SAM_QUALITY */
-    if ( rc == 0 )
-        rc = print_quality_or_star( opts, cgc_output.p_quality.ptr, cgc_output.p_quality.len, cgc_output.p_read.len ); /* above */    
+    if ( rc == 0 && bam != NULL )
+    {
+        bam->seq = cgc_output.p_read.ptr;
+        bam->l_seq = cgc_output.p_read.len;
+        if ( !is_star_quality( cgc_output.p_quality.ptr, cgc_output.p_quality.len, cgc_output.p_read.len ) )
+        {
+            bam->qual = cgc_output.p_quality.ptr;
+            bam->qual_offset = 33;
+            bam->qual_quant = ( opts->qual_quant != NULL ) ? opts->qual_quant_matrix : NULL;
+        }
+    }
+    else if ( rc == 0 )
+    {
+        rc = KOutMsg( "%.*s\t", cgc_output.p_read.len, cgc_output.p_read.ptr );
+        if ( rc == 0 )
+            rc = print_quality_or_star( opts, cgc_output.p_quality.ptr, cgc_output.p_quality.len, cgc_output.p_read.len ); /* above */    
+    }
 
     /* OPT SAM-FIELD: RG     SRA-column: SPOT_GROUP */
     if ( rc == 0 && ( atx->cmn.seq_spot_group_idx != COL_NOT_AVAILABLE ) )
-        rc = opt_field_spot_group( cursor, atx->cmn.seq_spot_group_idx, id );
+        rc = opt_field_spot_group( bam, cursor, atx->cmn.seq_spot_group_idx, id );
 
     /* OPT SAM-FIELD: BZ     SRA-column: LINKAGE_GROUP */
     if ( rc == 0 && ( atx->lnk_group_idx != COL_NOT_AVAILABLE ) )
-        rc = opt_field_lnk_group( cursor, atx->lnk_group_idx, id );
+        rc = opt_field_lnk_group( bam, cursor, atx->lnk_group_idx, id );
 
     if ( rc == 0 && cgc_output.p_tags.len > 0 )
-        rc = KOutMsg( "\t%.*s", cgc_output.p_tags.len, cgc_output.p_tags.ptr );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tags_text( bam, cgc_output.p_tags.ptr, cgc_output.p_tags.len );
+        else
+            rc = KOutMsg( "\t%.*s", cgc_output.p_tags.len, cgc_output.p_tags.ptr );
+    }
 
     /* OPT SAM-FIELD: XI     SRA-column: ALIGN_ID */
     if ( rc == 0 && opts->print_alignment_id_in_column_xi )
-        rc = KOutMsg( "\tXI:i:%u", id );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_int( bam, "XI", ( uint32_t )id );
+        else
+            rc = KOutMsg( "\tXI:i:%u", id );
+    }
 
     /* to match sam-tools output: in case we are dumping this in CG-mode.... */
     if ( rc == 0 && ( opts->cigar_treatment != ct_unchanged ) && ( atx->al_group_idx != COL_NOT_AVAILABLE ) )
@@ -1769,7 +1979,16 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
             {
                 if ( align_grp[ i ] == '_' )
                 {
-                    rc = KOutMsg( "\tZI:i:%.*s\tZA:i:%.1s", i, align_grp, align_grp + i + 1 );
+                    if ( bam != NULL )
+                    {
+                        char tags[ 256 ];
+                        size_t num_writ;
+                        rc = string_printf( tags, sizeof tags, &num_writ, "ZI:i:%.*s\tZA:i:%.1s", i, align_grp, align_grp + i + 1 );
+                        if ( rc == 0 )
+                            rc = bam_rec_tags_text( bam, tags, num_writ );
+                    }
+                    else
+                        rc = KOutMsg( "\tZI:i:%.*s\tZA:i:%.1s", i, align_grp, align_grp + i + 1 );
                     break;
                 }
             }
@@ -1783,12 +2002,22 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
         uint32_t al_count_len;
         rc = read_uint8_ptr( id, cursor, atx->cmn.al_count_idx, &al_count, &al_count_len, "ALIGNMENT_COUNT" );
         if ( rc == 0 && al_count_len > 0 )
-            rc = KOutMsg( "\tNH:i:%u", *al_count );
+        {
+            if ( bam != NULL )
+                rc = bam_rec_tag_int( bam, "NH", *al_count );
+            else
+                rc = KOutMsg( "\tNH:i:%u", *al_count );
+        }
     }
 
     /* OPT SAM-FIELD: NM     SRA-column: EDIT_DISTANCE */
     if ( rc == 0 )
-        rc = KOutMsg( "\tNM:i:%u", ( cgc_output.edit_dist - NM_adjustments ) );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_int( bam, "NM", ( uint32_t )( cgc_output.edit_dist - NM_adjustments ) );
+        else
+            rc = KOutMsg( "\tNM:i:%u", ( cgc_output.edit_dist - NM_adjustments ) );
+    }
 
     /* OPT SAM-FIELD: XS:A:+/-  SRA-column: RNA-SPLICING detected via computation, or from the RNA_ORIENTATION - column */
     if ( rc == 0 )
@@ -1798,10 +2027,11 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
             /* analysis of rna-splicing explicitly requested at the commandline */
             if ( candidates.fwd_matched > 0 || candidates.rev_matched > 0 )
             {
-                if ( candidates.fwd_matched > 0 )
-                    rc = KOutMsg( "\tXS:A:+" );
-                else 
-                    rc = KOutMsg( "\tXS:A:-" );
+                char strand = ( candidates.fwd_matched > 0 ) ? '+' : '-';
+                if ( bam != NULL )
+                    rc = bam_rec_tag_char( bam, "XS", strand );
+                else
+                    rc = KOutMsg( "\tXS:A:%c", strand );
             }
         }
         else
@@ -1815,7 +2045,10 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                                     &rna_orientation, &rna_orientation_len, "RNA_ORIENTATION" );
                 if ( rc == 0 && rna_orientation_len > 0 )
                 {
-                    rc = KOutMsg( "\tXS:A:%c", rna_orientation[ 0 ] );
+                    if ( bam != NULL )
+                        rc = bam_rec_tag_char( bam, "XS", rna_orientation[ 0 ] );
+                    else
+                        rc = KOutMsg( "\tXS:A:%c", rna_orientation[ 0 ] );
                 }
             }
         }
@@ -1831,7 +2064,13 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
         {
             INSDC_coord_len ref_len;
             rc = ReferenceObj_Read( rec->ref, pos, rec->len, alig_ref, &ref_len );
-            if ( rc == 0 )
+            if ( rc == 0 && bam != NULL )
+            {
+                rc = bam_md_tag( bam, cgc_output.p_cigar.ptr, cgc_output.p_cigar.len, /* cigar */
+                        cgc_output.p_read.ptr, cgc_output.p_read.len,                 /* read */
+                        alig_ref, ref_len );                                          /* reference */
+            }
+            else if ( rc == 0 )
             {
                 rc = kout_md_tag_from_cigar_string( cgc_output.p_cigar.ptr, cgc_output.p_cigar.len, /* cigar */
                         cgc_output.p_read.ptr, cgc_output.p_read.len,                               /* read */
@@ -1841,8 +2080,22 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
         }
     }
     
+    /* OPT SAM-FIELD: XR    the intervals of the region-file this alignment starts in */
+    if ( rc == 0 && atx->region_tag != NULL )
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_str( bam, "XR", atx->region_tag, string_size( atx->region_tag ) );
+        else
+            rc = KOutMsg( "\tXR:Z:%s", atx->region_tag );
+    }
+
     if ( rc == 0 )
-        rc = KOutMsg( "\n" );
+        rc = end_of_record( bam );
+
+    if ( bam != NULL )
+        bam_rec_release( bam );
+    if ( temp_cigar != NULL )
+        free( temp_cigar );
 
     /* print a log-info if have to because RNA-splicing is requested and we have not homogeneous bits */
     if ( rna_not_homogeneous_flag )
@@ -1977,17 +2230,327 @@ static rc_t print_alignment_fastx( const samdump_opts * const opts,
 }
 
 
-/* print one record of alignment-information in SAM-format */
+/* -------------------------------------------------------------------------------------------
+    region-batch ( --region-file )
+
+    the positions of one reference arrive in ascending order, two cursors follow them:
+    one into the coalesced ranges ( is the position requested at all? ) and one into
+    the original intervals of the BED-file ( which intervals does the record start in? )
+   -------------------------------------------------------------------------------------------*/
+
+typedef struct region_batch
+{
+    const reference_region * rr;    /* NULL if the reference has no regions */
+    uint32_t range_idx;             /* first range that can still contain the position */
+    uint32_t interval_idx;          /* first interval that can still contain the position */
+    char * tag;                     /* the joined labels for --region-dedup */
+    size_t tag_size;
+} region_batch;
+
+
+static void region_batch_enter_ref( region_batch * rb, const samdump_opts * const opts,
+                                    struct ReferenceObj const * ref_obj )
+{
+    const char * name;
+    rb->rr = NULL;
+    rb->range_idx = 0;
+    rb->interval_idx = 0;
+    /* the user may have named the reference by its name or its seq-id */
+    if ( ReferenceObj_Name( ref_obj, &name ) == 0 )
+        rb->rr = find_region_of_reference( opts, name );
+    if ( rb->rr == NULL && ReferenceObj_SeqId( ref_obj, &name ) == 0 )
+        rb->rr = find_region_of_reference( opts, name );
+}
+
+
+static bool region_batch_requested( region_batch * rb, INSDC_coord_zero pos )
+{
+    uint32_t count;
+    const range * r = NULL;
+
+    if ( rb->rr == NULL )
+        return false;
+    count = VectorLength( &rb->rr->ranges );
+    while ( rb->range_idx < count )
+    {
+        r = VectorGet( &rb->rr->ranges, rb->range_idx );
+        if ( r->end >= ( uint64_t )pos )
+            break;
+        rb->range_idx++;
+    }
+    return ( rb->range_idx < count && r->start <= ( uint64_t )pos );
+}
+
+
+/* returns the next interval at or after *idx that contains pos, NULL if there is none */
+static const region_interval * region_batch_next_hit( region_batch * rb, INSDC_coord_zero pos, uint32_t * idx )
+{
+    uint32_t count = VectorLength( &rb->rr->intervals );
+    for ( ; *idx < count; ++( *idx ) )
+    {
+        const region_interval * iv = VectorGet( &rb->rr->intervals, *idx );
+        if ( iv->start > ( uint64_t )pos )
+            break;
+        if ( iv->end >= ( uint64_t )pos )
+        {
+            ++( *idx );
+            return iv;
+        }
+    }
+    return NULL;
+}
+
+
+static rc_t region_batch_append_label( region_batch * rb, size_t * used, const char * label )
+{
+    size_t len = string_size( label );
+    size_t needed = *used + len + 2;    /* separator and terminator */
+    if ( needed > rb->tag_size )
+    {
+        size_t new_size = ( rb->tag_size < 256 ) ? 256 : rb->tag_size;
+        char * tmp;
+        while ( new_size < needed ) new_size *= 2;
+        tmp = realloc( rb->tag, new_size );
+        if ( tmp == NULL )
+            return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        rb->tag = tmp;
+        rb->tag_size = new_size;
+    }
+    if ( *used > 0 )
+        rb->tag[ ( *used )++ ] = ',';
+    memmove( &rb->tag[ *used ], label, len );
+    *used += len;
+    rb->tag[ *used ] = 0;
+    return 0;
+}
+
+
+static rc_t print_placement( const samdump_opts * const opts,
+                             const char * ref_name,
+                             INSDC_coord_zero pos,
+                             matecache * const mc,
+                             struct rna_splice_dict * splice_dict,
+                             const PlacementRecord *rec,
+                             align_table_context * atx )
+{
+    rc_t rc;
+    if ( opts->output_format == of_sam )
+    {
+        if ( atx->align_table_type == att_evidence )
+            rc = print_alignment_sam_ev( opts, ref_name, pos, rec, atx );
+        else
+            rc = print_alignment_sam_ps( opts, ref_name, pos, mc, splice_dict, rec, atx );
+    }
+    else
+        rc = print_alignment_fastx( opts, ref_name, pos, mc, rec, atx );
+    return rc;
+}
+
+
+/* a record is printed once for every interval of the region-file it starts in, tagged with the
+   label of that interval - or only once tagged with all the labels if --region-dedup is given */
+static rc_t print_placement_batch( const samdump_opts * const opts,
+                                   region_batch * rb,
+                                   const char * ref_name,
+                                   INSDC_coord_zero pos,
+                                   matecache * const mc,
+                                   struct rna_splice_dict * splice_dict,
+                                   const PlacementRecord *rec,
+                                   align_table_context * atx )
+{
+    rc_t rc = 0;
+    uint32_t count = VectorLength( &rb->rr->intervals );
+    uint32_t idx, hits = 0;
+    size_t used = 0;
+    const region_interval * iv;
+
+    /* intervals ending before pos can be skipped for good, the positions do only increase */
+    while ( rb->interval_idx < count )
+    {
+        iv = VectorGet( &rb->rr->intervals, rb->interval_idx );
+        if ( iv->end >= ( uint64_t )pos )
+            break;
+        rb->interval_idx++;
+    }
+
+    idx = rb->interval_idx;
+    while ( rc == 0 && ( iv = region_batch_next_hit( rb, pos, &idx ) ) != NULL )
+    {
+        if ( opts->region_dedup )
+            rc = region_batch_append_label( rb, &used, iv->label );
+        else
+        {
+            atx->region_tag = iv->label;
+            rc = print_placement( opts, ref_name, pos, mc, splice_dict, rec, atx );
+        }
+        hits++;
+    }
+
+    if ( rc == 0 && ( hits == 0 || opts->region_dedup ) )
+    {
+        /* no hit: the record starts in a region given via --aligned-region */
+        atx->region_tag = ( hits > 0 ) ? rb->tag : NULL;
+        rc = print_placement( opts, ref_name, pos, mc, splice_dict, rec, atx );
+    }
+    atx->region_tag = NULL;
+    return rc;
+}
+
+
+/* -------------------------------------------------------------------------------------------
+    the walker does not print a placement as soon as the iterator delivers it, it collects
+    up to PLACEMENT_BATCH_SIZE placements first. The row-ids of the batch are then read
+    column by column in ascending order ( col_prefetch.c ), instead of jumping around
+    in the alignment-table cell by cell. The placements are printed in the original order.
+   -------------------------------------------------------------------------------------------*/
+
+#define PLACEMENT_BATCH_SIZE 4096
+#define PLACEMENT_BATCH_CONTEXTS 8
+
+typedef struct placement_batch_entry
+{
+    const PlacementRecord * rec;
+    align_table_context * atx;
+    INSDC_coord_zero pos;
+} placement_batch_entry;
+
+
+typedef struct placement_batch
+{
+    placement_batch_entry * entries;
+    uint32_t count;
+
+    /* the table-contexts that have rows in this batch */
+    align_table_context * contexts[ PLACEMENT_BATCH_CONTEXTS ];
+    uint32_t context_count;
+} placement_batch;
+
+
+static rc_t make_align_table_prefetch( align_table_context * atx )
+{
+    rc_t rc = make_col_prefetch( &atx->prefetch, atx->cmn.cursor );
+    if ( rc == 0 )
+    {
+        const uint32_t cols[] =
+        {
+            atx->cmn.seq_spot_id_idx, atx->cmn.cigar_idx, atx->cmn.cigar_len_idx, atx->cmn.read_idx,
+            atx->cmn.read_len_idx, atx->cmn.edit_dist_idx, atx->cmn.seq_spot_group_idx, atx->cmn.seq_read_id_idx,
+            atx->cmn.raw_read_idx, atx->cmn.sam_quality_idx, atx->cmn.ref_orientation_idx,
+            atx->cmn.read_filter_idx, atx->cmn.al_count_idx,
+            atx->sam_flags_idx, atx->mate_align_id_idx, atx->mate_ref_name_idx, atx->mate_ref_pos_idx,
+            atx->tlen_idx, atx->rna_orientation_idx, atx->al_group_idx, atx->lnk_group_idx
+        };
+        uint32_t i;
+        for ( i = 0; i < ( sizeof cols / sizeof cols[ 0 ] ) && rc == 0; ++i )
+            rc = col_prefetch_add_column( atx->prefetch, cols[ i ] );
+        if ( rc != 0 )
+        {
+            release_col_prefetch( atx->prefetch );
+            atx->prefetch = NULL;
+        }
+    }
+    return rc;
+}
+
+
+static rc_t placement_batch_add_row( placement_batch * batch, align_table_context * atx, int64_t row_id )
+{
+    rc_t rc = 0;
+    uint32_t i;
+
+    if ( atx->align_table_type == att_evidence )
+        return 0;   /* the evidence-tables are read via a sub-cursor, not prefetched */
+
+    for ( i = 0; i < batch->context_count; ++i )
+    {
+        if ( batch->contexts[ i ] == atx )
+            break;
+    }
+    if ( i == batch->context_count )
+    {
+        if ( batch->context_count == PLACEMENT_BATCH_CONTEXTS )
+            return 0;   /* very unlikely: the rows of this context are read directly */
+        if ( atx->prefetch == NULL )
+            rc = make_align_table_prefetch( atx );
+        if ( rc == 0 )
+            batch->contexts[ batch->context_count++ ] = atx;
+    }
+    if ( rc == 0 )
+        rc = col_prefetch_add_row( atx->prefetch, row_id );
+    return rc;
+}
+
+
+static rc_t flush_placement_batch( const samdump_opts * const opts,
+                                   placement_batch * batch,
+                                   const char * ref_name,
+                                   matecache * const mc,
+                                   struct rna_splice_dict * splice_dict,
+                                   region_batch * rb )
+{
+    rc_t rc = 0;
+    uint32_t i;
+
+    /* --no-prefetch: the formatter reads the cells from the cursors */
+    for ( i = 0; i < batch->count && rc == 0 && opts->use_prefetch; ++i )
+        rc = placement_batch_add_row( batch, batch->entries[ i ].atx, batch->entries[ i ].rec->id );
+
+    for ( i = 0; i < batch->context_count && rc == 0; ++i )
+    {
+        rc = col_prefetch_load( batch->contexts[ i ]->prefetch );
+        if ( rc == 0 )
+            col_prefetch_activate( batch->contexts[ i ]->prefetch );
+    }
+
+    for ( i = 0; i < batch->count; ++i )
+    {
+        placement_batch_entry * e = &batch->entries[ i ];
+        if ( rc == 0 )
+            rc = Quitting ();
+        if ( rc == 0 )
+        {
+            if ( rb != NULL )
+                rc = print_placement_batch( opts, rb, ref_name, e->pos, mc, splice_dict, e->rec, e->atx );
+            else
+                rc = print_placement( opts, ref_name, e->pos, mc, splice_dict, e->rec, e->atx );
+        }
+        PlacementRecordWhack ( e->rec );
+    }
+    batch->count = 0;
+
+    for ( i = 0; i < batch->context_count; ++i )
+    {
+        col_prefetch_deactivate( batch->contexts[ i ]->prefetch );
+        col_prefetch_clear( batch->contexts[ i ]->prefetch );
+    }
+    batch->context_count = 0;
+    return rc;
+}
+
+
+static void discard_placement_batch( placement_batch * batch )
+{
+    uint32_t i;
+    for ( i = 0; i < batch->count; ++i )
+        PlacementRecordWhack ( batch->entries[ i ].rec );
+    batch->count = 0;
+}
+
+
+/* collect the records of one position, the batch is printed when it is full */
 static rc_t walk_position( const samdump_opts * const opts,
                            PlacementSetIterator * const set_iter,
                            const char * ref_name,
                            INSDC_coord_zero pos,
                            matecache * const mc,
                            struct rna_splice_dict * splice_dict,
+                           region_batch * rb,
+                           placement_batch * batch,
                            INSDC_coord_zero first_pos,
                            INSDC_coord_len len )
 {
     rc_t rc = 0;
+    bool requested = ( rb == NULL || region_batch_requested( rb, pos ) );
     while ( rc == 0 )
     {
         rc = Quitting ();
@@ -2004,6 +2567,7 @@ static rc_t walk_position( const samdump_opts * const opts,
             }
             else
             {
+                bool keep = false;
 
 #if _DEBUGGING
                 if ( opts->perf_log != NULL )
@@ -2012,8 +2576,9 @@ static rc_t walk_position( const samdump_opts * const opts,
 
                 /* We have to do this here, becasue the nature of the iterator is to return all alignments that
                    touch ( stick into ) the requested interval. But: sam-dump has to dump alignments that
-                   !! start !! in the requested interval. */
-                if ( pos >= first_pos )
+                   !! start !! in the requested interval. In region-batch mode the window can span the gap
+                   between two ranges, alignments starting in such a gap are not requested. */
+                if ( pos >= first_pos && requested )
                 {
                     align_table_context * atx = PlacementRecord_get_ext_data_ptr( rec, placementRecordExtension0 );
                     if ( atx == NULL )
@@ -2023,20 +2588,17 @@ static rc_t walk_position( const samdump_opts * const opts,
                     }
                     else
                     {
-                        if ( opts->output_format == of_sam )
-                        {
-                            if ( atx->align_table_type == att_evidence )
-                                rc = print_alignment_sam_ev( opts, ref_name, pos, rec, atx );
-                            else
-                                rc = print_alignment_sam_ps( opts, ref_name, pos, mc, splice_dict, rec, atx );
-                        }
-                        else
-                            rc = print_alignment_fastx( opts, ref_name, pos, mc, rec, atx );
+                        placement_batch_entry * e = &batch->entries[ batch->count++ ];
+                        e->rec = rec;
+                        e->atx = atx;
+                        e->pos = pos;
+                        keep = true;
+                        if ( batch->count == PLACEMENT_BATCH_SIZE )
+                            rc = flush_placement_batch( opts, batch, ref_name, mc, splice_dict, rb );
                     }
                 }
-                PlacementRecordWhack ( rec );
-
-
+                if ( !keep )
+                    PlacementRecordWhack ( rec );
             }
         }
     }
@@ -2050,6 +2612,8 @@ static rc_t walk_window( const samdump_opts * const opts,
                          const char * ref_name,
                          matecache * const mc,
                          struct rna_splice_dict * splice_dict,
+                         region_batch * rb,
+                         placement_batch * batch,
                          INSDC_coord_zero first_pos,
                          INSDC_coord_len len )
 {
@@ -2070,30 +2634,37 @@ static rc_t walk_window( const samdump_opts * const opts,
             }
             else
             {
-                rc = walk_position( opts, set_iter, ref_name, pos, mc, splice_dict, first_pos, len );
+                rc = walk_position( opts, set_iter, ref_name, pos, mc, splice_dict, rb, batch, first_pos, len );
             }
         }
     }
     if ( GetRCState( rc ) == rcDone ) rc = 0;
+
+    /* print what is left in the batch - or release the records if we failed */
+    if ( rc == 0 )
+        rc = flush_placement_batch( opts, batch, ref_name, mc, splice_dict, rb );
+    else
+        discard_placement_batch( batch );
     return rc;
 }
 
 
-static rc_t walk_reference( const samdump_opts * const opts,
-                            PlacementSetIterator * const set_iter,
-                            struct ReferenceObj const * ref_obj,
-                            const char * ref_name,
-                            matecache * const mc )
+static rc_t walk_windows( const samdump_opts * const opts,
+                          PlacementSetIterator * const set_iter,
+                          const char * ref_name,
+                          matecache * const mc,
+                          struct rna_splice_dict * splice_dict,
+                          region_batch * rb )
 {
+    placement_batch batch;
     rc_t rc = 0;
-    struct rna_splice_dict * splice_dict = NULL;
 
-    if ( opts->rna_splicing )
+    memset( &batch, 0, sizeof batch );
+    batch.entries = malloc( PLACEMENT_BATCH_SIZE * sizeof batch.entries[ 0 ] );
+    if ( batch.entries == NULL )
     {
-        splice_dict = make_rna_splice_dict();
-        /* rna-splice-log */
-        if ( opts->rna_splice_log != NULL )
-            rna_splice_log_enter_ref( opts->rna_splice_log, ref_name, ref_obj );
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot allocate placement-batch" );
     }
 
     while ( rc == 0 )
@@ -2112,10 +2683,37 @@ static rc_t walk_reference( const samdump_opts * const opts,
                 }
             }
             else
-                rc = walk_window( opts, set_iter, ref_name, mc, splice_dict, first_pos, len );
+                rc = walk_window( opts, set_iter, ref_name, mc, splice_dict, rb, &batch, first_pos, len );
         }
     }
     if ( GetRCState( rc ) == rcDone ) rc = 0;
+    free( batch.entries );
+    return rc;
+}
+
+
+static rc_t walk_reference( const samdump_opts * const opts,
+                            PlacementSetIterator * const set_iter,
+                            struct ReferenceObj const * ref_obj,
+                            const char * ref_name,
+                            matecache * const mc,
+                            region_batch * rb )
+{
+    rc_t rc;
+    struct rna_splice_dict * splice_dict = NULL;
+
+    if ( rb != NULL )
+        region_batch_enter_ref( rb, opts, ref_obj );
+
+    if ( opts->rna_splicing )
+    {
+        splice_dict = make_rna_splice_dict();
+        /* rna-splice-log */
+        if ( opts->rna_splice_log != NULL )
+            rna_splice_log_enter_ref( opts->rna_splice_log, ref_name, ref_obj );
+    }
+
+    rc = walk_windows( opts, set_iter, ref_name, mc, splice_dict, rb );
 
     if ( rc == 0 && mc != NULL && opts->use_mate_cache )
         rc = matecache_clear_same_ref( mc );
@@ -2137,6 +2735,14 @@ static rc_t walk_placements( const samdump_opts * const opts,
                              matecache * const mc )
 {
     rc_t rc = 0;
+    region_batch batch;
+    region_batch * rb = NULL;
+
+    if ( opts->region_file != NULL )
+    {
+        memset( &batch, 0, sizeof batch );
+        rb = &batch;
+    }
     while ( rc == 0 )
     {
         struct ReferenceObj const * ref_obj;
@@ -2159,7 +2765,7 @@ static rc_t walk_placements( const samdump_opts * const opts,
                         perf_log_start_sub_section( opts->perf_log, ref_name );
 #endif
 
-                    rc = walk_reference( opts, set_iter, ref_obj, ref_name, mc );
+                    rc = walk_reference( opts, set_iter, ref_obj, ref_name, mc, rb );
 
 #if _DEBUGGING
                     if ( opts->perf_log != NULL )
@@ -2185,6 +2791,9 @@ static rc_t walk_placements( const samdump_opts * const opts,
         }
     }
 
+    if ( rb != NULL )
+        free( rb->tag );
+
     if ( GetRCState( rc ) == rcDone )
         rc = 0;
     return rc;
@@ -2358,6 +2967,286 @@ static rc_t print_selected_aligned_spots( const samdump_opts * const opts,
 }
 
 
+/* -------------------------------------------------------------------------------------------
+    multi-threaded dumping of all aligned spots ( --threads N )
+
+    every reference is cut into windows of ALIGNED_CHUNK_LEN bases, each window is one job.
+    a worker-thread creates its own reference-list, placement-set-iterator and cursors for
+    the window, the text it prints is captured per job and written in the original order
+    by the dump-pool ( dump_pool.c / out_redir.c ).
+   -------------------------------------------------------------------------------------------*/
+
+#define ALIGNED_CHUNK_LEN ( 1024 * 1024 )
+
+typedef struct aligned_pool_ctx
+{
+    const samdump_opts * opts;
+    const input_files * ifs;
+    matecache * mc;
+    const AlignMgr * a_mgr;
+} aligned_pool_ctx;
+
+
+typedef struct aligned_worker
+{
+    const aligned_pool_ctx * pctx;
+    const ReferenceList * reflist;  /* ReferenceObj's cannot be shared between threads */
+    uint32_t reflist_db_idx;
+} aligned_worker;
+
+
+typedef struct aligned_job
+{
+    uint32_t db_idx;
+    uint32_t ref_idx;
+    INSDC_coord_zero start;
+    INSDC_coord_len len;
+} aligned_job;
+
+
+static rc_t CC aligned_worker_start( void * pool_data, void ** worker_data )
+{
+    rc_t rc = 0;
+    aligned_worker * w = calloc( 1, sizeof * w );
+    if ( w == NULL )
+    {
+        rc = RC( rcExe, rcThread, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create aligned worker" );
+    }
+    else
+        w->pctx = pool_data;
+    *worker_data = w;
+    return rc;
+}
+
+
+static void CC aligned_worker_end( void * worker_data )
+{
+    aligned_worker * w = worker_data;
+    if ( w != NULL )
+    {
+        if ( w->reflist != NULL )
+            ReferenceList_Release( w->reflist );
+        free( w );
+    }
+}
+
+
+static void CC aligned_job_release( void * job )
+{
+    free( job );
+}
+
+
+static rc_t get_ref_name( const samdump_opts * const opts,
+                          struct ReferenceObj const * ref_obj,
+                          const char ** ref_name )
+{
+    rc_t rc;
+    if ( opts->use_seqid_as_refname )
+    {
+        rc = ReferenceObj_SeqId( ref_obj, ref_name );
+        if ( rc != 0 )
+            (void)LOGERR( klogInt, rc, "ReferenceObj_SeqId() failed" );
+    }
+    else
+    {
+        rc = ReferenceObj_Name( ref_obj, ref_name );
+        if ( rc != 0 )
+            (void)LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
+    }
+    return rc;
+}
+
+
+static rc_t aligned_worker_reflist( aligned_worker * w, const input_database * ids )
+{
+    rc_t rc = 0;
+    if ( w->reflist == NULL || w->reflist_db_idx != ids->db_idx )
+    {
+        if ( w->reflist != NULL )
+        {
+            ReferenceList_Release( w->reflist );
+            w->reflist = NULL;
+        }
+        rc = ReferenceList_MakeDatabase( &w->reflist, ids->db, w->pctx->ifs->reflist_options, 0, NULL, 0 );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cannot create reflist for '$(t)'", "t=%s", ids->path ) );
+            w->reflist = NULL;
+        }
+        else
+            w->reflist_db_idx = ids->db_idx;
+    }
+    return rc;
+}
+
+
+static rc_t CC aligned_job_run( void * job, void * worker_data )
+{
+    aligned_job * j = job;
+    aligned_worker * w = worker_data;
+    const samdump_opts * opts = w->pctx->opts;
+    const input_database * ids = VectorGet( &w->pctx->ifs->dbs, j->db_idx );
+    rc_t rc = ( ids == NULL ) ? RC( rcExe, rcNoTarg, rcReading, rcItem, rcNotFound ) : 0;
+
+    if ( rc == 0 )
+        rc = aligned_worker_reflist( w, ids );
+    if ( rc == 0 )
+    {
+        const ReferenceObj * ref_obj;
+        rc = ReferenceList_Get( w->reflist, &ref_obj, j->ref_idx );
+        if ( rc == 0 && ref_obj != NULL )
+        {
+            PlacementSetIterator * set_iter;
+            rc = AlignMgrMakePlacementSetIterator( w->pctx->a_mgr, &set_iter );
+            if ( rc != 0 )
+            {
+                (void)LOGERR( klogErr, rc, "cannot create PlacementSetIterator" );
+            }
+            else
+            {
+                Vector context_list;
+                VectorInit ( &context_list, 0, 5 );
+
+                rc = add_pl_iters( opts, set_iter, ref_obj, ids, j->start, j->len, NULL, &context_list );
+                if ( rc == 0 )
+                {
+                    struct ReferenceObj const * iter_ref_obj;
+                    rc = PlacementSetIteratorNextReference( set_iter, NULL, NULL, &iter_ref_obj );
+                    if ( rc == 0 && iter_ref_obj != NULL )
+                    {
+                        const char * ref_name = NULL;
+                        rc = get_ref_name( opts, iter_ref_obj, &ref_name );
+                        /* the rna-splice-dict is only needed for the rna-splice-log,
+                           which is not available in multi-threaded mode */
+                        if ( rc == 0 )
+                            rc = walk_windows( opts, set_iter, ref_name, w->pctx->mc, NULL, NULL );
+                    }
+                    else if ( GetRCState( rc ) == rcDone )
+                        rc = 0;     /* no alignments in this window */
+                    else if ( rc != 0 )
+                        (void)LOGERR( klogInt, rc, "PlacementSetIteratorNextReference() failed" );
+                }
+                VectorWhack ( &context_list, destroy_align_table_context, NULL );
+                PlacementSetIteratorRelease( set_iter );
+            }
+            ReferenceObj_Release( ref_obj );
+        }
+    }
+    return rc;
+}
+
+
+static rc_t submit_aligned_jobs( const input_database * const ids, struct dump_pool * pool )
+{
+    uint32_t refobj_count;
+    rc_t rc = ReferenceList_Count( ids->reflist, &refobj_count );
+    if ( rc == 0 )
+    {
+        uint32_t ref_idx;
+        for ( ref_idx = 0; ref_idx < refobj_count && rc == 0; ++ref_idx )
+        {
+            const ReferenceObj * ref_obj;
+            rc = ReferenceList_Get( ids->reflist, &ref_obj, ref_idx );
+            if ( rc == 0 && ref_obj != NULL )
+            {
+                INSDC_coord_len ref_len;
+                rc = ReferenceObj_SeqLength( ref_obj, &ref_len );
+                ReferenceObj_Release( ref_obj );
+                if ( rc == 0 )
+                {
+                    INSDC_coord_len start;
+                    for ( start = 0; start < ref_len && rc == 0; start += ALIGNED_CHUNK_LEN )
+                    {
+                        aligned_job * job = malloc( sizeof * job );
+                        if ( job == NULL )
+                        {
+                            rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                            (void)LOGERR( klogErr, rc, "cannot create aligned job" );
+                        }
+                        else
+                        {
+                            job->db_idx = ids->db_idx;
+                            job->ref_idx = ref_idx;
+                            job->start = start;
+                            job->len = ( ref_len - start < ALIGNED_CHUNK_LEN ) ? ref_len - start : ALIGNED_CHUNK_LEN;
+                            rc = dump_pool_submit( pool, job ); /* takes ownership of the job */
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
+/*
+   the user did not specify regions, print all alignments from all input-files
+   this is strategy #0 ( one reference at a time ) spread over worker-threads,
+   the output is identical to print_all_aligned_spots_0()
+*/
+static rc_t print_all_aligned_spots_mt( const samdump_opts * const opts,
+                                        const input_files * const ifs,
+                                        matecache * const mc,
+                                        const AlignMgr * const a_mgr )
+{
+    rc_t rc;
+    aligned_pool_ctx pctx;
+    dump_pool_callbacks cb;
+    struct dump_pool * pool;
+
+    pctx.opts = opts;
+    pctx.ifs = ifs;
+    pctx.mc = mc;
+    pctx.a_mgr = a_mgr;
+
+    cb.on_worker_start = aligned_worker_start;
+    cb.on_job = aligned_job_run;
+    cb.on_worker_end = aligned_worker_end;
+    cb.release_job = aligned_job_release;
+    cb.pool_data = &pctx;
+
+    rc = make_dump_pool( &pool, opts->num_threads, &cb );
+    if ( rc == 0 )
+    {
+        rc_t rc2;
+        uint32_t db_idx;
+        for ( db_idx = 0; db_idx < ifs->database_count && rc == 0; ++db_idx )
+        {
+            const input_database * ids = VectorGet( &ifs->dbs, db_idx );
+            if ( ids != NULL )
+                rc = submit_aligned_jobs( ids, pool );
+        }
+        rc2 = dump_pool_finish( pool );
+        if ( rc == 0 )
+            rc = rc2;
+    }
+
+    /* the same-ref entries are not cleared per reference, because the windows of
+       different references are processed at the same time */
+    if ( rc == 0 && mc != NULL && opts->use_mate_cache )
+        rc = matecache_clear_same_ref( mc );
+    return rc;
+}
+
+
+/* not every mode can be spread over worker-threads */
+static bool use_worker_threads( const samdump_opts * const opts )
+{
+    bool res = ( opts->num_threads > 0 &&
+                 opts->region_count == 0 &&
+                 opts->dump_mode == dm_one_ref_at_a_time &&
+                 opts->rna_splice_log == NULL );
+#if _DEBUGGING
+    if ( opts->perf_log != NULL )
+        res = false;
+#endif
+    return res;
+}
+
+
 /*
    this is called from sam-dump3.c, it prepares the iterators and then walks them
    ---> only entry into this module <--- 
@@ -2385,10 +3274,15 @@ rc_t print_aligned_spots( const samdump_opts * const opts,
         if ( opts->region_count == 0 )
         {
             /* the user did not specify regions to be printed ==> print all alignments */
-            switch( opts->dump_mode )
+            if ( use_worker_threads( opts ) )
+                rc = print_all_aligned_spots_mt( opts, ifs, mc, a_mgr );
+            else
             {
-                case dm_one_ref_at_a_time : rc = print_all_aligned_spots_0( opts, ifs, mc, a_mgr ); break;
-                case dm_prepare_all_refs  : rc = print_all_aligned_spots_1( opts, ifs, mc, a_mgr ); break;
+                switch( opts->dump_mode )
+                {
+                    case dm_one_ref_at_a_time : rc = print_all_aligned_spots_0( opts, ifs, mc, a_mgr ); break;
+                    case dm_prepare_all_refs  : rc = print_all_aligned_spots_1( opts, ifs, mc, a_mgr ); break;
+                }
             }
         }
         else
@@ -29,10 +29,16 @@
 #include "perf_log.h"
 
 #include <klib/time.h>
+#include <klib/printf.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+#include <kfs/filetools.h>
 #include <align/quality-quantizer.h>
 #include <sysalloc.h>
 
 #define CURSOR_CACHE_SIZE 256*1024*1024
+#define MAX_NUM_THREADS 64
+#define DFLT_MATE_CACHE_MEM_MB 1024
 
 /* =========================================================================================== */
 
@@ -101,7 +107,10 @@ static reference_region * make_reference_region( const char *name )
             res = NULL;
         }
         else
+        {
             VectorInit ( &res->ranges, 0, 5 );
+            VectorInit ( &res->intervals, 0, 5 );
+        }
     }
     return res;
 }
@@ -227,10 +236,61 @@ static void CC release_range_wrapper( void * item, void * data )
 }
 
 
+static int64_t CC cmp_interval_wrapper( const void *item, const void *n )
+{
+    const region_interval * a = item;
+    const region_interval * b = n;
+    if ( a->start < b->start )
+        return -1;
+    else if ( a->start > b->start )
+        return 1;
+    else if ( a->end < b->end )
+        return -1;
+    else if ( a->end > b->end )
+        return 1;
+    return 0;
+}
+
+
+static rc_t add_ref_region_interval( reference_region * self, const uint64_t start, const uint64_t end,
+                                     const char * label )
+{
+    rc_t rc = 0;
+    region_interval * iv = calloc( 1, sizeof *iv );
+    if ( iv == NULL )
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        iv->start = start;
+        iv->end = end;
+        iv->label = string_dup_measure( label, NULL );
+        if ( iv->label == NULL )
+            rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        else
+            rc = VectorInsert ( &self->intervals, iv, NULL, cmp_interval_wrapper );
+        if ( rc != 0 )
+        {
+            free( ( void * )iv->label );
+            free( iv );
+        }
+    }
+    return rc;
+}
+
+
+static void CC release_interval_wrapper( void * item, void * data )
+{
+    region_interval * iv = item;
+    free( ( void * )iv->label );
+    free( iv );
+}
+
+
 static void free_reference_region( reference_region * self )
 {
     free( (void*)self->name );
     VectorWhack ( &self->ranges, release_range_wrapper, NULL );
+    VectorWhack ( &self->intervals, release_interval_wrapper, NULL );
     free( self );
 }
 
@@ -250,7 +310,8 @@ static void check_ref_region_ranges( reference_region * self )
             if ( remove )
             {
                 range *r;
-                a->end = b->end;
+                if ( b->end > a->end )
+                    a->end = b->end;
                 VectorRemove ( &self->ranges, i, (void**)&r );
                 free( r );
                 n--;
@@ -346,6 +407,21 @@ static rc_t add_refrange( BSTree * regions, const char * name, const uint64_t st
 }
 
 
+/* start and end are 1-based and inclusive, an end of 0 reaches to the end of the reference */
+static rc_t add_refrange_1based( BSTree * regions, const char * name, uint64_t start, uint64_t end )
+{
+    uint64_t start_0based = ( start > 0 ) ? start - 1 : 0;
+    uint64_t end_0based = ( end > 0 ) ? end - 1 : RANGE_OPEN_END;
+    if ( end_0based < start_0based )
+    {
+        uint64_t temp = end_0based;
+        end_0based = start_0based;
+        start_0based = temp;
+    }
+    return add_refrange( regions, name, start_0based, end_0based );
+}
+
+
 static rc_t parse_and_add_region( BSTree * regions, const char * s )
 {
     rc_t rc = 0;
@@ -355,17 +431,7 @@ static rc_t parse_and_add_region( BSTree * regions, const char * s )
     if ( name[ 0 ] == 0 )
         rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
     else
-    {
-        uint64_t start_0based = ( start > 0 ) ? start - 1 : 0;
-        uint64_t end_0based = ( end > 0 ) ? end - 1 : 0;
-        if ( end_0based != 0 && end_0based < start_0based )
-        {
-            uint64_t temp = end_0based;
-            end_0based = start_0based;
-            start_0based = temp;
-        }
-        rc = add_refrange( regions, name, start_0based, end_0based );
-    }
+        rc = add_refrange_1based( regions, name, start, end );
     return rc;
 }
 
@@ -552,16 +618,158 @@ static rc_t get_bool_option( Args * args, const char * name, bool *value )
 }
 
 
+/* splits the next whitespace-separated column off a BED-line */
+static const char * bed_column( const char ** s, size_t * len )
+{
+    const char * p = *s;
+    const char * res;
+    while ( *p == ' ' || *p == '\t' ) ++p;
+    res = p;
+    while ( *p != 0 && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' ) ++p;
+    *len = ( p - res );
+    *s = p;
+    return ( *len > 0 ) ? res : NULL;
+}
+
+
+static bool bed_number( const char * s, size_t len, uint64_t * value )
+{
+    char * end;
+    if ( len == 0 || s[ 0 ] < '0' || s[ 0 ] > '9' )
+        return false;
+    *value = strtou64( s, &end, 10 );
+    return ( ( size_t )( end - s ) == len );
+}
+
+
+/* one line of a BED-file: chrom start end [ name ... ], start is 0-based, end is exclusive */
+static rc_t parse_and_add_bed_line( BSTree * regions, const char * line, uint32_t line_nr )
+{
+    rc_t rc = 0;
+    const char * s = line;
+    size_t chrom_len, start_len, end_len, name_len;
+    const char * chrom = bed_column( &s, &chrom_len );
+
+    if ( chrom == NULL || chrom[ 0 ] == '#' ||
+         ( chrom_len == 5 && memcmp( chrom, "track", 5 ) == 0 ) ||
+         ( chrom_len == 7 && memcmp( chrom, "browser", 7 ) == 0 ) )
+        return 0;   /* empty line, comment or header-line */
+    else
+    {
+        const char * start_s = bed_column( &s, &start_len );
+        const char * end_s = bed_column( &s, &end_len );
+        const char * name = bed_column( &s, &name_len );
+        uint64_t start, end;
+
+        if ( start_s == NULL || end_s == NULL ||
+             !bed_number( start_s, start_len, &start ) ||
+             !bed_number( end_s, end_len, &end ) ||
+             chrom_len >= 4096 )
+        {
+            rc = RC( rcApp, rcArgv, rcParsing, rcFormat, rcInvalid );
+            (void)PLOGERR( klogErr, ( klogErr, rc, "invalid line #$(l) in region-file", "l=%u", line_nr ) );
+        }
+        else if ( start >= end )
+        {
+            rc = RC( rcApp, rcArgv, rcParsing, rcRange, rcEmpty );
+            (void)PLOGERR( klogErr, ( klogErr, rc, "empty interval $(s)-$(e) on line #$(l) in region-file",
+                                      "s=%lu,e=%lu,l=%u", start, end, line_nr ) );
+        }
+        else
+        {
+            char ref[ 4096 ];
+            char label[ 4096 ];
+            /* 0-based half-open in the BED-file, 1-based inclusive like --region */
+            uint64_t first = start + 1;
+            uint64_t last = end;
+
+            string_copy( ref, sizeof ref, chrom, chrom_len );
+            if ( name != NULL && name_len < sizeof label )
+                string_copy( label, sizeof label, name, name_len );
+            else
+                string_printf( label, sizeof label, NULL, "%s:%lu-%lu", ref, first, last );
+
+            rc = add_refrange_1based( regions, ref, first, last );
+            if ( rc == 0 )
+                rc = add_ref_region_interval( find_reference_region( regions, ref ), first - 1, last - 1, label );
+            if ( rc != 0 )
+            {
+                (void)PLOGERR( klogErr, ( klogErr, rc, "cannot store line #$(l) of region-file", "l=%u", line_nr ) );
+            }
+        }
+    }
+    return rc;
+}
+
+
+static rc_t load_region_file( BSTree * regions, const char * filename )
+{
+    KDirectory * dir;
+    rc_t rc = KDirectoryNativeDir ( &dir );
+    if ( rc != 0 )
+    {
+        (void)PLOGERR( klogErr, ( klogErr, rc, "cant created native directory for file '$(t)'", "t=%s", filename ) );
+    }
+    else
+    {
+        const struct KFile * f;
+        rc = KDirectoryOpenFileRead ( dir, &f, "%s", filename );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cant open file '$(t)'", "t=%s", filename ) );
+        }
+        else
+        {
+            VNamelist * lines;
+            rc = VNamelistMake ( &lines, 1024 );
+            if ( rc == 0 )
+            {
+                rc = LoadKFileToNameList( f, lines );
+                if ( rc != 0 )
+                {
+                    (void)PLOGERR( klogErr, ( klogErr, rc, "cant load file '$(t)' into container", "t=%s", filename ) );
+                }
+                else
+                {
+                    uint32_t i, count;
+                    rc = VNameListCount ( lines, &count );
+                    for ( i = 0; i < count && rc == 0; ++i )
+                    {
+                        const char * line;
+                        rc = VNameListGet ( lines, i, &line );
+                        if ( rc == 0 )
+                            rc = parse_and_add_bed_line( regions, line, i + 1 );
+                    }
+                }
+                VNamelistRelease ( lines );
+            }
+            KFileRelease ( f );
+        }
+        KDirectoryRelease ( dir );
+    }
+    return rc;
+}
+
+
 static rc_t gather_region_options( Args * args, samdump_opts * opts )
 {
-    uint32_t count;
+    uint32_t count, file_count;
 
     rc_t rc = ArgsOptionCount( args, OPT_REGION, &count );
     if ( rc != 0 )
     {
         (void)PLOGERR( klogErr, ( klogErr, rc, "error counting comandline option '$(t)'", "t=%s", OPT_REGION ) );
+        return rc;
     }
-    else if ( count > 0 )
+
+    rc = ArgsOptionCount( args, OPT_REGION_FILE, &file_count );
+    if ( rc != 0 )
+    {
+        (void)PLOGERR( klogErr, ( klogErr, rc, "error counting comandline option '$(t)'", "t=%s", OPT_REGION_FILE ) );
+        return rc;
+    }
+
+    if ( count > 0 || file_count > 0 )
     {
         uint32_t i;
 
@@ -577,6 +785,23 @@ static rc_t gather_region_options( Args * args, samdump_opts * opts )
             else
                 rc = parse_and_add_region( &opts->regions, s );
         }
+        if ( rc == 0 && file_count > 0 )
+        {
+            const char * s;
+            rc = ArgsOptionValue( args, OPT_REGION_FILE, 0, (const void **)&s );
+            if ( rc != 0 )
+            {
+                (void)PLOGERR( klogErr, ( klogErr, rc, "error retrieving comandline option '$(t)'", "t=%s", OPT_REGION_FILE ) );
+            }
+            else
+            {
+                opts->region_file = string_dup_measure( s, NULL );
+                if ( opts->region_file == NULL )
+                    rc = RC( rcExe, rcNoTarg, rcValidating, rcMemory, rcExhausted );
+                else
+                    rc = load_region_file( &opts->regions, opts->region_file );
+            }
+        }
         if ( rc == 0 )
         {
             check_ref_regions( &opts->regions );
@@ -699,6 +924,10 @@ static rc_t gather_flag_options( Args * args, samdump_opts * opts )
     rc = get_bool_option( args, OPT_HIDE_IDENT, &opts->print_matches_as_equal_sign );
     if ( rc != 0 ) return rc;
 
+    /* print records hitting more than one interval of the region-file only once */
+    rc = get_bool_option( args, OPT_REGION_DEDUP, &opts->region_dedup );
+    if ( rc != 0 ) return rc;
+
     {
         bool recalc_header, dont_print_header;
 
@@ -790,6 +1019,11 @@ static rc_t gather_flag_options( Args * args, samdump_opts * opts )
     if ( rc != 0 ) return rc;
     opts->use_mate_cache = !opts->use_mate_cache;
 
+    /* do we prefetch the alignment-rows of the placement-walker */
+    rc = get_bool_option( args, OPT_NO_PREFETCH, &opts->use_prefetch );
+    if ( rc != 0 ) return rc;
+    opts->use_prefetch = !opts->use_prefetch;
+
     /* do we use a mate-cache */
     rc = get_bool_option( args, OPT_LEGACY, &opts->force_legacy );
     if ( rc != 0 ) return rc;
@@ -813,6 +1047,10 @@ static rc_t gather_flag_options( Args * args, samdump_opts * opts )
     
     /* do we have to generate the MD-flag */ 
     rc = get_bool_option( args, OPT_MD_FLAG, &opts->with_md_flag );
+
+    /* do we write BAM instead of SAM */
+    if ( rc == 0 )
+        rc = get_bool_option( args, OPT_BAM, &opts->output_bam );
 	
     /* forcing to use the legacy code in case of Evidence-Dnb was requested */
     if ( rc == 0 )
@@ -949,6 +1187,22 @@ static rc_t gather_int_options( Args * args, samdump_opts * opts )
     if ( rc == 0 )
         rc = get_uint32_option( args, OPT_RNA_SPLICEL, 0, &opts->rna_splice_level, true );
 
+    if ( rc == 0 )
+    {
+        uint32_t mb;
+        /* 0 is valid: the smallest tables, everything beyond them is spilled */
+        rc = get_uint32_option( args, OPT_MATE_CACHE_MEM, DFLT_MATE_CACHE_MEM_MB, &mb, false );
+        if ( rc == 0 )
+            opts->mate_cache_mem = ( size_t )mb * 1024 * 1024;
+    }
+
+    if ( rc == 0 )
+    {
+        rc = get_uint32_option( args, OPT_THREADS, 0, &opts->num_threads, false );
+        if ( rc == 0 && opts->num_threads > MAX_NUM_THREADS )
+            opts->num_threads = MAX_NUM_THREADS;
+    }
+
     return rc;
 }
 
@@ -1006,6 +1260,20 @@ static rc_t gather_string_options( Args * args, samdump_opts * opts )
         }
     }
 
+    if ( rc == 0 )
+    {
+        rc = get_str_option( args, OPT_TEMP, &s );
+        if ( rc == 0 && s != NULL )
+        {
+            opts->temp_dir = string_dup_measure( s, NULL );
+            if ( opts->temp_dir == NULL )
+            {
+                rc = RC( rcExe, rcNoTarg, rcValidating, rcMemory, rcExhausted );
+                (void)LOGERR( klogErr, rc, "error storing TEMP" );
+            }
+        }
+    }
+
     if ( rc == 0 )
     {
         rc = ArgsOptionCount( args, OPT_HDR_COMMENT, &count );
@@ -1116,6 +1384,21 @@ static rc_t gather_string_options( Args * args, samdump_opts * opts )
     }
 #endif
 
+    rc = get_str_option( args, OPT_BAM_INDEX, &s );
+    if ( rc == 0 && s != NULL )
+    {
+        if ( cmp_pchar( s, "bai" ) == 0 )
+            opts->bam_index = bif_bai;
+        else if ( cmp_pchar( s, "csi" ) == 0 )
+            opts->bam_index = bif_csi;
+        else
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcInvalid );
+            (void)PLOGERR( klogErr, ( klogErr, rc, "unknown bam-index-format '$(f)', use 'bai' or 'csi'", "f=%s", s ) );
+        }
+    }
+    if ( rc != 0 ) return rc;
+
     rc = get_str_option( args, OPT_RNA_SPLICE_LOG, &s );
     if ( rc == 0 && s != NULL )
     {
@@ -1185,7 +1468,7 @@ static rc_t CC report_reference_cb( const char * name, Vector * ranges, void *da
             for ( i = VectorStart( ranges ); i < count && rc == 0; ++i )
             {
                 range *r = VectorGet( ranges, i );
-                if ( r->end == 0 )
+                if ( r->end == RANGE_OPEN_END )
                 {
                     if ( r->start == 0 )
                         rc = KOutMsg( "\t[ start ... end ]\n" );
@@ -1250,6 +1533,14 @@ void report_options( const samdump_opts * opts )
         default       : KOutMsg( "output-compression    : unknown\n" ); break;
     }
 
+    KOutMsg( "output-bam            : %s\n", opts->output_bam ? "YES" : "NO" );
+    switch( opts->bam_index )
+    {
+        case bif_none : KOutMsg( "bam-index             : none\n" ); break;
+        case bif_bai  : KOutMsg( "bam-index             : bai\n" ); break;
+        case bif_csi  : KOutMsg( "bam-index             : csi\n" ); break;
+    }
+
     switch( opts->output_format )
     {
         case of_sam   : KOutMsg( "output-format         : SAM\n" ); break;
@@ -1266,6 +1557,11 @@ void report_options( const samdump_opts * opts )
     }
 
     KOutMsg( "number of regions     : %u\n",  opts->region_count );
+    if ( opts->region_file != NULL )
+    {
+        KOutMsg( "region-file           : '%s'\n",  opts->region_file );
+        KOutMsg( "region-dedup          : %s\n",  opts->region_dedup ? "YES" : "NO" );
+    }
     if ( opts->region_count > 0 )
         foreach_reference( (BSTree *)&opts->regions, report_reference_cb, NULL );
 
@@ -1333,8 +1629,11 @@ void report_options( const samdump_opts * opts )
     KOutMsg( "outputfile            : %s\n",  opts->outputfile );
     KOutMsg( "outputbuffer-size     : %u\n",  opts->output_buffer_size );
     KOutMsg( "cursor-cache-size     : %u\n",  opts->cursor_cache_size );
+    KOutMsg( "mate-cache-mem        : %lu\n", opts->mate_cache_mem );
+    KOutMsg( "temp                  : %s\n",  opts->temp_dir );
 
     KOutMsg( "use mate-cache        : %s\n",  opts->use_mate_cache ? "YES" : "NO" );
+    KOutMsg( "use prefetch          : %s\n",  opts->use_prefetch ? "YES" : "NO" );
     KOutMsg( "force legacy code     : %s\n",  opts->force_legacy ? "YES" : "NO" );
     KOutMsg( "use min-mapq          : %s\n",  opts->use_min_mapq ? "YES" : "NO" );
     KOutMsg( "min-mapq              : %i\n",  opts->min_mapq );
@@ -1343,6 +1642,7 @@ void report_options( const samdump_opts * opts )
     KOutMsg( "rna-splice-log        : %s\n",  opts->rna_splice_log_file );
 
     KOutMsg( "multithreading        : %s\n",  opts->no_mt ? "NO" : "YES" );  
+    KOutMsg( "worker-threads        : %u\n",  opts->num_threads );
     KOutMsg( "with-MD-flag          : %s\n",  opts->with_md_flag ? "NO" : "YES" );
 	
 #if _DEBUGGING
@@ -1369,6 +1669,10 @@ void release_options( samdump_opts * opts )
         free( (void*)opts->outputfile );
     if( opts->header_file != NULL )
         free( (void*)opts->header_file );
+    if( opts->region_file != NULL )
+        free( (void*)opts->region_file );
+    if( opts->temp_dir != NULL )
+        free( (void*)opts->temp_dir );
     if( opts->timing_file != NULL )
         free( (void*)opts->timing_file );
     if( opts->rna_splice_log_file != NULL )
@@ -1390,6 +1694,51 @@ void release_options( samdump_opts * opts )
 /* =========================================================================================== */
 
 
+/* BAM is encoded by the record-printers for alignments and unaligned reads ( not for the
+   CG-evidence ), uncompressed, the index has to be written next to a file */
+static rc_t check_bam_options( const samdump_opts * opts )
+{
+    rc_t rc = 0;
+    if ( opts->output_bam )
+    {
+        if ( opts->output_format != of_sam )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam cannot be combined with --fasta/--fastq" );
+        }
+        else if ( opts->output_compression != oc_none )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam cannot be combined with --gzip/--bzip2" );
+        }
+        else if ( opts->header_mode == hm_none )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam needs the header ( cannot be combined with --no-header )" );
+        }
+        else if ( opts->force_legacy || opts->dump_cg_evidence || opts->dump_cg_sam )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam is not available for the requested CG-mode" );
+        }
+    }
+    if ( rc == 0 && opts->bam_index != bif_none )
+    {
+        if ( !opts->output_bam )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam-index needs --bam" );
+        }
+        else if ( opts->outputfile == NULL )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcParam, rcConflict );
+            (void)LOGERR( klogErr, rc, "--bam-index needs --output-file" );
+        }
+    }
+    return rc;
+}
+
+
 rc_t gather_options( Args * args, samdump_opts * opts )
 {
     rc_t rc = gather_region_options( args, opts );
@@ -1403,10 +1752,20 @@ rc_t gather_options( Args * args, samdump_opts * opts )
         rc = gather_matepair_distances( args, opts );
     if ( rc == 0 )
         gather_unaligned_options( opts );
+    if ( rc == 0 )
+        rc = check_bam_options( opts );
     return rc;
 }
 
 
+const reference_region * find_region_of_reference( const samdump_opts * opts, const char * name )
+{
+    if ( opts == NULL || name == NULL || opts->region_count == 0 )
+        return NULL;
+    return find_reference_region( ( BSTree * )&opts->regions, name );
+}
+
+
 bool is_this_alignment_requested( const samdump_opts * opts, const char *refname, uint32_t refname_len,
                                   uint64_t start, uint64_t end )
 {
@@ -1432,17 +1791,17 @@ bool is_this_alignment_requested( const samdump_opts * opts, const char *refname
 }
 
 
-rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
-                const char * spot_group, uint32_t spot_group_len )
+rc_t format_name( const samdump_opts * opts, char * buffer, size_t buffer_size, size_t * num_writ,
+                  int64_t seq_spot_id, const char * spot_group, uint32_t spot_group_len )
 {
     rc_t rc;
 
     if ( opts->print_cg_names )
     {
         if ( spot_group != NULL && spot_group_len != 0 )
-            rc = KOutMsg( "%.*s-1:%lu", spot_group_len, spot_group, seq_spot_id );
+            rc = string_printf( buffer, buffer_size, num_writ, "%.*s-1:%lu", spot_group_len, spot_group, seq_spot_id );
         else
-            rc = KOutMsg( "%lu", seq_spot_id );
+            rc = string_printf( buffer, buffer_size, num_writ, "%lu", seq_spot_id );
     }
     else
     {
@@ -1450,21 +1809,36 @@ rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
         {
             /* we do have to print a prefix */
             if ( opts->print_spot_group_in_name && spot_group != NULL && spot_group_len > 0 )
-                rc = KOutMsg( "%s.%lu.%.*s", opts->qname_prefix, seq_spot_id, spot_group_len, spot_group );
+                rc = string_printf( buffer, buffer_size, num_writ, "%s.%lu.%.*s",
+                                    opts->qname_prefix, seq_spot_id, spot_group_len, spot_group );
             else
             /* we do NOT have to append the spot-group */
-                rc = KOutMsg( "%s.%lu", opts->qname_prefix, seq_spot_id );
+                rc = string_printf( buffer, buffer_size, num_writ, "%s.%lu", opts->qname_prefix, seq_spot_id );
         }
         else
         {
             /* we do NOT have to print a prefix */
             if ( opts->print_spot_group_in_name && spot_group != NULL && spot_group_len > 0 )
-                rc = KOutMsg( "%lu.%.*s", seq_spot_id, spot_group_len, spot_group );
+                rc = string_printf( buffer, buffer_size, num_writ, "%lu.%.*s", seq_spot_id, spot_group_len, spot_group );
             else
             /* we do NOT have to append the spot-group */
-                rc = KOutMsg( "%lu", seq_spot_id );
+                rc = string_printf( buffer, buffer_size, num_writ, "%lu", seq_spot_id );
         }
     }
+    if ( rc != 0 )
+        (void)PLOGERR( klogErr, ( klogErr, rc, "cannot format the name of spot #$(id)", "id=%ld", seq_spot_id ) );
+    return rc;
+}
+
+
+rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
+                const char * spot_group, uint32_t spot_group_len )
+{
+    char buffer[ 4096 ];
+    size_t num_writ;
+    rc_t rc = format_name( opts, buffer, sizeof buffer, &num_writ, seq_spot_id, spot_group, spot_group_len );
+    if ( rc == 0 )
+        rc = KOutMsg( "%.*s", ( uint32_t )num_writ, buffer );
     return rc;
 }
 
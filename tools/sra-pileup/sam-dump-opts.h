@@ -45,6 +45,7 @@ extern "C" {
 #include <kapp/args.h>
 #include "perf_log.h"
 #include "rna_splice_log.h"
+#include "bam_index.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -91,6 +92,7 @@ extern "C" {
 #define OPT_DUMP_MODE   "dump-mode"
 #define OPT_MIN_MAPQ    "min-mapq"
 #define OPT_NO_MATE_CACHE "no-mate-cache"
+#define OPT_NO_PREFETCH "no-prefetch"
 #define OPT_LEGACY      "legacy"
 #define OPT_NEW         "new"
 #define OPT_RNA_SPLICE  "rna-splicing"
@@ -99,6 +101,13 @@ extern "C" {
 #define OPT_NO_MT       "disable-multithreading"
 #define OPT_TIMING      "timing"
 #define OPT_MD_FLAG     "with-md-flag"
+#define OPT_THREADS     "threads"
+#define OPT_BAM         "bam"
+#define OPT_BAM_INDEX   "bam-index"
+#define OPT_MATE_CACHE_MEM "mate-cache-mem"
+#define OPT_TEMP        "temp"
+#define OPT_REGION_FILE "region-file"
+#define OPT_REGION_DEDUP "region-dedup"
 
 typedef struct range
 {
@@ -106,12 +115,25 @@ typedef struct range
     uint64_t end;
 } range;
 
+/* the end of a region that reaches to the end of its reference */
+#define RANGE_OPEN_END UINT64_MAX
+
+
+/* one line of a BED-file given with --region-file, kept as given ( not coalesced ) */
+typedef struct region_interval
+{
+    uint64_t start;         /* 0-based, inclusive */
+    uint64_t end;           /* 0-based, inclusive */
+    const char * label;     /* name-column of the BED-line or "ref:from-to" */
+} region_interval;
+
 
 typedef struct reference_region
 {
     BSTNode node;
     const char * name;      /* the name of the reference */
     Vector ranges;          /* what regions on this reference */
+    Vector intervals;       /* region_interval's from a BED-file, sorted by start */
 } reference_region;
 
 
@@ -179,6 +201,12 @@ typedef struct samdump_opts
     /* optional header-file */
     const char * header_file;
 
+    /* optional BED-file with regions, dumped in one pass ( region-batch ) */
+    const char * region_file;
+
+    /* directory of the spill-files of the mate-cache, NULL: $TMPDIR or /tmp */
+    const char * temp_dir;
+
     /* cigar-test >>> not advertized! */
     const char * cigar_test;
 
@@ -208,6 +236,15 @@ typedef struct samdump_opts
 
     size_t cursor_cache_size;
 
+    /* memory-budget of the mate-cache in bytes */
+    size_t mate_cache_mem;
+
+    /* how many worker-threads format records, 0 ... single-threaded */
+    uint32_t num_threads;
+
+    /* which index to write next to the BAM-output */
+    enum bam_index_format bam_index;
+
     /* how the sam-headers are treated */
     enum header_mode header_mode;
 
@@ -225,6 +262,9 @@ typedef struct samdump_opts
 
     /* use a mate-cache to dump aligned and half-aligned reads */
     bool use_mate_cache;
+
+    /* read the rows of a batch of placements column by column ( col_prefetch.c ) */
+    bool use_prefetch;
     bool force_legacy;
     bool force_new;
 
@@ -264,6 +304,12 @@ typedef struct samdump_opts
     bool no_mt;
     
 	bool with_md_flag;
+
+    /* write BAM instead of SAM */
+    bool output_bam;
+
+    /* print a record only once, even if it starts in more than one interval of the region-file */
+    bool region_dedup;
 	
     uint8_t qual_quant_matrix[ 256 ];
 } samdump_opts;
@@ -290,9 +336,15 @@ void release_options( samdump_opts * opts );
 
 bool filter_by_matepair_dist( const samdump_opts * opts, int32_t tlen );
 
+const reference_region * find_region_of_reference( const samdump_opts * opts, const char * name );
+
 bool is_this_alignment_requested( const samdump_opts * opts, const char *refname, uint32_t refname_len,
                                   uint64_t start, uint64_t len );
 
+/* the QNAME like dump_name() prints it, into a buffer */
+rc_t format_name( const samdump_opts * opts, char * buffer, size_t buffer_size, size_t * num_writ,
+                  int64_t seq_spot_id, const char * spot_group, uint32_t spot_group_len );
+
 rc_t dump_name( const samdump_opts * opts, int64_t seq_spot_id,
                 const char * spot_group, uint32_t spot_group_len );
 
@@ -81,6 +81,15 @@ char const *sd_region_usage[]         = { "Filter by position on genome.",
                                        "\"from\" and \"to\" (inclusive) are 1-based coordinates",
                                        NULL };
 
+char const *sd_region_file_usage[]    = { "Filter by regions read from a BED-file ( chrom, start, end, optional name ).",
+                                       "All regions are dumped in one pass, every record is tagged",
+                                       "with the regions it starts in ( XR:Z:name )",
+                                       NULL };
+
+char const *sd_region_dedup_usage[]   = { "Print a record only once if it starts in more than one",
+                                       "region of the region-file, tagged with all their names",
+                                       NULL };
+
 char const *sd_distance_usage[]       = { "Filter by distance between matepairs.",
                                        "Use \"unknown\" to find matepairs split between the references.",
                                        "Use from-to (inclusive) to limit matepair distance on the same reference",
@@ -150,6 +159,9 @@ char const *sd_min_mapq_usage[]       = { "min. mapq an alignment has to have, t
 char const *sd_no_mate_cache_usage[]  = { "do not use a mate-cache, slower but less memory usage",
                                        NULL };
 
+char const *sd_no_prefetch_usage[]    = { "read the alignments cell by cell, not prefetched per batch of placements",
+                                       NULL };
+
 char const *rna_splice_usage[]        = { "modify cigar-string (replace .D. with .N.) and add output flags (XS:A:+/-) ",
                                            "when rna-splicing is detected by match to spliceosome recognition sites",
                                        NULL };
@@ -165,6 +177,20 @@ char const *rna_splice_log_usage[]    = { "file, into which rna-splice events ar
 char const *no_mt_usage[]             = { "disable multithreading", NULL };
 
 char const *with_md_flag_usage[]      = { "print MD-flag", NULL };
+char const *threads_usage[]           = { "number of worker-threads formatting the output",
+                                          "( default: 0 = single-threaded )", NULL };
+
+char const *mate_cache_mem_usage[]    = { "memory-budget of the mate-cache in MB",
+                                          "( default: 1024, beyond it entries are dropped or spilled to disk,",
+                                          "0: the smallest cache )", NULL };
+
+char const *temp_usage[]              = { "directory for the spill-files of the mate-cache",
+                                          "( default: $TMPDIR or /tmp )", NULL };
+
+char const *bam_usage[]               = { "Output BAM instead of SAM", NULL };
+
+char const *bam_index_usage[]         = { "Write an index next to the BAM-output-file",
+                                          "( 'bai' or 'csi', output has to be coordinate-sorted )", NULL };
                                       
 OptDef SamDumpArgs[] =
 {
@@ -177,6 +203,8 @@ OptDef SamDumpArgs[] =
     { OPT_NO_HDR,        "n", NULL, sd_noheader_usage,       0, false, false },  /* do not print header */
     { OPT_HDR_COMMENT,  NULL, NULL, sd_comment_usage,        0, true,  false },  /* insert this comment into header */
     { OPT_REGION,       NULL, NULL, sd_region_usage,         0, true,  false },  /* filter by region */
+    { OPT_REGION_FILE,  NULL, NULL, sd_region_file_usage,    0, true,  false },  /* filter by regions from BED-file */
+    { OPT_REGION_DEDUP, NULL, NULL, sd_region_dedup_usage,   0, false, false },  /* print region-batch records once */
     { OPT_MATE_DIST,    NULL, NULL, sd_distance_usage,       0, true,  false },  /* filter by a list of mate-pair-distances */
     { OPT_USE_SEQID,     "s", NULL, sd_seq_id_usage,         0, false, false },  /* print seq-id instead of seq-name*/
     { OPT_HIDE_IDENT,    "=", NULL, sd_identicalbases_usage, 0, false, false },  /* replace bases that match the reference with '=' */
@@ -204,11 +232,17 @@ OptDef SamDumpArgs[] =
     { OPT_CURSOR_CACHE, NULL, NULL, sd_cur_cache_usage,      0, true,  false },  /* size of cursor cache */
     { OPT_MIN_MAPQ,     NULL, NULL, sd_min_mapq_usage,       0, true,  false },  /* minimal mapping quality */
     { OPT_NO_MATE_CACHE,NULL, NULL, sd_no_mate_cache_usage,  0, false, false },  /* do not use mate-cache */
+    { OPT_NO_PREFETCH,  NULL, NULL, sd_no_prefetch_usage,    0, false, false },  /* do not prefetch alignment-rows */
+    { OPT_MATE_CACHE_MEM,NULL, NULL, mate_cache_mem_usage,   0, true,  false },  /* memory-budget of mate-cache */
+    { OPT_TEMP,         NULL, NULL, temp_usage,              0, true,  false },  /* directory of the spill-files */
     { OPT_RNA_SPLICE,   NULL, NULL, rna_splice_usage,        0, false, false },  /* detect rna-splicing in sequence */
     { OPT_RNA_SPLICEL,  NULL, NULL, rna_splicel_usage,       0, true,  false },  /* level of rna-splicing detection */
     { OPT_RNA_SPLICE_LOG,  NULL, NULL, rna_splice_log_usage, 0, true,  false },  /* filename to log rna-splice events into */
     { OPT_NO_MT,        NULL, NULL, no_mt_usage,              0, false, false },   /* force new code-path */    
     { OPT_MD_FLAG,		NULL, NULL, with_md_flag_usage,       0, false, false },    /* print the MD-flag */	
+    { OPT_THREADS,      NULL, NULL, threads_usage,           0, true,  false },  /* number of worker-threads */
+    { OPT_BAM,          NULL, NULL, bam_usage,               0, false, false },  /* output BAM */
+    { OPT_BAM_INDEX,    NULL, NULL, bam_index_usage,         0, true,  false },  /* write bai/csi-index */
     { OPT_DUMP_MODE,    NULL, NULL, NULL,                    0, true,  false },  /* how to produce aligned reads if no regions given */
     { OPT_CIGAR_TEST,   NULL, NULL, NULL,                    0, true,  false },  /* test cg-treatment of cigar string */
     { OPT_LEGACY,       NULL, NULL, NULL,                    0, false, false },  /* force legacy code-path */
@@ -227,6 +261,8 @@ char const *sd_usage_params[] =
     NULL,                       /* no-header */
     "text",                     /* hdr-comment */
     "name[:from-to]",           /* region */
+    "bed-file",                 /* region-file */
+    NULL,                       /* region-dedup */
     "from-to|'unknown'",        /* mate distance filter*/
     NULL,                       /* seq-id */
     NULL,                       /* identical-bases */
@@ -254,11 +290,16 @@ char const *sd_usage_params[] =
     NULL,                       /* cursor cache */
     NULL,                       /* min_mapq */
     NULL,                       /* no mate-cache */
+    "MB",                       /* mate-cache-mem */
+    "path",                     /* temp */
     NULL,                       /* detect rna-splicing in sequence */
     NULL,                       /* level of rna-splicing detection */
     NULL,                       /* file to log rna-splice-events into */
     NULL,                       /* no-mt */
     NULL,                       /* with-md-flag */	
+    "count",                    /* threads */
+    NULL,                       /* bam */
+    "bai|csi",                  /* bam-index */
     NULL,                       /* dump_mode */
     NULL,                       /* cigar test */
     NULL,                       /* force legacy code path */
@@ -384,7 +425,12 @@ static rc_t print_samdump( const samdump_opts * const opts )
                         matecache * mc = NULL;
 
                         if ( opts->use_mate_cache )
-                            rc = make_matecache( &mc, ifs->database_count );
+                        {
+                            rc = make_matecache( &mc, ifs->database_count, opts->mate_cache_mem, opts->temp_dir );
+                            /* the worker-threads share the cache */
+                            if ( rc == 0 && opts->num_threads > 0 )
+                                rc = matecache_make_thread_safe( mc );
+                        }
 
                         if ( rc == 0 )
                         {
@@ -475,6 +521,22 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
     }
 
     rc = init_out_redir( &redir, mode, opts->outputfile, opts->output_buffer_size ); /* from out_redir.c */
+    if ( rc == 0 && opts->output_bam && !opts->report_options && opts->cigar_test == NULL )
+    {
+        char idx_filename[ 4096 ] = "";
+        if ( opts->bam_index != bif_none )
+        {
+            size_t written;
+            rc = string_printf( idx_filename, sizeof idx_filename, &written, "%s.%s",
+                                opts->outputfile, opts->bam_index == bif_csi ? "csi" : "bai" );
+            if ( rc != 0 )
+                (void)LOGERR( klogErr, rc, "cannot create name of bam-index" );
+        }
+        if ( rc == 0 )
+            rc = out_redir_make_bam( &redir, opts->num_threads, opts->bam_index, idx_filename ); /* from out_redir.c */
+        if ( rc != 0 )
+            release_out_redir( &redir );
+    }
     if ( rc == 0 )
     {
         if ( opts->report_options )
@@ -500,6 +562,8 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
             /* ------------------------------------------------------ */
             }
         }
+        if ( rc == 0 )
+            rc = out_redir_finish( &redir ); /* from out_redir.c */
         release_out_redir( &redir ); /* from out_redir.c */
     }
     return rc;
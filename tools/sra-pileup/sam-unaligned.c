@@ -26,7 +26,10 @@
 
 #include "read_fkt.h"
 #include "sam-unaligned.h"
+#include "dump_pool.h"
+#include "bam_out.h"
 #include <kapp/main.h>
+#include <klib/printf.h>
 #include <sysalloc.h>
 #include <ctype.h>
 
@@ -371,7 +374,9 @@ static rc_t get_mate_info( const prim_table_ctx * const ptx,
 }
 
 
-static rc_t print_sliced_read( const INSDC_dna_text * read,
+/* bam != NULL: the field goes into the BAM-record instead of being printed */
+static rc_t print_sliced_read( bam_rec * bam,
+                               const INSDC_dna_text * read,
                                uint32_t read_idx,
                                bool reverse,
                                const INSDC_coord_zero * read_start,
@@ -379,7 +384,13 @@ static rc_t print_sliced_read( const INSDC_dna_text * read,
 {
     rc_t rc = 0;
     const INSDC_dna_text * ptr = read + read_start[ read_idx ];
-    if ( !reverse )
+    if ( bam != NULL )
+    {
+        bam->seq = ptr;
+        bam->l_seq = read_len[ read_idx ];
+        bam->seq_reverse = reverse;
+    }
+    else if ( !reverse )
     {
         rc = KOutMsg( "%.*s", read_len[ read_idx ], ptr );
     }
@@ -414,6 +425,7 @@ static rc_t print_sliced_read( const INSDC_dna_text * read,
 
 
 static rc_t print_sliced_quality( const samdump_opts * const opts,
+                                  bam_rec * bam,
                                   const char * quality,
                                   uint32_t read_idx,
                                   bool reverse,
@@ -421,11 +433,21 @@ static rc_t print_sliced_quality( const samdump_opts * const opts,
                                   const INSDC_coord_len * read_len )
 {
     const char * ptr = quality + read_start[ read_idx ];
+    if ( bam != NULL )
+    {
+        /* QUALITY is the raw phred-value */
+        bam->qual = ptr;
+        bam->qual_offset = 0;
+        bam->qual_reverse = reverse;
+        bam->qual_quant = ( opts->qual_quant != NULL ) ? opts->qual_quant_matrix : NULL;
+        return 0;
+    }
     return dump_quality( opts, ptr, read_len[ read_idx ], reverse ); /* sam-dump-opts.c */
 }
 
 
-static rc_t dump_the_other_read( const seq_table_ctx * const stx,
+static rc_t dump_the_other_read( bam_rec * bam,
+                                 const seq_table_ctx * const stx,
                                  const prim_table_ctx * const ptx,
                                  const int64_t row_id,
                                  const uint32_t mate_idx )
@@ -451,7 +473,8 @@ static rc_t dump_the_other_read( const seq_table_ctx * const stx,
             int64_t a_row_id = prim_al_id_ptr[ mate_idx ];
             if ( a_row_id == 0 )
             {
-                rc = KOutMsg( "*\t0\t" );
+                if ( bam == NULL )
+                    rc = KOutMsg( "*\t0\t" );
             }
             else
             {
@@ -470,7 +493,14 @@ static rc_t dump_the_other_read( const seq_table_ctx * const stx,
                         rc = read_INSDC_coord_zero_ptr( a_row_id, ptx->cursor, ptx->ref_pos_idx, &ref_pos, &row_len, "REF_POS" );
                         if ( rc == 0 )
                         {
-                            rc = KOutMsg( "%.*s\t%i\t", ref_name_len, ref_name, ref_pos[ 0 ] + 1 );
+                            if ( bam != NULL )
+                            {
+                                bam->rnext = ref_name;
+                                bam->rnext_len = ref_name_len;
+                                bam->pnext = ref_pos[ 0 ];
+                            }
+                            else
+                                rc = KOutMsg( "%.*s\t%i\t", ref_name_len, ref_name, ref_pos[ 0 ] + 1 );
                         }
                     }
                 }
@@ -566,26 +596,67 @@ static bool calc_reverse_flag( const samdump_opts * const opts,
 }
 
 
-static rc_t opt_field_spot_group( const seq_table_ctx * const stx, int64_t row_id )
+static rc_t opt_field_spot_group( bam_rec * bam, const seq_table_ctx * const stx, int64_t row_id )
 {
     const char * spot_group = NULL;
     uint32_t spot_group_len;    
     rc_t rc = read_char_ptr( row_id, stx->cursor, stx->spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
     if ( rc == 0 && spot_group_len > 0 )
-        rc = KOutMsg( "\tRG:Z:%.*s", spot_group_len, spot_group );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_str( bam, "RG", spot_group, spot_group_len );
+        else
+            rc = KOutMsg( "\tRG:Z:%.*s", spot_group_len, spot_group );
+    }
     return rc;
 }
 
-static rc_t opt_field_lnk_group( const seq_table_ctx * const stx, int64_t row_id )
+static rc_t opt_field_lnk_group( bam_rec * bam, const seq_table_ctx * const stx, int64_t row_id )
 {
     const char * lnk_grp;
     uint32_t lnk_grp_len;
     rc_t rc = read_char_ptr( row_id, stx->cursor, stx->lnk_group_idx, &lnk_grp, &lnk_grp_len, "LINKAGE_GROUP" );
     if ( rc == 0 && lnk_grp_len > 0 )
-        rc = KOutMsg( "\tBX:Z:%.*s", lnk_grp_len, lnk_grp );
+    {
+        if ( bam != NULL )
+            rc = bam_rec_tag_str( bam, "BX", lnk_grp, lnk_grp_len );
+        else
+            rc = KOutMsg( "\tBX:Z:%.*s", lnk_grp_len, lnk_grp );
+    }
+    return rc;
+}
+
+/* SAM-FIELD: QNAME, printed with the tab or ( for --bam ) formatted into buffer,
+   which has to stay valid until the record is written */
+static rc_t put_qname( bam_rec * bam, char * buffer, size_t buffer_size, const char * fmt, ... )
+{
+    rc_t rc;
+    va_list args;
+
+    va_start( args, fmt );
+    if ( bam != NULL )
+    {
+        rc = string_vprintf( buffer, buffer_size, &bam->qname_len, fmt, args );
+        bam->qname = buffer;
+    }
+    else
+    {
+        rc = KOutVMsg( fmt, args );
+        if ( rc == 0 )
+            rc = KOutMsg( "\t" );
+    }
+    va_end( args );
     return rc;
 }
 
+/* SAM: the line ends, BAM: the record is encoded and written */
+static rc_t end_of_record( bam_rec * bam )
+{
+    if ( bam != NULL )
+        return bam_rec_write( bam ); /* bam_out.c */
+    return KOutMsg( "\n" );
+}
+
 static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
                                        const seq_table_ctx * const stx,
                                        const prim_table_ctx * const ptx,
@@ -602,8 +673,15 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
     const INSDC_read_filter * read_filter = NULL;
     const INSDC_coord_zero * read_start = NULL;
     const INSDC_coord_len * read_len;
+    char qname[ 1024 ];
+    bam_rec bam_record, * bam = NULL;
 
     rc_t rc = read_int64_ptr( row_id, stx->cursor, stx->prim_al_id_idx, &prim_align_ids, &prim_align_ids_len, "PRIM_AL_ID" );
+    if ( opts->output_bam )
+    {
+        bam_rec_init( &bam_record );
+        bam = &bam_record;
+    }
     if ( rc == 0 && nreads != prim_align_ids_len )
         rc = complain_size_diff( row_id, "PRIMARY_ALIGNMENT_ID" );
     if ( rc == 0 )
@@ -651,6 +729,9 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
                         {
                             bool reverse = false;
 
+                            if ( bam != NULL )
+                                bam_rec_reset( bam );
+
                             /* SAM-FIELD: QNAME     SRA-column: SPOT_ID ( int64 ) */
                             if ( rc == 0 )
                             {
@@ -663,13 +744,13 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
                                     rc = read_char_ptr( row_id, stx->cursor, stx->spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
                                     if ( rc == 0 && spot_group_len > 0 )
                                     {
-                                        rc = KOutMsg( "%ld.%.*s\t", seq_spot_id, spot_group_len, spot_group );
+                                        rc = put_qname( bam, qname, sizeof qname, "%ld.%.*s", seq_spot_id, spot_group_len, spot_group );
                                         print_just_seq_spot_id = false;
                                     }
                                 }
                                 if ( print_just_seq_spot_id )
                                 {
-                                    rc = KOutMsg( "%ld\t", seq_spot_id );
+                                    rc = put_qname( bam, qname, sizeof qname, "%ld", seq_spot_id );
                                 }
                             }
                             
@@ -687,23 +768,35 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
                             {
                                 uint32_t sam_flags = calculate_unaligned_sam_flags_db( nreads, read_idx, mate_idx, 
                                                                                     align_id, read_type, reverse, read_filter );
-                                rc = KOutMsg( "%u\t", sam_flags );
+                                if ( bam != NULL )
+                                    bam->flag = sam_flags;
+                                else
+                                    rc = KOutMsg( "%u\t", sam_flags );
                             }
 
                             /* SAM-FIELD: RNAME     SRA-column: none, fix '*' */
                             /* SAM-FIELD: POS       SRA-column: none, fix '0' */
                             /* SAM-FIELD: MAPQ      SRA-column: none, fix '0' */
                             /* SAM-FIELD: CIGAR     SRA-column: none, fix '*' */
-                            if ( rc == 0 )
+                            if ( rc == 0 && bam == NULL )
                                 rc = KOutMsg( "*\t0\t0\t*\t" );
 
                             /* SAM-FIELD: RNEXT     SRA-column: found in cache */
                             /* SAM-FIELD: POS       SRA-column: found in cache */
                             if ( rc == 0 )
-                                rc = KOutMsg( "%s\t%li\t", mate_ref_name, mate_ref_pos + 1 );
+                            {
+                                if ( bam != NULL )
+                                {
+                                    bam->rnext = mate_ref_name;
+                                    bam->rnext_len = string_size( mate_ref_name );
+                                    bam->pnext = mate_ref_pos;
+                                }
+                                else
+                                    rc = KOutMsg( "%s\t%li\t", mate_ref_name, mate_ref_pos + 1 );
+                            }
 
                             /* SAM-FIELD: TLEN      SRA-column: none, fix '0' */
-                            if ( rc == 0 )
+                            if ( rc == 0 && bam == NULL )
                                 rc = KOutMsg( "0\t" );
 
                             if ( rc == 0 && read == NULL )
@@ -715,28 +808,33 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
 
                             /* SAM-FIELD: SEQ       SRA-column: READ, sliced by READ_START/READ_LEN */
                             if ( rc == 0 )
-                                rc = print_sliced_read( read, read_idx, reverse, read_start, read_len );
-                            if ( rc == 0 )
+                                rc = print_sliced_read( bam, read, read_idx, reverse, read_start, read_len );
+                            if ( rc == 0 && bam == NULL )
                                 rc = KOutMsg( "\t" );
 
                             /* SAM-FIELD: QUAL      SRA-column: QUALITY, sliced by READ_START/READ_LEN */
                             if ( rc == 0 )
-                                rc = print_sliced_quality( opts, quality, read_idx, reverse, read_start, read_len );
+                                rc = print_sliced_quality( opts, bam, quality, read_idx, reverse, read_start, read_len );
 
                             /* OPT SAM-FIELD:       SRA-column: ALIGN_ID */
                             if ( rc == 0 && opts->print_alignment_id_in_column_xi )
-                                rc = KOutMsg( "\tXI:i:%u", row_id );
+                            {
+                                if ( bam != NULL )
+                                    rc = bam_rec_tag_int( bam, "XI", ( uint32_t )row_id );
+                                else
+                                    rc = KOutMsg( "\tXI:i:%u", row_id );
+                            }
 
                             /* OPT SAM-FIELD:      SRA-column: SPOT_GROUP */
                             if ( rc == 0 && stx->spot_group_idx != COL_NOT_AVAILABLE )
-                                rc = opt_field_spot_group( stx, row_id );
+                                rc = opt_field_spot_group( bam, stx, row_id );
 
                             /* OPT SAM-FIELD:       SRA-column: LINKAGE_GROUP */
                             if ( rc == 0 && stx->lnk_group_idx != COL_NOT_AVAILABLE )
-                                rc = opt_field_lnk_group( stx, row_id );
+                                rc = opt_field_lnk_group( bam, stx, row_id );
                             
                             if ( rc == 0 )
-                                rc = KOutMsg( "\n" );
+                                rc = end_of_record( bam );
                         }
                     }
                 }
@@ -747,6 +845,8 @@ static rc_t dump_seq_row_sam_filtered( const samdump_opts * const opts,
             }
         }
     }
+    if ( bam != NULL )
+        bam_rec_release( bam );
     return rc;
 }
 
@@ -767,8 +867,15 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
     const INSDC_read_filter * read_filter = NULL;
     const INSDC_coord_zero * read_start = NULL;
     const INSDC_coord_len * read_len;
+    char qname[ 1024 ];
+    bam_rec bam_record, * bam = NULL;
 
     rc_t rc = read_int64_ptr( row_id, stx->cursor, stx->prim_al_id_idx, &prim_align_ids, &prim_align_ids_len, "PRIM_AL_ID" );
+    if ( opts->output_bam )
+    {
+        bam_rec_init( &bam_record );
+        bam = &bam_record;
+    }
     if ( rc == 0 && nreads != prim_align_ids_len )
         rc = complain_size_diff( row_id, "PRIMARY_ALIGNMENT_ID" );
     if ( rc == 0 )
@@ -783,6 +890,9 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
             uint32_t mate_idx = 0;
             int64_t mate_id = 0;
 
+            if ( bam != NULL )
+                bam_rec_reset( bam );
+
             if ( nreads > 1 )
             {
                 if ( read_idx == ( nreads - 1 ) )
@@ -815,13 +925,13 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
                     rc = read_char_ptr( row_id, stx->cursor, stx->spot_group_idx, &spot_group, &spot_group_len, "SPOT_GROUP" );
                     if ( rc == 0 && spot_group_len > 0 )
                     {
-                        rc = KOutMsg( "%ld.%.*s\t", row_id, spot_group_len, spot_group );
+                        rc = put_qname( bam, qname, sizeof qname, "%ld.%.*s", row_id, spot_group_len, spot_group );
                         print_just_seq_spot_id = false;
                     }
                 }
                 if ( print_just_seq_spot_id )
                 {
-                    rc = KOutMsg( "%ld\t", row_id );
+                    rc = put_qname( bam, qname, sizeof qname, "%ld", row_id );
                 }
             }
             
@@ -843,14 +953,17 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
                     else
                         sam_flags = 0x04;
                 }
-                rc = KOutMsg( "%u\t", sam_flags );
+                if ( bam != NULL )
+                    bam->flag = sam_flags;
+                else
+                    rc = KOutMsg( "%u\t", sam_flags );
             }
 
             /* SAM-FIELD: RNAME     SRA-column: none, fix '*' */
             /* SAM-FIELD: POS       SRA-column: none, fix '0' */
             /* SAM-FIELD: MAPQ      SRA-column: none, fix '0' */
             /* SAM-FIELD: CIGAR     SRA-column: none, fix '*' */
-            if ( rc == 0 )
+            if ( rc == 0 && bam == NULL )
                 rc = KOutMsg( "*\t0\t0\t*\t" );
 
             /* SAM-FIELD: RNEXT     SRA-column: look up in cache, or none */
@@ -859,7 +972,9 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
             {
                 if ( ptx == NULL || !mate_available )
                 {
-                    rc = KOutMsg( "0\t0\t" );   /* no way to get that without PRIM_ALIGN-table */
+                    /* no way to get that without PRIM_ALIGN-table, BAM has no '0' as RNEXT: it stays '*' */
+                    if ( bam == NULL )
+                        rc = KOutMsg( "0\t0\t" );
                 }
                 else
                 {
@@ -871,19 +986,28 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
 
                         rc = get_mate_info( ptx, mc, ids, row_id, mate_id, nreads, &mate_ref_name, &mate_ref_name_len, &mate_ref_pos );
                         if ( rc == 0 )
-                            rc = KOutMsg( "%.*s\t%li\t", mate_ref_name_len, mate_ref_name, mate_ref_pos );
+                        {
+                            if ( bam != NULL )
+                            {
+                                bam->rnext = mate_ref_name;
+                                bam->rnext_len = mate_ref_name_len;
+                                bam->pnext = mate_ref_pos - 1;
+                            }
+                            else
+                                rc = KOutMsg( "%.*s\t%li\t", mate_ref_name_len, mate_ref_name, mate_ref_pos );
+                        }
                     }
                     else
                     {
                         /* print the mate info */
-                        rc = dump_the_other_read( stx, ptx, row_id, mate_idx );
+                        rc = dump_the_other_read( bam, stx, ptx, row_id, mate_idx );
                     }
                 }
             }
 
 
             /* SAM-FIELD: TLEN      SRA-column: none, fix '0' */
-            if ( rc == 0 )
+            if ( rc == 0 && bam == NULL )
                 rc = KOutMsg( "0\t" );
 
             if ( rc == 0 && read == NULL )
@@ -893,8 +1017,8 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
 
             /* SAM-FIELD: SEQ       SRA-column: READ, sliced by READ_START/READ_LEN */
             if ( rc == 0 )
-                rc = print_sliced_read( read, read_idx, reverse, read_start, read_len );
-            if ( rc == 0 )
+                rc = print_sliced_read( bam, read, read_idx, reverse, read_start, read_len );
+            if ( rc == 0 && bam == NULL )
                 rc = KOutMsg( "\t" );
 
             if ( rc == 0 && quality == NULL )
@@ -902,24 +1026,31 @@ static rc_t dump_seq_prim_row_sam( const samdump_opts * const opts,
 
             /* SAM-FIELD: QUAL      SRA-column: QUALITY, sliced by READ_START/READ_LEN */
             if ( rc == 0 )
-                rc = print_sliced_quality( opts, quality, read_idx, reverse, read_start, read_len );
+                rc = print_sliced_quality( opts, bam, quality, read_idx, reverse, read_start, read_len );
 
             /* OPT SAM-FIIELD:      SRA-column: ALIGN_ID */
             if ( rc == 0 && opts->print_alignment_id_in_column_xi )
-                rc = KOutMsg( "\tXI:i:%u", row_id );
+            {
+                if ( bam != NULL )
+                    rc = bam_rec_tag_int( bam, "XI", ( uint32_t )row_id );
+                else
+                    rc = KOutMsg( "\tXI:i:%u", row_id );
+            }
 
             /* OPT SAM-FIIELD:      SRA-column: SPOT_GROUP */
             if ( rc == 0 && stx->spot_group_idx != COL_NOT_AVAILABLE )
-                rc = opt_field_spot_group( stx, row_id );
+                rc = opt_field_spot_group( bam, stx, row_id );
 
             /* OPT SAM-FIELD:       SRA-column: LINKAGE_GROUP */
             if ( rc == 0 && stx->lnk_group_idx != COL_NOT_AVAILABLE )
-                rc = opt_field_lnk_group( stx, row_id );
+                rc = opt_field_lnk_group( bam, stx, row_id );
 
             if ( rc == 0 )
-                rc = KOutMsg( "\n" );
+                rc = end_of_record( bam );
         }
     }
+    if ( bam != NULL )
+        bam_rec_release( bam );
     return rc;
 }
 
@@ -938,8 +1069,15 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
     const INSDC_read_filter * read_filter = NULL;
     const INSDC_coord_zero * read_start = NULL;
     const INSDC_coord_len * read_len;
+    char qname[ 1024 ];
+    bam_rec bam_record, * bam = NULL;
 
     rc_t rc = read_read_len( stx, row_id, &read_len, nreads );
+    if ( opts->output_bam )
+    {
+        bam_rec_init( &bam_record );
+        bam = &bam_record;
+    }
     if ( rc == 0 )
     {
         if ( stx->name_idx != COL_NOT_AVAILABLE )
@@ -958,6 +1096,9 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
             bool reverse = false;
             uint32_t mate_idx = 0;
 
+            if ( bam != NULL )
+                bam_rec_reset( bam );
+
             if ( nreads > 1 )
             {
                 if ( read_idx == ( nreads - 1 ) )
@@ -985,9 +1126,9 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
                     if ( rc == 0 && spot_group_len > 0 )
                     {
                         if ( name != NULL && name_len > 0 )
-                            rc = KOutMsg( "%.*s.%.*s\t", name_len, name, spot_group_len, spot_group );
+                            rc = put_qname( bam, qname, sizeof qname, "%.*s.%.*s", name_len, name, spot_group_len, spot_group );
                         else
-                            rc = KOutMsg( "%ld.%.*s\t", row_id, spot_group_len, spot_group );
+                            rc = put_qname( bam, qname, sizeof qname, "%ld.%.*s", row_id, spot_group_len, spot_group );
                         print_just_seq_spot_id = false;
                     }
                 }
@@ -995,9 +1136,9 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
                 if ( print_just_seq_spot_id )
                 {
                     if ( name != NULL && name_len > 0 )
-                        rc = KOutMsg( "%.*s\t", name_len, name );
+                        rc = put_qname( bam, qname, sizeof qname, "%.*s", name_len, name );
                     else
-                        rc = KOutMsg( "%lu\t", row_id );
+                        rc = put_qname( bam, qname, sizeof qname, "%lu", row_id );
                 }
             }
 
@@ -1006,7 +1147,10 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
             {
                 uint32_t sam_flags = calculate_unaligned_sam_flags_db( nreads, read_idx, mate_idx, 
                                             0, read_type, reverse, read_filter );
-                rc = KOutMsg( "%u\t", sam_flags );
+                if ( bam != NULL )
+                    bam->flag = sam_flags;
+                else
+                    rc = KOutMsg( "%u\t", sam_flags );
             }
 
             /* SAM-FIELD: RNAME     SRA-column: none, fix '*' */
@@ -1017,7 +1161,7 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
             /* SAM-FIELD: POS       SRA-column: none, fix '0' */
             /* SAM-FIELD: TLEN      SRA-column: none, fix '0' */
 
-            if ( rc == 0 )
+            if ( rc == 0 && bam == NULL )
                 rc = KOutMsg( "*\t0\t0\t*\t*\t0\t0\t" );
 
             if ( rc == 0 && read == NULL )
@@ -1027,8 +1171,8 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
 
             /* SAM-FIELD: SEQ       SRA-column: READ, sliced by READ_START/READ_LEN */
             if ( rc == 0 )
-                rc = print_sliced_read( read, read_idx, reverse, read_start, read_len );
-            if ( rc == 0 )
+                rc = print_sliced_read( bam, read, read_idx, reverse, read_start, read_len );
+            if ( rc == 0 && bam == NULL )
                 rc = KOutMsg( "\t" );
 
             if ( rc == 0 && quality == NULL )
@@ -1036,24 +1180,31 @@ static rc_t dump_seq_row_sam( const samdump_opts * const opts,
 
             /* SAM-FIELD: QUAL      SRA-column: QUALITY, sliced by READ_START/READ_LEN */
             if ( rc == 0 )
-                rc = print_sliced_quality( opts, quality, read_idx, reverse, read_start, read_len );
+                rc = print_sliced_quality( opts, bam, quality, read_idx, reverse, read_start, read_len );
 
             /* OPT SAM-FIIELD:      SRA-column: ALIGN_ID */
             if ( rc == 0 && opts->print_alignment_id_in_column_xi )
-                rc = KOutMsg( "\tXI:i:%u", row_id );
+            {
+                if ( bam != NULL )
+                    rc = bam_rec_tag_int( bam, "XI", ( uint32_t )row_id );
+                else
+                    rc = KOutMsg( "\tXI:i:%u", row_id );
+            }
 
             /* OPT SAM-FIIELD:      SRA-column: SPOT_GROUP */
             if ( rc == 0 && stx->spot_group_idx != COL_NOT_AVAILABLE )
-                rc = opt_field_spot_group( stx, row_id );
+                rc = opt_field_spot_group( bam, stx, row_id );
 
             /* OPT SAM-FIELD:       SRA-column: LINKAGE_GROUP */
             if ( rc == 0 && stx->lnk_group_idx != COL_NOT_AVAILABLE )
-                rc = opt_field_lnk_group( stx, row_id );
+                rc = opt_field_lnk_group( bam, stx, row_id );
 
             if ( rc == 0 )
-                rc = KOutMsg( "\n" );
+                rc = end_of_record( bam );
         }
     }
+    if ( bam != NULL )
+        bam_rec_release( bam );
     return rc;
 }
 
@@ -1129,7 +1280,7 @@ static rc_t dump_seq_row_fastx_filtered( const samdump_opts * const opts,
 
                     /* the READ */
                     if ( rc == 0 )
-                        rc = print_sliced_read( read, read_idx, /* reverse */ false, read_start, read_len );
+                        rc = print_sliced_read( NULL, read, read_idx, /* reverse */ false, read_start, read_len );
                     if ( rc == 0 )
                         rc = KOutMsg( "\n" );
 
@@ -1138,7 +1289,7 @@ static rc_t dump_seq_row_fastx_filtered( const samdump_opts * const opts,
                     {
                         rc = KOutMsg( "+\n" );
                         if ( rc == 0 )
-                            rc = print_sliced_quality( opts, quality, read_idx, /* reverse */ false, read_start, read_len );
+                            rc = print_sliced_quality( opts, NULL, quality, read_idx, /* reverse */ false, read_start, read_len );
                         if ( rc == 0 )
                             rc = KOutMsg( "\n" );
                     }
@@ -1211,7 +1362,7 @@ static rc_t dump_seq_row_fastx( const samdump_opts * const opts,
 
             /* the READ */
             if ( rc == 0 )
-                rc = print_sliced_read( read, read_idx, /*reverse*/ false, read_start, read_len );
+                rc = print_sliced_read( NULL, read, read_idx, /*reverse*/ false, read_start, read_len );
             if ( rc == 0 )
                 rc = KOutMsg( "\n" );
 
@@ -1220,7 +1371,7 @@ static rc_t dump_seq_row_fastx( const samdump_opts * const opts,
             {
                 rc = KOutMsg( "+\n" );
                 if ( rc == 0 )
-                    rc = print_sliced_quality( opts, quality, read_idx, /*reverse*/ false, read_start, read_len );
+                    rc = print_sliced_quality( opts, NULL, quality, read_idx, /*reverse*/ false, read_start, read_len );
                 if ( rc == 0 )
                     rc = KOutMsg( "\n" );
             }
@@ -1287,7 +1438,7 @@ static rc_t dump_seq_tab_row_fastx( const samdump_opts * const opts,
 
             /* the READ */
             if ( rc == 0 )
-                rc = print_sliced_read( read, read_idx, /* reverse */ false, read_start, read_len );
+                rc = print_sliced_read( NULL, read, read_idx, /* reverse */ false, read_start, read_len );
             if ( rc == 0 )
                 rc = KOutMsg( "\n" );
 
@@ -1299,7 +1450,7 @@ static rc_t dump_seq_tab_row_fastx( const samdump_opts * const opts,
                 if ( rc == 0 )
                     rc = KOutMsg( "+\n" );
                 if ( rc == 0 )
-                    rc = print_sliced_quality( opts, quality, read_idx, /* reverse */ false, read_start, read_len );
+                    rc = print_sliced_quality( opts, NULL, quality, read_idx, /* reverse */ false, read_start, read_len );
                 if ( rc == 0 )
                     rc = KOutMsg( "\n" );
             }
@@ -1441,6 +1592,38 @@ static rc_t print_unaligned_database_filtered( const samdump_opts * const opts,
 }
 
 
+static rc_t print_unaligned_rows( const samdump_opts * const opts,
+                                  const seq_table_ctx * const stx,
+                                  const prim_table_ctx * const ptx,
+                                  const matecache * const mc,
+                                  const input_database * const ids,
+                                  int64_t first_row,
+                                  uint64_t row_count )
+{
+    rc_t rc = 0;
+    int64_t row_id;
+    seq_row row;
+    for ( row_id = first_row; ( ( row_id - first_row ) < row_count ) && rc == 0; ++row_id )
+    {
+        rc = Quitting();
+        if ( rc == 0 )
+        {
+            rc = read_seq_row( opts, stx, row_id, &row );
+            if ( rc == 0 && !row.filtered_out )
+            {
+                switch( opts->output_format )
+                {
+                    case of_sam   : rc = dump_seq_prim_row_sam( opts, stx, ptx, mc, ids, row_id, row.nreads ); break;
+                    case of_fasta : /* fall through intended ! */
+                    case of_fastq : rc = dump_seq_row_fastx( opts, stx, row_id, row.nreads ); break;
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
 /* we are printing from a sra-database, we print all unaligned read we can find */
 static rc_t print_unaligned_database_full( const samdump_opts * const opts,
                                            const input_table * const seq,
@@ -1464,7 +1647,7 @@ static rc_t print_unaligned_database_full( const samdump_opts * const opts,
                 rc = prepare_prim_table_ctx( opts, prim, &ptx );
             if ( rc == 0 )
             {
-                int64_t first_row, row_id;
+                int64_t first_row;
                 uint64_t row_count;
                 rc = VCursorIdRange( stx.cursor, stx.read_type_idx, &first_row, &row_count );
                 if ( rc != 0 )
@@ -1473,24 +1656,7 @@ static rc_t print_unaligned_database_full( const samdump_opts * const opts,
                 }
                 else
                 {
-                    seq_row row;
-                    for ( row_id = first_row; ( ( row_id - first_row ) < row_count ) && rc == 0; ++row_id )
-                    {
-                        rc = Quitting();
-                        if ( rc == 0 )
-                        {
-                            rc = read_seq_row( opts, &stx, row_id, &row );
-                            if ( rc == 0 && !row.filtered_out )
-                            {
-                                switch( opts->output_format )
-                                {
-                                    case of_sam   : rc = dump_seq_prim_row_sam( opts, &stx, &ptx, mc, ids, row_id, row.nreads ); break;
-                                    case of_fasta : /* fall through intended ! */
-                                    case of_fastq : rc = dump_seq_row_fastx( opts, &stx, row_id, row.nreads ); break;
-                                }
-                            }
-                        }
-                    }
+                    rc = print_unaligned_rows( opts, &stx, &ptx, mc, ids, first_row, row_count );
                 }
                 if ( opts->output_format == of_sam )
                     VCursorRelease( ptx.cursor );
@@ -1502,6 +1668,182 @@ static rc_t print_unaligned_database_full( const samdump_opts * const opts,
 }
 
 
+/* -------------------------------------------------------------------------------------------
+    multi-threaded dumping of all unaligned reads ( --threads N )
+
+    the rows of the SEQUENCE-table are cut into chunks of UNALIGNED_CHUNK_ROWS, each worker
+    has its own SEQUENCE/PRIMARY_ALIGNMENT cursors, the dump-pool writes the chunks in order
+   -------------------------------------------------------------------------------------------*/
+
+#define UNALIGNED_CHUNK_ROWS ( 1024 * 64 )
+
+typedef struct unaligned_pool_ctx
+{
+    const samdump_opts * opts;
+    const input_table * seq;
+    const input_table * prim;
+    const matecache * mc;
+    const input_database * ids;
+} unaligned_pool_ctx;
+
+
+typedef struct unaligned_worker
+{
+    const unaligned_pool_ctx * pctx;
+    seq_table_ctx stx;
+    prim_table_ctx ptx;
+} unaligned_worker;
+
+
+typedef struct unaligned_job
+{
+    int64_t first_row;
+    uint64_t row_count;
+} unaligned_job;
+
+
+static void CC unaligned_worker_end( void * worker_data )
+{
+    unaligned_worker * w = worker_data;
+    if ( w != NULL )
+    {
+        VCursorRelease( w->ptx.cursor );
+        VCursorRelease( w->stx.cursor );
+        free( w );
+    }
+}
+
+
+static rc_t CC unaligned_worker_start( void * pool_data, void ** worker_data )
+{
+    rc_t rc = 0;
+    unaligned_worker * w = calloc( 1, sizeof * w );
+    *worker_data = w;
+    if ( w == NULL )
+    {
+        rc = RC( rcExe, rcThread, rcConstructing, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot create unaligned worker" );
+    }
+    else
+    {
+        const unaligned_pool_ctx * pctx = pool_data;
+        w->pctx = pctx;
+        rc = prepare_seq_table_ctx( pctx->opts, pctx->seq, &w->stx );
+        if ( rc == 0 )
+        {
+            rc = VCursorOpen( w->stx.cursor );
+            if ( rc != 0 )
+            {
+                (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorOpen( SEQUENCE ) for $(tn) failed", "tn=%s", pctx->seq->path ) );
+            }
+        }
+        if ( rc == 0 && pctx->opts->output_format == of_sam )
+            rc = prepare_prim_table_ctx( pctx->opts, pctx->prim, &w->ptx );
+    }
+    return rc;
+}
+
+
+static rc_t CC unaligned_job_run( void * job, void * worker_data )
+{
+    unaligned_job * j = job;
+    unaligned_worker * w = worker_data;
+    const unaligned_pool_ctx * pctx = w->pctx;
+    return print_unaligned_rows( pctx->opts, &w->stx, &w->ptx, pctx->mc, pctx->ids, j->first_row, j->row_count );
+}
+
+
+static void CC unaligned_job_release( void * job )
+{
+    free( job );
+}
+
+
+static rc_t get_seq_row_range( const samdump_opts * const opts,
+                               const input_table * const seq,
+                               int64_t * first_row,
+                               uint64_t * row_count )
+{
+    seq_table_ctx stx;
+    rc_t rc = prepare_seq_table_ctx( opts, seq, &stx );
+    if ( rc == 0 )
+    {
+        rc = VCursorOpen( stx.cursor );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorOpen( SEQUENCE ) for $(tn) failed", "tn=%s", seq->path ) );
+        }
+        else
+        {
+            rc = VCursorIdRange( stx.cursor, stx.read_type_idx, first_row, row_count );
+            if ( rc != 0 )
+            {
+                (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorIdRange( SEQUENCE ) for $(tn) failed", "tn=%s", seq->path ) );
+            }
+        }
+        VCursorRelease( stx.cursor );
+    }
+    return rc;
+}
+
+
+/* same output as print_unaligned_database_full(), spread over worker-threads */
+static rc_t print_unaligned_database_full_mt( const samdump_opts * const opts,
+                                              const input_table * const seq,
+                                              const input_table * const prim,
+                                              const matecache * const mc,
+                                              const input_database * const ids )
+{
+    int64_t first_row;
+    uint64_t row_count;
+    rc_t rc = get_seq_row_range( opts, seq, &first_row, &row_count );
+    if ( rc == 0 )
+    {
+        unaligned_pool_ctx pctx;
+        dump_pool_callbacks cb;
+        struct dump_pool * pool;
+
+        pctx.opts = opts;
+        pctx.seq = seq;
+        pctx.prim = prim;
+        pctx.mc = mc;
+        pctx.ids = ids;
+
+        cb.on_worker_start = unaligned_worker_start;
+        cb.on_job = unaligned_job_run;
+        cb.on_worker_end = unaligned_worker_end;
+        cb.release_job = unaligned_job_release;
+        cb.pool_data = &pctx;
+
+        rc = make_dump_pool( &pool, opts->num_threads, &cb );
+        if ( rc == 0 )
+        {
+            rc_t rc2;
+            uint64_t done;
+            for ( done = 0; done < row_count && rc == 0; done += UNALIGNED_CHUNK_ROWS )
+            {
+                unaligned_job * job = malloc( sizeof * job );
+                if ( job == NULL )
+                {
+                    rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                    (void)LOGERR( klogErr, rc, "cannot create unaligned job" );
+                }
+                else
+                {
+                    job->first_row = first_row + done;
+                    job->row_count = ( row_count - done < UNALIGNED_CHUNK_ROWS ) ? row_count - done : UNALIGNED_CHUNK_ROWS;
+                    rc = dump_pool_submit( pool, job ); /* takes ownership of the job */
+                }
+            }
+            rc2 = dump_pool_finish( pool );
+            if ( rc == 0 )
+                rc = rc2;
+        }
+    }
+    return rc;
+}
+
+
 /* we are printing from a (legacy) table not from a database! */
 static rc_t print_unaligned_table( const samdump_opts * const opts,
                                    const input_table * const seq )
@@ -1595,6 +1937,10 @@ rc_t print_unaligned_spots( const samdump_opts * const opts,
                         {
                             rc = print_unaligned_database_filtered( opts, &seq, &prim, mc, ids );
                         }
+                        else if ( opts->num_threads > 0 )
+                        {
+                            rc = print_unaligned_database_full_mt( opts, &seq, &prim, mc, ids );
+                        }
                         else
                         {
                             rc = print_unaligned_database_full( opts, &seq, &prim, mc, ids );
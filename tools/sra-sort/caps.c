@@ -82,6 +82,7 @@ void CapsInit ( Caps *caps, const ctx_t *ctx )
                         else
                         {
                             caps -> tool = orig -> tool;
+                            caps -> journal = orig -> journal;
                         }
                     }
                 }
@@ -102,6 +103,7 @@ void CapsWhack ( Caps *self, const ctx_t *ctx )
         MemBank *mem;
 
         self -> tool = NULL;
+        self -> journal = NULL;
 
         rc = VDBManagerRelease ( self -> vdb );
         if ( rc != 0 )
@@ -39,6 +39,7 @@ struct KConfig;
 struct KDBManager;
 struct VDBManager;
 struct Tool;
+struct Journal;
 
 
 /*--------------------------------------------------------------------------
@@ -53,6 +54,9 @@ struct Caps
     struct KDBManager *kdb;
     struct VDBManager *vdb;
     struct Tool const *tool;
+
+    /* checkpoint journal - not reference counted */
+    struct Journal *journal;
 };
 
 
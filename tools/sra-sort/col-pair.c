@@ -758,7 +758,7 @@ void ColumnPairCopy ( ColumnPair *self, const ctx_t *ctx, RowSet *rs )
             while ( ! FAILED () )
             {
                 rc_t rc;
-                size_t i, count;
+                size_t count;
                 int64_t row_ids [ 8 * 1024 ];
 
                 ON_FAIL ( count = RowSetNext ( rs, ctx, row_ids, sizeof row_ids / sizeof row_ids [ 0 ] ) )
@@ -773,16 +773,7 @@ void ColumnPairCopy ( ColumnPair *self, const ctx_t *ctx, RowSet *rs )
                     break;
                 }
 
-                for ( i = 0; ! FAILED () && i < count; ++ i )
-                {
-                    const void *base;
-                    uint32_t elem_bits, boff, row_len;
-                    
-                    TRY ( base = ColumnReaderRead ( self -> reader, ctx, row_ids [ i ], & elem_bits, & boff, & row_len ) )
-                    {
-                        ColumnWriterWrite ( self -> writer, ctx, elem_bits, base, boff, row_len );
-                    }
-                }
+                ColumnPairCopyRows ( self, ctx, row_ids, count );
             }
 
             ColumnPairPostCopy ( self, ctx );
@@ -791,6 +782,43 @@ void ColumnPairCopy ( ColumnPair *self, const ctx_t *ctx, RowSet *rs )
 }
 
 
+/* CopyRows
+ *  copy an explicit run of rows from source to destination
+ */
+void ColumnPairCopyRows ( ColumnPair *self, const ctx_t *ctx,
+    const int64_t *row_ids, size_t count )
+{
+    FUNC_ENTRY ( ctx );
+
+    size_t i;
+    for ( i = 0; ! FAILED () && i < count; ++ i )
+    {
+        const void *base;
+        uint32_t elem_bits, boff, row_len;
+
+        TRY ( base = ColumnReaderRead ( self -> reader, ctx, row_ids [ i ], & elem_bits, & boff, & row_len ) )
+        {
+            ColumnWriterWrite ( self -> writer, ctx, elem_bits, base, boff, row_len );
+        }
+    }
+}
+
+
+/* IsIndependent
+ *  only the simple reader and writer are known to keep their state
+ *  in private cursors. every specialized writer may share the row map
+ *  of the table or depend upon the order of other pairs.
+ */
+bool ColumnPairIsIndependent ( const ColumnPair *self )
+{
+    return ! self -> is_static
+        && self -> reader != NULL
+        && self -> writer != NULL
+        && self -> reader -> vt == & SimpleColumnReader_vt
+        && self -> writer -> vt == & SimpleColumnWriter_vt;
+}
+
+
 /* CopyStatic
  *  copy static column from source to destination
  */
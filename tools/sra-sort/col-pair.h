@@ -314,6 +314,22 @@ void ColumnPairPostCopy ( const ColumnPair *self, const ctx_t *ctx );
 void ColumnPairCopy ( ColumnPair *self, const ctx_t *ctx, struct RowSet *rs );
 
 
+/* CopyRows
+ *  copy an explicit run of rows from source to destination
+ *  caller is responsible for PreCopy and PostCopy
+ */
+void ColumnPairCopyRows ( ColumnPair *self, const ctx_t *ctx,
+    const int64_t *row_ids, size_t count );
+
+
+/* IsIndependent
+ *  true if the pair reads and writes through cursors of its own
+ *  and shares no state with other pairs, so that it may be
+ *  copied concurrently with them
+ */
+bool ColumnPairIsIndependent ( const ColumnPair *self );
+
+
 /* CopyStatic
  *  copy static column from source to destination
  */
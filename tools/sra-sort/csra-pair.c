@@ -38,6 +38,7 @@ struct cSRAPair;
 #include "status.h"
 #include "mem.h"
 #include "map-file.h"
+#include "journal.h"
 
 #include <vdb/database.h>
 #include <vdb/table.h>
@@ -62,6 +63,12 @@ void cSRAPairWhack ( cSRAPair *self, const ctx_t *ctx )
     FUNC_ENTRY ( ctx );
 
     /* destroy me */
+    if ( ctx -> caps -> journal != NULL )
+    {
+        JournalForgetValue ( ctx -> caps -> journal, ctx, & self -> first_half_aligned_spot );
+        JournalForgetValue ( ctx -> caps -> journal, ctx, & self -> first_unaligned_spot );
+    }
+
     MapFileRelease ( self -> seq_idx, ctx );
     MapFileRelease ( self -> sa_idx, ctx );
     MapFileRelease ( self -> pa_idx, ctx );
@@ -219,7 +226,29 @@ DbPair *cSRAPairMake ( const ctx_t *ctx,
             };
             db -> dad . exclude_tbls = exclude_tbls;
 
-            return & db -> dad;
+            /* the SEQUENCE markers are gathered across tables,
+               so a resumed run must pick them up where it left off */
+            if ( ctx -> caps -> journal != NULL )
+            {
+                char key [ 4096 ];
+                rc_t rc = string_printf ( key, sizeof key, NULL, "%s/first-half-aligned-spot", db -> dad . full_spec );
+                if ( rc == 0 )
+                {
+                    TRY ( JournalAddValue ( ctx -> caps -> journal, ctx, key, & db -> first_half_aligned_spot ) )
+                    {
+                        rc = string_printf ( key, sizeof key, NULL, "%s/first-unaligned-spot", db -> dad . full_spec );
+                        if ( rc == 0 )
+                            JournalAddValue ( ctx -> caps -> journal, ctx, key, & db -> first_unaligned_spot );
+                    }
+                }
+                if ( rc != 0 )
+                    INTERNAL_ERROR ( rc, "failed to create journal key for '%s'", db -> dad . full_spec );
+            }
+
+            if ( ! FAILED () )
+                return & db -> dad;
+
+            DbPairDestroy ( & db -> dad, ctx );
         }
 
         MemFree ( ctx, db, sizeof * db );
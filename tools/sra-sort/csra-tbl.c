@@ -88,6 +88,10 @@ ColumnPair *cSRATblPairMakePrimAlignIdColPair ( cSRATblPair *self, const ctx_t *
     ColumnReader *reader;
     const char *colspec = "(I64)PRIMARY_ALIGNMENT_IDS";
 
+    /* kept from an earlier run */
+    if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+        return NULL;
+
     TRY ( reader = TablePairMakeAlignIdReader ( & self -> dad, ctx,
               csra -> prim_align, csra -> pa_idx, colspec ) )
     {
@@ -118,6 +122,10 @@ ColumnPair *cSRATblPairMakeSecAlignIdColPair ( cSRATblPair *self, const ctx_t *c
         ColumnReader *reader;
         const char *colspec = "(I64)SECONDARY_ALIGNMENT_IDS";
 
+        /* kept from an earlier run */
+        if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+            return NULL;
+
         TRY ( reader = TablePairMakeAlignIdReader ( & self -> dad, ctx,
                   csra -> sec_align, csra -> sa_idx, colspec ) )
         {
@@ -224,6 +232,10 @@ ColumnPair *cSRATblPairMakeSeqSpotIdColPairPrim ( cSRATblPair *self, const ctx_t
     ColumnReader *reader;
     const char *colspec = "(I64)SEQ_SPOT_ID";
 
+    /* kept from an earlier run */
+    if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+        return NULL;
+
     /* we expect this column to be present */
     TRY ( reader = TablePairMakeColumnReader ( & self -> dad, ctx, NULL, colspec, true ) )
     {
@@ -265,6 +277,10 @@ ColumnPair *cSRATblPairMakeSeqSpotIdColPair ( cSRATblPair *self, const ctx_t *ct
     ColumnReader *reader;
     const char *colspec = "(I64)SEQ_SPOT_ID";
 
+    /* kept from an earlier run */
+    if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+        return NULL;
+
     /* we expect this column to be present */
     TRY ( reader = TablePairMakeColumnReader ( & self -> dad, ctx, NULL, colspec, true ) )
     {
@@ -300,6 +316,10 @@ ColumnPair *cSRATblPairMakePoslenColPair ( cSRATblPair *self, const ctx_t *ctx,
     ColumnReader *reader;
     const char *colspec = "(U64)GLOBAL_POSLEN";
 
+    /* kept from an earlier run */
+    if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+        return NULL;
+
     /* we expect this column to be present */
     TRY ( reader = TablePairMakePoslenColReader ( & self -> dad, ctx, idx, colspec ) )
     {
@@ -522,6 +542,10 @@ ColumnPair *cSRATblPairMakeSeqPrimAlignIdColPair ( cSRATblPair *self, const ctx_
     ColumnReader *reader;
     const char *colspec = "(I64)PRIMARY_ALIGNMENT_ID";
 
+    /* kept from an earlier run */
+    if ( TablePairColumnDone ( & self -> dad, ctx, colspec ) )
+        return NULL;
+
     /* this column may not be present if there are no alignments */
     TRY ( reader = TablePairMakeColumnReader ( & self -> dad, ctx, NULL, colspec, false ) )
     {
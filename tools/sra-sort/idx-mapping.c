@@ -26,8 +26,16 @@
 
 #include "idx-mapping.h"
 #include "ctx.h"
+#include "caps.h"
+#include "mem.h"
+#include "except.h"
+#include "status.h"
+#include "sra-sort.h"
 
 #include <klib/sort.h>
+#include <kproc/thread.h>
+
+#include <string.h>
 
 FILE_ENTRY ( idx-mapping );
 
@@ -62,7 +70,7 @@ int64_t CC IdxMappingCmpNew ( const void *a, const void *b, void *data )
 #define SWAP( a, b, off, size ) KSORT_TSWAP ( IdxMapping, a, b )
 
 
-void IdxMappingSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count )
+void IdxMappingKSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count )
 {
 #define CMP( a, b ) \
     ( ( T ( a ) -> old_id < T ( b ) -> old_id ) ? -1 : ( T ( a ) -> old_id > T ( b ) -> old_id ) )
@@ -72,7 +80,7 @@ void IdxMappingSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count )
 #undef CMP
 }
 
-void IdxMappingSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count )
+void IdxMappingKSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count )
 {
 #define CMP( a, b ) \
     ( ( T ( a ) -> new_id < T ( b ) -> new_id ) ? -1 : ( T ( a ) -> new_id > T ( b ) -> new_id ) )
@@ -85,4 +93,276 @@ void IdxMappingSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count )
 #undef T
 #undef SWAP
 
+
+/*--------------------------------------------------------------------------
+ * IdxMappingRadix
+ *  LSD radix sort on one of the two 64-bit ids
+ *
+ *  each pass distributes the array on 8 bits of the key from "src"
+ *  into "dst", and the two buffers trade places. passes over bits
+ *  that are the same in every key are skipped, so ids of up to 2^40
+ *  take 5 passes rather than 8.
+ *
+ *  the array is cut into one contiguous slice per thread. every pass
+ *  has a counting phase, after which the slice histograms are turned
+ *  into output offsets in bucket-major, slice-minor order, and a
+ *  scatter phase. this keeps the sort stable, which LSD requires.
+ */
+#define RADIX_BITS 8
+#define RADIX_BUCKETS ( 1 << RADIX_BITS )
+#define RADIX_MAX_THREADS 64
+
+/* below these, the threads or the whole radix sort do not pay */
+#define RADIX_MIN_COUNT ( 256 * 1024 )
+#define RADIX_MIN_SLICE ( 1024 * 1024 )
+
+/* room for the page header of the scratch bank */
+#define RADIX_PAGE_SLACK 64
+
+enum
+{
+    radixScan,
+    radixCount,
+    radixScatter
+};
+
+typedef struct IdxMappingRadixSlice IdxMappingRadixSlice;
+struct IdxMappingRadixSlice
+{
+    const IdxMapping *src;
+    IdxMapping *dst;
+    size_t start, end;
+    uint64_t first, diff;
+    uint32_t shift;
+    uint32_t phase;
+    bool by_new;
+    size_t hist [ RADIX_BUCKETS ];
+};
+
+/* Key
+ *  flips the sign bit so that signed ids order as unsigned
+ */
+static __inline__
+uint64_t IdxMappingRadixKey ( const IdxMapping *self, bool by_new )
+{
+    return ( uint64_t ) ( by_new ? self -> new_id : self -> old_id ) ^ ( ( uint64_t ) 1 << 63 );
+}
+
+static
+rc_t CC IdxMappingRadixRun ( const KThread *t, void *data )
+{
+    IdxMappingRadixSlice *self = data;
+
+    size_t i;
+    uint64_t first, diff;
+    const bool by_new = self -> by_new;
+    const uint32_t shift = self -> shift;
+    const IdxMapping *src = self -> src;
+    IdxMapping *dst = self -> dst;
+
+    switch ( self -> phase )
+    {
+    case radixScan:
+        /* record the bits that differ among keys of the slice */
+        first = IdxMappingRadixKey ( & src [ self -> start ], by_new );
+        for ( diff = 0, i = self -> start; i < self -> end; ++ i )
+            diff |= IdxMappingRadixKey ( & src [ i ], by_new ) ^ first;
+        self -> first = first;
+        self -> diff = diff;
+        break;
+
+    case radixCount:
+        memset ( self -> hist, 0, sizeof self -> hist );
+        for ( i = self -> start; i < self -> end; ++ i )
+            ++ self -> hist [ ( IdxMappingRadixKey ( & src [ i ], by_new ) >> shift ) & ( RADIX_BUCKETS - 1 ) ];
+        break;
+
+    case radixScatter:
+        for ( i = self -> start; i < self -> end; ++ i )
+            dst [ self -> hist [ ( IdxMappingRadixKey ( & src [ i ], by_new ) >> shift ) & ( RADIX_BUCKETS - 1 ) ] ++ ] = src [ i ];
+        break;
+    }
+
+    return 0;
+}
+
+/* RunPhase
+ *  runs one phase over all slices, the first on the calling thread.
+ *  a slice whose thread cannot be started is run inline, so
+ *  failure to create threads only costs time.
+ */
+static
+void IdxMappingRadixRunPhase ( IdxMappingRadixSlice *slices, uint32_t num_slices, uint32_t phase,
+    const IdxMapping *src, IdxMapping *dst, uint32_t shift )
+{
+    uint32_t i;
+    KThread *threads [ RADIX_MAX_THREADS ];
+
+    for ( i = 0; i < num_slices; ++ i )
+    {
+        slices [ i ] . phase = phase;
+        slices [ i ] . src = src;
+        slices [ i ] . dst = dst;
+        slices [ i ] . shift = shift;
+    }
+
+    for ( i = 1; i < num_slices; ++ i )
+    {
+        if ( KThreadMake ( & threads [ i ], IdxMappingRadixRun, & slices [ i ] ) != 0 )
+        {
+            threads [ i ] = NULL;
+            IdxMappingRadixRun ( NULL, & slices [ i ] );
+        }
+    }
+
+    IdxMappingRadixRun ( NULL, & slices [ 0 ] );
+
+    for ( i = 1; i < num_slices; ++ i )
+    {
+        if ( threads [ i ] != NULL )
+        {
+            rc_t status;
+            KThreadWait ( threads [ i ], & status );
+            KThreadRelease ( threads [ i ] );
+        }
+    }
+}
+
+static
+void IdxMappingRadixSort ( IdxMapping *self, const ctx_t *ctx,
+    size_t count, uint32_t num_threads, bool by_new )
+{
+    FUNC_ENTRY ( ctx );
+
+    MemBank *bank;
+    uint32_t i, num_slices;
+    const size_t bytes = sizeof * self * count;
+    IdxMappingRadixSlice slices [ RADIX_MAX_THREADS ];
+
+    num_slices = num_threads;
+    if ( num_slices > RADIX_MAX_THREADS )
+        num_slices = RADIX_MAX_THREADS;
+    if ( ( size_t ) num_slices > count / RADIX_MIN_SLICE )
+        num_slices = ( uint32_t ) ( count / RADIX_MIN_SLICE );
+    if ( num_slices == 0 )
+        num_slices = 1;
+
+    /* the scratch buffer is a single page of a paged bank,
+       which places it in a memory-mapped file when so configured */
+    TRY ( bank = MemBankMakePaged ( ctx, bytes + RADIX_PAGE_SLACK, bytes + RADIX_PAGE_SLACK ) )
+    {
+        IdxMapping *scratch;
+        TRY ( scratch = MemBankAlloc ( bank, ctx, bytes, false ) )
+        {
+            uint64_t diff;
+            uint32_t shift;
+            IdxMapping *src = self, *dst = scratch;
+
+            for ( i = 0; i < num_slices; ++ i )
+            {
+                slices [ i ] . start = count * i / num_slices;
+                slices [ i ] . end = count * ( i + 1 ) / num_slices;
+                slices [ i ] . by_new = by_new;
+            }
+
+            IdxMappingRadixRunPhase ( slices, num_slices, radixScan, src, dst, 0 );
+            for ( diff = 0, i = 0; i < num_slices; ++ i )
+                diff |= slices [ i ] . diff | ( slices [ i ] . first ^ slices [ 0 ] . first );
+
+            for ( shift = 0; shift < 64; shift += RADIX_BITS )
+            {
+                size_t b, off;
+                IdxMapping *tmp;
+
+                if ( ( ( diff >> shift ) & ( RADIX_BUCKETS - 1 ) ) == 0 )
+                    continue;
+
+                IdxMappingRadixRunPhase ( slices, num_slices, radixCount, src, dst, shift );
+
+                for ( off = 0, b = 0; b < RADIX_BUCKETS; ++ b )
+                {
+                    for ( i = 0; i < num_slices; ++ i )
+                    {
+                        size_t n = slices [ i ] . hist [ b ];
+                        slices [ i ] . hist [ b ] = off;
+                        off += n;
+                    }
+                }
+
+                IdxMappingRadixRunPhase ( slices, num_slices, radixScatter, src, dst, shift );
+
+                tmp = src;
+                src = dst;
+                dst = tmp;
+            }
+
+            /* an odd number of passes leaves the result in scratch */
+            if ( src != self )
+                memmove ( self, src, bytes );
+        }
+
+        MemBankRelease ( bank, ctx );
+    }
+}
+
+void IdxMappingRadixSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count, uint32_t num_threads )
+{
+    FUNC_ENTRY ( ctx );
+    if ( count > 1 )
+        IdxMappingRadixSort ( self, ctx, count, num_threads, false );
+}
+
+void IdxMappingRadixSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count, uint32_t num_threads )
+{
+    FUNC_ENTRY ( ctx );
+    if ( count > 1 )
+        IdxMappingRadixSort ( self, ctx, count, num_threads, true );
+}
+
+
+/* UseRadix
+ *  radix sort needs a scratch copy of the array.
+ *  when that would exceed the memory limit, stay with KSORT.
+ */
+static
+bool IdxMappingUseRadix ( const ctx_t *ctx, size_t count )
+{
+    size_t in_use, quota, bytes;
+
+    if ( count < RADIX_MIN_COUNT )
+        return false;
+
+    /* memory-mapped pages are not charged against the quota */
+    if ( ctx -> caps -> tool -> mmapdir != NULL )
+        return true;
+
+    bytes = sizeof ( IdxMapping ) * count + RADIX_PAGE_SLACK;
+    in_use = MemInUse ( ctx, & quota );
+    if ( ( quota + 1 ) == 0 || ( in_use < quota && quota - in_use >= bytes ) )
+        return true;
+
+    STATUS ( 3, "insufficient memory for radix sort of %,zu entries - using ksort", count );
+    return false;
+}
+
+void IdxMappingSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( IdxMappingUseRadix ( ctx, count ) )
+        IdxMappingRadixSortOld ( self, ctx, count, ctx -> caps -> tool -> num_threads );
+    else
+        IdxMappingKSortOld ( self, ctx, count );
+}
+
+void IdxMappingSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( IdxMappingUseRadix ( ctx, count ) )
+        IdxMappingRadixSortNew ( self, ctx, count, ctx -> caps -> tool -> num_threads );
+    else
+        IdxMappingKSortNew ( self, ctx, count );
+}
+
 #endif /* USE_OLD_KSORT */
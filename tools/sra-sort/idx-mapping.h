@@ -50,10 +50,29 @@ int64_t CC IdxMappingCmpNew ( const void *a, const void *b, void *data );
 
 #else
 
-/* ksort_inlines */
+/* SortOld
+ * SortNew
+ *  sort on old_id or new_id
+ *  large arrays use a parallel radix sort when memory permits
+ */
 void IdxMappingSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count );
 void IdxMappingSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count );
 
+/* KSortOld
+ * KSortNew
+ *  ksort_inlines
+ */
+void IdxMappingKSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count );
+void IdxMappingKSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count );
+
+/* RadixSortOld
+ * RadixSortNew
+ *  LSD radix sort using up to "num_threads" threads
+ *  and a scratch array the size of the input
+ */
+void IdxMappingRadixSortOld ( IdxMapping *self, const ctx_t *ctx, size_t count, uint32_t num_threads );
+void IdxMappingRadixSortNew ( IdxMapping *self, const ctx_t *ctx, size_t count, uint32_t num_threads );
+
 #endif
 
 #endif /* _h_sra_sort_idx_mapping_ */
@@ -0,0 +1,185 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/*--------------------------------------------------------------------------
+ * idx-sort-bench
+ *  compares the IdxMapping sorts over synthetic ( old_id, new_id ) pairs
+ *
+ *  usage: idx-sort-bench [ -t threads ] [ count ... ]
+ *
+ *  old ids are scattered over a 40-bit space as they are in a large
+ *  cSRA, and new ids are dense. every count is sorted on old_id with
+ *  KSORT and with the radix sort, the results are compared, and the
+ *  radix sort then restores new_id order.
+ *  the default count is 10^7; 10^9 pairs require 32GB of memory.
+ */
+
+#include "idx-mapping.h"
+#include "ctx.h"
+#include "caps.h"
+#include "mem.h"
+#include "except.h"
+#include "sra-sort.h"
+
+#include <klib/time.h>
+
+#include <stdio.h>
+#include <string.h>
+
+FILE_ENTRY ( idx-sort-bench );
+
+
+static
+void make_pairs ( IdxMapping *pairs, size_t count )
+{
+    size_t i;
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+
+    for ( i = 0; i < count; ++ i )
+    {
+        /* xorshift64 */
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+
+        pairs [ i ] . old_id = ( int64_t ) ( x & ( ( ( uint64_t ) 1 << 40 ) - 1 ) ) + 1;
+        pairs [ i ] . new_id = ( int64_t ) i + 1;
+    }
+}
+
+static
+void bench ( const ctx_t *ctx, size_t count, uint32_t num_threads )
+{
+    FUNC_ENTRY ( ctx );
+
+    IdxMapping *a, *b;
+    const size_t bytes = sizeof * a * count;
+
+    TRY ( a = MemAlloc ( ctx, bytes, false ) )
+    {
+        TRY ( b = MemAlloc ( ctx, bytes, false ) )
+        {
+            size_t i;
+            KTime_t ksort_ms, radix_ms, restore_ms, start;
+
+            make_pairs ( a, count );
+            memmove ( b, a, bytes );
+
+            start = KTimeMsStamp ();
+            IdxMappingKSortOld ( a, ctx, count );
+            ksort_ms = KTimeMsStamp () - start;
+
+            start = KTimeMsStamp ();
+            IdxMappingRadixSortOld ( b, ctx, count, num_threads );
+            radix_ms = KTimeMsStamp () - start;
+
+            if ( ! FAILED () )
+            {
+                /* KSORT is not stable, so only keys are comparable */
+                for ( i = 0; i < count; ++ i )
+                {
+                    if ( a [ i ] . old_id != b [ i ] . old_id )
+                    {
+                        rc_t rc = RC ( rcExe, rcData, rcSorting, rcData, rcCorrupt );
+                        ERROR ( rc, "radix sort differs from ksort at entry %zu", i );
+                        break;
+                    }
+                }
+            }
+
+            if ( ! FAILED () )
+            {
+                start = KTimeMsStamp ();
+                IdxMappingRadixSortNew ( b, ctx, count, num_threads );
+                restore_ms = KTimeMsStamp () - start;
+
+                for ( i = 0; ! FAILED () && i < count; ++ i )
+                {
+                    if ( b [ i ] . new_id != ( int64_t ) i + 1 )
+                    {
+                        rc_t rc = RC ( rcExe, rcData, rcSorting, rcData, rcCorrupt );
+                        ERROR ( rc, "radix sort on new_id is out of order at entry %zu", i );
+                    }
+                }
+            }
+
+            if ( ! FAILED () )
+            {
+                printf ( "%14zu pairs: ksort %8lu ms, radix ( %u threads ) %8lu ms on old_id, %8lu ms on new_id, %.2fx\n"
+                         , count
+                         , ( unsigned long ) ksort_ms
+                         , num_threads
+                         , ( unsigned long ) radix_ms
+                         , ( unsigned long ) restore_ms
+                         , radix_ms == 0 ? 0.0 : ( double ) ksort_ms / radix_ms
+                    );
+            }
+
+            MemFree ( ctx, b, bytes );
+        }
+
+        MemFree ( ctx, a, bytes );
+    }
+}
+
+int main ( int argc, char *argv [] )
+{
+    DECLARE_CTX_INFO ();
+
+    int i;
+    Tool tp;
+    Caps caps;
+    bool any_count = false;
+    ctx_t main_ctx = { & caps, NULL, & ctx_info };
+    const ctx_t *ctx = & main_ctx;
+
+    CapsInit ( & caps, NULL );
+
+    memset ( & tp, 0, sizeof tp );
+    tp . num_threads = 1;
+    caps . tool = & tp;
+
+    TRY ( caps . mem = MemBankMake ( ctx, -1 ) )
+    {
+        for ( i = 1; ! FAILED () && i < argc; ++ i )
+        {
+            if ( strcmp ( argv [ i ], "-t" ) == 0 && i + 1 < argc )
+                tp . num_threads = ( uint32_t ) strtoul ( argv [ ++ i ], NULL, 0 );
+            else
+            {
+                any_count = true;
+                bench ( ctx, ( size_t ) strtod ( argv [ i ], NULL ), tp . num_threads );
+            }
+        }
+
+        if ( ! any_count && ! FAILED () )
+            bench ( ctx, 10 * 1000 * 1000, tp . num_threads );
+    }
+
+    CapsWhack ( & caps, ctx );
+
+    return main_ctx . rc != 0;
+}
@@ -0,0 +1,1164 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#include "journal.h"
+#include "map-file.h"
+#include "sra-sort.h"
+#include "ctx.h"
+#include "caps.h"
+#include "mem.h"
+#include "except.h"
+#include "status.h"
+
+#include <vdb/table.h>
+#include <vdb/vdb-priv.h>
+#include <kdb/table.h>
+#include <kdb/consistency-check.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+#include <insdc/sra.h>
+#include <klib/vector.h>
+#include <klib/printf.h>
+#include <klib/text.h>
+#include <klib/rc.h>
+#include <strtol.h>
+
+#include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+FILE_ENTRY ( journal );
+
+
+/*--------------------------------------------------------------------------
+ * JournalMap
+ *  a MapFile known to the journal
+ */
+typedef struct JournalMap JournalMap;
+struct JournalMap
+{
+    /* the map while it is open */
+    MapFile *live;
+
+    /* checkpoint holding its latest snapshot, or 0 */
+    uint32_t seq;
+
+    char name [ 1 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * JournalValue
+ *  a scalar saved with every checkpoint
+ */
+typedef struct JournalValue JournalValue;
+struct JournalValue
+{
+    /* the variable while it is registered */
+    int64_t *var;
+
+    /* the value loaded from the journal */
+    int64_t saved;
+
+    char key [ 1 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * JournalColumn
+ */
+typedef struct JournalColumn JournalColumn;
+struct JournalColumn
+{
+    /* false until the checkpoint following its commit */
+    bool committed;
+
+    char name [ 1 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * JournalTable
+ */
+typedef struct JournalTable JournalTable;
+struct JournalTable
+{
+    /* JournalColumn */
+    Vector cols;
+
+    int64_t first_id;
+    int64_t last_excl;
+
+    uint32_t phase;
+
+    /* committed columns have been checked */
+    bool verified;
+
+    char spec [ 1 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * Journal
+ */
+struct Journal
+{
+    KDirectory *wd;
+    KFile *f;
+
+    /* end of the last complete record */
+    uint64_t eof;
+
+    /* last completed checkpoint */
+    uint32_t seq;
+
+    /* id map file naming */
+    int pid;
+    char tmpdir [ 4096 ];
+
+    /* JournalMap, JournalValue, JournalTable */
+    Vector maps;
+    Vector values;
+    Vector tables;
+
+    /* loaded from an earlier run */
+    bool resumed;
+
+    char path [ 4096 ];
+};
+
+static const char *phase_names [] = { "new", "copying", "done" };
+
+
+/* entry helpers
+ */
+static
+void *JournalEntryMake ( const ctx_t *ctx, Vector *v, size_t hdr_size, size_t name_offset, const char *name )
+{
+    FUNC_ENTRY ( ctx );
+
+    char *entry;
+    size_t name_size = string_size ( name );
+
+    TRY ( entry = MemAlloc ( ctx, hdr_size + name_size, true ) )
+    {
+        rc_t rc;
+        strcpy ( entry + name_offset, name );
+
+        rc = VectorAppend ( v, NULL, entry );
+        if ( rc == 0 )
+            return entry;
+
+        SYSTEM_ERROR ( rc, "failed to add journal entry '%s'", name );
+        MemFree ( ctx, entry, hdr_size + name_size );
+    }
+
+    return NULL;
+}
+
+static
+void CC JournalMapWhack ( void *item, void *data )
+{
+    JournalMap *self = item;
+    MemFree ( ( const ctx_t* ) data, self, sizeof * self + string_size ( self -> name ) );
+}
+
+static
+void CC JournalValueWhack ( void *item, void *data )
+{
+    JournalValue *self = item;
+    MemFree ( ( const ctx_t* ) data, self, sizeof * self + string_size ( self -> key ) );
+}
+
+static
+void CC JournalColumnWhack ( void *item, void *data )
+{
+    JournalColumn *self = item;
+    MemFree ( ( const ctx_t* ) data, self, sizeof * self + string_size ( self -> name ) );
+}
+
+static
+void CC JournalTableWhack ( void *item, void *data )
+{
+    JournalTable *self = item;
+    VectorWhack ( & self -> cols, JournalColumnWhack, data );
+    MemFree ( ( const ctx_t* ) data, self, sizeof * self + string_size ( self -> spec ) );
+}
+
+static
+JournalMap *JournalFindMap ( const Journal *self, const char *name )
+{
+    uint32_t i, count = VectorLength ( & self -> maps );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalMap *map = VectorGet ( & self -> maps, i );
+        if ( strcmp ( map -> name, name ) == 0 )
+            return map;
+    }
+    return NULL;
+}
+
+static
+JournalMap *JournalMakeMap ( Journal *self, const ctx_t *ctx, const char *name )
+{
+    JournalMap *map = JournalFindMap ( self, name );
+    if ( map == NULL )
+    {
+        FUNC_ENTRY ( ctx );
+        map = JournalEntryMake ( ctx, & self -> maps,
+            sizeof * map, offsetof ( JournalMap, name ), name );
+    }
+    return map;
+}
+
+static
+JournalValue *JournalFindValue ( const Journal *self, const char *key )
+{
+    uint32_t i, count = VectorLength ( & self -> values );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalValue *val = VectorGet ( & self -> values, i );
+        if ( strcmp ( val -> key, key ) == 0 )
+            return val;
+    }
+    return NULL;
+}
+
+static
+JournalValue *JournalMakeValue ( Journal *self, const ctx_t *ctx, const char *key )
+{
+    JournalValue *val = JournalFindValue ( self, key );
+    if ( val == NULL )
+    {
+        FUNC_ENTRY ( ctx );
+        val = JournalEntryMake ( ctx, & self -> values,
+            sizeof * val, offsetof ( JournalValue, key ), key );
+    }
+    return val;
+}
+
+static
+JournalTable *JournalFindTable ( const Journal *self, const char *spec )
+{
+    uint32_t i, count = VectorLength ( & self -> tables );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalTable *tbl = VectorGet ( & self -> tables, i );
+        if ( strcmp ( tbl -> spec, spec ) == 0 )
+            return tbl;
+    }
+    return NULL;
+}
+
+static
+JournalTable *JournalMakeTable ( Journal *self, const ctx_t *ctx, const char *spec )
+{
+    JournalTable *tbl = JournalFindTable ( self, spec );
+    if ( tbl == NULL )
+    {
+        FUNC_ENTRY ( ctx );
+        TRY ( tbl = JournalEntryMake ( ctx, & self -> tables,
+                  sizeof * tbl, offsetof ( JournalTable, spec ), spec ) )
+        {
+            VectorInit ( & tbl -> cols, 0, 32 );
+            tbl -> phase = jtblNew;
+        }
+    }
+    return tbl;
+}
+
+/* strips typecast from colspec */
+static
+const char *colspec_name ( const char *colspec )
+{
+    const char *name = strrchr ( colspec, ')' );
+    return ( name == NULL ) ? colspec : name + 1;
+}
+
+static
+JournalColumn *JournalTableFindColumn ( const JournalTable *self, const char *name )
+{
+    uint32_t i, count = VectorLength ( & self -> cols );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalColumn *col = VectorGet ( & self -> cols, i );
+        if ( strcmp ( col -> name, name ) == 0 )
+            return col;
+    }
+    return NULL;
+}
+
+static
+JournalColumn *JournalTableMakeColumn ( JournalTable *self, const ctx_t *ctx, const char *name )
+{
+    JournalColumn *col = JournalTableFindColumn ( self, name );
+    if ( col == NULL )
+    {
+        FUNC_ENTRY ( ctx );
+        col = JournalEntryMake ( ctx, & self -> cols,
+            sizeof * col, offsetof ( JournalColumn, name ), name );
+    }
+    return col;
+}
+
+
+/* Write
+ *  append a line to the journal
+ */
+static
+void JournalWrite ( Journal *self, const ctx_t *ctx, const char *fmt, ... )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    size_t size;
+    char line [ 8192 ];
+
+    va_list args;
+    va_start ( args, fmt );
+    rc = string_vprintf ( line, sizeof line, & size, fmt, args );
+    va_end ( args );
+
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "failed to format journal line" );
+    else
+    {
+        size_t num_writ;
+        rc = KFileWriteAll ( self -> f, self -> eof, line, size, & num_writ );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to write journal '%s'", self -> path );
+        else if ( num_writ != size )
+        {
+            rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+            SYSTEM_ERROR ( rc, "failed to write journal '%s'", self -> path );
+        }
+        else
+        {
+            self -> eof += size;
+        }
+    }
+}
+
+
+/* Load
+ *  applies every record up to the last complete checkpoint
+ *
+ *  the journal is a text file of one item per line:
+ *    sra-sort-journal 1
+ *    src <path>
+ *    tmpdir <path>
+ *    pid <pid>
+ *  followed by checkpoint records:
+ *    ckpt <seq>
+ *    map <seq> <name>
+ *    value <value> <key>
+ *    table <phase> <first-id> <last-excl> <spec>
+ *    column <name> <spec>
+ *    end <seq>
+ */
+static
+char *JournalNextField ( char **linep )
+{
+    char *field = * linep;
+    char *sep = strchr ( field, ' ' );
+    if ( sep == NULL )
+        * linep = field + strlen ( field );
+    else
+    {
+        * sep = 0;
+        * linep = sep + 1;
+    }
+    return field;
+}
+
+static
+bool JournalParseI64 ( const char *field, int64_t *val )
+{
+    char *end;
+    * val = strtoi64 ( field, & end, 10 );
+    return field [ 0 ] != 0 && end [ 0 ] == 0;
+}
+
+static
+void JournalApplyLine ( Journal *self, const ctx_t *ctx, char *line, uint32_t lineno )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    int64_t val, first_id, last_excl;
+    const char *tag = JournalNextField ( & line );
+
+    if ( strcmp ( tag, "sra-sort-journal" ) == 0 )
+    {
+        if ( ! JournalParseI64 ( line, & val ) || val != 1 )
+        {
+            rc = RC ( rcExe, rcFile, rcReading, rcFormat, rcUnsupported );
+            ERROR ( rc, "journal '%s' has an unsupported version", self -> path );
+        }
+        return;
+    }
+
+    if ( strcmp ( tag, "src" ) == 0 )
+    {
+        const Tool *tp = ctx -> caps -> tool;
+        if ( strcmp ( line, tp -> src_path ) != 0 )
+        {
+            rc = RC ( rcExe, rcFile, rcReading, rcPath, rcInconsistent );
+            ERROR ( rc, "journal '%s' was written for source '%s'", self -> path, line );
+        }
+        return;
+    }
+
+    if ( strcmp ( tag, "tmpdir" ) == 0 )
+    {
+        if ( string_copy_measure ( self -> tmpdir, sizeof self -> tmpdir, line ) < sizeof self -> tmpdir )
+            return;
+    }
+    else if ( strcmp ( tag, "pid" ) == 0 )
+    {
+        if ( JournalParseI64 ( line, & val ) )
+        {
+            self -> pid = ( int ) val;
+            return;
+        }
+    }
+    else if ( strcmp ( tag, "ckpt" ) == 0 )
+    {
+        if ( JournalParseI64 ( line, & val ) )
+            return;
+    }
+    else if ( strcmp ( tag, "end" ) == 0 )
+    {
+        if ( JournalParseI64 ( line, & val ) )
+        {
+            self -> seq = ( uint32_t ) val;
+            return;
+        }
+    }
+    else if ( strcmp ( tag, "map" ) == 0 )
+    {
+        if ( JournalParseI64 ( JournalNextField ( & line ), & val ) && line [ 0 ] != 0 )
+        {
+            JournalMap *map;
+            TRY ( map = JournalMakeMap ( self, ctx, line ) )
+            {
+                map -> seq = ( uint32_t ) val;
+            }
+            return;
+        }
+    }
+    else if ( strcmp ( tag, "value" ) == 0 )
+    {
+        if ( JournalParseI64 ( JournalNextField ( & line ), & val ) && line [ 0 ] != 0 )
+        {
+            JournalValue *jv;
+            TRY ( jv = JournalMakeValue ( self, ctx, line ) )
+            {
+                jv -> saved = val;
+            }
+            return;
+        }
+    }
+    else if ( strcmp ( tag, "table" ) == 0 )
+    {
+        uint32_t phase;
+        const char *phase_name = JournalNextField ( & line );
+        for ( phase = jtblNew; phase <= jtblDone; ++ phase )
+        {
+            if ( strcmp ( phase_name, phase_names [ phase ] ) == 0 )
+                break;
+        }
+
+        if ( phase <= jtblDone &&
+             JournalParseI64 ( JournalNextField ( & line ), & first_id ) &&
+             JournalParseI64 ( JournalNextField ( & line ), & last_excl ) &&
+             line [ 0 ] != 0 )
+        {
+            JournalTable *tbl;
+            TRY ( tbl = JournalMakeTable ( self, ctx, line ) )
+            {
+                tbl -> phase = phase;
+                tbl -> first_id = first_id;
+                tbl -> last_excl = last_excl;
+            }
+            return;
+        }
+    }
+    else if ( strcmp ( tag, "column" ) == 0 )
+    {
+        const char *name = JournalNextField ( & line );
+        if ( name [ 0 ] != 0 && line [ 0 ] != 0 )
+        {
+            JournalTable *tbl;
+            TRY ( tbl = JournalMakeTable ( self, ctx, line ) )
+            {
+                JournalColumn *col;
+                TRY ( col = JournalTableMakeColumn ( tbl, ctx, name ) )
+                {
+                    col -> committed = true;
+                }
+            }
+            return;
+        }
+    }
+
+    rc = RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+    ERROR ( rc, "journal '%s' line %u is malformed", self -> path, lineno );
+}
+
+static
+void JournalParse ( Journal *self, const ctx_t *ctx, char *text, size_t size )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t lineno;
+    size_t off, end, limit;
+
+    /* find the end of the header and of the last complete checkpoint.
+       anything after it was written by a checkpoint that never finished */
+    for ( limit = off = 0, lineno = 1; off < size; off = end + 1, ++ lineno )
+    {
+        const char *nl = memchr ( & text [ off ], '\n', size - off );
+        if ( nl == NULL )
+            break;
+        end = nl - text;
+
+        if ( ( lineno == 4 && strncmp ( & text [ off ], "pid ", 4 ) == 0 ) ||
+             strncmp ( & text [ off ], "end ", 4 ) == 0 )
+        {
+            limit = end + 1;
+        }
+    }
+
+    if ( limit == 0 )
+    {
+        rc_t rc = RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+        ERROR ( rc, "journal '%s' has an incomplete header", self -> path );
+        return;
+    }
+
+    for ( off = 0, lineno = 1; ! FAILED () && off < limit; off = end + 1, ++ lineno )
+    {
+        end = ( const char* ) memchr ( & text [ off ], '\n', limit - off ) - text;
+        text [ end ] = 0;
+        JournalApplyLine ( self, ctx, & text [ off ], lineno );
+    }
+
+    self -> eof = limit;
+}
+
+static
+void JournalLoad ( Journal *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint64_t size;
+    rc_t rc = KFileSize ( self -> f, & size );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to determine size of journal '%s'", self -> path );
+    else
+    {
+        char *text;
+        TRY ( text = MemAlloc ( ctx, ( size_t ) size + 1, false ) )
+        {
+            size_t num_read;
+            rc = KFileReadAll ( self -> f, 0, text, ( size_t ) size, & num_read );
+            if ( rc != 0 )
+                SYSTEM_ERROR ( rc, "failed to read journal '%s'", self -> path );
+            else
+            {
+                TRY ( JournalParse ( self, ctx, text, num_read ) )
+                {
+                    /* drop the unfinished tail */
+                    rc = KFileSetSize ( self -> f, self -> eof );
+                    if ( rc != 0 )
+                        SYSTEM_ERROR ( rc, "failed to truncate journal '%s'", self -> path );
+                }
+            }
+
+            MemFree ( ctx, text, ( size_t ) size + 1 );
+        }
+    }
+}
+
+
+/* Path
+ *  the journal sits beside the destination
+ */
+static
+rc_t JournalPath ( const Tool *tp, char *path, size_t path_size )
+{
+    size_t dst_size = string_size ( tp -> dst_path );
+    while ( dst_size > 1 && tp -> dst_path [ dst_size - 1 ] == '/' )
+        -- dst_size;
+    return string_printf ( path, path_size, NULL,
+        "%.*s.sra-sort.journal", ( uint32_t ) dst_size, tp -> dst_path );
+}
+
+
+/* Exists
+ *  true if a journal for "tool->dst_path" is found
+ */
+bool JournalExists ( const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    bool exists = false;
+    char path [ 4096 ];
+    const Tool *tp = ctx -> caps -> tool;
+
+    rc_t rc = JournalPath ( tp, path, sizeof path );
+    if ( rc != 0 )
+        ERROR ( rc, "journal path for '%s' is too long", tp -> dst_path );
+    else
+    {
+        KDirectory *wd;
+        rc = KDirectoryNativeDir ( & wd );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to create native directory" );
+        else
+        {
+            exists = ( KDirectoryPathType ( wd, "%s", path ) & ~ kptAlias ) == kptFile;
+            KDirectoryRelease ( wd );
+        }
+    }
+
+    return exists;
+}
+
+
+/* Make
+ *  creates a new journal for "tool->dst_path"
+ *  or loads the existing one when "resume" is true
+ */
+Journal *JournalMake ( const ctx_t *ctx, bool resume )
+{
+    FUNC_ENTRY ( ctx );
+
+    Journal *self;
+    const Tool *tp = ctx -> caps -> tool;
+
+    TRY ( self = MemAlloc ( ctx, sizeof * self, true ) )
+    {
+        rc_t rc;
+
+        VectorInit ( & self -> maps, 0, 8 );
+        VectorInit ( & self -> values, 0, 8 );
+        VectorInit ( & self -> tables, 0, 16 );
+
+        rc = JournalPath ( tp, self -> path, sizeof self -> path );
+        if ( rc != 0 )
+            ERROR ( rc, "journal path for '%s' is too long", tp -> dst_path );
+        else if ( string_copy_measure ( self -> tmpdir, sizeof self -> tmpdir, tp -> tmpdir ) == sizeof self -> tmpdir )
+        {
+            rc = RC ( rcExe, rcPath, rcCopying, rcBuffer, rcInsufficient );
+            ERROR ( rc, "temporary directory path is too long" );
+        }
+        else
+        {
+            self -> pid = tp -> pid;
+
+            rc = KDirectoryNativeDir ( & self -> wd );
+            if ( rc != 0 )
+                SYSTEM_ERROR ( rc, "failed to create native directory" );
+            else if ( resume && ( KDirectoryPathType ( self -> wd, "%s", self -> path ) & ~ kptAlias ) == kptFile )
+            {
+                rc = KDirectoryOpenFileWrite ( self -> wd, & self -> f, true, "%s", self -> path );
+                if ( rc != 0 )
+                    SYSTEM_ERROR ( rc, "failed to open journal '%s'", self -> path );
+                else
+                {
+                    TRY ( JournalLoad ( self, ctx ) )
+                    {
+                        self -> resumed = true;
+                        STATUS ( 1, "resuming after checkpoint %u of journal '%s'", self -> seq, self -> path );
+                        if ( strcmp ( self -> tmpdir, tp -> tmpdir ) != 0 )
+                            STATUS ( 1, "using id map files kept in '%s'", self -> tmpdir );
+                        return self;
+                    }
+                }
+            }
+            else
+            {
+                if ( resume )
+                    STATUS ( 1, "no journal found at '%s' - starting from the beginning", self -> path );
+
+                rc = KDirectoryCreateFile ( self -> wd, & self -> f, true,
+                    0600, kcmInit | kcmParents, "%s", self -> path );
+                if ( rc != 0 )
+                    SYSTEM_ERROR ( rc, "failed to create journal '%s'", self -> path );
+                else
+                {
+                    TRY ( JournalWrite ( self, ctx, "sra-sort-journal 1\nsrc %s\ntmpdir %s\npid %d\n",
+                              tp -> src_path, self -> tmpdir, self -> pid ) )
+                    {
+                        STATUS ( 2, "recording checkpoints in '%s'", self -> path );
+                        return self;
+                    }
+                }
+            }
+        }
+
+        JournalRelease ( self, ctx );
+    }
+
+    return NULL;
+}
+
+
+/* Release
+ */
+void JournalRelease ( Journal *self, const ctx_t *ctx )
+{
+    if ( self != NULL )
+    {
+        FUNC_ENTRY ( ctx );
+
+        rc_t rc = KFileRelease ( self -> f );
+        if ( rc != 0 )
+            WARN ( "failed to close journal '%s'", self -> path );
+        KDirectoryRelease ( self -> wd );
+
+        VectorWhack ( & self -> maps, JournalMapWhack, ( void* ) ctx );
+        VectorWhack ( & self -> values, JournalValueWhack, ( void* ) ctx );
+        VectorWhack ( & self -> tables, JournalTableWhack, ( void* ) ctx );
+
+        MemFree ( ctx, self, sizeof * self );
+    }
+}
+
+
+/* Resumed
+ */
+bool JournalResumed ( const Journal *self )
+{
+    return self != NULL && self -> resumed;
+}
+
+
+/* Finish
+ *  removes the journal along with the snapshots and
+ *  id map files that it kept, once the run has succeeded
+ */
+void JournalFinish ( Journal *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    uint32_t i, count = VectorLength ( & self -> maps );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        const JournalMap *map = VectorGet ( & self -> maps, i );
+        if ( map -> seq != 0 )
+            KDirectoryRemove ( self -> wd, false, "%s.%s.%u", self -> path, map -> name, map -> seq );
+        MapFileRemoveForks ( ctx, map -> name );
+    }
+
+    rc = KFileRelease ( self -> f );
+    self -> f = NULL;
+    if ( rc == 0 )
+        rc = KDirectoryRemove ( self -> wd, false, "%s", self -> path );
+    if ( rc != 0 )
+        WARN ( "failed to remove journal '%s'", self -> path );
+}
+
+
+/* IdxFileParams
+ */
+void JournalIdxFileParams ( const Journal *self, const char **tmpdir, int *pid )
+{
+    * tmpdir = self -> tmpdir;
+    * pid = self -> pid;
+}
+
+
+/* AddMap
+ *  register an open MapFile to be saved at every checkpoint
+ */
+void JournalAddMap ( Journal *self, const ctx_t *ctx, const char *name, MapFile *map )
+{
+    FUNC_ENTRY ( ctx );
+
+    JournalMap *entry;
+    TRY ( entry = JournalMakeMap ( self, ctx, name ) )
+    {
+        entry -> live = map;
+    }
+}
+
+/* ForgetMap
+ */
+void JournalForgetMap ( Journal *self, const ctx_t *ctx, const MapFile *map )
+{
+    uint32_t i, count = VectorLength ( & self -> maps );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalMap *entry = VectorGet ( & self -> maps, i );
+        if ( entry -> live == map )
+            entry -> live = NULL;
+    }
+}
+
+/* OpenMapSnapshot
+ */
+const KFile *JournalOpenMapSnapshot ( Journal *self, const ctx_t *ctx, const char *name )
+{
+    const JournalMap *map = JournalFindMap ( self, name );
+    if ( map != NULL && map -> seq != 0 )
+    {
+        FUNC_ENTRY ( ctx );
+
+        const KFile *snap;
+        rc_t rc = KDirectoryOpenFileRead ( self -> wd, & snap, "%s.%s.%u", self -> path, name, map -> seq );
+        if ( rc == 0 )
+            return snap;
+
+        SYSTEM_ERROR ( rc, "failed to open snapshot %u of id map '%s'", map -> seq, name );
+    }
+
+    return NULL;
+}
+
+
+/* AddValue
+ */
+void JournalAddValue ( Journal *self, const ctx_t *ctx, const char *key, int64_t *var )
+{
+    FUNC_ENTRY ( ctx );
+
+    JournalValue *val = JournalFindValue ( self, key );
+    if ( val != NULL )
+        * var = val -> saved;
+    else
+    {
+        ON_FAIL ( val = JournalMakeValue ( self, ctx, key ) )
+            return;
+        val -> saved = * var;
+    }
+
+    val -> var = var;
+}
+
+/* ForgetValue
+ */
+void JournalForgetValue ( Journal *self, const ctx_t *ctx, const int64_t *var )
+{
+    uint32_t i, count = VectorLength ( & self -> values );
+    for ( i = 0; i < count; ++ i )
+    {
+        JournalValue *val = VectorGet ( & self -> values, i );
+        if ( val -> var == var )
+        {
+            val -> saved = * var;
+            val -> var = NULL;
+        }
+    }
+}
+
+
+/* TablePhase
+ */
+uint32_t JournalTablePhase ( const Journal *self, const char *tbl_spec )
+{
+    if ( self != NULL )
+    {
+        const JournalTable *tbl = JournalFindTable ( self, tbl_spec );
+        if ( tbl != NULL )
+            return tbl -> phase;
+    }
+    return jtblNew;
+}
+
+/* TableRange
+ */
+bool JournalTableRange ( const Journal *self, const char *tbl_spec,
+    int64_t *first_id, int64_t *last_excl )
+{
+    if ( self != NULL )
+    {
+        const JournalTable *tbl = JournalFindTable ( self, tbl_spec );
+        if ( tbl != NULL && tbl -> phase != jtblNew )
+        {
+            * first_id = tbl -> first_id;
+            * last_excl = tbl -> last_excl;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ColumnDone
+ */
+bool JournalColumnDone ( const Journal *self, const char *tbl_spec, const char *colspec )
+{
+    if ( self != NULL )
+    {
+        const JournalTable *tbl = JournalFindTable ( self, tbl_spec );
+        if ( tbl != NULL )
+        {
+            const JournalColumn *col = JournalTableFindColumn ( tbl, colspec_name ( colspec ) );
+            if ( col != NULL )
+                return col -> committed;
+        }
+    }
+    return false;
+}
+
+
+/* VerifyTable
+ *  checks the blob checksums and md5 files of the
+ *  committed columns of a table before they are kept
+ */
+typedef struct JournalVerifyData JournalVerifyData;
+struct JournalVerifyData
+{
+    const JournalTable *tbl;
+    rc_t rc;
+    uint32_t num_checked;
+    char failed [ 256 ];
+};
+
+static
+rc_t CC JournalVerifyReport ( const CCReportInfoBlock *what, void *data )
+{
+    rc_t rc = 0;
+    JournalVerifyData *pb = data;
+
+    /* only committed columns matter. the others are rewritten */
+    const JournalColumn *col;
+
+    if ( what -> objType != kptColumn )
+        return 0;
+    col = JournalTableFindColumn ( pb -> tbl, what -> objName );
+    if ( col == NULL || ! col -> committed )
+        return 0;
+
+    switch ( what -> type )
+    {
+    case ccrpt_Done:
+        rc = what -> info . done . rc;
+        if ( rc == 0 )
+            ++ pb -> num_checked;
+        break;
+    case ccrpt_MD5:
+        rc = what -> info . MD5 . rc;
+        break;
+    default:
+        break;
+    }
+
+    if ( rc != 0 && pb -> rc == 0 )
+    {
+        pb -> rc = rc;
+        string_copy_measure ( pb -> failed, sizeof pb -> failed, what -> objName );
+    }
+
+    /* keep going through the remaining columns */
+    return 0;
+}
+
+void JournalVerifyTable ( Journal *self, const ctx_t *ctx,
+    const char *tbl_spec, const VTable *dtbl )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i, count;
+    JournalTable *tbl = JournalFindTable ( self, tbl_spec );
+    if ( tbl == NULL || tbl -> verified )
+        return;
+
+    /* count the committed columns */
+    count = VectorLength ( & tbl -> cols );
+    for ( i = 0; i < VectorLength ( & tbl -> cols ); ++ i )
+    {
+        const JournalColumn *col = VectorGet ( & tbl -> cols, i );
+        if ( ! col -> committed )
+            -- count;
+    }
+
+    if ( count != 0 )
+    {
+        const KTable *ktbl;
+        rc_t rc = VTableOpenKTableRead ( dtbl, & ktbl );
+        if ( rc != 0 )
+            ERROR ( rc, "VTableOpenKTableRead failed on 'dst.%s'", tbl_spec );
+        else
+        {
+            JournalVerifyData pb;
+            const Tool *tp = ctx -> caps -> tool;
+
+            /* level 1 includes blob checksums */
+            uint32_t level = ( tp -> col . checksum != kcsNone ) ? 1 : 0;
+
+            memset ( & pb, 0, sizeof pb );
+            pb . tbl = tbl;
+
+            STATUS ( 2, "verifying %u columns of 'dst.%s' committed by an earlier run", count, tbl_spec );
+            rc = KTableConsistencyCheck ( ktbl, 0, level, JournalVerifyReport, & pb, SRA_PLATFORM_UNDEFINED );
+            if ( pb . rc != 0 )
+                ERROR ( pb . rc, "column 'dst.%s.%s' failed verification - cannot resume", tbl_spec, pb . failed );
+            else if ( pb . num_checked < count )
+            {
+                if ( rc == 0 )
+                    rc = RC ( rcExe, rcTable, rcValidating, rcColumn, rcIncomplete );
+                ERROR ( rc, "only %u of %u committed columns of 'dst.%s' could be verified - cannot resume",
+                        pb . num_checked, count, tbl_spec );
+            }
+            else
+            {
+                tbl -> verified = true;
+            }
+
+            KTableRelease ( ktbl );
+        }
+    }
+}
+
+
+/* NoteColumn
+ *  mark a column as committed by the next checkpoint
+ */
+void JournalNoteColumn ( Journal *self, const ctx_t *ctx,
+    const char *tbl_spec, const char *colspec )
+{
+    FUNC_ENTRY ( ctx );
+
+    JournalTable *tbl;
+    TRY ( tbl = JournalMakeTable ( self, ctx, tbl_spec ) )
+    {
+        JournalTableMakeColumn ( tbl, ctx, colspec_name ( colspec ) );
+    }
+}
+
+
+/* Checkpoint
+ *  saves open MapFiles and values, then appends a
+ *  record of the table's phase and noted columns
+ */
+static
+void JournalSaveMap ( Journal *self, const ctx_t *ctx, const JournalMap *map, uint32_t seq )
+{
+    FUNC_ENTRY ( ctx );
+
+    KFile *snap;
+    rc_t rc = KDirectoryCreateFile ( self -> wd, & snap, false,
+        0600, kcmInit, "%s.%s.%u", self -> path, map -> name, seq );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create snapshot %u of id map '%s'", seq, map -> name );
+    else
+    {
+        MapFileCheckpoint ( map -> live, ctx, snap );
+
+        rc = KFileRelease ( snap );
+        if ( rc != 0 && ! FAILED () )
+            SYSTEM_ERROR ( rc, "failed to close snapshot %u of id map '%s'", seq, map -> name );
+    }
+}
+
+void JournalCheckpoint ( Journal *self, const ctx_t *ctx, const char *tbl_spec,
+    uint32_t phase, int64_t first_id, int64_t last_excl )
+{
+    FUNC_ENTRY ( ctx );
+
+    JournalTable *tbl;
+    uint32_t i, count, seq = self -> seq + 1;
+
+    STATUS ( 3, "checkpoint %u: table '%s' %s", seq, tbl_spec, phase_names [ phase ] );
+
+    /* snapshot every open map */
+    count = VectorLength ( & self -> maps );
+    for ( i = 0; ! FAILED () && i < count; ++ i )
+    {
+        const JournalMap *map = VectorGet ( & self -> maps, i );
+        if ( map -> live != NULL )
+            JournalSaveMap ( self, ctx, map, seq );
+    }
+
+    if ( FAILED () )
+        return;
+
+    TRY ( tbl = JournalMakeTable ( self, ctx, tbl_spec ) )
+    {
+        /* the record only counts once its "end" line is written */
+        TRY ( JournalWrite ( self, ctx, "ckpt %u\n", seq ) )
+        {
+            for ( i = 0; ! FAILED () && i < count; ++ i )
+            {
+                const JournalMap *map = VectorGet ( & self -> maps, i );
+                if ( map -> live != NULL )
+                    JournalWrite ( self, ctx, "map %u %s\n", seq, map -> name );
+            }
+
+            for ( i = 0; ! FAILED () && i < VectorLength ( & self -> values ); ++ i )
+            {
+                const JournalValue *val = VectorGet ( & self -> values, i );
+                JournalWrite ( self, ctx, "value %ld %s\n", val -> var != NULL ? * val -> var : val -> saved, val -> key );
+            }
+
+            if ( ! FAILED () )
+                JournalWrite ( self, ctx, "table %s %ld %ld %s\n", phase_names [ phase ], first_id, last_excl, tbl_spec );
+
+            for ( i = 0; ! FAILED () && i < VectorLength ( & tbl -> cols ); ++ i )
+            {
+                const JournalColumn *col = VectorGet ( & tbl -> cols, i );
+                if ( ! col -> committed )
+                    JournalWrite ( self, ctx, "column %s %s\n", col -> name, tbl_spec );
+            }
+
+            if ( ! FAILED () )
+                JournalWrite ( self, ctx, "end %u\n", seq );
+        }
+
+        if ( ! FAILED () )
+        {
+            /* drop the snapshots superseded by this checkpoint */
+            for ( i = 0; i < count; ++ i )
+            {
+                JournalMap *map = VectorGet ( & self -> maps, i );
+                if ( map -> live != NULL )
+                {
+                    if ( map -> seq != 0 )
+                        KDirectoryRemove ( self -> wd, false, "%s.%s.%u", self -> path, map -> name, map -> seq );
+                    map -> seq = seq;
+                }
+            }
+
+            for ( i = 0; i < VectorLength ( & tbl -> cols ); ++ i )
+            {
+                JournalColumn *col = VectorGet ( & tbl -> cols, i );
+                col -> committed = true;
+            }
+
+            tbl -> phase = phase;
+            tbl -> first_id = first_id;
+            tbl -> last_excl = last_excl;
+            tbl -> verified = true;
+
+            self -> seq = seq;
+        }
+    }
+}
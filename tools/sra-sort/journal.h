@@ -0,0 +1,172 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_sra_sort_journal_
+#define _h_sra_sort_journal_
+
+#ifndef _h_sra_sort_defs_
+#include "sort-defs.h"
+#endif
+
+
+/*--------------------------------------------------------------------------
+ * forwards
+ */
+struct KFile;
+struct VTable;
+struct MapFile;
+
+
+/*--------------------------------------------------------------------------
+ * Journal
+ *  a checkpoint journal kept beside the destination object
+ *
+ *  a checkpoint is taken after a table's pre-copy phase, after the
+ *  commit of each of its column groups and after its post-copy phase.
+ *  it records the phase and id range of the table, the columns that
+ *  were committed and a snapshot of every open MapFile, so that a
+ *  later run can pick up from the last checkpoint with "--resume".
+ */
+typedef struct Journal Journal;
+
+
+/* table phases
+ */
+enum
+{
+    jtblNew,
+    jtblCopying,
+    jtblDone
+};
+
+
+/* Exists
+ *  true if a journal for "tool->dst_path" is found
+ */
+bool JournalExists ( const ctx_t *ctx );
+
+
+/* Make
+ *  creates a new journal for "tool->dst_path"
+ *  or loads the existing one when "resume" is true
+ */
+Journal *JournalMake ( const ctx_t *ctx, bool resume );
+
+
+/* Release
+ */
+void JournalRelease ( Journal *self, const ctx_t *ctx );
+
+
+/* Resumed
+ *  true if the journal was loaded from an earlier run
+ */
+bool JournalResumed ( const Journal *self );
+
+
+/* Finish
+ *  removes the journal along with the snapshots and
+ *  id map files that it kept, once the run has succeeded
+ */
+void JournalFinish ( Journal *self, const ctx_t *ctx );
+
+
+/* IdxFileParams
+ *  the temporary directory and pid of the run that
+ *  created the id map files, used to (re)open them
+ */
+void JournalIdxFileParams ( const Journal *self, const char **tmpdir, int *pid );
+
+
+/* AddMap
+ *  register an open MapFile to be saved at every checkpoint
+ */
+void JournalAddMap ( Journal *self, const ctx_t *ctx, const char *name, struct MapFile *map );
+
+/* ForgetMap
+ *  called when a MapFile is destroyed
+ *  its last snapshot is retained
+ */
+void JournalForgetMap ( Journal *self, const ctx_t *ctx, const struct MapFile *map );
+
+/* OpenMapSnapshot
+ *  returns the latest snapshot of the named map
+ *  or NULL if there is none
+ */
+struct KFile const *JournalOpenMapSnapshot ( Journal *self, const ctx_t *ctx, const char *name );
+
+
+/* AddValue
+ *  register a variable to be saved at every checkpoint
+ *  it receives the saved value if one was journaled
+ */
+void JournalAddValue ( Journal *self, const ctx_t *ctx, const char *key, int64_t *var );
+
+/* ForgetValue
+ */
+void JournalForgetValue ( Journal *self, const ctx_t *ctx, const int64_t *var );
+
+
+/* TablePhase
+ *  returns jtblNew if self is NULL or the table is unknown
+ */
+uint32_t JournalTablePhase ( const Journal *self, const char *tbl_spec );
+
+/* TableRange
+ *  returns true and the id range of the table when journaled
+ */
+bool JournalTableRange ( const Journal *self, const char *tbl_spec,
+    int64_t *first_id, int64_t *last_excl );
+
+/* ColumnDone
+ *  true if the column was committed by an earlier run
+ *  "colspec" may carry a typecast
+ */
+bool JournalColumnDone ( const Journal *self, const char *tbl_spec, const char *colspec );
+
+/* VerifyTable
+ *  checks the blob checksums and md5 files of the
+ *  committed columns of a table before they are kept
+ */
+void JournalVerifyTable ( Journal *self, const ctx_t *ctx,
+    const char *tbl_spec, struct VTable const *dtbl );
+
+
+/* NoteColumn
+ *  mark a column as committed by the next checkpoint
+ */
+void JournalNoteColumn ( Journal *self, const ctx_t *ctx,
+    const char *tbl_spec, const char *colspec );
+
+/* Checkpoint
+ *  saves open MapFiles and values, then appends a
+ *  record of the table's phase and noted columns
+ */
+void JournalCheckpoint ( Journal *self, const ctx_t *ctx, const char *tbl_spec,
+    uint32_t phase, int64_t first_id, int64_t last_excl );
+
+
+#endif /* _h_sra_sort_journal_ */
@@ -31,12 +31,14 @@
 #include "status.h"
 #include "mem.h"
 #include "sra-sort.h"
+#include "journal.h"
 
 #include <kfs/directory.h>
 #include <kfs/file.h>
 #include <kfs/buffile.h>
 #include <klib/refcount.h>
 #include <klib/sort.h>
+#include <klib/text.h>
 #include <klib/rc.h>
 
 #include <string.h>
@@ -48,6 +50,264 @@
 FILE_ENTRY ( map-file );
 
 
+/*--------------------------------------------------------------------------
+ * MapFileBlocks
+ *  an append-only sequence of 64-bit values
+ *
+ *  values are stored in blocks of MAP_BLOCK_IDS, each encoded as
+ *  zigzag varint deltas from the previous value. the new=>old ids
+ *  and poslen values are written in new-id order, where they are
+ *  mostly ascending, so the deltas usually take one or two bytes.
+ *
+ *  the block offset index and the unsealed tail block are kept in
+ *  memory. random access decodes a single block, and the last block
+ *  decoded is cached for the benefit of sequential readers.
+ */
+#define MAP_BLOCK_IDS 4096
+#define MAP_BLOCK_MAX_BYTES ( MAP_BLOCK_IDS * 10 )
+
+typedef struct MapFileBlocks MapFileBlocks;
+struct MapFileBlocks
+{
+    KFile *f;
+
+    /* file offset of every sealed block,
+       plus one more for the end of the last */
+    uint64_t *offsets;
+    size_t num_blocks;
+    size_t max_blocks;
+
+    /* total number of values appended */
+    uint64_t count;
+
+    /* values of the unsealed tail block */
+    int64_t *tail;
+
+    /* the most recently decoded block */
+    int64_t *cache;
+    size_t cache_block;
+
+    /* encoded block */
+    uint8_t *scratch;
+};
+
+static
+void MapFileBlocksInit ( MapFileBlocks *self, const ctx_t *ctx, KFile *f )
+{
+    FUNC_ENTRY ( ctx );
+
+    void *mem;
+    const size_t bytes = sizeof self -> tail [ 0 ] * MAP_BLOCK_IDS * 2 + MAP_BLOCK_MAX_BYTES;
+
+    memset ( self, 0, sizeof * self );
+
+    TRY ( mem = MemAlloc ( ctx, bytes, false ) )
+    {
+        self -> tail = mem;
+        self -> cache = self -> tail + MAP_BLOCK_IDS;
+        self -> scratch = ( uint8_t* ) ( self -> cache + MAP_BLOCK_IDS );
+        self -> cache_block = ( size_t ) -1;
+
+        TRY ( self -> offsets = MemAlloc ( ctx, sizeof self -> offsets [ 0 ] * ( 256 + 1 ), true ) )
+        {
+            self -> max_blocks = 256;
+            self -> f = f;
+            return;
+        }
+
+        MemFree ( ctx, mem, bytes );
+        self -> tail = NULL;
+    }
+}
+
+static
+void MapFileBlocksWhack ( MapFileBlocks *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( self -> tail != NULL )
+        MemFree ( ctx, self -> tail, sizeof self -> tail [ 0 ] * MAP_BLOCK_IDS * 2 + MAP_BLOCK_MAX_BYTES );
+    if ( self -> offsets != NULL )
+        MemFree ( ctx, self -> offsets, sizeof self -> offsets [ 0 ] * ( self -> max_blocks + 1 ) );
+
+    memset ( self, 0, sizeof * self );
+}
+
+static
+size_t MapFileBlocksEncode ( uint8_t *dst, const int64_t *values, size_t count )
+{
+    size_t i, len;
+    int64_t prior;
+
+    for ( prior = 0, len = i = 0; i < count; prior = values [ i ], ++ i )
+    {
+        /* zigzag - computed unsigned to wrap rather than overflow */
+        uint64_t delta = ( uint64_t ) values [ i ] - ( uint64_t ) prior;
+        uint64_t z = ( delta << 1 ) ^ ( uint64_t ) ( ( int64_t ) delta >> 63 );
+
+        /* varint */
+        for ( ; z >= 0x80; z >>= 7 )
+            dst [ len ++ ] = ( uint8_t ) ( z | 0x80 );
+        dst [ len ++ ] = ( uint8_t ) z;
+    }
+
+    return len;
+}
+
+static
+size_t MapFileBlocksDecode ( int64_t *values, size_t count, const uint8_t *src, size_t len )
+{
+    size_t i, off;
+    int64_t prior;
+
+    for ( prior = 0, off = i = 0; i < count && off < len; ++ i )
+    {
+        uint32_t shift;
+        uint64_t z = 0;
+
+        for ( shift = 0; off < len && shift < 64; shift += 7 )
+        {
+            uint8_t b = src [ off ++ ];
+            z |= ( uint64_t ) ( b & 0x7F ) << shift;
+            if ( ( b & 0x80 ) == 0 )
+                break;
+        }
+
+        prior = ( int64_t ) ( ( uint64_t ) prior + ( ( z >> 1 ) ^ ( 0 - ( z & 1 ) ) ) );
+        values [ i ] = prior;
+    }
+
+    return i;
+}
+
+static
+void MapFileBlocksSeal ( MapFileBlocks *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    size_t len, num_writ;
+    uint64_t pos = self -> offsets [ self -> num_blocks ];
+
+    /* make room in offset index */
+    if ( self -> num_blocks == self -> max_blocks )
+    {
+        uint64_t *offsets;
+        size_t max_blocks = self -> max_blocks * 2;
+        TRY ( offsets = MemAlloc ( ctx, sizeof offsets [ 0 ] * ( max_blocks + 1 ), false ) )
+        {
+            memmove ( offsets, self -> offsets, sizeof offsets [ 0 ] * ( self -> num_blocks + 1 ) );
+            MemFree ( ctx, self -> offsets, sizeof offsets [ 0 ] * ( self -> max_blocks + 1 ) );
+            self -> offsets = offsets;
+            self -> max_blocks = max_blocks;
+        }
+        CATCH_ALL ()
+        {
+            ANNOTATE ( "failed to extend block index to %zu entries", max_blocks );
+            return;
+        }
+    }
+
+    len = MapFileBlocksEncode ( self -> scratch, self -> tail, MAP_BLOCK_IDS );
+    rc = KFileWriteAll ( self -> f, pos, self -> scratch, len, & num_writ );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to write id map block" );
+    else if ( num_writ != len )
+    {
+        rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        SYSTEM_ERROR ( rc, "failed to write id map block" );
+    }
+    else
+    {
+        self -> offsets [ ++ self -> num_blocks ] = pos + len;
+    }
+}
+
+/* Append
+ *  add a value to the end of the sequence
+ */
+static
+void MapFileBlocksAppend ( MapFileBlocks *self, const ctx_t *ctx, int64_t value )
+{
+    self -> tail [ self -> count % MAP_BLOCK_IDS ] = value;
+    if ( ( ++ self -> count % MAP_BLOCK_IDS ) == 0 )
+    {
+        FUNC_ENTRY ( ctx );
+        MapFileBlocksSeal ( self, ctx );
+    }
+}
+
+/* Read
+ *  read up to "max_count" values starting at zero-based index "start"
+ *  returns the number read
+ */
+static
+size_t MapFileBlocksRead ( const MapFileBlocks *cself, const ctx_t *ctx,
+    uint64_t start, int64_t *values, size_t max_count )
+{
+    FUNC_ENTRY ( ctx );
+
+    size_t total;
+
+    /* the block cache is updated on read */
+    MapFileBlocks *self = ( MapFileBlocks* ) cself;
+
+    if ( start >= self -> count )
+        return 0;
+    if ( ( uint64_t ) max_count > self -> count - start )
+        max_count = ( size_t ) ( self -> count - start );
+
+    for ( total = 0; total < max_count; )
+    {
+        size_t n;
+        const int64_t *block;
+        uint64_t idx = start + total;
+        size_t block_idx = ( size_t ) ( idx / MAP_BLOCK_IDS );
+        size_t off = ( size_t ) ( idx % MAP_BLOCK_IDS );
+
+        if ( block_idx == self -> num_blocks )
+            block = self -> tail;
+        else
+        {
+            if ( block_idx != self -> cache_block )
+            {
+                rc_t rc;
+                size_t num_read;
+                uint64_t pos = self -> offsets [ block_idx ];
+                size_t len = ( size_t ) ( self -> offsets [ block_idx + 1 ] - pos );
+
+                rc = KFileReadAll ( self -> f, pos, self -> scratch, len, & num_read );
+                if ( rc != 0 )
+                {
+                    SYSTEM_ERROR ( rc, "failed to read id map block %zu", block_idx );
+                    break;
+                }
+                if ( num_read != len ||
+                     MapFileBlocksDecode ( self -> cache, MAP_BLOCK_IDS, self -> scratch, len ) != MAP_BLOCK_IDS )
+                {
+                    rc = RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+                    SYSTEM_ERROR ( rc, "failed to decode id map block %zu", block_idx );
+                    break;
+                }
+
+                self -> cache_block = block_idx;
+            }
+
+            block = self -> cache;
+        }
+
+        n = MAP_BLOCK_IDS - off;
+        if ( n > max_count - total )
+            n = max_count - total;
+
+        memmove ( & values [ total ], & block [ off ], n * sizeof values [ 0 ] );
+        total += n;
+    }
+
+    return total;
+}
+
+
 /*--------------------------------------------------------------------------
  * MapFile
  *  a file for storing id mappings
@@ -58,9 +318,12 @@ struct MapFile
     uint64_t num_ids;
     uint64_t num_mapped_ids;
     int64_t max_new_id;
-    KFile *f_old, *f_new, *f_pos;
+    KFile *f_old;
+    MapFileBlocks b_new, b_pos;
     size_t id_size;
+    size_t bsize;
     KRefcount refcount;
+    char name [ 1 ];
 };
 
 
@@ -75,17 +338,23 @@ void MapFileWhack ( MapFile *self, const ctx_t *ctx )
         SYSTEM_ERROR ( rc, "KFileRelease failed on old=>new" );
     else
     {
-        rc = KFileRelease ( self -> f_new );
+        rc = KFileRelease ( self -> b_new . f );
         if ( rc != 0 )
             ABORT ( rc, "KFileRelease failed on new=>old" );
-        else if ( self -> f_pos != NULL )
+        else if ( self -> b_pos . f != NULL )
         {
-            rc = KFileRelease ( self -> f_pos );
+            rc = KFileRelease ( self -> b_pos . f );
             if ( rc != 0 )
                 ABORT ( rc, "KFileRelease failed on global poslen temp column" );
         }
-        
-        MemFree ( ctx, self, sizeof * self );
+
+        MapFileBlocksWhack ( & self -> b_new, ctx );
+        MapFileBlocksWhack ( & self -> b_pos, ctx );
+
+        if ( ctx -> caps -> journal != NULL )
+            JournalForgetMap ( ctx -> caps -> journal, ctx, self );
+
+        MemFree ( ctx, self, sizeof * self + string_size ( self -> name ) );
     }
 }
 
@@ -93,25 +362,55 @@ void MapFileWhack ( MapFile *self, const ctx_t *ctx )
 /* Make
  *  creates an id map
  */
+static
+void MapFileForkParams ( const ctx_t *ctx, const char **tmpdir, int *pid )
+{
+    const Tool *tp = ctx -> caps -> tool;
+
+    /* a resumed run picks up the files of the run it continues */
+    if ( ctx -> caps -> journal != NULL )
+        JournalIdxFileParams ( ctx -> caps -> journal, tmpdir, pid );
+    else
+    {
+        * tmpdir = tp -> tmpdir;
+        * pid = tp -> pid;
+    }
+}
+
 static
 void MapFileMakeFork ( KFile **fp, const ctx_t *ctx, const char *name,
-    KDirectory *wd, const char *tmpdir, int pid, size_t bsize, const char *fork )
+    KDirectory *wd, size_t bsize, const char *fork, bool reopen )
 {
     FUNC_ENTRY ( ctx );
 
     /* create temporary KFile */
     rc_t rc;
+    int pid;
     KFile *backing;
+    const char *tmpdir;
 
-    rc = KDirectoryCreateFile ( wd, & backing, true,
-        0600, kcmInit | kcmParents, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
-    if ( rc != 0 )
-        SYSTEM_ERROR ( rc, "failed to create %s id map file '%s'", fork, name );
+    MapFileForkParams ( ctx, & tmpdir, & pid );
+
+    if ( reopen )
+    {
+        rc = KDirectoryOpenFileWrite ( wd, & backing, true, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to reopen %s id map file '%s'", fork, name );
+    }
     else
+    {
+        rc = KDirectoryCreateFile ( wd, & backing, true,
+            0600, kcmInit | kcmParents, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to create %s id map file '%s'", fork, name );
+    }
+
+    if ( rc == 0 )
     {
 #if ! WINDOWS
-        /* never try to remove files on Windows */
-        if ( ctx -> caps -> tool -> unlink_idx_files )
+        /* never try to remove files on Windows,
+           nor files that a checkpoint may need again */
+        if ( ctx -> caps -> tool -> unlink_idx_files && ctx -> caps -> journal == NULL )
         {
             /* unlink KFile */
             rc = KDirectoryRemove ( wd, false, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
@@ -129,41 +428,385 @@ void MapFileMakeFork ( KFile **fp, const ctx_t *ctx, const char *name,
     }
 }
 
+/* Flush
+ *  pushes buffered writes to the fork files
+ *  by closing and reopening them
+ */
+static
+void MapFileFlushFork ( KFile **fp, const ctx_t *ctx, const char *name,
+    KDirectory *wd, size_t bsize, const char *fork )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc = KFileRelease ( * fp );
+    * fp = NULL;
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to flush %s id map file '%s'", fork, name );
+    else
+        MapFileMakeFork ( fp, ctx, name, wd, bsize, fork, true );
+}
+
+static
+void MapFileFlush ( MapFile *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    KDirectory *wd;
+    rc_t rc = KDirectoryNativeDir ( & wd );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create native directory" );
+    else
+    {
+        TRY ( MapFileFlushFork ( & self -> f_old, ctx, self -> name, wd, self -> bsize, "old" ) )
+        {
+            TRY ( MapFileFlushFork ( & self -> b_new . f, ctx, self -> name, wd, 32 * 1024, "new" ) )
+            {
+                if ( self -> b_pos . f != NULL )
+                    MapFileFlushFork ( & self -> b_pos . f, ctx, self -> name, wd, 32 * 1024, "pos" );
+            }
+        }
+
+        KDirectoryRelease ( wd );
+    }
+}
+
+
+/* Checkpoint
+ *  writes the in-memory state of the map to "snap"
+ *  after flushing the fork files
+ *
+ *  snapshots are only ever read back by the same build
+ *  on the same host, and so are written in native byte order
+ */
+#define MAP_SNAP_MAGIC "MAPSNAP1"
+
+typedef struct MapFileSnapHdr MapFileSnapHdr;
+struct MapFileSnapHdr
+{
+    char magic [ 8 ];
+    int64_t first_id;
+    uint64_t num_ids;
+    uint64_t num_mapped_ids;
+    int64_t max_new_id;
+    uint64_t id_size;
+    uint64_t has_pos;
+};
+
+static
+void MapFileSnapWrite ( KFile *snap, const ctx_t *ctx, uint64_t *pos, const void *data, size_t size )
+{
+    FUNC_ENTRY ( ctx );
+
+    size_t num_writ;
+    rc_t rc = KFileWriteAll ( snap, * pos, data, size, & num_writ );
+    if ( rc == 0 && num_writ != size )
+        rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to write id map snapshot" );
+    else
+        * pos += size;
+}
+
+static
+void MapFileSnapRead ( const KFile *snap, const ctx_t *ctx, uint64_t *pos, void *data, size_t size )
+{
+    FUNC_ENTRY ( ctx );
+
+    size_t num_read;
+    rc_t rc = KFileReadAll ( snap, * pos, data, size, & num_read );
+    if ( rc == 0 && num_read != size )
+        rc = RC ( rcExe, rcFile, rcReading, rcData, rcInsufficient );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to read id map snapshot" );
+    else
+        * pos += size;
+}
+
+static
+void MapFileBlocksCheckpoint ( const MapFileBlocks *self, const ctx_t *ctx, KFile *snap, uint64_t *pos )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint64_t num_blocks = self -> num_blocks;
+    TRY ( MapFileSnapWrite ( snap, ctx, pos, & self -> count, sizeof self -> count ) )
+    {
+        TRY ( MapFileSnapWrite ( snap, ctx, pos, & num_blocks, sizeof num_blocks ) )
+        {
+            TRY ( MapFileSnapWrite ( snap, ctx, pos, self -> offsets,
+                      sizeof self -> offsets [ 0 ] * ( self -> num_blocks + 1 ) ) )
+            {
+                MapFileSnapWrite ( snap, ctx, pos, self -> tail,
+                    sizeof self -> tail [ 0 ] * ( size_t ) ( self -> count % MAP_BLOCK_IDS ) );
+            }
+        }
+    }
+}
+
+static
+void MapFileBlocksRestore ( MapFileBlocks *self, const ctx_t *ctx, const KFile *snap, uint64_t *pos )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint64_t num_blocks;
+    TRY ( MapFileSnapRead ( snap, ctx, pos, & self -> count, sizeof self -> count ) )
+    {
+        TRY ( MapFileSnapRead ( snap, ctx, pos, & num_blocks, sizeof num_blocks ) )
+        {
+            if ( num_blocks != self -> count / MAP_BLOCK_IDS )
+            {
+                rc_t rc = RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+                ERROR ( rc, "id map snapshot has %lu blocks for %lu ids", num_blocks, self -> count );
+                return;
+            }
+
+            /* make room in offset index */
+            if ( ( size_t ) num_blocks > self -> max_blocks )
+            {
+                uint64_t *offsets;
+                TRY ( offsets = MemAlloc ( ctx, sizeof offsets [ 0 ] * ( ( size_t ) num_blocks + 1 ), false ) )
+                {
+                    MemFree ( ctx, self -> offsets, sizeof offsets [ 0 ] * ( self -> max_blocks + 1 ) );
+                    self -> offsets = offsets;
+                    self -> max_blocks = ( size_t ) num_blocks;
+                }
+            }
+
+            TRY ( MapFileSnapRead ( snap, ctx, pos, self -> offsets,
+                      sizeof self -> offsets [ 0 ] * ( ( size_t ) num_blocks + 1 ) ) )
+            {
+                TRY ( MapFileSnapRead ( snap, ctx, pos, self -> tail,
+                          sizeof self -> tail [ 0 ] * ( size_t ) ( self -> count % MAP_BLOCK_IDS ) ) )
+                {
+                    self -> num_blocks = ( size_t ) num_blocks;
+                    self -> cache_block = ( size_t ) -1;
+                }
+            }
+        }
+    }
+}
+
+void MapFileCheckpoint ( MapFile *self, const ctx_t *ctx, KFile *snap )
+{
+    FUNC_ENTRY ( ctx );
+
+    MapFileSnapHdr hdr;
+    uint64_t pos = 0;
+
+    TRY ( MapFileFlush ( self, ctx ) )
+    {
+        memset ( & hdr, 0, sizeof hdr );
+        memmove ( hdr . magic, MAP_SNAP_MAGIC, sizeof hdr . magic );
+        hdr . first_id = self -> first_id;
+        hdr . num_ids = self -> num_ids;
+        hdr . num_mapped_ids = self -> num_mapped_ids;
+        hdr . max_new_id = self -> max_new_id;
+        hdr . id_size = self -> id_size;
+        hdr . has_pos = self -> b_pos . f != NULL;
+
+        TRY ( MapFileSnapWrite ( snap, ctx, & pos, & hdr, sizeof hdr ) )
+        {
+            TRY ( MapFileBlocksCheckpoint ( & self -> b_new, ctx, snap, & pos ) )
+            {
+                if ( self -> b_pos . f != NULL )
+                    MapFileBlocksCheckpoint ( & self -> b_pos, ctx, snap, & pos );
+            }
+        }
+    }
+
+    if ( FAILED () )
+        ANNOTATE ( "failed to checkpoint id map '%s'", self -> name );
+}
+
+/* Restore
+ *  reloads the state saved by MapFileCheckpoint
+ *  old=>new entries written after the checkpoint are cleared
+ */
+static
+void MapFileScrubOldToNew ( MapFile *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint64_t pos, eof;
+    char buff [ 32 * 1024 ];
+
+    /* the highest translated new-id known to the checkpoint */
+    int64_t limit = ( self -> max_new_id == 0 ) ? 0 : self -> max_new_id - self -> first_id + 1;
+
+    rc_t rc = KFileSize ( self -> f_old, & eof );
+    if ( rc != 0 )
+    {
+        SYSTEM_ERROR ( rc, "failed to determine size of old=>new map" );
+        return;
+    }
+    if ( eof > self -> num_ids * self -> id_size )
+        eof = self -> num_ids * self -> id_size;
+
+    for ( pos = 0; pos < eof; )
+    {
+        bool dirty;
+        size_t off, num_read, num_writ;
+        size_t to_read = sizeof buff - sizeof buff % self -> id_size;
+        if ( pos + to_read > eof )
+            to_read = ( size_t ) ( eof - pos );
+
+        rc = KFileReadAll ( self -> f_old, pos, buff, to_read, & num_read );
+        if ( rc != 0 )
+        {
+            SYSTEM_ERROR ( rc, "failed to read old=>new map" );
+            return;
+        }
+        num_read -= num_read % self -> id_size;
+        if ( num_read == 0 )
+            break;
+
+        for ( dirty = false, off = 0; off < num_read; off += self -> id_size )
+        {
+            int64_t unpacked = 0;
+            memmove ( & unpacked, & buff [ off ], self -> id_size );
+#if __BYTE_ORDER == __BIG_ENDIAN
+            unpacked = bswap_64 ( unpacked );
+#endif
+            if ( unpacked > limit )
+            {
+                memset ( & buff [ off ], 0, self -> id_size );
+                dirty = true;
+            }
+        }
+
+        if ( dirty )
+        {
+            rc = KFileWriteAll ( self -> f_old, pos, buff, num_read, & num_writ );
+            if ( rc == 0 && num_writ != num_read )
+                rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+            if ( rc != 0 )
+            {
+                SYSTEM_ERROR ( rc, "failed to clear old=>new map" );
+                return;
+            }
+        }
+
+        pos += num_read;
+    }
+}
+
+static
+void MapFileRestore ( MapFile *self, const ctx_t *ctx, const KFile *snap, bool for_poslen )
+{
+    FUNC_ENTRY ( ctx );
+
+    MapFileSnapHdr hdr;
+    uint64_t pos = 0;
+
+    TRY ( MapFileSnapRead ( snap, ctx, & pos, & hdr, sizeof hdr ) )
+    {
+        if ( memcmp ( hdr . magic, MAP_SNAP_MAGIC, sizeof hdr . magic ) != 0 ||
+             hdr . has_pos != ( uint64_t ) for_poslen || hdr . id_size > 8 )
+        {
+            rc_t rc = RC ( rcExe, rcFile, rcReading, rcFormat, rcUnrecognized );
+            ERROR ( rc, "bad snapshot of id map '%s'", self -> name );
+            return;
+        }
+
+        self -> first_id = hdr . first_id;
+        self -> num_ids = hdr . num_ids;
+        self -> num_mapped_ids = hdr . num_mapped_ids;
+        self -> max_new_id = hdr . max_new_id;
+        self -> id_size = ( size_t ) hdr . id_size;
+
+        TRY ( MapFileBlocksRestore ( & self -> b_new, ctx, snap, & pos ) )
+        {
+            if ( for_poslen )
+                MapFileBlocksRestore ( & self -> b_pos, ctx, snap, & pos );
+            if ( ! FAILED () && self -> num_ids != 0 )
+                MapFileScrubOldToNew ( self, ctx );
+        }
+    }
+
+    if ( FAILED () )
+        ANNOTATE ( "failed to restore id map '%s'", self -> name );
+    else
+    {
+        STATUS ( 2, "restored id map '%s' with %,lu of %,lu new ids assigned",
+                 self -> name, self -> b_new . count, self -> num_ids );
+    }
+}
+
 static
 MapFile *MapFileMakeInt ( const ctx_t *ctx, const char *name, bool random, bool for_poslen )
 {
     MapFile *mf;
-    TRY ( mf = MemAlloc ( ctx, sizeof * mf, true ) )
+    const KFile *snap = NULL;
+    Journal *journal = ctx -> caps -> journal;
+
+    /* a resumed run continues from the last snapshot */
+    if ( journal != NULL )
+    {
+        ON_FAIL ( snap = JournalOpenMapSnapshot ( journal, ctx, name ) )
+            return NULL;
+    }
+
+    TRY ( mf = MemAlloc ( ctx, sizeof * mf + string_size ( name ), true ) )
     {
         /* create KDirectory */
         KDirectory *wd;
         rc_t rc = KDirectoryNativeDir ( & wd );
+        strcpy ( mf -> name, name );
         if ( rc != 0 )
             SYSTEM_ERROR ( rc, "failed to create native directory" );
         else
         {
             const Tool *tp = ctx -> caps -> tool;
             size_t bsize = random ? tp -> map_file_random_bsize : tp -> map_file_bsize;
+            bool reopen = snap != NULL;
+            mf -> bsize = bsize;
 
             /* create old=>new id file */
-            TRY ( MapFileMakeFork ( & mf -> f_old, ctx, name, wd, tp -> tmpdir, tp -> pid, bsize, "old" ) )
+            TRY ( MapFileMakeFork ( & mf -> f_old, ctx, name, wd, bsize, "old", reopen ) )
             {
-                TRY ( MapFileMakeFork ( & mf -> f_new, ctx, name, wd, tp -> tmpdir, tp -> pid, 32 * 1024, "new" ) )
+                KFile *f_new;
+                TRY ( MapFileMakeFork ( & f_new, ctx, name, wd, 32 * 1024, "new", reopen ) )
                 {
-                    if ( for_poslen )
-                        MapFileMakeFork ( & mf -> f_pos, ctx, name, wd, tp -> tmpdir, tp -> pid, 32 * 1024, "pos" );
+                    TRY ( MapFileBlocksInit ( & mf -> b_new, ctx, f_new ) )
+                    {
+                        if ( for_poslen )
+                        {
+                            KFile *f_pos;
+                            TRY ( MapFileMakeFork ( & f_pos, ctx, name, wd, 32 * 1024, "pos", reopen ) )
+                            {
+                                ON_FAIL ( MapFileBlocksInit ( & mf -> b_pos, ctx, f_pos ) )
+                                    KFileRelease ( f_pos );
+                            }
+                        }
 
-                    KDirectoryRelease ( wd );
+                        KDirectoryRelease ( wd );
 
-                    if ( ! FAILED () )
-                    {
-                        /* this is our guy */
-                        KRefcountInit ( & mf -> refcount, 1, "MapFile", "make", name );
-                        
-                        return mf;
+                        if ( ! FAILED () && snap != NULL )
+                            MapFileRestore ( mf, ctx, snap, for_poslen );
+
+                        if ( ! FAILED () && journal != NULL )
+                            JournalAddMap ( journal, ctx, name, mf );
+
+                        if ( ! FAILED () )
+                        {
+                            /* this is our guy */
+                            KRefcountInit ( & mf -> refcount, 1, "MapFile", "make", name );
+
+                            KFileRelease ( snap );
+                            return mf;
+                        }
+
+                        /* whacking the blocks forgets their files */
+                        KFileRelease ( mf -> b_pos . f );
+                        MapFileBlocksWhack ( & mf -> b_pos, ctx );
+                        MapFileBlocksWhack ( & mf -> b_new, ctx );
+                        KFileRelease ( f_new );
+                        KFileRelease ( mf -> f_old );
+                        MemFree ( ctx, mf, sizeof * mf + string_size ( name ) );
+                        KFileRelease ( snap );
+                        return NULL;
                     }
 
-                    KFileRelease ( mf -> f_new );
+                    KFileRelease ( f_new );
                 }
 
                 KFileRelease ( mf -> f_old );
@@ -172,9 +815,10 @@ MapFile *MapFileMakeInt ( const ctx_t *ctx, const char *name, bool random, bool
             KDirectoryRelease ( wd );
         }
 
-        MemFree ( ctx, mf, sizeof * mf );
+        MemFree ( ctx, mf, sizeof * mf + string_size ( name ) );
     }
 
+    KFileRelease ( snap );
     return NULL;
 }
 
@@ -265,6 +909,10 @@ void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
         rc = RC ( rcExe, rcFile, rcUpdating, rcSelf, rcNull );
         INTERNAL_ERROR ( rc, "bad self" );
     }
+    else if ( self -> max_new_id != 0 && first_id == self -> first_id && num_ids == self -> num_ids )
+    {
+        /* restored from a checkpoint with the same range */
+    }
     else if ( self -> max_new_id != 0 )
     {
         rc = RC ( rcExe, rcFile, rcUpdating, rcConstraint, rcViolated );
@@ -286,6 +934,36 @@ void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
 }
 
 
+/* RemoveForks
+ *  removes the files of an id map that was kept for a checkpoint
+ */
+void MapFileRemoveForks ( const ctx_t *ctx, const char *name )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( ctx -> caps -> tool -> unlink_idx_files )
+    {
+        KDirectory *wd;
+        rc_t rc = KDirectoryNativeDir ( & wd );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to create native directory" );
+        else
+        {
+            int pid;
+            const char *tmpdir;
+            MapFileForkParams ( ctx, & tmpdir, & pid );
+
+            /* there is no poslen fork for most maps */
+            KDirectoryRemove ( wd, false, "%s/sra-sort-%s.old.%d", tmpdir, name, pid );
+            KDirectoryRemove ( wd, false, "%s/sra-sort-%s.new.%d", tmpdir, name, pid );
+            KDirectoryRemove ( wd, false, "%s/sra-sort-%s.pos.%d", tmpdir, name, pid );
+
+            KDirectoryRelease ( wd );
+        }
+    }
+}
+
+
 /* First
  *  return first mapped id
  */
@@ -384,32 +1062,28 @@ void MapFileSetNewToOld ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids
             size_t i;
             for ( i = 0; i < count; ++ i )
             {
-                size_t num_writ;
                 /* zero based index */
                 int64_t new_id = ids [ i ] . new_id - self -> first_id;
-                /* zero based byte offset */
-                uint64_t pos = new_id * self -> id_size;
                 /* 1-based translated old-id */
                 int64_t old_id = ids [ i ] . old_id - self -> first_id + 1;
                 assert ( new_id >= 0 );
                 assert ( old_id >= 0 );
-#if __BYTE_ORDER == __BIG_ENDIAN
-                old_id = bswap_64 ( old_id );
-#endif
-                rc = KFileWriteAll ( self -> f_new, pos, & old_id, self -> id_size, & num_writ );
-                if ( rc != 0 )
+
+                /* new ids are assigned in order, and so are written */
+                if ( ( uint64_t ) new_id != self -> b_new . count )
                 {
-                    SYSTEM_ERROR ( rc, "failed to write new=>old id mapping" );
+                    rc = RC ( rcExe, rcFile, rcWriting, rcId, rcOutoforder );
+                    INTERNAL_ERROR ( rc, "new id %,ld written out of order ( expected %,ld )",
+                        ids [ i ] . new_id, self -> first_id + ( int64_t ) self -> b_new . count );
                     break;
                 }
-                
-                if ( num_writ != self -> id_size )
+
+                ON_FAIL ( MapFileBlocksAppend ( & self -> b_new, ctx, old_id ) )
                 {
-                    rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
-                    SYSTEM_ERROR ( rc, "failed to write new=>old id mapping" );
+                    ANNOTATE ( "failed to write new=>old id mapping" );
                     break;
                 }
-                
+
                 self -> max_new_id = new_id + self -> first_id;
             }
         }
@@ -430,7 +1104,7 @@ void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids,
         rc = RC ( rcExe, rcFile, rcWriting, rcSelf, rcNull );
         INTERNAL_ERROR ( rc, "bad self reference" );
     }
-    else if ( self -> f_pos == NULL )
+    else if ( self -> b_pos . f == NULL )
     {
         rc = RC ( rcExe, rcFile, rcWriting, rcFile, rcIncorrect );
         INTERNAL_ERROR ( rc, "MapFile must be created with MapFileMakeForPoslen" );
@@ -443,27 +1117,20 @@ void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids,
     else
     {
         /* start writing after the last new id recorded */
-        uint64_t pos = ( self -> max_new_id - self -> first_id + 1 ) * sizeof ids -> new_id;
+        uint64_t idx = ( uint64_t ) ( self -> max_new_id - self -> first_id + 1 );
 
         size_t i;
-        for ( i = 0; i < count; pos += sizeof ids -> new_id, ++ i )
+        if ( idx != self -> b_pos . count )
         {
-            size_t num_writ;
-            int64_t poslen = ids [ i ] . new_id;
-#if __BYTE_ORDER == __BIG_ENDIAN
-            poslen = bswap_64 ( poslen );
-#endif
-            rc = KFileWriteAll ( self -> f_pos, pos, & poslen, sizeof ids -> new_id, & num_writ );
-            if ( rc != 0 )
-            {
-                SYSTEM_ERROR ( rc, "failed to write poslen temporary column" );
-                break;
-            }
-
-            if ( num_writ != sizeof ids -> new_id )
+            rc = RC ( rcExe, rcFile, rcWriting, rcId, rcOutoforder );
+            INTERNAL_ERROR ( rc, "poslen for id %,ld written out of order ( expected %,ld )",
+                self -> first_id + ( int64_t ) idx, self -> first_id + ( int64_t ) self -> b_pos . count );
+        }
+        else for ( i = 0; i < count; ++ i )
+        {
+            ON_FAIL ( MapFileBlocksAppend ( & self -> b_pos, ctx, ids [ i ] . new_id ) )
             {
-                rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
-                SYSTEM_ERROR ( rc, "failed to write poslen temporary column" );
+                ANNOTATE ( "failed to write poslen temporary column" );
                 break;
             }
         }
@@ -489,7 +1156,7 @@ size_t MapFileReadPoslen ( const MapFile *self, const ctx_t *ctx,
         rc = RC ( rcExe, rcFile, rcReading, rcSelf, rcNull );
         INTERNAL_ERROR ( rc, "bad self reference" );
     }
-    else if ( self -> f_pos == NULL )
+    else if ( self -> b_pos . f == NULL )
     {
         rc = RC ( rcExe, rcFile, rcReading, rcFile, rcIncorrect );
         INTERNAL_ERROR ( rc, "MapFile must be created with MapFileMakeForPoslen" );
@@ -517,24 +1184,10 @@ size_t MapFileReadPoslen ( const MapFile *self, const ctx_t *ctx,
         }
         else
         {
-            /* read as many bytes of id as possible */
-            size_t num_read, to_read = max_count * sizeof * poslen;
-            uint64_t pos = ( start_id - self -> first_id ) * sizeof * poslen;
-            rc = KFileReadAll ( self -> f_pos, pos, poslen, to_read, & num_read );
-            if ( rc != 0 )
-                SYSTEM_ERROR ( rc, "failed to read new=>old map" );
-            else
+            ON_FAIL ( total = MapFileBlocksRead ( & self -> b_pos, ctx,
+                          ( uint64_t ) ( start_id - self -> first_id ), ( int64_t* ) poslen, max_count ) )
             {
-                total = ( size_t ) ( num_read / sizeof * poslen );
-
-#if __BYTE_ORDER == __BIG_ENDIAN
-                {
-                    /* revert byte-order */
-                    size_t i;
-                    for ( i = 0; i < total; ++ i )
-                        poslen [ i ] = bswap_64 ( poslen [ i ] );
-                }
-#endif
+                ANNOTATE ( "failed to read poslen temporary column" );
             }
         }
     }
@@ -792,31 +1445,17 @@ size_t MapFileReadNewToOld ( const MapFile *self, const ctx_t *ctx,
         }
         else
         {
-            /* read as many bytes of id as possible */
-            size_t num_read, to_read = max_count * self -> id_size;
-            uint64_t pos = ( start_id - self -> first_id ) * self -> id_size;
-            rc = KFileReadAll ( self -> f_new, pos, ids, to_read, & num_read );
-            if ( rc != 0 )
-                SYSTEM_ERROR ( rc, "failed to read new=>old map" );
-            else
+            /* read ids into the first half of the buffer */
+            int64_t *packed = ( int64_t* ) ids;
+            TRY ( total = MapFileBlocksRead ( & self -> b_new, ctx,
+                      ( uint64_t ) ( start_id - self -> first_id ), packed, max_count ) )
             {
                 size_t i;
-                const char *packed = ( const char* ) ids;
-                total = ( size_t ) ( num_read /self -> id_size );
 
-                /* read each packed id as little-endian integer onto
-                   pre-zeroed 64-bit integer, swap if needed */
-                for ( num_read = total * self -> id_size, i = total; i > 0; )
+                /* expand in place from the end */
+                for ( i = total; i > 0; )
                 {
-                    int64_t unpacked = 0;
-
-                    num_read -= self -> id_size;
-                    -- i;
-
-                    memmove ( & unpacked, & packed [ num_read ], self -> id_size );
-#if __BYTE_ORDER == __BIG_ENDIAN
-                    unpacked = bswap_64 ( unpacked );
-#endif
+                    int64_t unpacked = packed [ -- i ];
                     if ( unpacked != 0 )
                         unpacked += self -> first_id - 1;
 
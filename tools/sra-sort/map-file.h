@@ -35,6 +35,7 @@
 /*--------------------------------------------------------------------------
  * forwards
  */
+struct KFile;
 struct IdxMapping;
 
 
@@ -78,6 +79,20 @@ void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
     int64_t first_id, uint64_t num_ids );
 
 
+/* Checkpoint
+ *  flushes the map files and writes the in-memory state to "snap"
+ *  a map created while a journal holds a snapshot for it is
+ *  restored to that state
+ */
+void MapFileCheckpoint ( MapFile *self, const ctx_t *ctx, struct KFile *snap );
+
+
+/* RemoveForks
+ *  removes the files of an id map kept for a checkpoint
+ */
+void MapFileRemoveForks ( const ctx_t *ctx, const char *name );
+
+
 /* First
  *  return first mapped id
  * Count
@@ -96,6 +111,7 @@ void MapFileSetOldToNew ( MapFile *self, const ctx_t *ctx,
 
 /* SetNewToOld
  *  write new=>old id mappings
+ *  ids must arrive in ascending new-id order without gaps
  */
 void MapFileSetNewToOld ( MapFile *self, const ctx_t *ctx,
     struct IdxMapping const *ids, size_t count );
@@ -103,6 +119,7 @@ void MapFileSetNewToOld ( MapFile *self, const ctx_t *ctx,
 
 /* SetPoslen
  *  write global position/length in new-id order
+ *  continues from the last new id recorded
  */
 void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx,
     struct IdxMapping const *ids, size_t count );
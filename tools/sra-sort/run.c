@@ -31,12 +31,14 @@
 #include "mem.h"
 #include "except.h"
 #include "status.h"
+#include "journal.h"
 
 #include <sra/sraschema.h>
 #include <vdb/manager.h>
 #include <vdb/schema.h>
 #include <vdb/database.h>
 #include <vdb/table.h>
+#include <kdb/manager.h>
 #include <kfg/config.h>
 #include <klib/text.h>
 #include <klib/rc.h>
@@ -223,6 +225,91 @@ VSchema *map_schema_types ( TypeParams *type, const ctx_t *ctx, const VSchema *s
     return NULL;
 }
 
+/* copy_db
+ *  creates the output database and copies into it
+ */
+static
+void copy_db ( const ctx_t *ctx, const VDatabase *src,
+    VSchema *dst_schema, const char *dst_type, KCreateMode cmode )
+{
+    FUNC_ENTRY ( ctx );
+
+    VDatabase *dst;
+    const Tool *tp = ctx -> caps -> tool;
+    rc_t rc = VDBManagerCreateDB ( ctx -> caps -> vdb, & dst, dst_schema,
+                                   dst_type, cmode, "%s", tp -> dst_path );
+    if ( rc != 0 )
+        ERROR ( rc, "VDBManagerCreateDB failed to create '%s' with type '%s'", tp -> dst_path, dst_type );
+    else
+    {
+        rc = VDatabaseColumnCreateParams ( dst, tp -> col . cmode, tp -> col . checksum, tp -> col . pgsize );
+        if ( rc != 0 )
+            ERROR ( rc, "VDatabaseColumnCreateParams: failed to set column create params on db '%s'", tp -> dst_path );
+        else
+        {
+            DbPair *pb;
+
+            /* TBD - this has to be fixed to use proper stuff */
+            const char *name = strrchr ( tp -> src_path, '/' );
+            if ( name ++ == NULL )
+                name = tp -> src_path;
+
+            TRY ( pb = DbPairMake ( ctx, src, dst, name ) )
+            {
+                DbPairRun ( pb, ctx );
+                DbPairRelease ( pb, ctx );
+            }
+        }
+
+        rc = VDatabaseRelease ( dst );
+        if ( rc != 0 )
+            ERROR ( rc, "VDatabaseRelease failed on '%s'", tp -> dst_path );
+    }
+}
+
+/* copy_db_journaled
+ *  copies under a checkpoint journal,
+ *  continuing an earlier run when it left one behind
+ */
+static
+void copy_db_journaled ( const ctx_t *ctx, const VDatabase *src,
+    VSchema *dst_schema, const char *dst_type )
+{
+    FUNC_ENTRY ( ctx );
+
+    Journal *journal;
+    const Tool *tp = ctx -> caps -> tool;
+
+    TRY ( journal = JournalMake ( ctx, tp -> resume ) )
+    {
+        Caps caps;
+        TRY ( CapsInit ( & caps, ctx ) )
+        {
+            ctx_t journal_ctx = { & caps, ctx, & ctx_info };
+            KCreateMode cmode = tp -> db . cmode;
+
+            /* keep what the earlier run wrote */
+            if ( JournalResumed ( journal ) )
+                cmode = kcmOpen | ( cmode & ~ kcmValueMask );
+
+            caps . journal = journal;
+
+            TRY ( copy_db ( & journal_ctx, src, dst_schema, dst_type, cmode ) )
+            {
+                JournalFinish ( journal, & journal_ctx );
+            }
+            CATCH_ALL ()
+            {
+                STATUS ( 0, "run again with '--resume' to continue from the last checkpoint" );
+            }
+
+            CapsWhack ( & caps, ctx );
+        }
+
+        JournalRelease ( journal, ctx );
+    }
+}
+
 /* open_db
  *  called from run
  *  determines the type of schema
@@ -278,36 +365,10 @@ void open_db ( const ctx_t *ctx, const VDatabase **srcp )
 
                 if ( ! FAILED () )
                 {
-                    VDatabase *dst;
-                    rc = VDBManagerCreateDB ( ctx -> caps -> vdb, & dst, dst_schema,
-                                              type . dst_type, tp -> db . cmode, "%s", tp -> dst_path );
-                    if ( rc != 0 )
-                        ERROR ( rc, "VDBManagerCreateDB failed to create '%s' with type '%s'", tp -> dst_path, type . dst_type );
+                    if ( tp -> checkpoint )
+                        copy_db_journaled ( ctx, src, dst_schema, type . dst_type );
                     else
-                    {
-                        rc = VDatabaseColumnCreateParams ( dst, tp -> col . cmode, tp -> col . checksum, tp -> col . pgsize );
-                        if ( rc != 0 )
-                            ERROR ( rc, "VDatabaseColumnCreateParams: failed to set column create params on db '%s'", tp -> dst_path );
-                        else
-                        {
-                            DbPair *pb;
-
-                            /* TBD - this has to be fixed to use proper stuff */
-                            const char *name = strrchr ( tp -> src_path, '/' );
-                            if ( name ++ == NULL )
-                                name = tp -> src_path;
-
-                            TRY ( pb = DbPairMake ( ctx, src, dst, name ) )
-                            {
-                                DbPairRun ( pb, ctx );
-                                DbPairRelease ( pb, ctx );
-                            }
-                        }
-
-                        rc = VDatabaseRelease ( dst );
-                        if ( rc != 0 )
-                            ERROR ( rc, "VDatabaseRelease failed on '%s'", tp -> dst_path );
-                    }
+                        copy_db ( ctx, src, dst_schema, type . dst_type, tp -> db . cmode );
                 }
 
                 VSchemaRelease ( dst_schema );
@@ -334,6 +395,41 @@ void open_tbl ( const ctx_t *ctx, const VTable **tblp )
     ERROR ( rc, "unimplemented function" );
 }
 
+/* check_journal
+ *  only databases are copied under a journal, and resuming
+ *  needs the journal of a destination that exists already
+ */
+static
+void check_journal ( const ctx_t *ctx, bool is_db )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    const Tool *tp = ctx -> caps -> tool;
+
+    if ( ! tp -> checkpoint )
+        return;
+
+    if ( ! is_db )
+    {
+        rc = RC ( rcExe, rcArgv, rcParsing, rcParam, rcUnsupported );
+        ERROR ( rc, "'--checkpoint' and '--resume' are only supported for database sources - '%s' is a table", tp -> src_path );
+    }
+    else if ( tp -> resume && ! tp -> force &&
+              ( KDBManagerPathType ( ctx -> caps -> kdb, "%s", tp -> dst_path ) & ~ kptAlias ) != kptNotFound )
+    {
+        bool exists;
+        TRY ( exists = JournalExists ( ctx ) )
+        {
+            if ( ! exists )
+            {
+                rc = RC ( rcExe, rcArgv, rcParsing, rcFile, rcNotFound );
+                ERROR ( rc, "destination '%s' exists but has no journal to resume from - try again with '-f'", tp -> dst_path );
+            }
+        }
+    }
+}
+
 /* run
  *  called from KMain
  *  determines the type of object being copied/sorted
@@ -351,7 +447,10 @@ void run ( const ctx_t *ctx )
     rc_t rc = VDBManagerOpenDBRead ( mgr, & db, NULL, "%s", tp -> src_path );
     if ( rc == 0 )
     {
-        open_db ( ctx, & db );
+        TRY ( check_journal ( ctx, true ) )
+        {
+            open_db ( ctx, & db );
+        }
         VDatabaseRelease ( db );
     }
     else
@@ -361,7 +460,10 @@ void run ( const ctx_t *ctx )
         if ( rc2 == 0 )
         {
             rc = 0;
-            open_tbl ( ctx, & tbl );
+            TRY ( check_journal ( ctx, false ) )
+            {
+                open_tbl ( ctx, & tbl );
+            }
             VTableRelease ( tbl );
         }
         else
@@ -374,7 +476,10 @@ void run ( const ctx_t *ctx )
                 if ( rc2 == 0 )
                 {
                     rc = 0;
-                    open_tbl ( ctx, & tbl );
+                    TRY ( check_journal ( ctx, false ) )
+                    {
+                        open_tbl ( ctx, & tbl );
+                    }
                     VTableRelease ( tbl );
                 }
                 
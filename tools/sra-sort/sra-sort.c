@@ -81,6 +81,9 @@ rc_t CC UsageSummary ( const char *prog_name )
 #define OPT_TEMP_DIR "tempdir"
 #define OPT_MMAP_DIR "mmapdir"
 #define OPT_UNSORTED_OLD_NEW "unsorted-old-new"
+#define OPT_THREADS "threads"
+#define OPT_CHECKPOINT "checkpoint"
+#define OPT_RESUME "resume"
 
 #define OPT_COLUMN_MD5 "column-md5"
 #define OPT_NO_COLUMN_CHECKSUM "no-column-checksum"
@@ -103,6 +106,12 @@ static const char *hlp_max_large_idx_ids [] = { "sets number of rows to process
 static const char *hlp_temp_dir [] = { "sets a specific directory to use for temporary files", NULL };
 static const char *hlp_mmap_dir [] = { "sets a specific directory to use for memory-mapped buffers", NULL };
 static const char *hlp_unsorted_old_new [] = { "write old=>new index in unsorted order", NULL };
+static const char *hlp_threads [] = { "sets number of threads copying columns concurrently",
+                                      "large columns are further limited by --mem-limit", NULL };
+static const char *hlp_checkpoint [] = { "record progress in a journal beside the destination",
+                                         "so that an interrupted run can be resumed", NULL };
+static const char *hlp_resume [] = { "continue an interrupted run from its last checkpoint",
+                                     "implies --" OPT_CHECKPOINT, NULL };
 
 static const char *hlp_column_md5 [] = { "generate md5sum compatible checksum files for each column [default]", NULL };
 static const char *hlp_no_column_checksum [] = { "disable generation of column checksums", NULL };
@@ -136,6 +145,9 @@ static OptDef options [] =
   , { OPT_TEMP_DIR, NULL, NULL, hlp_temp_dir, 1, true, false }
   , { OPT_MMAP_DIR, NULL, NULL, hlp_mmap_dir, 1, true, false }
   , { OPT_UNSORTED_OLD_NEW, NULL, NULL, hlp_unsorted_old_new, 1, false, false }
+  , { OPT_THREADS, NULL, NULL, hlp_threads, 1, true, false }
+  , { OPT_CHECKPOINT, NULL, NULL, hlp_checkpoint, 1, false, false }
+  , { OPT_RESUME, NULL, NULL, hlp_resume, 1, false, false }
 
   , { OPT_COLUMN_MD5, NULL, NULL, hlp_column_md5, 1, false, false }
   , { OPT_NO_COLUMN_CHECKSUM, NULL, NULL, hlp_no_column_checksum, 1, false, false }
@@ -160,6 +172,9 @@ static const char *option_params [] =
   , "path-to-tmp"
   , "path-to-mmaps"
   , NULL
+  , "count"
+  , NULL
+  , NULL
   , NULL
   , NULL
   , NULL
@@ -339,6 +354,10 @@ void initialize_params ( const ctx_t *ctx, Caps *caps, Tool *tp, Selection *sel,
     tp -> min_idx_ids =  64 * 1024 * 1024;
     tp -> max_missing_ids = tp -> max_idx_ids;
 
+    /* default to copying one column at a time */
+    tp -> num_threads = 1;
+    tp -> large_col_mem = 512 * 1024 * 1024;
+
 #if 0
     /* refpos cache size */
     tp -> refpos_cache_capacity = 100 * 1024 * 1024;
@@ -364,6 +383,9 @@ void initialize_params ( const ctx_t *ctx, Caps *caps, Tool *tp, Selection *sel,
     /* normally do not force overwrite */
     tp -> force = false;
 
+    /* normally run without a journal */
+    tp -> checkpoint = tp -> resume = false;
+
     /* not needed under normal circumstances */
     tp -> write_new_to_old = false;
 tp->write_new_to_old=true;
@@ -401,6 +423,21 @@ tp->write_new_to_old=true;
     if ( found )
         tp -> max_ref_idx_ids = ( size_t ) val;
 
+    ON_FAIL ( val = KConfigGetNodeU64 ( ctx, "sra-sort/checkpoint", & found ) )
+        return;
+    if ( found )
+        tp -> checkpoint = val != 0;
+
+    ON_FAIL ( val = KConfigGetNodeU64 ( ctx, "sra-sort/threads", & found ) )
+        return;
+    if ( found )
+        tp -> num_threads = ( uint32_t ) val;
+
+    ON_FAIL ( val = KConfigGetNodeU64 ( ctx, "sra-sort/large_col_mem", & found ) )
+        return;
+    if ( found )
+        tp -> large_col_mem = ( size_t ) val;
+
     /* finally look in args */
     ON_FAIL ( str = ArgsGetOptStr ( args, ctx, OPT_TEMP_DIR, & count ) )
         return;
@@ -432,6 +469,13 @@ tp->write_new_to_old=true;
     if ( count != 0 )
         tp -> max_large_idx_ids = ( size_t ) val;
 
+    ON_FAIL ( val = ArgsGetOptU64 ( args, ctx, OPT_THREADS, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> num_threads = ( uint32_t ) val;
+    if ( tp -> num_threads == 0 )
+        tp -> num_threads = 1;
+
     ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_IGNORE_FAILURE, & count ) )
         return;
     if ( count != 0 )
@@ -441,6 +485,16 @@ tp->write_new_to_old=true;
         return;
     if ( count != 0 )
         tp -> force = true;
+
+    ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_CHECKPOINT, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> checkpoint = true;
+
+    ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_RESUME, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> checkpoint = tp -> resume = true;
    
     ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_UNSORTED_OLD_NEW, & count ) )
         return;
@@ -711,6 +765,11 @@ rc_t CC KMain ( int argc, char *argv [] )
                                                             rc = RC ( rcExe, rcArgv, rcParsing, rcArgv, rcIncorrect );
                                                             ERROR ( rc, "source and destination object types are not compatible" );
                                                         }
+                                                        else if ( tp . resume && ! tp . force )
+                                                        {
+                                                            /* opened for update if its journal is found,
+                                                               rejected by run otherwise */
+                                                        }
                                                         else if ( ! tp . force )
                                                         {
                                                             rc = RC ( rcExe, targ, rcCopying, targ, rcExists );
@@ -95,6 +95,12 @@ struct Tool
     /* the number of missing SEQUENCE ids to gather at a time */
     size_t max_missing_ids;
 
+    /* memory budgeted for each large column copied concurrently */
+    size_t large_col_mem;
+
+    /* the number of threads copying columns of a group */
+    uint32_t num_threads;
+
     /* pid of tool */
     int pid;
 
@@ -124,6 +130,11 @@ struct Tool
     /* force overwrite */
     bool force;
 
+    /* keep a checkpoint journal, and
+       continue from one left by an earlier run */
+    bool checkpoint;
+    bool resume;
+
     /* write new=>old mappings
        not normally needed */
     bool write_new_to_old;
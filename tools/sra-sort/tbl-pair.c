@@ -38,6 +38,7 @@ typedef struct TablePair StdTblPair;
 #include "status.h"
 #include "mem.h"
 #include "sra-sort.h"
+#include "journal.h"
 
 #include <vdb/table.h>
 #include <vdb/cursor.h>
@@ -48,6 +49,8 @@ typedef struct TablePair StdTblPair;
 #include <klib/namelist.h>
 #include <klib/rc.h>
 #include <kproc/thread.h> /* KThreadWait */
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include <string.h>
 
@@ -216,6 +219,415 @@ void CC TablePairReleaseColumnPair ( void *item, void *data )
 }
 
 
+/* DouseColumns
+ *  releases a group of columns, recording the committed
+ *  ones in the journal with a checkpoint when there is one
+ */
+static
+void TablePairDouseColumns ( TablePair *self, const ctx_t *ctx, Vector *cols, bool committed )
+{
+    FUNC_ENTRY ( ctx );
+
+    Journal *journal = ctx -> caps -> journal;
+    if ( journal != NULL && committed )
+    {
+        uint32_t i, count = VectorLength ( cols );
+        for ( i = 0; ! FAILED () && i < count; ++ i )
+        {
+            const ColumnPair *col = VectorGet ( cols, i );
+            JournalNoteColumn ( journal, ctx, self -> full_spec, col -> colspec );
+        }
+    }
+
+    VectorWhack ( cols, TablePairReleaseColumnPair, ( void* ) ctx );
+
+    if ( journal != NULL && committed && ! FAILED () )
+    {
+        JournalCheckpoint ( journal, ctx, self -> full_spec,
+            jtblCopying, self -> first_id, self -> last_excl );
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+ * ColumnCopyPool
+ *  copies the independent pairs of a column group concurrently
+ *  over a common run of row ids
+ *
+ *  the workers are started once per table and sleep until a chunk
+ *  is queued. the row ids are taken from the RowSet once per chunk
+ *  by the calling thread, which then joins the workers in pulling
+ *  the columns of the chunk off of the queue. every pair owns its
+ *  source and destination cursors, so no locking is needed beyond
+ *  the queue itself.
+ */
+#define COPY_POOL_MAX_THREADS 64
+#define COPY_POOL_CHUNK_IDS ( 1024 * 1024 )
+
+typedef struct ColumnCopyPool ColumnCopyPool;
+struct ColumnCopyPool
+{
+    const Caps *caps;
+    KLock *lock;
+    KCondition *cond; /* chunk queued, column copied or quitting */
+    KThread *threads [ COPY_POOL_MAX_THREADS ];
+    uint32_t num_threads;
+
+    /* the queued chunk - columns from "next" on are waiting */
+    ColumnPair **cols;
+    const int64_t *row_ids;
+    size_t num_ids;
+    uint32_t num_cols;
+    uint32_t next;
+
+    /* the workers copying a column, at most "max_busy" of them */
+    uint32_t busy;
+    uint32_t max_busy;
+
+    rc_t rc;
+    bool quitting;
+};
+
+static
+rc_t CC ColumnCopyPoolRun ( const KThread *self, void *data )
+{
+    ColumnCopyPool *pool = data;
+
+    DECLARE_CTX_INFO ();
+    ctx_t thread_ctx = { pool -> caps, NULL, & ctx_info };
+    const ctx_t *ctx = & thread_ctx;
+
+    rc_t rc = KLockAcquire ( pool -> lock );
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "KLockAcquire failed" );
+    else
+    {
+        while ( ! pool -> quitting )
+        {
+            ColumnPair *col;
+
+            if ( pool -> rc != 0 || pool -> next == pool -> num_cols || pool -> busy >= pool -> max_busy )
+            {
+                rc = KConditionWait ( pool -> cond, pool -> lock );
+                if ( rc != 0 )
+                {
+                    INTERNAL_ERROR ( rc, "KConditionWait failed" );
+                    break;
+                }
+                continue;
+            }
+
+            col = pool -> cols [ pool -> next ++ ];
+            ++ pool -> busy;
+            KLockUnlock ( pool -> lock );
+
+            ColumnPairCopyRows ( col, ctx, pool -> row_ids, pool -> num_ids );
+
+            rc = KLockAcquire ( pool -> lock );
+            if ( rc != 0 )
+            {
+                INTERNAL_ERROR ( rc, "KLockAcquire failed" );
+                return rc;
+            }
+            -- pool -> busy;
+            KConditionBroadcast ( pool -> cond );
+            if ( FAILED () )
+                break;
+        }
+
+        /* stop handing out columns of the chunk */
+        if ( FAILED () && pool -> rc == 0 )
+            pool -> rc = ctx -> rc;
+        KLockUnlock ( pool -> lock );
+    }
+
+    return ctx -> rc;
+}
+
+/* Make
+ *  start the workers for a table, "num_threads" including the caller of Exec
+ */
+static
+ColumnCopyPool *ColumnCopyPoolMake ( const ctx_t *ctx, uint32_t num_threads )
+{
+    FUNC_ENTRY ( ctx );
+
+    ColumnCopyPool *pool;
+
+    TRY ( pool = MemAlloc ( ctx, sizeof * pool, true ) )
+    {
+        rc_t rc = KLockMake ( & pool -> lock );
+        if ( rc != 0 )
+            ERROR ( rc, "failed to create column copy lock" );
+        else
+        {
+            rc = KConditionMake ( & pool -> cond );
+            if ( rc != 0 )
+                ERROR ( rc, "failed to create column copy condition" );
+            else
+            {
+                pool -> caps = ctx -> caps;
+
+                if ( num_threads > COPY_POOL_MAX_THREADS )
+                    num_threads = COPY_POOL_MAX_THREADS;
+
+                while ( pool -> num_threads + 1 < num_threads )
+                {
+                    rc = KThreadMake ( & pool -> threads [ pool -> num_threads ], ColumnCopyPoolRun, pool );
+                    if ( rc != 0 )
+                    {
+                        /* not fatal - the remaining threads pick up the slack */
+                        WARN ( "failed to start column copy thread: %R", rc );
+                        break;
+                    }
+                    ++ pool -> num_threads;
+                }
+
+                return pool;
+            }
+
+            KLockRelease ( pool -> lock );
+        }
+
+        MemFree ( ctx, pool, sizeof * pool );
+    }
+
+    return NULL;
+}
+
+/* Whack
+ *  stop and join the workers
+ */
+static
+void ColumnCopyPoolWhack ( ColumnCopyPool *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i;
+
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        self -> quitting = true;
+        KConditionBroadcast ( self -> cond );
+        KLockUnlock ( self -> lock );
+    }
+
+    for ( i = 0; i < self -> num_threads; ++ i )
+    {
+        rc_t status;
+        rc_t rc = KThreadWait ( self -> threads [ i ], & status );
+        if ( rc != 0 )
+            WARN ( "failed to wait for column copy thread 0x%p: %R", self -> threads [ i ], rc );
+        KThreadRelease ( self -> threads [ i ] );
+    }
+
+    KConditionRelease ( self -> cond );
+    KLockRelease ( self -> lock );
+    MemFree ( ctx, self, sizeof * self );
+}
+
+/* Exec
+ *  copy one chunk of rows into every column given
+ *  using at most "workers" threads, including the caller's
+ */
+static
+void ColumnCopyPoolExec ( ColumnCopyPool *self, const ctx_t *ctx,
+    ColumnPair **cols, uint32_t num_cols,
+    const int64_t *row_ids, size_t num_ids, uint32_t workers )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc != 0 )
+    {
+        INTERNAL_ERROR ( rc, "KLockAcquire failed" );
+        return;
+    }
+
+    /* queue the chunk */
+    self -> cols = cols;
+    self -> num_cols = num_cols;
+    self -> row_ids = row_ids;
+    self -> num_ids = num_ids;
+    self -> next = 0;
+    self -> max_busy = workers - 1;
+    KConditionBroadcast ( self -> cond );
+
+    while ( self -> rc == 0 && self -> next < self -> num_cols )
+    {
+        ColumnPair *col = self -> cols [ self -> next ++ ];
+        KLockUnlock ( self -> lock );
+
+        ColumnPairCopyRows ( col, ctx, row_ids, num_ids );
+
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+        {
+            INTERNAL_ERROR ( rc, "KLockAcquire failed" );
+            return;
+        }
+        if ( FAILED () )
+        {
+            if ( self -> rc == 0 )
+                self -> rc = ctx -> rc;
+            break;
+        }
+    }
+
+    /* the row ids belong to the caller again once no worker is busy */
+    while ( self -> busy != 0 )
+    {
+        rc = KConditionWait ( self -> cond, self -> lock );
+        if ( rc != 0 )
+        {
+            INTERNAL_ERROR ( rc, "KConditionWait failed" );
+            break;
+        }
+    }
+
+    rc = self -> rc;
+    KLockUnlock ( self -> lock );
+
+    if ( rc != 0 && ! FAILED () )
+        ERROR ( rc, "failed to copy columns on worker thread" );
+}
+
+
+/* CopyConcurrency
+ *  the number of threads to apply to a group of columns
+ *
+ *  large columns keep an entire blob of data per cursor in flight,
+ *  so when a memory limit has been given, each of them is charged
+ *  "large_col_mem" against what remains of the quota
+ */
+static
+uint32_t TablePairCopyConcurrency ( const TablePair *self, const ctx_t *ctx,
+    uint32_t num_cols, bool large )
+{
+    const Tool *tp = ctx -> caps -> tool;
+    uint32_t limit = tp -> num_threads;
+
+    if ( large && limit > 1 && tp -> large_col_mem != 0 )
+    {
+        size_t quota, in_use = MemInUse ( ctx, & quota );
+        if ( ( quota + 1 ) != 0 )
+        {
+            size_t fit = ( in_use < quota ) ? ( quota - in_use ) / tp -> large_col_mem : 0;
+            if ( fit < limit )
+                limit = ( fit == 0 ) ? 1 : ( uint32_t ) fit;
+        }
+    }
+
+    if ( limit > num_cols )
+        limit = num_cols;
+
+    return ( limit == 0 ) ? 1 : limit;
+}
+
+
+/* CopyColumnGroup
+ *  copy a single RowSet into every column of a group
+ *
+ *  independent pairs are copied concurrently, chunk by chunk,
+ *  by the workers of the table. the remaining pairs, typically
+ *  buffered writers that consume the row map of the RowSetIterator,
+ *  are copied serially afterward.
+ */
+static
+void TablePairCopyColumnGroup ( TablePair *self, const ctx_t *ctx,
+    const Vector *cols, RowSet *rs, bool large )
+{
+    FUNC_ENTRY ( ctx );
+
+    ColumnPair **indep = NULL;
+    uint32_t i, num_indep = 0, workers = 1, count = VectorLength ( cols );
+
+    if ( self -> copy_pool != NULL )
+    {
+        TRY ( indep = MemAlloc ( ctx, sizeof indep [ 0 ] * count, false ) )
+        {
+            for ( i = 0; i < count; ++ i )
+            {
+                ColumnPair *col = VectorGet ( cols, i );
+                if ( ColumnPairIsIndependent ( col ) )
+                    indep [ num_indep ++ ] = col;
+            }
+        }
+    }
+
+    if ( num_indep > 1 )
+        workers = TablePairCopyConcurrency ( self, ctx, num_indep, large );
+    if ( ! FAILED () && workers > 1 )
+    {
+        int64_t *row_ids;
+
+        STATUS ( 3, "copying %u columns of '%s' on %u threads", num_indep, self -> full_spec, workers );
+
+        TRY ( row_ids = MemAlloc ( ctx, sizeof row_ids [ 0 ] * COPY_POOL_CHUNK_IDS, false ) )
+        {
+            TRY ( RowSetReset ( rs, ctx, false ) )
+            {
+                for ( i = 0; i < num_indep; ++ i )
+                {
+                    ON_FAIL ( ColumnPairPreCopy ( indep [ i ], ctx ) )
+                        break;
+                }
+
+                while ( ! FAILED () )
+                {
+                    rc_t rc;
+                    size_t num_ids;
+
+                    ON_FAIL ( num_ids = RowSetNext ( rs, ctx, row_ids, COPY_POOL_CHUNK_IDS ) )
+                        break;
+                    if ( num_ids == 0 )
+                        break;
+
+                    rc = Quitting ();
+                    if ( rc != 0 )
+                    {
+                        INFO_ERROR ( rc, "quitting" );
+                        break;
+                    }
+
+                    ColumnCopyPoolExec ( self -> copy_pool, ctx, indep, num_indep, row_ids, num_ids, workers );
+                }
+
+                for ( i = 0; ! FAILED () && i < num_indep; ++ i )
+                    ColumnPairPostCopy ( indep [ i ], ctx );
+            }
+
+            MemFree ( ctx, row_ids, sizeof row_ids [ 0 ] * COPY_POOL_CHUNK_IDS );
+        }
+    }
+    else
+    {
+        /* nothing to share - copy every pair on this thread */
+        num_indep = 0;
+    }
+
+    /* copy whatever the pool did not */
+    for ( i = 0; ! FAILED () && i < count; ++ i )
+    {
+        uint32_t j;
+        ColumnPair *col = VectorGet ( cols, i );
+        assert ( col != NULL );
+
+        for ( j = 0; j < num_indep; ++ j )
+        {
+            if ( indep [ j ] == col )
+                break;
+        }
+
+        if ( j == num_indep )
+            ColumnPairCopy ( col, ctx, rs );
+    }
+
+    if ( indep != NULL )
+        MemFree ( ctx, indep, sizeof indep [ 0 ] * count );
+}
+
+
 /* Copy
  *  the table has to obtain a RowSetIterator
  *  which it walks vertically
@@ -284,7 +696,7 @@ void TablePairCopyStaticColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing static columns" );
-        VectorWhack ( & self -> static_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> static_cols, ! FAILED () );
     }
 }
 
@@ -304,21 +716,13 @@ void TablePairCopyPresortColumns ( TablePair *self, const ctx_t *ctx )
 
             while ( ! FAILED () )
             {
-                uint32_t i;
-
                 RowSet *rs;
                 ON_FAIL ( rs = RowSetIteratorNext ( rsi, ctx ) )
                     break;
                 if ( rs == NULL )
                     break;
 
-                for ( i = 0; i < count; ++ i )
-                {
-                    ColumnPair *col = VectorGet ( & self -> presort_cols, i );
-                    assert ( col != NULL );
-                    ON_FAIL ( ColumnPairCopy ( col, ctx, rs ) )
-                        break;
-                }
+                TablePairCopyColumnGroup ( self, ctx, & self -> presort_cols, rs, false );
 
                 RowSetRelease ( rs, ctx );
             }
@@ -335,7 +739,7 @@ void TablePairCopyPresortColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing presorted columns" );
-        VectorWhack ( & self -> presort_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> presort_cols, ! FAILED () );
     }
 }
 
@@ -357,21 +761,13 @@ void TablePairCopyMappedColumns ( TablePair *self, const ctx_t *ctx )
 
             while ( ! FAILED () )
             {
-                uint32_t i;
-
                 RowSet *rs;
                 ON_FAIL ( rs = RowSetIteratorNext ( rsi, ctx ) )
                     break;
                 if ( rs == NULL )
                     break;
 
-                for ( i = 0; i < count; ++ i )
-                {
-                    ColumnPair *col = VectorGet ( & self -> mapped_cols, i );
-                    assert ( col != NULL );
-                    ON_FAIL ( ColumnPairCopy ( col, ctx, rs ) )
-                        break;
-                }
+                TablePairCopyColumnGroup ( self, ctx, & self -> mapped_cols, rs, is_large );
 
                 RowSetRelease ( rs, ctx );
             }
@@ -388,7 +784,7 @@ void TablePairCopyMappedColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing mapped columns" );
-        VectorWhack ( & self -> mapped_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> mapped_cols, ! FAILED () );
     }
 }
 
@@ -410,21 +806,13 @@ void TablePairCopyLargeColumns ( TablePair *self, const ctx_t *ctx )
 
             while ( ! FAILED () )
             {
-                uint32_t i;
-
                 RowSet *rs;
                 ON_FAIL ( rs = RowSetIteratorNext ( rsi, ctx ) )
                     break;
                 if ( rs == NULL )
                     break;
 
-                for ( i = 0; i < count; ++ i )
-                {
-                    ColumnPair *col = VectorGet ( & self -> large_cols, i );
-                    assert ( col != NULL );
-                    ON_FAIL ( ColumnPairCopy ( col, ctx, rs ) )
-                        break;
-                }
+                TablePairCopyColumnGroup ( self, ctx, & self -> large_cols, rs, is_large );
 
                 RowSetRelease ( rs, ctx );
             }
@@ -441,7 +829,7 @@ void TablePairCopyLargeColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing large columns" );
-        VectorWhack ( & self -> large_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> large_cols, ! FAILED () );
     }
 }
 
@@ -463,21 +851,13 @@ void TablePairCopyLargeMappedColumns ( TablePair *self, const ctx_t *ctx )
 
             while ( ! FAILED () )
             {
-                uint32_t i;
-
                 RowSet *rs;
                 ON_FAIL ( rs = RowSetIteratorNext ( rsi, ctx ) )
                     break;
                 if ( rs == NULL )
                     break;
 
-                for ( i = 0; i < count; ++ i )
-                {
-                    ColumnPair *col = VectorGet ( & self -> large_mapped_cols, i );
-                    assert ( col != NULL );
-                    ON_FAIL ( ColumnPairCopy ( col, ctx, rs ) )
-                        break;
-                }
+                TablePairCopyColumnGroup ( self, ctx, & self -> large_mapped_cols, rs, is_large );
 
                 RowSetRelease ( rs, ctx );
             }
@@ -494,7 +874,7 @@ void TablePairCopyLargeMappedColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing large mapped columns" );
-        VectorWhack ( & self -> large_mapped_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> large_mapped_cols, ! FAILED () );
     }
 }
 
@@ -516,21 +896,13 @@ void TablePairCopyNormalColumns ( TablePair *self, const ctx_t *ctx )
 
             while ( ! FAILED () )
             {
-                uint32_t i;
-
                 RowSet *rs;
                 ON_FAIL ( rs = RowSetIteratorNext ( rsi, ctx ) )
                     break;
                 if ( rs == NULL )
                     break;
 
-                for ( i = 0; i < count; ++ i )
-                {
-                    ColumnPair *col = VectorGet ( & self -> normal_cols, i );
-                    assert ( col != NULL );
-                    ON_FAIL ( ColumnPairCopy ( col, ctx, rs ) )
-                        break;
-                }
+                TablePairCopyColumnGroup ( self, ctx, & self -> normal_cols, rs, is_large );
 
                 RowSetRelease ( rs, ctx );
             }
@@ -547,7 +919,7 @@ void TablePairCopyNormalColumns ( TablePair *self, const ctx_t *ctx )
 
         /* douse columns */
         STATUS ( 3, "releasing columns" );
-        VectorWhack ( & self -> normal_cols, TablePairReleaseColumnPair, ( void* ) ctx );
+        TablePairDouseColumns ( self, ctx, & self -> normal_cols, ! FAILED () );
     }
 }
 
@@ -556,6 +928,8 @@ void TablePairCopy ( TablePair *self, const ctx_t *ctx )
     FUNC_ENTRY ( ctx );
 
     size_t in_use, quota;
+    Journal *journal = ctx -> caps -> journal;
+    uint32_t phase = JournalTablePhase ( journal, self -> full_spec );
 
     /* copy columns */
     
@@ -563,6 +937,12 @@ void TablePairCopy ( TablePair *self, const ctx_t *ctx )
     ON_FAIL ( TablePairExplode ( self, ctx ) )
         return;
 
+    if ( phase == jtblDone )
+    {
+        STATUS ( 2, "table '%s' was completed by an earlier run", self -> full_spec );
+        return;
+    }
+
     STATUS ( 2, "copying table '%s'", self -> full_spec );
 
     in_use = MemInUse ( ctx, & quota );
@@ -571,7 +951,27 @@ void TablePairCopy ( TablePair *self, const ctx_t *ctx )
     else
         STATUS ( 4, "MEMORY: %,zu bytes used", in_use );
 
-    TRY ( TablePairPreCopy ( self, ctx ) )
+    if ( phase == jtblNew )
+    {
+        TRY ( TablePairPreCopy ( self, ctx ) )
+        {
+            if ( journal != NULL )
+            {
+                JournalCheckpoint ( journal, ctx, self -> full_spec,
+                    jtblCopying, self -> first_id, self -> last_excl );
+            }
+        }
+    }
+    else
+    {
+        STATUS ( 2, "resuming copy of table '%s'", self -> full_spec );
+    }
+
+    /* the workers copy the independent columns of every group */
+    if ( ! FAILED () && ctx -> caps -> tool -> num_threads > 1 )
+        self -> copy_pool = ColumnCopyPoolMake ( ctx, ctx -> caps -> tool -> num_threads );
+
+    if ( ! FAILED () )
     {
         TRY ( TablePairCopyStaticColumns ( self, ctx ) )
         {
@@ -591,9 +991,24 @@ void TablePairCopy ( TablePair *self, const ctx_t *ctx )
         }
     }
 
+    if ( self -> copy_pool != NULL )
+    {
+        ColumnCopyPoolWhack ( self -> copy_pool, ctx );
+        self -> copy_pool = NULL;
+    }
+
     /* cleanup */
     if ( ! FAILED () )
-        TablePairPostCopy ( self, ctx );
+    {
+        TRY ( TablePairPostCopy ( self, ctx ) )
+        {
+            if ( journal != NULL )
+            {
+                JournalCheckpoint ( journal, ctx, self -> full_spec,
+                    jtblDone, self -> first_id, self -> last_excl );
+            }
+        }
+    }
 
     in_use = MemInUse ( ctx, & quota );
     if ( ( quota + 1 ) != 0 )
@@ -809,6 +1224,13 @@ void TablePairDefaultExplode ( TablePair *self, const ctx_t *ctx )
                         break;
                     }
 
+                    /* filter out the columns committed by an earlier run */
+                    if ( TablePairColumnDone ( self, ctx, name ) )
+                    {
+                        STATUS ( 3, "keeping column 'dst.%s.%s' from an earlier run", self -> full_spec, name );
+                        continue;
+                    }
+
                     /* filter out the column names that are specifically excluded */
                     if ( self -> exclude_col_names != NULL )
                     {
@@ -851,12 +1273,23 @@ void TablePairExplode ( TablePair *self, const ctx_t *ctx )
     {
         FUNC_ENTRY ( ctx );
 
+        Journal *journal = ctx -> caps -> journal;
+        bool resumed = JournalTablePhase ( journal, self -> full_spec ) != jtblNew;
+
         STATUS ( 2, "exploding table '%s'", self -> full_spec );
 
+        /* columns kept from an earlier run must be intact */
+        if ( resumed )
+        {
+            ON_FAIL ( JournalVerifyTable ( journal, ctx, self -> full_spec, self -> dtbl ) )
+                return;
+        }
+
         /* first, ask subclass to perform explicit explode */
         TRY ( ( * self -> vt -> explode ) ( self, ctx ) )
         {
-            if ( self -> meta == NULL )
+            /* metadata was copied before the first checkpoint */
+            if ( self -> meta == NULL && ! resumed )
             {
                 TRY ( self -> meta = TablePairExplodeMetaPair ( self, ctx ) )
                 {
@@ -872,6 +1305,16 @@ void TablePairExplode ( TablePair *self, const ctx_t *ctx )
                 /* next, perform default self-explode for all columns not excluded */
                 TRY ( TablePairDefaultExplode ( self, ctx ) )
                 {
+                    /* the range may have come from columns now skipped */
+                    int64_t first_id, last_excl;
+                    if ( JournalTableRange ( journal, self -> full_spec, & first_id, & last_excl ) )
+                    {
+                        if ( first_id < self -> first_id )
+                            self -> first_id = first_id;
+                        if ( last_excl > self -> last_excl )
+                            self -> last_excl = last_excl;
+                    }
+
                     /* now create metadata pair */
                     if ( self -> meta == NULL )
                         self -> meta = TablePairExplodeMetaPair ( self, ctx );
@@ -884,6 +1327,16 @@ void TablePairExplode ( TablePair *self, const ctx_t *ctx )
 }
 
 
+/* ColumnDone
+ *  true if the column was committed by an earlier run
+ *  being resumed, and so must not be created again
+ */
+bool TablePairColumnDone ( const TablePair *self, const ctx_t *ctx, const char *colspec )
+{
+    return JournalColumnDone ( ctx -> caps -> journal, self -> full_spec, colspec );
+}
+
+
 /* AddColumnPair
  *  called from implementations
  */
@@ -46,6 +46,7 @@
 struct VTable;
 struct DbPair;
 struct KThread;
+struct ColumnCopyPool;
 struct ColumnReader;
 struct ColumnWriter;
 struct ColumnPair;
@@ -113,6 +114,9 @@ struct TablePair
     /* Thread launched by TablePairPostCopy [ to do consistency-check ] */
     struct KThread * thread;
 
+    /* workers copying independent columns while the table is copied */
+    struct ColumnCopyPool * copy_pool;
+
     uint8_t align [ 2 ];
 };
 
@@ -182,6 +186,13 @@ void TablePairExplode ( TablePair *self, const ctx_t *ctx );
 void TablePairAddColumnPair ( TablePair *self, const ctx_t *ctx, struct ColumnPair *col );
 
 
+/* ColumnDone
+ *  true if the column was committed by an earlier run
+ *  being resumed, and so must not be created again
+ */
+bool TablePairColumnDone ( const TablePair *self, const ctx_t *ctx, const char *colspec );
+
+
 /* PreCopy
  * PostCopy
  *  give table a chance to prepare and cleanup
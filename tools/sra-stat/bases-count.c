@@ -0,0 +1,274 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "sra-stat.h" /* BasesCountSpot */
+
+#include <insdc/sra.h> /* SRA_READ_TYPE_BIOLOGICAL */
+
+#include <string.h> /* memset */
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/* Byte histograms of a run of bases.
+   cnt [ 0 .. 4 ] are incremented by the number of bases with value 0 .. 4
+   ( A C G T N or 0 1 2 3 . ).
+   Return false if the run has an invalid value: cnt is undefined then. */
+
+#if defined ( __SSE2__ )
+
+/* 16 bases per step: one compare per counted value,
+   matches are accumulated in 8-bit lanes for up to 255 steps,
+   then added up with _mm_sad_epu8 */
+static size_t CountVector ( uint64_t cnt [ 4 ], const uint8_t * bases,
+    size_t count, const uint8_t value [ 4 ], uint8_t max )
+{
+    size_t i = 0;
+
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i vmax = _mm_set1_epi8 ( ( char ) max );
+    __m128i v [ 4 ];
+    int k = 0;
+
+    for ( k = 0; k < 4; ++ k )
+        v [ k ] = _mm_set1_epi8 ( ( char ) value [ k ] );
+
+    while ( count - i >= 16 ) {
+        size_t steps = ( count - i ) / 16;
+        __m128i c [ 4 ];
+        __m128i hi = zero;
+
+        if ( steps > 255 )
+            steps = 255;
+
+        for ( k = 0; k < 4; ++ k )
+            c [ k ] = zero;
+
+        for ( ; steps > 0; -- steps, i += 16 ) {
+            __m128i b = _mm_loadu_si128 ( ( const __m128i * ) ( bases + i ) );
+            hi = _mm_max_epu8 ( hi, b );
+            for ( k = 0; k < 4; ++ k )
+                c [ k ] = _mm_sub_epi8 ( c [ k ], _mm_cmpeq_epi8 ( b, v [ k ] ) );
+        }
+
+        /* max ( hi, max ) == max in every lane <=> every base <= max */
+        if ( _mm_movemask_epi8 ( _mm_cmpeq_epi8
+                ( _mm_max_epu8 ( hi, vmax ), vmax ) ) != 0xFFFF )
+        {
+            return ~ ( size_t ) 0;
+        }
+
+        for ( k = 0; k < 4; ++ k ) {
+            __m128i s = _mm_sad_epu8 ( c [ k ], zero );
+            cnt [ k ] += ( uint64_t ) _mm_cvtsi128_si32 ( s )
+                       + ( uint64_t ) _mm_cvtsi128_si32
+                                        ( _mm_srli_si128 ( s, 8 ) );
+        }
+    }
+
+    return i;
+}
+
+#endif
+
+static const uint8_t x4na [ 16 ]
+    = { 4, 0, 1, 4, 2, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, };
+/*      0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
+           A  C     G           T                    N  */
+
+/* one base at a time: the tails of the vectorized runs and the reference
+   for them */
+bool CountBasesScalar ( uint64_t cnt [ 5 ], const uint8_t * bases,
+    size_t count )
+{
+    size_t i = 0;
+    for ( i = 0; i < count; ++ i ) {
+        if ( bases [ i ] > 4 )
+            return false;
+        ++ cnt [ bases [ i ] ];
+    }
+    return true;
+}
+
+bool CountBases4naScalar ( uint64_t cnt [ 5 ], const uint8_t * bases,
+    size_t count )
+{
+    size_t i = 0;
+    for ( i = 0; i < count; ++ i ) {
+        if ( bases [ i ] > 15 )
+            return false;
+        ++ cnt [ x4na [ bases [ i ] ] ];
+    }
+    return true;
+}
+
+bool CountBases ( uint64_t cnt [ 5 ], const uint8_t * bases, size_t count ) {
+    size_t i = 0;
+    uint64_t c [ 5 ];
+
+    memset ( c, 0, sizeof c );
+
+#if defined ( __SSE2__ )
+    {
+        static const uint8_t value [ 4 ] = { 0, 1, 2, 3 };
+        i = CountVector ( c, bases, count, value, 4 );
+        if ( i > count )
+            return false;
+        /* everything else is 4 */
+        c [ 4 ] = i - c [ 0 ] - c [ 1 ] - c [ 2 ] - c [ 3 ];
+    }
+#endif
+
+    if ( ! CountBasesScalar ( c, bases + i, count - i ) )
+        return false;
+
+    for ( i = 0; i < 5; ++ i )
+        cnt [ i ] += c [ i ];
+
+    return true;
+}
+
+/* 4na bases: A=1 C=2 G=4 T=8, any other value up to 15 is counted as N */
+bool CountBases4na ( uint64_t cnt [ 5 ], const uint8_t * bases, size_t count )
+{
+    size_t i = 0;
+    uint64_t c [ 5 ];
+
+    memset ( c, 0, sizeof c );
+
+#if defined ( __SSE2__ )
+    {
+        static const uint8_t value [ 4 ] = { 1, 2, 4, 8 };
+        i = CountVector ( c, bases, count, value, 15 );
+        if ( i > count )
+            return false;
+        c [ 4 ] = i - c [ 0 ] - c [ 1 ] - c [ 2 ] - c [ 3 ];
+    }
+#endif
+
+    if ( ! CountBases4naScalar ( c, bases + i, count - i ) )
+        return false;
+
+    for ( i = 0; i < 5; ++ i )
+        cnt [ i ] += c [ i ];
+
+    return true;
+}
+
+/* Counts the bases of the biological reads of a spot, one run per read.
+   Returns false without touching cnt when the spot is not the plain case:
+   reads that do not cover the bases exactly, a biological read of 0 length
+   ( BasesCountLoop handles them its own way )
+   or an invalid base: the caller falls back to BasesCountLoop then. */
+bool BasesCountSpot ( uint64_t cnt [ 5 ], const uint8_t * bases, uint64_t size,
+    const uint32_t * READ_LEN, const uint8_t * READ_TYPE, int nreads,
+    bool alignment )
+{
+    uint64_t c [ 5 ];
+    uint64_t start = 0;
+    int read = 0;
+    int i = 0;
+
+    for ( read = 0; read < nreads; ++ read ) {
+        if ( READ_LEN [ read ] == 0
+            && ( READ_TYPE [ read ] & SRA_READ_TYPE_BIOLOGICAL ) != 0 )
+        {
+            return false;
+        }
+        start += READ_LEN [ read ];
+    }
+    if ( start != size )
+        return false;
+
+    memset ( c, 0, sizeof c );
+
+    for ( read = 0, start = 0; read < nreads; ++ read ) {
+        uint32_t len = READ_LEN [ read ];
+        if ( ( READ_TYPE [ read ] & SRA_READ_TYPE_BIOLOGICAL ) != 0 ) {
+            bool ok = alignment ? CountBases4na ( c, bases + start, len )
+                                : CountBases    ( c, bases + start, len );
+            if ( ! ok )
+                return false;
+        }
+        start += len;
+    }
+
+    for ( i = 0; i < 5; ++ i )
+        cnt [ i ] += c [ i ];
+
+    return true;
+}
+
+
+/* The base-by-base loop over the reads of a spot: counts every spot that
+   BasesCountSpot counts, and the irregular ones.
+   Returns false when a read starts beyond READ_LEN ( *at is -1 then )
+   or at an invalid base ( *at is its index ): cnt is undefined then. */
+bool BasesCountLoop ( uint64_t cnt [ 5 ], const uint8_t * bases, uint64_t size,
+    const uint32_t * READ_LEN, const uint8_t * READ_TYPE, int nreads,
+    bool alignment, int64_t * at )
+{
+    int64_t i = 0;
+    int read = 0;
+    uint32_t nxtRdStart = 0;
+
+    for ( i = 0; i < ( int64_t ) size; ++ i ) {
+        unsigned char base = bases [ i ];
+        if ( i == nxtRdStart ) {
+            if ( read > nreads ) {
+                * at = -1;
+                return false;
+            }
+            nxtRdStart += READ_LEN [ read ++ ];
+            if ( ( READ_TYPE [ read - 1 ] & SRA_READ_TYPE_BIOLOGICAL ) == 0 )
+                    /* skip non-biological reads */
+            {
+                if ( READ_LEN [ read - 1 ] > 0 )
+                    i += READ_LEN [ read - 1 ];
+                -- i; /* here i can become negative: it should be signed */
+                continue;
+            }
+        }
+
+        if ( alignment ) {
+            if ( base > 15 ) {
+                * at = i;
+                return false;
+            }
+            base = x4na [ base ];
+        }
+
+        if ( base > 4 ) {
+            * at = i;
+            return false;
+        }
+
+        ++ cnt [ base ];
+    }
+
+    return true;
+}
@@ -52,6 +52,10 @@
 #include <klib/rc.h>
 #include <klib/sort.h> /* ksort */
 
+#include <kproc/cond.h> /* KCondition */
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
 #include <sra/sraschema.h> /* VDBManagerMakeSRASchema */
 
 #include <vdb/blob.h> /* VBlobCellData */
@@ -313,6 +317,7 @@ typedef struct srastat_parms {
     bool print_arcinfo;
     bool statistics; /* calculate average and stdev */
     bool test; /* test stdev */
+    uint32_t threads; /* number of threads scanning the table */
 
     const XMLLogger *logger;
 
@@ -611,9 +616,6 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment) {
     uint8_t  dREAD_TYPE [MAX_NREADS] = { 1 };
     int nreads = 0;
 
-    int read = 0;
-    uint32_t nxtRdStart = 0;
-
     assert(self);
 
     if (self->cursSEQUENCE == NULL) {
@@ -709,58 +711,41 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment) {
     row_bits /= 8;
     bases = base;
 
-    for (i = 0; i < row_bits; ++i) {
-        unsigned char base = bases[i];
-        if ( i == nxtRdStart) {
-            if ( read > nreads )
-                return RC(rcExe, rcNumeral, rcComparing, rcData, rcInvalid);
-            nxtRdStart += dREAD_LEN [ read ++ ];
-            assert ( read > 0 );
-            if ( ( (dREAD_TYPE[read-1] & SRA_READ_TYPE_BIOLOGICAL) == 0 ) )
-                    /* skip non-biological reads */
-            {
-                if ( dREAD_LEN [ read - 1 ] > 0 )
-                    i += dREAD_LEN [ read - 1 ];
-                -- i; /* here i can become negative: it should be signed */
-                continue;                
-            }
-        }
+    /* whole reads at once when the spot is regular;
+       the base-by-base loop handles the rest and finds bad bases */
+    if (BasesCountSpot(self->cnt, bases, row_bits,
+        dREAD_LEN, dREAD_TYPE, nreads, alignment))
+    {
+        return 0;
+    }
 
-        if ( alignment ) {
-            const unsigned char x [16]
-                = { 4, 0, 1, 4, 2, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, };
-            /*      0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
-                       A  C     G           T                    N  */
-            if (base > 15) {
-                rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
-                PLOGERR(klogInt, (klogErr, rc, "Invalid RAW_READ column "
-                    "value '$(base)' while VCursorCellDataDirect"
-                    "(spotid=$(spotid), index=$(i))",
-                    "base=%d,spotid=%lu,i=%lu", base, spotid, i));
-                BasesRelease(self);
-                return rc;
-            }
-            assert ( base < sizeof x / sizeof x [ 0 ] );
-            base = x [  base ];
-        }
+    if (BasesCountLoop(self->cnt, bases, row_bits,
+        dREAD_LEN, dREAD_TYPE, nreads, alignment, &i))
+    {
+        return 0;
+    }
 
-        if (base > 4) {
-            const char * name = self->basesType == ebtCSREAD ? "CSREAD"
-                : self->basesType == ebtREAD ? "READ" : "RAW_READ";
-            rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
-            PLOGERR(klogInt, (klogErr, rc,
-               "Invalid READ column value '$(base)' while VCursorCellDataDirect"
-               "($(name), spotid=$(spotid), index=$(i))",
-               "base=%d,name=%s,spotid=%lu,i=%lu",
-               base, name, spotid, i));
-            BasesRelease(self);
-            return rc;
-        }
+    if (i < 0)
+        return RC(rcExe, rcNumeral, rcComparing, rcData, rcInvalid);
 
-        ++self->cnt[base];
+    rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
+    if (alignment) {
+        PLOGERR(klogInt, (klogErr, rc, "Invalid RAW_READ column "
+            "value '$(base)' while VCursorCellDataDirect"
+            "(spotid=$(spotid), index=$(i))",
+            "base=%d,spotid=%lu,i=%lu", bases[i], spotid, i));
     }
-
-    return 0;
+    else {
+        const char * name = self->basesType == ebtCSREAD ? "CSREAD"
+            : self->basesType == ebtREAD ? "READ" : "RAW_READ";
+        PLOGERR(klogInt, (klogErr, rc,
+           "Invalid READ column value '$(base)' while VCursorCellDataDirect"
+           "($(name), spotid=$(spotid), index=$(i))",
+           "base=%d,name=%s,spotid=%lu,i=%lu",
+           bases[i], name, spotid, i));
+    }
+    BasesRelease(self);
+    return rc;
 }
 
 static rc_t BasesPrint(const Bases *self,
@@ -2975,12 +2960,176 @@ int64_t CC srastats_sort ( const BSTNode *item, const BSTNode *n )
     return srastats_cmp(ss->spot_group,n);
 }
 
-static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
-    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+/* SPOT_GROUP -> SraStats node of the tree:
+   open addressing, linear probing; the tree is kept for the ordered output */
+typedef struct SpotGroupIndex {
+    SraStats** slot;
+    size_t size; /* a power of 2 */
+    size_t used;
+} SpotGroupIndex;
+
+static uint64_t SpotGroupHash(const char* spot_group) {
+    uint64_t h = 14695981039346656037ULL; /* FNV-1a */
+
+    assert(spot_group);
+
+    while (*spot_group != '\0') {
+        h ^= (unsigned char)*spot_group++;
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static SraStats* SpotGroupIndexFind(const SpotGroupIndex* self,
+    const char* spot_group)
 {
-    rc_t rc = 0;
+    size_t i = 0;
+
+    assert(self);
+
+    if (self->size == 0) {
+        return NULL;
+    }
+
+    for (i = SpotGroupHash(spot_group) & (self->size - 1);
+        self->slot[i] != NULL; i = (i + 1) & (self->size - 1))
+    {
+        if (strcmp(self->slot[i]->spot_group, spot_group) == 0) {
+            return self->slot[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void SpotGroupIndexPut(SpotGroupIndex* self, SraStats* ss) {
+    size_t i = SpotGroupHash(ss->spot_group) & (self->size - 1);
+
+    while (self->slot[i] != NULL) {
+        i = (i + 1) & (self->size - 1);
+    }
+
+    self->slot[i] = ss;
+}
+
+static rc_t SpotGroupIndexAdd(SpotGroupIndex* self, SraStats* ss) {
+    assert(self && ss);
+
+    if ((self->used + 1) * 2 > self->size) {
+        size_t i = 0;
+        SpotGroupIndex grown;
+        grown.size = self->size == 0 ? 64 : self->size * 2;
+        grown.used = self->used;
+        grown.slot = calloc(grown.size, sizeof *grown.slot);
+        if (grown.slot == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        for (i = 0; i < self->size; ++i) {
+            if (self->slot[i] != NULL) {
+                SpotGroupIndexPut(&grown, self->slot[i]);
+            }
+        }
+        free(self->slot);
+        *self = grown;
+    }
+
+    SpotGroupIndexPut(self, ss);
+    ++self->used;
+
+    return 0;
+}
 
-    const VCursor *curs = NULL;
+static void SpotGroupIndexRelease(SpotGroupIndex* self) {
+    assert(self);
+
+    free(self->slot);
+    memset(self, 0, sizeof *self);
+}
+
+/* the per-spot part of the table scan:
+   can run on the main thread or on a worker, each one with its own cursor */
+typedef struct SpotScan {
+    const VCursor *curs;
+
+    uint32_t idxPRIMARY_ALIGNMENT_ID;
+    uint32_t idxRD_FILTER;
+    uint32_t idxREAD_LEN;
+    uint32_t idxREAD_TYPE;
+    uint32_t idxSPOT_GROUP;
+
+    BSTree* tr;
+    SpotGroupIndex groups; /* the nodes of tr */
+    SraStats* last; /* the group of the previous spot */
+    SraStatsTotal* total;
+
+    int64_t start; /* the first spot of the whole scan */
+
+    bool hasSPOT_GROUP;
+    bool bad_read_filter;
+    int bad_read_filter_nreads;
+    bool fixedNReads;
+    bool fixedReadLength;
+
+    bool mt; /* scanning chunks on a worker thread */
+    /* set on a worker instead of dropping RD_FILTER in the middle of a scan */
+    bool bad_RD_FILTER_size;
+
+    /* READ_LEN-s of the scanned spots are appended here on a worker:
+       they are added to the statistics by the main thread in spot order */
+    struct ReadLenLog* lens;
+
+    int g_nreads;
+    /* filled with dREAD_LEN[i] for (spotid == start);
+       used to check fixedReadLength */
+    uint32_t g_dREAD_LEN[MAX_NREADS];
+    uint64_t g_totalREAD_LEN[MAX_NREADS];
+    uint64_t g_nonZeroLenReads[MAX_NREADS];
+} SpotScan;
+
+typedef struct ReadLenLog { /* { nreads, READ_LEN[0], ... } for every spot */
+    uint32_t* data;
+    size_t used;
+    size_t allocated;
+} ReadLenLog;
+
+static rc_t ReadLenLogAdd(ReadLenLog* self,
+    const uint32_t* values, uint32_t nreads)
+{
+    assert(self && values);
+
+    if (self->used + 1 + nreads > self->allocated) {
+        size_t allocated = self->allocated * 2 + 1 + nreads;
+        uint32_t* data = realloc(self->data, allocated * sizeof *data);
+        if (data == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        self->data = data;
+        self->allocated = allocated;
+    }
+
+    self->data[self->used++] = nreads;
+    memmove(self->data + self->used, values, nreads * sizeof *values);
+    self->used += nreads;
+
+    return 0;
+}
+
+static void ReadLenLogApply(const ReadLenLog* self, SraStatsTotal* total) {
+    size_t i = 0;
+
+    assert(self && total);
+
+    while (i < self->used) {
+        uint32_t nreads = self->data[i++];
+        SraStatsTotalAdd(total, self->data + i, nreads);
+        i += nreads;
+    }
+}
+
+static rc_t SpotScanOpen(SpotScan* self, const VTable *vtbl, size_t capacity)
+{
+    rc_t rc = 0;
 
 /*  const char CMP_READ  [] = "CMP_READ"; */
     const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
@@ -2989,562 +3138,1000 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
     const char READ_TYPE [] = "READ_TYPE";
     const char SPOT_GROUP[] = "SPOT_GROUP";
 
-    uint32_t idxPRIMARY_ALIGNMENT_ID = 0;
-    uint32_t idxRD_FILTER = 0;
-    uint32_t idxREAD_LEN = 0;
-    uint32_t idxREAD_TYPE = 0;
-    uint32_t idxSPOT_GROUP = 0;
-
-    int g_nreads = 0;
-    int64_t  n_spots = 0;
-    int64_t start = 0;
-    int64_t stop  = 0;
+    assert(self && vtbl);
 
-    /* filled with dREAD_LEN[i] for (spotid == start);
-       used to check fixedReadLength */
-    uint64_t g_totalREAD_LEN[MAX_NREADS];
-    uint64_t g_nonZeroLenReads[MAX_NREADS];
-    memset(g_totalREAD_LEN, 0, sizeof g_totalREAD_LEN);
-    memset(g_nonZeroLenReads, 0, sizeof g_nonZeroLenReads);
+    self->fixedNReads = true;
+    self->fixedReadLength = true;
 
-    rc = VTableCreateCachedCursorRead(vtbl, &curs, DEFAULT_CURSOR_CAPACITY);
+    rc = VTableCreateCachedCursorRead(vtbl, &self->curs, capacity);
     DISP_RC(rc, "Cannot VTableCreateCachedCursorRead");
 
     if (rc == 0) {
-        rc = VCursorPermitPostOpenAdd(curs);
+        rc = VCursorPermitPostOpenAdd(self->curs);
         DISP_RC(rc, "Cannot VCursorPermitPostOpenAdd");
     }
 
     if (rc == 0) {
-        rc = VCursorOpen(curs);
+        rc = VCursorOpen(self->curs);
         DISP_RC(rc, "Cannot VCursorOpen");
     }
 
-    assert(pb && vtbl && tr && total);
-
     if (rc == 0) {
         const char* name = READ_LEN;
-        rc = VCursorAddColumn(curs, &idxREAD_LEN, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_LEN, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
     if (rc == 0) {
         const char* name = READ_TYPE;
-        rc = VCursorAddColumn(curs, &idxREAD_TYPE, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_TYPE, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
+    if (rc == 0) {
+        const char* name = SPOT_GROUP;
+        rc = VCursorAddColumn(self->curs, &self->idxSPOT_GROUP, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxSPOT_GROUP = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        const char* name = RD_FILTER;
+        rc = VCursorAddColumn(self->curs, &self->idxRD_FILTER, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxRD_FILTER = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+/*  if (rc == 0) {
+        const char* name = CMP_READ;
+        rc = SRATableOpenColumnRead
+            (tbl, &cCMP_READ, name, "INSDC:dna:text");
+        if (GetRCState(rc) == rcNotFound)
+        {   rc = 0; }
+        DISP_RC2(rc, name, "while calling SRATableOpenColumnRead");
+    } */
+    if (rc == 0) {
+        const char* name = PRIMARY_ALIGNMENT_ID;
+        rc = VCursorAddColumn(self->curs, &self->idxPRIMARY_ALIGNMENT_ID,
+            "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxPRIMARY_ALIGNMENT_ID = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+
+    return rc;
+}
+
+static rc_t SpotScanReadLen(const SpotScan* self, int64_t spotid,
+    uint32_t* dREAD_LEN, int* nreads)
+{
+    const char READ_LEN[] = "READ_LEN";
+
+    const void* base;
+    bitsz_t boff, row_bits;
+
+    rc_t rc = VCursorColumnRead(self->curs, spotid,
+        self->idxREAD_LEN, &base, &boff, &row_bits);
+    DISP_RC_Read(rc, READ_LEN, spotid, "while calling VCursorColumnRead");
+    if (rc == 0) {
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        else if ((row_bits >> 3) > MAX_NREADS * sizeof(*dREAD_LEN)) {
+            rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
+        }
+        DISP_RC_Read(rc, READ_LEN, spotid, "after calling VCursorColumnRead");
+    }
+    if (rc == 0) {
+        memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
+                ( size_t ) row_bits >> 3);
+        *nreads = (int) ((row_bits >> 3) / sizeof(*dREAD_LEN));
+    }
+
+    return rc;
+}
+
+/* finds the accumulator of a SPOT_GROUP, creates it when the group is new.
+   Spots of a group mostly come in runs: the previous group is tried first */
+static rc_t SpotScanGroup(SpotScan* self,
+    const char* spot_group, SraStats** ss)
+{
+    rc_t rc = 0;
+
+    assert(self && spot_group && ss);
+
+    if (self->last != NULL && strcmp(self->last->spot_group, spot_group) == 0)
+    {
+        *ss = self->last;
+        return 0;
+    }
+
+    *ss = SpotGroupIndexFind(&self->groups, spot_group);
+    if (*ss == NULL) {
+        *ss = calloc(1, sizeof(**ss));
+        if (*ss == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        strcpy((*ss)->spot_group, spot_group);
+        rc = SpotGroupIndexAdd(&self->groups, *ss);
+        if (rc != 0) {
+            free(*ss);
+            *ss = NULL;
+            return rc;
+        }
+        BSTreeInsert(self->tr, (BSTNode*)*ss, srastats_sort);
+    }
+
+    self->last = *ss;
+
+    return 0;
+}
+
+static rc_t SpotScanAdd(SpotScan* self, int64_t spotid,
+    const srastat_parms* pb)
+{
+    rc_t rc = 0;
+
+    const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
+    const char RD_FILTER [] = "RD_FILTER";
+    const char READ_TYPE [] = "READ_TYPE";
+    const char SPOT_GROUP[] = "SPOT_GROUP";
+
+    SraStats* ss;
+    SraStatsTotal* total = self->total;
+    uint32_t dREAD_LEN  [MAX_NREADS];
+    uint8_t  dREAD_TYPE [MAX_NREADS];
+    uint8_t  dRD_FILTER [MAX_NREADS];
+    char     dSPOT_GROUP[MAX_NREADS] = "NULL";
+
+    const void* base;
+    bitsz_t boff, row_bits;
+    int nreads;
+
+    int i, bio_len, bio_count, bad_cnt, filt_cnt;
+    uint64_t cmp_len = 0; /* CMP_READ */
+
+    rc = SpotScanReadLen(self, spotid, dREAD_LEN, &nreads);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (spotid == self->start) {
+        self->g_nreads = nreads;
+        if (pb->statistics && self->lens == NULL) {
+            rc = SraStatsTotalMakeStatistics(total, self->g_nreads);
+        }
+    }
+    else if (self->g_nreads != nreads) {
+        self->fixedNReads = false;
+    }
 
     if (rc == 0) {
-        {
-            const char* name = SPOT_GROUP;
-            rc = VCursorAddColumn(curs, &idxSPOT_GROUP, "%s", name);
-            if (columnUndefined(rc)) {
-                idxSPOT_GROUP = 0;
-                rc = 0;
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxREAD_TYPE, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, READ_TYPE, spotid,
+            "while calling VCursorColumnRead");
+        if (rc == 0) {
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            else if ((row_bits >> 3) > sizeof(dREAD_TYPE))
+                rc = RC(rcExe, rcColumn, rcReading,
+                    rcBuffer, rcInsufficient);
+            else if ((row_bits >> 3) !=  nreads) {
+                rc = RC(rcExe, rcColumn, rcReading, rcData, rcIncorrect);
             }
-            DISP_RC2(rc, name, "while calling VCursorAddColumn");
+            DISP_RC_Read(rc, READ_TYPE, spotid,
+                "after calling VCursorColumnRead");
         }
-        if (rc == 0) {
-            if (rc == 0) {
-                const char* name = RD_FILTER;
-                rc = VCursorAddColumn(curs, &idxRD_FILTER, "%s", name);
-                if (columnUndefined(rc)) {
-                    idxRD_FILTER = 0;
-                    rc = 0;
-                }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        memmove(dREAD_TYPE, ((const char*)base) + (boff >> 3),
+            ( size_t ) row_bits >> 3);
+        if (self->idxSPOT_GROUP != 0) {
+            rc = VCursorColumnRead(self->curs, spotid,
+                self->idxSPOT_GROUP, &base, &boff, &row_bits);
+            DISP_RC_Read(rc, SPOT_GROUP, spotid,
+                "while calling VCursorColumnRead");
+            if (rc != 0) {
+                return rc;
             }
-/*          if (rc == 0) {
-                const char* name = CMP_READ;
-                rc = SRATableOpenColumnRead
-                    (tbl, &cCMP_READ, name, "INSDC:dna:text");
-                if (GetRCState(rc) == rcNotFound)
-                {   rc = 0; }
-                DISP_RC2(rc, name, "while calling SRATableOpenColumnRead");
-            } */
-            if (rc == 0) {
-                const char* name = PRIMARY_ALIGNMENT_ID;
-                rc = VCursorAddColumn(curs, &idxPRIMARY_ALIGNMENT_ID,
-                    "%s", name);
-                if (columnUndefined(rc)) {
-                    idxPRIMARY_ALIGNMENT_ID = 0;
-                    rc = 0;
+            if (row_bits > 0) {
+                if (boff & 7) {
+                    rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
                 }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
+                else if (row_bits & 7) {
+                    rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+                }
+                else if ((row_bits >> 3) > sizeof(dSPOT_GROUP)) {
+                    rc = RC(rcExe, rcColumn, rcReading,
+                        rcBuffer, rcInsufficient);
+                }
+                DISP_RC_Read(rc, SPOT_GROUP, spotid,
+                    "after calling VCursorColumnRead");
+                if (rc == 0) {
+                    bitsz_t n = row_bits >> 3;
+                    memmove(dSPOT_GROUP, ((const char*)base) + (boff>>3),
+                        ( size_t ) row_bits>>3);
+                    dSPOT_GROUP[n]='\0';
+                    if (n > 1 || (n == 1 && dSPOT_GROUP[0])) {
+                        self->hasSPOT_GROUP = true;
+                    }
+                }
+            }
+            else {
+                dSPOT_GROUP[0]='\0';
+            }
+        }
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (self->idxRD_FILTER != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxRD_FILTER, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, RD_FILTER, spotid,
+            "while calling VCursorColumnRead");
+        if (rc != 0) {
+            return rc;
+        }
+        else {
+            bitsz_t size = row_bits >> 3;
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            else if (size > sizeof dRD_FILTER) {
+                rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
             }
+            DISP_RC_Read(rc, RD_FILTER, spotid,
+                "after calling VCursorColumnRead");
             if (rc == 0) {
-                int64_t first = 0;
-                uint64_t count = 0;
-                int64_t spotid;
-                pb->hasSPOT_GROUP = 0;
-                rc = VCursorIdRange(curs, 0, &first, &count);
-                DISP_RC(rc, "VCursorIdRange() failed");
-                if (rc == 0) {
-                    if (pb->start > 0) {
-                        start = pb->start;
-                        if (start < first) {
-                            start = first;
+                memmove(dRD_FILTER, ((const char*)base) + (boff>>3),
+                    ( size_t ) size);
+                if (size < nreads) {
+                    /* RD_FILTER is expected to have nreads elements */
+                    if (size == 1) {
+                        /* fill all RD_FILTER elements with RD_FILTER[0] */
+                        for (i = 1; i < nreads; ++i) {
+                            memmove(dRD_FILTER + i,
+                                ((const char*)base) + (boff>>3), 1);
                         }
+                        if (!self->bad_read_filter) {
+                            self->bad_read_filter = true;
+                            self->bad_read_filter_nreads = nreads;
+                            if (!self->mt) {
+                                PLOGMSG(klogWarn, (klogWarn,
+             "RD_FILTER column size is 1 but it is expected to be $(n)",
+                                    "n=%d", nreads));
+                            }
+                        }
+                    }
+                    else if (self->mt) {
+                        /* it changes the way all the following spots
+                           are counted: the main thread will rescan */
+                        self->bad_RD_FILTER_size = true;
+                        return 0;
                     }
                     else {
-                        start = first;
+                        /* something really bad with RD_FILTER column:
+                           let's pretend it does not exist */
+                        self->idxRD_FILTER = 0;
+                        self->bad_read_filter = true;
+                        PLOGMSG(klogWarn, (klogWarn,
+             "RD_FILTER column size is $(real) but it is expected to be $(exp)",
+                            "real=%d,exp=%d", size, nreads));
                     }
+                }
+            }
+        }
+    }
+    if (self->idxPRIMARY_ALIGNMENT_ID != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxPRIMARY_ALIGNMENT_ID, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+            "while calling VCursorColumnRead");
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+            "after calling calling VCursorColumnRead");
+        if (rc == 0) {
+            const int64_t* pii = base;
+            assert(nreads);
+            for (i = 0; i < nreads; ++i) {
+                if (pii[i] == 0) {
+                    cmp_len += dREAD_LEN[i];
+                }
+            }
+        }
+    }
+
+    rc = SpotScanGroup(self, dSPOT_GROUP, &ss);
+    if (rc != 0) {
+        return rc;
+    }
+    ++ss->spot_count;
+    ++total->spot_count;
+
+    ss->total_cmp_len += cmp_len;
+    total->total_cmp_len += cmp_len;
+
+    if (pb->statistics) {
+        if (self->lens == NULL) {
+            SraStatsTotalAdd(total, dREAD_LEN, nreads);
+        }
+        else {
+            rc = ReadLenLogAdd(self->lens, dREAD_LEN, nreads);
+        }
+    }
+    for (bio_len = bio_count = i = bad_cnt = filt_cnt = 0;
+        (i < nreads) && (rc == 0); i++)
+    {
+        if ( i >= MAX_NREADS ) {
+            rc = RC ( rcExe, rcData, rcProcessing, rcBuffer, rcInsufficient );
+            break;
+        }
+        if (dREAD_LEN[i] > 0) {
+            self->g_totalREAD_LEN[i] += dREAD_LEN[i];
+            ++self->g_nonZeroLenReads[i];
+        }
+        if (spotid == self->start) {
+            self->g_dREAD_LEN[i] = dREAD_LEN[i];
+        }
+        else if (self->g_dREAD_LEN[i] != dREAD_LEN[i]) {
+            self->fixedReadLength = false;
+        }
 
-                    if (pb->stop > 0) {
-                        stop = pb->stop;
-                        if ( ( uint64_t ) stop > first + count) {
-                            stop = first + count;
+        if (dREAD_LEN[i] > 0) {
+            bool biological = false;
+            ss->total_len += dREAD_LEN[i];
+            total->BASE_COUNT += dREAD_LEN[i];
+            if ((dREAD_TYPE[i] & SRA_READ_TYPE_BIOLOGICAL) != 0) {
+                biological = true;
+                bio_len += dREAD_LEN[i];
+                bio_count++;
+            }
+            if (self->idxRD_FILTER != 0) {
+                switch (dRD_FILTER[i]) {
+                    case SRA_READ_FILTER_PASS:
+                        break;
+                    case SRA_READ_FILTER_REJECT:
+                    case SRA_READ_FILTER_CRITERIA:
+                        if (biological) {
+                            ss->bad_bio_len += dREAD_LEN[i];
+                            total->bad_bio_len += dREAD_LEN[i];
+                        }
+                        bad_cnt++;
+                        break;
+                    case SRA_READ_FILTER_REDACTED:
+                        if (biological) {
+                            ss->filtered_bio_len += dREAD_LEN[i];
+                            total->filtered_bio_len += dREAD_LEN[i];
                         }
+                        filt_cnt++;
+                        break;
+                    default:
+                        rc = RC(rcExe, rcColumn, rcReading,
+                            rcData, rcUnexpected);
+                        PLOGERR(klogInt, (klogInt, rc,
+    "spot=$(spot), read=$(read), READ_FILTER=$(val)", "spot=%lu,read=%d,val=%d",
+                            spotid, i, dRD_FILTER[i]));
+                        break;
+                }
+            }
+        }
+    }
+    ss->bio_len += bio_len;
+    total->BIO_BASE_COUNT += bio_len;
+    if (bio_count > 1) {
+        ++ss->spot_count_mates;
+        ++total->spot_count_mates;
+        ss->bio_len_mates += bio_len;
+        total->bio_len_mates += bio_len;
+    }
+    if (bad_cnt) {
+        ss->bad_spot_count++;
+        total->bad_spot_count++;
+    }
+    if (filt_cnt) {
+        ss->filtered_spot_count++;
+        total->filtered_spot_count++;
+    }
+
+    return rc;
+}
+
+/* adds the counters of a worker: all of them are sums,
+   so the result does not depend on the way the spots were split */
+static rc_t SpotScanMerge(SpotScan* self, SpotScan* other) {
+    int i = 0;
+    BSTNode* n = NULL;
+    SraStatsTotal* t = self->total;
+    const SraStatsTotal* o = other->total;
+
+    assert(self && other);
+
+    while ((n = BSTreeFirst(other->tr)) != NULL) {
+        SraStats* from = (SraStats*)n;
+        SraStats* ss = NULL;
+        BSTreeUnlink(other->tr, n);
+        ss = SpotGroupIndexFind(&self->groups, from->spot_group);
+        if (ss == NULL) {
+            rc_t rc = SpotGroupIndexAdd(&self->groups, from);
+            if (rc != 0) {
+                bst_whack_free(n, NULL);
+                return rc;
+            }
+            BSTreeInsert(self->tr, n, srastats_sort);
+            continue;
+        }
+        ss->spot_count          += from->spot_count;
+        ss->spot_count_mates    += from->spot_count_mates;
+        ss->bio_len             += from->bio_len;
+        ss->bio_len_mates       += from->bio_len_mates;
+        ss->total_len           += from->total_len;
+        ss->bad_spot_count      += from->bad_spot_count;
+        ss->bad_bio_len         += from->bad_bio_len;
+        ss->filtered_spot_count += from->filtered_spot_count;
+        ss->filtered_bio_len    += from->filtered_bio_len;
+        ss->total_cmp_len       += from->total_cmp_len;
+        bst_whack_free(n, NULL);
+    }
+
+    t->spot_count          += o->spot_count;
+    t->spot_count_mates    += o->spot_count_mates;
+    t->BIO_BASE_COUNT      += o->BIO_BASE_COUNT;
+    t->bio_len_mates       += o->bio_len_mates;
+    t->BASE_COUNT          += o->BASE_COUNT;
+    t->bad_spot_count      += o->bad_spot_count;
+    t->bad_bio_len         += o->bad_bio_len;
+    t->filtered_spot_count += o->filtered_spot_count;
+    t->filtered_bio_len    += o->filtered_bio_len;
+    t->total_cmp_len       += o->total_cmp_len;
+
+    for (i = 0; i < 5; ++i) {
+        t->bases_count.cnt[i] += o->bases_count.cnt[i];
+    }
+
+    for (i = 0; i < MAX_NREADS; ++i) {
+        self->g_totalREAD_LEN[i] += other->g_totalREAD_LEN[i];
+        self->g_nonZeroLenReads[i] += other->g_nonZeroLenReads[i];
+    }
+
+    self->hasSPOT_GROUP = self->hasSPOT_GROUP || other->hasSPOT_GROUP;
+    self->fixedNReads = self->fixedNReads && other->fixedNReads;
+    self->fixedReadLength = self->fixedReadLength && other->fixedReadLength;
+
+    return 0;
+}
+
+/*** multi-threaded scan ***/
+
+#define MT_CHUNK_SPOTS ( 16 * 1024 )
+
+typedef enum {
+    eChunkEmpty,
+    eChunkReady,
+    eChunkBusy,
+    eChunkDone
+} EChunkState;
+
+typedef enum {
+    eChunkSpots,     /* the spots of the scanned table */
+    eChunkAlignment, /* bases of PRIMARY_ALIGNMENT */
+    eChunkSequence   /* bases of SEQUENCE */
+} EChunkType;
+
+typedef struct ScanChunk {
+    EChunkType type;
+    int64_t start;
+    int64_t stop;
+    EChunkState state;
+    bool bad_RD_FILTER_size;
+    int bad_read_filter_nreads; /* the warning is logged by the main thread */
+    ReadLenLog lens;
+    rc_t rc;
+} ScanChunk;
+
+typedef struct ScanWorker {
+    SpotScan scan;
+    BSTree tr;
+    SraStatsTotal total; /* counters and Bases, no Statistics */
+    const srastat_parms* pb;
+    struct ScanMT* mt;
+} ScanWorker;
+
+typedef struct ScanMT {
+    KLock* lock;
+    KCondition* cond;
+    ScanChunk* chunks;
+    uint32_t num_chunks;
+    uint64_t filled; /* chunks handed to the workers */
+    uint64_t taken;  /* chunks taken by the workers */
+    uint64_t merged; /* chunks merged by the main thread */
+    bool stop;
+} ScanMT;
+
+static rc_t ScanWorkerChunk(ScanWorker* self, ScanChunk* chunk) {
+    rc_t rc = 0;
+    int64_t spotid = 0;
+
+    assert(self && chunk);
+
+    switch (chunk->type) {
+        case eChunkSpots:
+            self->scan.lens = self->pb->statistics ? &chunk->lens : NULL;
+            self->scan.bad_read_filter = false;
+            for (spotid = chunk->start; spotid < chunk->stop && rc == 0;
+                ++spotid)
+            {
+                rc = SpotScanAdd(&self->scan, spotid, self->pb);
+                if (self->scan.bad_RD_FILTER_size) {
+                    chunk->bad_RD_FILTER_size = true;
+                    break;
+                }
+            }
+            self->scan.lens = NULL;
+            if (self->scan.bad_read_filter) {
+                chunk->bad_read_filter_nreads
+                    = self->scan.bad_read_filter_nreads;
+            }
+            break;
+        case eChunkAlignment:
+        case eChunkSequence:
+            for (spotid = chunk->start; spotid < chunk->stop && rc == 0;
+                ++spotid)
+            {
+                rc = BasesAdd(&self->total.bases_count, spotid,
+                    chunk->type == eChunkAlignment);
+            }
+            break;
+    }
+
+    return rc;
+}
+
+static rc_t CC ScanWorkerThread(const KThread *self, void *data) {
+    ScanWorker* w = data;
+    ScanMT* mt = w->mt;
+
+    while (KLockAcquire(mt->lock) == 0) {
+        ScanChunk* chunk = NULL;
+        while (!mt->stop && mt->taken >= mt->filled) {
+            if (KConditionWait(mt->cond, mt->lock) != 0) {
+                break;
+            }
+        }
+        if (!mt->stop && mt->taken < mt->filled) {
+            chunk = &mt->chunks[mt->taken++ % mt->num_chunks];
+            chunk->state = eChunkBusy;
+        }
+        KLockUnlock(mt->lock);
+        if (chunk == NULL) {
+            break;
+        }
+
+        chunk->rc = ScanWorkerChunk(w, chunk);
+
+        if (KLockAcquire(mt->lock) == 0) {
+            chunk->state = eChunkDone;
+            KConditionBroadcast(mt->cond);
+            KLockUnlock(mt->lock);
+        }
+    }
+
+    return 0;
+}
+
+/* cuts the next chunk out of the spot ranges to scan:
+   the spots first, then PRIMARY_ALIGNMENT and SEQUENCE bases */
+static bool ScanNextChunk(ScanChunk* chunk, int64_t* next,
+    int64_t stop, const Bases* bases)
+{
+    static const EChunkType types[] =
+        { eChunkSpots, eChunkAlignment, eChunkSequence };
+    int t = 0;
+
+    assert(chunk && next && bases);
+
+    for (t = 0; t < 3; ++t) {
+        int64_t from = next[t];
+        int64_t to = t == 0 ? stop : t == 1 ? ( int64_t ) bases->stopALIGNMENT
+                                            : ( int64_t ) bases->stopSEQUENCE;
+        if (from < to) {
+            chunk->type = types[t];
+            chunk->start = from;
+            chunk->stop = to - from > MT_CHUNK_SPOTS
+                ? from + MT_CHUNK_SPOTS : to;
+            chunk->bad_RD_FILTER_size = false;
+            chunk->bad_read_filter_nreads = 0;
+            chunk->lens.used = 0;
+            chunk->rc = 0;
+            next[t] = chunk->stop;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* scans the spots and the bases on pb->threads workers.
+   Chunks are merged in order, so READ_LEN statistics get their values
+   in the same order as in the single-threaded scan.
+   Sets *rescan when the single-threaded scan has to be run instead. */
+static rc_t sra_stat_mt(const srastat_parms* pb, SpotScan* scan,
+    int64_t stop, const Ctx* ctx, const VTable* vtbl,
+    const KLoadProgressbar* pr, bool* rescan)
+{
+    rc_t rc = 0;
+    ScanMT mt;
+    ScanWorker* workers = NULL;
+    KThread** threads = NULL;
+    uint32_t i = 0, started = 0, opened = 0;
+    SraStatsTotal* total = scan->total;
+    int64_t next[3];
+
+    assert(pb && scan && total && rescan);
+
+    *rescan = false;
+
+    memset(&mt, 0, sizeof mt);
+    mt.num_chunks = pb->threads * 2;
+
+    next[0] = scan->start;
+    next[1] = total->bases_count.startALIGNMENT;
+    next[2] = total->bases_count.startSEQUENCE;
+
+    if (scan->start < stop) {
+        /* fixedNReads and fixedReadLength are checked against the first spot:
+           the workers need it before they start */
+        rc = SpotScanReadLen(scan, scan->start,
+            scan->g_dREAD_LEN, &scan->g_nreads);
+        if (rc == 0 && pb->statistics) {
+            rc = SraStatsTotalMakeStatistics(total, scan->g_nreads);
+        }
+    }
+
+    if (rc == 0) {
+        workers = calloc(pb->threads, sizeof *workers);
+        threads = calloc(pb->threads, sizeof *threads);
+        mt.chunks = calloc(mt.num_chunks, sizeof *mt.chunks);
+        if (workers == NULL || threads == NULL || mt.chunks == NULL) {
+            rc = RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+    }
+    for (opened = 0; rc == 0 && opened < pb->threads; ++opened) {
+        ScanWorker* w = &workers[opened];
+        BSTreeInit(&w->tr);
+        w->pb = pb;
+        w->mt = &mt;
+        w->scan.tr = &w->tr;
+        w->scan.total = &w->total;
+        w->scan.start = scan->start;
+        w->scan.mt = true;
+        w->scan.g_nreads = scan->g_nreads;
+        memmove(w->scan.g_dREAD_LEN,
+            scan->g_dREAD_LEN, sizeof w->scan.g_dREAD_LEN);
+        rc = SpotScanOpen(&w->scan, vtbl, DEFAULT_CURSOR_CAPACITY);
+        if (rc == 0) {
+            rc = BasesInit(&w->total.bases_count, ctx, vtbl, pb);
+        }
+    }
+    if (rc == 0) {
+        rc = KLockMake(&mt.lock);
+        DISP_RC(rc, "KLockMake() failed");
+    }
+    if (rc == 0) {
+        rc = KConditionMake(&mt.cond);
+        DISP_RC(rc, "KConditionMake() failed");
+    }
+    for (started = 0; rc == 0 && started < pb->threads; ++started) {
+        rc = KThreadMake(&threads[started], ScanWorkerThread,
+            &workers[started]);
+        DISP_RC(rc, "KThreadMake() failed");
+    }
+    if (rc != 0 && started > 0) {
+        --started;
+    }
+
+    if (rc == 0) {
+        bool more = true;
+        while (rc == 0) {
+            if (more && mt.filled < mt.merged + mt.num_chunks) {
+                /* the slot is empty: nobody else touches it until it is ready */
+                ScanChunk* chunk = &mt.chunks[mt.filled % mt.num_chunks];
+                rc = Quitting();
+                if (rc != 0) {
+                    LOGMSG(klogWarn, "Interrupted");
+                }
+                else {
+                    more = ScanNextChunk(chunk, next, stop,
+                        &total->bases_count);
+                }
+                if (rc == 0 && more) {
+                    rc = KLockAcquire(mt.lock);
+                    if (rc == 0) {
+                        chunk->state = eChunkReady;
+                        ++mt.filled;
+                        KConditionBroadcast(mt.cond);
+                        KLockUnlock(mt.lock);
                     }
-                    else {
-                        stop = first + count;
+                }
+            }
+            else if (mt.merged < mt.filled) {
+                ScanChunk* chunk = &mt.chunks[mt.merged % mt.num_chunks];
+                rc = KLockAcquire(mt.lock);
+                if (rc == 0) {
+                    while (rc == 0 && chunk->state != eChunkDone) {
+                        rc = KConditionWait(mt.cond, mt.lock);
                     }
+                    KLockUnlock(mt.lock);
                 }
                 if (rc == 0) {
-                    rc = BasesInit(&total->bases_count, ctx, vtbl, pb);
+                    rc = chunk->rc;
+                }
+                if (rc == 0 && chunk->bad_RD_FILTER_size) {
+                    *rescan = true;
+                    break;
                 }
                 if (rc == 0) {
-                    const KLoadProgressbar *pr = NULL;
-                    bool bad_read_filter = false;
-                    bool fixedNReads = true;
-                    bool fixedReadLength = true;
+                    if (chunk->bad_read_filter_nreads > 0
+                        && !scan->bad_read_filter)
+                    {
+                        scan->bad_read_filter = true;
+                        PLOGMSG(klogWarn, (klogWarn,
+             "RD_FILTER column size is 1 but it is expected to be $(n)",
+                            "n=%d", chunk->bad_read_filter_nreads));
+                    }
+                    if (chunk->type == eChunkSpots && pb->statistics) {
+                        ReadLenLogApply(&chunk->lens, total);
+                    }
+                    if (pb->progress) {
+                        KLoadProgressbar_Process(pr,
+                            chunk->stop - chunk->start, false);
+                    }
+                    chunk->state = eChunkEmpty;
+                    ++mt.merged;
+                }
+            }
+            else {
+                break;
+            }
+        }
+    }
 
-                    uint32_t g_dREAD_LEN[MAX_NREADS];
+    if (mt.lock != NULL && KLockAcquire(mt.lock) == 0) {
+        mt.stop = true;
+        if (mt.cond != NULL) {
+            KConditionBroadcast(mt.cond);
+        }
+        KLockUnlock(mt.lock);
+    }
+    for (i = 0; i < started; ++i) {
+        rc_t status = 0;
+        KThreadWait(threads[i], &status);
+        KThreadRelease(threads[i]);
+    }
+    KConditionRelease(mt.cond);
+    KLockRelease(mt.lock);
 
-                    memset(g_dREAD_LEN, 0, sizeof g_dREAD_LEN);
+    for (i = 0; i < opened; ++i) {
+        ScanWorker* w = &workers[i];
+        if (rc == 0 && !*rescan) {
+            rc = SpotScanMerge(scan, &w->scan);
+        }
+        SpotGroupIndexRelease(&w->scan.groups);
+        BSTreeWhack(&w->tr, bst_whack_free, NULL);
+        SraStatsTotalFree(&w->total);
+        RELEASE(VCursor, w->scan.curs);
+    }
+    if (mt.chunks != NULL) {
+        for (i = 0; i < mt.num_chunks; ++i) {
+            free(mt.chunks[i].lens.data);
+        }
+    }
+    free(mt.chunks);
+    free(threads);
+    free(workers);
 
-                    for (spotid = start; spotid < stop && rc == 0; ++spotid) {
-                        SraStats* ss;
-                        uint32_t dREAD_LEN  [MAX_NREADS];
-                        uint8_t  dREAD_TYPE [MAX_NREADS];
-                        uint8_t  dRD_FILTER [MAX_NREADS];
-                        char     dSPOT_GROUP[MAX_NREADS] = "NULL";
+    if (*rescan) {
+        /* drop the partial statistics: the single-threaded scan restarts them */
+        free(total->stats);
+        total->stats = NULL;
+        free(total->stats2);
+        total->stats2 = NULL;
+        total->nreads = 0;
+        total->variable_nreads = false;
+    }
 
-                        const void* base;
-                        bitsz_t boff, row_bits;
-                        int nreads;
+    return rc;
+}
 
-                        rc = Quitting();
-                        if (rc != 0) {
-                            LOGMSG(klogWarn, "Interrupted");
-                        }
+static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
+    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+{
+    rc_t rc = 0;
 
-                        if (rc == 0 && pb->progress && pr == NULL) {
-                            uint64_t b = total->bases_count.stopSEQUENCE + 1
-                                       - total->bases_count.startSEQUENCE;
-                            if ( total->bases_count.stopALIGNMENT > 0 )
-                                b +=  total->bases_count.stopALIGNMENT + 1
-                                    - total->bases_count.startALIGNMENT;
-                            rc = KLoadProgressbar_Make(&pr,
-                                                       stop + 1 - start + b);
-                            if (rc != 0) {
-                                DISP_RC(rc, "cannot initialize progress bar");
-                                rc = 0;
-                                pr = NULL;
-                            }
-                            else if (stop - start > 99) {
-                                KLoadProgressbar_Process(pr, 0, true);
-                            }
-                        }
+    const char READ_LEN  [] = "READ_LEN";
 
-                        if (rc == 0) {
-                            rc = VCursorColumnRead(curs, spotid,
-                                idxREAD_LEN, &base, &boff, &row_bits);
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "while calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            if (boff & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcOffset, rcInvalid);
-                            }
-                            else if (row_bits & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcSize, rcInvalid);
-                            }
-                            else if ((row_bits >> 3) > sizeof(dREAD_LEN)) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcBuffer, rcInsufficient);
-                            }
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "after calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            int i, bio_len, bio_count, bad_cnt, filt_cnt;
-                            memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
-                                    ( size_t ) row_bits >> 3);
-                            nreads
-                                = (int) ((row_bits >> 3) / sizeof(*dREAD_LEN));
-                            if (spotid == start) {
-                                g_nreads = nreads;
-                                if (pb->statistics) {
-                                    rc = SraStatsTotalMakeStatistics
-                                        (total, g_nreads);
-                                }
-                            }
-                            else if (g_nreads != nreads) {
-                                fixedNReads = false;
-                            }
+    SpotScan scan;
 
-                            if (rc == 0) {
-                                rc = VCursorColumnRead(curs, spotid,
-                                    idxREAD_TYPE, &base, &boff, &row_bits);
-                                DISP_RC_Read(rc, READ_TYPE, spotid,
-                                    "while calling VCursorColumnRead");
-                                if (rc == 0) {
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid);
-                                    }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    else if ((row_bits >> 3)
-                                             > sizeof(dREAD_TYPE))
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcBuffer, rcInsufficient);
-                                    else if ((row_bits >> 3) !=  nreads) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcData, rcIncorrect);
-                                    }
-                                    DISP_RC_Read(rc, READ_TYPE, spotid,
-                                        "after calling VCursorColumnRead");
-                                }
-                            }
-                            if (rc == 0) {
-                                memmove(dREAD_TYPE,
-                                    ((const char*)base) + (boff >> 3),
-                                    ( size_t ) row_bits >> 3);
-                                if (idxSPOT_GROUP != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxSPOT_GROUP, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        if (row_bits > 0) {
-                                            if (boff & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcOffset, rcInvalid);
-                                            }
-                                            else if (row_bits & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcSize, rcInvalid); }
-                                            else if ((row_bits >> 3)
-                                                > sizeof(dSPOT_GROUP))
-                                            {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcBuffer, rcInsufficient);
-                                            }
-                                            DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                               "after calling VCursorColumnRead"
-                                               );
-                                            if (rc == 0) {
-                                                bitsz_t n = row_bits >> 3;
-                                                memmove(dSPOT_GROUP,
-                                                  ((const char*)base)+(boff>>3),
-                                                  ( size_t ) row_bits>>3);
-                                                dSPOT_GROUP[n]='\0';
-                                                if (n > 1 ||
-                                                    (n == 1 && dSPOT_GROUP[0]))
-                                                {
-                                                    pb -> hasSPOT_GROUP = 1;
-                                                }
-                                            }
-                                        }
-                                        else {
-                                            dSPOT_GROUP[0]='\0';
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                            }
-                            if (rc == 0) {
-                                uint64_t cmp_len = 0; /* CMP_READ */
-                                if (idxRD_FILTER != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxRD_FILTER, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, RD_FILTER, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        bitsz_t size = row_bits >> 3;
-                                        if (boff & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcOffset, rcInvalid); }
-                                        else if (row_bits & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcSize, rcInvalid);
-                                        }
-                                        else if (size > sizeof dRD_FILTER) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcBuffer, rcInsufficient);
-                                        }
-                                        DISP_RC_Read(rc, RD_FILTER, spotid,
-                                            "after calling VCursorColumnRead");
-                                        if (rc == 0) {
-                                            memmove(dRD_FILTER,
-                                                ((const char*)base) + (boff>>3),
-                                                ( size_t ) size);
-                                            if (size < nreads) {
-                             /* RD_FILTER is expected to have nreads elements */
-                                                if (size == 1) {
-                             /* fill all RD_FILTER elements with RD_FILTER[0] */
-                                                    int i = 0;
-                                                    for (i = 1; i < nreads;
-                                                        ++i)
-                                                    {
-                                                        memmove(dRD_FILTER + i,
-                                                  ((const char*)base)+(boff>>3),
-                                                  1);
-                                                    }
-                                                    if
-                                                     (!bad_read_filter)
-                                                    {
-                                                        bad_read_filter = true;
-                                                        PLOGMSG(klogWarn,
-                                                            (klogWarn,
-             "RD_FILTER column size is 1 but it is expected to be $(n)",
-                                                            "n=%d", nreads));
-                                                    }
-                                                }
-                                                else {
-                                  /* something really bad with RD_FILTER column:
-                                     let's pretend it does not exist */
-                                                    idxRD_FILTER = 0;
-                                                    bad_read_filter = true;
-                                                    PLOGMSG(klogWarn,
-                                                        (klogWarn,
-             "RD_FILTER column size is $(real) but it is expected to be $(exp)",
-                                                        "real=%d,exp=%d",
-                                                        size, nreads));
-                                                }
-                                            }
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                                if (idxPRIMARY_ALIGNMENT_ID != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxPRIMARY_ALIGNMENT_ID,
-                                        &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                        spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid); }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                       spotid,
-                                       "after calling calling VCursorColumnRead"
-                                       );
-                                    if (rc == 0) {
-                                        int i = 0;
-                                        const int64_t* pii = base;
-                                        assert(nreads);
-                                        for (i = 0; i < nreads; ++i) {
-                                            if (pii[i] == 0) {
-                                                cmp_len += dREAD_LEN[i];
-                                            }
-                                        }
-                                    }
-                                }
-
-                                ss = (SraStats*)BSTreeFind
-                                    (tr, dSPOT_GROUP, srastats_cmp);
-                                if (ss == NULL) {
-                                    ss = calloc(1, sizeof(*ss));
-                                    if (ss == NULL) {
-                                        rc = RC(rcExe, rcStorage, rcAllocating,
-                                            rcMemory, rcExhausted);
-                                        break;
-                                    }
-                                    else {
-                                        strcpy(ss->spot_group, dSPOT_GROUP);
-                                        BSTreeInsert
-                                            (tr, (BSTNode*)ss, srastats_sort);
-                                    }
-                                }
-                                ++ss->spot_count;
-                                ++total->spot_count;
-
-                                ss->total_cmp_len += cmp_len;
-                                total->total_cmp_len += cmp_len;
-
-                                if (pb->statistics) {
-                                    SraStatsTotalAdd(total, dREAD_LEN, nreads);
-                                }
-                                for (bio_len = bio_count = i = bad_cnt
-                                        = filt_cnt = 0;
-                                    (i < nreads) && (rc == 0); i++)
-                                {
-                                    if ( i >= MAX_NREADS ) {
-                                        rc = RC ( rcExe, rcData, rcProcessing,
-                                                  rcBuffer, rcInsufficient );
-                                        break;
-                                    }
-                                    if (dREAD_LEN[i] > 0) {
-                                        g_totalREAD_LEN[i] += dREAD_LEN[i];
-                                        ++g_nonZeroLenReads[i];
-                                    }
-                                    if (spotid == start) {
-                                        g_dREAD_LEN[i] = dREAD_LEN[i];
-                                    }
-                                    else if (g_dREAD_LEN[i] != dREAD_LEN[i]) {
-                                        fixedReadLength = false;
-                                    }
-
-                                    if (dREAD_LEN[i] > 0) {
-                                        bool biological = false;
-                                        ss->total_len += dREAD_LEN[i];
-                                        total->BASE_COUNT += dREAD_LEN[i];
-                                        if ((dREAD_TYPE[i]
-                                            & SRA_READ_TYPE_BIOLOGICAL) != 0)
-                                        {
-                                            biological = true;
-                                            bio_len += dREAD_LEN[i];
-                                            bio_count++;
-                                        }
-                                        if (idxRD_FILTER != 0) {
-                                            switch (dRD_FILTER[i]) {
-                                                case SRA_READ_FILTER_PASS:
-                                                    break;
-                                                case SRA_READ_FILTER_REJECT:
-                                                case SRA_READ_FILTER_CRITERIA:
-                                                    if (biological) {
-                                                        ss->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    bad_cnt++;
-                                                    break;
-                                                case SRA_READ_FILTER_REDACTED:
-                                                    if (biological) {
-                                                        ss->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    filt_cnt++;
-                                                    break;
-                                                default:
-                                                    rc = RC(rcExe, rcColumn,
-                                                        rcReading,
-                                                        rcData, rcUnexpected);
-                                                    PLOGERR(klogInt,
-                                                        (klogInt, rc,
-    "spot=$(spot), read=$(read), READ_FILTER=$(val)", "spot=%lu,read=%d,val=%d",
-                                                        spotid, i,
-                                                        dRD_FILTER[i]));
-                                                    break;
-                                            }
-                                        }
-                                    }
-                                }
-                                ss->bio_len += bio_len;
-                                total->BIO_BASE_COUNT += bio_len;
-                                if (bio_count > 1) {
-                                    ++ss->spot_count_mates;
-                                    ++total->spot_count_mates;
-                                    ss->bio_len_mates += bio_len;
-                                    total->bio_len_mates += bio_len;
-                                }
-                                if (bad_cnt) {
-                                    ss->bad_spot_count++;
-                                    total->bad_spot_count++;
-                                }
-                                if (filt_cnt) {
-                                    ss->filtered_spot_count++;
-                                    total->filtered_spot_count++;
-                                }
-                            }
+    int64_t  n_spots = 0;
+    int64_t start = 0;
+    int64_t stop  = 0;
 
-                            if (rc == 0 && pb->progress) {
-                                KLoadProgressbar_Process(pr, 1, false);
-                            }
-                        }
-                    } /* for (spotid = start; spotid <= stop && rc == 0;
-                              ++spotid) */
+    assert(pb && vtbl && tr && total);
 
-                    for (spotid = total->bases_count.startALIGNMENT;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopALIGNMENT && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, true);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+    memset(&scan, 0, sizeof scan);
+    scan.tr = tr;
+    scan.total = total;
 
-                    for (spotid = total->bases_count.startSEQUENCE;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopSEQUENCE && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, false);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+    rc = SpotScanOpen(&scan, vtbl, DEFAULT_CURSOR_CAPACITY);
+
+    if (rc == 0) {
+        int64_t first = 0;
+        uint64_t count = 0;
+        int64_t spotid;
+        pb->hasSPOT_GROUP = 0;
+        rc = VCursorIdRange(scan.curs, 0, &first, &count);
+        DISP_RC(rc, "VCursorIdRange() failed");
+        if (rc == 0) {
+            if (pb->start > 0) {
+                start = pb->start;
+                if (start < first) {
+                    start = first;
+                }
+            }
+            else {
+                start = first;
+            }
 
+            if (pb->stop > 0) {
+                stop = pb->stop;
+                if ( ( uint64_t ) stop > first + count) {
+                    stop = first + count;
+                }
+            }
+            else {
+                stop = first + count;
+            }
+            scan.start = start;
+        }
+        if (rc == 0) {
+            rc = BasesInit(&total->bases_count, ctx, vtbl, pb);
+        }
+        if (rc == 0) {
+            const KLoadProgressbar *pr = NULL;
+            bool rescan = false;
+
+            if (pb->progress && start < stop) {
+                uint64_t b = total->bases_count.stopSEQUENCE + 1
+                           - total->bases_count.startSEQUENCE;
+                if ( total->bases_count.stopALIGNMENT > 0 )
+                    b +=  total->bases_count.stopALIGNMENT + 1
+                        - total->bases_count.startALIGNMENT;
+                rc = KLoadProgressbar_Make(&pr, stop + 1 - start + b);
+                if (rc != 0) {
+                    DISP_RC(rc, "cannot initialize progress bar");
+                    rc = 0;
+                    pr = NULL;
+                }
+                else if (stop - start > 99) {
+                    KLoadProgressbar_Process(pr, 0, true);
+                }
+            }
+
+            if (pb->threads > 1) {
+                rc = sra_stat_mt(pb, &scan, stop, ctx, vtbl, pr, &rescan);
+                if (rc == 0 && rescan) {
+                    /* nothing was merged: scan.total and scan.tr are empty */
+                    LOGMSG(klogInfo, "RD_FILTER column has unexpected size: "
+                        "scanning the table in a single thread");
+                }
+            }
+
+            if (pb->threads <= 1 || rescan) {
+                for (spotid = start; spotid < stop && rc == 0; ++spotid) {
+                    rc = Quitting();
+                    if (rc != 0) {
+                        LOGMSG(klogWarn, "Interrupted");
+                    }
                     if (rc == 0) {
-                        BasesFinalize(&total->bases_count);
-                        pb->variableReadLength = !fixedReadLength;
+                        rc = SpotScanAdd(&scan, spotid, pb);
+                    }
+                    if (rc == 0 && pb->progress) {
+                        KLoadProgressbar_Process(pr, 1, false);
+                    }
+                }
+
+                for (spotid = total->bases_count.startALIGNMENT;
+                     !pb->quick &&
+                       spotid < total->bases_count.stopALIGNMENT && rc == 0;
+                     ++spotid)
+                {
+                    rc = BasesAdd(&total->bases_count, spotid, true);
+                    if ( rc == 0 && pb->progress )
+                        KLoadProgressbar_Process ( pr, 1, false );
+                    rc = Quitting();
+                    if (rc != 0)
+                        LOGMSG(klogWarn, "Interrupted");
+                }
+
+                for (spotid = total->bases_count.startSEQUENCE;
+                     !pb->quick &&
+                       spotid < total->bases_count.stopSEQUENCE && rc == 0;
+                     ++spotid)
+                {
+                    rc = BasesAdd(&total->bases_count, spotid, false);
+                    if ( rc == 0 && pb->progress )
+                        KLoadProgressbar_Process ( pr, 1, false );
+                    rc = Quitting();
+                    if (rc != 0)
+                        LOGMSG(klogWarn, "Interrupted");
+                }
+            }
+
+            if (rc == 0) {
+                pb->hasSPOT_GROUP = scan.hasSPOT_GROUP;
+                BasesFinalize(&total->bases_count);
+                pb->variableReadLength = !scan.fixedReadLength;
 
               /* --- g_totalREAD_LEN[i] is sum(READ_LEN[i]) for all spots --- */
-                        if (fixedNReads) {
-                            int i = 0;
-                            if (stop >= start) {
-                                n_spots = stop - start;
-                            }
-                            if (n_spots > 0) {
-                                for (i = 0; i < g_nreads && rc == 0; ++i) {
-                                    if (fixedReadLength) {
-                                        assert(g_totalREAD_LEN[i] / n_spots
-                                            == g_dREAD_LEN[i]);
-                                    }
-                                }
+                if (scan.fixedNReads) {
+                    int i = 0;
+                    if (stop >= start) {
+                        n_spots = stop - start;
+                    }
+                    if (n_spots > 0) {
+                        for (i = 0; i < scan.g_nreads && rc == 0; ++i) {
+                            if (scan.fixedReadLength) {
+                                assert(scan.g_totalREAD_LEN[i] / n_spots
+                                    == scan.g_dREAD_LEN[i]);
                             }
                         }
                     }
-                    if (rc == 0) {
-                        KLoadProgressbar_Release(pr, true);
-                        pr = NULL;
-                    }
                 }
             }
+            if (rc == 0) {
+                KLoadProgressbar_Release(pr, true);
+                pr = NULL;
+            }
         }
     }
 
-    RELEASE(VCursor, curs);
+    SpotGroupIndexRelease(&scan.groups);
+    RELEASE(VCursor, scan.curs);
 
     if (pb->test && rc == 0) {
+        const VCursor *curs = NULL;
         uint32_t idx = 0;
         int i = 0;
         int64_t spotid = 0;
 
         double average[MAX_NREADS];
         double diff_sq[MAX_NREADS];
-        SraStatsTotalStatistics2Init(total,
-            g_nreads, g_totalREAD_LEN, g_nonZeroLenReads);
+        SraStatsTotalStatistics2Init(total, scan.g_nreads,
+            scan.g_totalREAD_LEN, scan.g_nonZeroLenReads);
         memset(diff_sq, 0, sizeof diff_sq);
-        for (i = 0; i < g_nreads; ++i) {
-            average[i] = (double)g_totalREAD_LEN[i] / n_spots;
+        for (i = 0; i < scan.g_nreads; ++i) {
+            average[i] = (double)scan.g_totalREAD_LEN[i] / n_spots;
         }
 
         rc = VTableCreateCachedCursorRead(vtbl, &curs, DEFAULT_CURSOR_CAPACITY);
@@ -3580,7 +4167,7 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                 memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
                         ( size_t ) row_bits>>3);
             }
-            for (i = 0; i < g_nreads; ++i) {
+            for (i = 0; i < scan.g_nreads; ++i) {
                 diff_sq[i] +=
                     (dREAD_LEN[i] - average[i]) * (dREAD_LEN[i] - average[i]);
             }
@@ -3785,6 +4372,9 @@ rc_t run(srastat_parms* pb)
 #define ALIAS_TEST     "t"
 #define OPTION_TEST    "test"
 
+#define ALIAS_THREADS  NULL
+#define OPTION_THREADS "threads"
+
 #define ALIAS_XML      "x"
 #define OPTION_XML     "xml"
 
@@ -3804,6 +4394,9 @@ static const char * quick_usage[] = {
    "quick mode: get statistics from metadata;", "do not scan the table", NULL };
 static const char * test_usage[] = {
    "test READ_LEN average and standard deviation calculation", NULL };
+static const char * threads_usage[] = {
+   "number of threads scanning the table, default is 1;",
+   "the output does not depend on it", NULL };
 static const char * xml_usage[] = { "output as XML, default is text", NULL };
 static const char * arcinfo_usage[] = { "output archive info, default is off"
                                                                     , NULL };
@@ -3820,6 +4413,7 @@ OptDef Options[] = {
     , { OPTION_STATS   , ALIAS_STATS   , NULL, stats_usage   , 1, false, false }
     , { OPTION_STOP    , ALIAS_STOP    , NULL, stop_usage    , 1, true,  false }
     , { OPTION_TEST    , ALIAS_TEST    , NULL, test_usage    , 1, false, false }
+    , { OPTION_THREADS , ALIAS_THREADS , NULL, threads_usage , 1, true , false }
     , { OPTION_XML     , ALIAS_XML     , NULL, xml_usage     , 1, false, false }
 };
 
@@ -3863,6 +4457,7 @@ rc_t CC Usage (const Args * args)
     HelpOptionLine(ALIAS_STATS   , OPTION_STATS   , NULL      , stats_usage);
     HelpOptionLine(ALIAS_ALIGN   , OPTION_ALIGN   , "on | off", align_usage);
     HelpOptionLine(ALIAS_PROGRESS, OPTION_PROGRESS, NULL      , progress_usage);
+    HelpOptionLine(ALIAS_THREADS , OPTION_THREADS , "count"   , threads_usage);
     XMLLogger_Usage();
 
     KOutMsg ("\n");
@@ -4053,6 +4648,21 @@ rc_t CC KMain ( int argc, char *argv [] )
                 if (pcount > 0) {
                     pb.test = pb.statistics = true;
                 }
+
+
+                rc = ArgsOptionCount (args, OPTION_THREADS, &pcount);
+                if (rc != 0) {
+                    break;
+                }
+
+                if (pcount == 1) {
+                    rc = ArgsOptionValue (args, OPTION_THREADS, 0, (const void **)&pc);
+                    if (rc != 0) {
+                        break;
+                    }
+
+                    pb.threads = AsciiToU32 (pc, NULL, NULL);
+                }
             }
 
             {
@@ -83,6 +83,20 @@ rc_t CC VTableMakeSingleFileArchive(const struct VTable *self,
 
 rc_t CC CalculateNL ( const struct VDatabase * db, Ctx * ctx );
 
+/* base composition counters: see bases-count.c */
+bool CountBases ( uint64_t cnt [ 5 ], const uint8_t * bases, size_t count );
+bool CountBases4na ( uint64_t cnt [ 5 ], const uint8_t * bases, size_t count );
+bool CountBasesScalar ( uint64_t cnt [ 5 ], const uint8_t * bases,
+    size_t count );
+bool CountBases4naScalar ( uint64_t cnt [ 5 ], const uint8_t * bases,
+    size_t count );
+bool BasesCountSpot ( uint64_t cnt [ 5 ], const uint8_t * bases, uint64_t size,
+    const uint32_t * READ_LEN, const uint8_t * READ_TYPE, int nreads,
+    bool alignment );
+bool BasesCountLoop ( uint64_t cnt [ 5 ], const uint8_t * bases, uint64_t size,
+    const uint32_t * READ_LEN, const uint8_t * READ_TYPE, int nreads,
+    bool alignment, int64_t * at );
+
 #define RELEASE(type, obj) do { rc_t rc2 = type##Release(obj); \
     if (rc2 && !rc) { rc = rc2; } obj = NULL; } while (false)
 
@@ -0,0 +1,909 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <vdb/table.h>
+#include <vdb/cursor.h>
+#include <vdb/schema.h>
+
+#include <klib/out.h>
+#include <klib/log.h>
+#include <klib/rc.h>
+#include <klib/num-gen.h>
+
+#include "vdb-dump-arrow.h"
+#include "vdb-dump-helper.h"
+
+#include <os-native.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+rc_t Quitting( void );
+
+/*************************************************************************************
+    Apache Arrow IPC ( https://arrow.apache.org/docs/format/Columnar.html )
+
+    every message is: 0xFFFFFFFF, int32 metadata-size, flatbuffer, body
+    the flatbuffers ( format/Message.fbs, format/Schema.fbs, format/File.fbs )
+    are written front to back: a parent-table is written first with empty
+    offset-fields, which are patched as soon as the child is written behind it
+
+    column-mapping:
+        ascii / utf8 .............. Utf8
+        INSDC:4na:bin ............. Utf8 ( IUPAC-letters, not with --without_sra )
+        bool ...................... List< Bool >
+        ( u )int 8/16/32/64 bit ... List< Int >
+        float 32/64 bit ........... List< FloatingPoint >
+        dimension > 1 ............. List< FixedSizeList< ... > >
+    every VDB-cell is a list, because the row-length is not known up front
+*************************************************************************************/
+
+#define VDA_BATCH_ROWS 4096
+#define VDA_BATCH_BYTES ( 64 * 1024 * 1024 )
+#define VDA_FB_MAX_FIELDS 8
+#define VDA_MAX_DEPTH 3
+
+/* values of the flatbuffer-union "Type" */
+#define VDA_TYPE_INT 2
+#define VDA_TYPE_FLOAT 3
+#define VDA_TYPE_UTF8 5
+#define VDA_TYPE_BOOL 6
+#define VDA_TYPE_LIST 12
+#define VDA_TYPE_FIXED_LIST 16
+
+/* values of the flatbuffer-union "MessageHeader" */
+#define VDA_MSG_SCHEMA 1
+#define VDA_MSG_BATCH 3
+
+#define VDA_METADATA_V5 4
+
+static const char vda_magic[ 8 ] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+static const char vda_4na_chars[ 16 ] = "-ACMGRSVTWYHKDBN";
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct vda_buf
+{
+    uint8_t * data;
+    size_t len;
+    size_t size;
+} vda_buf;
+
+
+static rc_t vda_buf_reserve( vda_buf * b, size_t add )
+{
+    if ( b->len + add > b->size )
+    {
+        size_t size = b->size > 0 ? b->size : 4096;
+        uint8_t * tmp;
+        while ( size < b->len + add )
+            size *= 2;
+        tmp = realloc( b->data, size );
+        if ( tmp == NULL )
+            return RC( rcExe, rcBuffer, rcResizing, rcMemory, rcExhausted );
+        b->data = tmp;
+        b->size = size;
+    }
+    return 0;
+}
+
+
+static rc_t vda_buf_append( vda_buf * b, const void * src, size_t len )
+{
+    rc_t rc = vda_buf_reserve( b, len );
+    if ( rc == 0 )
+    {
+        if ( src != NULL )
+            memmove( b->data + b->len, src, len );
+        else
+            memset( b->data + b->len, 0, len );
+        b->len += len;
+    }
+    return rc;
+}
+
+
+static rc_t vda_buf_pad( vda_buf * b, size_t align )
+{
+    size_t pad = ( align - ( b->len % align ) ) % align;
+    return vda_buf_append( b, NULL, pad );
+}
+
+
+static rc_t vda_buf_u32( vda_buf * b, uint32_t value )
+{
+    return vda_buf_append( b, &value, sizeof value );
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct vda_fb_field
+{
+    uint8_t size;       /* 0 ... field is not present */
+    bool offset;        /* uoffset, patched when the target is written */
+    uint64_t value;
+} vda_fb_field;
+
+
+static void vda_fb_patch( vda_buf * fb, size_t slot, size_t target )
+{
+    uint32_t ofs = ( uint32_t )( target - slot );
+    memmove( fb->data + slot, &ofs, sizeof ofs );
+}
+
+
+/* writes the vtable and then the table, the positions of the offset-fields
+   are returned in slots */
+static rc_t vda_fb_table( vda_buf * fb, const vda_fb_field * f, uint32_t count,
+                          size_t * slots, size_t * pos )
+{
+    uint16_t vt[ 2 + VDA_FB_MAX_FIELDS ];
+    uint32_t i, align = 4, tsize = 4;
+    size_t vt_pos;
+    int32_t soffset;
+    rc_t rc;
+
+    for ( i = 0; i < count; ++i )
+    {
+        vt[ 2 + i ] = 0;
+        if ( f[ i ].size > 0 )
+        {
+            tsize = ( tsize + f[ i ].size - 1 ) / f[ i ].size * f[ i ].size;
+            vt[ 2 + i ] = ( uint16_t )tsize;
+            tsize += f[ i ].size;
+            if ( f[ i ].size > align )
+                align = f[ i ].size;
+        }
+    }
+    vt[ 0 ] = ( uint16_t )( 4 + 2 * count );
+    vt[ 1 ] = ( uint16_t )tsize;
+
+    rc = vda_buf_pad( fb, 2 );
+    vt_pos = fb->len;
+    if ( rc == 0 )
+        rc = vda_buf_append( fb, vt, vt[ 0 ] );
+    if ( rc == 0 )
+        rc = vda_buf_pad( fb, align );
+    if ( rc == 0 )
+    {
+        *pos = fb->len;
+        soffset = ( int32_t )( *pos - vt_pos );
+        rc = vda_buf_append( fb, NULL, tsize );
+        if ( rc == 0 )
+        {
+            memmove( fb->data + *pos, &soffset, sizeof soffset );
+            for ( i = 0; i < count; ++i )
+            {
+                if ( f[ i ].size > 0 )
+                {
+                    size_t at = *pos + vt[ 2 + i ];
+                    if ( f[ i ].offset )
+                        *( slots++ ) = at;
+                    else
+                        memmove( fb->data + at, &( f[ i ].value ), f[ i ].size ); /* little endian */
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
+/* vector of count uoffsets, element i is at *pos + 4 + 4 * i */
+static rc_t vda_fb_offsets( vda_buf * fb, uint32_t count, size_t * pos )
+{
+    rc_t rc = vda_buf_pad( fb, 4 );
+    *pos = fb->len;
+    if ( rc == 0 )
+        rc = vda_buf_u32( fb, count );
+    if ( rc == 0 )
+        rc = vda_buf_append( fb, NULL, 4 * count );
+    return rc;
+}
+
+
+/* vector of count structs, each made of words 64-bit values */
+static rc_t vda_fb_structs( vda_buf * fb, const uint64_t * values, uint32_t count,
+                            uint32_t words, size_t * pos )
+{
+    rc_t rc = vda_buf_pad( fb, 8 );
+    if ( rc == 0 )
+        rc = vda_buf_u32( fb, 0 );  /* the elements have to be 8-byte aligned */
+    *pos = fb->len;
+    if ( rc == 0 )
+        rc = vda_buf_u32( fb, count );
+    if ( rc == 0 )
+        rc = vda_buf_append( fb, values, 8 * words * count );
+    return rc;
+}
+
+
+static rc_t vda_fb_string( vda_buf * fb, const char * s, size_t * pos )
+{
+    uint32_t len = ( uint32_t )strlen( s );
+    rc_t rc = vda_buf_pad( fb, 4 );
+    *pos = fb->len;
+    if ( rc == 0 )
+        rc = vda_buf_u32( fb, len );
+    if ( rc == 0 )
+        rc = vda_buf_append( fb, s, len + 1 );
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+enum { vda_kind_text, vda_kind_4na, vda_kind_bool, vda_kind_num };
+
+typedef struct vda_type
+{
+    uint8_t id;         /* VDA_TYPE_XXX */
+    int32_t param;      /* bitWidth, precision or listSize */
+    bool is_signed;
+} vda_type;
+
+typedef struct vda_col
+{
+    p_col_def def;
+    uint32_t kind;
+    uint32_t elem_bytes;    /* bytes of one value */
+    uint32_t dim;
+    vda_type types[ VDA_MAX_DEPTH ];
+    uint32_t depth;
+    vda_buf offsets;        /* int32, rows + 1 */
+    vda_buf values;
+    uint64_t count;         /* number of VDB-elements ( values * dim ) in this batch */
+} vda_col;
+
+typedef struct vda_dump
+{
+    p_row_context r_ctx;
+    vda_col * cols;
+    uint32_t num_cols;
+    uint64_t rows;          /* rows in this batch */
+    vda_buf fb;             /* the flatbuffer of the current message */
+    vda_buf blocks;         /* position/size of the record-batches for the file-footer */
+    KWrtWriter writer;
+    void * writer_data;
+    uint64_t pos;
+    bool file;
+} vda_dump;
+
+
+static rc_t vda_write( vda_dump * d, const void * src, size_t len )
+{
+    rc_t rc = 0;
+    const char * p = src;
+    while ( rc == 0 && len > 0 )
+    {
+        size_t num_writ = 0;
+        rc = d->writer( d->writer_data, p, len, &num_writ );
+        if ( rc == 0 && num_writ == 0 )
+            rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        p += num_writ;
+        len -= num_writ;
+        d->pos += num_writ;
+    }
+    DISP_RC( rc, "writing arrow-output failed" );
+    return rc;
+}
+
+
+static rc_t vda_write_pad( vda_dump * d, size_t len )
+{
+    static const uint8_t zeros[ 8 ] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    size_t pad = ( 8 - ( len % 8 ) ) % 8;
+    return pad > 0 ? vda_write( d, zeros, pad ) : 0;
+}
+
+
+/* decides how a column is converted, returns false for types without Arrow-mapping */
+static bool vda_col_init( vda_col * c, p_col_def def, const VSchema * schema, bool translate )
+{
+    const VTypedesc * td = &( def->type_desc );
+    uint32_t bits = td->intrinsic_bits;
+    vda_type elem;
+
+    memset( c, 0, sizeof *c );
+    c->def = def;
+    c->dim = td->intrinsic_dim;
+    c->elem_bytes = bits / 8;
+    memset( &elem, 0, sizeof elem );
+
+    if ( ( td->domain == vtdAscii || td->domain == vtdUnicode ) && bits == 8 && c->dim == 1 )
+        c->kind = vda_kind_text;
+    else if ( translate && td->domain == vtdUint && bits == 8 && c->dim == 1 &&
+              schema != NULL && vdcd_type_cmp( schema, &( def->type_decl ), "INSDC:4na:bin" ) )
+        c->kind = vda_kind_4na;
+    else if ( td->domain == vtdBool && bits == 8 )
+    {
+        c->kind = vda_kind_bool;
+        elem.id = VDA_TYPE_BOOL;
+    }
+    else if ( ( td->domain == vtdUint || td->domain == vtdInt || td->domain == vtdUnicode ) &&
+              ( bits == 8 || bits == 16 || bits == 32 || bits == 64 ) )
+    {
+        c->kind = vda_kind_num;
+        elem.id = VDA_TYPE_INT;
+        elem.param = bits;
+        elem.is_signed = ( td->domain == vtdInt );
+    }
+    else if ( td->domain == vtdFloat && ( bits == 32 || bits == 64 ) )
+    {
+        c->kind = vda_kind_num;
+        elem.id = VDA_TYPE_FLOAT;
+        elem.param = ( bits == 32 ) ? 1 : 2;  /* SINGLE, DOUBLE */
+    }
+    else
+        return false;
+
+    if ( c->kind == vda_kind_text || c->kind == vda_kind_4na )
+    {
+        c->types[ c->depth++ ].id = VDA_TYPE_UTF8;
+    }
+    else
+    {
+        c->types[ c->depth++ ].id = VDA_TYPE_LIST;
+        if ( c->dim > 1 )
+        {
+            c->types[ c->depth ].id = VDA_TYPE_FIXED_LIST;
+            c->types[ c->depth++ ].param = c->dim;
+        }
+        c->types[ c->depth++ ] = elem;
+    }
+    return true;
+}
+
+
+static rc_t vda_col_reset( vda_col * c )
+{
+    c->offsets.len = 0;
+    c->values.len = 0;
+    c->count = 0;
+    return vda_buf_u32( &( c->offsets ), 0 );
+}
+
+
+static rc_t vda_col_add_cell( vda_col * c, const uint8_t * base, uint32_t row_len )
+{
+    rc_t rc = 0;
+    uint32_t end;
+    uint32_t i;
+
+    switch ( c->kind )
+    {
+        case vda_kind_text :
+            rc = vda_buf_append( &( c->values ), base, row_len );
+            end = ( uint32_t )c->values.len;
+            break;
+
+        case vda_kind_4na :
+            rc = vda_buf_reserve( &( c->values ), row_len );
+            for ( i = 0; rc == 0 && i < row_len; ++i )
+                c->values.data[ c->values.len++ ] = vda_4na_chars[ base[ i ] & 0x0F ];
+            end = ( uint32_t )c->values.len;
+            break;
+
+        case vda_kind_bool :
+            {
+                uint64_t bit = c->count * c->dim;
+                uint64_t n = ( uint64_t )row_len * c->dim;
+                size_t needed = ( size_t )( ( bit + n + 7 ) / 8 );
+                if ( needed > c->values.len )
+                    rc = vda_buf_append( &( c->values ), NULL, needed - c->values.len );
+                for ( i = 0; rc == 0 && i < n; ++i, ++bit )
+                {
+                    if ( base[ i ] != 0 )
+                        c->values.data[ bit >> 3 ] |= ( uint8_t )( 1 << ( bit & 7 ) );
+                }
+                c->count += row_len;
+                end = ( uint32_t )c->count;
+            }
+            break;
+
+        default :
+            rc = vda_buf_append( &( c->values ), base, ( size_t )row_len * c->dim * c->elem_bytes );
+            c->count += row_len;
+            end = ( uint32_t )c->count;
+            break;
+    }
+    if ( rc == 0 )
+        rc = vda_buf_u32( &( c->offsets ), end );
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+/* the field of level in the type-chain of a column, children are written behind it */
+static rc_t vda_fb_column_field( vda_buf * fb, const vda_col * c, uint32_t level, size_t * pos )
+{
+    const vda_type * t = &( c->types[ level ] );
+    bool has_child = ( level + 1 < c->depth );
+    vda_fb_field f[ 6 ];
+    size_t slots[ 3 ], at, vec;
+    rc_t rc;
+
+    memset( f, 0, sizeof f );
+    f[ 0 ].size = 4; f[ 0 ].offset = true;          /* name */
+    f[ 1 ].size = 1; f[ 1 ].value = 1;              /* nullable */
+    f[ 2 ].size = 1; f[ 2 ].value = t->id;          /* type_type */
+    f[ 3 ].size = 4; f[ 3 ].offset = true;          /* type */
+    f[ 5 ].size = 4; f[ 5 ].offset = true;          /* children */
+    rc = vda_fb_table( fb, f, 6, slots, pos );
+
+    if ( rc == 0 )
+        rc = vda_fb_string( fb, level == 0 ? c->def->name : "item", &at );
+    if ( rc == 0 )
+    {
+        vda_fb_patch( fb, slots[ 0 ], at );
+        memset( f, 0, sizeof f );
+        switch ( t->id )
+        {
+            case VDA_TYPE_INT :
+                f[ 0 ].size = 4; f[ 0 ].value = ( uint32_t )t->param;    /* bitWidth */
+                f[ 1 ].size = 1; f[ 1 ].value = t->is_signed ? 1 : 0;   /* is_signed */
+                rc = vda_fb_table( fb, f, 2, NULL, &at );
+                break;
+            case VDA_TYPE_FLOAT :
+                f[ 0 ].size = 2; f[ 0 ].value = ( uint16_t )t->param;    /* precision */
+                rc = vda_fb_table( fb, f, 1, NULL, &at );
+                break;
+            case VDA_TYPE_FIXED_LIST :
+                f[ 0 ].size = 4; f[ 0 ].value = ( uint32_t )t->param;    /* listSize */
+                rc = vda_fb_table( fb, f, 1, NULL, &at );
+                break;
+            default :
+                rc = vda_fb_table( fb, f, 0, NULL, &at );
+                break;
+        }
+    }
+    if ( rc == 0 )
+    {
+        vda_fb_patch( fb, slots[ 1 ], at );
+        rc = vda_fb_offsets( fb, has_child ? 1 : 0, &vec );
+    }
+    if ( rc == 0 )
+    {
+        vda_fb_patch( fb, slots[ 2 ], vec );
+        if ( has_child )
+        {
+            rc = vda_fb_column_field( fb, c, level + 1, &at );
+            if ( rc == 0 )
+                vda_fb_patch( fb, vec + 4, at );
+        }
+    }
+    return rc;
+}
+
+
+static rc_t vda_fb_schema( vda_dump * d, size_t * pos )
+{
+    vda_fb_field f[ 2 ];
+    size_t slot, vec;
+    uint32_t i;
+    rc_t rc;
+
+    memset( f, 0, sizeof f );
+    f[ 1 ].size = 4; f[ 1 ].offset = true;          /* fields, endianness = Little by default */
+    rc = vda_fb_table( &( d->fb ), f, 2, &slot, pos );
+    if ( rc == 0 )
+        rc = vda_fb_offsets( &( d->fb ), d->num_cols, &vec );
+    if ( rc == 0 )
+        vda_fb_patch( &( d->fb ), slot, vec );
+    for ( i = 0; rc == 0 && i < d->num_cols; ++i )
+    {
+        size_t at;
+        rc = vda_fb_column_field( &( d->fb ), &( d->cols[ i ] ), 0, &at );
+        if ( rc == 0 )
+            vda_fb_patch( &( d->fb ), vec + 4 + 4 * i, at );
+    }
+    return rc;
+}
+
+
+/* starts the flatbuffer of a message, the header-table has to follow */
+static rc_t vda_fb_message( vda_dump * d, uint8_t header_type, uint64_t body_len, size_t * header_slot )
+{
+    vda_fb_field f[ 4 ];
+    size_t pos;
+    rc_t rc;
+
+    d->fb.len = 0;
+    rc = vda_buf_u32( &( d->fb ), 0 );  /* root-offset */
+    memset( f, 0, sizeof f );
+    f[ 0 ].size = 2; f[ 0 ].value = VDA_METADATA_V5;    /* version */
+    f[ 1 ].size = 1; f[ 1 ].value = header_type;        /* header_type */
+    f[ 2 ].size = 4; f[ 2 ].offset = true;              /* header */
+    f[ 3 ].size = 8; f[ 3 ].value = body_len;           /* bodyLength */
+    if ( rc == 0 )
+        rc = vda_fb_table( &( d->fb ), f, 4, header_slot, &pos );
+    if ( rc == 0 )
+        vda_fb_patch( &( d->fb ), 0, pos );
+    return rc;
+}
+
+
+/* writes the message in d->fb followed by the body-buffers */
+static rc_t vda_write_message( vda_dump * d, const vda_buf ** bufs, uint32_t num_bufs, uint64_t body_len )
+{
+    uint64_t start = d->pos;
+    uint32_t hdr[ 2 ];
+    uint32_t i;
+    rc_t rc = vda_buf_pad( &( d->fb ), 8 );
+
+    hdr[ 0 ] = 0xFFFFFFFF;  /* continuation */
+    hdr[ 1 ] = ( uint32_t )d->fb.len;
+    if ( rc == 0 )
+        rc = vda_write( d, hdr, sizeof hdr );
+    if ( rc == 0 )
+        rc = vda_write( d, d->fb.data, d->fb.len );
+    for ( i = 0; rc == 0 && i < num_bufs; ++i )
+    {
+        if ( bufs[ i ] != NULL && bufs[ i ]->len > 0 )
+        {
+            rc = vda_write( d, bufs[ i ]->data, bufs[ i ]->len );
+            if ( rc == 0 )
+                rc = vda_write_pad( d, bufs[ i ]->len );
+        }
+    }
+    if ( rc == 0 && d->file && num_bufs > 0 )
+    {
+        /* Block { offset, metaDataLength, bodyLength } for the footer */
+        uint64_t block[ 3 ];
+        block[ 0 ] = start;
+        block[ 1 ] = sizeof hdr + d->fb.len;
+        block[ 2 ] = body_len;
+        rc = vda_buf_append( &( d->blocks ), block, sizeof block );
+    }
+    return rc;
+}
+
+
+static rc_t vda_write_schema( vda_dump * d )
+{
+    size_t slot, pos;
+    rc_t rc = vda_fb_message( d, VDA_MSG_SCHEMA, 0, &slot );
+    if ( rc == 0 )
+        rc = vda_fb_schema( d, &pos );
+    if ( rc == 0 )
+    {
+        vda_fb_patch( &( d->fb ), slot, pos );
+        rc = vda_write_message( d, NULL, 0, 0 );
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+#define VDA_MAX_BUFFERS ( VDA_MAX_DEPTH * 3 )
+
+/* collects the field-nodes and buffers of all columns in the order of the schema */
+static uint32_t vda_batch_layout( vda_dump * d, uint64_t * nodes, uint32_t * num_nodes,
+                                  const vda_buf ** bufs )
+{
+    uint32_t i, num_bufs = 0;
+    *num_nodes = 0;
+    for ( i = 0; i < d->num_cols; ++i )
+    {
+        vda_col * c = &( d->cols[ i ] );
+        uint32_t level;
+        uint64_t length = d->rows;
+        for ( level = 0; level < c->depth; ++level )
+        {
+            nodes[ 2 * *num_nodes ] = length;       /* length */
+            nodes[ 2 * *num_nodes + 1 ] = 0;        /* null_count */
+            ( *num_nodes )++;
+            bufs[ num_bufs++ ] = NULL;              /* validity, no nulls */
+            switch ( c->types[ level ].id )
+            {
+                case VDA_TYPE_UTF8 :
+                    bufs[ num_bufs++ ] = &( c->offsets );
+                    bufs[ num_bufs++ ] = &( c->values );
+                    break;
+                case VDA_TYPE_LIST :
+                    bufs[ num_bufs++ ] = &( c->offsets );
+                    length = c->count;
+                    break;
+                case VDA_TYPE_FIXED_LIST :
+                    length *= c->dim;
+                    break;
+                default :
+                    bufs[ num_bufs++ ] = &( c->values );
+                    break;
+            }
+        }
+    }
+    return num_bufs;
+}
+
+
+static rc_t vda_write_batch( vda_dump * d )
+{
+    uint64_t * nodes;
+    uint64_t * buffers;
+    const vda_buf ** bufs;
+    uint32_t num_nodes, num_bufs, i;
+    uint64_t body_len = 0;
+    rc_t rc = 0;
+
+    nodes = malloc( d->num_cols * VDA_MAX_DEPTH * 2 * sizeof *nodes );
+    buffers = malloc( d->num_cols * VDA_MAX_BUFFERS * 2 * sizeof *buffers );
+    bufs = malloc( d->num_cols * VDA_MAX_BUFFERS * sizeof *bufs );
+    if ( nodes == NULL || buffers == NULL || bufs == NULL )
+        rc = RC( rcExe, rcBuffer, rcAllocating, rcMemory, rcExhausted );
+    else
+    {
+        size_t slots[ 2 ], header_slot, pos, at;
+        vda_fb_field f[ 3 ];
+
+        num_bufs = vda_batch_layout( d, nodes, &num_nodes, bufs );
+        for ( i = 0; i < num_bufs; ++i )
+        {
+            uint64_t len = bufs[ i ] != NULL ? bufs[ i ]->len : 0;
+            buffers[ 2 * i ] = body_len;        /* offset */
+            buffers[ 2 * i + 1 ] = len;         /* length */
+            body_len += ( len + 7 ) / 8 * 8;
+        }
+
+        rc = vda_fb_message( d, VDA_MSG_BATCH, body_len, &header_slot );
+        memset( f, 0, sizeof f );
+        f[ 0 ].size = 8; f[ 0 ].value = d->rows;    /* length */
+        f[ 1 ].size = 4; f[ 1 ].offset = true;      /* nodes */
+        f[ 2 ].size = 4; f[ 2 ].offset = true;      /* buffers */
+        if ( rc == 0 )
+            rc = vda_fb_table( &( d->fb ), f, 3, slots, &pos );
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), header_slot, pos );
+            rc = vda_fb_structs( &( d->fb ), nodes, num_nodes, 2, &at );
+        }
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), slots[ 0 ], at );
+            rc = vda_fb_structs( &( d->fb ), buffers, num_bufs, 2, &at );
+        }
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), slots[ 1 ], at );
+            rc = vda_write_message( d, bufs, num_bufs, body_len );
+        }
+    }
+    DISP_RC( rc, "writing arrow record-batch failed" );
+    free( bufs );
+    free( buffers );
+    free( nodes );
+
+    for ( i = 0; rc == 0 && i < d->num_cols; ++i )
+        rc = vda_col_reset( &( d->cols[ i ] ) );
+    d->rows = 0;
+    return rc;
+}
+
+
+static rc_t vda_write_end( vda_dump * d )
+{
+    uint32_t eos[ 2 ] = { 0xFFFFFFFF, 0 };
+    rc_t rc = vda_write( d, eos, sizeof eos );
+    if ( rc == 0 && d->file )
+    {
+        /* Footer { version, schema, dictionaries, recordBatches } */
+        vda_fb_field f[ 4 ];
+        size_t slots[ 3 ], pos, at;
+        uint32_t footer_len;
+
+        d->fb.len = 0;
+        rc = vda_buf_u32( &( d->fb ), 0 );
+        memset( f, 0, sizeof f );
+        f[ 0 ].size = 2; f[ 0 ].value = VDA_METADATA_V5;
+        f[ 1 ].size = 4; f[ 1 ].offset = true;
+        f[ 2 ].size = 4; f[ 2 ].offset = true;
+        f[ 3 ].size = 4; f[ 3 ].offset = true;
+        if ( rc == 0 )
+            rc = vda_fb_table( &( d->fb ), f, 4, slots, &pos );
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), 0, pos );
+            rc = vda_fb_schema( d, &at );
+        }
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), slots[ 0 ], at );
+            rc = vda_fb_structs( &( d->fb ), NULL, 0, 3, &at );
+        }
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), slots[ 1 ], at );
+            rc = vda_fb_structs( &( d->fb ), ( const uint64_t * )d->blocks.data,
+                                 ( uint32_t )( d->blocks.len / 24 ), 3, &at );
+        }
+        if ( rc == 0 )
+        {
+            vda_fb_patch( &( d->fb ), slots[ 2 ], at );
+            footer_len = ( uint32_t )d->fb.len;
+            rc = vda_write( d, d->fb.data, d->fb.len );
+        }
+        if ( rc == 0 )
+            rc = vda_write( d, &footer_len, sizeof footer_len );
+        if ( rc == 0 )
+            rc = vda_write( d, vda_magic, 6 );
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static rc_t vda_make_cols( vda_dump * d )
+{
+    p_row_context r_ctx = d->r_ctx;
+    const Vector * v = &( r_ctx->col_defs->cols );
+    uint32_t start = VectorStart( v );
+    uint32_t end = start + VectorLength( v );
+    const VSchema * schema = NULL;
+    uint32_t i;
+    rc_t rc;
+
+    d->cols = calloc( VectorLength( v ) + 1, sizeof *( d->cols ) );
+    if ( d->cols == NULL )
+        return RC( rcExe, rcBuffer, rcAllocating, rcMemory, rcExhausted );
+
+    rc = VTableOpenSchema( r_ctx->table, &schema );
+    DISP_RC( rc, "VTableOpenSchema() failed" );
+    if ( rc != 0 )
+    {
+        /* without schema only the 4na-translation is missing */
+        schema = NULL;
+        rc = 0;
+    }
+
+    for ( i = start; rc == 0 && i < end; ++i )
+    {
+        p_col_def def = VectorGet( v, i );
+        if ( def != NULL && def->valid && !def->excluded )
+        {
+            vda_col * c = &( d->cols[ d->num_cols ] );
+            if ( vda_col_init( c, def, schema, !r_ctx->ctx->without_sra_types ) )
+            {
+                d->num_cols++;
+                rc = vda_col_reset( c );
+            }
+            else
+            {
+                PLOGMSG( klogWarn, ( klogWarn, "column $(col_name) has no arrow-type, skipped",
+                                     "col_name=%s", def->name ) );
+            }
+        }
+    }
+    if ( schema != NULL )
+        VSchemaRelease( schema );
+    if ( rc == 0 && d->num_cols == 0 )
+    {
+        rc = RC( rcExe, rcColumn, rcReading, rcType, rcUnsupported );
+        LOGERR( klogErr, rc, "no column can be written as arrow" );
+    }
+    return rc;
+}
+
+
+static rc_t vda_read_row( vda_dump * d, int64_t row_id )
+{
+    rc_t rc = 0;
+    uint32_t i;
+    if ( d->r_ctx->where != NULL )
+    {
+        bool match;
+        rc = vdfi_expr_match( d->r_ctx->where, d->r_ctx->cursor, row_id, &match );
+        if ( rc != 0 || !match )
+            return rc;
+    }
+    for ( i = 0; rc == 0 && i < d->num_cols; ++i )
+    {
+        vda_col * c = &( d->cols[ i ] );
+        const void * base = NULL;
+        uint32_t elem_bits, boff, row_len;
+        rc_t rc1 = VCursorCellDataDirect( d->r_ctx->cursor, row_id, c->def->idx,
+                                          &elem_bits, &base, &boff, &row_len );
+        if ( rc1 != 0 || ( boff & 7 ) != 0 )
+        {
+            PLOGERR( klogInt, ( klogInt, rc1,
+                     "VCursorCellData( col:$(col_name) at row #$(row_nr) ) failed",
+                     "col_name=%s,row_nr=%ld", c->def->name, row_id ) );
+            /* be forgiving and write an empty cell if it cannot be read */
+            row_len = 0;
+        }
+        else
+            base = ( const uint8_t * )base + ( boff >> 3 );
+        rc = vda_col_add_cell( c, base, row_len );
+    }
+    if ( rc == 0 )
+        d->rows++;
+    return rc;
+}
+
+
+static size_t vda_batch_bytes( const vda_dump * d )
+{
+    size_t res = 0;
+    uint32_t i;
+    for ( i = 0; i < d->num_cols; ++i )
+        res += d->cols[ i ].values.len;
+    return res;
+}
+
+
+rc_t vda_dump_rows( p_row_context r_ctx )
+{
+    vda_dump d;
+    const struct num_gen_iter * iter = NULL;
+    uint32_t i;
+    rc_t rc;
+
+    memset( &d, 0, sizeof d );
+    d.r_ctx = r_ctx;
+    d.file = ( r_ctx->ctx->format == df_arrow_file );
+    d.writer = KOutWriterGet();
+    d.writer_data = KOutDataGet();
+
+    rc = vda_make_cols( &d );
+    if ( rc == 0 )
+    {
+        rc = num_gen_iterator_make( r_ctx->ctx->rows, &iter );
+        DISP_RC( rc, "num_gen_iterator_make() failed" );
+    }
+    if ( rc == 0 && d.file )
+    {
+        rc = vda_write( &d, vda_magic, sizeof vda_magic );
+    }
+    if ( rc == 0 )
+        rc = vda_write_schema( &d );
+    if ( rc == 0 )
+    {
+        int64_t row_id;
+        while ( rc == 0 && num_gen_iterator_next( iter, &row_id, &rc ) )
+        {
+            if ( rc == 0 && d.rows == 0 )
+                rc = Quitting();
+            if ( rc == 0 )
+                rc = vda_read_row( &d, row_id );
+            if ( rc == 0 && ( d.rows >= VDA_BATCH_ROWS || vda_batch_bytes( &d ) >= VDA_BATCH_BYTES ) )
+                rc = vda_write_batch( &d );
+        }
+        if ( rc == 0 && d.rows > 0 )
+            rc = vda_write_batch( &d );
+        if ( rc == 0 )
+            rc = vda_write_end( &d );
+    }
+
+    if ( iter != NULL )
+        num_gen_iterator_destroy( iter );
+    for ( i = 0; i < d.num_cols; ++i )
+    {
+        free( d.cols[ i ].offsets.data );
+        free( d.cols[ i ].values.data );
+    }
+    free( d.cols );
+    free( d.fb.data );
+    free( d.blocks.data );
+    return rc;
+}
@@ -169,7 +169,7 @@ const char *vdcd_get_read_filter_txt( const uint32_t id )
 #define SRA_PACBIO_HOLE_STATUS "PacBio:hole:status"
 
 
-static bool vdcd_type_cmp( const VSchema *my_schema, VTypedecl * typedecl, const char * to_check )
+bool vdcd_type_cmp( const VSchema *my_schema, VTypedecl * typedecl, const char * to_check )
 {
     VTypedecl type_to_check;
     rc_t rc = VSchemaResolveTypedecl ( my_schema, &type_to_check, "%s", to_check );
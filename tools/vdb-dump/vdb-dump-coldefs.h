@@ -98,6 +98,7 @@ bool vdcd_extract_from_phys_table( col_defs* defs, const VTable *my_table );
 uint32_t vdcd_add_to_cursor( col_defs* defs, const VCursor *my_cursor );
 void vdcd_reset_content( col_defs* defs );
 void vdcd_ins_trans_fkt( col_defs* defs, const VSchema *my_schema );
+bool vdcd_type_cmp( const VSchema *my_schema, VTypedecl * typedecl, const char * to_check );
 void vdcd_exclude_these_columns( col_defs* defs, const char* column_names );
 bool vdcd_get_first_none_static_column_idx( col_defs* defs, const VCursor * cur, uint32_t * idx );
 
@@ -103,6 +103,7 @@ static void vdco_init_values( p_dump_context ctx )
     ctx->columns = NULL;
     ctx->excluded_columns = NULL;
     ctx->filter = NULL;
+    ctx->where = NULL;
     ctx->idx_range = NULL;
     ctx->output_file = NULL;
     ctx->output_path = NULL;
@@ -117,6 +118,7 @@ static void vdco_init_values( p_dump_context ctx )
     ctx->indented_line_len = 0;
     ctx->phase = 0;
     ctx->slice_depth = 0;
+    ctx->threads = 1;
 
     ctx->help_requested = false;
     ctx->usage_requested = false;
@@ -138,6 +140,7 @@ static void vdco_init_values( p_dump_context ctx )
     ctx->diff = false;
     ctx->show_spotgroups = false;
     ctx->show_spread = false;
+    ctx->profile = false;
     ctx->len_spread = false;
     ctx->interactive = false;    
 }
@@ -206,6 +209,12 @@ rc_t vdco_destroy( p_dump_context ctx )
             ctx->row_range = NULL;
         }
 
+        if ( ctx->where != NULL )
+        {
+            free( (void*)ctx->where );
+            ctx->where = NULL;
+        }
+
 
         if ( ctx->output_path != NULL )
         {
@@ -270,6 +279,21 @@ static rc_t vdco_set_filter( p_dump_context ctx, const char *src )
     return rc;
 }
 
+static rc_t vdco_set_where( p_dump_context ctx, const char *src )
+{
+    rc_t rc = 0;
+    if ( ( ctx == NULL )||( src == NULL ) )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+    }
+    if ( rc == 0 )
+    {
+        rc = vdco_set_str( (char**)&(ctx->where), src );
+        DISP_RC( rc, "vdco_set_str() failed" );
+    }
+    return rc;
+}
+
 /* not static because can be called directly from vdb-dump.c */
 rc_t vdco_set_table( p_dump_context ctx, const char * src )
 {
@@ -437,6 +461,10 @@ static bool vdco_set_format( p_dump_context ctx, const char *src )
         ctx->format = df_bin;
     else if ( strcmp( src, "sql" ) == 0 )
         ctx->format = df_sql;
+    else if ( strcmp( src, "arrow" ) == 0 )
+        ctx->format = df_arrow;
+    else if ( strcmp( src, "arrow-file" ) == 0 )
+        ctx->format = df_arrow_file;
     else ctx->format = df_default;
     return true;
 }
@@ -607,9 +635,11 @@ static void vdco_evaluate_options( const Args *my_args,
     /*ctx->force_sra_schema = vdco_get_bool_option( my_args, OPTION_SRASCHEMA, false );*/
     ctx->merge_ranges = vdco_get_bool_option( my_args, OPTION_MERGE_RANGES, false );
     ctx->show_spread = vdco_get_bool_option( my_args, OPTION_SPREAD, false );
+    ctx->profile = vdco_get_bool_option( my_args, OPTION_PROFILE, false );
     ctx->len_spread = vdco_get_bool_option( my_args, OPTION_LEN_SPREAD, false );
     ctx->interactive = vdco_get_bool_option( my_args, OPTION_INTERACTIVE, false );
     ctx->slice_depth = vdco_get_uint16_option( my_args, OPTION_SLICE, 0 );
+    ctx->threads = vdco_get_uint16_option( my_args, OPTION_THREADS, 1 );
     
     ctx->cur_cache_size = vdco_get_size_t_option( my_args, OPTION_CUR_CACHE, CURSOR_CACHE_SIZE );
     ctx->output_buffer_size = vdco_get_size_t_option( my_args, OPTION_OUT_BUF_SIZE, DEF_OPTION_OUT_BUF_SIZE );
@@ -634,6 +664,7 @@ static void vdco_evaluate_options( const Args *my_args,
     ctx->idx_range_requested = ( ctx->idx_range != NULL );
     vdco_set_schemas( my_args, ctx );
     vdco_set_filter( ctx, vdco_get_str_option( my_args, OPTION_FILTER ) );
+    vdco_set_where( ctx, vdco_get_str_option( my_args, OPTION_WHERE ) );
     vdco_set_boolean_char( ctx, vdco_get_str_option( my_args, OPTION_BOOLEAN ) );
 
     if ( ctx->format == df_sra_dump )
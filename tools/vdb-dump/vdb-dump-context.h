@@ -85,9 +85,12 @@ extern "C" {
 /*#define OPTION_SRASCHEMA         "sraschema"*/
 #define OPTION_MERGE_RANGES      "merge-ranges"
 #define OPTION_SPREAD            "spread"
+#define OPTION_PROFILE           "profile"
 #define OPTION_SLICE             "slice"
 #define OPTION_INTERACTIVE       "interactive"
 #define OPTION_LEN_SPREAD        "len-spread"
+#define OPTION_THREADS           "threads"
+#define OPTION_WHERE             "where"
 
 #define ALIAS_ROW_ID_ON         "I"
 #define ALIAS_LINE_FEED         "l"
@@ -136,7 +139,9 @@ typedef enum dump_format_t
     df_qual,
     df_qual1,
     df_bin,
-    df_sql
+    df_sql,
+    df_arrow,
+    df_arrow_file
 } dump_format_t;
 
 /********************************************************************
@@ -150,6 +155,7 @@ typedef struct dump_context
     const char *columns;
     const char *excluded_columns;
     const char *filter;
+    const char *where;
     const char *idx_range;
     const char *row_range;
     const char *output_file;
@@ -162,6 +168,7 @@ typedef struct dump_context
     uint16_t phase;
     uint32_t generic_idx;
     uint32_t slice_depth;
+    uint32_t threads;
     size_t cur_cache_size;
     size_t output_buffer_size;
     dump_format_t format;
@@ -198,6 +205,7 @@ typedef struct dump_context
     bool show_spotgroups;
     bool merge_ranges;
     bool show_spread;
+    bool profile;
     bool interactive;
     bool len_spread;
 } dump_context;
@@ -26,11 +26,17 @@
 
 #include "vdb-dump-filter.h"
 #include <klib/text.h>
+#include <klib/log.h>
+#include <klib/rc.h>
+#include <vdb/schema.h>
+#include <vdb/cursor.h>
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
 #include <os-native.h>
 #include <sysalloc.h>
 
@@ -114,3 +120,635 @@ uint16_t vdfi_count( p_filters flts )
     if ( flts == NULL ) return 0;
     return flts->count;
 }
+
+/********************************************************************
+typed expression ( --where )
+********************************************************************/
+
+enum { vdfi_node_and, vdfi_node_or, vdfi_node_not, vdfi_node_cmp };
+enum { vdfi_cmp_eq, vdfi_cmp_ne, vdfi_cmp_lt, vdfi_cmp_le, vdfi_cmp_gt, vdfi_cmp_ge,
+       vdfi_cmp_prefix, vdfi_cmp_range };
+
+typedef struct vdfi_value
+{
+    bool text;
+    bool is_int;
+    bool negative;      /* an integer below zero, compared to an unsigned column */
+    int64_t i;
+    uint64_t u;         /* the integer, compared to an unsigned column */
+    double d;
+    char * s;
+    size_t len;
+} vdfi_value;
+
+typedef struct vdfi_node
+{
+    uint32_t kind;
+    uint32_t cmp;
+    uint32_t col;
+    vdfi_value v1;
+    vdfi_value v2;      /* upper bound of a range */
+    struct vdfi_node * left;
+    struct vdfi_node * right;
+} vdfi_node;
+
+typedef struct vdfi_col
+{
+    char * name;
+    uint32_t idx;
+    VTypedesc type_desc;
+    bool text;
+    /* the cell of row_id, read on demand */
+    int64_t row_id;
+    bool loaded;
+    const uint8_t * base;
+    uint32_t elem_bits;
+    uint32_t row_len;
+} vdfi_col;
+
+typedef struct vdfi_expr
+{
+    vdfi_node * root;
+    vdfi_col * cols;
+    uint32_t num_cols;
+} vdfi_expr;
+
+enum { vdfi_tk_end, vdfi_tk_ident, vdfi_tk_number, vdfi_tk_string, vdfi_tk_op,
+       vdfi_tk_lparen, vdfi_tk_rparen, vdfi_tk_dots };
+
+typedef struct vdfi_parser
+{
+    const char * text;
+    const char * p;
+    const char * tok;
+    size_t tok_len;
+    uint32_t kind;
+    vdfi_expr * expr;
+    const VCursor * cursor;
+} vdfi_parser;
+
+
+static rc_t vdfi_syntax_error( vdfi_parser * ps, const char * msg )
+{
+    rc_t rc = RC( rcExe, rcNoTarg, rcParsing, rcParam, rcInvalid );
+    PLOGERR( klogErr, ( klogErr, rc, "--where: $(msg) at position #$(pos) in '$(expr)'",
+                        "msg=%s,pos=%u,expr=%s", msg, ( uint32_t )( ps->tok - ps->text ), ps->text ) );
+    return rc;
+}
+
+
+static void vdfi_next_token( vdfi_parser * ps )
+{
+    const char * p = ps->p;
+    while ( isspace( ( unsigned char )*p ) )
+        p++;
+    ps->tok = p;
+    if ( *p == 0 )
+        ps->kind = vdfi_tk_end;
+    else if ( isalpha( ( unsigned char )*p ) || *p == '_' )
+    {
+        while ( isalnum( ( unsigned char )*p ) || *p == '_' )
+            p++;
+        ps->kind = vdfi_tk_ident;
+    }
+    else if ( isdigit( ( unsigned char )*p ) ||
+              ( ( *p == '-' || *p == '+' || *p == '.' ) && isdigit( ( unsigned char )p[ 1 ] ) ) )
+    {
+        p++;
+        while ( isalnum( ( unsigned char )*p ) ||
+                ( *p == '.' && p[ 1 ] != '.' ) ||
+                ( ( *p == '-' || *p == '+' ) && ( p[ -1 ] == 'e' || p[ -1 ] == 'E' ) ) )
+            p++;
+        ps->kind = vdfi_tk_number;
+    }
+    else if ( *p == '\'' || *p == '"' )
+    {
+        char quote = *p++;
+        while ( *p != 0 && *p != quote )
+            p++;
+        if ( *p == quote )
+            p++;
+        ps->kind = vdfi_tk_string;
+    }
+    else if ( *p == '(' || *p == ')' )
+    {
+        ps->kind = ( *p++ == '(' ) ? vdfi_tk_lparen : vdfi_tk_rparen;
+    }
+    else if ( p[ 0 ] == '.' && p[ 1 ] == '.' )
+    {
+        p += 2;
+        ps->kind = vdfi_tk_dots;
+    }
+    else
+    {
+        /* operators: = == != <> < <= > >= ^= && || ! */
+        if ( ( p[ 1 ] == '=' && strchr( "=!<>^", p[ 0 ] ) != NULL ) ||
+             ( p[ 0 ] == '<' && p[ 1 ] == '>' ) ||
+             ( p[ 0 ] == '&' && p[ 1 ] == '&' ) ||
+             ( p[ 0 ] == '|' && p[ 1 ] == '|' ) )
+            p += 2;
+        else
+            p++;
+        ps->kind = vdfi_tk_op;
+    }
+    ps->tok_len = p - ps->tok;
+    ps->p = p;
+}
+
+
+static bool vdfi_is_token( const vdfi_parser * ps, const char * word )
+{
+    size_t len = strlen( word );
+    if ( ps->tok_len != len || ( ps->kind != vdfi_tk_ident && ps->kind != vdfi_tk_op ) )
+        return false;
+    return ( strcase_cmp( ps->tok, len, word, len, ( uint32_t )len ) == 0 );
+}
+
+
+static void vdfi_destroy_node( vdfi_node * node )
+{
+    if ( node != NULL )
+    {
+        vdfi_destroy_node( node->left );
+        vdfi_destroy_node( node->right );
+        free( node->v1.s );
+        free( node->v2.s );
+        free( node );
+    }
+}
+
+
+static rc_t vdfi_make_node( vdfi_node ** node, uint32_t kind, vdfi_node * left, vdfi_node * right )
+{
+    *node = calloc( 1, sizeof **node );
+    if ( *node == NULL )
+    {
+        vdfi_destroy_node( left );
+        vdfi_destroy_node( right );
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    }
+    ( *node )->kind = kind;
+    ( *node )->left = left;
+    ( *node )->right = right;
+    return 0;
+}
+
+
+/* finds the column in the expression or adds it to the expression and the cursor */
+static rc_t vdfi_column( vdfi_parser * ps, uint32_t * col )
+{
+    vdfi_expr * e = ps->expr;
+    vdfi_col * c;
+    uint32_t i;
+    VTypedecl type_decl;
+    rc_t rc;
+
+    for ( i = 0; i < e->num_cols; ++i )
+    {
+        if ( strlen( e->cols[ i ].name ) == ps->tok_len &&
+             strncmp( e->cols[ i ].name, ps->tok, ps->tok_len ) == 0 )
+        {
+            *col = i;
+            return 0;
+        }
+    }
+
+    c = realloc( e->cols, ( e->num_cols + 1 ) * sizeof *c );
+    if ( c == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    e->cols = c;
+    c = &( e->cols[ e->num_cols ] );
+    memset( c, 0, sizeof *c );
+    c->name = string_dup( ps->tok, ps->tok_len );
+    if ( c->name == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    e->num_cols++;
+
+    /* the column may already be in the cursor because it is dumped too */
+    rc = VCursorAddColumn( ps->cursor, &( c->idx ), "%s", c->name );
+    if ( GetRCState( rc ) == rcExists )
+        rc = VCursorGetColumnIdx( ps->cursor, &( c->idx ), "%s", c->name );
+    if ( rc != 0 )
+    {
+        PLOGERR( klogErr, ( klogErr, rc, "--where: cannot read column '$(col)'", "col=%s", c->name ) );
+        return rc;
+    }
+    rc = VCursorDatatype( ps->cursor, c->idx, &type_decl, &( c->type_desc ) );
+    if ( rc != 0 )
+    {
+        PLOGERR( klogErr, ( klogErr, rc, "--where: no datatype for column '$(col)'", "col=%s", c->name ) );
+        return rc;
+    }
+
+    c->text = ( ( c->type_desc.domain == vtdAscii || c->type_desc.domain == vtdUnicode ) &&
+                c->type_desc.intrinsic_bits == 8 );
+    if ( !c->text )
+    {
+        uint32_t bits = c->type_desc.intrinsic_bits;
+        bool num = ( bits == 8 || bits == 16 || bits == 32 || bits == 64 );
+        if ( c->type_desc.domain == vtdFloat )
+            num = ( bits == 32 || bits == 64 );
+        if ( !num )
+            return vdfi_syntax_error( ps, "type of column cannot be compared" );
+    }
+    *col = e->num_cols - 1;
+    return 0;
+}
+
+
+static rc_t vdfi_value_parse( vdfi_parser * ps, vdfi_value * v, const vdfi_col * c )
+{
+    bool text = c->text;
+    if ( ps->kind == vdfi_tk_string )
+    {
+        if ( !text )
+            return vdfi_syntax_error( ps, "numeric column compared to text" );
+        v->text = true;
+        v->len = ps->tok_len >= 2 ? ps->tok_len - 2 : 0;
+        if ( ps->tok_len < 2 || ps->tok[ ps->tok_len - 1 ] != ps->tok[ 0 ] )
+            return vdfi_syntax_error( ps, "unterminated text" );
+        v->s = string_dup( ps->tok + 1, v->len );
+        if ( v->s == NULL )
+            return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    }
+    else if ( ps->kind == vdfi_tk_number )
+    {
+        char buf[ 64 ];
+        char * end;
+        if ( text )
+            return vdfi_syntax_error( ps, "text column compared to a number" );
+        if ( ps->tok_len >= sizeof buf )
+            return vdfi_syntax_error( ps, "number too long" );
+        memmove( buf, ps->tok, ps->tok_len );
+        buf[ ps->tok_len ] = 0;
+        /* decimal only: no octal, hex or inf/nan */
+        if ( strspn( buf, "0123456789+-.eE" ) != ps->tok_len )
+            return vdfi_syntax_error( ps, "invalid number" );
+        errno = 0;
+        if ( c->type_desc.domain == vtdUint && buf[ 0 ] != '-' )
+            v->u = strtoull( buf, &end, 10 );
+        else
+        {
+            v->i = strtoll( buf, &end, 10 );
+            v->negative = ( v->i < 0 );
+            v->u = 0;
+        }
+        v->is_int = ( *end == 0 );
+        if ( v->is_int && errno == ERANGE && c->type_desc.domain != vtdFloat )
+            return vdfi_syntax_error( ps, "number out of range" );
+        if ( !v->is_int || errno == ERANGE )
+        {
+            v->is_int = false;
+            errno = 0;
+            v->d = strtod( buf, &end );
+            if ( *end != 0 )
+                return vdfi_syntax_error( ps, "invalid number" );
+            if ( errno == ERANGE )
+                return vdfi_syntax_error( ps, "number out of range" );
+        }
+    }
+    else
+        return vdfi_syntax_error( ps, "value expected" );
+    vdfi_next_token( ps );
+    return 0;
+}
+
+
+static rc_t vdfi_parse_or( vdfi_parser * ps, vdfi_node ** node );
+
+static rc_t vdfi_parse_cmp( vdfi_parser * ps, vdfi_node ** node )
+{
+    static const char * ops[] = { "=", "!=", "<", "<=", ">", ">=", "^=" };
+    rc_t rc;
+    uint32_t i;
+    const vdfi_col * col;
+
+    if ( ps->kind != vdfi_tk_ident )
+        return vdfi_syntax_error( ps, "column-name expected" );
+    rc = vdfi_make_node( node, vdfi_node_cmp, NULL, NULL );
+    if ( rc == 0 )
+        rc = vdfi_column( ps, &( ( *node )->col ) );
+    if ( rc != 0 )
+        return rc;
+    col = &( ps->expr->cols[ ( *node )->col ] );
+    vdfi_next_token( ps );
+
+    if ( vdfi_is_token( ps, "in" ) )
+    {
+        ( *node )->cmp = vdfi_cmp_range;
+        vdfi_next_token( ps );
+        rc = vdfi_value_parse( ps, &( ( *node )->v1 ), col );
+        if ( rc == 0 && ps->kind != vdfi_tk_dots )
+            rc = vdfi_syntax_error( ps, "'..' expected" );
+        if ( rc == 0 )
+        {
+            vdfi_next_token( ps );
+            rc = vdfi_value_parse( ps, &( ( *node )->v2 ), col );
+        }
+        return rc;
+    }
+
+    for ( i = 0; i < sizeof ops / sizeof ops[ 0 ]; ++i )
+    {
+        if ( vdfi_is_token( ps, ops[ i ] ) )
+            break;
+    }
+    if ( vdfi_is_token( ps, "==" ) )
+        i = vdfi_cmp_eq;
+    else if ( vdfi_is_token( ps, "<>" ) )
+        i = vdfi_cmp_ne;
+    else if ( i == sizeof ops / sizeof ops[ 0 ] )
+        return vdfi_syntax_error( ps, "comparison expected" );
+    if ( i == vdfi_cmp_prefix && !col->text )
+        return vdfi_syntax_error( ps, "prefix-match on a numeric column" );
+    ( *node )->cmp = i;
+    vdfi_next_token( ps );
+    return vdfi_value_parse( ps, &( ( *node )->v1 ), col );
+}
+
+
+static rc_t vdfi_parse_factor( vdfi_parser * ps, vdfi_node ** node )
+{
+    rc_t rc;
+    if ( vdfi_is_token( ps, "not" ) || vdfi_is_token( ps, "!" ) )
+    {
+        vdfi_node * inner = NULL;
+        vdfi_next_token( ps );
+        rc = vdfi_parse_factor( ps, &inner );
+        if ( rc == 0 )
+            rc = vdfi_make_node( node, vdfi_node_not, inner, NULL );
+        else
+            vdfi_destroy_node( inner );
+    }
+    else if ( ps->kind == vdfi_tk_lparen )
+    {
+        vdfi_next_token( ps );
+        rc = vdfi_parse_or( ps, node );
+        if ( rc == 0 )
+        {
+            if ( ps->kind != vdfi_tk_rparen )
+                rc = vdfi_syntax_error( ps, "')' expected" );
+            else
+                vdfi_next_token( ps );
+        }
+    }
+    else
+        rc = vdfi_parse_cmp( ps, node );
+    return rc;
+}
+
+
+static rc_t vdfi_parse_and( vdfi_parser * ps, vdfi_node ** node )
+{
+    rc_t rc = vdfi_parse_factor( ps, node );
+    while ( rc == 0 && ( vdfi_is_token( ps, "and" ) || vdfi_is_token( ps, "&&" ) ) )
+    {
+        vdfi_node * right = NULL;
+        vdfi_next_token( ps );
+        rc = vdfi_parse_factor( ps, &right );
+        if ( rc == 0 )
+            rc = vdfi_make_node( node, vdfi_node_and, *node, right );
+        else
+            vdfi_destroy_node( right );
+    }
+    return rc;
+}
+
+
+static rc_t vdfi_parse_or( vdfi_parser * ps, vdfi_node ** node )
+{
+    rc_t rc = vdfi_parse_and( ps, node );
+    while ( rc == 0 && ( vdfi_is_token( ps, "or" ) || vdfi_is_token( ps, "||" ) ) )
+    {
+        vdfi_node * right = NULL;
+        vdfi_next_token( ps );
+        rc = vdfi_parse_and( ps, &right );
+        if ( rc == 0 )
+            rc = vdfi_make_node( node, vdfi_node_or, *node, right );
+        else
+            vdfi_destroy_node( right );
+    }
+    return rc;
+}
+
+
+void vdfi_expr_destroy( struct vdfi_expr * expr )
+{
+    if ( expr != NULL )
+    {
+        uint32_t i;
+        vdfi_destroy_node( expr->root );
+        for ( i = 0; i < expr->num_cols; ++i )
+            free( expr->cols[ i ].name );
+        free( expr->cols );
+        free( expr );
+    }
+}
+
+
+rc_t vdfi_expr_make( struct vdfi_expr ** expr, const char * text, const VCursor * cursor )
+{
+    rc_t rc = 0;
+    vdfi_parser ps;
+
+    if ( expr == NULL || text == NULL || cursor == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcParam, rcNull );
+
+    memset( &ps, 0, sizeof ps );
+    ps.text = text;
+    ps.p = text;
+    ps.cursor = cursor;
+    ps.expr = calloc( 1, sizeof *( ps.expr ) );
+    if ( ps.expr == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+
+    vdfi_next_token( &ps );
+    rc = vdfi_parse_or( &ps, &( ps.expr->root ) );
+    if ( rc == 0 && ps.kind != vdfi_tk_end )
+        rc = vdfi_syntax_error( &ps, "unexpected text" );
+    if ( rc == 0 )
+        *expr = ps.expr;
+    else
+        vdfi_expr_destroy( ps.expr );
+    return rc;
+}
+
+
+/* -1, 0, 1 for the element p of the numeric column c against v */
+static int vdfi_cmp_number( const vdfi_col * c, const uint8_t * p, const vdfi_value * v )
+{
+    uint32_t bits = c->type_desc.intrinsic_bits;
+    if ( c->type_desc.domain == vtdFloat )
+    {
+        double x, y = v->is_int ? ( double )v->i : v->d;
+        if ( bits == 32 )
+        {
+            float f;
+            memmove( &f, p, sizeof f );
+            x = f;
+        }
+        else
+            memmove( &x, p, sizeof x );
+        return ( x > y ) - ( x < y );
+    }
+    else if ( c->type_desc.domain == vtdInt )
+    {
+        int64_t x;
+        switch ( bits )
+        {
+            case 8  : { int8_t t;  memmove( &t, p, 1 ); x = t; } break;
+            case 16 : { int16_t t; memmove( &t, p, 2 ); x = t; } break;
+            case 32 : { int32_t t; memmove( &t, p, 4 ); x = t; } break;
+            default : memmove( &x, p, 8 ); break;
+        }
+        if ( v->is_int )
+            return ( x > v->i ) - ( x < v->i );
+        return ( ( double )x > v->d ) - ( ( double )x < v->d );
+    }
+    else
+    {
+        uint64_t x;
+        switch ( bits )
+        {
+            case 8  : x = p[ 0 ]; break;
+            case 16 : { uint16_t t; memmove( &t, p, 2 ); x = t; } break;
+            case 32 : { uint32_t t; memmove( &t, p, 4 ); x = t; } break;
+            default : memmove( &x, p, 8 ); break;
+        }
+        if ( v->is_int )
+        {
+            if ( v->negative )
+                return 1;
+            return ( x > v->u ) - ( x < v->u );
+        }
+        return ( ( double )x > v->d ) - ( ( double )x < v->d );
+    }
+}
+
+
+static int vdfi_cmp_text( const uint8_t * p, size_t len, const vdfi_value * v )
+{
+    size_t n = len < v->len ? len : v->len;
+    int res = memcmp( p, v->s, n );
+    if ( res == 0 )
+        res = ( len > v->len ) - ( len < v->len );
+    return ( res > 0 ) - ( res < 0 );
+}
+
+
+static bool vdfi_cmp_result( uint32_t cmp, int res )
+{
+    switch ( cmp )
+    {
+        case vdfi_cmp_eq : return res == 0;
+        case vdfi_cmp_ne : return res != 0;
+        case vdfi_cmp_lt : return res < 0;
+        case vdfi_cmp_le : return res <= 0;
+        case vdfi_cmp_gt : return res > 0;
+        case vdfi_cmp_ge : return res >= 0;
+    }
+    return false;
+}
+
+
+static bool vdfi_eval_cmp( const vdfi_node * node, const vdfi_col * c )
+{
+    if ( c->text )
+    {
+        size_t len = c->row_len;
+        if ( node->cmp == vdfi_cmp_prefix )
+            return len >= node->v1.len && memcmp( c->base, node->v1.s, node->v1.len ) == 0;
+        if ( node->cmp == vdfi_cmp_range )
+            return vdfi_cmp_text( c->base, len, &( node->v1 ) ) >= 0 &&
+                   vdfi_cmp_text( c->base, len, &( node->v2 ) ) <= 0;
+        return vdfi_cmp_result( node->cmp, vdfi_cmp_text( c->base, len, &( node->v1 ) ) );
+    }
+    else
+    {
+        /* any element of the cell */
+        uint32_t step = c->type_desc.intrinsic_bits / 8;
+        uint64_t i, n = ( uint64_t )c->row_len * c->type_desc.intrinsic_dim;
+        const uint8_t * p = c->base;
+        for ( i = 0; i < n; ++i, p += step )
+        {
+            bool res;
+            if ( node->cmp == vdfi_cmp_range )
+                res = vdfi_cmp_number( c, p, &( node->v1 ) ) >= 0 &&
+                      vdfi_cmp_number( c, p, &( node->v2 ) ) <= 0;
+            else
+                res = vdfi_cmp_result( node->cmp, vdfi_cmp_number( c, p, &( node->v1 ) ) );
+            if ( res )
+                return true;
+        }
+        return false;
+    }
+}
+
+
+static rc_t vdfi_load( vdfi_col * c, const VCursor * cursor, int64_t row_id )
+{
+    rc_t rc = 0;
+    if ( !c->loaded || c->row_id != row_id )
+    {
+        const void * base;
+        uint32_t boff;
+        rc = VCursorCellDataDirect( cursor, row_id, c->idx, &( c->elem_bits ), &base, &boff, &( c->row_len ) );
+        c->loaded = ( rc == 0 );
+        if ( rc != 0 )
+        {
+            PLOGERR( klogInt, ( klogInt, rc,
+                     "VCursorCellDataDirect( col:$(col_name) at row #$(row_nr) ) failed",
+                     "col_name=%s,row_nr=%ld", c->name, row_id ) );
+        }
+        else
+        {
+            c->row_id = row_id;
+            c->base = ( const uint8_t * )base + ( boff >> 3 );
+        }
+    }
+    return rc;
+}
+
+
+static rc_t vdfi_eval( vdfi_expr * expr, const vdfi_node * node, const VCursor * cursor,
+                       int64_t row_id, bool * match )
+{
+    rc_t rc = 0;
+    switch ( node->kind )
+    {
+        case vdfi_node_and :
+            rc = vdfi_eval( expr, node->left, cursor, row_id, match );
+            if ( rc == 0 && *match )
+                rc = vdfi_eval( expr, node->right, cursor, row_id, match );
+            break;
+
+        case vdfi_node_or :
+            rc = vdfi_eval( expr, node->left, cursor, row_id, match );
+            if ( rc == 0 && !*match )
+                rc = vdfi_eval( expr, node->right, cursor, row_id, match );
+            break;
+
+        case vdfi_node_not :
+            rc = vdfi_eval( expr, node->left, cursor, row_id, match );
+            *match = !*match;
+            break;
+
+        default :
+            {
+                vdfi_col * c = &( expr->cols[ node->col ] );
+                rc = vdfi_load( c, cursor, row_id );
+                *match = ( rc == 0 && vdfi_eval_cmp( node, c ) );
+            }
+            break;
+    }
+    return rc;
+}
+
+
+rc_t vdfi_expr_match( struct vdfi_expr * expr, const VCursor * cursor, int64_t row_id, bool * match )
+{
+    *match = true;
+    if ( expr == NULL || expr->root == NULL )
+        return 0;
+    return vdfi_eval( expr, expr->root, cursor, row_id, match );
+}
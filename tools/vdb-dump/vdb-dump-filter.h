@@ -28,6 +28,7 @@
 #define _h_vdb_dump_filter_
 
 #include <klib/vector.h>
+#include <vdb/cursor.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -75,6 +76,27 @@ void vdfi_reset( p_filters flts );
 bool vdfi_match( p_filters flts );
 uint16_t vdfi_count( p_filters flts );
 
+/********************************************************************
+a typed expression over the raw values of cursor-columns ( --where ):
+    expr := term { "or" term }
+    term := factor { "and" factor }
+    factor := "not" factor | "(" expr ")" | COLUMN op VALUE
+            | COLUMN "in" VALUE ".." VALUE
+    op := "=" | "!=" | "<" | "<=" | ">" | ">=" | "^=" ( prefix )
+    VALUE := number | 'text' | "text"
+text-columns are compared as a whole, numeric columns match if
+one of the elements of the cell matches
+********************************************************************/
+struct vdfi_expr;
+
+/* parses the expression and adds the columns it needs to the cursor,
+   the cursor must not be open yet */
+rc_t vdfi_expr_make( struct vdfi_expr ** expr, const char * text, const VCursor * cursor );
+void vdfi_expr_destroy( struct vdfi_expr * expr );
+
+/* reads only the columns needed to decide about the row */
+rc_t vdfi_expr_match( struct vdfi_expr * expr, const VCursor * cursor, int64_t row_id, bool * match );
+
 #ifdef __cplusplus
 }
 #endif
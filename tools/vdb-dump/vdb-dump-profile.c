@@ -0,0 +1,1355 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <vdb/table.h>
+#include <vdb/cursor.h>
+#include <vdb/schema.h>
+
+#include <kdb/table.h>
+#include <kdb/column.h>
+
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+
+#include <klib/out.h>
+#include <klib/log.h>
+#include <klib/rc.h>
+#include <klib/num-gen.h>
+
+#include "vdb-dump-profile.h"
+#include "vdb-dump-helper.h"
+
+#include <os-native.h>
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+rc_t Quitting( void );
+
+/*************************************************************************************
+    --profile: one pass over the rows, collecting for every column
+
+        all columns ........ row-count, empty rows, distribution of the
+                             element-count per row ( log2-histogram ),
+                             distinct-count estimate ( HyperLogLog ),
+                             sizes of the physical blobs in the scanned row-range
+        integer / bool ..... min, max, sum, log2-histogram of the values
+        float .............. min, max, sum, count of NaN's ( with more than one
+                             thread the float-sum can differ in the last digits )
+        text ............... the most frequent values ( space-saving top-k )
+
+    every worker-thread takes batches of row-ids from the shared row-set-iterator
+    and adds them to statistics of its own, all statistics are mergeable:
+    the ones of the threads are merged at the end, then the main thread walks
+    the blobs of the physical columns and writes the JSON-report
+*************************************************************************************/
+
+#define VDP_BATCH_ROWS 4096
+#define VDP_BUCKETS 65
+#define VDP_HLL_BITS 12
+#define VDP_HLL_REGS ( 1 << VDP_HLL_BITS )
+#define VDP_TOP_K 10
+#define VDP_TOP_CAPACITY 256
+#define VDP_TOP_SLOTS 512
+#define VDP_TOP_VALUE_LEN 128
+
+enum vdp_kind { vdp_other, vdp_unsigned, vdp_signed, vdp_float, vdp_text };
+
+/* ----------------------------------------------------------------------------------- */
+
+/* bucket of the log2-histograms: 0 for 0, b for 2^(b-1) ... 2^b - 1 */
+static uint32_t vdp_bit_len( uint64_t v )
+{
+    uint32_t n = 0;
+    if ( v >= ( ( uint64_t )1 << 32 ) ) { n += 32; v >>= 32; }
+    if ( v >= ( 1 << 16 ) ) { n += 16; v >>= 16; }
+    if ( v >= ( 1 << 8 ) ) { n += 8; v >>= 8; }
+    if ( v >= ( 1 << 4 ) ) { n += 4; v >>= 4; }
+    if ( v >= ( 1 << 2 ) ) { n += 2; v >>= 2; }
+    if ( v >= ( 1 << 1 ) ) { n += 1; v >>= 1; }
+    return n + ( uint32_t )v;
+}
+
+
+static uint64_t vdp_mix( uint64_t h )
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+static uint64_t vdp_hash_bytes( const uint8_t * p, size_t len )
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i;
+    for ( i = 0; i < len; ++i )
+    {
+        h ^= p[ i ];
+        h *= 0x100000001b3ULL;
+    }
+    return vdp_mix( h ^ len );
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static void vdp_hll_add( uint8_t * regs, uint64_t hash )
+{
+    uint32_t idx = ( uint32_t )( hash >> ( 64 - VDP_HLL_BITS ) );
+    /* the guard-bit limits the rank to 64 - VDP_HLL_BITS + 1 */
+    uint64_t rest = ( hash << VDP_HLL_BITS ) | ( ( uint64_t )1 << ( VDP_HLL_BITS - 1 ) );
+    uint8_t rank = ( uint8_t )( 65 - vdp_bit_len( rest ) );
+    if ( rank > regs[ idx ] )
+        regs[ idx ] = rank;
+}
+
+
+static void vdp_hll_merge( uint8_t * dst, const uint8_t * src )
+{
+    uint32_t i;
+    for ( i = 0; i < VDP_HLL_REGS; ++i )
+    {
+        if ( src[ i ] > dst[ i ] )
+            dst[ i ] = src[ i ];
+    }
+}
+
+
+static uint64_t vdp_hll_estimate( const uint8_t * regs )
+{
+    double m = VDP_HLL_REGS;
+    double sum = 0.0, e;
+    uint32_t i, zeros = 0;
+    for ( i = 0; i < VDP_HLL_REGS; ++i )
+    {
+        sum += ldexp( 1.0, -( int )regs[ i ] );
+        if ( regs[ i ] == 0 )
+            zeros++;
+    }
+    e = ( 0.7213 / ( 1.0 + 1.079 / m ) ) * m * m / sum;
+    /* small range: linear counting is more exact */
+    if ( e <= 2.5 * m && zeros > 0 )
+        e = m * log( m / zeros );
+    return ( uint64_t )( e + 0.5 );
+}
+
+/* -----------------------------------------------------------------------------------
+    space-saving top-k: a min-heap ( by count ) of VDP_TOP_CAPACITY counters,
+    found by value via an open-addressing table of heap-positions;
+    a new value replaces the counter with the smallest count and inherits
+    this count as its error
+   ----------------------------------------------------------------------------------- */
+
+typedef struct vdp_top_entry
+{
+    uint64_t count;
+    uint64_t error;
+    uint64_t hash;
+    uint32_t slot;
+    uint32_t len;
+    char value[ VDP_TOP_VALUE_LEN ];
+} vdp_top_entry;
+
+typedef struct vdp_top
+{
+    vdp_top_entry entries[ VDP_TOP_CAPACITY ];
+    int32_t slots[ VDP_TOP_SLOTS ];
+    uint32_t count;
+} vdp_top;
+
+
+static void vdp_top_reset( vdp_top * t )
+{
+    uint32_t i;
+    for ( i = 0; i < VDP_TOP_SLOTS; ++i )
+        t->slots[ i ] = -1;
+    t->count = 0;
+}
+
+
+static int32_t vdp_top_find( const vdp_top * t, uint64_t hash, const char * value, uint32_t len )
+{
+    uint32_t k = ( uint32_t )hash & ( VDP_TOP_SLOTS - 1 );
+    while ( t->slots[ k ] >= 0 )
+    {
+        const vdp_top_entry * e = &( t->entries[ t->slots[ k ] ] );
+        if ( e->hash == hash && e->len == len && memcmp( e->value, value, len ) == 0 )
+            return t->slots[ k ];
+        k = ( k + 1 ) & ( VDP_TOP_SLOTS - 1 );
+    }
+    return -1;
+}
+
+
+static void vdp_top_hash( vdp_top * t, uint32_t pos )
+{
+    uint32_t k = ( uint32_t )t->entries[ pos ].hash & ( VDP_TOP_SLOTS - 1 );
+    while ( t->slots[ k ] >= 0 )
+        k = ( k + 1 ) & ( VDP_TOP_SLOTS - 1 );
+    t->slots[ k ] = pos;
+    t->entries[ pos ].slot = k;
+}
+
+
+/* removes a slot, moving the following slots of the probe-sequence back */
+static void vdp_top_unhash( vdp_top * t, uint32_t k )
+{
+    uint32_t j = k;
+    t->slots[ k ] = -1;
+    while ( true )
+    {
+        uint32_t home;
+        j = ( j + 1 ) & ( VDP_TOP_SLOTS - 1 );
+        if ( t->slots[ j ] < 0 )
+            return;
+        home = ( uint32_t )t->entries[ t->slots[ j ] ].hash & ( VDP_TOP_SLOTS - 1 );
+        /* the entry stays, if its home-slot is cyclic in ( k, j ] */
+        if ( k <= j ? ( k < home && home <= j ) : ( k < home || home <= j ) )
+            continue;
+        t->slots[ k ] = t->slots[ j ];
+        t->entries[ t->slots[ k ] ].slot = k;
+        t->slots[ j ] = -1;
+        k = j;
+    }
+}
+
+
+static void vdp_top_swap( vdp_top * t, uint32_t a, uint32_t b )
+{
+    vdp_top_entry tmp = t->entries[ a ];
+    t->entries[ a ] = t->entries[ b ];
+    t->entries[ b ] = tmp;
+    t->slots[ t->entries[ a ].slot ] = a;
+    t->slots[ t->entries[ b ].slot ] = b;
+}
+
+
+static void vdp_top_sift_down( vdp_top * t, uint32_t pos )
+{
+    while ( true )
+    {
+        uint32_t smallest = pos;
+        uint32_t l = 2 * pos + 1;
+        uint32_t r = l + 1;
+        if ( l < t->count && t->entries[ l ].count < t->entries[ smallest ].count )
+            smallest = l;
+        if ( r < t->count && t->entries[ r ].count < t->entries[ smallest ].count )
+            smallest = r;
+        if ( smallest == pos )
+            return;
+        vdp_top_swap( t, pos, smallest );
+        pos = smallest;
+    }
+}
+
+
+static void vdp_top_sift_up( vdp_top * t, uint32_t pos )
+{
+    while ( pos > 0 )
+    {
+        uint32_t parent = ( pos - 1 ) / 2;
+        if ( t->entries[ parent ].count <= t->entries[ pos ].count )
+            return;
+        vdp_top_swap( t, pos, parent );
+        pos = parent;
+    }
+}
+
+
+static void vdp_top_set( vdp_top_entry * e, uint64_t hash, const char * value, uint32_t len )
+{
+    e->hash = hash;
+    e->len = len;
+    memmove( e->value, value, len );
+}
+
+
+/* values longer than VDP_TOP_VALUE_LEN are counted by their prefix */
+static void vdp_top_add( vdp_top * t, const char * value, uint32_t len )
+{
+    uint64_t hash;
+    int32_t pos;
+    if ( len > VDP_TOP_VALUE_LEN )
+        len = VDP_TOP_VALUE_LEN;
+    hash = vdp_hash_bytes( ( const uint8_t * )value, len );
+    pos = vdp_top_find( t, hash, value, len );
+    if ( pos >= 0 )
+    {
+        t->entries[ pos ].count++;
+        vdp_top_sift_down( t, pos );
+    }
+    else if ( t->count < VDP_TOP_CAPACITY )
+    {
+        vdp_top_entry * e = &( t->entries[ t->count ] );
+        vdp_top_set( e, hash, value, len );
+        e->count = 1;
+        e->error = 0;
+        vdp_top_hash( t, t->count );
+        vdp_top_sift_up( t, t->count++ );
+    }
+    else
+    {
+        vdp_top_entry * e = &( t->entries[ 0 ] );
+        vdp_top_unhash( t, e->slot );
+        vdp_top_set( e, hash, value, len );
+        e->error = e->count++;
+        vdp_top_hash( t, 0 );
+        vdp_top_sift_down( t, 0 );
+    }
+}
+
+
+static int CC vdp_top_cmp_desc( const void * a, const void * b )
+{
+    const vdp_top_entry * ea = a;
+    const vdp_top_entry * eb = b;
+    if ( ea->count != eb->count )
+        return ea->count > eb->count ? -1 : 1;
+    if ( ea->len != eb->len )
+    {
+        uint32_t n = ea->len < eb->len ? ea->len : eb->len;
+        int res = memcmp( ea->value, eb->value, n );
+        return res != 0 ? res : ( ea->len < eb->len ? -1 : 1 );
+    }
+    return memcmp( ea->value, eb->value, ea->len );
+}
+
+
+/* merging of two summaries: a value missing in one of them may have been
+   counted there up to the smallest count of it ( if it is full ) */
+static rc_t vdp_top_merge( vdp_top * dst, const vdp_top * src )
+{
+    uint64_t min_dst = dst->count == VDP_TOP_CAPACITY ? dst->entries[ 0 ].count : 0;
+    uint64_t min_src = src->count == VDP_TOP_CAPACITY ? src->entries[ 0 ].count : 0;
+    vdp_top_entry * all = malloc( ( dst->count + src->count ) * sizeof *all );
+    bool * used = calloc( VDP_TOP_CAPACITY, sizeof *used );
+    uint32_t i, n = 0;
+    rc_t rc = 0;
+
+    if ( all == NULL || used == NULL )
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        for ( i = 0; i < dst->count; ++i )
+        {
+            vdp_top_entry * e = &( all[ n++ ] );
+            int32_t pos;
+            *e = dst->entries[ i ];
+            pos = vdp_top_find( src, e->hash, e->value, e->len );
+            if ( pos >= 0 )
+            {
+                e->count += src->entries[ pos ].count;
+                e->error += src->entries[ pos ].error;
+                used[ pos ] = true;
+            }
+            else
+            {
+                e->count += min_src;
+                e->error += min_src;
+            }
+        }
+        for ( i = 0; i < src->count; ++i )
+        {
+            if ( !used[ i ] )
+            {
+                vdp_top_entry * e = &( all[ n++ ] );
+                *e = src->entries[ i ];
+                e->count += min_dst;
+                e->error += min_dst;
+            }
+        }
+        qsort( all, n, sizeof *all, vdp_top_cmp_desc );
+        if ( n > VDP_TOP_CAPACITY )
+            n = VDP_TOP_CAPACITY;
+
+        /* ascending order is a valid min-heap */
+        vdp_top_reset( dst );
+        for ( i = 0; i < n; ++i )
+        {
+            dst->entries[ i ] = all[ n - 1 - i ];
+            vdp_top_hash( dst, i );
+        }
+        dst->count = n;
+    }
+    free( used );
+    free( all );
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct vdp_blobs
+{
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t min;
+    uint64_t max;
+    uint64_t hist[ VDP_BUCKETS ];
+    bool physical;
+} vdp_blobs;
+
+typedef struct vdp_col
+{
+    const col_def * def;
+    uint32_t idx;           /* in the cursor of the thread */
+    uint32_t kind;
+    uint32_t bits;          /* of a single value */
+    uint32_t dim;
+    uint64_t rows;
+    uint64_t empty_rows;
+    uint64_t elements;
+    uint64_t len_min;
+    uint64_t len_max;
+    uint64_t len_hist[ VDP_BUCKETS ];
+    uint64_t values;
+    uint64_t nan;
+    uint64_t u_min, u_max;
+    int64_t i_min, i_max;
+    double f_min, f_max;
+    double sum;             /* of float-values */
+    uint64_t sum_lo;        /* of integer-values: exact, 128 bit */
+    int64_t sum_hi;
+    uint64_t pos_hist[ VDP_BUCKETS ];   /* values >= 0 */
+    uint64_t neg_hist[ VDP_BUCKETS ];   /* magnitude of values < 0 */
+    bool distinct_valid;
+    uint8_t * hll;
+    vdp_top * top;
+    vdp_blobs blobs;        /* only in the merged statistics */
+} vdp_col;
+
+
+static uint32_t vdp_kind_of( const VTypedesc * desc )
+{
+    uint32_t bits = desc->intrinsic_bits;
+    bool whole_bytes = ( bits == 8 || bits == 16 || bits == 32 || bits == 64 );
+    switch ( desc->domain )
+    {
+        case vtdBool     :
+        case vtdUint     : return whole_bytes ? vdp_unsigned : vdp_other;
+        case vtdInt      : return whole_bytes ? vdp_signed : vdp_other;
+        case vtdFloat    : return ( bits == 32 || bits == 64 ) ? vdp_float : vdp_other;
+        case vtdAscii    :
+        case vtdUnicode  : return ( bits == 8 && desc->intrinsic_dim == 1 ) ? vdp_text : vdp_other;
+    }
+    return vdp_other;
+}
+
+
+static rc_t vdp_col_init( vdp_col * c, const col_def * def )
+{
+    memset( c, 0, sizeof *c );
+    c->def = def;
+    c->kind = vdp_kind_of( &( def->type_desc ) );
+    c->bits = def->type_desc.intrinsic_bits;
+    c->dim = def->type_desc.intrinsic_dim > 0 ? def->type_desc.intrinsic_dim : 1;
+    c->len_min = UINT64_MAX;
+    c->u_min = UINT64_MAX;
+    c->i_min = INT64_MAX;
+    c->i_max = INT64_MIN;
+    c->f_min = HUGE_VAL;
+    c->f_max = -HUGE_VAL;
+    c->distinct_valid = true;
+    c->hll = calloc( VDP_HLL_REGS, 1 );
+    if ( c->hll == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    if ( c->kind == vdp_text )
+    {
+        c->top = malloc( sizeof *( c->top ) );
+        if ( c->top == NULL )
+            return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        vdp_top_reset( c->top );
+    }
+    return 0;
+}
+
+
+static void vdp_col_free( vdp_col * c )
+{
+    free( c->hll );
+    free( c->top );
+}
+
+
+/* the integer-sums are exact, so they do not depend on how the rows are split between threads */
+static void vdp_sum_add( vdp_col * c, uint64_t lo, int64_t hi )
+{
+    uint64_t old = c->sum_lo;
+    c->sum_lo += lo;
+    c->sum_hi += hi + ( c->sum_lo < old ? 1 : 0 );
+}
+
+
+/* the magnitude of the integer-sum, a negative sum is converted by its magnitude to not lose the low bits */
+static bool vdp_sum_magnitude( const vdp_col * c, uint64_t * hi, uint64_t * lo )
+{
+    *lo = c->sum_lo;
+    *hi = ( uint64_t )c->sum_hi;
+    if ( c->sum_hi < 0 )
+    {
+        *lo = ~*lo + 1;
+        *hi = ~*hi + ( *lo == 0 ? 1 : 0 );
+    }
+    return c->sum_hi < 0;
+}
+
+
+static double vdp_sum_value( const vdp_col * c )
+{
+    uint64_t lo, hi;
+    bool negative;
+    double res;
+    if ( c->kind == vdp_float )
+        return c->sum;
+    negative = vdp_sum_magnitude( c, &hi, &lo );
+    res = ( double )hi * 18446744073709551616.0 + ( double )lo;
+    return negative ? -res : res;
+}
+
+
+static void vdp_add_unsigned( vdp_col * c, uint64_t v )
+{
+    if ( v < c->u_min ) c->u_min = v;
+    if ( v > c->u_max ) c->u_max = v;
+    vdp_sum_add( c, v, 0 );
+    c->pos_hist[ vdp_bit_len( v ) ]++;
+}
+
+
+static void vdp_add_signed( vdp_col * c, int64_t v )
+{
+    if ( v < c->i_min ) c->i_min = v;
+    if ( v > c->i_max ) c->i_max = v;
+    vdp_sum_add( c, ( uint64_t )v, v < 0 ? -1 : 0 );
+    if ( v < 0 )
+        c->neg_hist[ vdp_bit_len( ( uint64_t )0 - ( uint64_t )v ) ]++;
+    else
+        c->pos_hist[ vdp_bit_len( ( uint64_t )v ) ]++;
+}
+
+
+static void vdp_add_float( vdp_col * c, double v )
+{
+    if ( v != v )
+        c->nan++;
+    else
+    {
+        if ( v < c->f_min ) c->f_min = v;
+        if ( v > c->f_max ) c->f_max = v;
+        c->sum += v;
+    }
+}
+
+/*
+    C ... vdp_col * c
+    P ... const uint8_t * to the values
+    N ... number of values
+    T ... type of the values
+    ADD . vdp_add_unsigned / vdp_add_signed / vdp_add_float
+    AS .. type ADD takes
+*/
+#define VDP_VALUES( C, P, N, T, ADD, AS )               \
+    {                                                   \
+        const T * v = ( const T * )( P );               \
+        uint64_t i;                                     \
+        for ( i = 0; i < ( N ); ++i )                   \
+            ADD( ( C ), ( AS )v[ i ] );                 \
+    }
+
+/* the distinct-count of numeric columns counts elements ( all values of a dimension ) */
+static void vdp_hll_elements( vdp_col * c, const uint8_t * p, uint32_t row_len )
+{
+    size_t elem_bytes = ( c->bits / 8 ) * c->dim;
+    uint32_t i;
+    for ( i = 0; i < row_len; ++i, p += elem_bytes )
+    {
+        if ( elem_bytes <= 8 )
+        {
+            uint64_t v = 0;
+            memmove( &v, p, elem_bytes );
+            vdp_hll_add( c->hll, vdp_mix( v ) );
+        }
+        else
+            vdp_hll_add( c->hll, vdp_hash_bytes( p, elem_bytes ) );
+    }
+}
+
+
+static void vdp_add_cell( vdp_col * c, const void * base, uint32_t boff, uint32_t row_len )
+{
+    const uint8_t * p = ( const uint8_t * )base + ( boff >> 3 );
+    uint64_t n = ( uint64_t )row_len * c->dim;
+
+    c->rows++;
+    c->elements += row_len;
+    if ( row_len == 0 )
+        c->empty_rows++;
+    if ( row_len < c->len_min )
+        c->len_min = row_len;
+    if ( row_len > c->len_max )
+        c->len_max = row_len;
+    c->len_hist[ vdp_bit_len( row_len ) ]++;
+    c->values += n;
+
+    switch ( c->kind )
+    {
+        case vdp_unsigned :
+            switch ( c->bits )
+            {
+                case 8  : VDP_VALUES( c, p, n, uint8_t, vdp_add_unsigned, uint64_t ) break;
+                case 16 : VDP_VALUES( c, p, n, uint16_t, vdp_add_unsigned, uint64_t ) break;
+                case 32 : VDP_VALUES( c, p, n, uint32_t, vdp_add_unsigned, uint64_t ) break;
+                case 64 : VDP_VALUES( c, p, n, uint64_t, vdp_add_unsigned, uint64_t ) break;
+            }
+            vdp_hll_elements( c, p, row_len );
+            break;
+
+        case vdp_signed :
+            switch ( c->bits )
+            {
+                case 8  : VDP_VALUES( c, p, n, int8_t, vdp_add_signed, int64_t ) break;
+                case 16 : VDP_VALUES( c, p, n, int16_t, vdp_add_signed, int64_t ) break;
+                case 32 : VDP_VALUES( c, p, n, int32_t, vdp_add_signed, int64_t ) break;
+                case 64 : VDP_VALUES( c, p, n, int64_t, vdp_add_signed, int64_t ) break;
+            }
+            vdp_hll_elements( c, p, row_len );
+            break;
+
+        case vdp_float :
+            if ( c->bits == 32 )
+                VDP_VALUES( c, p, n, float, vdp_add_float, double )
+            else
+                VDP_VALUES( c, p, n, double, vdp_add_float, double )
+            vdp_hll_elements( c, p, row_len );
+            break;
+
+        case vdp_text :
+            vdp_hll_add( c->hll, vdp_hash_bytes( p, row_len ) );
+            vdp_top_add( c->top, ( const char * )p, row_len );
+            break;
+
+        default :
+            /* the distinct-count of other columns counts byte-aligned cells */
+            if ( ( boff & 7 ) == 0 && ( ( n * c->bits ) & 7 ) == 0 )
+                vdp_hll_add( c->hll, vdp_hash_bytes( p, ( size_t )( ( n * c->bits ) >> 3 ) ) );
+            else
+                c->distinct_valid = false;
+            break;
+    }
+}
+#undef VDP_VALUES
+
+
+static void vdp_hist_merge( uint64_t * dst, const uint64_t * src )
+{
+    uint32_t i;
+    for ( i = 0; i < VDP_BUCKETS; ++i )
+        dst[ i ] += src[ i ];
+}
+
+
+static rc_t vdp_col_merge( vdp_col * dst, const vdp_col * src )
+{
+    rc_t rc = 0;
+    dst->rows += src->rows;
+    dst->empty_rows += src->empty_rows;
+    dst->elements += src->elements;
+    if ( src->len_min < dst->len_min ) dst->len_min = src->len_min;
+    if ( src->len_max > dst->len_max ) dst->len_max = src->len_max;
+    vdp_hist_merge( dst->len_hist, src->len_hist );
+    dst->values += src->values;
+    dst->nan += src->nan;
+    if ( src->u_min < dst->u_min ) dst->u_min = src->u_min;
+    if ( src->u_max > dst->u_max ) dst->u_max = src->u_max;
+    if ( src->i_min < dst->i_min ) dst->i_min = src->i_min;
+    if ( src->i_max > dst->i_max ) dst->i_max = src->i_max;
+    if ( src->f_min < dst->f_min ) dst->f_min = src->f_min;
+    if ( src->f_max > dst->f_max ) dst->f_max = src->f_max;
+    dst->sum += src->sum;
+    vdp_sum_add( dst, src->sum_lo, src->sum_hi );
+    vdp_hist_merge( dst->pos_hist, src->pos_hist );
+    vdp_hist_merge( dst->neg_hist, src->neg_hist );
+    dst->distinct_valid = dst->distinct_valid && src->distinct_valid;
+    vdp_hll_merge( dst->hll, src->hll );
+    if ( dst->top != NULL && src->top != NULL )
+        rc = vdp_top_merge( dst->top, src->top );
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+typedef struct vdp_profile
+{
+    p_dump_context ctx;
+    const VTable * table;
+    const struct num_gen_iter * iter;
+    KLock * lock;
+    bool stop;
+} vdp_profile;
+
+typedef struct vdp_worker
+{
+    vdp_profile * p;
+    vdp_col * cols;
+    uint32_t num_cols;
+    int64_t first_row;
+    int64_t last_row;
+    uint64_t rows;
+    rc_t rc;
+    int64_t row_id[ VDP_BATCH_ROWS ];
+} vdp_worker;
+
+
+static rc_t vdp_worker_init( vdp_worker * w, vdp_profile * p, const col_defs * cols )
+{
+    rc_t rc = 0;
+    uint32_t i, n = VectorLength( &( cols->cols ) );
+    w->p = p;
+    w->first_row = INT64_MAX;
+    w->last_row = INT64_MIN;
+    w->cols = calloc( n > 0 ? n : 1, sizeof *( w->cols ) );
+    if ( w->cols == NULL )
+        return RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    for ( i = 0; rc == 0 && i < n; ++i )
+    {
+        const col_def * cd = VectorGet( &( cols->cols ), i );
+        if ( cd != NULL && cd->valid && !cd->excluded )
+            rc = vdp_col_init( &( w->cols[ w->num_cols++ ] ), cd );
+    }
+    return rc;
+}
+
+
+static void vdp_worker_free( vdp_worker * w )
+{
+    uint32_t i;
+    if ( w->cols != NULL )
+    {
+        for ( i = 0; i < w->num_cols; ++i )
+            vdp_col_free( &( w->cols[ i ] ) );
+        free( w->cols );
+    }
+}
+
+
+/* takes the next batch of row-ids from the shared iterator, 0 if there are no more */
+static uint32_t vdp_next_batch( vdp_worker * w, rc_t * rc )
+{
+    vdp_profile * p = w->p;
+    uint32_t count = 0;
+    *rc = KLockAcquire( p->lock );
+    if ( *rc == 0 )
+    {
+        while ( !p->stop && count < VDP_BATCH_ROWS &&
+                num_gen_iterator_next( p->iter, &( w->row_id[ count ] ), rc ) )
+        {
+            if ( *rc != 0 )
+                break;
+            count++;
+        }
+        if ( *rc != 0 )
+            p->stop = true;
+        KLockUnlock( p->lock );
+    }
+    return *rc == 0 ? count : 0;
+}
+
+
+static void vdp_stop( vdp_profile * p )
+{
+    if ( KLockAcquire( p->lock ) == 0 )
+    {
+        p->stop = true;
+        KLockUnlock( p->lock );
+    }
+}
+
+
+static rc_t vdp_worker_scan( vdp_worker * w )
+{
+    const VCursor * cursor;
+    rc_t rc = VTableCreateCachedCursorRead( w->p->table, &cursor, w->p->ctx->cur_cache_size );
+    DISP_RC( rc, "VTableCreateCursorRead() failed" );
+    if ( rc == 0 )
+    {
+        uint32_t i;
+        for ( i = 0; rc == 0 && i < w->num_cols; ++i )
+        {
+            rc = VCursorAddColumn( cursor, &( w->cols[ i ].idx ), "%s", w->cols[ i ].def->name );
+            DISP_RC( rc, "VCursorAddColumn() failed" );
+        }
+        if ( rc == 0 )
+        {
+            rc = VCursorOpen( cursor );
+            DISP_RC( rc, "VCursorOpen() failed" );
+        }
+        while ( rc == 0 )
+        {
+            uint32_t count = vdp_next_batch( w, &rc );
+            if ( rc == 0 && count > 0 )
+                rc = Quitting();
+            if ( rc != 0 || count == 0 )
+                break;
+
+            if ( w->row_id[ 0 ] < w->first_row )
+                w->first_row = w->row_id[ 0 ];
+            if ( w->row_id[ count - 1 ] > w->last_row )
+                w->last_row = w->row_id[ count - 1 ];
+            w->rows += count;
+
+            for ( i = 0; rc == 0 && i < count; ++i )
+            {
+                uint32_t j;
+                for ( j = 0; rc == 0 && j < w->num_cols; ++j )
+                {
+                    vdp_col * c = &( w->cols[ j ] );
+                    const void * base;
+                    uint32_t elem_bits, boff, row_len;
+                    rc = VCursorCellDataDirect( cursor, w->row_id[ i ], c->idx, &elem_bits, &base, &boff, &row_len );
+                    if ( rc != 0 )
+                        PLOGERR( klogInt, ( klogInt, rc, "VCursorCellDataDirect( row #$(row), column $(col) ) failed",
+                                 "row=%ld,col=%s", w->row_id[ i ], c->def->name ) );
+                    else
+                        vdp_add_cell( c, base, boff, row_len );
+                }
+            }
+        }
+        VCursorRelease( cursor );
+    }
+    if ( rc != 0 )
+        vdp_stop( w->p );
+    return rc;
+}
+
+
+static rc_t CC vdp_worker_thread( const KThread *self, void *data )
+{
+    vdp_worker * w = data;
+    w->rc = vdp_worker_scan( w );
+    return w->rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+static rc_t vdp_walk_blobs( const KTable * ktbl, vdp_col * c, int64_t first, int64_t last )
+{
+    const KColumn * kcol;
+    vdp_blobs * b = &( c->blobs );
+    rc_t rc = KTableOpenColumnRead( ktbl, &kcol, "%s", c->def->name );
+    if ( rc != 0 )
+        return 0;   /* not a physical column */
+
+    b->physical = true;
+    b->min = UINT64_MAX;
+    {
+        int64_t col_first;
+        uint64_t col_count;
+        rc = KColumnIdRange( kcol, &col_first, &col_count );
+        DISP_RC( rc, "KColumnIdRange() failed" );
+        if ( rc == 0 )
+        {
+            int64_t id = first > col_first ? first : col_first;
+            int64_t col_last = col_first + ( int64_t )col_count - 1;
+            if ( last > col_last )
+                last = col_last;
+            while ( rc == 0 && id <= last )
+            {
+                const KColumnBlob * blob;
+                rc = Quitting();
+                if ( rc == 0 && KColumnOpenBlobRead( kcol, &blob, id ) != 0 )
+                {
+                    /* a gap in the column: continue with the next row that has a blob */
+                    int64_t next;
+                    if ( KColumnFindFirstRowId( kcol, &next, id ) != 0 || next <= id )
+                        break;
+                    id = next;
+                    continue;
+                }
+                if ( rc == 0 )
+                {
+                    int64_t first_in_blob;
+                    uint32_t ids_in_blob;
+                    rc = KColumnBlobIdRange( blob, &first_in_blob, &ids_in_blob );
+                    DISP_RC( rc, "KColumnBlobIdRange() failed" );
+                    if ( rc == 0 )
+                    {
+                        char buffer[ 8 ];
+                        size_t num_read, remaining;
+                        rc = KColumnBlobRead ( blob, 0, &buffer, 0, &num_read, &remaining );
+                        DISP_RC( rc, "KColumnBlobRead() failed" );
+                        if ( rc == 0 )
+                        {
+                            uint64_t size = num_read + remaining;
+                            b->count++;
+                            b->bytes += size;
+                            if ( size < b->min ) b->min = size;
+                            if ( size > b->max ) b->max = size;
+                            b->hist[ vdp_bit_len( size ) ]++;
+                        }
+                        id = first_in_blob + ( ids_in_blob > 0 ? ids_in_blob : 1 );
+                    }
+                    KColumnBlobRelease( blob );
+                }
+            }
+        }
+    }
+    KColumnRelease( kcol );
+    return rc;
+}
+
+/* -----------------------------------------------------------------------------------
+    the JSON-report
+   ----------------------------------------------------------------------------------- */
+
+/* text of ascii-columns is escaped byte by byte, utf8-text is passed through */
+static rc_t vdp_json_str( const char * s, size_t len, bool utf8 )
+{
+    size_t i, start = 0;
+    rc_t rc = KOutMsg( "\"" );
+    for ( i = 0; rc == 0 && i < len; ++i )
+    {
+        unsigned char ch = s[ i ];
+        if ( ch < 0x20 || ch == '"' || ch == '\\' || ( ch >= 0x80 && !utf8 ) )
+        {
+            if ( i > start )
+                rc = KOutMsg( "%.*s", ( uint32_t )( i - start ), s + start );
+            if ( rc == 0 )
+            {
+                if ( ch == '"' || ch == '\\' )
+                    rc = KOutMsg( "\\%c", ch );
+                else
+                    rc = KOutMsg( "\\u%04x", ch );
+            }
+            start = i + 1;
+        }
+    }
+    if ( rc == 0 && len > start )
+        rc = KOutMsg( "%.*s", ( uint32_t )( len - start ), s + start );
+    if ( rc == 0 )
+        rc = KOutMsg( "\"" );
+    return rc;
+}
+
+
+static rc_t vdp_json_double( double v )
+{
+    /* JSON has no NaN / Infinity */
+    if ( v != v || v - v != 0.0 )
+        return KOutMsg( "null" );
+    return KOutMsg( "%.16e", v );
+}
+
+
+/* the integer-sum as an exact decimal number, the float-sum like the other doubles */
+static rc_t vdp_json_sum( const vdp_col * c )
+{
+    uint32_t limbs[ 4 ];
+    char digits[ 48 ];
+    size_t n = sizeof digits;
+    uint64_t lo, hi;
+    bool negative, zero = false;
+
+    if ( c->kind == vdp_float )
+        return vdp_json_double( c->sum );
+
+    negative = vdp_sum_magnitude( c, &hi, &lo );
+    limbs[ 0 ] = ( uint32_t )( hi >> 32 );
+    limbs[ 1 ] = ( uint32_t )hi;
+    limbs[ 2 ] = ( uint32_t )( lo >> 32 );
+    limbs[ 3 ] = ( uint32_t )lo;
+    digits[ --n ] = 0;
+    while ( !zero )
+    {
+        /* divide the 128-bit magnitude by 10, most significant limb first */
+        uint64_t rem = 0;
+        uint32_t i;
+        zero = true;
+        for ( i = 0; i < 4; ++i )
+        {
+            uint64_t cur = ( rem << 32 ) | limbs[ i ];
+            limbs[ i ] = ( uint32_t )( cur / 10 );
+            rem = cur % 10;
+            if ( limbs[ i ] != 0 )
+                zero = false;
+        }
+        digits[ --n ] = ( char )( '0' + rem );
+    }
+    if ( negative )
+        digits[ --n ] = '-';
+    return KOutMsg( "%s", &digits[ n ] );
+}
+
+
+/* an array of { from, to, count } for the non-empty buckets, negative ones first */
+static rc_t vdp_json_hist( const uint64_t * neg, const uint64_t * pos )
+{
+    rc_t rc = KOutMsg( "[" );
+    bool first = true;
+    uint32_t b;
+    for ( b = VDP_BUCKETS - 1; rc == 0 && neg != NULL && b > 0; --b )
+    {
+        if ( neg[ b ] > 0 )
+        {
+            int64_t from = ( b == 64 ) ? INT64_MIN : -( ( ( int64_t )1 << b ) - 1 );
+            int64_t to = ( b == 64 ) ? INT64_MIN : -( ( int64_t )1 << ( b - 1 ) );
+            rc = KOutMsg( "%s{\"from\":%ld,\"to\":%ld,\"count\":%lu}",
+                          first ? "" : ",", from, to, neg[ b ] );
+            first = false;
+        }
+    }
+    for ( b = 0; rc == 0 && b < VDP_BUCKETS; ++b )
+    {
+        if ( pos[ b ] > 0 )
+        {
+            uint64_t from = ( b == 0 ) ? 0 : ( ( uint64_t )1 << ( b - 1 ) );
+            uint64_t to = ( b == 0 ) ? 0 : ( b == 64 ) ? UINT64_MAX : ( ( ( uint64_t )1 << b ) - 1 );
+            rc = KOutMsg( "%s{\"from\":%lu,\"to\":%lu,\"count\":%lu}",
+                          first ? "" : ",", from, to, pos[ b ] );
+            first = false;
+        }
+    }
+    if ( rc == 0 )
+        rc = KOutMsg( "]" );
+    return rc;
+}
+
+
+static rc_t vdp_json_values( const vdp_col * c )
+{
+    rc_t rc = KOutMsg( ",\n      \"values\": { \"count\": %lu", c->values );
+    if ( rc == 0 )
+    {
+        if ( c->kind == vdp_unsigned && c->values > 0 )
+            rc = KOutMsg( ", \"min\": %lu, \"max\": %lu", c->u_min, c->u_max );
+        else if ( c->kind == vdp_signed && c->values > 0 )
+            rc = KOutMsg( ", \"min\": %ld, \"max\": %ld", c->i_min, c->i_max );
+        else if ( c->kind == vdp_float )
+        {
+            rc = KOutMsg( ", \"nan\": %lu, \"min\": ", c->nan );
+            if ( rc == 0 ) rc = vdp_json_double( c->f_min );
+            if ( rc == 0 ) rc = KOutMsg( ", \"max\": " );
+            if ( rc == 0 ) rc = vdp_json_double( c->f_max );
+        }
+        else
+            rc = KOutMsg( ", \"min\": null, \"max\": null" );
+    }
+    if ( rc == 0 ) rc = KOutMsg( ", \"sum\": " );
+    if ( rc == 0 ) rc = vdp_json_sum( c );
+    if ( rc == 0 ) rc = KOutMsg( ", \"mean\": " );
+    if ( rc == 0 )
+    {
+        uint64_t counted = c->values - c->nan;
+        rc = counted > 0 ? vdp_json_double( vdp_sum_value( c ) / counted ) : KOutMsg( "null" );
+    }
+    if ( rc == 0 && c->kind != vdp_float )
+    {
+        rc = KOutMsg( ",\n                  \"histogram\": " );
+        if ( rc == 0 )
+            rc = vdp_json_hist( c->kind == vdp_signed ? c->neg_hist : NULL, c->pos_hist );
+    }
+    if ( rc == 0 )
+        rc = KOutMsg( " }" );
+    return rc;
+}
+
+
+static rc_t vdp_json_top( const vdp_col * c )
+{
+    vdp_top_entry * sorted = malloc( VDP_TOP_CAPACITY * sizeof *sorted );
+    rc_t rc = 0;
+    if ( sorted == NULL )
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        uint32_t i, n = c->top->count;
+        bool utf8 = ( c->def->type_desc.domain == vtdUnicode );
+        memmove( sorted, c->top->entries, n * sizeof *sorted );
+        qsort( sorted, n, sizeof *sorted, vdp_top_cmp_desc );
+        rc = KOutMsg( ",\n      \"top\": [" );
+        for ( i = 0; rc == 0 && i < n && i < VDP_TOP_K; ++i )
+        {
+            rc = KOutMsg( "%s\n        { \"value\": ", i > 0 ? "," : "" );
+            if ( rc == 0 )
+                rc = vdp_json_str( sorted[ i ].value, sorted[ i ].len, utf8 );
+            if ( rc == 0 )
+                rc = KOutMsg( ", \"count\": %lu, \"error\": %lu }", sorted[ i ].count, sorted[ i ].error );
+        }
+        if ( rc == 0 )
+            rc = KOutMsg( " ]" );
+        free( sorted );
+    }
+    return rc;
+}
+
+
+static rc_t vdp_json_blobs( const vdp_col * c )
+{
+    const vdp_blobs * b = &( c->blobs );
+    rc_t rc;
+    if ( !b->physical )
+        return KOutMsg( ",\n      \"blobs\": null" );
+    rc = KOutMsg( ",\n      \"blobs\": { \"count\": %lu, \"bytes\": %lu", b->count, b->bytes );
+    if ( rc == 0 )
+    {
+        if ( b->count > 0 )
+            rc = KOutMsg( ", \"min\": %lu, \"max\": %lu, \"mean\": %lu",
+                          b->min, b->max, b->bytes / b->count );
+        else
+            rc = KOutMsg( ", \"min\": null, \"max\": null, \"mean\": null" );
+    }
+    if ( rc == 0 )
+        rc = KOutMsg( ",\n                 \"histogram\": " );
+    if ( rc == 0 )
+        rc = vdp_json_hist( NULL, b->hist );
+    if ( rc == 0 )
+        rc = KOutMsg( " }" );
+    return rc;
+}
+
+
+static const char * vdp_kind_txt( uint32_t kind )
+{
+    switch ( kind )
+    {
+        case vdp_unsigned : return "unsigned";
+        case vdp_signed   : return "signed";
+        case vdp_float    : return "float";
+        case vdp_text     : return "text";
+    }
+    return "other";
+}
+
+
+static rc_t vdp_json_col( const vdp_col * c, const VSchema * schema )
+{
+    char type[ 64 ];
+    rc_t rc;
+
+    if ( schema == NULL || VTypedeclToText( &( c->def->type_decl ), schema, type, sizeof type ) != 0 )
+        type[ 0 ] = 0;
+
+    rc = KOutMsg( "    {\n      \"name\": " );
+    if ( rc == 0 )
+        rc = vdp_json_str( c->def->name, strlen( c->def->name ), false );
+    if ( rc == 0 )
+        rc = KOutMsg( ", \"type\": " );
+    if ( rc == 0 )
+        rc = vdp_json_str( type, strlen( type ), false );
+    if ( rc == 0 )
+        rc = KOutMsg( ", \"kind\": \"%s\", \"bits\": %u, \"dim\": %u,\n"
+                      "      \"rows\": %lu, \"empty_rows\": %lu, \"elements\": %lu",
+                      vdp_kind_txt( c->kind ), c->bits, c->dim, c->rows, c->empty_rows, c->elements );
+    if ( rc == 0 )
+    {
+        if ( c->rows > 0 )
+            rc = KOutMsg( ",\n      \"elements_per_row\": { \"min\": %lu, \"max\": %lu, \"mean\": ",
+                          c->len_min, c->len_max );
+        else
+            rc = KOutMsg( ",\n      \"elements_per_row\": { \"min\": null, \"max\": null, \"mean\": " );
+    }
+    if ( rc == 0 )
+        rc = c->rows > 0 ? vdp_json_double( ( double )c->elements / c->rows ) : KOutMsg( "null" );
+    if ( rc == 0 )
+        rc = KOutMsg( ",\n                          \"histogram\": " );
+    if ( rc == 0 )
+        rc = vdp_json_hist( NULL, c->len_hist );
+    if ( rc == 0 )
+    {
+        rc = KOutMsg( " },\n      \"distinct\": " );
+        if ( rc == 0 )
+        {
+            if ( c->distinct_valid )
+                rc = KOutMsg( "{ \"estimate\": %lu, \"of\": \"%s\" }", vdp_hll_estimate( c->hll ),
+                              ( c->kind == vdp_text || c->kind == vdp_other ) ? "cells" : "elements" );
+            else
+                rc = KOutMsg( "null" );
+        }
+    }
+    if ( rc == 0 && ( c->kind == vdp_unsigned || c->kind == vdp_signed || c->kind == vdp_float ) )
+        rc = vdp_json_values( c );
+    if ( rc == 0 && c->kind == vdp_text )
+        rc = vdp_json_top( c );
+    if ( rc == 0 )
+        rc = vdp_json_blobs( c );
+    if ( rc == 0 )
+        rc = KOutMsg( "\n    }" );
+    return rc;
+}
+
+
+static rc_t vdp_json_report( const p_dump_context ctx, const VTable * my_table,
+                             const vdp_worker * w, uint32_t threads )
+{
+    const VSchema * schema = NULL;
+    uint32_t i;
+    rc_t rc;
+
+    /* without a schema the type-names are left empty */
+    if ( VTableOpenSchema( my_table, &schema ) != 0 )
+        schema = NULL;
+
+    rc = KOutMsg( "{\n  \"path\": " );
+    if ( rc == 0 )
+        rc = vdp_json_str( ctx->path, strlen( ctx->path ), true );
+    if ( rc == 0 && ctx->table != NULL )
+    {
+        rc = KOutMsg( ",\n  \"table\": " );
+        if ( rc == 0 )
+            rc = vdp_json_str( ctx->table, strlen( ctx->table ), true );
+    }
+    if ( rc == 0 )
+    {
+        if ( w->rows > 0 )
+            rc = KOutMsg( ",\n  \"rows\": %lu, \"first_row\": %ld, \"last_row\": %ld, \"threads\": %u,\n"
+                          "  \"columns\": [\n", w->rows, w->first_row, w->last_row, threads );
+        else
+            rc = KOutMsg( ",\n  \"rows\": 0, \"first_row\": null, \"last_row\": null, \"threads\": %u,\n"
+                          "  \"columns\": [\n", threads );
+    }
+    for ( i = 0; rc == 0 && i < w->num_cols; ++i )
+    {
+        if ( i > 0 )
+            rc = KOutMsg( ",\n" );
+        if ( rc == 0 )
+            rc = vdp_json_col( &( w->cols[ i ] ), schema );
+    }
+    if ( rc == 0 )
+        rc = KOutMsg( "\n  ]\n}\n" );
+
+    if ( schema != NULL )
+        VSchemaRelease( schema );
+    return rc;
+}
+
+/* ----------------------------------------------------------------------------------- */
+
+rc_t vdp_profile_table( const p_dump_context ctx, const VTable * my_table, const col_defs * cols )
+{
+    vdp_profile p;
+    vdp_worker * workers;
+    KThread ** threads = NULL;
+    uint32_t i, started = 0;
+    uint32_t num_threads = ctx->threads > 0 ? ctx->threads : 1;
+    rc_t rc = 0;
+
+    memset( &p, 0, sizeof p );
+    p.ctx = ctx;
+    p.table = my_table;
+
+    workers = calloc( num_threads, sizeof *workers );
+    if ( num_threads > 1 )
+        threads = calloc( num_threads, sizeof *threads );
+    if ( workers == NULL || ( num_threads > 1 && threads == NULL ) )
+    {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        DISP_RC( rc, "calloc() failed" );
+    }
+    for ( i = 0; rc == 0 && i < num_threads; ++i )
+    {
+        rc = vdp_worker_init( &workers[ i ], &p, cols );
+        DISP_RC( rc, "vdp_worker_init() failed" );
+    }
+    if ( rc == 0 )
+    {
+        rc = num_gen_iterator_make( ctx->rows, &p.iter );
+        DISP_RC( rc, "num_gen_iterator_make() failed" );
+    }
+    if ( rc == 0 )
+    {
+        rc = KLockMake( &p.lock );
+        DISP_RC( rc, "KLockMake() failed" );
+    }
+
+    if ( rc == 0 )
+    {
+        if ( num_threads == 1 )
+            rc = vdp_worker_scan( &workers[ 0 ] );
+        else
+        {
+            for ( started = 0; rc == 0 && started < num_threads; ++started )
+            {
+                rc = KThreadMake( &threads[ started ], vdp_worker_thread, &workers[ started ] );
+                DISP_RC( rc, "KThreadMake() failed" );
+            }
+            if ( rc != 0 )
+            {
+                started--;
+                vdp_stop( &p );
+            }
+            for ( i = 0; i < started; ++i )
+            {
+                rc_t status = 0;
+                KThreadWait( threads[ i ], &status );
+                KThreadRelease( threads[ i ] );
+                if ( rc == 0 )
+                    rc = workers[ i ].rc;
+            }
+        }
+    }
+
+    /* merge the statistics of all threads into the first one */
+    for ( i = 1; rc == 0 && i < num_threads; ++i )
+    {
+        vdp_worker * dst = &workers[ 0 ];
+        const vdp_worker * src = &workers[ i ];
+        uint32_t j;
+        for ( j = 0; rc == 0 && j < dst->num_cols; ++j )
+            rc = vdp_col_merge( &( dst->cols[ j ] ), &( src->cols[ j ] ) );
+        dst->rows += src->rows;
+        if ( src->first_row < dst->first_row ) dst->first_row = src->first_row;
+        if ( src->last_row > dst->last_row ) dst->last_row = src->last_row;
+    }
+
+    if ( rc == 0 && workers[ 0 ].rows > 0 )
+    {
+        const KTable * ktbl;
+        if ( VTableOpenKTableRead( my_table, &ktbl ) == 0 )
+        {
+            vdp_worker * w = &workers[ 0 ];
+            for ( i = 0; rc == 0 && i < w->num_cols; ++i )
+                rc = vdp_walk_blobs( ktbl, &( w->cols[ i ] ), w->first_row, w->last_row );
+            KTableRelease( ktbl );
+        }
+    }
+
+    if ( rc == 0 )
+        rc = vdp_json_report( ctx, my_table, &workers[ 0 ], num_threads );
+
+    KLockRelease( p.lock );
+    if ( p.iter != NULL )
+        num_gen_iterator_destroy( p.iter );
+    if ( workers != NULL )
+    {
+        for ( i = 0; i < num_threads; ++i )
+            vdp_worker_free( &workers[ i ] );
+        free( workers );
+    }
+    free( threads );
+    return rc;
+}
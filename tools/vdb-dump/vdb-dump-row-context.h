@@ -33,6 +33,7 @@
 #include "vdb-dump-context.h"
 #include "vdb-dump-coldefs.h"
 #include "vdb-dump-str.h"
+#include "vdb-dump-filter.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,6 +48,9 @@ extern "C" {
         - a Vector containing p_col_data - pointers
         - a return-type to stop if reading data failed ( neccessary to stop after
           last row if no row-range is given at command-line )
+        - an optional dump-string collecting the output of worker-threads,
+          if NULL the output goes directly to KOutMsg
+        - an optional compiled --where expression, rows not matching it are skipped
 
     needed as a (one and only) parameter to VectorForEach
 *************************************************************************************/
@@ -60,6 +64,8 @@ typedef struct row_context
     int64_t row_id;
     uint32_t col_nr;
     rc_t rc;
+    p_dump_str out;
+    struct vdfi_expr * where;
 } row_context;
 typedef row_context* p_row_context;
 
@@ -237,6 +237,36 @@ rc_t vds_append_str_no_limit_check( p_dump_str s, const char *s1 )
 }
 
 
+rc_t vds_append_vfmt_no_limit_check( p_dump_str s, const char *fmt, va_list args )
+{
+    rc_t rc = 0;
+    if ( ( s == NULL )||( fmt == NULL ) )
+    {
+        return RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+    }
+    while ( rc == 0 )
+    {
+        size_t num_writ = 0;
+        va_list argp;
+
+        va_copy( argp, args );
+        rc = string_vprintf( s->buf + s->str_len, s->buf_size - s->str_len, &num_writ, fmt, argp );
+        va_end( argp );
+        if ( rc == 0 )
+        {
+            s->str_len += num_writ;
+            break;
+        }
+        else if ( GetRCState( rc ) == rcInsufficient )
+        {
+            /* grow the buffer and print again */
+            rc = vds_inc_buffer( s, ( num_writ > s->buf_size ) ? num_writ : s->buf_size );
+        }
+    }
+    return rc;
+}
+
+
 rc_t vds_rinsert( p_dump_str s, const char *s1 )
 {
     size_t len;
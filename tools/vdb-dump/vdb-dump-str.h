@@ -38,6 +38,8 @@ extern "C" {
 #include <klib/rc.h>
 #include <klib/namelist.h>
 
+#include <stdarg.h>
+
 typedef struct dump_str
 {
     char *buf;
@@ -76,6 +78,9 @@ rc_t vds_append_str( p_dump_str s, const char *s1 );
 /* appends the string, does not truncate */
 rc_t vds_append_str_no_limit_check( p_dump_str s, const char *s1 );
 
+/* appends the formated string with parameters, does not truncate */
+rc_t vds_append_vfmt_no_limit_check( p_dump_str s, const char *fmt, va_list args );
+
 /* right-inserts the string at the end of the ev. limited string */
 rc_t vds_rinsert( p_dump_str s, const char *s1 );
 
@@ -58,10 +58,15 @@
 #include <klib/time.h>
 #include <klib/num-gen.h>
 
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+
 #include <os-native.h>
 #include <sysalloc.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <bitstr.h>
 
 #include "vdb-dump-context.h"
@@ -73,6 +78,8 @@
 #include "vdb-dump-fastq.h"
 #include "vdb-dump-redir.h"
 #include "vdb-dump-bin.h"
+#include "vdb-dump-profile.h"
+#include "vdb-dump-arrow.h"
 #include "vdb-dump-interact.h"
 #include "vdb_info.h"
 
@@ -121,7 +128,11 @@ static const char * merge_ranges_usage[]        = { "merge and sort row-ranges",
 static const char * spread_usage[]              = { "show spread of integer values",                NULL };
 static const char * len_spread_usage[]          = { "show spread of READ/REF_LEN values",           NULL };
 static const char * slice_usage[]               = { "find a slice of given depth",                  NULL };
+static const char * profile_usage[]             = { "statistics of all columns in one pass, as JSON", NULL };
 static const char * interactive_usage[]         = { "interactive mode",                             NULL };
+static const char * threads_usage[]             = { "number of threads formating rows ( or profiling )", NULL };
+static const char * where_usage[]               = { "dump only rows matching a typed expression,",
+                                                    "e.g. \"READ_LEN > 1000 and SPOT_GROUP = 'X'\"", NULL };
 
 OptDef DumpOptions[] =
 {
@@ -170,9 +181,12 @@ OptDef DumpOptions[] =
     { OPTION_SPOTGROUPS,            NULL,                     NULL, spotgroup_usage,         1, false,  false },
     { OPTION_MERGE_RANGES,          NULL,                     NULL, merge_ranges_usage,      1, false,  false },
     { OPTION_SPREAD,                NULL,                     NULL, spread_usage,            1, false,  false },
+    { OPTION_PROFILE,               NULL,                     NULL, profile_usage,           1, false,  false },
     { OPTION_LEN_SPREAD,            NULL,                     NULL, len_spread_usage,        1, false,  false },    
     { OPTION_INTERACTIVE,           NULL,                     NULL, interactive_usage,       1, false,  false },    
-    { OPTION_SLICE,                 NULL,                     NULL, slice_usage,             1, true,   false }
+    { OPTION_SLICE,                 NULL,                     NULL, slice_usage,             1, true,   false },
+    { OPTION_THREADS,               NULL,                     NULL, threads_usage,           1, true,   false },
+    { OPTION_WHERE,                 NULL,                     NULL, where_usage,             1, true,   false }
 };
 
 const char UsageDefaultName[] = "vdb-dump";
@@ -233,7 +247,9 @@ rc_t CC Usage ( const Args * args )
     KOutMsg( "      fasta1 .. one FASTA-record for the whole accession (REFSEQ)\n" );
     KOutMsg( "      fasta2 .. one FASTA-record for each REFERENCE in cSRA\n" );
     KOutMsg( "      qual .... QUAL( 2 lines ) for each row\n" );    
-    KOutMsg( "      qual1 ... QUAL( 2 lines ) for each fragment if possible\n\n" );
+    KOutMsg( "      qual1 ... QUAL( 2 lines ) for each fragment if possible\n" );
+    KOutMsg( "      arrow ... Apache Arrow IPC stream ( binary )\n" );
+    KOutMsg( "      arrow-file  Apache Arrow IPC file ( binary )\n\n" );
     
     HelpOptionLine ( ALIAS_ID_RANGE,            OPTION_ID_RANGE,        NULL,           id_range_usage );
     HelpOptionLine ( ALIAS_WITHOUT_SRA,         OPTION_WITHOUT_SRA,     NULL,           without_sra_usage );
@@ -260,6 +276,9 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( NULL,                      OPTION_SPOTGROUPS,      NULL,           spotgroup_usage );
     HelpOptionLine ( NULL,                      OPTION_MERGE_RANGES,    NULL,           merge_ranges_usage );
     HelpOptionLine ( NULL,                      OPTION_SPREAD,          NULL,           spread_usage );
+    HelpOptionLine ( NULL,                      OPTION_PROFILE,         NULL,           profile_usage );
+    HelpOptionLine ( NULL,                      OPTION_THREADS,         "threads",      threads_usage );
+    HelpOptionLine ( NULL,                      OPTION_WHERE,           "expression",   where_usage );
     
     HelpOptionsStandard ();
 
@@ -420,17 +439,78 @@ static void vdm_row_error( const char * fmt, rc_t rc, uint64_t row_id )
 
 }
 
+/*************************************************************************************
+    dump_row:
+    * dumps the row r_ctx->row_id
+        - skip the row if it does not match the --where expression
+        - set the row-id into the cursor and open the cursor-row
+        - loop throuh the columns
+        - close the row
+        - call print_row (vdb-dump-formats.c) which actually prints the row
+
+r_ctx   [IN] ... row-context ( cursor, dump_context, col_defs ... )
+*************************************************************************************/
+static rc_t vdm_dump_row( p_row_context r_ctx )
+{
+    if ( r_ctx->where != NULL )
+    {
+        /* only the columns of the expression are read for rows that do not match */
+        bool match;
+        r_ctx->rc = vdfi_expr_match( r_ctx->where, r_ctx->cursor, r_ctx->row_id, &match );
+        if ( r_ctx->rc != 0 || !match )
+            return r_ctx->rc;
+    }
+
+    r_ctx->rc = VCursorSetRowId( r_ctx->cursor, r_ctx->row_id );
+    if ( r_ctx->rc != 0 )
+    {
+        vdm_row_error( "VCursorSetRowId( row#$(row_nr) ) failed", 
+                       r_ctx->rc, r_ctx->row_id );
+    }
+    else
+    {
+        r_ctx->rc = VCursorOpenRow( r_ctx->cursor );
+        if ( r_ctx->rc != 0 )
+        {
+            vdm_row_error( "VCursorOpenRow( row#$(row_nr) ) failed", 
+                           r_ctx->rc, r_ctx->row_id );
+        }
+        else
+        {
+            /* first reset the string and valid-flag for every column */
+            vdcd_reset_content( r_ctx->col_defs );
+
+            /* read the data of every column and create a string for it */
+            VectorForEach( &(r_ctx->col_defs->cols),
+                           false, vdm_read_cell_data, r_ctx );
+
+            if ( r_ctx->rc == 0 )
+            {
+                /* prints the collected strings, in vdb-dump-formats.c */
+                if ( !r_ctx->ctx->sum_num_elem )
+                {
+                    r_ctx->rc = vdfo_print_row( r_ctx );
+                    if ( r_ctx->rc != 0 )
+                        vdm_row_error( "vdfo_print_row( row#$(row_nr) ) failed", 
+                               r_ctx->rc, r_ctx->row_id );
+                }
+            }
+            r_ctx->rc = VCursorCloseRow( r_ctx->cursor );
+            if ( r_ctx->rc != 0 )
+                vdm_row_error( "VCursorCloseRow( row#$(row_nr) ) failed", 
+                               r_ctx->rc, r_ctx->row_id );
+        }
+    }
+    return r_ctx->rc;
+}
+
 /*************************************************************************************
     dump_rows:
     * is the main loop to dump all rows or all selected rows ( -R1-10 )
     * creates a dump-string ( parameterizes it with the wanted max. line-len )
     * starts the number-generator
     * as long as the number-generator has a number and the result-code is ok
-      do for every row-id:
-        - set the row-id into the cursor and open the cursor-row
-        - loop throuh the columns
-        - close the row
-        - call print_row (vdb-dump-formats.c) which actually prints the row
+      call "dump_row()" for every row-id
     * the collection of the text's for the columns "read_cell_data_and_dump()"
       is separated from the actual printing "print_row()" !
 
@@ -457,46 +537,7 @@ static rc_t vdm_dump_rows( p_row_context r_ctx )
                     r_ctx-> rc = Quitting();
                 if ( r_ctx->rc != 0 )
                     break;
-                r_ctx->rc = VCursorSetRowId( r_ctx->cursor, r_ctx->row_id );
-                if ( r_ctx->rc != 0 )
-                {
-                    vdm_row_error( "VCursorSetRowId( row#$(row_nr) ) failed", 
-                                   r_ctx->rc, r_ctx->row_id );
-                }
-                else
-                {
-                    r_ctx->rc = VCursorOpenRow( r_ctx->cursor );
-                    if ( r_ctx->rc != 0 )
-                    {
-                        vdm_row_error( "VCursorOpenRow( row#$(row_nr) ) failed", 
-                                       r_ctx->rc, r_ctx->row_id );
-                    }
-                    else
-                    {
-                        /* first reset the string and valid-flag for every column */
-                        vdcd_reset_content( r_ctx->col_defs );
-
-                        /* read the data of every column and create a string for it */
-                        VectorForEach( &(r_ctx->col_defs->cols),
-                                       false, vdm_read_cell_data, r_ctx );
-
-                        if ( r_ctx->rc == 0 )
-                        {
-                            /* prints the collected strings, in vdb-dump-formats.c */
-                            if ( !r_ctx->ctx->sum_num_elem )
-                            {
-                                r_ctx->rc = vdfo_print_row( r_ctx );
-                                if ( r_ctx->rc != 0 )
-                                    vdm_row_error( "vdfo_print_row( row#$(row_nr) ) failed", 
-                                           r_ctx->rc, r_ctx->row_id );
-                            }
-                        }
-                        r_ctx->rc = VCursorCloseRow( r_ctx->cursor );
-                        if ( r_ctx->rc != 0 )
-                            vdm_row_error( "VCursorCloseRow( row#$(row_nr) ) failed", 
-                                           r_ctx->rc, r_ctx->row_id );
-                    }
-                }
+                vdm_dump_row( r_ctx );
             }
         }
         num_gen_iterator_destroy( iter );
@@ -517,6 +558,272 @@ static rc_t vdm_dump_rows( p_row_context r_ctx )
 }
 
 
+/*************************************************************************************
+    multi-threaded dump_rows:
+    * the main thread cuts the row-ids of the number-generator into chunks
+      and puts them into a ring of 2 * threads slots
+    * every worker-thread has its own cursor and column-definitions,
+      takes the next ready chunk and formats its rows into the chunk's
+      output-string ( instead of KOutMsg )
+    * the main thread writes the finished chunks in the order of the row-ids,
+      so the output is identical to the single-threaded "dump_rows()"
+*************************************************************************************/
+#define VDM_MT_CHUNK_ROWS 1024
+
+enum vdm_chunk_state { vdm_chunk_empty, vdm_chunk_ready, vdm_chunk_busy, vdm_chunk_done };
+
+typedef struct vdm_chunk
+{
+    int64_t row_id[ VDM_MT_CHUNK_ROWS ];
+    uint32_t count;
+    uint32_t state;
+    dump_str out;
+    rc_t rc;
+} vdm_chunk;
+
+typedef struct vdm_mt_dump
+{
+    p_dump_context ctx;
+    const VTable * table;
+    KLock * lock;
+    KCondition * cond;
+    vdm_chunk * chunks;
+    uint32_t num_chunks;
+    uint64_t filled;    /* chunks handed to the workers */
+    uint64_t taken;     /* chunks taken by the workers */
+    uint64_t written;   /* chunks written by the main thread */
+    bool stop;
+} vdm_mt_dump;
+
+static rc_t vdm_open_row_cursor( const p_dump_context ctx, const VTable *my_table,
+                                 p_row_context r_ctx );
+static void vdm_close_row_cursor( p_row_context r_ctx );
+
+static rc_t CC vdm_dump_rows_thread( const KThread *self, void *data )
+{
+    vdm_mt_dump * mt = data;
+    row_context r_ctx;
+    rc_t rc = vdm_open_row_cursor( mt->ctx, mt->table, &r_ctx );
+    if ( rc == 0 )
+    {
+        r_ctx.ctx = mt->ctx;
+        rc = vds_make( &(r_ctx.s_col), mt->ctx->max_line_len, 512 );
+        DISP_RC( rc, "dump_str_make() failed" );
+        if ( rc != 0 )
+        {
+            vdm_close_row_cursor( &r_ctx );
+            r_ctx.cursor = NULL;
+        }
+    }
+
+    while ( KLockAcquire( mt->lock ) == 0 )
+    {
+        vdm_chunk * chunk = NULL;
+        while ( !mt->stop && mt->taken >= mt->filled )
+        {
+            if ( KConditionWait( mt->cond, mt->lock ) != 0 )
+                break;
+        }
+        if ( !mt->stop && mt->taken < mt->filled )
+        {
+            chunk = &( mt->chunks[ mt->taken++ % mt->num_chunks ] );
+            chunk->state = vdm_chunk_busy;
+        }
+        KLockUnlock( mt->lock );
+        if ( chunk == NULL )
+            break;
+
+        /* a worker that could not set up its cursor fails every chunk it takes,
+           the main thread reports the error of the first one */
+        chunk->rc = rc;
+        if ( rc == 0 )
+        {
+            uint32_t i;
+            r_ctx.out = &( chunk->out );
+            for ( i = 0; i < chunk->count && chunk->rc == 0; ++i )
+            {
+                r_ctx.row_id = chunk->row_id[ i ];
+                chunk->rc = vdm_dump_row( &r_ctx );
+            }
+        }
+
+        if ( KLockAcquire( mt->lock ) == 0 )
+        {
+            chunk->state = vdm_chunk_done;
+            KConditionBroadcast( mt->cond );
+            KLockUnlock( mt->lock );
+        }
+    }
+
+    if ( rc == 0 )
+    {
+        vds_free( &(r_ctx.s_col) );
+        vdm_close_row_cursor( &r_ctx );
+    }
+    return rc;
+}
+
+static rc_t vdm_write_chunk( vdm_chunk * chunk )
+{
+    rc_t rc = 0;
+    const char * buf = vds_ptr( &( chunk->out ) );
+    size_t len = chunk->out.str_len;
+    KWrtWriter writer = KOutWriterGet();
+    void * writer_data = KOutDataGet();
+
+    while ( rc == 0 && len > 0 )
+    {
+        size_t num_writ = 0;
+        rc = writer( writer_data, buf, len, &num_writ );
+        DISP_RC( rc, "writing output failed" );
+        if ( rc == 0 && num_writ == 0 )
+            rc = RC( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+        buf += num_writ;
+        len -= num_writ;
+    }
+    vds_clear( &( chunk->out ) );
+    return rc;
+}
+
+/* fills the next free slot of the ring with row-ids, returns false if there are no more */
+static bool vdm_fill_chunk( vdm_chunk * chunk, const struct num_gen_iter * iter, rc_t * rc )
+{
+    chunk->count = 0;
+    chunk->rc = 0;
+    while ( chunk->count < VDM_MT_CHUNK_ROWS &&
+            num_gen_iterator_next( iter, &( chunk->row_id[ chunk->count ] ), rc ) )
+    {
+        if ( *rc != 0 )
+            break;
+        chunk->count++;
+    }
+    return ( *rc == 0 && chunk->count == VDM_MT_CHUNK_ROWS );
+}
+
+static rc_t vdm_dump_rows_mt( const p_dump_context ctx, const VTable *my_table )
+{
+    vdm_mt_dump mt;
+    const struct num_gen_iter * iter;
+    KThread ** threads;
+    uint32_t i, started = 0;
+    rc_t rc;
+
+    memset( &mt, 0, sizeof mt );
+    mt.ctx = ctx;
+    mt.table = my_table;
+    mt.num_chunks = ctx->threads * 2;
+
+    rc = num_gen_iterator_make( ctx->rows, &iter );
+    DISP_RC( rc, "num_gen_iterator_make() failed" );
+    if ( rc != 0 )
+        return rc;
+
+    threads = calloc( ctx->threads, sizeof *threads );
+    mt.chunks = calloc( mt.num_chunks, sizeof *( mt.chunks ) );
+    if ( threads == NULL || mt.chunks == NULL )
+    {
+        rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        DISP_RC( rc, "calloc() failed" );
+    }
+    for ( i = 0; rc == 0 && i < mt.num_chunks; ++i )
+    {
+        rc = vds_make( &( mt.chunks[ i ].out ), 0, 64 * 1024 );
+        DISP_RC( rc, "dump_str_make() failed" );
+    }
+    if ( rc == 0 )
+    {
+        rc = KLockMake( &mt.lock );
+        DISP_RC( rc, "KLockMake() failed" );
+    }
+    if ( rc == 0 )
+    {
+        rc = KConditionMake( &mt.cond );
+        DISP_RC( rc, "KConditionMake() failed" );
+    }
+    for ( started = 0; rc == 0 && started < ctx->threads; ++started )
+    {
+        rc = KThreadMake( &threads[ started ], vdm_dump_rows_thread, &mt );
+        DISP_RC( rc, "KThreadMake() failed" );
+    }
+    if ( rc != 0 && started > 0 )
+        started--;
+
+    if ( rc == 0 )
+    {
+        bool more = true;
+        while ( rc == 0 )
+        {
+            if ( more && mt.filled < mt.written + mt.num_chunks )
+            {
+                /* the slot is empty, nobody else touches it until it is marked ready */
+                vdm_chunk * chunk = &( mt.chunks[ mt.filled % mt.num_chunks ] );
+                rc = Quitting();
+                if ( rc == 0 )
+                    more = vdm_fill_chunk( chunk, iter, &rc );
+                if ( rc == 0 && chunk->count > 0 )
+                {
+                    rc = KLockAcquire( mt.lock );
+                    if ( rc == 0 )
+                    {
+                        chunk->state = vdm_chunk_ready;
+                        mt.filled++;
+                        KConditionBroadcast( mt.cond );
+                        KLockUnlock( mt.lock );
+                    }
+                }
+            }
+            else if ( mt.written < mt.filled )
+            {
+                vdm_chunk * chunk = &( mt.chunks[ mt.written % mt.num_chunks ] );
+                rc = KLockAcquire( mt.lock );
+                if ( rc == 0 )
+                {
+                    while ( rc == 0 && chunk->state != vdm_chunk_done )
+                        rc = KConditionWait( mt.cond, mt.lock );
+                    KLockUnlock( mt.lock );
+                }
+                if ( rc == 0 )
+                {
+                    /* the rows before a failing one are written, like "dump_rows()" does */
+                    rc = vdm_write_chunk( chunk );
+                    if ( rc == 0 )
+                        rc = chunk->rc;
+                    chunk->state = vdm_chunk_empty;
+                    mt.written++;
+                }
+            }
+            else
+                break;
+        }
+    }
+
+    if ( mt.lock != NULL && KLockAcquire( mt.lock ) == 0 )
+    {
+        mt.stop = true;
+        if ( mt.cond != NULL )
+            KConditionBroadcast( mt.cond );
+        KLockUnlock( mt.lock );
+    }
+    for ( i = 0; i < started; ++i )
+    {
+        rc_t status = 0;
+        KThreadWait( threads[ i ], &status );
+        KThreadRelease( threads[ i ] );
+    }
+    KConditionRelease( mt.cond );
+    KLockRelease( mt.lock );
+    if ( mt.chunks != NULL )
+    {
+        for ( i = 0; i < mt.num_chunks; ++i )
+            vds_free( &( mt.chunks[ i ].out ) );
+        free( mt.chunks );
+    }
+    free( threads );
+    num_gen_iterator_destroy( iter );
+    return rc;
+}
+
+
 static uint32_t vdm_extract_or_parse_columns( const p_dump_context ctx,
                                           const VTable *my_table,
                                           p_col_defs my_col_defs )
@@ -603,6 +910,90 @@ static bool vdm_extract_or_parse_static_columns( const p_dump_context ctx,
 
 }
 
+/*************************************************************************************
+    open_row_cursor:
+    * opens a cursor to read, creates the column-definitions of r_ctx
+      and adds them to the cursor
+    * on error nothing is left open in r_ctx
+
+ctx       [IN]  ... contains path, tablename, columns, row-range etc.
+my_table  [IN]  ... open table needed for vdb-calls
+r_ctx     [OUT] ... row-context with an open cursor and col_defs
+*************************************************************************************/
+static rc_t vdm_open_row_cursor( const p_dump_context ctx, const VTable *my_table,
+                                 p_row_context r_ctx )
+{
+    rc_t rc;
+
+    r_ctx->col_defs = NULL;
+    r_ctx->table = my_table;
+    r_ctx->ctx = ctx;
+    r_ctx->out = NULL;
+    r_ctx->where = NULL;
+    rc = VTableCreateCachedCursorRead( my_table, &(r_ctx->cursor), ctx->cur_cache_size );
+    DISP_RC( rc, "VTableCreateCursorRead() failed" );
+    if ( rc == 0 )
+    {
+        if ( !vdcd_init( &(r_ctx->col_defs), ctx->max_line_len ) )
+        {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            DISP_RC( rc, "col_defs_init() failed" );
+            r_ctx->col_defs = NULL;
+        }
+
+        if ( rc == 0 )
+        {
+            uint32_t n = vdm_extract_or_parse_columns( ctx, my_table, r_ctx->col_defs );
+            if ( n < 1 )
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+            else
+            {
+                n = vdcd_add_to_cursor( r_ctx->col_defs, r_ctx->cursor );
+                if ( n < 1 )
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+                else
+                {
+                    const VSchema *my_schema;
+                    rc = VTableOpenSchema( my_table, &my_schema );
+                    DISP_RC( rc, "VTableOpenSchema() failed" );
+                    if ( rc == 0 )
+                    {
+                        /* translate in special columns to numeric values to strings */
+                        vdcd_ins_trans_fkt( r_ctx->col_defs, my_schema );
+                        VSchemaRelease( my_schema );
+                    }
+
+                    /* the columns of the where-expression are added, but only read on demand */
+                    if ( ctx->where != NULL )
+                        rc = vdfi_expr_make( &(r_ctx->where), ctx->where, r_ctx->cursor );
+
+                    if ( rc == 0 )
+                    {
+                        rc = VCursorOpen( r_ctx->cursor );
+                        DISP_RC( rc, "VCursorOpen() failed" );
+                    }
+                }
+            }
+        }
+        if ( rc != 0 )
+            vdm_close_row_cursor( r_ctx );
+    }
+    return rc;
+}
+
+
+static void vdm_close_row_cursor( p_row_context r_ctx )
+{
+    if ( r_ctx->col_defs != NULL )
+        vdcd_destroy( r_ctx->col_defs );
+    r_ctx->col_defs = NULL;
+    vdfi_expr_destroy( r_ctx->where );
+    r_ctx->where = NULL;
+    VCursorRelease( r_ctx->cursor );
+    r_ctx->cursor = NULL;
+}
+
+
 /*************************************************************************************
     dump_tab_table:
     * called by "dump_db_table()" and "dump_tab()" as a fkt-pointer
@@ -613,7 +1004,8 @@ static bool vdm_extract_or_parse_static_columns( const p_dump_context ctx,
     * we end up with a list of column-definitions (name,type) in my_col_defs
     * calls "col_defs_add_to_cursor()" to add them to the cursor
     * opens the cursor
-    * calls "dump_rows()" to execute the dump
+    * calls "dump_rows()" to execute the dump, or "dump_rows_mt()" if more
+      than one thread is requested
     * destroys the my_col_defs - structure
     * releases the cursor
 
@@ -632,87 +1024,57 @@ static rc_t vdm_dump_opened_table( const p_dump_context ctx, const VTable *my_ta
     {
         row_context r_ctx;
 
-        rc = VTableCreateCachedCursorRead( my_table, &(r_ctx.cursor), ctx->cur_cache_size );
-        DISP_RC( rc, "VTableCreateCursorRead() failed" );
+        rc = vdm_open_row_cursor( ctx, my_table, &r_ctx );
         if ( rc == 0 )
         {
-            r_ctx.table = my_table;
-            if ( !vdcd_init( &(r_ctx.col_defs), ctx->max_line_len ) )
-            {
-                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
-                DISP_RC( rc, "col_defs_init() failed" );
-            }
-
+            int64_t  first;
+            uint64_t count;
+            rc = VCursorIdRange( r_ctx.cursor, 0, &first, &count );
+            DISP_RC( rc, "VCursorIdRange() failed" );
             if ( rc == 0 )
             {
-                uint32_t n = vdm_extract_or_parse_columns( ctx, my_table, r_ctx.col_defs );
-                if ( n < 1 )
-                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+                if ( ctx->rows == NULL )
+                {
+                    /* if the user did not specify a row-range, take all rows */
+                    rc = num_gen_make_from_range( &ctx->rows, first, count );
+                    DISP_RC( rc, "num_gen_make_from_range() failed" );
+                }
                 else
                 {
-                    n = vdcd_add_to_cursor( r_ctx.col_defs, r_ctx.cursor );
-                    if ( n < 1 )
-                        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
-                    else
+                    /* if the user did specify a row-range, check the boundaries */
+                    if ( count > 0 )
                     {
-                        const VSchema *my_schema;
-                        rc = VTableOpenSchema( my_table, &my_schema );
-                        DISP_RC( rc, "VTableOpenSchema() failed" );
-                        if ( rc == 0 )
-                        {
-                            /* translate in special columns to numeric values to strings */
-                            vdcd_ins_trans_fkt( r_ctx.col_defs, my_schema );
-                            VSchemaRelease( my_schema );
-                        }
-
-                        rc = VCursorOpen( r_ctx.cursor );
-                        DISP_RC( rc, "VCursorOpen() failed" );
-                        if ( rc == 0 )
-                        {
-                            int64_t  first;
-                            uint64_t count;
-                            rc = VCursorIdRange( r_ctx.cursor, 0, &first, &count );
-                            DISP_RC( rc, "VCursorIdRange() failed" );
-                            if ( rc == 0 )
-                            {
-                                if ( ctx->rows == NULL )
-                                {
-                                    /* if the user did not specify a row-range, take all rows */
-                                    rc = num_gen_make_from_range( &ctx->rows, first, count );
-                                    DISP_RC( rc, "num_gen_make_from_range() failed" );
-                                }
-                                else
-                                {
-                                    /* if the user did specify a row-range, check the boundaries */
-                                    if ( count > 0 )
-                                    {
-                                        /* trim only if the row-range is not zero, otherwise
-                                           we will not get data if the user specified only static columns
-                                           because they report a row-range of zero! */
-                                        rc = num_gen_trim( ctx->rows, first, count );
-                                        DISP_RC( rc, "num_gen_trim() failed" );
-                                    }
-                                }
+                        /* trim only if the row-range is not zero, otherwise
+                           we will not get data if the user specified only static columns
+                           because they report a row-range of zero! */
+                        rc = num_gen_trim( ctx->rows, first, count );
+                        DISP_RC( rc, "num_gen_trim() failed" );
+                    }
+                }
 
-                                if ( rc == 0 )
-                                {
-                                    if ( num_gen_empty( ctx->rows ) )
-                                    {
-                                        rc = RC( rcExe, rcDatabase, rcReading, rcRange, rcEmpty );
-                                    }
-                                    else
-                                    {
-                                        r_ctx.ctx = ctx;
-                                        rc = vdm_dump_rows( &r_ctx ); /* <--- */
-                                    }
-                                }
-                            }
-                        }
+                if ( rc == 0 )
+                {
+                    if ( num_gen_empty( ctx->rows ) )
+                    {
+                        rc = RC( rcExe, rcDatabase, rcReading, rcRange, rcEmpty );
+                    }
+                    else if ( ctx->format == df_arrow || ctx->format == df_arrow_file )
+                    {
+                        rc = vda_dump_rows( &r_ctx ); /* <--- */
+                    }
+                    else if ( ctx->threads > 1 && !ctx->sum_num_elem )
+                    {
+                        /* the workers open their own cursors */
+                        vdm_close_row_cursor( &r_ctx );
+                        rc = vdm_dump_rows_mt( ctx, my_table ); /* <--- */
+                    }
+                    else
+                    {
+                        rc = vdm_dump_rows( &r_ctx ); /* <--- */
                     }
                 }
-                vdcd_destroy( r_ctx.col_defs );
             }
-            VCursorRelease( r_ctx.cursor );
+            vdm_close_row_cursor( &r_ctx );
         }
     }
     return rc;
@@ -743,8 +1105,9 @@ static rc_t vdm_dump_opened_database( const p_dump_context ctx,
 
 /* ********************************************************************** */
 
-static rc_t vdm_show_tab_spread( const p_dump_context ctx,
-                                 const VTable *my_table )
+/* the columns for --spread and --profile, the row-set is trimmed to the range of the table */
+static rc_t vdm_show_tab_stats( const p_dump_context ctx,
+                                const VTable *my_table, bool profile )
 {
     const VCursor * cursor;
     rc_t rc = VTableCreateCachedCursorRead( my_table, &cursor, ctx->cur_cache_size );
@@ -797,6 +1160,8 @@ static rc_t vdm_show_tab_spread( const p_dump_context ctx,
                             {
                                 if ( num_gen_empty( ctx->rows ) )
                                     rc = RC( rcExe, rcDatabase, rcReading, rcRange, rcEmpty );
+                                else if ( profile )
+                                    rc = vdp_profile_table( ctx, my_table, cols ); /* is in vdb-dump-profile.c */
                                 else
                                     rc = vdcd_collect_spread( ctx->rows, cols, cursor ); /* is in vdb-dump-coldefs.c */
                             }
@@ -811,6 +1176,12 @@ static rc_t vdm_show_tab_spread( const p_dump_context ctx,
     return rc;
 }
 
+static rc_t vdm_show_tab_spread( const p_dump_context ctx,
+                                 const VTable *my_table )
+{
+    return vdm_show_tab_stats( ctx, my_table, false );
+}
+
 static rc_t vdm_show_db_spread( const p_dump_context ctx,
                                 const VDatabase *my_database )
 {
@@ -823,6 +1194,25 @@ static rc_t vdm_show_db_spread( const p_dump_context ctx,
     }
     return rc;
 }
+
+static rc_t vdm_show_tab_profile( const p_dump_context ctx,
+                                  const VTable *my_table )
+{
+    return vdm_show_tab_stats( ctx, my_table, true );
+}
+
+static rc_t vdm_show_db_profile( const p_dump_context ctx,
+                                 const VDatabase *my_database )
+{
+    const VTable *my_table;
+    rc_t rc = open_table_by_path( my_database, ctx->table, &my_table );
+    if ( rc == 0 )
+    {
+        rc = vdm_show_tab_profile( ctx, my_table );
+        VTableRelease( my_table );
+    }
+    return rc;
+}
 /* ********************************************************************** */
 
 /********************************************************************
@@ -1790,6 +2180,10 @@ static rc_t vdm_dump_table( const p_dump_context ctx, const VDBManager *my_manag
         {
             rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_show_tab_spread );
         }
+        else if ( ctx->profile )
+        {
+            rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_show_tab_profile );
+        }
         else
         {
             rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_dump_opened_table );
@@ -1933,6 +2327,10 @@ static rc_t vdm_dump_database( const p_dump_context ctx, const VDBManager *my_ma
     {
         rc = vdm_dump_db_fkt( ctx, my_manager, vdm_show_db_spread );
     }
+    else if ( ctx->profile )
+    {
+        rc = vdm_dump_db_fkt( ctx, my_manager, vdm_show_db_profile );
+    }
     else
     {
         rc = vdm_dump_db_fkt( ctx, my_manager, vdm_dump_opened_database );
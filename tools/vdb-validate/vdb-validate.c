@@ -56,6 +56,7 @@
 #include <kfs/sra.h>
 #include <kfs/tar.h>
 #include <kfs/file.h> /* KFileRelease */
+#include <kfs/directory.h> /* KDirectoryDate */
 
 #include <insdc/insdc.h>
 #include <insdc/sra.h>
@@ -73,9 +74,17 @@
 #include <klib/debug.h>
 #include <klib/data-buffer.h>
 #include <klib/sort.h>
+#include <klib/checksum.h> /* MD5State */
+
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/procmgr.h> /* KProcMgrGetPID */
 
 #include <sysalloc.h>
+#include <strtol.h> /* strtou64 */
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -91,6 +100,12 @@
 #define MAX(a,b)    (((a) > (b)) ? (a) : (b))
 #endif
 
+#if WINDOWS
+#define THREAD_LOCAL __declspec( thread )
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 #define RELEASE(type, obj) do { rc_t rc2 = type##Release(obj); \
     if (rc2 != 0 && rc == 0) { rc = rc2; } obj = NULL; } while (false)
 
@@ -107,6 +122,7 @@ static bool md5_required;
 static bool ref_int_check;
 static bool s_IndexOnly;
 static size_t memory_suggestion = (2ull * 1024ull * 1024ull * 1024ull);
+static const char *scratch_dir = NULL; /* --temp, $TMPDIR or /tmp */
 
 typedef struct node_s {
     int parent;
@@ -347,22 +363,19 @@ static rc_t CC report(CCReportInfoBlock const *what, void *Ctx)
 }
 
 static
-rc_t kdbcc ( const KDBManager *mgr, char const name[], uint32_t mode,
-    KPathType *pathType, bool is_file, node_t nodes[], char names[],
-    INSDC_SRA_platform_id platform )
+uint32_t kdbcc_level ( uint32_t mode )
 {
-    rc_t rc = 0;
-    cc_context_t ctx;
-    char const *objtype;
-
     uint32_t level = ( mode & 4 ) ? 3 : ( mode & 2 ) ? 1 : 0;
     if (s_IndexOnly)
         level |= CC_INDEX_ONLY;
+    return level;
+}
 
-
-    memset(&ctx, 0, sizeof(ctx));
-    ctx.nodes = &nodes[0];
-    ctx.names = &names[0];
+static
+rc_t kdbcc_path_type ( const KDBManager *mgr, char const name[],
+    KPathType *pathType )
+{
+    rc_t rc = 0;
 
     if (KDBManagerExists(mgr, kptDatabase, "%s", name))
         *pathType = kptDatabase;
@@ -375,48 +388,39 @@ rc_t kdbcc ( const KDBManager *mgr, char const name[], uint32_t mode,
         rc = RC(rcExe, rcPath, rcValidating, rcType, rcUnknown);
         (void)PLOGERR(klogErr, (klogErr, rc, "Object '$(table)' "
             "has unknown type", "table=%s", name));
-        return rc;
     }
 
-    if (*pathType == kptDatabase)
-    {
-        const KDatabase *db;
+    return rc;
+}
+
+/* rc is what the consistency check of the object returned */
+static
+rc_t kdbcc_done ( rc_t rc, cc_context_t const *ctx, KPathType pathType,
+    char const name[], bool is_file )
+{
+    char const *objtype;
 
+    if (pathType == kptDatabase)
+    {
         objtype = "database";
-        rc = KDBManagerOpenDBRead ( mgr, & db, "%s", name );
         if ( rc == 0 )
         {
-            rc = KDatabaseConsistencyCheck ( db, 0, level, report, & ctx );
-            if ( rc == 0 )
-            {
-                rc = ctx.rc;
-                if ( s_IndexOnly )
-                    (void)LOGMSG(klogInfo, "Indices: checked");
-            }
-
-            KDatabaseRelease ( db );
+            rc = ctx -> rc;
+            if ( s_IndexOnly )
+                (void)LOGMSG(klogInfo, "Indices: checked");
         }
     }
     else
     {
-        const KTable *tbl;
-
         objtype = "table";
-        rc = KDBManagerOpenTableRead ( mgr, & tbl, "%s", name );
         if ( rc == 0 )
-        {
-            rc = KTableConsistencyCheck ( tbl, 0, level, report, & ctx, platform );
-            if ( rc == 0 )
-                rc = ctx.rc;
-
-            if ( rc == 0 && s_IndexOnly )
-                (void)LOGMSG(klogInfo, "Index: checked");
+            rc = ctx -> rc;
 
-            KTableRelease ( tbl );
-        }
+        if ( rc == 0 && s_IndexOnly )
+            (void)LOGMSG(klogInfo, "Index: checked");
     }
 
-    if (rc == 0 && ctx.num_columns == 0 && !s_IndexOnly)
+    if (rc == 0 && ctx->num_columns == 0 && !s_IndexOnly)
     {
         if (is_file)
         {
@@ -436,2003 +440,4036 @@ rc_t kdbcc ( const KDBManager *mgr, char const name[], uint32_t mode,
 }
 
 static
-rc_t vdbcc ( const VDBManager *mgr, char const name[], uint32_t mode,
-    KPathType *pathType, bool is_file)
+rc_t kdbcc ( const KDBManager *mgr, char const name[], uint32_t mode,
+    KPathType *pathType, bool is_file, node_t nodes[], char names[],
+    INSDC_SRA_platform_id platform )
 {
-#if 0
-    if ( ( mode & 8) != 0 )
-    {
-        const VTable *tbl;
-        rc_t rc = VDBManagerOpenTableRead(mgr, &tbl, NULL, "%s", name);
-        if (rc == 0)
-            rc = VTableConsistencyCheck(tbl, 2);
+    cc_context_t ctx;
+    uint32_t level = kdbcc_level ( mode );
+
+    rc_t rc = kdbcc_path_type ( mgr, name, pathType );
+    if ( rc != 0 )
         return rc;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.nodes = &nodes[0];
+    ctx.names = &names[0];
+
+    if (*pathType == kptDatabase)
+    {
+        const KDatabase *db;
+
+        rc = KDBManagerOpenDBRead ( mgr, & db, "%s", name );
+        if ( rc == 0 )
+        {
+            rc = KDatabaseConsistencyCheck ( db, 0, level, report, & ctx );
+            rc = kdbcc_done ( rc, & ctx, * pathType, name, is_file );
+
+            KDatabaseRelease ( db );
+        }
     }
-#endif
-    return 0;
+    else
+    {
+        const KTable *tbl;
+
+        rc = KDBManagerOpenTableRead ( mgr, & tbl, "%s", name );
+        if ( rc == 0 )
+        {
+            rc = KTableConsistencyCheck ( tbl, 0, level, report, & ctx, platform );
+            rc = kdbcc_done ( rc, & ctx, * pathType, name, is_file );
+
+            KTableRelease ( tbl );
+        }
+    }
+
+    return rc;
 }
 
-typedef struct ColumnInfo_s {
-    char const *name;
-    union {
-        void     const *vp;
-        char     const *string;
-        bool     const *tf;
-        int8_t   const *i8;
-        uint8_t  const *u8;
-        int16_t  const *i16;
-        uint16_t const *u16;
-        int32_t  const *i32;
-        uint32_t const *u32;
-        int64_t  const *i64;
-        uint64_t const *u64;
-        float    const *f32;
-        double   const *f64;
-    } value;
-    uint32_t idx;
-    uint32_t elem_bits;
-    uint32_t elem_count;
-} ColumnInfo;
+/*******************************************************************************
+ * --threads
+ *
+ * The consistency check of a database is split into one job per table and
+ * sub-database, plus a job for the files of the database itself.  The jobs
+ * run on worker threads; instead of being logged, their report events are
+ * recorded and replayed through report() in the order of a serial check.
+ */
 
-static rc_t CC get_sizes_cb(const KDirectory *dir,
-    uint32_t type, const char *name, void *data)
+typedef struct cc_event_s {
+    char *objName;
+    char *text; /* done.mesg or MD5.file */
+    uint32_t objType;
+    uint32_t type;
+    unsigned depth;
+    rc_t rc;
+} cc_event_t;
+
+typedef struct cc_record_s {
+    cc_event_t *event;
+    unsigned count;
+    unsigned max;
+} cc_record_t;
+
+/* what report() returns for an event, without logging it */
+static rc_t report_result(CCReportInfoBlock const *what)
 {
-    struct {
-        unsigned count;
-        size_t size;
-    } *pb = data;
+    if (what->type == ccrpt_Visit)
+        return 0;
 
-    ++pb->count;
-    pb->size += strlen(name) + 1;
+    switch (what->objType) {
+    case kptDatabase:
+    case kptTable:
+        if (what->type == ccrpt_Done && what->info.done.rc == 0
+            && what->info.done.mesg != NULL && md5_required
+            && strcmp(what->info.done.mesg, "missing md5 file") == 0)
+        {
+            return what->objType == kptTable
+                ? RC(0, rcTable, rcValidating, rcChecksum, rcNotFound)
+                : RC(rcExe, rcTable, rcValidating, rcChecksum, rcNotFound);
+        }
+        break;
+    case kptColumn:
+        if (what->type == ccrpt_Blob)
+            return 0;
+        break;
+    case kptIndex:
+        if (what->type == ccrpt_Index)
+            return 0;
+        break;
+    default:
+        return RC(rcExe, rcTable, rcVisiting, rcParam, rcUnexpected);
+    }
 
-    return 0;
+    switch (what->type) {
+    case ccrpt_Done:
+        return report_rtn (what->info.done.rc);
+    case ccrpt_MD5:
+        return report_rtn (what->info.MD5.rc);
+    default:
+        return RC(rcExe, rcTable, rcVisiting, rcParam, rcUnexpected);
+    }
 }
 
-static rc_t get_sizes(KDirectory const *dir, unsigned *nobj, size_t *namesz)
+static char *record_string(char const *str, rc_t *rc)
 {
-    rc_t rc;
-    struct {
-        unsigned count;
-        size_t size;
-    } pb;
+    char *copy = NULL;
 
-    memset(&pb, 0, sizeof(pb));
-    rc = KDirectoryVVisit(dir, true, get_sizes_cb, &pb, NULL, NULL);
-    if (rc)
-        memset(&pb, 0, sizeof(pb));
-    *nobj = pb.count;
-    *namesz = pb.size;
-    return rc;
+    if (str != NULL && *rc == 0) {
+        copy = strdup(str);
+        if (copy == NULL)
+            *rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    }
+    return copy;
 }
 
-static rc_t EncFileReadAll(const char *name,
-    char *buffer, size_t bsize, size_t *num_read)
+static rc_t record_add(cc_record_t *self, CCReportInfoBlock const *what)
 {
     rc_t rc = 0;
+    cc_event_t *evt;
+    char const *text = NULL;
 
-    VFSManager *mgr = NULL;
-    VPath *path = NULL;
-    const KFile *f = NULL;
+    if (self->count == self->max) {
+        unsigned const max = self->max ? self->max * 2 : 64;
+        void *const tmp = realloc(self->event, max * sizeof(self->event[0]));
 
-    rc = VFSManagerMake(&mgr);
-    if (rc != 0) {
-        LOGERR(klogErr, rc, "Failed to VFSManagerMake()");
+        if (tmp == NULL)
+            return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+        self->event = tmp;
+        self->max = max;
     }
+    evt = &self->event[self->count];
+    memset(evt, 0, sizeof(*evt));
 
-    if (rc == 0) {
-        rc = VFSManagerMakePath (mgr, &path, "%s", name);
-        if (rc != 0) {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to VPathMake($(name))", "name=%s", name));
-        }
+    evt->objType = what->objType;
+    evt->type = what->type;
+    switch (what->type) {
+    case ccrpt_Visit:
+        evt->depth = what->info.visit.depth;
+        break;
+    case ccrpt_Done:
+        evt->rc = what->info.done.rc;
+        text = what->info.done.mesg;
+        break;
+    case ccrpt_MD5:
+        evt->rc = what->info.MD5.rc;
+        text = what->info.MD5.file;
+        break;
+    default:
+        break;
+    }
+    evt->objName = record_string(what->objName, &rc);
+    evt->text = record_string(text, &rc);
+    if (rc) {
+        free(evt->objName);
+        free(evt->text);
+        return rc;
     }
+    ++self->count;
+    return 0;
+}
 
-    if (rc == 0) {
-        rc = VFSManagerOpenFileReadDecrypt(mgr, &f, path);
-        if (rc != 0) {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to VFSManagerOpenFileReadDecrypt($(name))",
-                "name=%s", name));
-        }
+static rc_t CC record(CCReportInfoBlock const *what, void *Ctx)
+{
+    cc_record_t *self = Ctx;
+    rc_t rc = Quitting();
+
+    if (rc)
+        return rc;
+
+    /* report() neither logs nor counts them */
+    if (what->type != ccrpt_Blob && what->type != ccrpt_Index) {
+        rc = record_add(self, what);
+        if (rc)
+            return rc;
     }
+    return report_result(what);
+}
 
-    if (rc == 0) {
-        rc = KFileReadAll(f, 0, buffer, bsize, num_read);
-        if (rc != 0) {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to KFileReadAll($(name))", "name=%s", name));
+static rc_t record_replay(cc_record_t const *self, cc_context_t *ctx)
+{
+    rc_t rc = 0;
+    unsigned i;
+
+    for (i = 0; i < self->count && rc == 0; ++i) {
+        cc_event_t const *evt = &self->event[i];
+        CCReportInfoBlock what;
+
+        memset(&what, 0, sizeof(what));
+        what.objName = evt->objName;
+        what.objType = evt->objType;
+        what.type = (CCReportType)evt->type;
+        switch (what.type) {
+        case ccrpt_Visit:
+            what.info.visit.depth = evt->depth;
+            break;
+        case ccrpt_Done:
+            what.info.done.rc = evt->rc;
+            what.info.done.mesg = evt->text;
+            break;
+        case ccrpt_MD5:
+            what.info.MD5.rc = evt->rc;
+            what.info.MD5.file = evt->text;
+            break;
+        default:
+            break;
         }
+        rc = report(&what, ctx);
     }
-
-    KFileRelease(f);
-    VPathRelease(path);
-    VFSManagerRelease(mgr);
-
     return rc;
 }
 
+static void record_whack(cc_record_t *self)
+{
+    unsigned i;
 
-#if 0
-static rc_t verify_encryption(const KDirectory *dir, const char *name,
-    bool *enc, bool *sra)
+    for (i = 0; i < self->count; ++i) {
+        free(self->event[i].objName);
+        free(self->event[i].text);
+    }
+    free(self->event);
+    memset(self, 0, sizeof(*self));
+}
+
+static rc_t file_md5(KDirectory const *dir, char const path[],
+    uint8_t digest[16])
 {
-    rc_t rc = 0;
-    const KFile *f = NULL;
-    char buffer[24];
-    size_t num_read = ~0;
+    char buffer[64 * 1024];
+    KFile const *f = NULL;
+    uint64_t pos = 0;
+    MD5State md5;
 
-    assert(enc && sra);
-    *enc = false;
-    *sra = true;
+    rc_t rc = KDirectoryOpenFileRead(dir, &f, "%s", path);
+    if (rc)
+        return rc;
 
-    rc = KDirectoryOpenFileRead(dir, &f, "%s", name);
-    if (rc == 0) {
-        rc = KFileReadAll(f, 0, &buffer, sizeof buffer, &num_read);
-    }
-
-    if (rc == 0) {
-        size_t sz = num_read < 8 ? num_read : 8;
-        assert(num_read <= sizeof buffer);
-        rc = KFileIsEnc(buffer, sz);
-        if (rc == 0)
-        {
-            (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)' is encrypted",
-                "f=%s", name));
-            *enc = true;
-            rc = KEncFileValidate(f);
-            if (rc != 0) {
-                (void)PLOGERR(klogErr, (klogErr, rc, "Failure of encryption "
-                    "validation of file '$(name)'", "name=%s", name));
-            }
-            else {
-                (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)': encryption OK",
-                    "f=%s", name));
-                rc = EncFileReadAll(name, buffer, sizeof buffer, &num_read);
-            }
-        }
-        else {
-            rc = 0;
-            (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)' is not encrypted",
-                "f=%s", name));
-        }
-    }
-
-    if (rc == 0) {
-        rc = KFileIsSRA(buffer, num_read);
-        if (rc == 0) {
-            *sra = true;
-        }
-        else if (rc
-            == SILENT_RC(rcFS, rcFile, rcIdentifying, rcBuffer, rcWrongType))
-        {
-            rc = 0;
-            *sra = false;
-        }
-        else {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to KFileIsSRA($(name))", "name=%s", name));
-        }
+    MD5StateInit(&md5);
+    for ( ; ; ) {
+        size_t num_read = 0;
+
+        rc = KFileReadAll(f, pos, buffer, sizeof(buffer), &num_read);
+        if (rc || num_read == 0)
+            break;
+        MD5StateAppend(&md5, buffer, num_read);
+        pos += num_read;
+
+        rc = Quitting();
+        if (rc)
+            break;
     }
+    if (rc == 0)
+        MD5StateFinish(&md5, digest);
 
     KFileRelease(f);
-
     return rc;
 }
-#endif
 
-static rc_t init_dbcc(KDirectory const *dir, char const name[], bool is_file,
-    node_t **nodes, char **names, KPathType *pathType)
+/* KDatabaseConsistencyCheck of the database itself stops with it
+   when it comes to its first table or database: these are jobs of their own */
+#define CC_DB_FILES_DONE RC(rcExe, rcDatabase, rcVisiting, rcItem, rcDone)
+
+static rc_t CC record_db_files(CCReportInfoBlock const *what, void *Ctx)
+{
+    if (what->type == ccrpt_Visit && what->info.visit.depth > 0)
+        return CC_DB_FILES_DONE;
+    return record(what, Ctx);
+}
+
+/* log messages held back: size_t length, then the message; one after another */
+typedef struct log_buffer_s {
+    KDataBuffer buf;
+    uint64_t used;
+} log_buffer_t;
+
+static rc_t log_buffer_add(log_buffer_t *self, const char *buffer,
+    size_t bufsize)
 {
-    KDirectory const *obj;
-    unsigned nobj;
-    size_t namesz;
     rc_t rc = 0;
 
-    assert(pathType);
+    if (self->buf.elem_bits == 0)
+        rc = KDataBufferMakeBytes(&self->buf, 0);
+    if (rc == 0)
+        rc = KDataBufferResize(&self->buf,
+                               self->used + sizeof(bufsize) + bufsize);
+    if (rc == 0) {
+        char *dst = (char *)self->buf.base + self->used;
 
-    if (is_file) {
-        rc = KDirectoryOpenSraArchiveRead_silent(dir, &obj, false, "%s", name);
-        if (rc != 0)
-        {   rc = KDirectoryOpenTarArchiveRead_silent(dir, &obj, false, "%s", name); }
-        if (rc != 0) {
-            const VDBManager *mgr = NULL;
-            const VTable *tbl = NULL;
-            VSchema *sra_schema = NULL;
-            rc = VDBManagerMakeRead(&mgr, dir);
-            if (rc != 0)
-            {   return rc; }
-            for ( ; rc == 0; ) {
-                rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
-                VSchemaRelease(sra_schema);
-                if (rc == 0) {
-                    const KTable *ktbl = NULL;
-                    rc = VTableOpenKTableRead(tbl, &ktbl);
-                    if (rc == 0)
-                    {   rc = KTableOpenDirectoryRead(ktbl, &obj); }
-                    KTableRelease(ktbl);
-                    *pathType = kptTable;
-                    break;
-                }
-                else if (GetRCState(rc) == rcNotFound
-                    && GetRCObject(rc) == (enum RCObject)rcSchema && sra_schema == NULL)
-                {
-                     rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
-                }
-                else {
-                    const VDatabase *db = NULL;
-                    const KDatabase *kdb = NULL;
-                    rc = VDBManagerOpenDBRead(mgr, &db, NULL, "%s", name);
-                    if (rc == 0)
-                    {   rc = VDatabaseOpenKDatabaseRead(db, &kdb); }
-                    if (rc == 0)
-                    {   rc = KDatabaseOpenDirectoryRead(kdb, &obj); }
-                    if (rc == 0)
-                    {   *pathType = kptDatabase; }
-                    KDatabaseRelease(kdb);
-                    VDatabaseRelease(db);
-                    break;
-                }
-            }
-            VTableRelease(tbl);
-            VDBManagerRelease(mgr);
-        }
-    }
-    else {
-        rc = KDirectoryOpenDirRead(dir, &obj, false, "%s", name);
-    }
-    if (rc)
-        return rc;
-    rc = get_sizes(obj, &nobj, &namesz);
-    KDirectoryRelease(obj);
-    if (rc) {
-        *nodes = NULL;
-        *names = NULL;
-    }
-    else {
-        *nodes = calloc(1, nobj * sizeof(**nodes) + namesz);
-        if (nodes)
-            *names = (char *)&(*nodes)[nobj];
-        else
-            rc = RC(rcExe, rcSelf, rcConstructing, rcMemory, rcExhausted);
+        memmove(dst, &bufsize, sizeof(bufsize));
+        memmove(dst + sizeof(bufsize), buffer, bufsize);
+        self->used += sizeof(bufsize) + bufsize;
     }
     return rc;
 }
 
-static rc_t get_schema_info(KMetadata const *meta, char buffer[], size_t bsz,
-    char **vers)
+/* passes the messages on to the log handler: in their original order */
+static void log_buffer_flush(log_buffer_t const *self, KWrtWriter writer,
+    void *data)
 {
-    KMDataNode const *node;
-    rc_t rc = KMetadataOpenNodeRead(meta, &node, "schema");
+    uint64_t pos = 0;
 
-    if (rc == 0) {
-        size_t sz;
+    while (writer != NULL && pos < self->used) {
+        char const *src = (char const *)self->buf.base + pos;
+        size_t bufsize = 0;
+        size_t num_writ = 0;
 
-        rc = KMDataNodeReadAttr(node, "name", buffer, bsz, &sz);
+        memmove(&bufsize, src, sizeof(bufsize));
+        writer(data, src + sizeof(bufsize), bufsize, &num_writ);
+        pos += sizeof(bufsize) + bufsize;
+    }
+}
+
+static void log_buffer_whack(log_buffer_t *self)
+{
+    if (self->buf.elem_bits != 0)
+        KDataBufferWhack(&self->buf);
+    memset(self, 0, sizeof(*self));
+}
+
+/* if not NULL: the log messages of the job the thread runs are held in it */
+static THREAD_LOCAL log_buffer_t *job_log = NULL;
+
+/* holds back the log messages while the jobs run: those of a job go with the
+   job and are replayed with it, the others are kept in the order they came */
+typedef struct log_capture_s {
+    KWrtWriter writer;
+    void *data;
+    KLock *lock; /* the log handler is process-global: any thread may log */
+    log_buffer_t held;
+    bool hold; /* false: the messages that are not of a job are passed on */
+    bool active;
+} log_capture_t;
+
+static rc_t CC log_capture_write(void *data, const char *buffer,
+    size_t bufsize, size_t *num_writ)
+{
+    log_capture_t *self = data;
+    rc_t rc = 0;
+
+    *num_writ = 0;
+    if (job_log != NULL)
+        rc = log_buffer_add(job_log, buffer, bufsize);
+    else {
+        rc = KLockAcquire(self->lock);
         if (rc == 0) {
-            buffer[sz] = '\0';
-            *vers = &buffer[sz];
-            while (sz) {
-                --sz;
-                if (buffer[sz] == '#') {
-                    buffer[sz] = '\0';
-                    *vers = &buffer[sz + 1];
-                    break;
-                }
-            }
+            if (self->hold)
+                rc = log_buffer_add(&self->held, buffer, bufsize);
+            else if (self->writer != NULL)
+                rc = self->writer(self->data, buffer, bufsize, num_writ);
+            KLockUnlock(self->lock);
         }
-        KMDataNodeRelease(node);
     }
+    if (rc == 0)
+        *num_writ = bufsize;
     return rc;
 }
 
-static rc_t get_tbl_schema_info(VTable const *tbl, char buffer[], size_t bsz,
-    char **vers)
+static void log_capture_start(log_capture_t *self)
 {
-    KMetadata const *meta;
-    rc_t rc = VTableOpenMetadataRead(tbl, &meta);
-
-    *(*vers = &buffer[0]) = '\0';
-    if (rc == 0) rc = get_schema_info(meta, buffer, bsz, vers);
-    return 0;
+    memset(self, 0, sizeof(*self));
+    if (KLockMake(&self->lock) == 0) {
+        self->writer = KLogWriterGet();
+        self->data = KLogDataGet();
+        self->hold = true;
+        self->active = KLogHandlerSet(log_capture_write, self) == 0;
+    }
 }
 
-static rc_t get_db_schema_info(VDatabase const *db, char buffer[], size_t bsz,
-    char **vers)
+/* the messages that are not of a job are passed on from now on */
+static void log_capture_pass(log_capture_t *self)
 {
-    KMetadata const *meta;
-    rc_t rc = VDatabaseOpenMetadataRead(db, &meta);
-
-    *(*vers = &buffer[0]) = '\0';
-    if (rc == 0)
-    {
-        rc = get_schema_info(meta, buffer, bsz, vers);
-        KMetadataRelease(meta);
+    if (self->active && KLockAcquire(self->lock) == 0) {
+        self->hold = false;
+        KLockUnlock(self->lock);
     }
+}
 
-    return rc;
+/* no thread may log through it anymore */
+static void log_capture_stop(log_capture_t *self)
+{
+    if (self->active) {
+        KLogHandlerSet(self->writer, self->data);
+        self->active = false;
+    }
 }
 
-static rc_t sra_dbcc_454(VTable const *tbl, char const name[])
+static void log_capture_flush(log_capture_t const *self)
 {
-    /* TODO: complete this */
-    return 0;
+    log_buffer_flush(&self->held, self->writer, self->data);
 }
 
-typedef struct vdb_validate_params vdb_validate_params;
-struct vdb_validate_params
+static void log_capture_whack(log_capture_t *self)
 {
-    const KDirectory *wd;
-    const KDBManager *kmgr;
-    const VDBManager *vmgr;
+    log_capture_stop(self);
+    log_buffer_whack(&self->held);
+    KLockRelease(self->lock);
+}
 
-    bool md5_chk;
-    bool md5_chk_explicit;
-    bool blob_crc;
-    bool index_chk;
-    bool consist_check;
-    bool exhaustive;
+typedef struct cc_job_s {
+    char *name;
+    KDatabase const *db;
+    KTable const *tbl;
+    unsigned depth;
+    cc_record_t record;
+    log_buffer_t log;
+    rc_t rc;
+    bool done;
+} cc_job_t;
 
-    // data integrity checks parameters
-    bool sdc_enabled;
-    bool sdc_sec_rows_in_percent;
-    union
-    {
-        double percent;
-        uint64_t number;
-    } sdc_sec_rows;
+typedef struct cc_mt_s {
+    KLock *lock;
+    KCondition *cond;
+    KThread **thread;
+    unsigned threads;
 
-    bool sdc_seq_rows_in_percent;
-    union
-    {
-        double percent;
-        uint64_t number;
-    } sdc_seq_rows;
+    cc_job_t *job;
+    unsigned jobs;
+    unsigned next;    /* the next job to take */
+    unsigned stop_at; /* the first failed job: later ones are not needed */
 
-    bool sdc_pa_len_thold_in_percent;
-    union
-    {
-        double percent;
-        uint64_t number;
-    } sdc_pa_len_thold;
-};
+    uint32_t level;
+    INSDC_SRA_platform_id platform;
+} cc_mt_t;
 
-static rc_t tableConsistCheck(const vdb_validate_params *pb, const VTable *tbl)
+static rc_t cc_job_run(cc_mt_t const *mt, cc_job_t *job)
 {
-    rc_t rce = 0;
+    rc_t rc;
 
-    const VCursor *curs = NULL;
+    if (job->tbl != NULL) {
+        return KTableConsistencyCheck(job->tbl, job->depth, mt->level,
+            record, &job->record,
+            job->depth == 0 ? mt->platform : SRA_PLATFORM_UNDEFINED);
+    }
+    if (job->depth > 0) {
+        return KDatabaseConsistencyCheck(job->db, job->depth, mt->level,
+            record, &job->record);
+    }
+    rc = KDatabaseConsistencyCheck(job->db, 0, mt->level,
+        record_db_files, &job->record);
+    return rc == CC_DB_FILES_DONE ? 0 : rc;
+}
 
-    int64_t firstREAD_LEN = 0;
-    uint64_t countREAD_LEN = 0;
+/* also run on the main thread once it has nothing else to do */
+static rc_t CC cc_worker(const KThread *self, void *data)
+{
+    cc_mt_t *mt = data;
+    rc_t rc = 0;
 
-    uint64_t i = 0;
+    while (rc == 0) {
+        cc_job_t *job = NULL;
 
-    ColumnInfo readLen;
-    ColumnInfo spotLen;
-    ColumnInfo read;
+        rc = KLockAcquire(mt->lock);
+        if (rc)
+            break;
+        while (mt->next < mt->stop_at && mt->job[mt->next].done)
+            ++mt->next;
+        if (mt->next < mt->stop_at)
+            job = &mt->job[mt->next++];
+        KLockUnlock(mt->lock);
 
-    memset(&readLen, 0, sizeof readLen);
-    memset(&spotLen, 0, sizeof spotLen);
-    memset(&read   , 0, sizeof read   );
+        if (job == NULL)
+            break;
 
-    assert(pb);
+        job_log = &job->log;
+        job->rc = cc_job_run(mt, job);
+        job_log = NULL;
 
-    if (!pb->consist_check) {
-        return 0;
-    }
+        rc = KLockAcquire(mt->lock);
+        if (rc == 0) {
+            unsigned const idx = (unsigned)(job - mt->job);
 
-    rce = VTableCreateCursorRead(tbl, &curs);
-    if (rce != 0) {
-        return rce;
-    }
-    if (rce == 0) {
-        readLen.name = "READ_LEN";
-        rce = VCursorAddColumn(curs, &readLen.idx, "%s", readLen.name);
-    }
-    if (rce == 0) {
-        spotLen.name = "SPOT_LEN";
-        rce = VCursorAddColumn(curs, &spotLen.idx, "%s", spotLen.name);
-    }
-    if (rce == 0) {
-        read.name = "READ";
-        rce = VCursorAddColumn(curs, &read.idx, "%s", read.name);
+            job->done = true;
+            if (job->rc != 0 && idx < mt->stop_at)
+                mt->stop_at = idx;
+            KConditionBroadcast(mt->cond);
+            KLockUnlock(mt->lock);
+        }
     }
+    return rc;
+}
 
-    if (rce == 0) {
-        assert(readLen.idx && spotLen.idx && read.idx);
-        if (readLen.idx == 0) {
-            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
-            LOGERR(klogErr, rce, "Cannot find 'READ_LEN' column");
-        }
-        else if (spotLen.idx == 0) {
-            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
-            LOGERR(klogErr, rce, "Cannot find 'SPOT_LEN' column");
-        }
-        else if (read.idx == 0) {
-            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
-            LOGERR(klogErr, rce, "Cannot find 'READ' column");
-        }
-    }
-
-    if (rce == 0) {
-        rce = VCursorOpen(curs);
-    }
-    if (rce == 0) {
-        rce =
-            VCursorIdRange(curs, readLen.idx, &firstREAD_LEN, &countREAD_LEN);
-    }
-    if (rce == 0) {
-        int64_t firstSPOT_LEN = 0;
-        uint64_t countSPOT_LEN = 0;
-        rce =
-            VCursorIdRange(curs, spotLen.idx, &firstSPOT_LEN, &countSPOT_LEN);
-        if (rce == 0) {
-            if (firstREAD_LEN != firstSPOT_LEN) {
-                rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcInvalid);
-                LOGERR(klogErr, rce, "The first ID-s "
-                    "in READ_LEN and SPOT_LEN columns do not match");
-            }
-            else if (countREAD_LEN != countSPOT_LEN) {
-                rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcInvalid);
-                LOGERR(klogErr, rce, "ID ranges "
-                    "in READ_LEN and SPOT_LEN columns do not match");
-            }
-        }
+static rc_t cc_mt_add(cc_mt_t *mt, char const name[], unsigned depth,
+    KDatabase const *db, KTable const *tbl, rc_t open_rc)
+{
+    cc_job_t *const job = &mt->job[mt->jobs];
+
+    job->name = strdup(name);
+    if (job->name == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    job->db = db;
+    job->tbl = tbl;
+    job->depth = depth;
+    if (open_rc != 0) {
+        /* a serial check would have stopped here */
+        job->rc = open_rc;
+        job->done = true;
+        if (mt->jobs < mt->stop_at)
+            mt->stop_at = mt->jobs;
     }
+    ++mt->jobs;
+    return 0;
+}
 
-    for (i = 0; i < countREAD_LEN; ++i) {
-        uint32_t n = 0;
-        uint32_t j = 0;
-        rc_t rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
-            readLen.idx, &readLen.elem_bits,
-            &readLen.value.vp, NULL, &readLen.elem_count);
-        if (rc != 0) {
-            PLOGERR(klogErr, (klogErr, rc,
-                "Cannot read 'READ_LEN' column at row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
-        rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
-            spotLen.idx, &spotLen.elem_bits,
-            &spotLen.value.vp, NULL, &spotLen.elem_count);
-        if (rc != 0) {
-            PLOGERR(klogErr, (klogErr, rc,
-                "Cannot read 'SPOT_LEN' column at row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
-        rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
-            read.idx, &read.elem_bits,
-            &read.value.vp, NULL, &read.elem_count);
-        if (rc != 0) {
-            PLOGERR(klogErr, (klogErr, rc,
-                "Cannot read 'READ' column at row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
+static uint32_t cc_mt_count(KNamelist const *list)
+{
+    uint32_t count = 0;
 
-        if (readLen.value.vp == NULL || spotLen.value.vp == NULL) {
-            rc = RC(rcExe, rcTable, rcValidating, rcData, rcNull);
-            PLOGERR(klogErr, (klogErr, rc,
-                "Invalid 'READ_LEN' or 'SPOT_LEN' value at row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
-        for (j = 0; j < readLen.elem_count; ++j) {
-            n += readLen.value.u32[j];
-        }
-        if (n != *(spotLen.value.u32)) {
-            rc = RC(rcExe, rcTable, rcValidating, rcData, rcCorrupt);
-            PLOGERR(klogErr, (klogErr, rc,
-                "Sum(READ_LEN) != SPOT_LEN in row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
-        if (n != read.elem_count) {
-            rc = RC(rcExe, rcTable, rcValidating, rcData, rcCorrupt);
-            PLOGERR(klogErr, (klogErr, rc,
-                "Sum(READ_LEN) != length(READ) in row $(row)",
-                "row=%ld", firstREAD_LEN + i));
-            if (rce == 0) {
-                rce = rc;
-            }
-            if (!pb->exhaustive) {
-                break;
-            }
-        }
-    }
+    if (list != NULL && KNamelistCount(list, &count) != 0)
+        count = 0;
+    return count;
+}
 
-    if (rce == 0) {
-        LOGMSG(klogInfo, "Columns 'READ_LEN' and 'SPOT_LEN' are consistent");
-    }
+static rc_t cc_mt_add_children(cc_mt_t *mt, KDatabase const *db,
+    KNamelist const *list, bool tables)
+{
+    uint32_t const count = cc_mt_count(list);
+    uint32_t i;
+    rc_t rc = 0;
 
-    VCursorRelease(curs);
+    for (i = 0; i < count && rc == 0; ++i) {
+        char const *name = NULL;
+        KDatabase const *sub = NULL;
+        KTable const *tbl = NULL;
+        rc_t rc2;
 
-    return rce;
+        rc = KNamelistGet(list, i, &name);
+        if (rc)
+            break;
+        if (tables)
+            rc2 = KDatabaseOpenTableRead(db, &tbl, "%s", name);
+        else
+            rc2 = KDatabaseOpenDBRead(db, &sub, "%s", name);
+        rc = cc_mt_add(mt, name, 1, sub, tbl, rc2);
+        if (rc) {
+            KTableRelease(tbl);
+            KDatabaseRelease(sub);
+        }
+    }
+    return rc;
 }
 
-static rc_t sra_dbcc_fastq(const vdb_validate_params *pb,
-    const VTable *tbl, char const name[])
+static rc_t cc_mt_make(cc_mt_t *mt, const KDBManager *mgr,
+    char const name[], KPathType pathType, uint32_t mode,
+    INSDC_SRA_platform_id platform)
 {
-    static char const *const cn_FastQ[] = {
-        "READ", "QUALITY", "SPOT_LEN", "READ_START", "READ_LEN", "READ_TYPE"
-    };
+    rc_t rc = 0;
 
-    VCursor const *curs;
-    rc_t rc = VTableCreateCursorRead(tbl, &curs);
+    memset(mt, 0, sizeof(*mt));
+    mt->level = kdbcc_level(mode);
+    mt->platform = platform;
 
-    if (rc == 0) {
-        unsigned const n = sizeof(cn_FastQ)/sizeof(cn_FastQ[0]);
-        ColumnInfo cols[sizeof(cn_FastQ)/sizeof(cn_FastQ[0])];
-        unsigned i;
+    if (pathType == kptDatabase) {
+        KDatabase const *db = NULL;
+        KNamelist *tbls = NULL;
+        KNamelist *dbs = NULL;
 
-        memset(cols, 0, sizeof(cols));
-        for (i = 0; i < n; ++i) {
-            cols[i].name = cn_FastQ[i];
-            VCursorAddColumn(curs, &cols[i].idx, "%s", cols[i].name);
+        rc = KDBManagerOpenDBRead(mgr, &db, "%s", name);
+        if (rc)
+            return rc;
+
+        /* a database might have no tables or no databases */
+        KDatabaseListTbl(db, &tbls);
+        KDatabaseListDB(db, &dbs);
+
+        mt->job = calloc(1 + cc_mt_count(tbls) + cc_mt_count(dbs),
+                         sizeof(mt->job[0]));
+        if (mt->job == NULL) {
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+            KDatabaseRelease(db);
         }
-        rc = VCursorOpen(curs);
-        if (rc == 0) {
-            rc = VCursorOpenRow(curs);
-            for (i = 0; i < n && rc == 0; ++i) {
-                VCursorCellData(curs, cols[i].idx, &cols[i].elem_bits,
-                    &cols[i].value.vp, NULL, &cols[i].elem_count);
-            }
-            if (   cols[0].idx == 0 || cols[0].elem_bits == 0
-                                                    || cols[0].value.vp == NULL
-                || cols[1].idx == 0 || cols[1].elem_bits == 0
-                                                    || cols[1].value.vp == NULL)
-            {
-                rc = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
-            }
-            else if (cols[2].idx == 0 || cols[2].elem_bits == 0
-                                                    || cols[2].value.vp == NULL)
-            {
-                (void)PLOGERR(klogWarn, (klogWarn,
-                    RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound),
-                    "Table '$(name)' is usable for fasta only; no quality data",
-                    "name=%s", name));
-            }
+        else {
+            mt->stop_at = 1 + cc_mt_count(tbls) + cc_mt_count(dbs);
+            rc = cc_mt_add(mt, name, 0, db, NULL, 0);
+            if (rc)
+                KDatabaseRelease(db);
+            if (rc == 0)
+                rc = cc_mt_add_children(mt, db, tbls, true);
+            if (rc == 0)
+                rc = cc_mt_add_children(mt, db, dbs, false);
         }
-        VCursorRelease(curs);
+        KNamelistRelease(dbs);
+        KNamelistRelease(tbls);
     }
+    else {
+        KTable const *tbl = NULL;
 
-    if (rc == 0) {
-        rc = tableConsistCheck(pb, tbl);
-    }
+        rc = KDBManagerOpenTableRead(mgr, &tbl, "%s", name);
+        if (rc)
+            return rc;
 
-    if (rc) {
-        (void)PLOGERR(klogErr, (klogErr, rc,
-            "Table '$(name)' is damaged beyond any use", "name=%s", name));
+        mt->job = calloc(1, sizeof(mt->job[0]));
+        if (mt->job == NULL) {
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+            KTableRelease(tbl);
+        }
+        else {
+            mt->stop_at = 1;
+            rc = cc_mt_add(mt, name, 0, NULL, tbl, 0);
+            if (rc)
+                KTableRelease(tbl);
+        }
     }
 
+    if (rc == 0)
+        rc = KLockMake(&mt->lock);
+    if (rc == 0)
+        rc = KConditionMake(&mt->cond);
     return rc;
 }
 
-static rc_t VTable_get_platform(VTable const *tbl,
-    INSDC_SRA_platform_id *rslt)
+/* jobs that are done already are not run again */
+static rc_t cc_mt_start(cc_mt_t *mt, uint32_t threads)
 {
-    rc_t rc;
-    VCursor const *curs;
-    INSDC_SRA_platform_id platform = -1;
+    unsigned pending = 0;
+    unsigned i;
 
-    rc = VTableCreateCursorRead(tbl, &curs);
-    if (rc == 0) {
-        uint32_t cid;
+    for (i = 0; i < mt->jobs; ++i) {
+        if (!mt->job[i].done)
+            ++pending;
+    }
+    if (threads > pending)
+        threads = pending;
+    if (threads == 0)
+        return 0;
 
-        rc = VCursorAddColumn(curs, &cid, "("sra_platform_id_t")PLATFORM");
-        if (rc == 0) {
-            rc = VCursorOpen(curs);
-            if (rc == 0) {
-                uint32_t ebits;
-                void const *data;
-                uint32_t boff;
-                uint32_t ecnt;
+    mt->thread = calloc(threads, sizeof(mt->thread[0]));
+    if (mt->thread == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
 
-                rc = VCursorCellDataDirect(curs, 1, cid,
-                    &ebits, &data, &boff, &ecnt);
-                if (rc == 0) {
-                    if (ebits == sizeof(platform) * 8 && boff == 0 && ecnt == 1)
-                        platform = ((INSDC_SRA_platform_id *)data)[0];
-                    else
-                        rc =
-                            RC(rcExe, rcTable, rcReading, rcType, rcUnexpected);
-                }
-            }
-        }
-        else
-            rc = 0;
-        VCursorRelease(curs);
+    /* the main thread takes over the jobs of the threads that did not start */
+    for (i = 0; i < threads; ++i) {
+        if (KThreadMake(&mt->thread[mt->threads], cc_worker, mt) == 0)
+            ++mt->threads;
     }
-    rslt[0] = platform;
-    return rc;
+    return 0;
 }
 
-static rc_t verify_table(const vdb_validate_params *pb,
-    const VTable *tbl, char const name[])
+/* the database and its children, as visiting() would have recorded them:
+   enough for the checks of sra_dbcc */
+static rc_t cc_mt_nodes(cc_mt_t const *mt, KPathType pathType,
+    node_t **nodes, char **names)
+{
+    cc_context_t ctx;
+    CCReportInfoBlock what;
+    size_t namesz = 0;
+    unsigned i;
+
+    for (i = 0; i < mt->jobs; ++i)
+        namesz += strlen(mt->job[i].name) + 1;
+
+    *nodes = calloc(1, mt->jobs * sizeof(**nodes) + namesz);
+    if (*nodes == NULL)
+        return RC(rcExe, rcSelf, rcConstructing, rcMemory, rcExhausted);
+    *names = (char *)&(*nodes)[mt->jobs];
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.nodes = *nodes;
+    ctx.names = *names;
+
+    memset(&what, 0, sizeof(what));
+    what.type = ccrpt_Visit;
+    for (i = 0; i < mt->jobs; ++i) {
+        cc_job_t const *job = &mt->job[i];
+
+        what.objName = job->name;
+        what.objType = job->depth == 0 ? pathType
+                     : job->tbl != NULL ? kptTable : kptDatabase;
+        what.info.visit.depth = job->depth;
+        visiting(&what, &ctx);
+    }
+    return 0;
+}
+
+/* waits for the jobs in order and replays them; returns what the
+   consistency check of the whole object would have returned */
+static rc_t cc_mt_replay(cc_mt_t *mt, cc_context_t *ctx,
+    log_capture_t const *capture)
 {
-    char schemaName[1024];
-    char *schemaVers = NULL;
     rc_t rc = 0;
+    unsigned i;
 
-    get_tbl_schema_info(tbl, schemaName, sizeof(schemaName), &schemaVers);
+    cc_worker(NULL, mt);
 
-    if (schemaName[0] == '\0' || strncmp(schemaName, "NCBI:SRA:", 9) == 0) {
-        /* SRA or legacy SRA */
-        INSDC_SRA_platform_id platform;
+    for (i = 0; i < mt->jobs && rc == 0; ++i) {
+        cc_job_t *const job = &mt->job[i];
 
-        rc = VTable_get_platform(tbl, &platform);
-        if (rc == 0) {
-            if (platform == (INSDC_SRA_platform_id)-1) {
-                (void)PLOGMSG(klogWarn, (klogWarn, "Couldn't determine "
-                    "SRA Platform; type of table '$(name)' is indeterminate.",
-                    "name=%s", name));
-            }
-            rc = sra_dbcc_fastq(pb, tbl, name);
-            if (rc == 0 && platform == SRA_PLATFORM_454) {
-                rc = sra_dbcc_454(tbl, name);
-            }
-        }
-        else {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to read table '$(name)'", "name=%s", name));
-        }
+        rc = KLockAcquire(mt->lock);
+        if (rc)
+            break;
+        while (!job->done && rc == 0)
+            rc = KConditionWait(mt->cond, mt->lock);
+        KLockUnlock(mt->lock);
+
+        if (rc == 0)
+            rc = record_replay(&job->record, ctx);
+        log_buffer_flush(&job->log, capture->writer, capture->data);
+        if (rc == 0)
+            rc = job->rc;
     }
     return rc;
 }
 
-static rc_t verify_mgr_table(const vdb_validate_params *pb, char const name[])
+/* no job is started anymore; the running ones are finished */
+static void cc_mt_wait(cc_mt_t *mt)
 {
-    rc_t rc = 0;
+    unsigned i;
 
-    const VTable *tbl = NULL;
-    VSchema *sra_schema = NULL;
+    if (mt->lock != NULL && KLockAcquire(mt->lock) == 0) {
+        /* nothing more is needed */
+        mt->stop_at = 0;
+        KLockUnlock(mt->lock);
+    }
+    for (i = 0; i < mt->threads; ++i) {
+        rc_t status = 0;
 
-    const VDBManager *mgr = NULL;
+        KThreadWait(mt->thread[i], &status);
+        KThreadRelease(mt->thread[i]);
+    }
+    free(mt->thread);
+    mt->thread = NULL;
+    mt->threads = 0;
+}
 
-    assert(pb);
+static void cc_mt_whack(cc_mt_t *mt)
+{
+    unsigned i;
 
-    mgr = pb->vmgr;
+    cc_mt_wait(mt);
 
-    for ( ; ; ) {
-        rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
-        VSchemaRelease(sra_schema);
-        if (rc == 0) {
-            rc = verify_table(pb, tbl, name);
-            break;
-        }
-        else if (GetRCState(rc) == rcNotFound && GetRCObject(rc) == (enum RCObject)rcSchema
-            && sra_schema == NULL)
-        {
-            rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
-            if (rc) {
-                (void)PLOGERR(klogErr, (klogErr, rc,
-                    "Failed to open table '$(name)'", "name=%s", name));
-                break;
-            }
-        }
-        else {
-            (void)PLOGERR(klogErr, (klogErr, rc,
-                "Failed to open table '$(name)'", "name=%s", name));
-            break;
-        }
-    }
+    for (i = 0; i < mt->jobs; ++i) {
+        cc_job_t *const job = &mt->job[i];
 
-    RELEASE(VSchema, sra_schema);
-    RELEASE(VTable, tbl);
+        record_whack(&job->record);
+        log_buffer_whack(&job->log);
+        KTableRelease(job->tbl);
+        KDatabaseRelease(job->db);
+        free(job->name);
+    }
+    free(mt->job);
 
-    return rc;
+    KConditionRelease(mt->cond);
+    KLockRelease(mt->lock);
+    memset(mt, 0, sizeof(*mt));
 }
 
+static
+rc_t vdbcc ( const VDBManager *mgr, char const name[], uint32_t mode,
+    KPathType *pathType, bool is_file)
+{
 #if 0
-static rc_t verify_db_table(VDatabase const *db, char const name[])
+    if ( ( mode & 8) != 0 )
+    {
+        const VTable *tbl;
+        rc_t rc = VDBManagerOpenTableRead(mgr, &tbl, NULL, "%s", name);
+        if (rc == 0)
+            rc = VTableConsistencyCheck(tbl, 2);
+        return rc;
+    }
+#endif
+    return 0;
+}
+
+typedef struct ColumnInfo_s {
+    char const *name;
+    union {
+        void     const *vp;
+        char     const *string;
+        bool     const *tf;
+        int8_t   const *i8;
+        uint8_t  const *u8;
+        int16_t  const *i16;
+        uint16_t const *u16;
+        int32_t  const *i32;
+        uint32_t const *u32;
+        int64_t  const *i64;
+        uint64_t const *u64;
+        float    const *f32;
+        double   const *f64;
+    } value;
+    uint32_t idx;
+    uint32_t elem_bits;
+    uint32_t elem_count;
+} ColumnInfo;
+
+static rc_t CC get_sizes_cb(const KDirectory *dir,
+    uint32_t type, const char *name, void *data)
 {
-    VTable const *tbl;
-    rc_t rc = VDatabaseOpenTableRead(db, &tbl, "%s", name);
+    struct {
+        unsigned count;
+        size_t size;
+    } *pb = data;
 
-    if (rc == 0) {
-        rc = verify_table(tbl, name);
-        VTableRelease(tbl);
-    }
-    else {
-        (void)PLOGERR(klogErr, (klogErr, rc,
-            "Failed to open table '$(name)'", "name=%s", name));
-    }
+    ++pb->count;
+    pb->size += strlen(name) + 1;
+
+    return 0;
+}
+
+static rc_t get_sizes(KDirectory const *dir, unsigned *nobj, size_t *namesz)
+{
+    rc_t rc;
+    struct {
+        unsigned count;
+        size_t size;
+    } pb;
+
+    memset(&pb, 0, sizeof(pb));
+    rc = KDirectoryVVisit(dir, true, get_sizes_cb, &pb, NULL, NULL);
+    if (rc)
+        memset(&pb, 0, sizeof(pb));
+    *nobj = pb.count;
+    *namesz = pb.size;
     return rc;
 }
 
-static rc_t align_dbcc_primary_alignment(VTable const *tbl, char const name[])
+static rc_t EncFileReadAll(const char *name,
+    char *buffer, size_t bsize, size_t *num_read)
 {
-    VCursor const *curs;
-    rc_t rc = VTableCreateCursorRead(tbl, &curs);
+    rc_t rc = 0;
 
-    if (rc == 0) {
-        static char const *const cn_SAM[] = {
-            "SEQ_NAME",
-            "SAM_FLAGS",
-            "REF_NAME",
-            "REF_POS",
-            "MAPQ",
-            "HAS_MISMATCH",
-            "HAS_REF_OFFSET",
-            "REF_OFFSET",
-            "MATE_REF_NAME",
-            "MATE_REF_POS",
-            "TEMPLATE_LEN",
-            "READ",
-            "QUALITY"
-        };
-        unsigned const n = sizeof(cn_SAM)/sizeof(cn_SAM[0]);
-        ColumnInfo cols[sizeof(cn_SAM)/sizeof(cn_SAM[0])];
-        unsigned i;
+    VFSManager *mgr = NULL;
+    VPath *path = NULL;
+    const KFile *f = NULL;
 
-        memset(cols, 0, sizeof(cols));
-        for (i = 0; i < n; ++i) {
-            cols[i].name = cn_SAM[i];
-            VCursorAddColumn(curs, &cols[i].idx, "%s", cols[i].name);
+    rc = VFSManagerMake(&mgr);
+    if (rc != 0) {
+        LOGERR(klogErr, rc, "Failed to VFSManagerMake()");
+    }
+
+    if (rc == 0) {
+        rc = VFSManagerMakePath (mgr, &path, "%s", name);
+        if (rc != 0) {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to VPathMake($(name))", "name=%s", name));
         }
-        rc = VCursorOpen(curs);
-        if (rc == 0) {
-            rc = VCursorOpenRow(curs);
-            for (i = 0; i < n && rc == 0; ++i) {
-                VCursorCellData(curs, cols[i].idx, &cols[i].elem_bits,
-                    &cols[i].value.vp, NULL, &cols[i].elem_count);
-            }
-            for (i = 0; i < n && rc == 0; ++i) {
-                if (cols[i].idx == 0 || cols[i].elem_bits == 0) {
-                    (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(name)' "
-                        "could not be used to generate SAM", "name=%s", name));
-                    break;
-                }
-            }
+    }
+
+    if (rc == 0) {
+        rc = VFSManagerOpenFileReadDecrypt(mgr, &f, path);
+        if (rc != 0) {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to VFSManagerOpenFileReadDecrypt($(name))",
+                "name=%s", name));
         }
-        VCursorRelease(curs);
     }
-    if (rc) {
-        (void)PLOGERR(klogErr, (klogErr, rc,
-            "Database '$(name)' is damaged beyond any use", "name=%s", name));
+
+    if (rc == 0) {
+        rc = KFileReadAll(f, 0, buffer, bsize, num_read);
+        if (rc != 0) {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to KFileReadAll($(name))", "name=%s", name));
+        }
     }
+
+    KFileRelease(f);
+    VPathRelease(path);
+    VFSManagerRelease(mgr);
+
     return rc;
 }
-#endif
 
-typedef struct id_pair_s {
-    int64_t first;
-    int64_t second;
-} id_pair_t;
 
-static size_t work_chunk(uint64_t const count)
+#if 0
+static rc_t verify_encryption(const KDirectory *dir, const char *name,
+    bool *enc, bool *sra)
 {
-    size_t const max = memory_suggestion / (sizeof(id_pair_t));
-    size_t chunk = (size_t)count;
-
-#if 1
-    /* do as many as possible at once */
-    if (chunk > max)
-        chunk = max;
-#else
-    /* break it up into chunks of about equal size */
-    while (chunk > max)
-        chunk /= 2;
-#endif
-    return chunk;
-}
+    rc_t rc = 0;
+    const KFile *f = NULL;
+    char buffer[24];
+    size_t num_read = ~0;
 
-static void sort_key_pairs(size_t const N, id_pair_t array[/* N */])
-{
-    id_pair_t a;
-    id_pair_t b;
-    
-#define GET(P, V) ((void)(V = ((id_pair_t const *)(P))[0]))
-#define SET(P, V) ((void)((((id_pair_t *)(P))[0]) = V))
-#define CMP(A, B) (((GET(A, a)),(GET(B, b))), (a.first  < b.first  ? -1 :      \
-                                               b.first  < a.first  ?  1 :      \
-                                               a.second < b.second ? -1 :      \
-                                               b.second < a.second ?  1 : 0))
-#define SWAP(A, B, C, D) do{GET(A, a); GET(B, b); SET(A, b); SET(B, a);}while(0)
-    KSORT(array, N, sizeof(array[0]), 0, 0);
-#undef SWAP
-#undef CMP
-#undef SET
-#undef GET
-}
+    assert(enc && sra);
+    *enc = false;
+    *sra = true;
 
-static void sort_keys(size_t const N, int64_t array[/* N */])
-{
-#define INDEXOF(A) (((int64_t const *)(A)) - ((int64_t const *)(&array[0])))
-#define CMP(A, B) (array[INDEXOF(A)] - array[INDEXOF(B)])
-#define SWAP(A, B, C, D) do {                                                  \
-    int64_t const a = array[INDEXOF(A)];                                       \
-    int64_t const b = array[INDEXOF(B)];                                       \
-    array[INDEXOF(A)] = b;                                                     \
-    array[INDEXOF(B)] = a; } while(0)
-    KSORT(array, N, sizeof(array[0]), 0, 0);
-#undef SWAP
-#undef CMP
-#undef INDEXOF
-}
+    rc = KDirectoryOpenFileRead(dir, &f, "%s", name);
+    if (rc == 0) {
+        rc = KFileReadAll(f, 0, &buffer, sizeof buffer, &num_read);
+    }
 
-#define CHECK_QUITTING do { rc_t const rc = Quitting(); if (rc) return rc; } while(0);
+    if (rc == 0) {
+        size_t sz = num_read < 8 ? num_read : 8;
+        assert(num_read <= sizeof buffer);
+        rc = KFileIsEnc(buffer, sz);
+        if (rc == 0)
+        {
+            (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)' is encrypted",
+                "f=%s", name));
+            *enc = true;
+            rc = KEncFileValidate(f);
+            if (rc != 0) {
+                (void)PLOGERR(klogErr, (klogErr, rc, "Failure of encryption "
+                    "validation of file '$(name)'", "name=%s", name));
+            }
+            else {
+                (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)': encryption OK",
+                    "f=%s", name));
+                rc = EncFileReadAll(name, buffer, sizeof buffer, &num_read);
+            }
+        }
+        else {
+            rc = 0;
+            (void)PLOGMSG(klogInfo, (klogInfo, "File '$(f)' is not encrypted",
+                "f=%s", name));
+        }
+    }
 
-static size_t load_key_pairs(int64_t const startId,
-                             int64_t const endId,
-                             size_t const pairs,
-                             id_pair_t pair[/* pairs */],
-                             VCursor const *const acurs,
-                             ColumnInfo *const aci,
-                             int64_t plast[],
-                             rc_t Rc[])
+    if (rc == 0) {
+        rc = KFileIsSRA(buffer, num_read);
+        if (rc == 0) {
+            *sra = true;
+        }
+        else if (rc
+            == SILENT_RC(rcFS, rcFile, rcIdentifying, rcBuffer, rcWrongType))
+        {
+            rc = 0;
+            *sra = false;
+        }
+        else {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to KFileIsSRA($(name))", "name=%s", name));
+        }
+    }
+
+    KFileRelease(f);
+
+    return rc;
+}
+#endif
+
+static rc_t init_dbcc(KDirectory const *dir, char const name[], bool is_file,
+    node_t **nodes, char **names, KPathType *pathType)
 {
-    int64_t last_fkey = INT64_MIN;
-    int64_t row = startId;
-    size_t j = 0;
-    bool ordered = true;
-    
-    while (row < endId) {
-        int64_t first;
-        int64_t maybe_last;
-        rc_t const rc1 = VCursorPageIdRange(acurs, aci->idx, row, &first, &maybe_last);
-        int64_t const last = maybe_last < endId ? maybe_last : endId - 1;
-        size_t const count = (last + 1) - first;
+    KDirectory const *obj;
+    unsigned nobj;
+    size_t namesz;
+    rc_t rc = 0;
 
-        if (rc1) {
-            Rc[0] = rc1;
-            return 0;
-        }
-        CHECK_QUITTING;
-        
-        if (first < row)
-            first = row;
-        if (row != startId && pairs < count + j)
-            break;
-        plast[0] = last;
-        
-        for ( ; j < pairs && row <= last; ++row) {
-            rc_t const rc = VCursorCellDataDirect(acurs, row, aci->idx,
-                                                  &aci->elem_bits, &aci->value.vp,
-                                                  NULL, &aci->elem_count);
-            if (rc == 0) {
-                if (aci->elem_count == 1) {
-                    int64_t const fkey = aci->value.i64[0];
-                    
-                    ordered &= (last_fkey <= fkey);
-                    pair[j].second = row;
-                    pair[j].first = fkey;
-                    last_fkey = fkey;
-                    ++j;
+    assert(pathType);
+
+    if (is_file) {
+        rc = KDirectoryOpenSraArchiveRead_silent(dir, &obj, false, "%s", name);
+        if (rc != 0)
+        {   rc = KDirectoryOpenTarArchiveRead_silent(dir, &obj, false, "%s", name); }
+        if (rc != 0) {
+            const VDBManager *mgr = NULL;
+            const VTable *tbl = NULL;
+            VSchema *sra_schema = NULL;
+            rc = VDBManagerMakeRead(&mgr, dir);
+            if (rc != 0)
+            {   return rc; }
+            for ( ; rc == 0; ) {
+                rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
+                VSchemaRelease(sra_schema);
+                if (rc == 0) {
+                    const KTable *ktbl = NULL;
+                    rc = VTableOpenKTableRead(tbl, &ktbl);
+                    if (rc == 0)
+                    {   rc = KTableOpenDirectoryRead(ktbl, &obj); }
+                    KTableRelease(ktbl);
+                    *pathType = kptTable;
+                    break;
+                }
+                else if (GetRCState(rc) == rcNotFound
+                    && GetRCObject(rc) == (enum RCObject)rcSchema && sra_schema == NULL)
+                {
+                     rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
                 }
                 else {
-                    Rc[0] = RC(rcExe, rcDatabase, rcValidating, rcData, rcUnexpected);
-                    return 0;
+                    const VDatabase *db = NULL;
+                    const KDatabase *kdb = NULL;
+                    rc = VDBManagerOpenDBRead(mgr, &db, NULL, "%s", name);
+                    if (rc == 0)
+                    {   rc = VDatabaseOpenKDatabaseRead(db, &kdb); }
+                    if (rc == 0)
+                    {   rc = KDatabaseOpenDirectoryRead(kdb, &obj); }
+                    if (rc == 0)
+                    {   *pathType = kptDatabase; }
+                    KDatabaseRelease(kdb);
+                    VDatabaseRelease(db);
+                    break;
                 }
             }
-            else if (!(GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound)) {
-                Rc[0] = rc;
-                return 0;
-            }
-            /* row not found might be an error but that won't be decided here */
+            VTableRelease(tbl);
+            VDBManagerRelease(mgr);
         }
     }
-    if (!ordered)
-        sort_key_pairs(j, pair);
-    
-    Rc[0] = 0;
-    return j;
-}
-
-static bool is_sorted(uint32_t const N, int64_t const key[/* N */])
-{
-    uint32_t i = 0;
-    int64_t last = key[i];
-    
-    for (i = 1; i < N; ++i) {
-        int64_t const cur = key[i];
-        
-        if (cur < last)
-            return false;
-
-        last = cur;
+    else {
+        rc = KDirectoryOpenDirRead(dir, &obj, false, "%s", name);
     }
-    return true;
+    if (rc)
+        return rc;
+    rc = get_sizes(obj, &nobj, &namesz);
+    KDirectoryRelease(obj);
+    if (rc) {
+        *nodes = NULL;
+        *names = NULL;
+    }
+    else {
+        *nodes = calloc(1, nobj * sizeof(**nodes) + namesz);
+        if (nodes)
+            *names = (char *)&(*nodes)[nobj];
+        else
+            rc = RC(rcExe, rcSelf, rcConstructing, rcMemory, rcExhausted);
+    }
+    return rc;
 }
 
-static rc_t ric_align_generic(int64_t const startId,
-                              uint64_t const count,
-                              size_t const pairs,
-                              id_pair_t pair[/* pairs */],
-                              void *scratch[],
-                              VCursor const *const acurs,
-                              ColumnInfo *const aci,
-                              VCursor const *const bcurs,
-                              ColumnInfo *const bci
-                              )
+static rc_t get_schema_info(KMetadata const *meta, char buffer[], size_t bsz,
+    char **vers)
 {
-    int64_t chunk;
-    int64_t const endId = startId + count;
-    size_t scratch_size = 0;
-
-    for (chunk = startId; chunk < endId; ) {
-        rc_t rc = 0;
-        int64_t last;
-        size_t const n = load_key_pairs(chunk, endId, pairs, pair, acurs, aci, &last, &rc);
-        size_t i;
-        int64_t cur_fkey = 0;
-        uint32_t elem_count = 0;
-        uint32_t current = 0;
-        int64_t const *id = 0;
+    KMDataNode const *node;
+    rc_t rc = KMetadataOpenNodeRead(meta, &node, "schema");
 
-        if (rc) return rc;
-        if (chunk == last)
-            break;
-        if (chunk != startId) {
-            (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
-                                     "$(aname) <-> $(bname)"
-                                     " $(pct)% complete",
-                                     "aname=%s,bname=%s,pct=%5.1f",
-                                     aci->name, bci->name,
-                                     (100.0 * (chunk - startId)) / count));
-        }
-        chunk = last;
-        for (i = 0; i < n; ++i) {
-            int64_t const fkey = pair[i].first;
-            int64_t const row = pair[i].second;
-            
-            if (cur_fkey != fkey) {
-                uint32_t dummy;
-                
-                CHECK_QUITTING;
-                
-                rc = VCursorCellDataDirect(bcurs, fkey, bci->idx,
-                                           &dummy, (void const **)&id,
-                                           NULL, &elem_count);
-
-                if (GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound){
-					(void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
-                                     "$(aname) <-> $(bname)"
-                                     " failed to retrieve pair $(first) -> $(second)",
-                                     "aname=%s,bname=%s,first=%ld,second=%ld",
-                                     aci->name, bci->name,
-                                     pair[i].first,pair[i].second));
+    if (rc == 0) {
+        size_t sz;
 
-                    return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                } else if (rc) 
-                    return rc;
-                
-                if (!is_sorted(elem_count, id)) {
-                    if (scratch_size < elem_count) {
-                        void *const temp = realloc(scratch[0], elem_count * sizeof(id[0]));
-                        
-                        if (temp == NULL)
-                            return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
-                        
-                        scratch[0] = temp;
-                        scratch_size = elem_count;
-                    }
-                    memmove(scratch[0], id, elem_count * sizeof(id[0]));
-                    sort_keys(elem_count, scratch[0]);
-                    id = scratch[0];
-                }
-                current = 0;
-                cur_fkey = fkey;
-                while (current < elem_count && id[current] < row) {
-                    ++current;
+        rc = KMDataNodeReadAttr(node, "name", buffer, bsz, &sz);
+        if (rc == 0) {
+            buffer[sz] = '\0';
+            *vers = &buffer[sz];
+            while (sz) {
+                --sz;
+                if (buffer[sz] == '#') {
+                    buffer[sz] = '\0';
+                    *vers = &buffer[sz + 1];
+                    break;
                 }
             }
-            if (current >= elem_count || id[current] != row){
-				  (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
-                                     "$(aname) <-> $(bname)"
-                                     " inconsistens pair $(first) -> $(second)",
-                                     "aname=%s,bname=%s,first=%ld,second=%ld",
-                                     aci->name, bci->name,
-                                     pair[i].first,pair[i].second));
-
-                return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-			}
-            ++current;
         }
+        KMDataNodeRelease(node);
     }
-    return 0;
+    return rc;
 }
 
-static rc_t ric_align_ref_and_align(char const dbname[],
-                                    VTable const *ref,
-                                    VTable const *align,
-                                    int which)
+static rc_t get_tbl_schema_info(VTable const *tbl, char buffer[], size_t bsz,
+    char **vers)
 {
-    char const *const id_col_name = which == 0 ? "PRIMARY_ALIGNMENT_IDS"
-                                  : which == 1 ? "SECONDARY_ALIGNMENT_IDS"
-                                  : which == 2 ? "EVIDENCE_ALIGNMENT_IDS"
-                                  : NULL;
-    rc_t rc;
-    VCursor const *acurs = NULL;
-    VCursor const *bcurs = NULL;
-    ColumnInfo aci;
-    ColumnInfo bci;
-    int64_t startId;
-    uint64_t count;
-
-    aci.name = "REF_ID";
-    bci.name = id_col_name;
-    
-    rc = VTableCreateCursorRead(align, &acurs);
-    if (rc == 0) {
-        rc = VCursorAddColumn(acurs, &aci.idx, "%s", aci.name);
-        if (rc == 0)
-            rc = VCursorOpen(acurs);
-        if (rc == 0)
-            rc = VCursorIdRange(acurs, aci.idx, &startId, &count);
-    }
-    if (rc)
-        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-            "alignment table can not be read", "name=%s", dbname));
-    else {
-        rc = VTableCreateCursorRead(ref, &bcurs);
-        if (rc == 0)
-            rc = VCursorAddColumn(bcurs, &bci.idx, "%s", bci.name);
-        if (rc == 0)
-            rc = VCursorOpen(bcurs);
-        if (rc)
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                "reference table can not be read", "name=%s", dbname));
-    }
-    if (rc == 0) {
-        size_t const chunk = work_chunk(count);
-        id_pair_t *const pair = malloc(sizeof(id_pair_t) * chunk);
-
-        if (pair) {
-            void *scratch = NULL;
-            
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
-            if (scratch)
-                free(scratch);
-
-            if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-                    "Database '$(name)': failed referential "
-                    "integrity check", "name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcInconsistent)
-                (void)PLOGERR(klogErr, (klogErr, rc,
- "Database '$(name)': column '$(idcol)' failed referential integrity check",
- "name=%s,idcol=%s", dbname, id_col_name));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcTooBig)
-                (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
-                         " referential integrity could not be checked, skipped",
-                         "name=%s", dbname));
-            else if (rc)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-"Database '$(name)': reference table can not be read", "name=%s", dbname));
+    KMetadata const *meta;
+    rc_t rc = VTableOpenMetadataRead(tbl, &meta);
 
-            free(pair);
-        }
-        else
-            rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
-        
-        if (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted) {
-            rc = 0;
-            (void)PLOGERR(klogWarn, (klogWarn, rc, "Database '$(name)':"
-                " referential integrity could not be checked, skipped",
-                "name=%s", dbname));
-        }
-    }
-    VCursorRelease(acurs);
-    VCursorRelease(bcurs);
-    return rc;
+    *(*vers = &buffer[0]) = '\0';
+    if (rc == 0) rc = get_schema_info(meta, buffer, bsz, vers);
+    return 0;
 }
 
-static rc_t ric_align_seq_and_pri(char const dbname[],
-                                  VTable const *seq,
-                                  VTable const *pri)
+static rc_t get_db_schema_info(VDatabase const *db, char buffer[], size_t bsz,
+    char **vers)
 {
-    rc_t rc;
-    VCursor const *acurs = NULL;
-    VCursor const *bcurs = NULL;
-    ColumnInfo aci;
-    ColumnInfo bci;
-    int64_t startId;
-    uint64_t count;
+    KMetadata const *meta;
+    rc_t rc = VDatabaseOpenMetadataRead(db, &meta);
 
-    aci.name = "SEQ_SPOT_ID";
-    bci.name = "PRIMARY_ALIGNMENT_ID";
-    
-    rc = VTableCreateCursorRead(pri, &acurs);
-    if (rc == 0)
-        rc = VCursorAddColumn(acurs, &aci.idx, "%s", aci.name);
-    if (rc == 0)
-        rc = VCursorOpen(acurs);
+    *(*vers = &buffer[0]) = '\0';
     if (rc == 0)
-        rc = VCursorIdRange(acurs, aci.idx, &startId, &count);
-    if (rc)
-        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-            "alignment table can not be read", "name=%s", dbname));
-    else {
-        rc = VTableCreateCursorRead(seq, &bcurs);
-        if (rc == 0)
-            rc = VCursorAddColumn(bcurs, &bci.idx, "%s", bci.name);
-        if (rc == 0)
-            rc = VCursorOpen(bcurs);
-        if (rc)
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                "sequence table can not be read", "name=%s", dbname));
+    {
+        rc = get_schema_info(meta, buffer, bsz, vers);
+        KMetadataRelease(meta);
     }
-    if (rc == 0) {
-        size_t const chunk = work_chunk(count);
-        id_pair_t *const pair = malloc((sizeof(id_pair_t)+sizeof(int64_t)) * chunk);
-
-        if (pair) {
-            void *scratch = NULL;
-            
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
-            if (scratch)
-                free(scratch);
-            
-            if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-                    "Database '$(name)': failed referential "
-                    "integrity check", "name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcInconsistent)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-"Database '$(name)': column 'SEQ_SPOT_ID' failed referential integrity check",
-"name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcTooBig)
-                (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
-                         " referential integrity could not be checked, skipped",
-                         "name=%s", dbname));
-            else if (rc)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-"Database '$(name)': sequence table can not be read", "name=%s", dbname));
 
-            free(pair);
-        }
-        else
-            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
-                         " referential integrity could not be checked, skipped",
-                         "name=%s", dbname));
-    }
-    VCursorRelease(acurs);
-    VCursorRelease(bcurs);
     return rc;
 }
 
-/* referential integrity and data checks for sequence, primary and secondary alignment tables */
-static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
-                          char const dbname[],
-                          VTable const *seq,
-                          VTable const *pri,
-                          VTable const *sec)
+static rc_t sra_dbcc_454(VTable const *tbl, char const name[])
 {
-    rc_t rc = 0, rc2;
-    VCursor const *seq_cursor = NULL;
-    VCursor const *pri_cursor = NULL;
-    VCursor const *sec_cursor = NULL;
-    VCursor const *sec_cursor2 = NULL;
+    /* TODO: complete this */
+    return 0;
+}
 
-    uint32_t seq_read_len_idx;
-    uint32_t seq_cmp_read_idx;
-    uint32_t seq_pa_id_idx;
-    uint32_t pri_has_ref_offset_idx;
-    uint32_t sec_has_ref_offset_idx;
-    uint32_t sec_seq_spot_id_idx;
-    uint32_t sec_seq_read_id_idx;
-    uint32_t sec_tmp_mismatch_idx;
-    bool has_tmp_mismatch;
+typedef struct vdb_validate_params vdb_validate_params;
+struct vdb_validate_params
+{
+    const KDirectory *wd;
+    const KDBManager *kmgr;
+    const VDBManager *vmgr;
 
-    int64_t sec_id_first;
-    int64_t seq_id_first;
-    uint64_t sec_row_count;
-    uint64_t seq_row_count;
+    bool md5_chk;
+    bool md5_chk_explicit;
+    bool blob_crc;
+    bool index_chk;
+    bool consist_check;
+    bool exhaustive;
 
-    size_t chunk_size;
-    id_pair_t *pri_id_pairs = NULL;
-    id_pair_t * pri_len_pairs = NULL;
-    id_pair_t *seq_spot_id_pairs = NULL;
-    id_pair_t *seq_spot_read_id_pairs = NULL;
-    uint32_t *seq_read_lens = NULL;
+    uint32_t threads;
 
-    // SEQUENCE cursor
-    if (rc == 0)
-    {
-        rc2 = VTableCreateCursorRead(seq, &seq_cursor);
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(seq_cursor, &seq_read_len_idx, "%s", "READ_LEN");
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(seq_cursor, &seq_cmp_read_idx, "%s", "CMP_READ");
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(seq_cursor, &seq_pa_id_idx, "%s", "PRIMARY_ALIGNMENT_ID");
-        if (rc2 == 0)
-            rc2 = VCursorOpen(seq_cursor);
-        if (rc2 != 0)
-        {
-            rc = rc2;
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                        "alignment table SEQUENCE can not be read", "name=%s", dbname));
-        }
-    }
+    bool incremental;
+    const char *manifest_dir;
 
-    // PRIMARY_ALIGNMENT cursor
-    if (rc == 0)
+    // data integrity checks parameters
+    bool sdc_enabled;
+    bool sdc_sec_rows_in_percent;
+    union
     {
-        if (rc2 == 0)
-            rc2 = VTableCreateCursorRead(pri, &pri_cursor);
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(pri_cursor, &pri_has_ref_offset_idx, "%s", "(bool)HAS_REF_OFFSET");
-        if (rc2 == 0)
-            rc2 = VCursorOpen(pri_cursor);
-        if (rc2 != 0)
-        {
-            rc = rc2;
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                        "alignment table PRIMARY_ALIGNMENT can not be read", "name=%s", dbname));
-        }
-    }
+        double percent;
+        uint64_t number;
+    } sdc_sec_rows;
 
-    // SECONDARY_ALIGNMENT cursor
-    if (rc == 0)
+    bool sdc_seq_rows_in_percent;
+    union
     {
-        if (rc2 == 0)
-            rc2 = VTableCreateCursorRead(sec, &sec_cursor);
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(sec_cursor, &sec_has_ref_offset_idx, "%s", "(bool)HAS_REF_OFFSET");
-        if (rc2 == 0)
-        {
-            rc2 = VCursorAddColumn(sec_cursor, &sec_tmp_mismatch_idx, "%s", "TMP_MISMATCH");
-            if (rc2 == 0)
-                has_tmp_mismatch = true;
-            else
-            {
-                has_tmp_mismatch = false;
-                rc2 = 0;
-            }
-        }
-        if (rc2 == 0)
-            rc2 = VCursorOpen(sec_cursor);
-        if (rc2 != 0)
-        {
-            rc = rc2;
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                        "alignment table SECONDARY_ALIGNMENT can not be read", "name=%s", dbname));
-        }
-    }
-    if (rc == 0)
+        double percent;
+        uint64_t number;
+    } sdc_seq_rows;
+
+    bool sdc_pa_len_thold_in_percent;
+    union
     {
-        if (rc2 == 0)
-            rc2 = VTableCreateCursorRead(sec, &sec_cursor2);
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(sec_cursor2, &sec_seq_spot_id_idx, "%s", "SEQ_SPOT_ID");
-        if (rc2 == 0)
-            rc2 = VCursorAddColumn(sec_cursor2, &sec_seq_read_id_idx, "%s", "SEQ_READ_ID");
-        if (rc2 == 0)
-            rc2 = VCursorOpen(sec_cursor2);
-        if (rc2 != 0)
-        {
-            rc = rc2;
-            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                        "alignment table SECONDARY_ALIGNMENT can not be read", "name=%s", dbname));
-        }
-    }
+        double percent;
+        uint64_t number;
+    } sdc_pa_len_thold;
+};
 
-    // SECONDARY_ALIGNMENT row range
-    if (rc == 0)
-        rc = VCursorIdRange(sec_cursor, sec_has_ref_offset_idx, &sec_id_first, &sec_row_count);
-    if (rc != 0)
-        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-            "secondary alignment table can not be read", "name=%s", dbname));
+static rc_t tableConsistCheck(const vdb_validate_params *pb, const VTable *tbl)
+{
+    rc_t rce = 0;
 
-    // SEQUENCE row range
-    if (rc == 0)
-        rc = VCursorIdRange(seq_cursor, seq_pa_id_idx, &seq_id_first, &seq_row_count);
-    if (rc != 0)
-        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-            "sequence table can not be read", "name=%s", dbname));
+    const VCursor *curs = NULL;
 
-    if (rc == 0)
-    {
-        chunk_size = sec_row_count > SDC_ROW_CHUNK_MAX ? SDC_ROW_CHUNK_MAX : sec_row_count;
+    int64_t firstREAD_LEN = 0;
+    uint64_t countREAD_LEN = 0;
 
-        pri_id_pairs = malloc(sizeof(*pri_id_pairs) * chunk_size);
-        pri_len_pairs = malloc(sizeof(*pri_len_pairs) * chunk_size);
-        seq_spot_id_pairs = malloc(sizeof(*seq_spot_id_pairs) * chunk_size);
-        seq_spot_read_id_pairs = malloc(sizeof(*seq_spot_read_id_pairs) * chunk_size);
-        seq_read_lens = malloc(sizeof(*seq_read_lens) * chunk_size);
+    uint64_t i = 0;
 
-        if (seq_spot_id_pairs == NULL)
-        {
-            rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
-        }
-    }
+    ColumnInfo readLen;
+    ColumnInfo spotLen;
+    ColumnInfo read;
 
-    if (rc == 0)
-    {
-        bool reported_about_no_pa = false;
-        uint64_t pa_longer_sa_rows = 0;
-        uint64_t pa_longer_sa_limit;
-        uint64_t sec_row_lmit;
+    memset(&readLen, 0, sizeof readLen);
+    memset(&spotLen, 0, sizeof spotLen);
+    memset(&read   , 0, sizeof read   );
 
-        int64_t sec_row_id_start = sec_id_first;
-        int64_t sec_row_id_end;
+    assert(pb);
 
-        int64_t chunk;
+    if (!pb->consist_check) {
+        return 0;
+    }
 
-        // set limits from params
-        if (pb->sdc_pa_len_thold_in_percent)
-            pa_longer_sa_limit = ceil( pb->sdc_pa_len_thold.percent * sec_row_count );
-        else if (pb->sdc_pa_len_thold.number == 0 || pb->sdc_pa_len_thold.number > sec_row_count)
-            pa_longer_sa_limit = sec_row_count;
-        else
-            pa_longer_sa_limit = pb->sdc_pa_len_thold.number;
+    rce = VTableCreateCursorRead(tbl, &curs);
+    if (rce != 0) {
+        return rce;
+    }
+    if (rce == 0) {
+        readLen.name = "READ_LEN";
+        rce = VCursorAddColumn(curs, &readLen.idx, "%s", readLen.name);
+    }
+    if (rce == 0) {
+        spotLen.name = "SPOT_LEN";
+        rce = VCursorAddColumn(curs, &spotLen.idx, "%s", spotLen.name);
+    }
+    if (rce == 0) {
+        read.name = "READ";
+        rce = VCursorAddColumn(curs, &read.idx, "%s", read.name);
+    }
 
-        if (pb->sdc_sec_rows_in_percent)
-            sec_row_lmit = ceil( pb->sdc_sec_rows.percent * sec_row_count );
-        else if (pb->sdc_sec_rows.number == 0 || pb->sdc_sec_rows.number > sec_row_count)
-            sec_row_lmit = sec_row_count;
-        else
-            sec_row_lmit = pb->sdc_sec_rows.number;
+    if (rce == 0) {
+        assert(readLen.idx && spotLen.idx && read.idx);
+        if (readLen.idx == 0) {
+            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
+            LOGERR(klogErr, rce, "Cannot find 'READ_LEN' column");
+        }
+        else if (spotLen.idx == 0) {
+            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
+            LOGERR(klogErr, rce, "Cannot find 'SPOT_LEN' column");
+        }
+        else if (read.idx == 0) {
+            rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
+            LOGERR(klogErr, rce, "Cannot find 'READ' column");
+        }
+    }
 
-        sec_row_id_end = sec_id_first + MIN(sec_row_count, sec_row_lmit);
+    if (rce == 0) {
+        rce = VCursorOpen(curs);
+    }
+    if (rce == 0) {
+        rce =
+            VCursorIdRange(curs, readLen.idx, &firstREAD_LEN, &countREAD_LEN);
+    }
+    if (rce == 0) {
+        int64_t firstSPOT_LEN = 0;
+        uint64_t countSPOT_LEN = 0;
+        rce =
+            VCursorIdRange(curs, spotLen.idx, &firstSPOT_LEN, &countSPOT_LEN);
+        if (rce == 0) {
+            if (firstREAD_LEN != firstSPOT_LEN) {
+                rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcInvalid);
+                LOGERR(klogErr, rce, "The first ID-s "
+                    "in READ_LEN and SPOT_LEN columns do not match");
+            }
+            else if (countREAD_LEN != countSPOT_LEN) {
+                rce = RC(rcExe, rcTable, rcValidating, rcColumn, rcInvalid);
+                LOGERR(klogErr, rce, "ID ranges "
+                    "in READ_LEN and SPOT_LEN columns do not match");
+            }
+        }
+    }
 
-        for ( chunk = sec_row_id_start; chunk < sec_row_id_end; chunk += chunk_size )
-        {
-            int64_t i;
-            int64_t i_count = MIN(chunk_size, sec_row_id_end - chunk);
-            const void * data_ptr = NULL;
-            uint32_t data_len;
-            int64_t last_seq_spot_id = INT64_MIN;
-            int64_t last_pri_row_id = INT64_MIN;
-            bool ordered = true;
+    for (i = 0; i < countREAD_LEN; ++i) {
+        uint32_t n = 0;
+        uint32_t j = 0;
+        rc_t rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
+            readLen.idx, &readLen.elem_bits,
+            &readLen.value.vp, NULL, &readLen.elem_count);
+        if (rc != 0) {
+            PLOGERR(klogErr, (klogErr, rc,
+                "Cannot read 'READ_LEN' column at row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
+        rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
+            spotLen.idx, &spotLen.elem_bits,
+            &spotLen.value.vp, NULL, &spotLen.elem_count);
+        if (rc != 0) {
+            PLOGERR(klogErr, (klogErr, rc,
+                "Cannot read 'SPOT_LEN' column at row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
+        rc = VCursorCellDataDirect(curs, firstREAD_LEN + i,
+            read.idx, &read.elem_bits,
+            &read.value.vp, NULL, &read.elem_count);
+        if (rc != 0) {
+            PLOGERR(klogErr, (klogErr, rc,
+                "Cannot read 'READ' column at row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
 
-            // Load chunk of SEQ_SPOT_ID and sort ids for faster data retrieval
-            for ( i = 0; i < i_count; ++i )
-            {
-                int64_t seq_spot_id;
-                int64_t sec_row_id = i + chunk;
+        if (readLen.value.vp == NULL || spotLen.value.vp == NULL) {
+            rc = RC(rcExe, rcTable, rcValidating, rcData, rcNull);
+            PLOGERR(klogErr, (klogErr, rc,
+                "Invalid 'READ_LEN' or 'SPOT_LEN' value at row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
+        for (j = 0; j < readLen.elem_count; ++j) {
+            n += readLen.value.u32[j];
+        }
+        if (n != *(spotLen.value.u32)) {
+            rc = RC(rcExe, rcTable, rcValidating, rcData, rcCorrupt);
+            PLOGERR(klogErr, (klogErr, rc,
+                "Sum(READ_LEN) != SPOT_LEN in row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
+        if (n != read.elem_count) {
+            rc = RC(rcExe, rcTable, rcValidating, rcData, rcCorrupt);
+            PLOGERR(klogErr, (klogErr, rc,
+                "Sum(READ_LEN) != length(READ) in row $(row)",
+                "row=%ld", firstREAD_LEN + i));
+            if (rce == 0) {
+                rce = rc;
+            }
+            if (!pb->exhaustive) {
+                break;
+            }
+        }
+    }
 
-                // SECONDARY_ALIGNMENT:SEQ_SPOT_ID
-                rc = VCursorCellDataDirect ( sec_cursor2, sec_row_id, sec_seq_spot_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-                if ( rc != 0 || data_ptr == NULL || data_len != 1 )
-                {
-                    if (rc == 0)
-                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                            "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, SEQ_SPOT_ID column, row_id: $(ROW_ID)",
-                                            "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                    break;
-                }
+    if (rce == 0) {
+        LOGMSG(klogInfo, "Columns 'READ_LEN' and 'SPOT_LEN' are consistent");
+    }
 
-                seq_spot_id = *(const int64_t *)data_ptr;
-                DBG_MSG(("SECONDARY_ALIGNMENT:%ld SEQ_SPOT_ID column = %ld\n", sec_row_id, seq_spot_id));
-                if (seq_spot_id == 0)
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "SECONDARY_ALIGNMENT:$(ROW_ID) has SEQ_SPOT_ID = 0", "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                    break;
-                }
+    VCursorRelease(curs);
 
-                ordered &= last_seq_spot_id <= seq_spot_id;
-                last_seq_spot_id = seq_spot_id;
+    return rce;
+}
 
-                seq_spot_id_pairs[i].first = seq_spot_id;
-                seq_spot_id_pairs[i].second = sec_row_id;
+static rc_t sra_dbcc_fastq(const vdb_validate_params *pb,
+    const VTable *tbl, char const name[])
+{
+    static char const *const cn_FastQ[] = {
+        "READ", "QUALITY", "SPOT_LEN", "READ_START", "READ_LEN", "READ_TYPE"
+    };
 
-                // SECONDARY_ALIGNMENT:SEQ_READ_ID
-                rc = VCursorCellDataDirect ( sec_cursor2, sec_row_id, sec_seq_read_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-                if ( rc != 0 || data_ptr == NULL || data_len != 1 )
-                {
-                    if (rc == 0)
-                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, SEQ_READ_ID column, row_id: $(ROW_ID)",
-                                "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                    break;
-                }
-                DBG_MSG(("SECONDARY_ALIGNMENT:%ld SEQ_READ_ID column = %d\n", sec_row_id, *(const int32_t *)data_ptr));
+    VCursor const *curs;
+    rc_t rc = VTableCreateCursorRead(tbl, &curs);
 
-                // one-based read index
-                seq_spot_read_id_pairs[i].first = seq_spot_id;
-                seq_spot_read_id_pairs[i].second = *(const int32_t *)data_ptr;
-            }
-            if (rc != 0)
-                break;
+    if (rc == 0) {
+        unsigned const n = sizeof(cn_FastQ)/sizeof(cn_FastQ[0]);
+        ColumnInfo cols[sizeof(cn_FastQ)/sizeof(cn_FastQ[0])];
+        unsigned i;
 
-            if (!ordered)
+        memset(cols, 0, sizeof(cols));
+        for (i = 0; i < n; ++i) {
+            cols[i].name = cn_FastQ[i];
+            VCursorAddColumn(curs, &cols[i].idx, "%s", cols[i].name);
+        }
+        rc = VCursorOpen(curs);
+        if (rc == 0) {
+            rc = VCursorOpenRow(curs);
+            for (i = 0; i < n && rc == 0; ++i) {
+                VCursorCellData(curs, cols[i].idx, &cols[i].elem_bits,
+                    &cols[i].value.vp, NULL, &cols[i].elem_count);
+            }
+            if (   cols[0].idx == 0 || cols[0].elem_bits == 0
+                                                    || cols[0].value.vp == NULL
+                || cols[1].idx == 0 || cols[1].elem_bits == 0
+                                                    || cols[1].value.vp == NULL)
             {
-                sort_key_pairs(i_count, seq_spot_id_pairs);
+                rc = RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound);
             }
-
-            // Load chunk of PRIMARY_ALIGNMENT_ID (and some other fields) and sort ids for faster data retrieval
-            ordered = true;
-            for ( i = 0; i < i_count; ++i )
+            else if (cols[2].idx == 0 || cols[2].elem_bits == 0
+                                                    || cols[2].value.vp == NULL)
             {
-                int64_t pri_row_id;
-                int64_t sec_row_id = seq_spot_id_pairs[i].second;
-                int64_t seq_spot_id = seq_spot_id_pairs[i].first;
-                int32_t seq_read_id = seq_spot_read_id_pairs[sec_row_id - chunk].second;
+                (void)PLOGERR(klogWarn, (klogWarn,
+                    RC(rcExe, rcTable, rcValidating, rcColumn, rcNotFound),
+                    "Table '$(name)' is usable for fasta only; no quality data",
+                    "name=%s", name));
+            }
+        }
+        VCursorRelease(curs);
+    }
 
-                // SEQUENCE:PRIMARY_ALIGNMENT_ID
-                rc = VCursorCellDataDirect ( seq_cursor, seq_spot_id, seq_pa_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-                if ( rc != 0 || data_ptr == NULL )
-                {
-                    if (rc == 0)
-                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                            "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
-                                            "name=%s,SPOT_ID=%ld", dbname, seq_spot_id));
-                    break;
-                }
+    if (rc == 0) {
+        rc = tableConsistCheck(pb, tbl);
+    }
 
-                if ( seq_read_id < 1 || (uint32_t)seq_read_id > data_len )
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "SECONDARY_ALIGNMENT:$(SEC_ROW_ID) SEQ_READ_ID value ($(SEQ_READ_ID)) - 1 based, is out of SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT range ($(PRIMARY_ALIGNMENT_LEN))",
-                                "name=%s,SEC_ROW_ID=%ld,SEQ_READ_ID=%d,SEQ_SPOT_ID=%ld,PRIMARY_ALIGNMENT_LEN=%u", dbname, sec_row_id, seq_read_id, seq_spot_id, data_len));
-                    break;
-                }
+    if (rc) {
+        (void)PLOGERR(klogErr, (klogErr, rc,
+            "Table '$(name)' is damaged beyond any use", "name=%s", name));
+    }
 
-                pri_row_id = ((const int64_t *)data_ptr)[seq_read_id - 1];
-                DBG_MSG(("SEQUENCE:%ld PRIMARY_ALIGNMENT_ID column = %ld\n", seq_spot_id, pri_row_id));
-                if (pri_row_id == 0)
-                {
-                    if (!reported_about_no_pa)
-                    {
-                        PLOGMSG (klogWarn, (klogWarn, "Database '$(name)' has secondary alignments without primary", "name=%s", dbname));
-                        reported_about_no_pa = true;
-                    }
-                }
+    return rc;
+}
 
-                ordered &= last_pri_row_id <= pri_row_id;
-                last_pri_row_id = pri_row_id;
+static rc_t VTable_get_platform(VTable const *tbl,
+    INSDC_SRA_platform_id *rslt)
+{
+    rc_t rc;
+    VCursor const *curs;
+    INSDC_SRA_platform_id platform = -1;
 
-                pri_id_pairs[i].first = pri_row_id;
-                pri_id_pairs[i].second = sec_row_id;
+    rc = VTableCreateCursorRead(tbl, &curs);
+    if (rc == 0) {
+        uint32_t cid;
 
-                // SEQUENCE:READ_LEN
-                rc = VCursorCellDataDirect ( seq_cursor, seq_spot_id, seq_read_len_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-                if ( rc != 0 || data_ptr == NULL )
-                {
-                    if (rc == 0)
-                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, row_id: $(ROW_ID)",
-                                "name=%s,ROW_ID=%ld", dbname, seq_spot_id));
-                    break;
-                }
+        rc = VCursorAddColumn(curs, &cid, "("sra_platform_id_t")PLATFORM");
+        if (rc == 0) {
+            rc = VCursorOpen(curs);
+            if (rc == 0) {
+                uint32_t ebits;
+                void const *data;
+                uint32_t boff;
+                uint32_t ecnt;
 
-                if ( seq_read_id < 1 || (uint32_t)seq_read_id > data_len )
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "SECONDARY_ALIGNMENT:$(SEC_ROW_ID) SEQ_READ_ID value ($(SEQ_READ_ID)) - 1 based, is out of SEQUENCE:$(SEQ_SPOT_ID) READ_LEN range ($(SEQ_READ_LEN_LEN))",
-                                "name=%s,SEC_ROW_ID=%ld,SEQ_READ_ID=%d,SEQ_SPOT_ID=%ld,SEQ_READ_LEN_LEN=%u", dbname, sec_row_id, seq_read_id, seq_spot_id, data_len));
-                    break;
+                rc = VCursorCellDataDirect(curs, 1, cid,
+                    &ebits, &data, &boff, &ecnt);
+                if (rc == 0) {
+                    if (ebits == sizeof(platform) * 8 && boff == 0 && ecnt == 1)
+                        platform = ((INSDC_SRA_platform_id *)data)[0];
+                    else
+                        rc =
+                            RC(rcExe, rcTable, rcReading, rcType, rcUnexpected);
                 }
+            }
+        }
+        else
+            rc = 0;
+        VCursorRelease(curs);
+    }
+    rslt[0] = platform;
+    return rc;
+}
 
-                seq_read_lens[sec_row_id - chunk] = ((const uint32_t *)data_ptr)[seq_read_id - 1];
-                DBG_MSG(("SEQUENCE:%ld READ_LEN column = %u\n", seq_spot_id, seq_read_lens[sec_row_id - chunk]));
+static rc_t verify_table(const vdb_validate_params *pb,
+    const VTable *tbl, char const name[])
+{
+    char schemaName[1024];
+    char *schemaVers = NULL;
+    rc_t rc = 0;
+
+    get_tbl_schema_info(tbl, schemaName, sizeof(schemaName), &schemaVers);
+
+    if (schemaName[0] == '\0' || strncmp(schemaName, "NCBI:SRA:", 9) == 0) {
+        /* SRA or legacy SRA */
+        INSDC_SRA_platform_id platform;
+
+        rc = VTable_get_platform(tbl, &platform);
+        if (rc == 0) {
+            if (platform == (INSDC_SRA_platform_id)-1) {
+                (void)PLOGMSG(klogWarn, (klogWarn, "Couldn't determine "
+                    "SRA Platform; type of table '$(name)' is indeterminate.",
+                    "name=%s", name));
+            }
+            rc = sra_dbcc_fastq(pb, tbl, name);
+            if (rc == 0 && platform == SRA_PLATFORM_454) {
+                rc = sra_dbcc_454(tbl, name);
+            }
+        }
+        else {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to read table '$(name)'", "name=%s", name));
+        }
+    }
+    return rc;
+}
+
+static rc_t verify_mgr_table(const vdb_validate_params *pb, char const name[])
+{
+    rc_t rc = 0;
+
+    const VTable *tbl = NULL;
+    VSchema *sra_schema = NULL;
+
+    const VDBManager *mgr = NULL;
+
+    assert(pb);
+
+    mgr = pb->vmgr;
+
+    for ( ; ; ) {
+        rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
+        VSchemaRelease(sra_schema);
+        if (rc == 0) {
+            rc = verify_table(pb, tbl, name);
+            break;
+        }
+        else if (GetRCState(rc) == rcNotFound && GetRCObject(rc) == (enum RCObject)rcSchema
+            && sra_schema == NULL)
+        {
+            rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
+            if (rc) {
+                (void)PLOGERR(klogErr, (klogErr, rc,
+                    "Failed to open table '$(name)'", "name=%s", name));
+                break;
             }
+        }
+        else {
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Failed to open table '$(name)'", "name=%s", name));
+            break;
+        }
+    }
+
+    RELEASE(VSchema, sra_schema);
+    RELEASE(VTable, tbl);
+
+    return rc;
+}
+
+#if 0
+static rc_t verify_db_table(VDatabase const *db, char const name[])
+{
+    VTable const *tbl;
+    rc_t rc = VDatabaseOpenTableRead(db, &tbl, "%s", name);
+
+    if (rc == 0) {
+        rc = verify_table(tbl, name);
+        VTableRelease(tbl);
+    }
+    else {
+        (void)PLOGERR(klogErr, (klogErr, rc,
+            "Failed to open table '$(name)'", "name=%s", name));
+    }
+    return rc;
+}
+
+static rc_t align_dbcc_primary_alignment(VTable const *tbl, char const name[])
+{
+    VCursor const *curs;
+    rc_t rc = VTableCreateCursorRead(tbl, &curs);
+
+    if (rc == 0) {
+        static char const *const cn_SAM[] = {
+            "SEQ_NAME",
+            "SAM_FLAGS",
+            "REF_NAME",
+            "REF_POS",
+            "MAPQ",
+            "HAS_MISMATCH",
+            "HAS_REF_OFFSET",
+            "REF_OFFSET",
+            "MATE_REF_NAME",
+            "MATE_REF_POS",
+            "TEMPLATE_LEN",
+            "READ",
+            "QUALITY"
+        };
+        unsigned const n = sizeof(cn_SAM)/sizeof(cn_SAM[0]);
+        ColumnInfo cols[sizeof(cn_SAM)/sizeof(cn_SAM[0])];
+        unsigned i;
+
+        memset(cols, 0, sizeof(cols));
+        for (i = 0; i < n; ++i) {
+            cols[i].name = cn_SAM[i];
+            VCursorAddColumn(curs, &cols[i].idx, "%s", cols[i].name);
+        }
+        rc = VCursorOpen(curs);
+        if (rc == 0) {
+            rc = VCursorOpenRow(curs);
+            for (i = 0; i < n && rc == 0; ++i) {
+                VCursorCellData(curs, cols[i].idx, &cols[i].elem_bits,
+                    &cols[i].value.vp, NULL, &cols[i].elem_count);
+            }
+            for (i = 0; i < n && rc == 0; ++i) {
+                if (cols[i].idx == 0 || cols[i].elem_bits == 0) {
+                    (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(name)' "
+                        "could not be used to generate SAM", "name=%s", name));
+                    break;
+                }
+            }
+        }
+        VCursorRelease(curs);
+    }
+    if (rc) {
+        (void)PLOGERR(klogErr, (klogErr, rc,
+            "Database '$(name)' is damaged beyond any use", "name=%s", name));
+    }
+    return rc;
+}
+#endif
+
+typedef struct id_pair_s {
+    int64_t first;
+    int64_t second;
+} id_pair_t;
+
+/* the pairs that fit in the memory budget along with the buffer of their sort */
+static size_t work_chunk(uint64_t const count)
+{
+    size_t const max = memory_suggestion / (2 * sizeof(id_pair_t));
+    size_t chunk = (size_t)count;
+
+    if (chunk > max)
+        chunk = max;
+    if (chunk == 0)
+        chunk = 1;
+    return chunk;
+}
+
+static void sort_key_pairs(size_t const N, id_pair_t array[/* N */])
+{
+    id_pair_t a;
+    id_pair_t b;
+    
+#define GET(P, V) ((void)(V = ((id_pair_t const *)(P))[0]))
+#define SET(P, V) ((void)((((id_pair_t *)(P))[0]) = V))
+#define CMP(A, B) (((GET(A, a)),(GET(B, b))), (a.first  < b.first  ? -1 :      \
+                                               b.first  < a.first  ?  1 :      \
+                                               a.second < b.second ? -1 :      \
+                                               b.second < a.second ?  1 : 0))
+#define SWAP(A, B, C, D) do{GET(A, a); GET(B, b); SET(A, b); SET(B, a);}while(0)
+    KSORT(array, N, sizeof(array[0]), 0, 0);
+#undef SWAP
+#undef CMP
+#undef SET
+#undef GET
+}
+
+static void sort_keys(size_t const N, int64_t array[/* N */])
+{
+#define INDEXOF(A) (((int64_t const *)(A)) - ((int64_t const *)(&array[0])))
+#define CMP(A, B) (array[INDEXOF(A)] - array[INDEXOF(B)])
+#define SWAP(A, B, C, D) do {                                                  \
+    int64_t const a = array[INDEXOF(A)];                                       \
+    int64_t const b = array[INDEXOF(B)];                                       \
+    array[INDEXOF(A)] = b;                                                     \
+    array[INDEXOF(B)] = a; } while(0)
+    KSORT(array, N, sizeof(array[0]), 0, 0);
+#undef SWAP
+#undef CMP
+#undef INDEXOF
+}
+
+#define RADIX_KEY(P) ((uint64_t)(P).first ^ ((uint64_t)1 << 63))
+
+/* Stable LSD radix sort of the pairs by key, a byte at a time; the bytes that
+ * are the same in every key are skipped.  Pairs of the same key keep their
+ * order, which is row order as loaded.  Returns the array holding the result:
+ * pair or aux.
+ */
+static id_pair_t *radix_sort_key_pairs(size_t const N,
+                                       id_pair_t pair[/* N */],
+                                       id_pair_t aux[/* N */])
+{
+    size_t count[8][256];
+    id_pair_t *src = pair;
+    id_pair_t *dst = aux;
+    size_t i;
+    unsigned d;
+
+    if (N == 0)
+        return pair;
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < N; ++i) {
+        uint64_t const key = RADIX_KEY(pair[i]);
+
+        for (d = 0; d < 8; ++d)
+            ++count[d][(key >> (8 * d)) & 0xFF];
+    }
+    for (d = 0; d < 8; ++d) {
+        size_t *const pos = count[d];
+        size_t sum = 0;
+        unsigned b;
+
+        if (pos[(RADIX_KEY(pair[0]) >> (8 * d)) & 0xFF] == N)
+            continue;
+
+        for (b = 0; b < 256; ++b) {
+            size_t const n = pos[b];
+
+            pos[b] = sum;
+            sum += n;
+        }
+        for (i = 0; i < N; ++i)
+            dst[pos[(RADIX_KEY(src[i]) >> (8 * d)) & 0xFF]++] = src[i];
+        {
+            id_pair_t *const tmp = src;
+
+            src = dst;
+            dst = tmp;
+        }
+    }
+    return src;
+}
+
+#undef RADIX_KEY
+
+#define CHECK_QUITTING do { rc_t const rc = Quitting(); if (rc) return rc; } while(0);
+
+/* Loads ( foreign key, row ) of the rows from startId on, sorted by key then
+ * by row, stopping at endId, when pair is full or at a page boundary when the
+ * next page would not fit.  *pnext is the first row not loaded, *psorted the
+ * array holding the pairs: pair or aux.
+ */
+static size_t load_key_pairs(int64_t const startId,
+                             int64_t const endId,
+                             size_t const pairs,
+                             id_pair_t pair[/* pairs */],
+                             id_pair_t aux[/* pairs */],
+                             VCursor const *const acurs,
+                             ColumnInfo *const aci,
+                             int64_t pnext[],
+                             id_pair_t *psorted[],
+                             rc_t Rc[])
+{
+    int64_t last_fkey = INT64_MIN;
+    int64_t row = startId;
+    size_t j = 0;
+    bool ordered = true;
+    
+    psorted[0] = pair;
+    while (row < endId && j < pairs) {
+        int64_t first;
+        int64_t maybe_last;
+        rc_t const rc1 = VCursorPageIdRange(acurs, aci->idx, row, &first, &maybe_last);
+        int64_t const last = maybe_last < endId ? maybe_last : endId - 1;
+
+        if (rc1) {
+            Rc[0] = rc1;
+            return 0;
+        }
+        if (last < row) {
+            /* the page would not move on */
+            Rc[0] = RC(rcExe, rcDatabase, rcValidating, rcData, rcUnexpected);
+            return 0;
+        }
+        Rc[0] = Quitting();
+        if (Rc[0])
+            return 0;
+        
+        if (j > 0 && (uint64_t)(last + 1 - row) > pairs - j)
+            break;
+        
+        for ( ; j < pairs && row <= last; ++row) {
+            rc_t const rc = VCursorCellDataDirect(acurs, row, aci->idx,
+                                                  &aci->elem_bits, &aci->value.vp,
+                                                  NULL, &aci->elem_count);
+            if (rc == 0) {
+                if (aci->elem_count == 1) {
+                    int64_t const fkey = aci->value.i64[0];
+                    
+                    ordered &= (last_fkey <= fkey);
+                    pair[j].second = row;
+                    pair[j].first = fkey;
+                    last_fkey = fkey;
+                    ++j;
+                }
+                else {
+                    Rc[0] = RC(rcExe, rcDatabase, rcValidating, rcData, rcUnexpected);
+                    return 0;
+                }
+            }
+            else if (!(GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound)) {
+                Rc[0] = rc;
+                return 0;
+            }
+            /* row not found might be an error but that won't be decided here */
+        }
+    }
+    pnext[0] = row;
+    if (!ordered)
+        psorted[0] = radix_sort_key_pairs(j, pair, aux);
+    
+    Rc[0] = 0;
+    return j;
+}
+
+static bool is_sorted(uint32_t const N, int64_t const key[/* N */])
+{
+    uint32_t i = 0;
+    int64_t last = key[i];
+    
+    for (i = 1; i < N; ++i) {
+        int64_t const cur = key[i];
+        
+        if (cur < last)
+            return false;
+
+        last = cur;
+    }
+    return true;
+}
+
+/* checks ( foreign key, row ) pairs in key order against the id lists of the
+   other table, which is thereby read once, front to back */
+typedef struct ric_join_s {
+    VCursor const *bcurs;
+    ColumnInfo const *aci;
+    ColumnInfo const *bci;
+    int64_t const *id;
+    void *scratch;
+    size_t scratch_size;
+    int64_t cur_fkey;
+    uint32_t elem_count;
+    uint32_t current;
+    bool started;
+} ric_join_t;
+
+static rc_t ric_join(ric_join_t *const self, id_pair_t const *const pair)
+{
+    int64_t const fkey = pair->first;
+    int64_t const row = pair->second;
+
+    if (!self->started || self->cur_fkey != fkey) {
+        uint32_t dummy;
+        rc_t rc;
+
+        CHECK_QUITTING;
+
+        rc = VCursorCellDataDirect(self->bcurs, fkey, self->bci->idx,
+                                   &dummy, (void const **)&self->id,
+                                   NULL, &self->elem_count);
+
+        if (GetRCObject(rc) == rcRow && GetRCState(rc) == rcNotFound){
+            (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
+                             "$(aname) <-> $(bname)"
+                             " failed to retrieve pair $(first) -> $(second)",
+                             "aname=%s,bname=%s,first=%ld,second=%ld",
+                             self->aci->name, self->bci->name,
+                             pair->first, pair->second));
+
+            return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+        } else if (rc) 
+            return rc;
+
+        if (!is_sorted(self->elem_count, self->id)) {
+            if (self->scratch_size < self->elem_count) {
+                void *const temp = realloc(self->scratch,
+                    self->elem_count * sizeof(self->id[0]));
+
+                if (temp == NULL)
+                    return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+                self->scratch = temp;
+                self->scratch_size = self->elem_count;
+            }
+            memmove(self->scratch, self->id, self->elem_count * sizeof(self->id[0]));
+            sort_keys(self->elem_count, self->scratch);
+            self->id = self->scratch;
+        }
+        self->current = 0;
+        self->cur_fkey = fkey;
+        self->started = true;
+        while (self->current < self->elem_count && self->id[self->current] < row) {
+            ++self->current;
+        }
+    }
+    if (self->current >= self->elem_count || self->id[self->current] != row){
+        (void)PLOGMSG(klogWarn, (klogWarn, "Referential Integrity: "
+                         "$(aname) <-> $(bname)"
+                         " inconsistens pair $(first) -> $(second)",
+                         "aname=%s,bname=%s,first=%ld,second=%ld",
+                         self->aci->name, self->bci->name,
+                         pair->first, pair->second));
+
+        return RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+    }
+    ++self->current;
+    return 0;
+}
+
+/* a sorted run of pairs spilled to a scratch file */
+typedef struct ric_run_s {
+    KFile *file;
+    char *path; /* not NULL: to be removed when the run is closed */
+    id_pair_t *buf;
+    id_pair_t *wbuf; /* pairs appended but not written yet */
+    size_t wn;
+    uint64_t size; /* pairs written to the file */
+    uint64_t next; /* pair read next */
+    uint64_t left; /* pairs still in the file */
+    size_t pos;
+    size_t n;
+    unsigned level; /* 0: written from memory, else merged from runs of level - 1 */
+} ric_run_t;
+
+/* the most runs merged at once: each of them holds a scratch file open */
+#define RIC_MAX_FANIN 64
+
+/* pairs a run being written holds back */
+#define RIC_WRITE_BUF 4096
+
+#define RIC_SCRATCH_RC RC(rcExe, rcFile, rcWriting, rcStorage, rcExhausted)
+
+/* a new file in scratch_dir named after the process and the thread;
+   it is removed right away where an open file can be removed */
+static rc_t ric_run_make(ric_run_t *const run, unsigned const level)
+{
+    static THREAD_LOCAL unsigned generation = 0;
+    KDirectory *dir = NULL;
+    uint32_t pid = 0;
+    char path[4096];
+    unsigned i;
+    rc_t rc;
+
+    memset(run, 0, sizeof(*run));
+    run->level = level;
+
+    {
+        KProcMgr *proc_mgr = NULL;
+
+        if (KProcMgrMakeSingleton(&proc_mgr) == 0) {
+            KProcMgrGetPID(proc_mgr, &pid);
+            KProcMgrRelease(proc_mgr);
+        }
+    }
+    rc = KDirectoryNativeDir(&dir);
+    /* the generation is per thread: another thread can have taken the name */
+    for (i = 0; rc == 0 && i < 1000; ++i) {
+        unsigned const g = generation++;
+
+        snprintf(path, sizeof(path), "%s/vdb-validate.%u.%p.%u.tmp",
+                 scratch_dir, pid, (void *)&generation, g);
+        rc = KDirectoryCreateFile(dir, &run->file, true, 0600, kcmCreate,
+                                  "%s", path);
+        if (GetRCState(rc) == rcExists)
+            rc = 0;
+        else
+            break;
+    }
+    if (rc == 0 && run->file == NULL)
+        rc = RC(rcExe, rcFile, rcCreating, rcFile, rcExists);
+    if (rc == 0 && KDirectoryRemove(dir, false, "%s", path) != 0) {
+        run->path = string_dup_measure(path, NULL);
+        if (run->path == NULL) {
+            KFileRelease(run->file);
+            run->file = NULL;
+            KDirectoryRemove(dir, false, "%s", path);
+            rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+        }
+    }
+    KDirectoryRelease(dir);
+    if (rc) {
+        (void)PLOGERR(klogErr, (klogErr, rc, "cannot create a scratch file "
+            "in '$(dir)'", "dir=%s", scratch_dir));
+        return RIC_SCRATCH_RC;
+    }
+    return 0;
+}
+
+static rc_t ric_run_write_file(ric_run_t *const run,
+                               id_pair_t const pair[], size_t const n)
+{
+    size_t const bytes = n * sizeof(pair[0]);
+    size_t num_writ = 0;
+    rc_t const rc = KFileWriteAll(run->file, run->size * sizeof(pair[0]),
+                                  pair, bytes, &num_writ);
+
+    if (rc || num_writ != bytes)
+        return RIC_SCRATCH_RC;
+    run->size += n;
+    return 0;
+}
+
+static rc_t ric_run_flush(ric_run_t *const run)
+{
+    rc_t rc = 0;
+
+    if (run->wn > 0)
+        rc = ric_run_write_file(run, run->wbuf, run->wn);
+    run->wn = 0;
+    return rc;
+}
+
+static rc_t ric_run_append(ric_run_t *const run,
+                           id_pair_t const pair[], size_t const n)
+{
+    rc_t rc = 0;
+
+    if (n >= RIC_WRITE_BUF) {
+        rc = ric_run_flush(run);
+        if (rc == 0)
+            rc = ric_run_write_file(run, pair, n);
+    }
+    else {
+        if (run->wbuf == NULL) {
+            run->wbuf = malloc(RIC_WRITE_BUF * sizeof(run->wbuf[0]));
+            if (run->wbuf == NULL)
+                return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+        }
+        if (run->wn + n > RIC_WRITE_BUF)
+            rc = ric_run_flush(run);
+        if (rc == 0) {
+            memmove(&run->wbuf[run->wn], pair, n * sizeof(pair[0]));
+            run->wn += n;
+        }
+    }
+    if (rc == 0)
+        run->left += n;
+    return rc;
+}
+
+/* the run is read from its start */
+static rc_t ric_run_rewind(ric_run_t *const run)
+{
+    rc_t const rc = ric_run_flush(run);
+
+    free(run->wbuf);
+    run->wbuf = NULL;
+    run->next = 0;
+    return rc;
+}
+
+static void ric_run_close(ric_run_t *const run)
+{
+    KFileRelease(run->file);
+    run->file = NULL;
+    if (run->path != NULL) {
+        KDirectory *dir = NULL;
+
+        if (KDirectoryNativeDir(&dir) == 0) {
+            KDirectoryRemove(dir, false, "%s", run->path);
+            KDirectoryRelease(dir);
+        }
+        free(run->path);
+        run->path = NULL;
+    }
+    free(run->wbuf);
+    run->wbuf = NULL;
+}
+
+static rc_t ric_run_write(ric_run_t *const run,
+                          id_pair_t const pair[], size_t const n)
+{
+    rc_t rc = ric_run_make(run, 0);
+
+    if (rc == 0)
+        rc = ric_run_append(run, pair, n);
+    if (rc == 0)
+        rc = ric_run_rewind(run);
+    return rc;
+}
+
+/* refills the buffer of the run; false at its end */
+static bool ric_run_fill(ric_run_t *const run, size_t const bufsize,
+                         rc_t *const rc)
+{
+    size_t const n = run->left < bufsize ? (size_t)run->left : bufsize;
+
+    if (n == 0)
+        return false;
+    {
+        size_t const bytes = n * sizeof(run->buf[0]);
+        size_t num_read = 0;
+
+        if (KFileReadAll(run->file, run->next * sizeof(run->buf[0]),
+                         run->buf, bytes, &num_read) != 0 || num_read != bytes)
+        {
+            *rc = RIC_SCRATCH_RC;
+            return false;
+        }
+    }
+    run->next += n;
+    run->left -= n;
+    run->pos = 0;
+    run->n = n;
+    return true;
+}
+
+static bool ric_run_less(ric_run_t const *const a, ric_run_t const *const b)
+{
+    id_pair_t const *const x = &a->buf[a->pos];
+    id_pair_t const *const y = &b->buf[b->pos];
+
+    return x->first < y->first || (x->first == y->first && x->second < y->second);
+}
+
+static void ric_heap_down(ric_run_t *heap[], unsigned const n, unsigned i)
+{
+    for ( ; ; ) {
+        unsigned const l = 2 * i + 1;
+        unsigned const r = l + 1;
+        unsigned m = i;
+
+        if (l < n && ric_run_less(heap[l], heap[m]))
+            m = l;
+        if (r < n && ric_run_less(heap[r], heap[m]))
+            m = r;
+        if (m == i)
+            break;
+        {
+            ric_run_t *const tmp = heap[i];
+
+            heap[i] = heap[m];
+            heap[m] = tmp;
+        }
+        i = m;
+    }
+}
+
+/* merges at most RIC_MAX_FANIN runs, the budget shared by their buffers:
+   into the join, or into the run out */
+static rc_t ric_merge(ric_run_t run[], unsigned const runs,
+                      id_pair_t buf[], size_t const bufsize,
+                      ric_join_t *const join, ric_run_t *const out,
+                      uint64_t const count)
+{
+    size_t per_run = bufsize / runs;
+    id_pair_t *own = NULL;
+    ric_run_t *heap[RIC_MAX_FANIN];
+    unsigned n = 0;
+    unsigned i;
+    uint64_t done = 0;
+    uint64_t const step = bufsize / 2;
+    uint64_t report = step;
+    rc_t rc = 0;
+
+    assert(runs <= RIC_MAX_FANIN);
+    if (per_run == 0) {
+        /* more runs than the budget has pairs */
+        per_run = 1;
+        buf = own = malloc(runs * sizeof(buf[0]));
+        if (buf == NULL)
+            return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+    }
+    for (i = 0; i < runs && rc == 0; ++i) {
+        run[i].buf = &buf[i * per_run];
+        if (ric_run_fill(&run[i], per_run, &rc))
+            heap[n++] = &run[i];
+    }
+    for (i = n / 2; i-- > 0; )
+        ric_heap_down(heap, n, i);
+
+    while (rc == 0 && n > 0) {
+        ric_run_t *const top = heap[0];
+        id_pair_t const *const pair = &top->buf[top->pos++];
+
+        rc = out != NULL ? ric_run_append(out, pair, 1) : ric_join(join, pair);
+        if (rc)
+            break;
+        if (top->pos == top->n && !ric_run_fill(top, per_run, &rc)) {
+            if (rc)
+                break;
+            heap[0] = heap[--n];
+        }
+        ric_heap_down(heap, n, 0);
+
+        if (out == NULL && ++done == report && done < count) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
+                                     "$(aname) <-> $(bname)"
+                                     " $(pct)% complete",
+                                     "aname=%s,bname=%s,pct=%5.1f",
+                                     join->aci->name, join->bci->name,
+                                     (100.0 * done) / count));
+            report += step;
+        }
+    }
+    if (rc == 0 && out != NULL)
+        rc = ric_run_rewind(out);
+    free(own);
+    return rc;
+}
+
+/* merges the runs from first on into one run, which takes their place */
+static rc_t ric_merge_runs(ric_run_t run[], unsigned *const runs,
+                           unsigned const first,
+                           id_pair_t buf[], size_t const bufsize)
+{
+    ric_run_t merged;
+    unsigned i;
+    rc_t rc = ric_run_make(&merged, run[first].level + 1);
+
+    if (rc == 0)
+        rc = ric_merge(&run[first], *runs - first, buf, bufsize,
+                       NULL, &merged, 0);
+    for (i = first; i < *runs; ++i)
+        ric_run_close(&run[i]);
+    if (rc) {
+        ric_run_close(&merged);
+        *runs = first;
+        return rc;
+    }
+    run[first] = merged;
+    *runs = first + 1;
+    return 0;
+}
+
+/* Checks that the foreign key column of table a and the id list column of
+ * table b refer to each other.  The ( key, row ) pairs of a are loaded in one
+ * pass over a; if they do not fit in the memory budget they are spilled to
+ * scratch files in sorted runs, which are merged.  Either way b is read once
+ * in key order.
+ */
+static rc_t ric_align_generic(int64_t const startId,
+                              uint64_t const count,
+                              VCursor const *const acurs,
+                              ColumnInfo *const aci,
+                              VCursor const *const bcurs,
+                              ColumnInfo *const bci
+                              )
+{
+    int64_t const endId = startId + count;
+    size_t const pairs = work_chunk(count);
+    id_pair_t *const pair = malloc(2 * pairs * sizeof(pair[0]));
+    ric_run_t *run = NULL;
+    unsigned runs = 0;
+    unsigned max_runs = 0;
+    int64_t row = startId;
+    ric_join_t join;
+    rc_t rc = 0;
+
+    if (pair == NULL)
+        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+    memset(&join, 0, sizeof(join));
+    join.bcurs = bcurs;
+    join.aci = aci;
+    join.bci = bci;
+
+    while (rc == 0 && row < endId) {
+        id_pair_t *sorted = pair;
+        int64_t const from = row;
+        size_t const n = load_key_pairs(row, endId, pairs, pair, &pair[pairs],
+                                        acurs, aci, &row, &sorted, &rc);
+        size_t i;
+
+        if (rc)
+            break;
+        if (row <= from) {
+            /* nothing was loaded and the next row would be the same again */
+            rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcUnexpected);
+            break;
+        }
+        if (runs == 0 && row >= endId) {
+            /* all of it fits in memory */
+            for (i = 0; i < n && rc == 0; ++i)
+                rc = ric_join(&join, &sorted[i]);
+            break;
+        }
+        if (n == 0)
+            continue;
+        if (runs == max_runs) {
+            unsigned const max = max_runs ? max_runs * 2 : 16;
+            void *const temp = realloc(run, max * sizeof(run[0]));
+
+            if (temp == NULL) {
+                rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+                break;
+            }
+            run = temp;
+            max_runs = max;
+        }
+        rc = ric_run_write(&run[runs++], sorted, n);
+
+        /* the levels of the runs do not increase: RIC_MAX_FANIN runs of the
+           lowest one are merged into one of the next, their pairs are free */
+        while (rc == 0 && runs >= RIC_MAX_FANIN
+               && run[runs - RIC_MAX_FANIN].level == run[runs - 1].level)
+        {
+            rc = ric_merge_runs(run, &runs, runs - RIC_MAX_FANIN,
+                                pair, 2 * pairs);
+        }
+        if (rc == 0) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Referential Integrity: "
+                                     "$(aname) <-> $(bname)"
+                                     " $(pct)% sorted",
+                                     "aname=%s,bname=%s,pct=%5.1f",
+                                     aci->name, bci->name,
+                                     (100.0 * (row - startId)) / count));
+        }
+    }
+    /* the runs of the lowest levels until the rest can be merged at once */
+    while (rc == 0 && runs > RIC_MAX_FANIN)
+        rc = ric_merge_runs(run, &runs, runs - RIC_MAX_FANIN, pair, 2 * pairs);
+    if (rc == 0 && runs > 0)
+        rc = ric_merge(run, runs, pair, 2 * pairs, &join, NULL, count);
+
+    if (rc == RIC_SCRATCH_RC) {
+        /* the check can not be completed: it fails */
+        (void)PLOGERR(klogErr, (klogErr, rc, "Referential Integrity: "
+                                "$(aname) <-> $(bname)"
+                                " scratch file can not be written",
+                                "aname=%s,bname=%s", aci->name, bci->name));
+        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcIncomplete);
+    }
+
+    while (runs > 0)
+        ric_run_close(&run[--runs]);
+    free(run);
+    free(join.scratch);
+    free(pair);
+    return rc;
+}
+
+#undef RIC_SCRATCH_RC
+
+static rc_t ric_align_ref_and_align(char const dbname[],
+                                    VTable const *ref,
+                                    VTable const *align,
+                                    int which)
+{
+    char const *const id_col_name = which == 0 ? "PRIMARY_ALIGNMENT_IDS"
+                                  : which == 1 ? "SECONDARY_ALIGNMENT_IDS"
+                                  : which == 2 ? "EVIDENCE_ALIGNMENT_IDS"
+                                  : NULL;
+    rc_t rc;
+    VCursor const *acurs = NULL;
+    VCursor const *bcurs = NULL;
+    ColumnInfo aci;
+    ColumnInfo bci;
+    int64_t startId;
+    uint64_t count;
+
+    aci.name = "REF_ID";
+    bci.name = id_col_name;
+    
+    rc = VTableCreateCursorRead(align, &acurs);
+    if (rc == 0) {
+        rc = VCursorAddColumn(acurs, &aci.idx, "%s", aci.name);
+        if (rc == 0)
+            rc = VCursorOpen(acurs);
+        if (rc == 0)
+            rc = VCursorIdRange(acurs, aci.idx, &startId, &count);
+    }
+    if (rc)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+            "alignment table can not be read", "name=%s", dbname));
+    else {
+        rc = VTableCreateCursorRead(ref, &bcurs);
+        if (rc == 0)
+            rc = VCursorAddColumn(bcurs, &bci.idx, "%s", bci.name);
+        if (rc == 0)
+            rc = VCursorOpen(bcurs);
+        if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                "reference table can not be read", "name=%s", dbname));
+    }
+    if (rc == 0) {
+        rc = ric_align_generic(startId, count, acurs, &aci, bcurs, &bci);
+
+        if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Database '$(name)': failed referential "
+                "integrity check", "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcInconsistent)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+ "Database '$(name)': column '$(idcol)' failed referential integrity check",
+ "name=%s,idcol=%s", dbname, id_col_name));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcIncomplete)
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                "referential integrity could not be checked", "name=%s", dbname));
+        else if ((GetRCObject(rc) == (enum RCObject)rcData &&
+                  GetRCState(rc) == rcTooBig) ||
+                 (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted))
+            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
+                     " referential integrity could not be checked, skipped",
+                     "name=%s", dbname));
+        else if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+"Database '$(name)': reference table can not be read", "name=%s", dbname));
+    }
+    VCursorRelease(acurs);
+    VCursorRelease(bcurs);
+    return rc;
+}
+
+static rc_t ric_align_seq_and_pri(char const dbname[],
+                                  VTable const *seq,
+                                  VTable const *pri)
+{
+    rc_t rc;
+    VCursor const *acurs = NULL;
+    VCursor const *bcurs = NULL;
+    ColumnInfo aci;
+    ColumnInfo bci;
+    int64_t startId;
+    uint64_t count;
+
+    aci.name = "SEQ_SPOT_ID";
+    bci.name = "PRIMARY_ALIGNMENT_ID";
+    
+    rc = VTableCreateCursorRead(pri, &acurs);
+    if (rc == 0)
+        rc = VCursorAddColumn(acurs, &aci.idx, "%s", aci.name);
+    if (rc == 0)
+        rc = VCursorOpen(acurs);
+    if (rc == 0)
+        rc = VCursorIdRange(acurs, aci.idx, &startId, &count);
+    if (rc)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+            "alignment table can not be read", "name=%s", dbname));
+    else {
+        rc = VTableCreateCursorRead(seq, &bcurs);
+        if (rc == 0)
+            rc = VCursorAddColumn(bcurs, &bci.idx, "%s", bci.name);
+        if (rc == 0)
+            rc = VCursorOpen(bcurs);
+        if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                "sequence table can not be read", "name=%s", dbname));
+    }
+    if (rc == 0) {
+        rc = ric_align_generic(startId, count, acurs, &aci, bcurs, &bci);
+
+        if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Database '$(name)': failed referential "
+                "integrity check", "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcInconsistent)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+"Database '$(name)': column 'SEQ_SPOT_ID' failed referential integrity check",
+"name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcIncomplete)
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                "referential integrity could not be checked", "name=%s", dbname));
+        else if ((GetRCObject(rc) == (enum RCObject)rcData &&
+                  GetRCState(rc) == rcTooBig) ||
+                 (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted))
+            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
+                     " referential integrity could not be checked, skipped",
+                     "name=%s", dbname));
+        else if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+"Database '$(name)': sequence table can not be read", "name=%s", dbname));
+    }
+    VCursorRelease(acurs);
+    VCursorRelease(bcurs);
+    return rc;
+}
+
+/* referential integrity and data checks for sequence, primary and secondary alignment tables */
+static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
+                          char const dbname[],
+                          VTable const *seq,
+                          VTable const *pri,
+                          VTable const *sec)
+{
+    rc_t rc = 0, rc2;
+    VCursor const *seq_cursor = NULL;
+    VCursor const *pri_cursor = NULL;
+    VCursor const *sec_cursor = NULL;
+    VCursor const *sec_cursor2 = NULL;
+
+    uint32_t seq_read_len_idx;
+    uint32_t seq_cmp_read_idx;
+    uint32_t seq_pa_id_idx;
+    uint32_t pri_has_ref_offset_idx;
+    uint32_t sec_has_ref_offset_idx;
+    uint32_t sec_seq_spot_id_idx;
+    uint32_t sec_seq_read_id_idx;
+    uint32_t sec_tmp_mismatch_idx;
+    bool has_tmp_mismatch;
+
+    int64_t sec_id_first;
+    int64_t seq_id_first;
+    uint64_t sec_row_count;
+    uint64_t seq_row_count;
+
+    size_t chunk_size;
+    id_pair_t *pri_id_pairs = NULL;
+    id_pair_t * pri_len_pairs = NULL;
+    id_pair_t *seq_spot_id_pairs = NULL;
+    id_pair_t *seq_spot_read_id_pairs = NULL;
+    uint32_t *seq_read_lens = NULL;
+
+    // SEQUENCE cursor
+    if (rc == 0)
+    {
+        rc2 = VTableCreateCursorRead(seq, &seq_cursor);
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(seq_cursor, &seq_read_len_idx, "%s", "READ_LEN");
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(seq_cursor, &seq_cmp_read_idx, "%s", "CMP_READ");
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(seq_cursor, &seq_pa_id_idx, "%s", "PRIMARY_ALIGNMENT_ID");
+        if (rc2 == 0)
+            rc2 = VCursorOpen(seq_cursor);
+        if (rc2 != 0)
+        {
+            rc = rc2;
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "alignment table SEQUENCE can not be read", "name=%s", dbname));
+        }
+    }
+
+    // PRIMARY_ALIGNMENT cursor
+    if (rc == 0)
+    {
+        if (rc2 == 0)
+            rc2 = VTableCreateCursorRead(pri, &pri_cursor);
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(pri_cursor, &pri_has_ref_offset_idx, "%s", "(bool)HAS_REF_OFFSET");
+        if (rc2 == 0)
+            rc2 = VCursorOpen(pri_cursor);
+        if (rc2 != 0)
+        {
+            rc = rc2;
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "alignment table PRIMARY_ALIGNMENT can not be read", "name=%s", dbname));
+        }
+    }
+
+    // SECONDARY_ALIGNMENT cursor
+    if (rc == 0)
+    {
+        if (rc2 == 0)
+            rc2 = VTableCreateCursorRead(sec, &sec_cursor);
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(sec_cursor, &sec_has_ref_offset_idx, "%s", "(bool)HAS_REF_OFFSET");
+        if (rc2 == 0)
+        {
+            rc2 = VCursorAddColumn(sec_cursor, &sec_tmp_mismatch_idx, "%s", "TMP_MISMATCH");
+            if (rc2 == 0)
+                has_tmp_mismatch = true;
+            else
+            {
+                has_tmp_mismatch = false;
+                rc2 = 0;
+            }
+        }
+        if (rc2 == 0)
+            rc2 = VCursorOpen(sec_cursor);
+        if (rc2 != 0)
+        {
+            rc = rc2;
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "alignment table SECONDARY_ALIGNMENT can not be read", "name=%s", dbname));
+        }
+    }
+    if (rc == 0)
+    {
+        if (rc2 == 0)
+            rc2 = VTableCreateCursorRead(sec, &sec_cursor2);
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(sec_cursor2, &sec_seq_spot_id_idx, "%s", "SEQ_SPOT_ID");
+        if (rc2 == 0)
+            rc2 = VCursorAddColumn(sec_cursor2, &sec_seq_read_id_idx, "%s", "SEQ_READ_ID");
+        if (rc2 == 0)
+            rc2 = VCursorOpen(sec_cursor2);
+        if (rc2 != 0)
+        {
+            rc = rc2;
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "alignment table SECONDARY_ALIGNMENT can not be read", "name=%s", dbname));
+        }
+    }
+
+    // SECONDARY_ALIGNMENT row range
+    if (rc == 0)
+        rc = VCursorIdRange(sec_cursor, sec_has_ref_offset_idx, &sec_id_first, &sec_row_count);
+    if (rc != 0)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+            "secondary alignment table can not be read", "name=%s", dbname));
+
+    // SEQUENCE row range
+    if (rc == 0)
+        rc = VCursorIdRange(seq_cursor, seq_pa_id_idx, &seq_id_first, &seq_row_count);
+    if (rc != 0)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+            "sequence table can not be read", "name=%s", dbname));
+
+    if (rc == 0)
+    {
+        chunk_size = sec_row_count > SDC_ROW_CHUNK_MAX ? SDC_ROW_CHUNK_MAX : sec_row_count;
+
+        pri_id_pairs = malloc(sizeof(*pri_id_pairs) * chunk_size);
+        pri_len_pairs = malloc(sizeof(*pri_len_pairs) * chunk_size);
+        seq_spot_id_pairs = malloc(sizeof(*seq_spot_id_pairs) * chunk_size);
+        seq_spot_read_id_pairs = malloc(sizeof(*seq_spot_read_id_pairs) * chunk_size);
+        seq_read_lens = malloc(sizeof(*seq_read_lens) * chunk_size);
+
+        if (seq_spot_id_pairs == NULL)
+        {
+            rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+        }
+    }
+
+    if (rc == 0)
+    {
+        bool reported_about_no_pa = false;
+        uint64_t pa_longer_sa_rows = 0;
+        uint64_t pa_longer_sa_limit;
+        uint64_t sec_row_lmit;
+
+        int64_t sec_row_id_start = sec_id_first;
+        int64_t sec_row_id_end;
+
+        int64_t chunk;
+
+        // set limits from params
+        if (pb->sdc_pa_len_thold_in_percent)
+            pa_longer_sa_limit = ceil( pb->sdc_pa_len_thold.percent * sec_row_count );
+        else if (pb->sdc_pa_len_thold.number == 0 || pb->sdc_pa_len_thold.number > sec_row_count)
+            pa_longer_sa_limit = sec_row_count;
+        else
+            pa_longer_sa_limit = pb->sdc_pa_len_thold.number;
+
+        if (pb->sdc_sec_rows_in_percent)
+            sec_row_lmit = ceil( pb->sdc_sec_rows.percent * sec_row_count );
+        else if (pb->sdc_sec_rows.number == 0 || pb->sdc_sec_rows.number > sec_row_count)
+            sec_row_lmit = sec_row_count;
+        else
+            sec_row_lmit = pb->sdc_sec_rows.number;
+
+        sec_row_id_end = sec_id_first + MIN(sec_row_count, sec_row_lmit);
+
+        for ( chunk = sec_row_id_start; chunk < sec_row_id_end; chunk += chunk_size )
+        {
+            int64_t i;
+            int64_t i_count = MIN(chunk_size, sec_row_id_end - chunk);
+            const void * data_ptr = NULL;
+            uint32_t data_len;
+            int64_t last_seq_spot_id = INT64_MIN;
+            int64_t last_pri_row_id = INT64_MIN;
+            bool ordered = true;
+
+            // Load chunk of SEQ_SPOT_ID and sort ids for faster data retrieval
+            for ( i = 0; i < i_count; ++i )
+            {
+                int64_t seq_spot_id;
+                int64_t sec_row_id = i + chunk;
+
+                // SECONDARY_ALIGNMENT:SEQ_SPOT_ID
+                rc = VCursorCellDataDirect ( sec_cursor2, sec_row_id, sec_seq_spot_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+                if ( rc != 0 || data_ptr == NULL || data_len != 1 )
+                {
+                    if (rc == 0)
+                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                            "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, SEQ_SPOT_ID column, row_id: $(ROW_ID)",
+                                            "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                    break;
+                }
+
+                seq_spot_id = *(const int64_t *)data_ptr;
+                DBG_MSG(("SECONDARY_ALIGNMENT:%ld SEQ_SPOT_ID column = %ld\n", sec_row_id, seq_spot_id));
+                if (seq_spot_id == 0)
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "SECONDARY_ALIGNMENT:$(ROW_ID) has SEQ_SPOT_ID = 0", "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                    break;
+                }
+
+                ordered &= last_seq_spot_id <= seq_spot_id;
+                last_seq_spot_id = seq_spot_id;
+
+                seq_spot_id_pairs[i].first = seq_spot_id;
+                seq_spot_id_pairs[i].second = sec_row_id;
+
+                // SECONDARY_ALIGNMENT:SEQ_READ_ID
+                rc = VCursorCellDataDirect ( sec_cursor2, sec_row_id, sec_seq_read_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+                if ( rc != 0 || data_ptr == NULL || data_len != 1 )
+                {
+                    if (rc == 0)
+                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, SEQ_READ_ID column, row_id: $(ROW_ID)",
+                                "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                    break;
+                }
+                DBG_MSG(("SECONDARY_ALIGNMENT:%ld SEQ_READ_ID column = %d\n", sec_row_id, *(const int32_t *)data_ptr));
+
+                // one-based read index
+                seq_spot_read_id_pairs[i].first = seq_spot_id;
+                seq_spot_read_id_pairs[i].second = *(const int32_t *)data_ptr;
+            }
+            if (rc != 0)
+                break;
+
+            if (!ordered)
+            {
+                sort_key_pairs(i_count, seq_spot_id_pairs);
+            }
+
+            // Load chunk of PRIMARY_ALIGNMENT_ID (and some other fields) and sort ids for faster data retrieval
+            ordered = true;
+            for ( i = 0; i < i_count; ++i )
+            {
+                int64_t pri_row_id;
+                int64_t sec_row_id = seq_spot_id_pairs[i].second;
+                int64_t seq_spot_id = seq_spot_id_pairs[i].first;
+                int32_t seq_read_id = seq_spot_read_id_pairs[sec_row_id - chunk].second;
+
+                // SEQUENCE:PRIMARY_ALIGNMENT_ID
+                rc = VCursorCellDataDirect ( seq_cursor, seq_spot_id, seq_pa_id_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+                if ( rc != 0 || data_ptr == NULL )
+                {
+                    if (rc == 0)
+                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                            "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
+                                            "name=%s,SPOT_ID=%ld", dbname, seq_spot_id));
+                    break;
+                }
+
+                if ( seq_read_id < 1 || (uint32_t)seq_read_id > data_len )
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "SECONDARY_ALIGNMENT:$(SEC_ROW_ID) SEQ_READ_ID value ($(SEQ_READ_ID)) - 1 based, is out of SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT range ($(PRIMARY_ALIGNMENT_LEN))",
+                                "name=%s,SEC_ROW_ID=%ld,SEQ_READ_ID=%d,SEQ_SPOT_ID=%ld,PRIMARY_ALIGNMENT_LEN=%u", dbname, sec_row_id, seq_read_id, seq_spot_id, data_len));
+                    break;
+                }
+
+                pri_row_id = ((const int64_t *)data_ptr)[seq_read_id - 1];
+                DBG_MSG(("SEQUENCE:%ld PRIMARY_ALIGNMENT_ID column = %ld\n", seq_spot_id, pri_row_id));
+                if (pri_row_id == 0)
+                {
+                    if (!reported_about_no_pa)
+                    {
+                        PLOGMSG (klogWarn, (klogWarn, "Database '$(name)' has secondary alignments without primary", "name=%s", dbname));
+                        reported_about_no_pa = true;
+                    }
+                }
+
+                ordered &= last_pri_row_id <= pri_row_id;
+                last_pri_row_id = pri_row_id;
+
+                pri_id_pairs[i].first = pri_row_id;
+                pri_id_pairs[i].second = sec_row_id;
+
+                // SEQUENCE:READ_LEN
+                rc = VCursorCellDataDirect ( seq_cursor, seq_spot_id, seq_read_len_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+                if ( rc != 0 || data_ptr == NULL )
+                {
+                    if (rc == 0)
+                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, row_id: $(ROW_ID)",
+                                "name=%s,ROW_ID=%ld", dbname, seq_spot_id));
+                    break;
+                }
+
+                if ( seq_read_id < 1 || (uint32_t)seq_read_id > data_len )
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "SECONDARY_ALIGNMENT:$(SEC_ROW_ID) SEQ_READ_ID value ($(SEQ_READ_ID)) - 1 based, is out of SEQUENCE:$(SEQ_SPOT_ID) READ_LEN range ($(SEQ_READ_LEN_LEN))",
+                                "name=%s,SEC_ROW_ID=%ld,SEQ_READ_ID=%d,SEQ_SPOT_ID=%ld,SEQ_READ_LEN_LEN=%u", dbname, sec_row_id, seq_read_id, seq_spot_id, data_len));
+                    break;
+                }
+
+                seq_read_lens[sec_row_id - chunk] = ((const uint32_t *)data_ptr)[seq_read_id - 1];
+                DBG_MSG(("SEQUENCE:%ld READ_LEN column = %u\n", seq_spot_id, seq_read_lens[sec_row_id - chunk]));
+            }
+
+            if (rc != 0)
+                break;
+
+            if (!ordered)
+            {
+                sort_key_pairs(i_count, pri_id_pairs);
+            }
+
+            for ( i = 0; i < i_count; ++i )
+            {
+                uint32_t pri_len;
+                int sec_i_orig = pri_id_pairs[i].second - chunk;
+                pri_len_pairs[sec_i_orig].first = pri_id_pairs[i].first;
+                if (pri_id_pairs[i].first == 0)
+                {
+                    pri_len_pairs[sec_i_orig].second = -1;
+                    continue;
+                }
+
+                // PRIMARY_ALIGNMENT:HAS_REF_OFFSET
+                rc = VCursorCellDataDirect ( pri_cursor, pri_len_pairs[sec_i_orig].first, pri_has_ref_offset_idx, NULL, &data_ptr, NULL, &pri_len );
+                if ( rc != 0 )
+                {
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                            "VCursorCellDataDirect() failed on PRIMARY_ALIGNMENT table, HAS_REF_OFFSET column, row_id: $(ROW_ID)",
+                                            "name=%s,ROW_ID=%ld", dbname, pri_len_pairs[sec_i_orig].first));
+                    break;
+                }
+                pri_len_pairs[sec_i_orig].second = pri_len;
+                DBG_MSG(("PRIMARY_ALIGNMENT:%ld HAS_REF_OFFSET column len = %u\n", pri_len_pairs[sec_i_orig].first, pri_len_pairs[sec_i_orig].second));
+            }
+            if (rc != 0)
+                break;
+
+            // Iterate over SECONDARY_ALIGNMENT chunk, having data from other table chunks already loaded
+            for ( i = 0; i < i_count; ++i )
+            {
+                int64_t pri_row_id = pri_len_pairs[i].first;
+                int64_t sec_row_id = i + chunk;
+
+                int64_t seq_spot_id = seq_spot_read_id_pairs[i].first;
+                int32_t seq_read_id = seq_spot_read_id_pairs[i].second;
+
+                uint32_t seq_read_len = seq_read_lens[i];
+
+                uint32_t pri_row_len = pri_len_pairs[i].second;
+                uint32_t sec_row_len;
+
+                // SECONDARY_ALIGNMENT:HAS_REF_OFFSET
+                rc = VCursorCellDataDirect ( sec_cursor, sec_row_id, sec_has_ref_offset_idx, NULL, (const void**)&data_ptr, NULL, &sec_row_len );
+
+                if ( rc != 0 )
+                {
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                            "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, HAS_REF_OFFSET column, row_id: $(ROW_ID)",
+                                            "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                    break;
+                }
+                DBG_MSG(("SECONDARY_ALIGNMENT:%ld HAS_REF_OFFSET column len = %u\n", sec_row_id, sec_row_len));
+
+                if ( has_tmp_mismatch )
+                {
+                    const char * p_sa_tmp_mismatch;
+                    // SECONDARY_ALIGNMENT:TMP_MISMATCH
+                    rc = VCursorCellDataDirect ( sec_cursor, sec_row_id, sec_tmp_mismatch_idx, NULL, (const void**)&p_sa_tmp_mismatch, NULL, &data_len );
+                    if ( rc != 0 || p_sa_tmp_mismatch == NULL )
+                    {
+                        if (rc == 0)
+                            rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                                "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, TMP_MISMATCH column, row_id: $(ROW_ID)",
+                                                "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                        break;
+                    }
+
+                    if (string_chr(p_sa_tmp_mismatch, data_len, '=') != NULL)
+                    {
+                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                    "SECONDARY_ALIGNMENT:$(ROW_ID) TMP_MISMATCH column contains '='",
+                                    "name=%s,ROW_ID=%ld", dbname, sec_row_id));
+                        break;
+                    }
+                }
+
+                DBG_MSG(("Performing length check SA:%ld len = %u\t PA:%ld len = %u\t SEQ:%ld len = %u\n", sec_row_id, sec_row_len, pri_row_id, pri_row_len, seq_spot_id, seq_read_len));
+                // move on when there is no primary or PRIMARY_ALIGNMENT.len equal to SECONDARY_ALIGNMENT.len
+                if (pri_row_id == 0 || pri_row_len == sec_row_len)
+                    continue;
+
+                if (pri_row_len < sec_row_len)
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "PRIMARY_ALIGNMENT:$(PRI_ROW_ID) HAS_REF_OFFSET length ($(PRI_LEN)) less than SECONDARY_ALIGNMENT:$(SEC_ROW_ID) HAS_REF_OFFSET length ($(SEC_LEN))",
+                                "name=%s,PRI_ROW_ID=%ld,SEC_ROW_ID=%ld,PRI_LEN=%u,SEC_LEN=%u", dbname, pri_row_id, sec_row_id, pri_row_len, sec_row_len));
+                    break;
+                }
+
+                // we already know that pri_row_len > sec_row_len
+                ++pa_longer_sa_rows;
+
+                if (pri_row_len != seq_read_len)
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "PRIMARY_ALIGNMENT:$(PRI_ROW_ID) HAS_REF_OFFSET length ($(PRI_LEN)) does not match its SEQUENCE:$(SEQ_SPOT_ID) READ_LEN[$(SEQ_READ_ID)] value ($(SEQ_READ_LEN))",
+                                "name=%s,PRI_ROW_ID=%ld,PRI_LEN=%u,SEQ_SPOT_ID=%ld,SEQ_READ_ID=%d,SEQ_READ_LEN=%u", dbname, pri_row_id, pri_row_len, seq_spot_id, seq_read_id, seq_read_len));
+                    break;
+                }
+
+                if (pa_longer_sa_rows >= pa_longer_sa_limit)
+                {
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                "Limit violation (pa_longer_sa): there are at least $(PA_LONGER_SA_ROWS) alignments where HAS_REF_OFFSET column is longer in PRIMARY_ALIGNMENT than in SECONDARY_ALIGNMENT",
+                                "name=%s,PA_LONGER_SA_ROWS=%lu", dbname, pa_longer_sa_rows));
+                    break;
+                }
+            }
+        }
+    }
+
+    free(pri_id_pairs);
+    free(pri_len_pairs);
+    free(seq_spot_id_pairs);
+    free(seq_spot_read_id_pairs);
+    free(seq_read_lens);
+
+    if ( rc == 0 )
+    {
+        int64_t i;
+        int64_t i_count;
+        uint64_t seq_row_lmit;
+        // set limits from params
+        if (pb->sdc_seq_rows_in_percent)
+            seq_row_lmit = ceil( pb->sdc_seq_rows.percent * sec_row_count );
+        else if (pb->sdc_seq_rows.number == 0 || pb->sdc_seq_rows.number > sec_row_count)
+            seq_row_lmit = sec_row_count;
+        else
+            seq_row_lmit = pb->sdc_seq_rows.number;
+
+        i_count = MIN(seq_row_lmit, seq_row_count);
+
+        for ( i = 0; i < i_count; ++i )
+        {
+            int64_t seq_row_id = i + seq_id_first;
+
+            const void * data_ptr = NULL;
+            uint32_t data_len;
+            const int64_t * p_seq_pa_id;
+            const uint32_t * p_seq_read_len;
+            uint32_t seq_pa_id_len;
+
+            uint64_t sum_unaligned_read_len;
+            uint32_t j;
+
+            // SEQUENCE:PRIMARY_ALIGNMENT_ID
+            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_pa_id_idx, NULL, (const void**)&p_seq_pa_id, NULL, &seq_pa_id_len );
+            if ( rc != 0 || p_seq_pa_id == NULL )
+            {
+                if (rc == 0)
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                        "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
+                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+                break;
+            }
+
+            // SEQUENCE:READ_LEN
+            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_read_len_idx, NULL, (const void**)&p_seq_read_len, NULL, &data_len );
+            if ( rc != 0 || p_seq_read_len == NULL )
+            {
+                if (rc == 0)
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                        "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, spot_id: $(SPOT_ID)",
+                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+                break;
+            }
+            if ( seq_pa_id_len != data_len )
+            {
+                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                            "SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT_ID length ($(SEQ_PA_LEN)) does not match SEQUENCE:$(SEQ_SPOT_ID) READ_LEN length ($(SEQ_READ_LEN_LEN))",
+                            "name=%s,SEQ_SPOT_ID=%ld,SEQ_PA_LEN=%u,SEQ_READ_LEN_LEN=%u", dbname, seq_row_id, seq_pa_id_len, data_len));
+                break;
+            }
+
+            sum_unaligned_read_len = 0;
+            for ( j = 0; j < seq_pa_id_len; ++j )
+            {
+                if ( p_seq_pa_id[j] == 0 )
+                {
+                    sum_unaligned_read_len += p_seq_read_len[j];
+                }
+            }
+
+            // SEQUENCE:CMP_READ
+            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_cmp_read_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+            if ( rc != 0 || data_ptr == NULL )
+            {
+                if (rc == 0)
+                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                        "VCursorCellDataDirect() failed on SEQUENCE table, CMP_READ column, spot_id: $(SPOT_ID)",
+                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+                break;
+            }
+
+            if ( sum_unaligned_read_len != data_len )
+            {
+                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                            "SEQUENCE:$(SEQ_SPOT_ID) CMP_READ length ($(CMD_READ_LEN)) does not match sum of unaligned READ_LEN values ($(SUM_UNALIGNED_READ_LEN))",
+                            "name=%s,SEQ_SPOT_ID=%ld,CMD_READ_LEN=%u,SUM_UNALIGNED_READ_LEN=%lu", dbname, seq_row_id, data_len, sum_unaligned_read_len));
+                break;
+            }
+        }
+    }
+
+    VCursorRelease(sec_cursor2);
+    VCursorRelease(sec_cursor);
+    VCursorRelease(pri_cursor);
+    VCursorRelease(seq_cursor);
+    return rc;
+
+}
+
+/* database referential integrity check for alignment database */
+static rc_t dbric_align(const vdb_validate_params *pb,
+                        char const dbname[],
+                        VTable const *pri,
+                        VTable const *sec,
+                        VTable const *seq,
+                        VTable const *ref)
+{
+    rc_t rc = 0;
+
+    if ((rc == 0 || exhaustive) && (pri != NULL && seq != NULL)) {
+        rc_t rc2 = ric_align_seq_and_pri(dbname, seq, pri);
+
+        if (rc2 == 0) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
+               "SEQUENCE.PRIMARY_ALIGNMENT_ID <-> PRIMARY_ALIGNMENT.SEQ_SPOT_ID"
+               " referential integrity ok", "dbname=%s", dbname));
+        }
+        if (rc == 0) {
+            rc = rc2;
+        }
+    }
+    if ((rc == 0 || exhaustive) && (pri != NULL && ref != NULL)) {
+        rc_t rc2 = ric_align_ref_and_align(dbname, ref, pri, 0);
+
+        if (rc2 == 0) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
+                "REFERENCE.PRIMARY_ALIGNMENT_IDS <-> PRIMARY_ALIGNMENT.REF_ID "
+                "referential integrity ok", "dbname=%s", dbname));
+        }
+        if (rc == 0) {
+            rc = rc2;
+        }
+    }
+    if (pb->sdc_enabled && (rc == 0 || exhaustive) && (pri != NULL && sec != NULL && seq != NULL)) {
+        rc_t rc2 = ridc_align_seq_pri_sec(pb, dbname, seq, pri, sec);
+        if (rc2 == 0) {
+            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
+                "SEQUENCE and SECONDARY_ALIGNMENT tables data integrity checks ok", "dbname=%s", dbname));
+        }
+        if (rc == 0) {
+            rc = rc2;
+        }
+    }
+    return rc;
+}
+
+
+static rc_t verify_database_align(const vdb_validate_params *pb, VDatabase const *db,
+    char const name[], node_t const nodes[], char const names[])
+{
+    rc_t rc = 0;
+    unsigned tables = 0;
+    node_t const *tbl = &nodes[nodes[0].firstChild];
+    enum table_bits {
+        tbEvidenceInterval   = ( 1u << 0 ),
+        tbEvidenceAlignment  = ( 1u << 1 ),
+        tbPrimaryAlignment   = ( 1u << 2 ),
+        tbReference          = ( 1u << 3 ),
+        tbSequence           = ( 1u << 4 ),
+        tbSecondaryAlignment = ( 1u << 5 )
+    };
+
+    if (nodes[0].firstChild) {
+        for ( ; ; ) {
+            char const *tname = &names[tbl->name];
+            unsigned this_table = 0;
+
+            if (tbl->objType == kptTable) {
+                switch (tname[0]) {
+                case 'E':
+                    if (strcmp(tname, "EVIDENCE_INTERVAL") == 0)
+                        this_table |= tbEvidenceInterval;
+                    else if (strcmp(tname, "EVIDENCE_ALIGNMENT") == 0)
+                        this_table |= tbEvidenceAlignment;
+                    break;
+                case 'P':
+                    if (strcmp(tname, "PRIMARY_ALIGNMENT") == 0)
+                        this_table |= tbPrimaryAlignment;
+                    break;
+                case 'R':
+                    if (strcmp(tname, "REFERENCE") == 0)
+                        this_table |= tbReference;
+                    break;
+                case 'S':
+                    if (strcmp(tname, "SEQUENCE") == 0)
+                        this_table |= tbSequence;
+                    else if (strcmp(tname, "SECONDARY_ALIGNMENT") == 0)
+                        this_table |= tbSecondaryAlignment;
+                    break;
+                }
+                if (this_table == 0) {
+                    (void)PLOGERR(klogWarn, (klogWarn, RC(
+                        rcExe, rcDatabase, rcValidating, rcTable, rcUnexpected),
+                      "Database '$(name)' contains unexpected table '$(table)'",
+                      "name=%s,table=%s", name, tname));
+                }
+                tables |= this_table;
+            }
+            else {
+                (void)PLOGERR(klogWarn, (klogWarn, RC(
+                    rcExe, rcDatabase, rcValidating, rcType, rcUnexpected),
+                    "Database '$(name)' contains unexpected object '$(obj)'",
+                    "name=%s,obj=%s", name, tname));
+            }
+            if (tbl->nxtSibl > 0)
+                tbl = &nodes[tbl->nxtSibl];
+            else
+                break;
+        }
+    }
+    if (tables == tbSequence) {
+        /* sequence data only */
+        (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(name)' "
+            "contains only unaligned reads", "name=%s", name));
+    }
+    else if (   (tables & tbReference) == 0
+             || (tables & tbPrimaryAlignment) == 0)
+    {
+        /* missing reference or primary alignment */
+        rc = RC(rcExe, rcDatabase, rcValidating, rcDatabase, rcIncomplete);
+        (void)PLOGERR(klogWarn, (klogWarn, rc,
+            "Database '$(name)' does not contain all required tables",
+            "name=%s", name));
+    }
+    else if (   ((tables & tbEvidenceAlignment) != 0)
+             != ((tables & tbEvidenceInterval ) != 0))
+    {
+        /* both must be present or both must be absent */
+        rc = RC(rcExe, rcDatabase, rcValidating, rcDatabase, rcIncomplete);
+        (void)PLOGERR(klogWarn, (klogWarn, rc,
+            "Database '$(name)' does not contain all required tables",
+            "name=%s", name));
+    }
+    while (ref_int_check) {
+        VTable const *pri = NULL;
+        VTable const *sec = NULL;
+        VTable const *seq = NULL;
+        VTable const *ref = NULL;
+
+        if ((tables & tbPrimaryAlignment) != 0) {
+            rc = VDatabaseOpenTableRead(db, &pri, "PRIMARY_ALIGNMENT");
+            if (rc) break;
+        }
+        if ((tables & tbSecondaryAlignment) != 0) {
+            rc = VDatabaseOpenTableRead(db, &sec, "SECONDARY_ALIGNMENT");
+            if (rc) break;
+        }
+        if ((tables & tbSequence) != 0) {
+            rc = VDatabaseOpenTableRead(db, &seq, "SEQUENCE");
+            if (rc) break;
+        }
+        if ((tables & tbReference) != 0) {
+            rc = VDatabaseOpenTableRead(db, &ref, "REFERENCE");
+            if (rc) break;
+        }
+        rc = dbric_align(pb, name, pri, sec, seq, ref);
+
+        RELEASE(VTable, ref);
+        RELEASE(VTable, seq);
+        RELEASE(VTable, sec);
+        RELEASE(VTable, pri);
+
+        break;
+    }
+
+    return rc;
+}
+
+static rc_t verify_database(const vdb_validate_params *pb, VDatabase const *db,
+    char const name[], node_t const nodes[], char const names[])
+{
+    char schemaName[1024];
+    char *schemaVers = NULL;
+    rc_t rc;
+
+    rc = get_db_schema_info(db, schemaName, sizeof(schemaName), &schemaVers);
+    if (rc) {
+        (void)PLOGERR(klogErr, (klogErr, rc,
+            "Failed to find database schema for '$(name)'", "name=%s", name));
+    }
+    else if (strncmp(schemaName, "NCBI:var:db:", 12) == 0) {
+        /* TODO: verify NCBI:var:db:* */
+    }
+    else if (strncmp(schemaName, "NCBI:WGS:db:", 12) == 0) {
+        /* TODO: verify NCBI:WGS:db:* */
+    }
+    else if (strncmp(schemaName, "NCBI:align:db:", 14) == 0) {
+        rc = verify_database_align(pb, db, name, nodes, names);
+    }
+    else if (strcmp(schemaName, "NCBI:SRA:PacBio:smrt:db") == 0) {
+        /* TODO: verify NCBI:SRA:PacBio:smrt:db */
+    }
+    else {
+        (void)PLOGERR(klogWarn, (klogWarn,
+            RC(rcExe, rcDatabase, rcValidating, rcType, rcUnrecognized),
+            "Database '$(name)' has unrecognized type '$(type)'",
+            "name=%s,type=%s", name, schemaName));
+    }
+    return rc;
+}
+
+static rc_t verify_mgr_database(const vdb_validate_params *pb,
+    char const name[], node_t const nodes[], char const names[])
+{
+    rc_t rc = 0;
+    VDatabase const *child;
+    const VDBManager *mgr = NULL;
+    
+    assert(pb);
 
-            if (rc != 0)
-                break;
+    mgr = pb->vmgr;
 
-            if (!ordered)
-            {
-                sort_key_pairs(i_count, pri_id_pairs);
-            }
+    rc = VDBManagerOpenDBRead(mgr, &child, NULL, "%s", name);
 
-            for ( i = 0; i < i_count; ++i )
-            {
-                uint32_t pri_len;
-                int sec_i_orig = pri_id_pairs[i].second - chunk;
-                pri_len_pairs[sec_i_orig].first = pri_id_pairs[i].first;
-                if (pri_id_pairs[i].first == 0)
-                {
-                    pri_len_pairs[sec_i_orig].second = -1;
-                    continue;
-                }
+    if (rc == 0) {
+        rc = verify_database(pb, child, name, nodes, names);
+        VDatabaseRelease(child);
+    }
 
-                // PRIMARY_ALIGNMENT:HAS_REF_OFFSET
-                rc = VCursorCellDataDirect ( pri_cursor, pri_len_pairs[sec_i_orig].first, pri_has_ref_offset_idx, NULL, &data_ptr, NULL, &pri_len );
-                if ( rc != 0 )
-                {
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                            "VCursorCellDataDirect() failed on PRIMARY_ALIGNMENT table, HAS_REF_OFFSET column, row_id: $(ROW_ID)",
-                                            "name=%s,ROW_ID=%ld", dbname, pri_len_pairs[sec_i_orig].first));
-                    break;
-                }
-                pri_len_pairs[sec_i_orig].second = pri_len;
-                DBG_MSG(("PRIMARY_ALIGNMENT:%ld HAS_REF_OFFSET column len = %u\n", pri_len_pairs[sec_i_orig].first, pri_len_pairs[sec_i_orig].second));
-            }
-            if (rc != 0)
-                break;
+    return rc;
+}
 
-            // Iterate over SECONDARY_ALIGNMENT chunk, having data from other table chunks already loaded
-            for ( i = 0; i < i_count; ++i )
-            {
-                int64_t pri_row_id = pri_len_pairs[i].first;
-                int64_t sec_row_id = i + chunk;
+static rc_t sra_dbcc(const vdb_validate_params *pb,
+    char const name[], node_t const nodes[], char const names[])
+{
+    rc_t rc = 0;
 
-                int64_t seq_spot_id = seq_spot_read_id_pairs[i].first;
-                int32_t seq_read_id = seq_spot_read_id_pairs[i].second;
+    if (nodes[0].objType == kptDatabase)
+        rc = verify_mgr_database(pb, name, nodes, names);
+    else
+        rc = verify_mgr_table(pb, name);
 
-                uint32_t seq_read_len = seq_read_lens[i];
+    return rc;
+}
 
-                uint32_t pri_row_len = pri_len_pairs[i].second;
-                uint32_t sec_row_len;
+static
+rc_t get_platform(const VDBManager *mgr,
+    const VTable *aTbl, char const name[],
+    INSDC_SRA_platform_id *platform)
+{
+    rc_t rc = 0;
+    const VTable *tbl = aTbl;
+    assert(name && platform);
+    if (tbl == NULL) {
+        VSchema *sra_schema = NULL;
+        for ( ; rc == 0; ) {
+            rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
+            VSchemaRelease(sra_schema);
+            if (rc == 0) {
+                rc = VTable_get_platform(tbl, platform);
+                break;
+            }
+            else if (GetRCState(rc) == rcNotFound && GetRCObject(rc) == (enum RCObject)rcSchema
+                && sra_schema == NULL)
+            {
+                rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
+            }
+        }
+    }
 
-                // SECONDARY_ALIGNMENT:HAS_REF_OFFSET
-                rc = VCursorCellDataDirect ( sec_cursor, sec_row_id, sec_has_ref_offset_idx, NULL, (const void**)&data_ptr, NULL, &sec_row_len );
+    if (aTbl == NULL)
+        VTableRelease(tbl);
 
-                if ( rc != 0 )
-                {
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                            "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, HAS_REF_OFFSET column, row_id: $(ROW_ID)",
-                                            "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                    break;
-                }
-                DBG_MSG(("SECONDARY_ALIGNMENT:%ld HAS_REF_OFFSET column len = %u\n", sec_row_id, sec_row_len));
+    return rc;
+}
 
-                if ( has_tmp_mismatch )
-                {
-                    const char * p_sa_tmp_mismatch;
-                    // SECONDARY_ALIGNMENT:TMP_MISMATCH
-                    rc = VCursorCellDataDirect ( sec_cursor, sec_row_id, sec_tmp_mismatch_idx, NULL, (const void**)&p_sa_tmp_mismatch, NULL, &data_len );
-                    if ( rc != 0 || p_sa_tmp_mismatch == NULL )
-                    {
-                        if (rc == 0)
-                            rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                                "VCursorCellDataDirect() failed on SECONDARY_ALIGNMENT table, TMP_MISMATCH column, row_id: $(ROW_ID)",
-                                                "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                        break;
-                    }
+/*******************************************************************************
+ * --incremental
+ *
+ * The manifest of an object keeps, for every job of its consistency check
+ * ( see --threads ), the size and date of the files of the job, the MD5 of
+ * its md5 files and the report events of its check.  A job that passed and
+ * whose files look the same is not run again: its events are replayed from
+ * the manifest.  When no job has to run and the data checks passed, they are
+ * not run again either.
+ *
+ * The files are looked at before they are checked: a file that changes while
+ * it is being checked is checked again by the next run.
+ */
 
-                    if (string_chr(p_sa_tmp_mismatch, data_len, '=') != NULL)
-                    {
-                        rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                    "SECONDARY_ALIGNMENT:$(ROW_ID) TMP_MISMATCH column contains '='",
-                                    "name=%s,ROW_ID=%ld", dbname, sec_row_id));
-                        break;
-                    }
-                }
+#define MANIFEST_EXT ".vdb-validate"
+#define MANIFEST_HEADER "vdb-validate manifest 1"
+
+typedef struct mf_file_s {
+    char *path; /* relative to the directory of the job */
+    uint64_t size;
+    KTime_t date;
+    uint8_t md5[16];
+    bool has_md5; /* it is a md5 file */
+} mf_file_t;
+
+typedef struct mf_files_s {
+    mf_file_t *file;
+    unsigned count;
+    unsigned max;
+    bool valid;
+} mf_files_t;
+
+typedef struct mf_job_s {
+    char *name;
+    unsigned depth;
+    bool table;
+    rc_t rc;
+    mf_files_t files;
+    cc_record_t record;
+} mf_job_t;
+
+typedef struct manifest_s {
+    mf_job_t *job;
+    unsigned jobs;
+    unsigned max;
+    rc_t data_rc;
+    bool has_data;
+} manifest_t;
+
+static void mf_files_whack(mf_files_t *self)
+{
+    unsigned i;
 
-                DBG_MSG(("Performing length check SA:%ld len = %u\t PA:%ld len = %u\t SEQ:%ld len = %u\n", sec_row_id, sec_row_len, pri_row_id, pri_row_len, seq_spot_id, seq_read_len));
-                // move on when there is no primary or PRIMARY_ALIGNMENT.len equal to SECONDARY_ALIGNMENT.len
-                if (pri_row_id == 0 || pri_row_len == sec_row_len)
-                    continue;
+    for (i = 0; i < self->count; ++i)
+        free(self->file[i].path);
+    free(self->file);
+    memset(self, 0, sizeof(*self));
+}
 
-                if (pri_row_len < sec_row_len)
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "PRIMARY_ALIGNMENT:$(PRI_ROW_ID) HAS_REF_OFFSET length ($(PRI_LEN)) less than SECONDARY_ALIGNMENT:$(SEC_ROW_ID) HAS_REF_OFFSET length ($(SEC_LEN))",
-                                "name=%s,PRI_ROW_ID=%ld,SEC_ROW_ID=%ld,PRI_LEN=%u,SEC_LEN=%u", dbname, pri_row_id, sec_row_id, pri_row_len, sec_row_len));
-                    break;
-                }
+static mf_file_t *mf_files_next(mf_files_t *self)
+{
+    if (self->count == self->max) {
+        unsigned const max = self->max ? self->max * 2 : 64;
+        void *const tmp = realloc(self->file, max * sizeof(self->file[0]));
+
+        if (tmp == NULL)
+            return NULL;
+        self->file = tmp;
+        self->max = max;
+    }
+    memset(&self->file[self->count], 0, sizeof(self->file[0]));
+    return &self->file[self->count];
+}
 
-                // we already know that pri_row_len > sec_row_len
-                ++pa_longer_sa_rows;
+static rc_t mf_files_add(mf_files_t *self, KDirectory const *dir,
+    char const name[], char const path[])
+{
+    mf_file_t *const file = mf_files_next(self);
+    rc_t rc;
 
-                if (pri_row_len != seq_read_len)
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "PRIMARY_ALIGNMENT:$(PRI_ROW_ID) HAS_REF_OFFSET length ($(PRI_LEN)) does not match its SEQUENCE:$(SEQ_SPOT_ID) READ_LEN[$(SEQ_READ_ID)] value ($(SEQ_READ_LEN))",
-                                "name=%s,PRI_ROW_ID=%ld,PRI_LEN=%u,SEQ_SPOT_ID=%ld,SEQ_READ_ID=%d,SEQ_READ_LEN=%u", dbname, pri_row_id, pri_row_len, seq_spot_id, seq_read_id, seq_read_len));
-                    break;
-                }
+    if (file == NULL)
+        return RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
 
-                if (pa_longer_sa_rows >= pa_longer_sa_limit)
-                {
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                    (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                "Limit violation (pa_longer_sa): there are at least $(PA_LONGER_SA_ROWS) alignments where HAS_REF_OFFSET column is longer in PRIMARY_ALIGNMENT than in SECONDARY_ALIGNMENT",
-                                "name=%s,PA_LONGER_SA_ROWS=%lu", dbname, pa_longer_sa_rows));
-                    break;
-                }
-            }
-        }
+    rc = KDirectoryFileSize(dir, &file->size, "%s", name);
+    if (rc == 0)
+        rc = KDirectoryDate(dir, &file->date, "%s", name);
+    if (rc == 0 && strcmp(name, "md5") == 0) {
+        rc = file_md5(dir, name, file->md5);
+        file->has_md5 = true;
     }
+    if (rc == 0) {
+        file->path = strdup(path);
+        if (file->path == NULL)
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    }
+    if (rc == 0)
+        ++self->count;
+    return rc;
+}
 
-    free(pri_id_pairs);
-    free(pri_len_pairs);
-    free(seq_spot_id_pairs);
-    free(seq_spot_read_id_pairs);
-    free(seq_read_lens);
-
-    if ( rc == 0 )
-    {
-        int64_t i;
-        int64_t i_count;
-        uint64_t seq_row_lmit;
-        // set limits from params
-        if (pb->sdc_seq_rows_in_percent)
-            seq_row_lmit = ceil( pb->sdc_seq_rows.percent * sec_row_count );
-        else if (pb->sdc_seq_rows.number == 0 || pb->sdc_seq_rows.number > sec_row_count)
-            seq_row_lmit = sec_row_count;
-        else
-            seq_row_lmit = pb->sdc_seq_rows.number;
+typedef struct mf_visit_s {
+    mf_files_t *files;
+    size_t len;
+    bool own_files; /* of a database: not its tables and databases */
+    char path[4096];
+} mf_visit_t;
 
-        i_count = MIN(seq_row_lmit, seq_row_count);
+static rc_t CC mf_files_visit(const KDirectory *dir,
+    uint32_t type, const char *name, void *data)
+{
+    mf_visit_t *pb = data;
+    size_t const len = pb->len;
+    size_t const nlen = strlen(name);
+    rc_t rc = Quitting();
 
-        for ( i = 0; i < i_count; ++i )
-        {
-            int64_t seq_row_id = i + seq_id_first;
+    if (rc)
+        return rc;
+    if (pb->own_files && len == 0
+        && (strcmp(name, "tbl") == 0 || strcmp(name, "db") == 0))
+    {
+        return 0;
+    }
+    if (len + nlen + 2 > sizeof(pb->path))
+        return RC(rcExe, rcPath, rcVisiting, rcPath, rcExcessive);
+    memmove(&pb->path[len], name, nlen + 1);
 
-            const void * data_ptr = NULL;
-            uint32_t data_len;
-            const int64_t * p_seq_pa_id;
-            const uint32_t * p_seq_read_len;
-            uint32_t seq_pa_id_len;
+    switch (type & ~kptAlias) {
+    case kptFile:
+        rc = mf_files_add(pb->files, dir, name, pb->path);
+        break;
+    case kptDir:
+        pb->path[len + nlen] = '/';
+        pb->path[len + nlen + 1] = '\0';
+        pb->len = len + nlen + 1;
+        rc = KDirectoryVisit(dir, false, mf_files_visit, pb, "%s", name);
+        pb->len = len;
+        break;
+    default:
+        break;
+    }
+    return rc;
+}
 
-            uint64_t sum_unaligned_read_len;
-            uint32_t j;
+static int CC mf_file_cmp(const void *A, const void *B)
+{
+    mf_file_t const *a = A;
+    mf_file_t const *b = B;
 
-            // SEQUENCE:PRIMARY_ALIGNMENT_ID
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_pa_id_idx, NULL, (const void**)&p_seq_pa_id, NULL, &seq_pa_id_len );
-            if ( rc != 0 || p_seq_pa_id == NULL )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
+    return strcmp(a->path, b->path);
+}
 
-            // SEQUENCE:READ_LEN
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_read_len_idx, NULL, (const void**)&p_seq_read_len, NULL, &data_len );
-            if ( rc != 0 || p_seq_read_len == NULL )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
-            if ( seq_pa_id_len != data_len )
-            {
-                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                            "SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT_ID length ($(SEQ_PA_LEN)) does not match SEQUENCE:$(SEQ_SPOT_ID) READ_LEN length ($(SEQ_READ_LEN_LEN))",
-                            "name=%s,SEQ_SPOT_ID=%ld,SEQ_PA_LEN=%u,SEQ_READ_LEN_LEN=%u", dbname, seq_row_id, seq_pa_id_len, data_len));
-                break;
-            }
+/* the files the job looks at; not valid if they could not be listed */
+static void mf_files_make(cc_job_t const *job, mf_files_t *files)
+{
+    KDirectory const *dir = NULL;
+    mf_visit_t pb;
+    rc_t rc;
 
-            sum_unaligned_read_len = 0;
-            for ( j = 0; j < seq_pa_id_len; ++j )
-            {
-                if ( p_seq_pa_id[j] == 0 )
-                {
-                    sum_unaligned_read_len += p_seq_read_len[j];
-                }
-            }
+    memset(files, 0, sizeof(*files));
+    if (job->tbl != NULL)
+        rc = KTableOpenDirectoryRead(job->tbl, &dir);
+    else if (job->db != NULL)
+        rc = KDatabaseOpenDirectoryRead(job->db, &dir);
+    else
+        return; /* could not be opened */
 
-            // SEQUENCE:CMP_READ
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_cmp_read_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-            if ( rc != 0 || data_ptr == NULL )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, CMP_READ column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
+    memset(&pb, 0, sizeof(pb));
+    pb.files = files;
+    pb.own_files = job->tbl == NULL && job->depth == 0;
+    if (rc == 0)
+        rc = KDirectoryVisit(dir, false, mf_files_visit, &pb, ".");
+    KDirectoryRelease(dir);
 
-            if ( sum_unaligned_read_len != data_len )
-            {
-                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                            "SEQUENCE:$(SEQ_SPOT_ID) CMP_READ length ($(CMD_READ_LEN)) does not match sum of unaligned READ_LEN values ($(SUM_UNALIGNED_READ_LEN))",
-                            "name=%s,SEQ_SPOT_ID=%ld,CMD_READ_LEN=%u,SUM_UNALIGNED_READ_LEN=%lu", dbname, seq_row_id, data_len, sum_unaligned_read_len));
-                break;
-            }
+    if (rc == 0 && files->count > 0) {
+        qsort(files->file, files->count, sizeof(files->file[0]),
+              mf_file_cmp);
+    }
+    files->valid = rc == 0;
+}
+
+static bool mf_files_equal(mf_files_t const *a, mf_files_t const *b)
+{
+    unsigned i;
+
+    if (!a->valid || !b->valid || a->count != b->count)
+        return false;
+    for (i = 0; i < a->count; ++i) {
+        mf_file_t const *x = &a->file[i];
+        mf_file_t const *y = &b->file[i];
+
+        if (strcmp(x->path, y->path) != 0 || x->size != y->size
+            || x->date != y->date || x->has_md5 != y->has_md5
+            || memcmp(x->md5, y->md5, sizeof(x->md5)) != 0)
+        {
+            return false;
         }
     }
+    return true;
+}
 
-    VCursorRelease(sec_cursor2);
-    VCursorRelease(sec_cursor);
-    VCursorRelease(pri_cursor);
-    VCursorRelease(seq_cursor);
-    return rc;
+static void manifest_whack(manifest_t *self)
+{
+    unsigned i;
 
+    for (i = 0; i < self->jobs; ++i) {
+        free(self->job[i].name);
+        mf_files_whack(&self->job[i].files);
+        record_whack(&self->job[i].record);
+    }
+    free(self->job);
+    memset(self, 0, sizeof(*self));
 }
 
-/* database referential integrity check for alignment database */
-static rc_t dbric_align(const vdb_validate_params *pb,
-                        char const dbname[],
-                        VTable const *pri,
-                        VTable const *sec,
-                        VTable const *seq,
-                        VTable const *ref)
+/* the checks of another run would not be the same */
+static void manifest_options(const vdb_validate_params *pb, uint32_t mode,
+    INSDC_SRA_platform_id platform, char buffer[], size_t bsize)
 {
-    rc_t rc = 0;
+    snprintf(buffer, bsize, "mode=%u,level=%u,platform=%u,md5=%d"
+        ",exhaustive=%d,ri=%d,cc=%d,sdc=%d:%d:%.17g:%d:%.17g:%d:%.17g",
+        mode, kdbcc_level(mode), (unsigned)platform, md5_required,
+        exhaustive, ref_int_check, pb->consist_check, pb->sdc_enabled,
+        pb->sdc_sec_rows_in_percent, pb->sdc_sec_rows_in_percent
+            ? pb->sdc_sec_rows.percent : (double)pb->sdc_sec_rows.number,
+        pb->sdc_seq_rows_in_percent, pb->sdc_seq_rows_in_percent
+            ? pb->sdc_seq_rows.percent : (double)pb->sdc_seq_rows.number,
+        pb->sdc_pa_len_thold_in_percent, pb->sdc_pa_len_thold_in_percent
+            ? pb->sdc_pa_len_thold.percent
+            : (double)pb->sdc_pa_len_thold.number);
+}
 
-    if ((rc == 0 || exhaustive) && (pri != NULL && seq != NULL)) {
-        rc_t rc2 = ric_align_seq_and_pri(dbname, seq, pri);
+/* next to the object or, with --manifest-dir, named after its full path */
+static rc_t manifest_path(const vdb_validate_params *pb, char const name[],
+    char buffer[], size_t bsize)
+{
+    size_t len = strlen(name);
+    int n;
 
-        if (rc2 == 0) {
-            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
-               "SEQUENCE.PRIMARY_ALIGNMENT_ID <-> PRIMARY_ALIGNMENT.SEQ_SPOT_ID"
-               " referential integrity ok", "dbname=%s", dbname));
-        }
-        if (rc == 0) {
-            rc = rc2;
-        }
+    while (len > 1 && name[len - 1] == '/')
+        --len;
+
+    if (pb->manifest_dir == NULL)
+        n = snprintf(buffer, bsize, "%.*s" MANIFEST_EXT, (int)len, name);
+    else {
+        char full[4096];
+        char const *base;
+        uint8_t digest[16];
+        MD5State md5;
+
+        rc_t rc = KDirectoryResolvePath(pb->wd, true, full, sizeof(full),
+                                        "%.*s", (int)len, name);
+        if (rc)
+            return rc;
+
+        MD5StateInit(&md5);
+        MD5StateAppend(&md5, full, strlen(full));
+        MD5StateFinish(&md5, digest);
+
+        base = strrchr(full, '/');
+        base = base != NULL ? base + 1 : full;
+        n = snprintf(buffer, bsize,
+            "%s/%s.%02x%02x%02x%02x%02x%02x%02x%02x" MANIFEST_EXT,
+            pb->manifest_dir, base, digest[0], digest[1], digest[2],
+            digest[3], digest[4], digest[5], digest[6], digest[7]);
     }
-    if ((rc == 0 || exhaustive) && (pri != NULL && ref != NULL)) {
-        rc_t rc2 = ric_align_ref_and_align(dbname, ref, pri, 0);
+    if (n < 0 || (size_t)n >= bsize)
+        return RC(rcExe, rcPath, rcConstructing, rcBuffer, rcInsufficient);
+    return 0;
+}
 
-        if (rc2 == 0) {
-            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
-                "REFERENCE.PRIMARY_ALIGNMENT_IDS <-> PRIMARY_ALIGNMENT.REF_ID "
-                "referential integrity ok", "dbname=%s", dbname));
-        }
-        if (rc == 0) {
-            rc = rc2;
-        }
+/* a line per record, tab-separated fields;
+   strings are "-" for NULL or '=' and the string with \t \n \\ escaped */
+
+static unsigned mf_fields(char *line, char *field[], unsigned max)
+{
+    unsigned n = 0;
+
+    for ( ; ; ) {
+        char *const tab = strchr(line, '\t');
+
+        if (n == max)
+            return max + 1;
+        field[n++] = line;
+        if (tab == NULL)
+            return n;
+        *tab = '\0';
+        line = tab + 1;
     }
-    if (pb->sdc_enabled && (rc == 0 || exhaustive) && (pri != NULL && sec != NULL && seq != NULL)) {
-        rc_t rc2 = ridc_align_seq_pri_sec(pb, dbname, seq, pri, sec);
-        if (rc2 == 0) {
-            (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
-                "SEQUENCE and SECONDARY_ALIGNMENT tables data integrity checks ok", "dbname=%s", dbname));
-        }
-        if (rc == 0) {
-            rc = rc2;
+}
+
+static bool mf_string(char *field, char **str)
+{
+    char const *src;
+    char *dst;
+
+    if (strcmp(field, "-") == 0) {
+        *str = NULL;
+        return true;
+    }
+    if (field[0] != '=')
+        return false;
+    for (src = field + 1, dst = field; *src != '\0'; ++src) {
+        if (*src != '\\')
+            *dst++ = *src;
+        else {
+            switch (*++src) {
+            case 't':
+                *dst++ = '\t';
+                break;
+            case 'n':
+                *dst++ = '\n';
+                break;
+            case '\\':
+                *dst++ = '\\';
+                break;
+            default:
+                return false;
+            }
         }
     }
-    return rc;
+    *dst = '\0';
+    *str = field;
+    return true;
 }
 
+static bool mf_number(char const *field, uint64_t *value)
+{
+    char *end = NULL;
 
-static rc_t verify_database_align(const vdb_validate_params *pb, VDatabase const *db,
-    char const name[], node_t const nodes[], char const names[])
+    if (!isdigit(field[0]))
+        return false;
+    *value = strtou64(field, &end, 10);
+    return *end == '\0';
+}
+
+static bool mf_md5(char const *field, mf_file_t *file)
 {
-    rc_t rc = 0;
-    unsigned tables = 0;
-    node_t const *tbl = &nodes[nodes[0].firstChild];
-    enum table_bits {
-        tbEvidenceInterval   = ( 1u << 0 ),
-        tbEvidenceAlignment  = ( 1u << 1 ),
-        tbPrimaryAlignment   = ( 1u << 2 ),
-        tbReference          = ( 1u << 3 ),
-        tbSequence           = ( 1u << 4 ),
-        tbSecondaryAlignment = ( 1u << 5 )
-    };
+    unsigned i;
+
+    if (strcmp(field, "-") == 0)
+        return true;
+    if (strlen(field) != 2 * sizeof(file->md5))
+        return false;
+    for (i = 0; i < sizeof(file->md5); ++i) {
+        char hex[3];
+        char *end = NULL;
+
+        hex[0] = field[2 * i];
+        hex[1] = field[2 * i + 1];
+        hex[2] = '\0';
+        if (!isxdigit(hex[0]) || !isxdigit(hex[1]))
+            return false;
+        file->md5[i] = (uint8_t)strtoul(hex, &end, 16);
+    }
+    file->has_md5 = true;
+    return true;
+}
 
-    if (nodes[0].firstChild) {
-        for ( ; ; ) {
-            char const *tname = &names[tbl->name];
-            unsigned this_table = 0;
+static bool mf_parse_job(manifest_t *self, char *field[], unsigned n)
+{
+    uint64_t depth, rc;
+    char *name;
+    mf_job_t *job;
 
-            if (tbl->objType == kptTable) {
-                switch (tname[0]) {
-                case 'E':
-                    if (strcmp(tname, "EVIDENCE_INTERVAL") == 0)
-                        this_table |= tbEvidenceInterval;
-                    else if (strcmp(tname, "EVIDENCE_ALIGNMENT") == 0)
-                        this_table |= tbEvidenceAlignment;
-                    break;
-                case 'P':
-                    if (strcmp(tname, "PRIMARY_ALIGNMENT") == 0)
-                        this_table |= tbPrimaryAlignment;
-                    break;
-                case 'R':
-                    if (strcmp(tname, "REFERENCE") == 0)
-                        this_table |= tbReference;
-                    break;
-                case 'S':
-                    if (strcmp(tname, "SEQUENCE") == 0)
-                        this_table |= tbSequence;
-                    else if (strcmp(tname, "SECONDARY_ALIGNMENT") == 0)
-                        this_table |= tbSecondaryAlignment;
-                    break;
-                }
-                if (this_table == 0) {
-                    (void)PLOGERR(klogWarn, (klogWarn, RC(
-                        rcExe, rcDatabase, rcValidating, rcTable, rcUnexpected),
-                      "Database '$(name)' contains unexpected table '$(table)'",
-                      "name=%s,table=%s", name, tname));
-                }
-                tables |= this_table;
-            }
-            else {
-                (void)PLOGERR(klogWarn, (klogWarn, RC(
-                    rcExe, rcDatabase, rcValidating, rcType, rcUnexpected),
-                    "Database '$(name)' contains unexpected object '$(obj)'",
-                    "name=%s,obj=%s", name, tname));
-            }
-            if (tbl->nxtSibl > 0)
-                tbl = &nodes[tbl->nxtSibl];
-            else
-                break;
-        }
+    if (n != 5 || !mf_number(field[1], &depth) || !mf_number(field[3], &rc)
+        || !mf_string(field[4], &name) || name == NULL
+        || (strcmp(field[2], "t") != 0 && strcmp(field[2], "d") != 0))
+    {
+        return false;
     }
-    if (tables == tbSequence) {
-        /* sequence data only */
-        (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(name)' "
-            "contains only unaligned reads", "name=%s", name));
+    if (self->jobs == self->max) {
+        unsigned const max = self->max ? self->max * 2 : 16;
+        void *const tmp = realloc(self->job, max * sizeof(self->job[0]));
+
+        if (tmp == NULL)
+            return false;
+        self->job = tmp;
+        self->max = max;
     }
-    else if (   (tables & tbReference) == 0
-             || (tables & tbPrimaryAlignment) == 0)
+    job = &self->job[self->jobs];
+    memset(job, 0, sizeof(*job));
+    job->name = strdup(name);
+    if (job->name == NULL)
+        return false;
+    job->depth = (unsigned)depth;
+    job->table = field[2][0] == 't';
+    job->rc = (rc_t)rc;
+    job->files.valid = true;
+    ++self->jobs;
+    return true;
+}
+
+static bool mf_parse_file(mf_files_t *files, char *field[], unsigned n)
+{
+    uint64_t size, date;
+    char *path;
+    mf_file_t *file;
+
+    if (n != 5 || !mf_number(field[1], &size) || !mf_number(field[2], &date)
+        || !mf_string(field[4], &path) || path == NULL)
     {
-        /* missing reference or primary alignment */
-        rc = RC(rcExe, rcDatabase, rcValidating, rcDatabase, rcIncomplete);
-        (void)PLOGERR(klogWarn, (klogWarn, rc,
-            "Database '$(name)' does not contain all required tables",
-            "name=%s", name));
+        return false;
     }
-    else if (   ((tables & tbEvidenceAlignment) != 0)
-             != ((tables & tbEvidenceInterval ) != 0))
+    file = mf_files_next(files);
+    if (file == NULL || !mf_md5(field[3], file))
+        return false;
+    file->path = strdup(path);
+    if (file->path == NULL)
+        return false;
+    file->size = size;
+    file->date = (KTime_t)date;
+    ++files->count;
+    return true;
+}
+
+static bool mf_parse_event(cc_record_t *record, char *field[], unsigned n)
+{
+    uint64_t objType, type, depth, rc;
+    char *objName, *text;
+    CCReportInfoBlock what;
+
+    if (n != 7 || !mf_number(field[1], &objType)
+        || !mf_number(field[2], &type) || !mf_number(field[3], &depth)
+        || !mf_number(field[4], &rc) || !mf_string(field[5], &objName)
+        || !mf_string(field[6], &text))
     {
-        /* both must be present or both must be absent */
-        rc = RC(rcExe, rcDatabase, rcValidating, rcDatabase, rcIncomplete);
-        (void)PLOGERR(klogWarn, (klogWarn, rc,
-            "Database '$(name)' does not contain all required tables",
-            "name=%s", name));
+        return false;
     }
-    while (ref_int_check) {
-        VTable const *pri = NULL;
-        VTable const *sec = NULL;
-        VTable const *seq = NULL;
-        VTable const *ref = NULL;
 
-        if ((tables & tbPrimaryAlignment) != 0) {
-            rc = VDatabaseOpenTableRead(db, &pri, "PRIMARY_ALIGNMENT");
-            if (rc) break;
-        }
-        if ((tables & tbSecondaryAlignment) != 0) {
-            rc = VDatabaseOpenTableRead(db, &sec, "SECONDARY_ALIGNMENT");
-            if (rc) break;
-        }
-        if ((tables & tbSequence) != 0) {
-            rc = VDatabaseOpenTableRead(db, &seq, "SEQUENCE");
-            if (rc) break;
-        }
-        if ((tables & tbReference) != 0) {
-            rc = VDatabaseOpenTableRead(db, &ref, "REFERENCE");
-            if (rc) break;
-        }
-        rc = dbric_align(pb, name, pri, sec, seq, ref);
+    memset(&what, 0, sizeof(what));
+    what.objName = objName;
+    what.objType = (uint32_t)objType;
+    what.type = (CCReportType)type;
+    switch (what.type) {
+    case ccrpt_Visit:
+        what.info.visit.depth = (unsigned)depth;
+        break;
+    case ccrpt_Done:
+        what.info.done.rc = (rc_t)rc;
+        what.info.done.mesg = text;
+        break;
+    case ccrpt_MD5:
+        what.info.MD5.rc = (rc_t)rc;
+        what.info.MD5.file = text;
+        break;
+    default:
+        return false;
+    }
+    return record_add(record, &what) == 0;
+}
 
-        RELEASE(VTable, ref);
-        RELEASE(VTable, seq);
-        RELEASE(VTable, sec);
-        RELEASE(VTable, pri);
+/* an unusable manifest is as good as none */
+static rc_t manifest_read(KDirectory const *wd, char const path[],
+    char const options[], manifest_t *self)
+{
+    KFile const *f = NULL;
+    uint64_t size = 0;
+    size_t num_read = 0;
+    char *buffer = NULL;
+    char *line;
+    bool ok = true;
+    rc_t rc;
+
+    memset(self, 0, sizeof(*self));
+
+    rc = KDirectoryOpenFileRead(wd, &f, "%s", path);
+    if (rc)
+        return rc;
+    rc = KFileSize(f, &size);
+    if (rc == 0 && size != (size_t)size)
+        rc = RC(rcExe, rcFile, rcReading, rcSize, rcExcessive);
+    if (rc == 0) {
+        buffer = malloc((size_t)size + 1);
+        if (buffer == NULL)
+            rc = RC(rcExe, rcData, rcAllocating, rcMemory, rcExhausted);
+    }
+    if (rc == 0)
+        rc = KFileReadAll(f, 0, buffer, (size_t)size, &num_read);
+    KFileRelease(f);
+    if (rc) {
+        free(buffer);
+        return rc;
+    }
+    buffer[num_read] = '\0';
 
-        break;
+    for (line = buffer; ok && *line != '\0'; ) {
+        char *const eol = strchr(line, '\n');
+        char *field[8];
+        unsigned n;
+
+        if (eol == NULL)
+            break;
+        *eol = '\0';
+
+        n = mf_fields(line, field, 7);
+        if (line == buffer)
+            ok = strcmp(line, MANIFEST_HEADER) == 0;
+        else if (strcmp(field[0], "options") == 0)
+            ok = n == 2 && strcmp(field[1], options) == 0;
+        else if (strcmp(field[0], "job") == 0)
+            ok = mf_parse_job(self, field, n);
+        else if (strcmp(field[0], "file") == 0 && self->jobs > 0)
+            ok = mf_parse_file(&self->job[self->jobs - 1].files, field, n);
+        else if (strcmp(field[0], "event") == 0 && self->jobs > 0)
+            ok = mf_parse_event(&self->job[self->jobs - 1].record, field, n);
+        else if (strcmp(field[0], "data") == 0) {
+            uint64_t data_rc = 0;
+
+            ok = n == 2 && mf_number(field[1], &data_rc);
+            self->data_rc = (rc_t)data_rc;
+            self->has_data = ok;
+        }
+        else
+            ok = false;
+        line = eol + 1;
+    }
+    if (*line != '\0')
+        ok = false; /* truncated */
+    free(buffer);
+
+    if (!ok) {
+        STSMSG(1, ("manifest '%s' is not usable", path));
+        manifest_whack(self);
+        return RC(rcExe, rcFile, rcParsing, rcFormat, rcInvalid);
     }
+    return 0;
+}
 
-    return rc;
+static bool mf_job_passed(mf_job_t const *self)
+{
+    unsigned i;
+
+    if (self->rc != 0)
+        return false;
+    for (i = 0; i < self->record.count; ++i) {
+        if (self->record.event[i].rc != 0)
+            return false;
+    }
+    return true;
 }
 
-static rc_t verify_database(const vdb_validate_params *pb, VDatabase const *db,
-    char const name[], node_t const nodes[], char const names[])
+/* the jobs that passed and whose files did not change get their events from
+   the manifest and are done; returns their number */
+static unsigned manifest_apply(manifest_t *self, cc_mt_t *mt,
+    mf_files_t const files[])
 {
-    char schemaName[1024];
-    char *schemaVers = NULL;
+    unsigned reused = 0;
+    unsigned i, j;
+
+    for (i = 0; i < mt->jobs; ++i) {
+        cc_job_t *const job = &mt->job[i];
+
+        if (job->done || !files[i].valid)
+            continue;
+        for (j = 0; j < self->jobs; ++j) {
+            mf_job_t *const prev = &self->job[j];
+
+            if (prev->depth == job->depth
+                && prev->table == (job->tbl != NULL)
+                && strcmp(prev->name, job->name) == 0
+                && mf_job_passed(prev)
+                && mf_files_equal(&prev->files, &files[i]))
+            {
+                job->record = prev->record;
+                memset(&prev->record, 0, sizeof(prev->record));
+                job->done = true;
+                ++reused;
+                STSMSG(1, ("'%s' has not changed since its last check",
+                           job->name));
+                break;
+            }
+        }
+    }
+    return reused;
+}
+
+typedef struct mf_out_s {
+    KDataBuffer buf;
+    uint64_t used;
     rc_t rc;
+} mf_out_t;
 
-    rc = get_db_schema_info(db, schemaName, sizeof(schemaName), &schemaVers);
-    if (rc) {
-        (void)PLOGERR(klogErr, (klogErr, rc,
-            "Failed to find database schema for '$(name)'", "name=%s", name));
-    }
-    else if (strncmp(schemaName, "NCBI:var:db:", 12) == 0) {
-        /* TODO: verify NCBI:var:db:* */
+static void mf_printf(mf_out_t *self, char const *fmt, ...)
+{
+    while (self->rc == 0) {
+        size_t const avail = (size_t)(self->buf.elem_count - self->used);
+        va_list args;
+        int n;
+
+        va_start(args, fmt);
+        n = vsnprintf((char *)self->buf.base + self->used, avail, fmt, args);
+        va_end(args);
+
+        if (n < 0)
+            self->rc = RC(rcExe, rcString, rcFormatting, rcData, rcInvalid);
+        else if ((size_t)n < avail)
+            self->used += n;
+        else {
+            self->rc = KDataBufferResize(&self->buf, 2 * (self->used + n + 1));
+            continue;
+        }
+        break;
     }
-    else if (strncmp(schemaName, "NCBI:WGS:db:", 12) == 0) {
-        /* TODO: verify NCBI:WGS:db:* */
+}
+
+static void mf_put_string(mf_out_t *self, char const *str)
+{
+    if (str == NULL) {
+        mf_printf(self, "\t-");
+        return;
     }
-    else if (strncmp(schemaName, "NCBI:align:db:", 14) == 0) {
-        rc = verify_database_align(pb, db, name, nodes, names);
+    mf_printf(self, "\t=");
+    for ( ; *str != '\0' && self->rc == 0; ++str) {
+        switch (*str) {
+        case '\t':
+            mf_printf(self, "\\t");
+            break;
+        case '\n':
+            mf_printf(self, "\\n");
+            break;
+        case '\\':
+            mf_printf(self, "\\\\");
+            break;
+        default:
+            mf_printf(self, "%c", *str);
+            break;
+        }
     }
-    else if (strcmp(schemaName, "NCBI:SRA:PacBio:smrt:db") == 0) {
-        /* TODO: verify NCBI:SRA:PacBio:smrt:db */
+}
+
+static void mf_put_job(mf_out_t *self, cc_job_t const *job,
+    mf_files_t const *files)
+{
+    unsigned i, k;
+
+    mf_printf(self, "job\t%u\t%c\t%u", job->depth,
+              job->tbl != NULL ? 't' : 'd', job->rc);
+    mf_put_string(self, job->name);
+    mf_printf(self, "\n");
+
+    for (i = 0; i < files->count; ++i) {
+        mf_file_t const *file = &files->file[i];
+
+        mf_printf(self, "file\t%lu\t%lu\t", file->size, (uint64_t)file->date);
+        if (!file->has_md5)
+            mf_printf(self, "-");
+        for (k = 0; file->has_md5 && k < sizeof(file->md5); ++k)
+            mf_printf(self, "%02x", file->md5[k]);
+        mf_put_string(self, file->path);
+        mf_printf(self, "\n");
     }
-    else {
-        (void)PLOGERR(klogWarn, (klogWarn,
-            RC(rcExe, rcDatabase, rcValidating, rcType, rcUnrecognized),
-            "Database '$(name)' has unrecognized type '$(type)'",
-            "name=%s,type=%s", name, schemaName));
+    for (i = 0; i < job->record.count; ++i) {
+        cc_event_t const *evt = &job->record.event[i];
+
+        mf_printf(self, "event\t%u\t%u\t%u\t%u", evt->objType, evt->type,
+                  evt->depth, evt->rc);
+        mf_put_string(self, evt->objName);
+        mf_put_string(self, evt->text);
+        mf_printf(self, "\n");
     }
-    return rc;
 }
 
-static rc_t verify_mgr_database(const vdb_validate_params *pb,
-    char const name[], node_t const nodes[], char const names[])
+/* written to a temporary file and renamed: a manifest is whole or none */
+static void manifest_write(char const path[], char const options[],
+    cc_mt_t const *mt, mf_files_t const files[], rc_t data_rc)
 {
-    rc_t rc = 0;
-    VDatabase const *child;
-    const VDBManager *mgr = NULL;
-    
-    assert(pb);
+    KDirectory *dir = NULL;
+    KFile *f = NULL;
+    mf_out_t out;
+    char tmp[4096 + 8];
+    unsigned i;
+    rc_t rc;
 
-    mgr = pb->vmgr;
+    memset(&out, 0, sizeof(out));
+    out.rc = KDataBufferMakeBytes(&out.buf, 64 * 1024);
+    mf_printf(&out, MANIFEST_HEADER "\noptions\t%s\n", options);
+    for (i = 0; i < mt->jobs; ++i) {
+        cc_job_t const *job = &mt->job[i];
 
-    rc = VDBManagerOpenDBRead(mgr, &child, NULL, "%s", name);
+        /* a job that did not run or that could not be listed is not kept */
+        if (job->done && files[i].valid)
+            mf_put_job(&out, job, &files[i]);
+    }
+    mf_printf(&out, "data\t%u\n", data_rc);
 
+    rc = out.rc;
+    if (rc == 0)
+        rc = KDirectoryNativeDir(&dir);
     if (rc == 0) {
-        rc = verify_database(pb, child, name, nodes, names);
-        VDatabaseRelease(child);
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        rc = KDirectoryCreateFile(dir, &f, false, 0664,
+                                  kcmInit | kcmParents, "%s", tmp);
     }
+    if (rc == 0) {
+        size_t num_writ = 0;
 
-    return rc;
+        rc = KFileWriteAll(f, 0, out.buf.base, (size_t)out.used, &num_writ);
+        if (rc == 0 && num_writ != out.used)
+            rc = RC(rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete);
+        KFileRelease(f);
+        if (rc == 0)
+            rc = KDirectoryRename(dir, true, tmp, path);
+        else
+            KDirectoryRemove(dir, false, "%s", tmp);
+    }
+    if (rc) {
+        (void)PLOGERR(klogWarn, (klogWarn, rc,
+            "Manifest '$(path)' could not be written", "path=%s", path));
+    }
+    KDirectoryRelease(dir);
+    KDataBufferWhack(&out.buf);
 }
 
-static rc_t sra_dbcc(const vdb_validate_params *pb,
-    char const name[], node_t const nodes[], char const names[])
+/* --threads: the consistency check of the object runs on worker threads
+ * while vdbcc and sra_dbcc run on this one.  Their log messages are held back
+ * and released after the replayed messages of the consistency check, if it
+ * passed: the order and the output of a serial run.
+ *
+ * --incremental: the jobs that need not run again are done before the
+ * threads start; the manifest is written when all threads are finished.
+ */
+static
+rc_t dbcc_mt ( const vdb_validate_params *pb, char const name[], uint32_t mode,
+    KPathType *pathType, bool is_file, node_t nodes[], char names[],
+    INSDC_SRA_platform_id platform )
 {
-    rc_t rc = 0;
+    cc_mt_t mt;
+    manifest_t manifest;
+    mf_files_t *files = NULL;
+    char options [ 512 ];
+    char mpath [ 4096 ];
+    bool incremental = pb -> incremental;
+    bool unchanged = false;
+
+    rc_t rc = kdbcc_path_type ( pb -> kmgr, name, pathType );
+    if ( rc != 0 )
+        return rc;
 
-    if (nodes[0].objType == kptDatabase)
-        rc = verify_mgr_database(pb, name, nodes, names);
-    else
-        rc = verify_mgr_table(pb, name);
+    memset ( & manifest, 0, sizeof manifest );
+    if ( incremental )
+    {
+        rc_t rc2 = manifest_path ( pb, name, mpath, sizeof mpath );
+        if ( rc2 != 0 )
+        {
+            (void)PLOGERR ( klogWarn, ( klogWarn, rc2,
+                "No manifest for '$(name)': it is checked in full",
+                "name=%s", name ) );
+            incremental = false;
+        }
+        else
+            manifest_options ( pb, mode, platform, options, sizeof options );
+    }
 
-    return rc;
-}
+    rc = cc_mt_make ( & mt, pb -> kmgr, name, * pathType, mode, platform );
+    if ( rc == 0 && incremental )
+    {
+        files = calloc ( mt . jobs, sizeof files [ 0 ] );
+        if ( files == NULL )
+            rc = RC ( rcExe, rcData, rcAllocating, rcMemory, rcExhausted );
+        else
+        {
+            unsigned i;
+            for ( i = 0; i < mt . jobs && rc == 0; ++ i )
+            {
+                mf_files_make ( & mt . job [ i ], & files [ i ] );
+                rc = Quitting ();
+            }
+            if ( rc == 0
+                && manifest_read ( pb -> wd, mpath, options, & manifest ) == 0 )
+            {
+                unchanged = manifest_apply ( & manifest, & mt, files ) == mt . jobs
+                         && manifest . has_data && manifest . data_rc == 0;
+            }
+        }
+    }
+    if ( rc == 0 )
+    {
+        log_capture_t capture;
 
-static
-rc_t get_platform(const VDBManager *mgr,
-    const VTable *aTbl, char const name[],
-    INSDC_SRA_platform_id *platform)
-{
-    rc_t rc = 0;
-    const VTable *tbl = aTbl;
-    assert(name && platform);
-    if (tbl == NULL) {
-        VSchema *sra_schema = NULL;
-        for ( ; rc == 0; ) {
-            rc = VDBManagerOpenTableRead(mgr, &tbl, sra_schema, "%s", name);
-            VSchemaRelease(sra_schema);
-            if (rc == 0) {
-                rc = VTable_get_platform(tbl, platform);
-                break;
+        /* before the first job starts: each job keeps its messages */
+        log_capture_start ( & capture );
+        rc = cc_mt_start ( & mt, pb -> threads );
+        if ( rc == 0 )
+        {
+            cc_context_t ctx;
+            node_t *tree = NULL;
+            char *tree_names = NULL;
+
+            rc_t rc2 = cc_mt_nodes ( & mt, * pathType, & tree, & tree_names );
+
+            if ( unchanged )
+            {
+                (void)PLOGMSG ( klogInfo, ( klogInfo, "'$(name)' has not changed "
+                    "since it was validated: data checks skipped", "name=%s", name ) );
             }
-            else if (GetRCState(rc) == rcNotFound && GetRCObject(rc) == (enum RCObject)rcSchema
-                && sra_schema == NULL)
+            else
             {
-                rc = VDBManagerMakeSRASchema(mgr, &sra_schema);
+                if ( rc2 == 0 )
+                    rc2 = vdbcc ( pb -> vmgr, name, mode, pathType, is_file );
+                if ( rc2 == 0 )
+                    rc2 = sra_dbcc ( pb, name, tree, tree_names );
+            }
+            log_capture_pass ( & capture );
+            free ( tree );
+
+            memset ( & ctx, 0, sizeof ctx );
+            ctx . nodes = & nodes [ 0 ];
+            ctx . names = & names [ 0 ];
+
+            rc = cc_mt_replay ( & mt, & ctx, & capture );
+            rc = kdbcc_done ( rc, & ctx, * pathType, name, is_file );
+            if ( rc == 0 )
+            {
+                log_capture_flush ( & capture );
+                rc = rc2;
             }
+            /* no job may log through the capture anymore */
+            cc_mt_wait ( & mt );
+
+            if ( incremental && files != NULL )
+                manifest_write ( mpath, options, & mt, files, rc2 );
         }
+        log_capture_whack ( & capture );
     }
 
-    if (aTbl == NULL)
-        VTableRelease(tbl);
+    if ( files != NULL )
+    {
+        unsigned i;
+        for ( i = 0; i < mt . jobs; ++ i )
+            mf_files_whack ( & files [ i ] );
+        free ( files );
+    }
+    manifest_whack ( & manifest );
+    cc_mt_whack ( & mt );
 
     return rc;
 }
@@ -2457,12 +4494,17 @@ rc_t dbcc ( const vdb_validate_params *pb, const char *path, bool is_file )
         INSDC_SRA_platform_id platform = SRA_PLATFORM_UNDEFINED;
         get_platform ( pb -> vmgr, NULL, path, & platform );
 
-        /* check as kdb object */
-        rc = kdbcc ( pb -> kmgr, path, mode, & pathType, is_file, nodes, names, platform );
-        if ( rc == 0 )
-            rc = vdbcc ( pb -> vmgr, path, mode, & pathType, is_file );
-        if ( rc == 0 )
-            rc = sra_dbcc(pb, path, nodes, names);
+        if ( pb -> threads > 1 || pb -> incremental )
+            rc = dbcc_mt ( pb, path, mode, & pathType, is_file, nodes, names, platform );
+        else
+        {
+            /* check as kdb object */
+            rc = kdbcc ( pb -> kmgr, path, mode, & pathType, is_file, nodes, names, platform );
+            if ( rc == 0 )
+                rc = vdbcc ( pb -> vmgr, path, mode, & pathType, is_file );
+            if ( rc == 0 )
+                rc = sra_dbcc(pb, path, nodes, names);
+        }
     }
 
     obj_type = ( pathType == kptDatabase ) ? "Database" : "Table";
@@ -2870,6 +4912,31 @@ static const char *USAGE_SDC_SEQ_ROWS[] =
 static const char *USAGE_SDC_PLEN_THOLD[] =
 { "Specify a threshold for amount of secondary alignment which are shorter (hard-clipped) than corresponding primaries, default 1%.", NULL };
 
+#define OPTION_THREADS "threads"
+static const char *USAGE_THREADS[] =
+{ "Number of threads checking the tables of a database, default 1.",
+  "The output does not depend on it", NULL };
+
+#define OPTION_MEM "mem"
+static const char *USAGE_MEM[] =
+{ "Memory for sorting referential integrity keys, default 2G.",
+  "Can have suffix K, M or G; keys that do not fit are sorted on disk", NULL };
+
+#define OPTION_TEMP "temp"
+static const char *USAGE_TEMP[] =
+{ "Directory of the scratch files of keys sorted on disk,",
+  "default: $TMPDIR or /tmp", NULL };
+
+#define OPTION_INCREMENTAL "incremental"
+static const char *USAGE_INCREMENTAL[] =
+{ "Do not check again what passed and did not change since:",
+  "files are taken as unchanged while they keep their size and date.",
+  "The results are kept in a manifest next to the object", NULL };
+
+#define OPTION_MANIFEST_DIR "manifest-dir"
+static const char *USAGE_MANIFEST_DIR[] =
+{ "Keep the manifests in this directory instead, implies --"
+  OPTION_INCREMENTAL, NULL };
 
 static const char *USAGE_DRI[] =
 { "Do not check data referential integrity for databases", NULL };
@@ -2894,6 +4961,12 @@ static OptDef options [] =
   , { OPTION_SDC_SEQ_ROWS, NULL      , NULL, USAGE_SDC_SEQ_ROWS, 1, true , false }
   , { OPTION_SDC_PLEN_THOLD, NULL    , NULL, USAGE_SDC_PLEN_THOLD, 1, true , false }
 
+  , { OPTION_THREADS , NULL          , NULL, USAGE_THREADS , 1, true , false }
+  , { OPTION_MEM     , NULL          , NULL, USAGE_MEM     , 1, true , false }
+  , { OPTION_TEMP    , NULL          , NULL, USAGE_TEMP    , 1, true , false }
+  , { OPTION_INCREMENTAL, NULL      , NULL, USAGE_INCREMENTAL, 1, false, false }
+  , { OPTION_MANIFEST_DIR, NULL     , NULL, USAGE_MANIFEST_DIR, 1, true , false }
+
     /* not printed by --help */
   , { "dri"          , NULL          , NULL, USAGE_DRI     , 1, false, false }
   , { "index-only"   ,NULL           , NULL, USAGE_IND_ONLY, 1, false, false }
@@ -2949,6 +5022,11 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine(NULL          , OPTION_SDC_SEC_ROWS, "rows"    , USAGE_SDC_SEC_ROWS);
     HelpOptionLine(NULL          , OPTION_SDC_SEQ_ROWS, "rows"    , USAGE_SDC_SEQ_ROWS);
     HelpOptionLine(NULL          , OPTION_SDC_PLEN_THOLD, "threshold", USAGE_SDC_PLEN_THOLD);
+    HelpOptionLine(NULL          , OPTION_THREADS , "count"   , USAGE_THREADS);
+    HelpOptionLine(NULL          , OPTION_MEM     , "bytes"   , USAGE_MEM);
+    HelpOptionLine(NULL          , OPTION_TEMP    , "path"    , USAGE_TEMP);
+    HelpOptionLine(NULL          , OPTION_INCREMENTAL, NULL   , USAGE_INCREMENTAL);
+    HelpOptionLine(NULL          , OPTION_MANIFEST_DIR, "path", USAGE_MANIFEST_DIR);
 
 /*
 #define NUM_LISTABLE_OPTIONS \
@@ -2984,6 +5062,7 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
     pb -> sdc_seq_rows.number = 100000;
     pb -> sdc_pa_len_thold_in_percent = true;
     pb -> sdc_pa_len_thold.percent = 0.01;
+    pb -> threads = 1;
 
   {
     rc = ArgsOptionCount(args, OPTION_CNS_CHK, &cnt);
@@ -3249,6 +5328,146 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
         }
     }
 
+    {
+        rc = ArgsOptionCount ( args, OPTION_THREADS, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_THREADS);
+            return rc;
+        }
+
+        if (cnt > 0)
+        {
+            uint64_t value;
+            rc = ArgsOptionValue ( args, OPTION_THREADS, 0, (const void **) &dummy );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "ArgsOptionValue() failed for " OPTION_THREADS);
+                return rc;
+            }
+
+            value = string_to_U64 ( dummy, string_size ( dummy ), &rc );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "string_to_U64() failed for " OPTION_THREADS);
+                return rc;
+            }
+            else if (value == 0 || value > 1024)
+            {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR (klogInt, rc, OPTION_THREADS " has illegal value (has to be 1-1024)" );
+                return rc;
+            }
+
+            pb->threads = (uint32_t)value;
+        }
+    }
+
+    {
+        rc = ArgsOptionCount ( args, OPTION_MEM, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_MEM);
+            return rc;
+        }
+
+        if (cnt > 0)
+        {
+            uint64_t value;
+            uint64_t unit = 1;
+            size_t value_size;
+            rc = ArgsOptionValue ( args, OPTION_MEM, 0, (const void **) &dummy );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "ArgsOptionValue() failed for " OPTION_MEM);
+                return rc;
+            }
+
+            value_size = string_size ( dummy );
+            if ( value_size >= 1 )
+            {
+                switch ( dummy[value_size - 1] )
+                {
+                case 'k': case 'K': unit = 1024; break;
+                case 'm': case 'M': unit = 1024 * 1024; break;
+                case 'g': case 'G': unit = 1024 * 1024 * 1024; break;
+                }
+                if ( unit != 1 )
+                    --value_size;
+            }
+
+            value = string_to_U64 ( dummy, value_size, &rc );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "string_to_U64() failed for " OPTION_MEM);
+                return rc;
+            }
+            else if (value > ((size_t)-1) / unit || value * unit < 1024)
+            {
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+                LOGERR (klogInt, rc, OPTION_MEM " has illegal value (has to be at least 1K)" );
+                return rc;
+            }
+
+            memory_suggestion = (size_t)(value * unit);
+        }
+    }
+
+    {
+        rc = ArgsOptionCount ( args, OPTION_TEMP, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_TEMP);
+            return rc;
+        }
+
+        if (cnt > 0)
+        {
+            rc = ArgsOptionValue ( args, OPTION_TEMP, 0, (const void **) &dummy );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "ArgsOptionValue() failed for " OPTION_TEMP);
+                return rc;
+            }
+            scratch_dir = dummy;
+        }
+        if (scratch_dir == NULL || scratch_dir[0] == '\0')
+            scratch_dir = getenv("TMPDIR");
+        if (scratch_dir == NULL || scratch_dir[0] == '\0')
+            scratch_dir = "/tmp";
+    }
+
+    {
+        rc = ArgsOptionCount ( args, OPTION_INCREMENTAL, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_INCREMENTAL);
+            return rc;
+        }
+        pb->incremental = cnt != 0;
+    }
+
+    {
+        rc = ArgsOptionCount ( args, OPTION_MANIFEST_DIR, &cnt );
+        if (rc)
+        {
+            LOGERR (klogInt, rc, "ArgsOptionCount() failed for " OPTION_MANIFEST_DIR);
+            return rc;
+        }
+
+        if (cnt > 0)
+        {
+            rc = ArgsOptionValue ( args, OPTION_MANIFEST_DIR, 0, (const void **) &dummy );
+            if (rc)
+            {
+                LOGERR (klogInt, rc, "ArgsOptionValue() failed for " OPTION_MANIFEST_DIR);
+                return rc;
+            }
+            pb->manifest_dir = dummy;
+            pb->incremental = true;
+        }
+    }
+
     if ( pb -> blob_crc || pb -> index_chk )
         pb -> md5_chk = pb -> md5_chk_explicit;
 
@@ -3335,12 +5554,17 @@ static rc_t main_with_args(Args *const args)
                         STSMSG(2, ("exhaustive = %d", exhaustive));
                         STSMSG(2, ("ref_int_check = %d", ref_int_check));
                         STSMSG(2, ("md5_required = %d", md5_required));
+                        STSMSG(2, ("memory_suggestion = %zu", memory_suggestion));
                         STSMSG(2, ("P {"));
                         STSMSG(2, ("\tmd5_chk = %d", pb.md5_chk));
                         STSMSG(2, ("\tmd5_chk_explicit = %d",
                             pb.md5_chk_explicit));
                         STSMSG(2, ("\tblob_crc = %d", pb.blob_crc));
                         STSMSG(2, ("\tconsist_check = %d", pb.consist_check));
+                        STSMSG(2, ("\tthreads = %u", pb.threads));
+                        STSMSG(2, ("\tincremental = %d", pb.incremental));
+                        if (pb.manifest_dir != NULL)
+                            STSMSG(2, ("\tmanifest_dir = %s", pb.manifest_dir));
                         STSMSG(2, ("}"));
                         for ( i = 0; i < pcount; ++ i )
                         {